@@ -44,15 +44,22 @@ void Population(T& index) {
   }
 }
 
+struct BenchmarkResult {
+  size_t succeed_ops;
+  size_t aborts_ops;
+  double probes_per_lookup;
+};
+
 template <typename T>
-std::pair<size_t, size_t> Benchmark(T& index,
-                                    LineairDB::EpochFramework& epoch_f,
-                                    size_t threads, size_t proportion,
-                                    bool populated, size_t duration) {
+BenchmarkResult Benchmark(T& index, LineairDB::EpochFramework& epoch_f,
+                          size_t threads, size_t proportion, bool populated,
+                          size_t duration) {
   std::atomic<size_t> count_down_latch(0);
   std::atomic<bool> end_flag(false);
   std::atomic<size_t> total_succeed(0);
   std::atomic<size_t> total_aborts(0);
+  std::atomic<size_t> total_lookups(0);
+  std::atomic<size_t> total_probes(0);
   std::vector<std::future<void>> futures;
 
   for (size_t i = 0; i < threads; i++) {
@@ -67,11 +74,15 @@ std::pair<size_t, size_t> Benchmark(T& index,
       std::uniform_int_distribution<> random_string(0, CHARACTERS.size() - 1);
 
       count_down_latch++;
+      const auto [lookups_before, probes_before] = T::GetProbeStatistics();
 
       for (;;) {
         if (end_flag.load()) {
+          const auto [lookups, probes] = T::GetProbeStatistics();
           total_succeed.fetch_add(operation_succeed);
           total_aborts.fetch_add(operation_aborts);
+          total_lookups.fetch_add(lookups - lookups_before);
+          total_probes.fetch_add(probes - probes_before);
           break;
         };
         epoch_f.MakeMeOnline();
@@ -140,8 +151,12 @@ std::pair<size_t, size_t> Benchmark(T& index,
           .count();
   auto success_ops = (total_succeed.load() / duration_ns) * 1000;
   auto aborts_ops  = (total_aborts.load() / duration_ns) * 1000;
+  const double probes_per_lookup =
+      total_lookups.load() == 0
+          ? 0
+          : static_cast<double>(total_probes.load()) / total_lookups.load();
 
-  return std::make_pair(success_ops, aborts_ops);
+  return {success_ops, aborts_ops, probes_per_lookup};
 }
 
 int main(int argc, char** argv) {
@@ -153,7 +168,7 @@ int main(int argc, char** argv) {
       ("t,thread", "The number of worker threads",
        cxxopts::value<size_t>()->default_value(
            std::to_string(std::thread::hardware_concurrency())))  //
-      ("s,structure", "Index data structure",
+      ("s,structure", "Index data structure [PrecisionLocking|OLCTree]",
        cxxopts::value<std::string>()->default_value("PrecisionLocking"))  //
       ("p,proportion", "Proportion of 'scan' operation",
        cxxopts::value<size_t>()->default_value("10"))  //
@@ -179,8 +194,9 @@ int main(int argc, char** argv) {
   const auto structure            = result["structure"].as<std::string>();
 
   /** run benchmark **/
-  auto ops = 0;
-  auto aps = 0;
+  auto ops                 = 0;
+  auto aps                 = 0;
+  double probes_per_lookup = 0;
 
   {
     using namespace LineairDB::Index;
@@ -190,6 +206,8 @@ int main(int argc, char** argv) {
     LineairDB::Config config;
     if (structure == "PrecisionLocking") {
       config.index_structure = decltype(config)::IndexStructure::HashTableWithPrecisionLockingIndex;
+    } else if (structure == "OLCTree") {
+      config.index_structure = decltype(config)::IndexStructure::HashTableWithOLCTreeIndex;
     } else {
       std::cout << "invalid structure name." << std::endl
                 << options.help() << std::endl;
@@ -204,12 +222,14 @@ int main(int argc, char** argv) {
     auto res =
         Benchmark<decltype(index)>(index, epoch_framework, threads, proportion,
                                    populated, measurement_duration);
-    ops = res.first;
-    aps = res.second;
+    ops               = res.succeed_ops;
+    aps               = res.aborts_ops;
+    probes_per_lookup = res.probes_per_lookup;
   }
   SPDLOG_INFO("IndexBench: measurement has finisihed.");
-  SPDLOG_INFO("Structure;CommitPS;AbortPS;OPS");
-  SPDLOG_INFO("{0};{1};{2};{3}", structure, ops, aps, ops + aps);
+  SPDLOG_INFO("Structure;CommitPS;AbortPS;OPS;ProbesPerLookup");
+  SPDLOG_INFO("{0};{1};{2};{3};{4:.2f}", structure, ops, aps, ops + aps,
+              probes_per_lookup);
 
   /** Output result as json format **/
   rapidjson::Document result_json(rapidjson::kObjectType);
@@ -220,6 +240,7 @@ int main(int argc, char** argv) {
   result_json.AddMember("cps", ops, allocator);
   result_json.AddMember("aps", aps, allocator);
   result_json.AddMember("ops", ops + aps, allocator);
+  result_json.AddMember("probes_per_lookup", probes_per_lookup, allocator);
 
   rapidjson::StringBuffer buffer;
   rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
@@ -30,8 +30,37 @@
 
 #include "lock/impl/readers_writers_lock.hpp"
 #include "lock/impl/ttas_lock.hpp"
+#include "lock/wait_policy.hpp"
 #include "spdlog/spdlog.h"
 
+// Emulates the lock bit of the transaction id, which Silo uses as the lock
+// of a data item.
+template <LineairDB::Config::LockWaitPolicy Policy>
+class TransactionIdLock {
+ public:
+  enum class LockType { Exclusive };
+  void Lock(LockType = LockType::Exclusive) {
+    for (;;) {
+      auto current = word_.load();
+      if (current & 1llu) {
+        wait_policy_.WaitUntil(&word_,
+                               [&]() { return !(word_.load() & 1llu); });
+        continue;
+      }
+      if (word_.compare_exchange_weak(current, current + 1)) return;
+    }
+  }
+  void UnLock() {
+    word_.fetch_add(1);
+    wait_policy_.NotifyReleased(&word_);
+  }
+  constexpr static bool IsReadersWritersLockingAlgorithm() { return false; }
+
+ private:
+  std::atomic<uint64_t> word_{0};
+  const LineairDB::Lock::WaitPolicy wait_policy_{Policy};
+};
+
 template <typename T>
 size_t benchmark(size_t threads, size_t duration) {
   T lock;
@@ -115,6 +144,15 @@ int main(int argc, char** argv) {
       ops = benchmark<ReadersWritersLockCO>(threads, measurement_duration);
     } else if (algorithm == "ReadersWritersLockBOCO") {
       ops = benchmark<ReadersWritersLockBOCO>(threads, measurement_duration);
+    } else if (algorithm == "TransactionIdLock") {
+      ops = benchmark<TransactionIdLock<LineairDB::Config::Yield>>(
+          threads, measurement_duration);
+    } else if (algorithm == "TransactionIdLockBO") {
+      ops = benchmark<TransactionIdLock<LineairDB::Config::SpinThenBackoff>>(
+          threads, measurement_duration);
+    } else if (algorithm == "TransactionIdLockPark") {
+      ops = benchmark<TransactionIdLock<LineairDB::Config::SpinThenPark>>(
+          threads, measurement_duration);
     } else {
       std::cout << "invalid algorithm name." << std::endl
                 << options.help() << std::endl;
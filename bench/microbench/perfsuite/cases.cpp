@@ -0,0 +1,380 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <lineairdb/lineairdb.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <experimental/filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "index/precision_locking_index/point_index/mpmc_concurrent_set_impl.hpp"
+#include "index/precision_locking_index/range_index/impl/std_map_container.hpp"
+#include "index/precision_locking_index/range_index/precision_locking.h"
+#include "perfsuite.h"
+#include "thread_pool/thread_pool.h"
+#include "util/32bit_set.hpp"
+#include "util/epoch_framework.hpp"
+
+namespace PerfSuite {
+
+namespace {
+
+// The keys are zero-padded, so that their lexical order is their numerical
+// order.
+std::string MakeKey(size_t i) {
+  std::string key = std::to_string(i);
+  return std::string(12 - std::min<size_t>(12, key.size()), '0') + key;
+}
+
+using PointIndex = LineairDB::Index::MPMCConcurrentSetImpl<size_t>;
+
+void Populate(PointIndex& set, size_t size) {
+  for (size_t i = 0; i < size; i++) set.Put(MakeKey(i), new size_t(i));
+}
+
+double MPMCSetGet(size_t threads, size_t size, size_t duration) {
+  PointIndex set(0.75, LineairDB::Config::HashIndexProbing::LinearProbing,
+                 size);
+  Populate(set, size);
+  return OperationsPerSecond(
+      threads, duration, [&](size_t i, const std::atomic<bool>& end_flag) {
+        std::mt19937_64 engine(i);
+        std::uniform_int_distribution<size_t> dist(
+            0, std::max<size_t>(1, size) - 1);
+        std::vector<std::string> keys;
+        for (size_t n = 0; n < 1024; n++) keys.push_back(MakeKey(dist(engine)));
+        size_t operations = 0;
+        while (!end_flag.load(std::memory_order_relaxed)) {
+          for (const auto& key : keys) set.Get(key);
+          operations += keys.size();
+        }
+        return operations;
+      });
+}
+
+double MPMCSetPut(size_t threads, size_t size, size_t duration) {
+  PointIndex set;
+  Populate(set, size);
+  return OperationsPerSecond(
+      threads, duration, [&](size_t i, const std::atomic<bool>& end_flag) {
+        // the keys after the populated ones, which no other thread inserts.
+        size_t operations = 0;
+        for (size_t key = size + i; !end_flag.load(std::memory_order_relaxed);
+             key += threads) {
+          set.Put(MakeKey(key), new size_t(key));
+          operations++;
+        }
+        return operations;
+      });
+}
+
+double PrecisionLockingBenchmark(size_t threads, size_t size, size_t duration,
+                                 bool scan) {
+  LineairDB::EpochFramework epoch_framework;
+  epoch_framework.Start();
+  LineairDB::Index::PrecisionLockingIndex index(
+      epoch_framework, std::make_unique<LineairDB::Index::StdMapContainer>());
+  for (size_t i = 0; i < size; i++) index.InsertDirectly(MakeKey(i));
+  constexpr size_t ScanWidth = 100;
+  const double ops           = OperationsPerSecond(
+      threads, duration, [&](size_t i, const std::atomic<bool>& end_flag) {
+        std::mt19937_64 engine(i);
+        std::uniform_int_distribution<size_t> dist(
+            0, std::max<size_t>(1, size) - 1);
+        size_t operations = 0;
+        size_t inserted   = size + i;
+        while (!end_flag.load(std::memory_order_relaxed)) {
+          epoch_framework.MakeMeOnline();
+          if (scan) {
+            const size_t begin = dist(engine);
+            index.Scan(MakeKey(begin), MakeKey(begin + ScanWidth),
+                       [](std::string_view) { return false; });
+          } else {
+            index.Insert(MakeKey(inserted));
+            inserted += threads;
+          }
+          epoch_framework.MakeMeOffline();
+          operations++;
+        }
+        return operations;
+      });
+  epoch_framework.Stop();
+  return ops;
+}
+
+double HalfWordSetOperations(size_t, size_t, size_t duration) {
+  // the configuration of the sets of the versions of PivotObject.
+  using Set = HalfWordSet<4>;
+  return OperationsPerSecond(
+      1, duration, [&](size_t, const std::atomic<bool>& end_flag) {
+        std::mt19937 engine(0);
+        std::vector<uint32_t> seeds(1024);
+        for (auto& seed : seeds) seed = engine();
+        size_t operations = 0;
+        size_t greater    = 0;
+        Set lhs, rhs;
+        while (!end_flag.load(std::memory_order_relaxed)) {
+          for (size_t n = 0; n + 1 < seeds.size(); n += 2) {
+            lhs.Put(seeds[n], seeds[n] % Set::MaxVersion + 1);
+            rhs.Put(seeds[n + 1], seeds[n + 1] % Set::MaxVersion + 1);
+            greater += lhs.IsGreaterThan(rhs);
+            greater += rhs.Get(seeds[n]) < lhs.Get(seeds[n]);
+            lhs = lhs.Merge(rhs);
+            operations += 5;
+          }
+          lhs = Set();
+        }
+        // keeps the compiler from removing the operations.
+        [[maybe_unused]] volatile size_t sink = greater;
+        return operations;
+      });
+}
+
+// The sets of the versions of a pivot object, as NWR merges and compares
+// them at the validation phase; see NWRPivotObject::IsReachableInto.
+template <typename Set>
+std::vector<Set> MakeVersionedSets(size_t seed, size_t sets, size_t items) {
+  std::mt19937 engine(seed);
+  std::vector<Set> versioned_sets(sets);
+  for (auto& set : versioned_sets) {
+    for (size_t i = 0; i < items; i++) {
+      set.Put(static_cast<uint32_t>(engine()),
+              engine() % Set::MaxVersion + 1);
+    }
+  }
+  return versioned_sets;
+}
+
+template <typename Set>
+double ValidationOperations(size_t duration) {
+  return OperationsPerSecond(
+      1, duration, [&](size_t, const std::atomic<bool>& end_flag) {
+        const auto rsets  = MakeVersionedSets<Set>(0, 1024, 4);
+        const auto wsets  = MakeVersionedSets<Set>(1, 1024, 4);
+        size_t operations = 0;
+        size_t reachable  = 0;
+        Set merged;
+        while (!end_flag.load(std::memory_order_relaxed)) {
+          for (size_t n = 0; n + 1 < rsets.size(); n++) {
+            reachable += rsets[n + 1].IsGreaterOrEqualThan(wsets[n]);
+            reachable += wsets[n + 1].IsGreaterThan(rsets[n]);
+            merged = merged.Merge(rsets[n]);
+            operations += 3;
+          }
+          reachable += merged.IsEmpty();
+          merged = Set();
+        }
+        // keeps the compiler from removing the operations.
+        [[maybe_unused]] volatile size_t sink = reachable;
+        return operations;
+      });
+}
+
+// The percentage of the comparisons of the sets of disjoint items that
+// report a dependency, which is a false positive of the hashing.
+template <typename Set>
+double FalsePositiveRate() {
+  constexpr size_t Comparisons = 100000;
+  const auto lhs = MakeVersionedSets<Set>(0, Comparisons, 4);
+  const auto rhs = MakeVersionedSets<Set>(1, Comparisons, 4);
+  size_t false_positives = 0;
+  for (size_t n = 0; n < Comparisons; n++) {
+    false_positives += rhs[n].IsGreaterOrEqualThan(lhs[n]);
+  }
+  return 100.0 * false_positives / Comparisons;
+}
+
+double HalfWordSetValidation(size_t, size_t bits, size_t duration) {
+  switch (bits) {
+    case 32:
+      return ValidationOperations<HalfWordSet<4>>(duration);
+    case 64:
+      return ValidationOperations<WideHalfWordSet<4, 64>>(duration);
+    default:
+      return ValidationOperations<WideHalfWordSet<4, 128>>(duration);
+  }
+}
+
+double HalfWordSetFalsePositives(size_t, size_t bits, size_t) {
+  switch (bits) {
+    case 32:
+      return FalsePositiveRate<HalfWordSet<4>>();
+    case 64:
+      return FalsePositiveRate<WideHalfWordSet<4, 64>>();
+    default:
+      return FalsePositiveRate<WideHalfWordSet<4, 128>>();
+  }
+}
+
+double ThreadPoolOperations(size_t threads, size_t, size_t duration) {
+  LineairDB::ThreadPool pool(threads);
+  std::vector<std::atomic<size_t>> completed(threads);
+  for (auto& count : completed) count.store(0);
+  // the jobs in flight of a producer are bounded, so that the queues stay
+  // short whichever side is faster.
+  constexpr size_t MaxJobsInFlight = 4096;
+  const double ops                 = OperationsPerSecond(
+      threads, duration, [&](size_t i, const std::atomic<bool>& end_flag) {
+        size_t enqueued = 0;
+        auto& count     = completed[i];
+        while (!end_flag.load(std::memory_order_relaxed)) {
+          if (enqueued - count.load(std::memory_order_relaxed) >=
+              MaxJobsInFlight) {
+            std::this_thread::yield();
+            continue;
+          }
+          pool.Enqueue([&count]() { count++; });
+          enqueued++;
+        }
+        while (count.load() != enqueued) std::this_thread::yield();
+        return enqueued;
+      });
+  pool.WaitForQueuesToBecomeEmpty();
+  return ops;
+}
+
+double EpochFrameworkOperations(size_t threads, size_t, size_t duration) {
+  LineairDB::EpochFramework epoch_framework;
+  epoch_framework.Start();
+  const double ops = OperationsPerSecond(
+      threads, duration, [&](size_t, const std::atomic<bool>& end_flag) {
+        size_t operations = 0;
+        while (!end_flag.load(std::memory_order_relaxed)) {
+          epoch_framework.MakeMeOnline();
+          epoch_framework.MakeMeOffline();
+          operations++;
+        }
+        return operations;
+      });
+  epoch_framework.Stop();
+  return ops;
+}
+
+/**
+ * The transactions which become durable per second, i.e., the throughput
+ * of the logger flushing the logs of `size`-byte writes.
+ */
+double LoggerFlush(size_t threads, size_t size, size_t duration) {
+  std::experimental::filesystem::remove_all("lineairdb_logs");
+  LineairDB::Config config;
+  config.max_thread           = threads;
+  config.enable_logging       = true;
+  config.enable_recovery      = false;
+  config.enable_checkpointing = false;
+  double ops                  = 0;
+  {
+    LineairDB::Database db(config);
+    const std::vector<std::byte> payload(size);
+    std::vector<std::atomic<size_t>> durable(threads);
+    for (auto& count : durable) count.store(0);
+    constexpr size_t MaxTransactionsInFlight = 1024;
+    ops = OperationsPerSecond(
+        threads, duration, [&](size_t i, const std::atomic<bool>& end_flag) {
+          auto& count      = durable[i];
+          size_t submitted = 0;
+          while (!end_flag.load(std::memory_order_relaxed)) {
+            // the transactions wait for an epoch to be durable.
+            if (submitted - count.load(std::memory_order_relaxed) >=
+                MaxTransactionsInFlight) {
+              std::this_thread::yield();
+              continue;
+            }
+            db.ExecuteTransaction(
+                [&, key = MakeKey(i * 1024 + submitted % 1024)](
+                    LineairDB::Transaction& tx) {
+                  tx.Write(key, payload.data(), payload.size());
+                },
+                [&count](LineairDB::TxStatus status) {
+                  if (status == LineairDB::TxStatus::Committed) count++;
+                });
+            submitted++;
+          }
+          return count.load();
+        });
+    db.Fence();
+  }
+  std::experimental::filesystem::remove_all("lineairdb_logs");
+  return ops;
+}
+
+/**
+ * The milliseconds to bulk load `size` data items, which is dominated by
+ * saving them as a full checkpoint with `threads` checkpoint threads.
+ */
+double CheckpointTime(size_t threads, size_t size, size_t) {
+  std::experimental::filesystem::remove_all("lineairdb_logs");
+  LineairDB::Config config;
+  config.enable_logging     = false;
+  config.enable_recovery    = false;
+  config.checkpoint_threads = threads;
+  double milliseconds       = 0;
+  {
+    LineairDB::Database db(config);
+    const std::vector<std::byte> payload(64);
+    const auto begin = std::chrono::high_resolution_clock::now();
+    db.BulkLoad([&](const LineairDB::Database::BulkLoadWriter& write) {
+      for (size_t i = 0; i < size; i++) {
+        write(MakeKey(i), payload.data(), payload.size());
+      }
+    });
+    const auto end = std::chrono::high_resolution_clock::now();
+    milliseconds =
+        std::chrono::duration<double, std::milli>(end - begin).count();
+  }
+  std::experimental::filesystem::remove_all("lineairdb_logs");
+  return milliseconds;
+}
+
+}  // namespace
+
+std::vector<Case> Cases() {
+  using namespace std::placeholders;
+  return {
+      {"mpmc_set/get", "ops/s", true, true, {10000, 1000000}, MPMCSetGet},
+      {"mpmc_set/put", "ops/s", true, true, {0, 1000000}, MPMCSetPut},
+      {"precision_locking/scan",
+       "ops/s",
+       true,
+       true,
+       {10000, 1000000},
+       std::bind(PrecisionLockingBenchmark, _1, _2, _3, true)},
+      {"precision_locking/insert",
+       "ops/s",
+       true,
+       true,
+       {10000, 1000000},
+       std::bind(PrecisionLockingBenchmark, _1, _2, _3, false)},
+      {"half_word_set/ops", "ops/s", true, false, {0}, HalfWordSetOperations},
+      {"half_word_set/validation", "ops/s", true, false, {32, 64, 128},
+       HalfWordSetValidation},
+      {"half_word_set/false_positives", "%", false, false, {32, 64, 128},
+       HalfWordSetFalsePositives},
+      {"thread_pool/enqueue_dequeue", "ops/s", true, true, {0},
+       ThreadPoolOperations},
+      {"epoch_framework/online_offline", "ops/s", true, true, {0},
+       EpochFrameworkOperations},
+      {"logger/flush", "txns/s", true, true, {8, 1024}, LoggerFlush},
+      {"checkpoint/full", "ms", false, true, {100000, 1000000},
+       CheckpointTime},
+  };
+}
+
+}  // namespace PerfSuite
@@ -0,0 +1,195 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <cxxopts.hpp>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "perfsuite.h"
+#include "spdlog/spdlog.h"
+
+/**
+ * The driver of the microbenchmarks of the components of LineairDB. It runs
+ * every case at every point of the sweeps of the numbers of threads and the
+ * data sizes, and compares the results with a baseline, i.e., the output of
+ * a previous run, to detect performance regressions.
+ */
+
+// A point of the sweeps: the name of the case, the threads and the size.
+using Point = std::tuple<std::string, size_t, size_t>;
+
+std::map<Point, double> ReadBaseline(const std::string& filename) {
+  std::ifstream input(filename);
+  std::stringstream content;
+  content << input.rdbuf();
+  rapidjson::Document baseline;
+  baseline.Parse(content.str().c_str());
+  if (!input.good() || baseline.HasParseError() || !baseline.IsObject() ||
+      !baseline.HasMember("results") || !baseline["results"].IsArray()) {
+    SPDLOG_ERROR("PerfSuite: unable to read the baseline {0}", filename);
+    exit(1);
+  }
+  std::map<Point, double> values;
+  const auto& results = baseline["results"];
+  for (rapidjson::SizeType i = 0; i < results.Size(); i++) {
+    const auto& r = results[i];
+    values[{r["name"].GetString(), r["threads"].GetUint64(),
+            r["size"].GetUint64()}] = r["value"].GetDouble();
+  }
+  return values;
+}
+
+std::string DefaultThreads() {
+  std::string threads = "1";
+  for (size_t n = 2; n <= std::thread::hardware_concurrency(); n *= 2) {
+    threads += "," + std::to_string(n);
+  }
+  return threads;
+}
+
+int main(int argc, char** argv) {
+  cxxopts::Options options(
+      "perfsuite",
+      "Microbenchmarks of the components with thread and data size sweeps");
+
+  options.add_options()          //
+      ("h,help", "Print usage")  //
+      ("t,threads", "Comma-separated numbers of threads of the sweep",
+       cxxopts::value<std::vector<size_t>>()->default_value(
+           DefaultThreads()))  //
+      ("z,sizes",
+       "Comma-separated data sizes of the sweep, instead of the ones of each "
+       "case",
+       cxxopts::value<std::vector<size_t>>())  //
+      ("f,filter", "Runs only the cases whose names contain this string",
+       cxxopts::value<std::string>()->default_value(""))  //
+      ("d,duration", "Measurement duration of each point (milliseconds)",
+       cxxopts::value<size_t>()->default_value("500"))  //
+      ("b,baseline", "JSON result of a previous run to compare with",
+       cxxopts::value<std::string>()->default_value(""))  //
+      ("r,threshold",
+       "Slowdown from the baseline that is reported as a regression "
+       "(percent)",
+       cxxopts::value<double>()->default_value("10"))  //
+      ("o,output", "Output JSON filename",
+       cxxopts::value<std::string>()->default_value(
+           "perfsuite_result.json"))  //
+      ;
+
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    exit(0);
+  }
+
+  const auto threads           = result["threads"].as<std::vector<size_t>>();
+  const auto duration          = result["duration"].as<size_t>();
+  const auto filter            = result["filter"].as<std::string>();
+  const auto threshold         = result["threshold"].as<double>() / 100;
+  const auto baseline_filename = result["baseline"].as<std::string>();
+  std::map<Point, double> baseline;
+  if (!baseline_filename.empty()) baseline = ReadBaseline(baseline_filename);
+
+  rapidjson::Document result_json(rapidjson::kObjectType);
+  auto& allocator = result_json.GetAllocator();
+  rapidjson::Value results(rapidjson::kArrayType);
+  size_t regressions = 0;
+
+  for (const auto& c : PerfSuite::Cases()) {
+    if (c.name.find(filter) == std::string::npos) continue;
+    // the sizes of the command line are not given to a case without sizes.
+    const bool sized = c.sizes != std::vector<size_t>{0};
+    const auto sizes = result.count("sizes") && sized
+                           ? result["sizes"].as<std::vector<size_t>>()
+                           : c.sizes;
+    for (const auto size : sizes) {
+      for (const auto thread : threads) {
+        if (!c.threaded && thread != threads.front()) break;
+        const size_t t     = c.threaded ? thread : 1;
+        const double value = c.run(t, size, duration);
+
+        rapidjson::Value r(rapidjson::kObjectType);
+        r.AddMember("name", rapidjson::Value(c.name.c_str(), allocator),
+                    allocator);
+        r.AddMember("unit", rapidjson::Value(c.unit.c_str(), allocator),
+                    allocator);
+        r.AddMember("threads", static_cast<uint64_t>(t), allocator);
+        r.AddMember("size", static_cast<uint64_t>(size), allocator);
+        r.AddMember("value", value, allocator);
+
+        const auto base = baseline.find({c.name, t, size});
+        if (base == baseline.end() || base->second == 0) {
+          SPDLOG_INFO("PerfSuite: {0} threads={1} size={2}: {3:.2f} {4}",
+                      c.name, t, size, value, c.unit);
+        } else {
+          // the change is positive if the case has become slower.
+          const double change =
+              c.higher_is_better ? (base->second - value) / base->second
+                                 : (value - base->second) / base->second;
+          const bool regression = threshold < change;
+          if (regression) regressions++;
+          SPDLOG_INFO(
+              "PerfSuite: {0} threads={1} size={2}: {3:.2f} {4} "
+              "(baseline {5:.2f}, {6:+.1f}% slower){7}",
+              c.name, t, size, value, c.unit, base->second, change * 100,
+              regression ? " REGRESSION" : "");
+          r.AddMember("baseline", base->second, allocator);
+          r.AddMember("slowdown", change, allocator);
+          r.AddMember("regression", regression, allocator);
+        }
+        results.PushBack(r, allocator);
+      }
+    }
+  }
+  result_json.AddMember("duration_ms", static_cast<uint64_t>(duration),
+                        allocator);
+  result_json.AddMember("results", results, allocator);
+  result_json.AddMember("regressions", static_cast<uint64_t>(regressions),
+                        allocator);
+
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  result_json.Accept(writer);
+  writer.Flush();
+
+  auto result_string   = buffer.GetString();
+  auto output_filename = result["output"].as<std::string>();
+  std::ofstream output_f(output_filename,
+                         std::ofstream::out | std::ofstream::trunc);
+  output_f << result_string;
+  if (!output_f.good()) {
+    std::cerr << "Unable to write output file" << output_filename << std::endl;
+    exit(1);
+  }
+  std::cout << "This benchmark result is saved into " << output_filename
+            << std::endl;
+  if (0 < regressions) {
+    SPDLOG_ERROR("PerfSuite: {0} regressions from the baseline {1}",
+                 regressions, baseline_filename);
+    return 1;
+  }
+  return 0;
+}
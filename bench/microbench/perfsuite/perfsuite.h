@@ -0,0 +1,84 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_PERFSUITE_H
+#define LINEAIRDB_PERFSUITE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace PerfSuite {
+
+/**
+ * A benchmark of a component, which is measured at every number of threads
+ * and every data size of the sweeps.
+ */
+struct Case {
+  std::string name;
+  // the unit of the measured value, e.g., "ops/s" or "ms".
+  std::string unit;
+  bool higher_is_better;
+  // false if the case has no concurrency, i.e., it is measured at one thread.
+  bool threaded;
+  // the default data sizes of the sweep; {0} if the case has no data size.
+  std::vector<size_t> sizes;
+  std::function<double(size_t threads, size_t size, size_t duration_ms)> run;
+};
+
+std::vector<Case> Cases();
+
+/**
+ * Runs `worker(i, end_flag)` on `threads` threads for `duration_ms`
+ * milliseconds. Each worker repeats its operation until `end_flag` is set
+ * and returns the number of operations it has done.
+ * @return the operations per second of all the workers.
+ */
+template <typename F>
+double OperationsPerSecond(size_t threads, size_t duration_ms, F&& worker) {
+  std::atomic<size_t> count_down_latch(0);
+  std::atomic<bool> end_flag(false);
+  std::vector<std::future<size_t>> futures;
+  for (size_t i = 0; i < threads; i++) {
+    futures.push_back(std::async(std::launch::async, [&, i]() {
+      count_down_latch++;
+      while (count_down_latch.load() != threads + 1) {
+        std::this_thread::yield();
+      }
+      return worker(i, end_flag);
+    }));
+  }
+  while (count_down_latch.load() != threads) { std::this_thread::yield(); }
+  const auto begin = std::chrono::high_resolution_clock::now();
+  count_down_latch++;
+  std::this_thread::sleep_for(std::chrono::milliseconds(duration_ms));
+  end_flag.store(true);
+  size_t operations = 0;
+  for (auto& future : futures) operations += future.get();
+  const auto end = std::chrono::high_resolution_clock::now();
+  const double seconds =
+      std::chrono::duration<double>(end - begin).count();
+  return operations / seconds;
+}
+
+}  // namespace PerfSuite
+
+#endif /* LINEAIRDB_PERFSUITE_H */
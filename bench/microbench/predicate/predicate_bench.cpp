@@ -0,0 +1,141 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <chrono>
+#include <cxxopts.hpp>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "index/precision_locking_index/range_index/impl/std_map_container.hpp"
+#include "index/precision_locking_index/range_index/precision_locking.h"
+#include "spdlog/spdlog.h"
+#include "util/epoch_framework.hpp"
+
+/**
+ * Measures the latency of PrecisionLockingIndex::Insert while the given number
+ * of scans (predicates) are alive in the current epochs.
+ * Predicates and inserted keys are disjoint, so that every Insert has to
+ * check the whole predicate set.
+ */
+double Benchmark(size_t scans, size_t inserts, size_t epoch_duration_ms) {
+  LineairDB::EpochFramework epoch_framework(epoch_duration_ms);
+  epoch_framework.Start();
+  LineairDB::Index::PrecisionLockingIndex index(
+      epoch_framework,
+      std::make_unique<LineairDB::Index::StdMapContainer>());
+
+  std::mt19937 engine(scans);
+  std::uniform_int_distribution<size_t> dist(0, 999999);
+  auto to_key = [](const char prefix, size_t i) {
+    auto key = std::to_string(i);
+    return prefix + std::string(6 - key.size(), '0') + key;
+  };
+
+  epoch_framework.Sync();
+  epoch_framework.MakeMeOnline();
+  for (size_t i = 0; i < scans; i++) {
+    const auto begin = dist(engine);
+    index.Scan(to_key('p', begin), to_key('p', begin + 10),
+               [](auto) { return false; });
+  }
+
+  const auto begin = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < inserts; i++) {
+    index.Insert(to_key('i', dist(engine)));
+  }
+  const auto end = std::chrono::high_resolution_clock::now();
+  epoch_framework.MakeMeOffline();
+
+  return static_cast<double>(
+             std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+                 .count()) /
+         inserts;
+}
+
+int main(int argc, char** argv) {
+  cxxopts::Options options(
+      "predicatebench",
+      "Microbenchmark of insert latency against the number of scans");
+
+  options.add_options()          //
+      ("h,help", "Print usage")  //
+      ("s,scans", "The maximum number of scans; it is multiplied by 10 from 1",
+       cxxopts::value<size_t>()->default_value("100000"))  //
+      ("i,inserts", "The number of inserts measured for each step",
+       cxxopts::value<size_t>()->default_value("10000"))  //
+      ("e,epoch", "Epoch duration (milliseconds); predicates have to be "
+                  "alive during the measurement",
+       cxxopts::value<size_t>()->default_value("1000"))  //
+      ("o,output", "Output JSON filename",
+       cxxopts::value<std::string>()->default_value(
+           "predicatebench_result.json"))  //
+      ;
+
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    exit(0);
+  }
+
+  const auto max_scans = result["scans"].as<size_t>();
+  const auto inserts   = result["inserts"].as<size_t>();
+  const auto epoch     = result["epoch"].as<size_t>();
+
+  /** Output result as json format **/
+  rapidjson::Document result_json(rapidjson::kObjectType);
+  auto& allocator = result_json.GetAllocator();
+  rapidjson::Value steps(rapidjson::kArrayType);
+
+  SPDLOG_INFO("Scans;InsertLatency(ns)");
+  for (size_t scans = 1; scans <= max_scans; scans *= 10) {
+    const auto latency = Benchmark(scans, inserts, epoch);
+    SPDLOG_INFO("{0};{1}", scans, latency);
+    rapidjson::Value step(rapidjson::kObjectType);
+    step.AddMember("scans", scans, allocator);
+    step.AddMember("insert_latency_ns", latency, allocator);
+    steps.PushBack(step, allocator);
+  }
+  SPDLOG_INFO("PredicateBench: measurement has finished.");
+  result_json.AddMember("inserts", inserts, allocator);
+  result_json.AddMember("results", steps, allocator);
+
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  result_json.Accept(writer);
+  writer.Flush();
+
+  auto result_string   = buffer.GetString();
+  auto output_filename = result["output"].as<std::string>();
+  std::ofstream output_f(output_filename,
+                         std::ofstream::out | std::ofstream::trunc);
+  output_f << result_string;
+  if (!output_f.good()) {
+    std::cerr << "Unable to write output file" << output_filename << std::endl;
+    exit(1);
+  }
+  std::cout << "This benchmark result is saved into " << output_filename
+            << std::endl;
+  return 0;
+}
@@ -29,11 +29,13 @@
 #include <set>
 #include <thread>
 #include <variant>
+#include <vector>
 
 #include "util/logger.hpp"
 
-size_t benchmark(const size_t db_size, const size_t buffer_size,
-                 const size_t number_of_updates_per_data_item) {
+std::vector<uint64_t> benchmark(const size_t db_size, const size_t buffer_size,
+                                const size_t number_of_updates_per_data_item,
+                                const std::vector<size_t>& thread_counts) {
   assert(0 < db_size);
   LineairDB::Config config;
   config.concurrency_control_protocol =
@@ -71,15 +73,23 @@ size_t benchmark(const size_t db_size, const size_t buffer_size,
     SPDLOG_INFO("DB Fence.");
   }
 
-  auto begin = std::chrono::high_resolution_clock::now();
-  LineairDB::Database db(config);
-  auto end     = std::chrono::high_resolution_clock::now();
-  auto elapsed = end - begin;
-
-  uint64_t milliseconds =
-      std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+  // Recover the same logs with each number of threads.
+  std::vector<uint64_t> results;
+  for (auto threads : thread_counts) {
+    config.max_thread = threads;
+    auto begin        = std::chrono::high_resolution_clock::now();
+    LineairDB::Database db(config);
+    auto end     = std::chrono::high_resolution_clock::now();
+    auto elapsed = end - begin;
+
+    uint64_t milliseconds =
+        std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+    SPDLOG_INFO("Recovery with {0} threads: {1} milliseconds", threads,
+                milliseconds);
+    results.push_back(milliseconds);
+  }
 
-  return milliseconds;
+  return results;
 }
 
 int main(int argc, char** argv) {
@@ -94,6 +104,9 @@ int main(int argc, char** argv) {
        cxxopts::value<size_t>()->default_value("1"))  //
       ("b,buffersize", "Buffer size (bytes) for each data item",
        cxxopts::value<size_t>()->default_value("8"))  //
+      ("t,threads", "Comma-separated numbers of threads used for recovery",
+       cxxopts::value<std::vector<size_t>>()->default_value(
+           std::to_string(std::thread::hardware_concurrency())))  //
       ("o,output", "Output JSON filename",
        cxxopts::value<std::string>()->default_value(
            "recoverytime_bench_result.json"))  //
@@ -108,19 +121,36 @@ int main(int argc, char** argv) {
   const size_t db_size     = result["dbsize"].as<size_t>();
   const size_t buffer_size = result["buffersize"].as<size_t>();
   const size_t updates     = result["updates"].as<size_t>();
+  const auto thread_counts = result["threads"].as<std::vector<size_t>>();
 
   std::experimental::filesystem::remove_all("lineairdb_logs");
 
   /** run benchmark **/
-  uint64_t elapsed_ms = benchmark(db_size, buffer_size, updates);
+  auto elapsed_ms = benchmark(db_size, buffer_size, updates, thread_counts);
 
   SPDLOG_INFO("RecoveryTimeBench: measurement has finisihed.");
-  SPDLOG_INFO("elapsed time: {0} milliseconds", elapsed_ms);
+  SPDLOG_INFO("elapsed time: {0} milliseconds", elapsed_ms.front());
 
   /** Output result as json format **/
   rapidjson::Document result_json(rapidjson::kObjectType);
   auto& allocator = result_json.GetAllocator();
-  result_json.AddMember("elapsed_ms", rapidjson::Value(elapsed_ms), allocator);
+  result_json.AddMember("elapsed_ms", rapidjson::Value(elapsed_ms.front()),
+                        allocator);
+  // The speedup is relative to the first number of threads.
+  rapidjson::Value results(rapidjson::kArrayType);
+  for (size_t i = 0; i < thread_counts.size(); i++) {
+    rapidjson::Value r(rapidjson::kObjectType);
+    r.AddMember("threads", rapidjson::Value(uint64_t{thread_counts[i]}),
+                allocator);
+    r.AddMember("elapsed_ms", rapidjson::Value(elapsed_ms[i]), allocator);
+    const double speedup =
+        elapsed_ms[i] == 0 ? 0.0
+                           : static_cast<double>(elapsed_ms.front()) /
+                                 static_cast<double>(elapsed_ms[i]);
+    r.AddMember("speedup", rapidjson::Value(speedup), allocator);
+    results.PushBack(r, allocator);
+  }
+  result_json.AddMember("results", results, allocator);
 
   rapidjson::StringBuffer buffer;
   rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
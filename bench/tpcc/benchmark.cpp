@@ -0,0 +1,194 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <lineairdb/database.h>
+#include <lineairdb/statistics.h>
+#include <lineairdb/transaction.h>
+#include <lineairdb/tx_status.h>
+#include <lineairdb/tx_type.h>
+#include <rapidjson/document.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "spdlog/spdlog.h"
+#include "transactions.h"
+
+namespace TPCC {
+
+namespace {
+
+// The mix of the transactions in percentage (Clause 5.2.3).
+constexpr std::array<size_t, TransactionTypes> Mix = {45, 43, 4, 4, 4};
+
+TransactionType ChooseTransaction(Random& random) {
+  size_t what_i_do  = random.Uniform(0, 99);
+  size_t proportion = 0;
+  for (size_t type = 0; type + 1 < TransactionTypes; type++) {
+    if (what_i_do < (proportion += Mix[type])) {
+      return static_cast<TransactionType>(type);
+    }
+  }
+  return static_cast<TransactionType>(TransactionTypes - 1);
+}
+
+bool Execute(const TransactionType type, LineairDB::Transaction& tx,
+             Client& client) {
+  switch (type) {
+    case NewOrder:
+      return DoNewOrder(tx, client);
+    case Payment:
+      return DoPayment(tx, client);
+    case OrderStatus:
+      return DoOrderStatus(tx, client);
+    case Delivery:
+      return DoDelivery(tx, client);
+    case StockLevel:
+      return DoStockLevel(tx, client);
+    default:
+      SPDLOG_ERROR("No transaction has found");
+      exit(1);
+  }
+}
+
+struct ClientResult {
+  std::array<uint64_t, TransactionTypes> commits{};
+  std::array<uint64_t, TransactionTypes> aborts{};
+  // the transactions rolled back by themselves; see DoNewOrder.
+  std::array<uint64_t, TransactionTypes> rollbacks{};
+};
+
+}  // namespace
+
+rapidjson::Document RunBenchmark(LineairDB::Database& db, uint32_t warehouses,
+                                 size_t client_size, size_t warmup_duration,
+                                 size_t measurement_duration) {
+  enum class Phase { Warmup, Measurement, Finished };
+  std::atomic<Phase> phase{Phase::Warmup};
+  std::atomic<size_t> waits_count(0);
+  std::vector<ClientResult> results(client_size);
+  std::vector<std::thread> clients;
+  std::random_device seeder;
+  for (size_t i = 0; i < client_size; i++) {
+    // The clients are spread over the warehouses.
+    clients.emplace_back([&, i, seed = seeder()]() {
+      Client client(i, i % warehouses + 1, warehouses, seed);
+      auto& result = results[i];
+      waits_count.fetch_add(1);
+      while (phase.load() != Phase::Finished) {
+        const auto type = ChooseTransaction(client.random);
+        auto& tx        = db.BeginTransaction(
+            type == OrderStatus || type == StockLevel
+                       ? LineairDB::TxType::ReadOnly
+                       : LineairDB::TxType::ReadWrite);
+        const bool completed = Execute(type, tx, client);
+        const bool precommitted =
+            db.EndTransaction(tx, [](LineairDB::TxStatus) {});
+        if (phase.load(std::memory_order_relaxed) != Phase::Measurement) {
+          continue;
+        }
+        if (!completed) {
+          result.rollbacks[type]++;
+        } else if (precommitted) {
+          result.commits[type]++;
+        } else {
+          result.aborts[type]++;
+        }
+      }
+    });
+  }
+  while (waits_count.load() != clients.size()) { std::this_thread::yield(); }
+
+  SPDLOG_INFO("TPC-C: Benchmark start.");
+  std::this_thread::sleep_for(std::chrono::milliseconds(warmup_duration));
+  phase.store(Phase::Measurement);
+  auto begin = std::chrono::high_resolution_clock::now();
+  std::this_thread::sleep_for(std::chrono::milliseconds(measurement_duration));
+  phase.store(Phase::Finished);
+  auto end = std::chrono::high_resolution_clock::now();
+  for (auto& client : clients) client.join();
+  SPDLOG_INFO("TPC-C: Benchmark end.");
+  db.Fence();
+
+  const uint64_t milliseconds = std::max<uint64_t>(
+      1, std::chrono::duration_cast<std::chrono::milliseconds>(end - begin)
+             .count());
+  rapidjson::Document result_json(rapidjson::kObjectType);
+  auto& allocator = result_json.GetAllocator();
+  rapidjson::Value transactions(rapidjson::kObjectType);
+  uint64_t total_commits = 0;
+  uint64_t total_aborts  = 0;
+  for (size_t type = 0; type < TransactionTypes; type++) {
+    uint64_t commits = 0, aborts = 0, rollbacks = 0;
+    for (const auto& result : results) {
+      commits += result.commits[type];
+      aborts += result.aborts[type];
+      rollbacks += result.rollbacks[type];
+    }
+    total_commits += commits;
+    total_aborts += aborts;
+    SPDLOG_INFO("TPC-C: {0}: commits {1}, aborts {2}, rollbacks {3}",
+                TransactionNames[type], commits, aborts, rollbacks);
+    rapidjson::Value counts(rapidjson::kObjectType);
+    counts.AddMember("commits", commits, allocator);
+    counts.AddMember("aborts", aborts, allocator);
+    counts.AddMember("rollbacks", rollbacks, allocator);
+    transactions.AddMember(rapidjson::StringRef(TransactionNames[type]),
+                           counts, allocator);
+  }
+  // tpmC is the number of the NewOrder transactions per minute.
+  uint64_t new_orders = 0;
+  for (const auto& result : results) new_orders += result.commits[NewOrder];
+  const uint64_t tpmc = new_orders * 60000 / milliseconds;
+  const uint64_t tps  = total_commits * 1000 / milliseconds;
+  SPDLOG_INFO(
+      "TPC-C: Benchmark completed. elapsed time: {0}ms, commits: {1}, "
+      "aborts: {2}, tps: {3}, tpmC: {4}",
+      milliseconds, total_commits, total_aborts, tps, tpmc);
+
+  result_json.AddMember("etime", milliseconds, allocator);
+  result_json.AddMember("commits", total_commits, allocator);
+  result_json.AddMember("aborts", total_aborts, allocator);
+  result_json.AddMember("tps", tps, allocator);
+  result_json.AddMember("tpmC", tpmc, allocator);
+  result_json.AddMember("transactions", transactions, allocator);
+
+  // The causes of the aborts, if LineairDB is built with
+  // ENABLE_INSTRUMENTATION. NOTE: they include the warmup.
+  using LineairDB::Statistics;
+  const auto statistics = db.GetStatistics();
+  if (statistics.instrumented) {
+    rapidjson::Value aborts(rapidjson::kObjectType);
+    for (size_t i = 0; i < Statistics::NumberOfAbortReasons; i++) {
+      const auto reason = static_cast<Statistics::AbortReason>(i);
+      SPDLOG_INFO("TPC-C: aborts by {0}: {1}",
+                  Statistics::AbortReasonName(reason), statistics.aborts[i]);
+      aborts.AddMember(
+          rapidjson::StringRef(Statistics::AbortReasonName(reason)),
+          statistics.aborts[i], allocator);
+    }
+    result_json.AddMember("abort_reasons", aborts, allocator);
+  }
+  return result_json;
+}
+
+}  // namespace TPCC
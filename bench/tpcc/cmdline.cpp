@@ -0,0 +1,163 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <lineairdb/config.h>
+#include <lineairdb/database.h>
+#include <rapidjson/document.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+
+#include <cxxopts.hpp>
+#include <experimental/filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "schema.h"
+#include "transactions.h"
+
+namespace TPCC {
+
+rapidjson::Document RunBenchmark(LineairDB::Database&, uint32_t, size_t,
+                                 size_t, size_t);
+
+}  // namespace TPCC
+
+const std::map<std::string, LineairDB::Config::ConcurrencyControl> Protocols = {
+    {"Silo", LineairDB::Config::ConcurrencyControl::Silo},
+    {"SiloNWR", LineairDB::Config::ConcurrencyControl::SiloNWR},
+    {"2PL", LineairDB::Config::ConcurrencyControl::TwoPhaseLocking},
+    {"2PLWaitDie",
+     LineairDB::Config::ConcurrencyControl::TwoPhaseLockingWaitDie},
+    {"2PLWoundWait",
+     LineairDB::Config::ConcurrencyControl::TwoPhaseLockingWoundWait},
+};
+
+std::vector<std::string> Split(const std::string& list) {
+  std::vector<std::string> elements;
+  std::stringstream stream(list);
+  std::string element;
+  while (std::getline(stream, element, ',')) {
+    if (!element.empty()) elements.emplace_back(element);
+  }
+  return elements;
+}
+
+int main(int argc, char** argv) {
+  cxxopts::Options options(
+      "tpcc", "TPC-C: the order-entry benchmark on the key-value interface");
+
+  options.add_options()          //
+      ("h,help", "Print usage")  //
+      ("W,warehouses", "Scale factor of TPC-C: the number of warehouses",
+       cxxopts::value<uint32_t>()->default_value("1"))  //
+      ("c,cc", "Comma-separated list of concurrency control protocols",
+       cxxopts::value<std::string>()->default_value("SiloNWR"))  //
+      ("t,thread", "Comma-separated list of the numbers of threads",
+       cxxopts::value<std::string>()->default_value("1"))  //
+      ("l,log", "Enable logging",
+       cxxopts::value<bool>()->default_value("false"))  //
+      ("e,epoch", "Size of epoch duration",
+       cxxopts::value<size_t>()->default_value("40"))  //
+      ("d,duration", "Measurement duration of each run (milliseconds)",
+       cxxopts::value<size_t>()->default_value("2000"))  //
+      ("u,warmup", "Warmup duration before the measurement (milliseconds)",
+       cxxopts::value<size_t>()->default_value("0"))  //
+      ("o,output", "Output JSON filename",
+       cxxopts::value<std::string>()->default_value("tpcc_result.json"))  //
+      ;
+
+  auto result = options.parse(argc, argv);
+  if (result.count("help")) {
+    std::cout << options.help() << std::endl;
+    exit(0);
+  }
+
+  const auto warehouses = result["warehouses"].as<uint32_t>();
+  const auto protocols  = Split(result["cc"].as<std::string>());
+  std::vector<size_t> threads;
+  for (const auto& thread : Split(result["thread"].as<std::string>())) {
+    threads.emplace_back(std::stoul(thread));
+  }
+  for (const auto& protocol : protocols) {
+    if (Protocols.find(protocol) == Protocols.end()) {
+      std::cerr << "Unknown concurrency control protocol: " << protocol
+                << std::endl;
+      exit(1);
+    }
+  }
+  if (warehouses == 0 || threads.empty()) {
+    std::cerr << "No warehouse or thread is given" << std::endl;
+    exit(1);
+  }
+
+  rapidjson::Document output_json(rapidjson::kObjectType);
+  auto& allocator = output_json.GetAllocator();
+  rapidjson::Value runs(rapidjson::kArrayType);
+
+  // Each run populates a new database, since the transactions of the
+  // previous run have grown the tables.
+  for (const auto& protocol : protocols) {
+    for (const auto thread : threads) {
+      std::experimental::filesystem::remove_all("lineairdb_logs");
+
+      LineairDB::Config config;
+      config.concurrency_control_protocol = Protocols.find(protocol)->second;
+      config.enable_recovery              = false;
+      config.enable_logging               = result["log"].as<bool>();
+      config.max_thread                   = thread;
+      config.epoch_duration_ms            = result["epoch"].as<size_t>();
+      config.expected_record_count =
+          TPCC::Items + static_cast<size_t>(warehouses) *
+                            (TPCC::Items + TPCC::DistrictsPerWarehouse *
+                                               TPCC::CustomersPerDistrict * 6);
+      LineairDB::Database db(config);
+
+      TPCC::Populate(db, warehouses);
+
+      auto run_json = TPCC::RunBenchmark(db, warehouses, thread,
+                                         result["warmup"].as<size_t>(),
+                                         result["duration"].as<size_t>());
+      run_json.AddMember("protocol",
+                         rapidjson::Value(protocol.c_str(), allocator),
+                         allocator);
+      run_json.AddMember("threads", static_cast<uint64_t>(thread), allocator);
+      runs.PushBack(rapidjson::Value(run_json, allocator), allocator);
+    }
+  }
+  output_json.AddMember("warehouses", warehouses, allocator);
+  output_json.AddMember("runs", runs, allocator);
+
+  rapidjson::StringBuffer buffer;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+  output_json.Accept(writer);
+  writer.Flush();
+
+  auto output_filename = result["output"].as<std::string>();
+  std::ofstream output_f(output_filename,
+                         std::ofstream::out | std::ofstream::trunc);
+  output_f << buffer.GetString();
+  if (!output_f.good()) {
+    std::cerr << "Unable to write output file" << output_filename << std::endl;
+    exit(1);
+  }
+  std::cout << "This benchmark result is saved into " << output_filename
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_TPCC_RANDOM_HPP
+#define LINEAIRDB_TPCC_RANDOM_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+
+namespace TPCC {
+
+/**
+ * The random numbers and strings of TPC-C (Clause 4.3.2).
+ */
+class Random {
+ public:
+  Random(uint64_t seed) : engine_(seed) {}
+
+  uint64_t Uniform(uint64_t min, uint64_t max) {
+    return std::uniform_int_distribution<uint64_t>(min, max)(engine_);
+  }
+  double UniformReal(double min, double max) {
+    return std::uniform_real_distribution<double>(min, max)(engine_);
+  }
+
+  /**
+   * NURand(A, x, y) of Clause 2.1.6. The constant C is the same for all the
+   * clients of a run.
+   */
+  uint64_t NonUniform(uint64_t a, uint64_t x, uint64_t y) {
+    const uint64_t c = a == 255 ? 123 : a == 1023 ? 259 : 7911;
+    return (((Uniform(0, a) | Uniform(x, y)) + c) % (y - x + 1)) + x;
+  }
+  uint32_t CustomerId() { return NonUniform(1023, 1, 3000); }
+  uint32_t ItemId() { return NonUniform(8191, 1, 100000); }
+
+  // a random a-string of [min, max] characters into `out`.
+  void AlphaString(char* out, size_t min, size_t max) {
+    static constexpr char Alphabet[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    const size_t size = Uniform(min, max);
+    for (size_t i = 0; i < size; i++) {
+      out[i] = Alphabet[Uniform(0, sizeof(Alphabet) - 2)];
+    }
+    out[size] = '\0';
+  }
+  void NumberString(char* out, size_t size) {
+    for (size_t i = 0; i < size; i++) out[i] = '0' + Uniform(0, 9);
+    out[size] = '\0';
+  }
+  // a-string which contains "ORIGINAL" at 10% (Clause 4.3.3.1).
+  void Data(char* out, size_t min, size_t max) {
+    AlphaString(out, min, max);
+    if (Uniform(1, 10) == 1) {
+      const size_t size = std::strlen(out);
+      std::memcpy(out + Uniform(0, size - 8), "ORIGINAL", 8);
+    }
+  }
+
+  /**
+   * The last name of the number `n` in [0, 999] (Clause 4.3.2.3).
+   */
+  static std::string LastName(uint32_t n) {
+    static const char* Syllables[] = {"BAR", "OUGHT", "ABLE",  "PRI",
+                                      "PRES", "ESE",  "ANTI",  "CALLY",
+                                      "ATION", "EING"};
+    return std::string(Syllables[n / 100]) + Syllables[(n / 10) % 10] +
+           Syllables[n % 10];
+  }
+  std::string RandomLastName() { return LastName(NonUniform(255, 0, 999)); }
+
+ private:
+  std::mt19937_64 engine_;
+};
+
+}  // namespace TPCC
+
+#endif /* LINEAIRDB_TPCC_RANDOM_HPP */
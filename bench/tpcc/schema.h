@@ -0,0 +1,185 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_TPCC_SCHEMA_H
+#define LINEAIRDB_TPCC_SCHEMA_H
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+/**
+ * The tables of TPC-C on the key-value interface of LineairDB.
+ *
+ * NOTE:
+ * as bench/ycsb does, the name of a table and the primary key of a row are
+ * concatenated into a key, and the columns of a row are stored as a
+ * trivially copyable struct. The numbers in the keys are zero-padded, so that
+ * the lexical order of the keys is the order of the primary keys and a range
+ * of the keys is a range of the rows: e.g., the order lines of an order, or
+ * the oldest new order of a district.
+ * The secondary index of the customers by their last names (CustomerByName)
+ * and the one of the orders by their customers (OrderByCustomer) are tables
+ * as well; the latter is ordered from the latest order.
+ */
+namespace TPCC {
+
+constexpr uint32_t Items                    = 100000;
+constexpr uint32_t DistrictsPerWarehouse    = 10;
+constexpr uint32_t CustomersPerDistrict     = 3000;
+constexpr uint32_t InitialOrdersPerDistrict = 3000;
+// the last orders of each district are not delivered at the population.
+constexpr uint32_t InitialNewOrdersPerDistrict = 900;
+constexpr uint32_t MaxOrderLines               = 15;
+constexpr uint32_t MaxOrderId                  = 99999999;
+
+struct Warehouse {
+  double tax;
+  double ytd;
+  char name[11];
+  char street[21];
+  char city[21];
+  char state[3];
+  char zip[10];
+};
+
+struct District {
+  double tax;
+  double ytd;
+  uint32_t next_o_id;
+  char name[11];
+  char street[21];
+  char city[21];
+  char state[3];
+  char zip[10];
+};
+
+struct Customer {
+  double discount;
+  double credit_lim;
+  double balance;
+  double ytd_payment;
+  uint32_t payment_cnt;
+  uint32_t delivery_cnt;
+  uint64_t since;
+  char first[17];
+  char middle[3];
+  char last[17];
+  char credit[3];
+  char phone[17];
+  char data[501];
+};
+
+struct History {
+  uint32_t c_id;
+  uint32_t c_d_id;
+  uint32_t c_w_id;
+  uint32_t d_id;
+  uint32_t w_id;
+  double amount;
+  uint64_t date;
+  char data[25];
+};
+
+struct Order {
+  uint32_t c_id;
+  uint32_t carrier_id;  // 0 until the order is delivered
+  uint32_t ol_cnt;
+  bool all_local;
+  uint64_t entry_d;
+};
+
+struct OrderLine {
+  uint32_t i_id;
+  uint32_t supply_w_id;
+  uint32_t quantity;
+  double amount;
+  uint64_t delivery_d;  // 0 until the order is delivered
+  char dist_info[25];
+};
+
+struct Item {
+  uint32_t im_id;
+  double price;
+  char name[25];
+  char data[51];
+};
+
+struct Stock {
+  uint32_t quantity;
+  uint32_t ytd;
+  uint32_t order_cnt;
+  uint32_t remote_cnt;
+  char dist[DistrictsPerWarehouse][25];
+  char data[51];
+};
+
+namespace Key {
+
+inline std::string Format(const char* format, ...)
+    __attribute__((format(printf, 1, 2)));
+inline std::string Format(const char* format, ...) {
+  char buffer[64];
+  va_list args;
+  va_start(args, format);
+  const int size = std::vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  return std::string(buffer, size);
+}
+
+inline std::string Warehouse(uint32_t w) { return Format("w%04u", w); }
+inline std::string District(uint32_t w, uint32_t d) {
+  return Format("d%04u%02u", w, d);
+}
+inline std::string Customer(uint32_t w, uint32_t d, uint32_t c) {
+  return Format("c%04u%02u%04u", w, d, c);
+}
+// The last names are padded by spaces, which precede the letters.
+inline std::string CustomerByName(uint32_t w, uint32_t d,
+                                  std::string_view last, uint32_t c) {
+  return Format("C%04u%02u%-16.*s%04u", w, d, static_cast<int>(last.size()),
+                last.data(), c);
+}
+inline std::string History(uint32_t w, uint32_t d, uint32_t c,
+                           uint32_t client, uint64_t sequence) {
+  return Format("h%04u%02u%04u%04u%012llu", w, d, c, client,
+                static_cast<unsigned long long>(sequence));
+}
+inline std::string Order(uint32_t w, uint32_t d, uint32_t o) {
+  return Format("o%04u%02u%08u", w, d, o);
+}
+inline std::string OrderByCustomer(uint32_t w, uint32_t d, uint32_t c,
+                                   uint32_t o) {
+  return Format("O%04u%02u%04u%08u", w, d, c, MaxOrderId - o);
+}
+inline std::string NewOrder(uint32_t w, uint32_t d, uint32_t o) {
+  return Format("n%04u%02u%08u", w, d, o);
+}
+inline std::string OrderLine(uint32_t w, uint32_t d, uint32_t o,
+                             uint32_t number) {
+  return Format("l%04u%02u%08u%02u", w, d, o, number);
+}
+inline std::string Item(uint32_t i) { return Format("i%06u", i); }
+inline std::string Stock(uint32_t w, uint32_t i) {
+  return Format("s%04u%06u", w, i);
+}
+
+}  // namespace Key
+}  // namespace TPCC
+
+#endif /* LINEAIRDB_TPCC_SCHEMA_H */
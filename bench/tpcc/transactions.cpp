@@ -0,0 +1,452 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+/**
+ * TPC-C Benchmark: the five transactions of the specification [1] on the
+ * tables of schema.h.
+ *
+ * NOTE:
+ * the terminals do not wait for the keying and think times, and the
+ * transactions are executed one after another, as most of the in-memory
+ * database studies do (e.g., Silo (SOSP '13)). The customers of the same
+ * last name are ordered by their ids instead of their first names.
+ *
+ * @ref [1] http://www.tpc.org/tpc_documents_current_versions/pdf/tpc-c_v5.11.0.pdf
+ */
+
+#include "transactions.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "schema.h"
+#include "spdlog/spdlog.h"
+
+namespace TPCC {
+
+namespace {
+
+uint64_t Now() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+template <typename T>
+void Put(const LineairDB::Database::BulkLoadWriter& write,
+         const std::string& key, const T& row) {
+  write(key, reinterpret_cast<const std::byte*>(&row), sizeof(T));
+}
+
+// The home warehouse at `percentage_of_home`%, or another one at random
+// (Clause 2.4.1.5 and 2.5.1.2).
+uint32_t ChooseWarehouse(Client& client, uint32_t percentage_of_home) {
+  if (client.warehouses == 1 ||
+      client.random.Uniform(1, 100) <= percentage_of_home) {
+    return client.warehouse;
+  }
+  for (;;) {
+    const uint32_t w = client.random.Uniform(1, client.warehouses);
+    if (w != client.warehouse) return w;
+  }
+}
+
+/**
+ * Finds the customer of the middle position among the customers of `last`
+ * (Clause 2.5.2.2).
+ */
+std::optional<uint32_t> FindCustomerByName(LineairDB::Transaction& tx,
+                                           uint32_t w, uint32_t d,
+                                           const std::string& last) {
+  std::vector<uint32_t> customers;
+  const auto begin = Key::CustomerByName(w, d, last, 0);
+  const auto end   = Key::CustomerByName(w, d, last, CustomersPerDistrict);
+  tx.Scan<uint32_t>(begin, end, [&](std::string_view, uint32_t c) {
+    customers.push_back(c);
+    return false;
+  });
+  if (customers.empty()) return std::nullopt;
+  return customers[(customers.size() - 1) / 2];
+}
+
+// The customer by the last name at 60%, otherwise by the id.
+std::optional<uint32_t> ChooseCustomer(LineairDB::Transaction& tx,
+                                       Client& client, uint32_t w,
+                                       uint32_t d) {
+  if (client.random.Uniform(1, 100) <= 60) {
+    return FindCustomerByName(tx, w, d, client.random.RandomLastName());
+  }
+  return client.random.CustomerId();
+}
+
+}  // namespace
+
+void Populate(LineairDB::Database& db, uint32_t warehouses) {
+  Random random(0xC0FFEE);
+  const uint64_t now = Now();
+  db.BulkLoad([&](const LineairDB::Database::BulkLoadWriter& write) {
+    for (uint32_t i = 1; i <= Items; i++) {
+      Item item;
+      item.im_id = random.Uniform(1, 10000);
+      item.price = random.Uniform(100, 10000) / 100.0;
+      random.AlphaString(item.name, 14, 24);
+      random.Data(item.data, 26, 50);
+      Put(write, Key::Item(i), item);
+    }
+
+    for (uint32_t w = 1; w <= warehouses; w++) {
+      Warehouse warehouse;
+      warehouse.tax = random.Uniform(0, 2000) / 10000.0;
+      warehouse.ytd = 300000;
+      random.AlphaString(warehouse.name, 6, 10);
+      random.AlphaString(warehouse.street, 10, 20);
+      random.AlphaString(warehouse.city, 10, 20);
+      random.AlphaString(warehouse.state, 2, 2);
+      random.NumberString(warehouse.zip, 9);
+      Put(write, Key::Warehouse(w), warehouse);
+
+      for (uint32_t i = 1; i <= Items; i++) {
+        Stock stock;
+        stock.quantity   = random.Uniform(10, 100);
+        stock.ytd        = 0;
+        stock.order_cnt  = 0;
+        stock.remote_cnt = 0;
+        for (auto& dist : stock.dist) random.AlphaString(dist, 24, 24);
+        random.Data(stock.data, 26, 50);
+        Put(write, Key::Stock(w, i), stock);
+      }
+
+      for (uint32_t d = 1; d <= DistrictsPerWarehouse; d++) {
+        District district;
+        district.tax       = random.Uniform(0, 2000) / 10000.0;
+        district.ytd       = 30000;
+        district.next_o_id = InitialOrdersPerDistrict + 1;
+        random.AlphaString(district.name, 6, 10);
+        random.AlphaString(district.street, 10, 20);
+        random.AlphaString(district.city, 10, 20);
+        random.AlphaString(district.state, 2, 2);
+        random.NumberString(district.zip, 9);
+        Put(write, Key::District(w, d), district);
+
+        for (uint32_t c = 1; c <= CustomersPerDistrict; c++) {
+          const auto last = c <= 1000 ? Random::LastName(c - 1)
+                                      : random.RandomLastName();
+          Customer customer;
+          customer.discount     = random.Uniform(0, 5000) / 10000.0;
+          customer.credit_lim   = 50000;
+          customer.balance      = -10;
+          customer.ytd_payment  = 10;
+          customer.payment_cnt  = 1;
+          customer.delivery_cnt = 0;
+          customer.since        = now;
+          random.AlphaString(customer.first, 8, 16);
+          std::strcpy(customer.middle, "OE");
+          std::snprintf(customer.last, sizeof(customer.last), "%s",
+                        last.c_str());
+          std::strcpy(customer.credit,
+                      random.Uniform(1, 100) <= 10 ? "BC" : "GC");
+          random.NumberString(customer.phone, 16);
+          random.AlphaString(customer.data, 300, 500);
+          Put(write, Key::Customer(w, d, c), customer);
+          Put(write, Key::CustomerByName(w, d, last, c), c);
+
+          History history;
+          history.c_id   = c;
+          history.c_d_id = d;
+          history.c_w_id = w;
+          history.d_id   = d;
+          history.w_id   = w;
+          history.amount = 10;
+          history.date   = now;
+          random.AlphaString(history.data, 12, 24);
+          Put(write, Key::History(w, d, c, 0, 0), history);
+        }
+
+        // The orders are of a random permutation of the customers.
+        std::vector<uint32_t> customers(CustomersPerDistrict);
+        std::iota(customers.begin(), customers.end(), 1);
+        for (uint32_t i = customers.size() - 1; 0 < i; i--) {
+          std::swap(customers[i], customers[random.Uniform(0, i)]);
+        }
+        const uint32_t first_new_order =
+            InitialOrdersPerDistrict - InitialNewOrdersPerDistrict + 1;
+        for (uint32_t o = 1; o <= InitialOrdersPerDistrict; o++) {
+          const bool delivered = o < first_new_order;
+          Order order;
+          order.c_id       = customers[o - 1];
+          order.carrier_id = delivered ? random.Uniform(1, 10) : 0;
+          order.ol_cnt     = random.Uniform(5, MaxOrderLines);
+          order.all_local  = true;
+          order.entry_d    = now;
+          Put(write, Key::Order(w, d, o), order);
+          Put(write, Key::OrderByCustomer(w, d, order.c_id, o), o);
+          if (!delivered) Put(write, Key::NewOrder(w, d, o), o);
+
+          for (uint32_t number = 1; number <= order.ol_cnt; number++) {
+            OrderLine line;
+            line.i_id        = random.Uniform(1, Items);
+            line.supply_w_id = w;
+            line.quantity    = 5;
+            line.amount =
+                delivered ? 0 : random.Uniform(1, 999999) / 100.0;
+            line.delivery_d = delivered ? now : 0;
+            random.AlphaString(line.dist_info, 24, 24);
+            Put(write, Key::OrderLine(w, d, o, number), line);
+          }
+        }
+      }
+      SPDLOG_INFO("TPC-C: warehouse {0} is populated", w);
+    }
+  });
+}
+
+bool DoNewOrder(LineairDB::Transaction& tx, Client& client) {
+  auto& random     = client.random;
+  const uint32_t w = client.warehouse;
+  const uint32_t d = random.Uniform(1, DistrictsPerWarehouse);
+  const uint32_t c = random.CustomerId();
+  struct Line {
+    uint32_t i_id;
+    uint32_t supply_w_id;
+    uint32_t quantity;
+  };
+  std::vector<Line> lines(random.Uniform(5, MaxOrderLines));
+  bool all_local = true;
+  for (auto& line : lines) {
+    line.i_id        = random.ItemId();
+    line.supply_w_id = ChooseWarehouse(client, 99);
+    line.quantity    = random.Uniform(1, 10);
+    all_local &= line.supply_w_id == w;
+  }
+  // 1% of the transactions order an unused item, and are rolled back.
+  if (random.Uniform(1, 100) == 1) lines.back().i_id = Items + 1;
+
+  const auto warehouse = tx.Read<Warehouse>(Key::Warehouse(w));
+  const auto district_key = Key::District(w, d);
+  auto district           = tx.Read<District>(district_key);
+  const auto customer     = tx.Read<Customer>(Key::Customer(w, d, c));
+  if (!warehouse || !district || !customer) return true;  // aborted
+  const uint32_t o = district->next_o_id++;
+  tx.Write(district_key, district.value());
+
+  Order order;
+  order.c_id       = c;
+  order.carrier_id = 0;
+  order.ol_cnt     = lines.size();
+  order.all_local  = all_local;
+  order.entry_d    = Now();
+  tx.Write(Key::Order(w, d, o), order);
+  tx.Write(Key::OrderByCustomer(w, d, c, o), o);
+  tx.Write(Key::NewOrder(w, d, o), o);
+
+  for (uint32_t number = 1; number <= lines.size(); number++) {
+    const auto& line = lines[number - 1];
+    const auto item  = tx.Read<Item>(Key::Item(line.i_id));
+    if (!item) {
+      if (tx.IsAborted()) return true;
+      tx.Abort();
+      return false;
+    }
+    const auto stock_key = Key::Stock(line.supply_w_id, line.i_id);
+    auto stock           = tx.Read<Stock>(stock_key);
+    if (!stock) return true;
+    if (line.quantity + 10 <= stock->quantity) {
+      stock->quantity -= line.quantity;
+    } else {
+      stock->quantity = stock->quantity - line.quantity + 91;
+    }
+    stock->ytd += line.quantity;
+    stock->order_cnt++;
+    if (line.supply_w_id != w) stock->remote_cnt++;
+    tx.Write(stock_key, stock.value());
+
+    OrderLine order_line;
+    order_line.i_id        = line.i_id;
+    order_line.supply_w_id = line.supply_w_id;
+    order_line.quantity    = line.quantity;
+    order_line.amount      = line.quantity * item->price *
+                        (1 + warehouse->tax + district->tax) *
+                        (1 - customer->discount);
+    order_line.delivery_d = 0;
+    std::memcpy(order_line.dist_info, stock->dist[d - 1],
+                sizeof(order_line.dist_info));
+    tx.Write(Key::OrderLine(w, d, o, number), order_line);
+  }
+  return true;
+}
+
+bool DoPayment(LineairDB::Transaction& tx, Client& client) {
+  auto& random       = client.random;
+  const uint32_t w   = client.warehouse;
+  const uint32_t d   = random.Uniform(1, DistrictsPerWarehouse);
+  const uint32_t c_w = ChooseWarehouse(client, 85);
+  const uint32_t c_d =
+      c_w == w ? d : random.Uniform(1, DistrictsPerWarehouse);
+  const double amount = random.Uniform(100, 500000) / 100.0;
+
+  const auto warehouse_key = Key::Warehouse(w);
+  auto warehouse           = tx.Read<Warehouse>(warehouse_key);
+  const auto district_key  = Key::District(w, d);
+  auto district            = tx.Read<District>(district_key);
+  if (!warehouse || !district) return true;
+  warehouse->ytd += amount;
+  tx.Write(warehouse_key, warehouse.value());
+  district->ytd += amount;
+  tx.Write(district_key, district.value());
+
+  const auto c = ChooseCustomer(tx, client, c_w, c_d);
+  if (!c) return true;  // aborted, or no customer has the name
+  const auto customer_key = Key::Customer(c_w, c_d, c.value());
+  auto customer           = tx.Read<Customer>(customer_key);
+  if (!customer) return true;
+  customer->balance -= amount;
+  customer->ytd_payment += amount;
+  customer->payment_cnt++;
+  if (std::strcmp(customer->credit, "BC") == 0) {
+    // The history of the payments of a bad credit (Clause 2.5.2.2).
+    const auto data = Key::Format("%u %u %u %u %u %.2f ", c.value(), c_d,
+                                  c_w, d, w, amount) +
+                      customer->data;
+    const size_t size = std::min(data.size(), sizeof(customer->data) - 1);
+    std::memcpy(customer->data, data.data(), size);
+    customer->data[size] = '\0';
+  }
+  tx.Write(customer_key, customer.value());
+
+  History history;
+  history.c_id   = c.value();
+  history.c_d_id = c_d;
+  history.c_w_id = c_w;
+  history.d_id   = d;
+  history.w_id   = w;
+  history.amount = amount;
+  history.date   = Now();
+  std::snprintf(history.data, sizeof(history.data), "%.10s    %.10s",
+                warehouse->name, district->name);
+  tx.Write(Key::History(c_w, c_d, c.value(), client.id + 1,
+                        client.history_sequence++),
+           history);
+  return true;
+}
+
+bool DoOrderStatus(LineairDB::Transaction& tx, Client& client) {
+  const uint32_t w = client.warehouse;
+  const uint32_t d = client.random.Uniform(1, DistrictsPerWarehouse);
+  const auto c     = ChooseCustomer(tx, client, w, d);
+  if (!c) return true;
+  const auto customer = tx.Read<Customer>(Key::Customer(w, d, c.value()));
+  if (!customer) return true;
+
+  // The latest order of the customer is the first one of the index.
+  std::optional<uint32_t> o;
+  tx.Scan<uint32_t>(Key::OrderByCustomer(w, d, c.value(), MaxOrderId),
+                    Key::OrderByCustomer(w, d, c.value(), 0), 1,
+                    [&](std::string_view, uint32_t order_id) {
+                      o = order_id;
+                      return true;
+                    });
+  if (!o) return true;
+  const auto order = tx.Read<Order>(Key::Order(w, d, o.value()));
+  if (!order) return true;
+  tx.Scan<OrderLine>(Key::OrderLine(w, d, o.value(), 0),
+                     Key::OrderLine(w, d, o.value(), MaxOrderLines),
+                     [&](std::string_view, OrderLine) { return false; });
+  return true;
+}
+
+bool DoDelivery(LineairDB::Transaction& tx, Client& client) {
+  const uint32_t w          = client.warehouse;
+  const uint32_t carrier_id = client.random.Uniform(1, 10);
+  const uint64_t now        = Now();
+  for (uint32_t d = 1; d <= DistrictsPerWarehouse; d++) {
+    // The oldest order which has not been delivered.
+    std::optional<uint32_t> o;
+    tx.Scan<uint32_t>(Key::NewOrder(w, d, 0), Key::NewOrder(w, d, MaxOrderId),
+                      1, [&](std::string_view, uint32_t order_id) {
+                        o = order_id;
+                        return true;
+                      });
+    if (tx.IsAborted()) return true;
+    if (!o) continue;  // skipped (Clause 2.7.4.2)
+    tx.Delete(Key::NewOrder(w, d, o.value()));
+
+    const auto order_key = Key::Order(w, d, o.value());
+    auto order           = tx.Read<Order>(order_key);
+    if (!order) return true;
+    order->carrier_id = carrier_id;
+    tx.Write(order_key, order.value());
+
+    std::vector<std::pair<std::string, OrderLine>> lines;
+    tx.Scan<OrderLine>(Key::OrderLine(w, d, o.value(), 0),
+                       Key::OrderLine(w, d, o.value(), MaxOrderLines),
+                       [&](std::string_view key, OrderLine line) {
+                         lines.emplace_back(std::string(key), line);
+                         return false;
+                       });
+    double amount = 0;
+    for (auto& [key, line] : lines) {
+      amount += line.amount;
+      line.delivery_d = now;
+      tx.Write(key, line);
+    }
+
+    const auto customer_key = Key::Customer(w, d, order->c_id);
+    auto customer           = tx.Read<Customer>(customer_key);
+    if (!customer) return true;
+    customer->balance += amount;
+    customer->delivery_cnt++;
+    tx.Write(customer_key, customer.value());
+  }
+  return true;
+}
+
+bool DoStockLevel(LineairDB::Transaction& tx, Client& client) {
+  const uint32_t w         = client.warehouse;
+  const uint32_t d         = client.random.Uniform(1, DistrictsPerWarehouse);
+  const uint32_t threshold = client.random.Uniform(10, 20);
+  const auto district      = tx.Read<District>(Key::District(w, d));
+  if (!district) return true;
+
+  // The items of the last 20 orders of the district.
+  const uint32_t next_o_id = district->next_o_id;
+  std::set<uint32_t> items;
+  tx.Scan<OrderLine>(Key::OrderLine(w, d, next_o_id - 20, 0),
+                     Key::OrderLine(w, d, next_o_id - 1, MaxOrderLines),
+                     [&](std::string_view, OrderLine line) {
+                       items.insert(line.i_id);
+                       return false;
+                     });
+  std::vector<std::string> keys;
+  for (const auto i : items) keys.emplace_back(Key::Stock(w, i));
+  const auto stocks = tx.MultiRead<Stock>(
+      std::vector<std::string_view>(keys.begin(), keys.end()));
+  [[maybe_unused]] size_t low_stock = 0;
+  for (const auto& stock : stocks) {
+    if (stock && stock->quantity < threshold) low_stock++;
+  }
+  return true;
+}
+
+}  // namespace TPCC
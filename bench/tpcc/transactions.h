@@ -0,0 +1,76 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_TPCC_TRANSACTIONS_H
+#define LINEAIRDB_TPCC_TRANSACTIONS_H
+
+#include <lineairdb/database.h>
+#include <lineairdb/transaction.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "random.hpp"
+
+namespace TPCC {
+
+enum TransactionType {
+  NewOrder,
+  Payment,
+  OrderStatus,
+  Delivery,
+  StockLevel,
+  TransactionTypes
+};
+constexpr const char* TransactionNames[TransactionTypes] = {
+    "NewOrder", "Payment", "OrderStatus", "Delivery", "StockLevel"};
+
+/**
+ * A terminal of TPC-C, which issues the transactions of its home warehouse.
+ */
+struct Client {
+  uint32_t id;
+  uint32_t warehouse;
+  uint32_t warehouses;  // the scale factor
+  uint64_t history_sequence;
+  Random random;
+
+  Client(uint32_t i, uint32_t w, uint32_t ws, uint64_t seed)
+      : id(i), warehouse(w), warehouses(ws), history_sequence(0),
+        random(seed) {}
+};
+
+/**
+ * Populates the `warehouses` warehouses and the items (Clause 4.3.3).
+ */
+void Populate(LineairDB::Database& db, uint32_t warehouses);
+
+/**
+ * The procedures of the transactions, which chooses their inputs by
+ * `client`. A procedure returns without completing its transaction when an
+ * operation of the transaction is aborted by the concurrency control.
+ * @return false if the transaction is rolled back by itself, i.e., a
+ * NewOrder of an unused item (Clause 2.4.1.4); the transaction is aborted.
+ */
+bool DoNewOrder(LineairDB::Transaction& tx, Client& client);
+bool DoPayment(LineairDB::Transaction& tx, Client& client);
+bool DoOrderStatus(LineairDB::Transaction& tx, Client& client);
+bool DoDelivery(LineairDB::Transaction& tx, Client& client);
+bool DoStockLevel(LineairDB::Transaction& tx, Client& client);
+
+}  // namespace TPCC
+
+#endif /* LINEAIRDB_TPCC_TRANSACTIONS_H */
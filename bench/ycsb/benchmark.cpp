@@ -42,8 +42,11 @@
 #include <lineairdb/tx_status.h>
 #include <rapidjson/document.h>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstdint>
 #include <random>
 #include <string>
 #include <string_view>
@@ -54,57 +57,101 @@
 #include "interface.h"
 #include "random_generator.hpp"
 #include "spdlog/spdlog.h"
+#include "util/instrumentation.hpp"
 #include "util/thread_key_storage.h"
 #include "workload.h"
 
 namespace YCSB {
 
-void PopulateDatabase(LineairDB::Database& db, Workload& workload,
-                      size_t worker_threads) {
-  std::vector<int> failed;
-  std::vector<std::thread> workers;
-
-  worker_threads = std::min(workload.recordcount, worker_threads);
-  workers.reserve(worker_threads);
-  for (size_t i = 0; i < worker_threads; ++i) {
-    size_t from = workload.recordcount * i / worker_threads;
-    size_t to   = workload.recordcount * (i + 1) / worker_threads;
-    failed.emplace_back(0);
-    workers.emplace_back([&, from, to]() {
-      db.ExecuteTransaction(
-          [&, from, to](LineairDB::Transaction& tx) {
-            std::byte ptr[workload.payload_size];
-            for (size_t idx = from; idx < to; idx++) {
-              tx.Write(std::to_string(idx), ptr, workload.payload_size);
-            }
-          },
-          [](LineairDB::TxStatus status) {
-            if (status != LineairDB::TxStatus::Committed) {
-              SPDLOG_ERROR("YCSB: a database population query is aborted");
-              exit(1);
-            }
-          });
-    });
-  }
-  SPDLOG_INFO("YCSB: Database population queries are enqueued");
-  for (auto& w : workers) { w.join(); }
-  db.Fence();
+void PopulateDatabase(LineairDB::Database& db, Workload& workload) {
+  std::vector<std::byte> payload(workload.payload_size);
+  db.BulkLoad([&](const LineairDB::Database::BulkLoadWriter& write) {
+    for (size_t idx = 0; idx < workload.recordcount; idx++) {
+      write(std::to_string(idx), payload.data(), workload.payload_size);
+    }
+  });
   SPDLOG_INFO("YCSB: Database population is completed");
 }
 
+// The operation of a transaction; all the operations of a transaction are
+// of the same type.
+enum Operation { Read, Update, Insert, Scan, ReadModifyWrite, Operations };
+constexpr const char* OperationNames[Operations] = {"read", "update",
+                                                    "insert", "scan", "rmw"};
+
+using Histogram = LineairDB::Instrumentation::Histogram;
+using Clock     = std::chrono::steady_clock;
+
+/**
+ * The results of the transactions finished on a thread. The latencies are
+ * recorded by the thread that finishes each transaction, which may be one of
+ * LineairDB's threads, and are read by the sampler during the measurement.
+ */
 struct ThreadLocalResult {
-  size_t commits = 0;
-  size_t aborts  = 0;
+  std::atomic<uint64_t> commits{0};
+  std::atomic<uint64_t> aborts{0};
+  // from the arrival of a transaction to its precommit, and to its commit.
+  std::array<Histogram, Operations> precommit_latencies;
+  std::array<Histogram, Operations> commit_latencies;
 };
 ThreadKeyStorage<ThreadLocalResult> thread_local_result;
-std::atomic<bool> finish_flag{false};
 
+enum class Phase { Warmup, Measurement, Finished };
+std::atomic<Phase> benchmark_phase{Phase::Warmup};
+Clock::time_point measurement_begin;  // set before the Measurement phase
+
+bool IsMeasuring() {
+  return benchmark_phase.load(std::memory_order_acquire) == Phase::Measurement;
+}
+
+void Increment(std::atomic<uint64_t>& counter) {
+  counter.store(counter.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+}
+
+uint64_t NanosecondsSince(const Clock::time_point arrival) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                              arrival)
+      .count();
+}
+
+/**
+ * Counts a transaction precommitted or aborted in the measurement phase, with
+ * the latency from its arrival.
+ */
+void CountPrecommit(const Operation operation, const Clock::time_point arrival,
+                    const bool precommitted) {
+  if (!IsMeasuring()) return;
+  auto* result = thread_local_result.Get();
+  if (precommitted) {
+    Increment(result->commits);
+    result->precommit_latencies[operation].Record(NanosecondsSince(arrival));
+  } else {
+    Increment(result->aborts);
+  }
+}
+
+void CountCommit(const Operation operation, const Clock::time_point arrival,
+                 const LineairDB::TxStatus status) {
+  // NOTE: the transactions issued in the warmup are not measured.
+  if (!IsMeasuring() || arrival < measurement_begin) return;
+  if (status != LineairDB::TxStatus::Committed) return;
+  thread_local_result.Get()->commit_latencies[operation].Record(
+      NanosecondsSince(arrival));
+}
+
+/**
+ * Executes a transaction which has arrived at `arrival`; with the closed-loop
+ * load, it arrives when the previous one of the client is issued.
+ */
 void ExecuteWorkload(LineairDB::Database& db, Workload& workload,
                      RandomGenerator* rand, void* payload,
+                     const Clock::time_point arrival,
                      bool use_handler = true) {
   std::function<void(LineairDB::Transaction&, std::string_view,
                      std::string_view, void*, size_t)>
       operation;
+  Operation type;
 
   bool is_scan = false;
   bool is_insert = false;
@@ -114,16 +161,21 @@ void ExecuteWorkload(LineairDB::Database& db, Workload& workload,
 
     if (what_i_do < (proportion += workload.read_proportion)) {
       operation = YCSB::Interface::Read;
+      type      = Operation::Read;
     } else if (what_i_do < (proportion += workload.update_proportion)) {
       operation = YCSB::Interface::Update;
+      type      = Operation::Update;
     } else if (what_i_do < (proportion += workload.insert_proportion)) {
       operation = YCSB::Interface::Insert;
+      type      = Operation::Insert;
       is_insert = true;
     } else if (what_i_do < (proportion += workload.scan_proportion)) {
       operation = YCSB::Interface::Scan;
+      type      = Operation::Scan;
       is_scan   = true;
     } else if (what_i_do < (proportion += workload.rmw_proportion)) {
       operation = YCSB::Interface::ReadModifyWrite;
+      type      = Operation::ReadModifyWrite;
     } else {
       SPDLOG_ERROR("No operation has found");
       exit(1);
@@ -166,15 +218,11 @@ void ExecuteWorkload(LineairDB::Database& db, Workload& workload,
         operation(tx, key, "", payload, workload.payload_size);
       }
     }
-    bool precommitted = db.EndTransaction(tx, [&](LineairDB::TxStatus) {});
-    auto* result      = thread_local_result.Get();
-    if (!finish_flag.load(std::memory_order_relaxed)) {
-      if (precommitted) {
-        result->commits++;
-      } else {
-        result->aborts++;
-      }
-    }
+    bool precommitted =
+        db.EndTransaction(tx, [type, arrival](LineairDB::TxStatus status) {
+          CountCommit(type, arrival, status);
+        });
+    CountPrecommit(type, arrival, precommitted);
   } else {
     db.ExecuteTransaction(
         [is_scan, operation, keys, payload,
@@ -188,21 +236,146 @@ void ExecuteWorkload(LineairDB::Database& db, Workload& workload,
             }
           }
         },
-        [](LineairDB::TxStatus) {},
-        [&](LineairDB::TxStatus status) {
-          if (!finish_flag.load(std::memory_order_relaxed)) {
-            auto* result = thread_local_result.Get();
-
-            if (status == LineairDB::TxStatus::Committed) {
-              result->commits++;
-            } else {
-              result->aborts++;
-            }
-          }
+        [type, arrival](LineairDB::TxStatus status) {
+          CountCommit(type, arrival, status);
+        },
+        [type, arrival](LineairDB::TxStatus status) {
+          CountPrecommit(type, arrival,
+                         status != LineairDB::TxStatus::Aborted);
         });
   }
 }
 
+rapidjson::Value LatencyToJson(const LineairDB::Statistics::Latency& latency,
+                               rapidjson::Document::AllocatorType& allocator) {
+  rapidjson::Value summary(rapidjson::kObjectType);
+  summary.AddMember("count", latency.count, allocator);
+  summary.AddMember("mean_ns", latency.mean_ns, allocator);
+  summary.AddMember("p50_ns", latency.p50_ns, allocator);
+  summary.AddMember("p90_ns", latency.p90_ns, allocator);
+  summary.AddMember("p99_ns", latency.p99_ns, allocator);
+  summary.AddMember("p999_ns", latency.p999_ns, allocator);
+  summary.AddMember("max_ns", latency.max_ns, allocator);
+  return summary;
+}
+
+/**
+ * Adds the latencies and the abort reasons of LineairDB to the result, if it
+ * is built with ENABLE_INSTRUMENTATION. NOTE: they include the population.
+ */
+void AddInstrumentation(const LineairDB::Database& db,
+                        rapidjson::Document& result_json) {
+  using LineairDB::Statistics;
+  const auto statistics = db.GetStatistics();
+  if (!statistics.instrumented) return;
+  auto& allocator = result_json.GetAllocator();
+
+  rapidjson::Value latencies(rapidjson::kObjectType);
+  for (size_t i = 0; i < Statistics::NumberOfPhases; i++) {
+    const auto phase    = static_cast<Statistics::Phase>(i);
+    const auto& latency = statistics.latencies[i];
+    if (latency.count == 0) continue;
+    SPDLOG_INFO(
+        "YCSB: {0}: count {1}, mean {2:.0f}ns, p50 {3}ns, p90 {4}ns, "
+        "p99 {5}ns, p99.9 {6}ns, max {7}ns",
+        Statistics::PhaseName(phase), latency.count, latency.mean_ns,
+        latency.p50_ns, latency.p90_ns, latency.p99_ns, latency.p999_ns,
+        latency.max_ns);
+    latencies.AddMember(rapidjson::StringRef(Statistics::PhaseName(phase)),
+                        LatencyToJson(latency, allocator), allocator);
+  }
+  result_json.AddMember("latencies", latencies, allocator);
+
+  rapidjson::Value aborts(rapidjson::kObjectType);
+  for (size_t i = 0; i < Statistics::NumberOfAbortReasons; i++) {
+    const auto reason = static_cast<Statistics::AbortReason>(i);
+    SPDLOG_INFO("YCSB: aborts by {0}: {1}",
+                Statistics::AbortReasonName(reason), statistics.aborts[i]);
+    aborts.AddMember(rapidjson::StringRef(Statistics::AbortReasonName(reason)),
+                     statistics.aborts[i], allocator);
+  }
+  result_json.AddMember("abort_reasons", aborts, allocator);
+
+  SPDLOG_INFO("YCSB: NWR omitted {0} of {1} write transactions",
+              statistics.nwr_omitted, statistics.nwr_omittable_checks);
+  result_json.AddMember("nwr_omittable_checks",
+                        statistics.nwr_omittable_checks, allocator);
+  result_json.AddMember("nwr_omitted", statistics.nwr_omitted, allocator);
+}
+
+/**
+ * The sum of the results of all the threads at a time.
+ */
+struct Sample {
+  uint64_t commits = 0;
+  uint64_t aborts  = 0;
+  std::array<Histogram::Merged, Operations> precommit_latencies;
+  std::array<Histogram::Merged, Operations> commit_latencies;
+
+  static Sample Take() {
+    Sample sample;
+    thread_local_result.ForEach([&](const ThreadLocalResult* result) {
+      sample.commits += result->commits.load(std::memory_order_relaxed);
+      sample.aborts += result->aborts.load(std::memory_order_relaxed);
+      for (size_t i = 0; i < Operations; i++) {
+        sample.precommit_latencies[i].Add(result->precommit_latencies[i]);
+        sample.commit_latencies[i].Add(result->commit_latencies[i]);
+      }
+    });
+    return sample;
+  }
+
+  // the histogram of all the operations.
+  static Histogram::Merged Total(
+      const std::array<Histogram::Merged, Operations>& histograms) {
+    Histogram::Merged total;
+    for (const auto& histogram : histograms) {
+      for (size_t i = 0; i < Histogram::Buckets; i++) {
+        total.buckets[i] += histogram.buckets[i];
+      }
+      total.count += histogram.count;
+      total.sum += histogram.sum;
+      total.max = std::max(total.max, histogram.max);
+    }
+    return total;
+  }
+
+  // the values recorded after `former`; the maximum is not subtracted.
+  static Histogram::Merged Since(const Histogram::Merged& current,
+                                 const Histogram::Merged& former) {
+    Histogram::Merged since = current;
+    for (size_t i = 0; i < Histogram::Buckets; i++) {
+      since.buckets[i] -= former.buckets[i];
+    }
+    since.count -= former.count;
+    since.sum -= former.sum;
+    return since;
+  }
+};
+
+/**
+ * Adds a sample of the results since `former` to `samples`.
+ */
+void AddSample(const Sample& current, const Sample& former,
+               const uint64_t time_ms, const uint64_t interval_us,
+               rapidjson::Value& samples,
+               rapidjson::Document::AllocatorType& allocator) {
+  const auto latency =
+      Sample::Since(Sample::Total(current.precommit_latencies),
+                    Sample::Total(former.precommit_latencies));
+  const uint64_t commits = current.commits - former.commits;
+  rapidjson::Value sample(rapidjson::kObjectType);
+  sample.AddMember("time_ms", time_ms, allocator);
+  sample.AddMember("commits", commits, allocator);
+  sample.AddMember("aborts", current.aborts - former.aborts, allocator);
+  const uint64_t tps = commits * 1000000 / std::max<uint64_t>(1, interval_us);
+  sample.AddMember("tps", tps, allocator);
+  sample.AddMember("p50_ns", latency.Percentile(50), allocator);
+  sample.AddMember("p99_ns", latency.Percentile(99), allocator);
+  sample.AddMember("p999_ns", latency.Percentile(99.9), allocator);
+  samples.PushBack(sample, allocator);
+}
+
 rapidjson::Document RunBenchmark(LineairDB::Database& db, Workload& workload,
                                  bool use_handler = true) {
   std::vector<std::thread> clients;
@@ -216,10 +389,28 @@ rapidjson::Document RunBenchmark(LineairDB::Database& db, Workload& workload,
       RandomGenerator* rand = thread_local_random.Get();
       rand->Init(workload.recordcount, workload.zipfian_theta);
 
+      // With the open-loop load, the transactions of a client arrive by a
+      // Poisson process, regardless of the ones still running; the latency
+      // of a transaction includes the time it waits to be issued.
+      const bool open_loop = 0 < workload.target_rate;
+      std::mt19937_64 engine(std::random_device{}());
+      std::exponential_distribution<double> interarrival_seconds(
+          open_loop ? workload.target_rate / workload.client_thread_size : 1);
+
       waits_count.fetch_add(1);
+      while (!start_flag.load()) { std::this_thread::yield(); }
 
-      while (finish_flag.load() == false) {
-        ExecuteWorkload(db, workload, rand, &buffers[i][0], use_handler);
+      auto arrival = Clock::now();
+      while (benchmark_phase.load() != Phase::Finished) {
+        if (open_loop) {
+          arrival += std::chrono::duration_cast<Clock::duration>(
+              std::chrono::duration<double>(interarrival_seconds(engine)));
+          std::this_thread::sleep_until(arrival);
+        } else {
+          arrival = Clock::now();
+        }
+        ExecuteWorkload(db, workload, rand, &buffers[i][0], arrival,
+                        use_handler);
       }
     }));
   }
@@ -228,40 +419,102 @@ rapidjson::Document RunBenchmark(LineairDB::Database& db, Workload& workload,
   while (waits_count.load() != clients.size()) { std::this_thread::yield(); }
 
   SPDLOG_INFO("YCSB: Benchmark start.");
-  auto begin = std::chrono::high_resolution_clock::now();
   start_flag.store(true);
-  std::this_thread::sleep_for(
-      std::chrono::milliseconds(workload.measurement_duration));
-  finish_flag.store(true);
+  if (0 < workload.warmup_duration) {
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(workload.warmup_duration));
+    SPDLOG_INFO("YCSB: Warmup end.");
+  }
+  auto begin        = Clock::now();
+  measurement_begin = begin;
+  benchmark_phase.store(Phase::Measurement, std::memory_order_release);
+
+  // The results are sampled every sampling_interval, as a time series.
+  rapidjson::Document result_json(rapidjson::kObjectType);
+  auto& allocator = result_json.GetAllocator();
+  rapidjson::Value samples(rapidjson::kArrayType);
+  {
+    using std::chrono::duration_cast;
+    const auto end_of_measurement =
+        begin + std::chrono::milliseconds(workload.measurement_duration);
+    const auto interval = std::chrono::milliseconds(
+        std::max<size_t>(1, workload.sampling_interval));
+    Sample former;
+    auto former_time = begin;
+    while (Clock::now() < end_of_measurement) {
+      std::this_thread::sleep_until(
+          std::min(former_time + interval, end_of_measurement));
+      const auto now     = Clock::now();
+      const auto current = Sample::Take();
+      AddSample(
+          current, former,
+          duration_cast<std::chrono::milliseconds>(now - begin).count(),
+          duration_cast<std::chrono::microseconds>(now - former_time).count(),
+          samples, allocator);
+      former      = current;
+      former_time = now;
+    }
+  }
+  benchmark_phase.store(Phase::Finished);
+  auto end = Clock::now();
   for (auto& worker : clients) { worker.join(); }
-  auto end = std::chrono::high_resolution_clock::now();
   SPDLOG_INFO("YCSB: Benchmark end.");
   db.Fence();
   SPDLOG_INFO("YCSB: DB Fenced.");
 
-  uint64_t total_commits = 0;
-  uint64_t total_aborts  = 0;
-  thread_local_result.ForEach([&](const ThreadLocalResult* res) {
-    total_commits += res->commits;
-    total_aborts += res->aborts;
-  });
+  // NOTE: the commits after the measurement are not in the latencies.
+  const auto result      = Sample::Take();
+  uint64_t total_commits = result.commits;
+  uint64_t total_aborts  = result.aborts;
 
   auto elapsed = end - begin;
   uint64_t milliseconds =
       std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
-  uint64_t tps = total_commits * 1000 / milliseconds;
+  uint64_t tps = total_commits * 1000 / std::max<uint64_t>(1, milliseconds);
 
   SPDLOG_INFO(
       "YCSB: Benchmark completed. elapsed time: {3}ms, commits: {0}, aborts: "
       "{1}, tps: {2}",
       total_commits, total_aborts, tps, milliseconds);
 
-  rapidjson::Document result_json(rapidjson::kObjectType);
-  auto& allocator = result_json.GetAllocator();
   result_json.AddMember("etime", milliseconds, allocator);
   result_json.AddMember("commits", total_commits, allocator);
   result_json.AddMember("aborts", total_aborts, allocator);
   result_json.AddMember("tps", tps, allocator);
+  result_json.AddMember("warmup",
+                        static_cast<uint64_t>(workload.warmup_duration),
+                        allocator);
+  result_json.AddMember("target_rate", workload.target_rate, allocator);
+
+  // the latencies of all the transactions, and then of each operation.
+  auto add_latency = [&](const char* kind, const char* name,
+                         const Histogram::Merged& histogram,
+                         rapidjson::Value& latencies) {
+    const auto latency = histogram.Summarize();
+    if (latency.count == 0) return;
+    SPDLOG_INFO(
+        "YCSB: {0} latency of {1}: count {2}, mean {3:.0f}ns, p50 {4}ns, "
+        "p99 {5}ns, p99.9 {6}ns",
+        kind, name, latency.count, latency.mean_ns, latency.p50_ns,
+        latency.p99_ns, latency.p999_ns);
+    latencies.AddMember(rapidjson::StringRef(name),
+                        LatencyToJson(latency, allocator), allocator);
+  };
+  rapidjson::Value precommit(rapidjson::kObjectType);
+  rapidjson::Value commit(rapidjson::kObjectType);
+  add_latency("precommit", "all", Sample::Total(result.precommit_latencies),
+              precommit);
+  add_latency("commit", "all", Sample::Total(result.commit_latencies), commit);
+  for (size_t i = 0; i < Operations; i++) {
+    add_latency("precommit", OperationNames[i], result.precommit_latencies[i],
+                precommit);
+    add_latency("commit", OperationNames[i], result.commit_latencies[i],
+                commit);
+  }
+  result_json.AddMember("precommit_latencies", precommit, allocator);
+  result_json.AddMember("commit_latencies", commit, allocator);
+  result_json.AddMember("samples", samples, allocator);
+  AddInstrumentation(db, result_json);
 
   return result_json;
 }
@@ -34,7 +34,7 @@
 
 namespace YCSB {
 
-void PopulateDatabase(LineairDB::Database&, YCSB::Workload&, size_t);
+void PopulateDatabase(LineairDB::Database&, YCSB::Workload&);
 rapidjson::Document RunBenchmark(LineairDB::Database&, YCSB::Workload&, bool);
 
 }  // namespace YCSB
@@ -43,6 +43,10 @@ const std::map<std::string, LineairDB::Config::ConcurrencyControl> Protocols = {
     {"Silo", LineairDB::Config::ConcurrencyControl::Silo},
     {"SiloNWR", LineairDB::Config::ConcurrencyControl::SiloNWR},
     {"2PL", LineairDB::Config::ConcurrencyControl::TwoPhaseLocking},
+    {"2PLWaitDie",
+     LineairDB::Config::ConcurrencyControl::TwoPhaseLockingWaitDie},
+    {"2PLWoundWait",
+     LineairDB::Config::ConcurrencyControl::TwoPhaseLockingWoundWait},
 };
 
 int main(int argc, char** argv) {
@@ -79,11 +83,23 @@ int main(int argc, char** argv) {
       ("q,clients", "The number of threads queueing the jobs into LineairDB",
        cxxopts::value<size_t>()->default_value("1"))  //
       // std::to_string(std::thread::hardware_concurrency())))  //
+      ("k,hot_keys",
+       "Conflicts after which a record is locked at the first read (0: off)",
+       cxxopts::value<size_t>()->default_value("0"))  //
       ("H,handler",
        "Use handler interface: queueing threads also execute transactions",
        cxxopts::value<bool>()->default_value("false"))  //
       ("d,duration", "Measurement duration of this benchmark (milliseconds)",
        cxxopts::value<size_t>()->default_value("2000"))  //
+      ("W,warmup", "Warmup duration before the measurement (milliseconds)",
+       cxxopts::value<size_t>()->default_value("0"))  //
+      ("T,rate",
+       "Target throughput (transactions per second) of the open-loop load by "
+       "a Poisson process (0: closed-loop)",
+       cxxopts::value<double>()->default_value("0"))  //
+      ("I,sampling_interval",
+       "Interval of the time series of the results (milliseconds)",
+       cxxopts::value<size_t>()->default_value("1000"))  //
       ("o,output", "Output JSON filename",
        cxxopts::value<std::string>()->default_value("ycsb_result.json"))  //
       ;
@@ -106,6 +122,8 @@ int main(int argc, char** argv) {
   config.epoch_duration_ms            = result["epoch"].as<size_t>();
   config.checkpoint_period            = result["checkpoint_interval"].as<size_t>();
   config.rehash_threshold             = result["rehash_threshold"].as<double>();
+  config.expected_record_count        = result["records"].as<size_t>();
+  config.hot_key_threshold            = result["hot_keys"].as<size_t>();
   LineairDB::Database db(config);
 
   const auto use_handler = result["handler"].as<bool>();
@@ -121,9 +139,12 @@ int main(int argc, char** argv) {
   workload.payload_size         = result["payload"].as<size_t>();
   workload.client_thread_size   = result["clients"].as<size_t>();
   workload.measurement_duration = result["duration"].as<size_t>();
+  workload.warmup_duration      = result["warmup"].as<size_t>();
+  workload.target_rate          = result["rate"].as<double>();
+  workload.sampling_interval    = result["sampling_interval"].as<size_t>();
 
   /** Populate the table **/
-  YCSB::PopulateDatabase(db, workload, std::thread::hardware_concurrency());
+  YCSB::PopulateDatabase(db, workload);
 
   /** Run the benchmark **/
   auto result_json = YCSB::RunBenchmark(db, workload, use_handler);
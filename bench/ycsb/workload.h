@@ -41,7 +41,12 @@ struct Workload {
   size_t reps_per_txn;
   size_t payload_size;
   size_t client_thread_size;
-  size_t measurement_duration;
+  size_t measurement_duration;  // milliseconds
+  size_t warmup_duration;       // milliseconds, not measured
+  size_t sampling_interval;     // milliseconds
+  // transactions per second issued by all the clients by a Poisson process;
+  // if 0, each client issues the next one when the previous one is issued.
+  double target_rate;
 
 
   Workload(size_t r, size_t u, size_t i, size_t s, size_t m, Distribution d)
@@ -50,7 +55,10 @@ struct Workload {
         insert_proportion(i),
         scan_proportion(s),
         rmw_proportion(m),
-        distribution(d) {
+        distribution(d),
+        warmup_duration(0),
+        sampling_interval(1000),
+        target_rate(0) {
     assert((r + u + i + s + m) == 100);
     has_insert = 0 < insert_proportion;
   }
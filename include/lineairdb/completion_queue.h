@@ -0,0 +1,83 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_COMPLETION_QUEUE_H
+#define LINEAIRDB_COMPLETION_QUEUE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "tx_status.h"
+
+namespace LineairDB {
+
+class Database;
+
+/**
+ * @brief
+ * Collects the results of the transactions executed by
+ * Database::ExecuteTransaction with a CompletionQueue, in place of callback
+ * functions: LineairDB pushes the tag of a transaction and its result into
+ * the queue, and the threads of the user harvest them in batches by #Poll or
+ * #Wait. No user code runs on LineairDB's threads after the transaction
+ * procedure. On Linux, #GetEventFd returns an eventfd, which is readable
+ * while there may be completions to harvest; it can be registered to an
+ * epoll loop.
+ * Thread-safe.
+ */
+class CompletionQueue {
+ public:
+  struct Completion {
+    uint64_t tag;
+    TxStatus status;
+  };
+
+  CompletionQueue();
+  ~CompletionQueue();
+  CompletionQueue(const CompletionQueue&) = delete;
+  CompletionQueue& operator=(const CompletionQueue&) = delete;
+
+  /**
+   * @brief Moves at most `max` completions into `out`, without blocking.
+   * @return the number of the completions moved.
+   */
+  size_t Poll(Completion* out, size_t max);
+
+  /**
+   * @brief Same as #Poll, but waits for a completion for up to `timeout`.
+   */
+  size_t Wait(Completion* out, size_t max, std::chrono::microseconds timeout);
+
+  /**
+   * @return the file descriptor of the eventfd, or -1 on the platforms
+   * that do not have eventfd. Reading it is not needed; #Poll and #Wait
+   * reset it.
+   */
+  int GetEventFd() const;
+
+ private:
+  friend class Database;
+  void Push(uint64_t tag, TxStatus status);
+
+  class Impl;
+  std::unique_ptr<Impl> pimpl_;
+};
+
+}  // namespace LineairDB
+
+#endif /* LINEAIRDB_COMPLETION_QUEUE_H */
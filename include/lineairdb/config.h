@@ -36,6 +36,29 @@ struct Config {
    * std::thread::hardware_concurrency().
    */
   size_t max_thread = std::thread::hardware_concurrency();
+  /**
+   * @brief
+   * If true, the threads of the thread pool are placed NUMA node by node,
+   * allocate their memory on their own nodes, and process the transactions
+   * enqueued by the threads on the same node, stealing ones of the other
+   * nodes only when the node has none. See also
+   * Database::ExecuteTransaction with a partition key, which routes a
+   * transaction to the node that owns the key.
+   *
+   * Default: false.
+   */
+  bool enable_numa_aware_thread_pool = false;
+  /**
+   * @brief
+   * The duration (microseconds) for which an idle thread of the thread pool
+   * keeps looking for transactions before it sleeps. A sleeping thread is
+   * woken up when a transaction is enqueued into it; a longer duration saves
+   * the wakeup latency of bursty workloads, at the cost of burning the CPU
+   * while LineairDB is idle.
+   *
+   * Default: 100us.
+   */
+  size_t thread_pool_spin_duration_us = 100;
   /**
    * @brief
    * The size of epoch duration (milliseconds). See [Tu13, Chandramouli18] to
@@ -52,34 +75,223 @@ struct Config {
    */
   size_t epoch_duration_ms = 40;
 
-  enum ConcurrencyControl { Silo, SiloNWR, TwoPhaseLocking };
+  /**
+   * @brief
+   * If true, LineairDB adapts the epoch duration to the workload, starting
+   * from epoch_duration_ms. It lengthens the epochs while it increases the
+   * commit rate, i.e., while the per-epoch work of flushing logs and
+   * executing callbacks limits the throughput, and shortens them otherwise.
+   * The duration is bounded by min_epoch_duration_ms, max_epoch_duration_ms
+   * and target_commit_latency_ms, and an epoch is shortened whenever it holds
+   * more logs than max_log_bytes_per_epoch.
+   *
+   * Default: false
+   */
+  bool enable_adaptive_epoch = false;
+
+  /**
+   * @brief
+   * The bounds of the epoch duration (milliseconds) that
+   * enable_adaptive_epoch chooses.
+   *
+   * Default: 1ms and 100ms.
+   */
+  size_t min_epoch_duration_ms = 1;
+  size_t max_epoch_duration_ms = 100;
+
+  /**
+   * @brief
+   * The commit latency (milliseconds) that enable_adaptive_epoch keeps the
+   * epochs within. A commit waits for up to one epoch, or for up to two
+   * epochs when the callbacks wait for the durable epoch without
+   * enable_eager_durability_notification.
+   *
+   * Default: 100ms.
+   */
+  size_t target_commit_latency_ms = 100;
+
+  /**
+   * @brief
+   * The bytes of the write sets that enable_adaptive_epoch lets an epoch
+   * hold.
+   *
+   * Default: 64MiB.
+   */
+  size_t max_log_bytes_per_epoch = 64 << 20;
+
+  enum ConcurrencyControl {
+    Silo,
+    SiloNWR,
+    TwoPhaseLocking,
+    TwoPhaseLockingWaitDie,
+    TwoPhaseLockingWoundWait
+  };
   /**
    * @brief
    * Set a concurrency control algorithm.
    * See LineairDB::Config::ConcurrencyControl for the enum options of this
    * configuration.
+   * TwoPhaseLocking aborts a transaction as soon as it conflicts on a lock
+   * (NoWait). TwoPhaseLockingWaitDie and TwoPhaseLockingWoundWait instead let
+   * a transaction wait for the lock, and avoid deadlocks by the start order
+   * of transactions: with WaitDie, a younger transaction aborts instead of
+   * waiting for an older one; with WoundWait, an older transaction makes the
+   * younger owners abort. A transaction aborted by a conflict keeps its start
+   * order for the next transaction of the same thread; retry it on the thread,
+   * e.g., by the handler interface, so that it is not starved.
    *
    * Default: SiloNWR
    */
   ConcurrencyControl concurrency_control_protocol = SiloNWR;
 
-  enum Logger { ThreadLocalLogger };
+  enum LockWaitPolicy { Yield, SpinThenBackoff, SpinThenPark };
+  /**
+   * @brief
+   * Set how a transaction waits for a data item locked by another one.
+   * Yield yields the processor until the lock is released.
+   * SpinThenBackoff spins for a while and then sleeps with bounded
+   * exponential backoff; SpinThenPark spins for a while and then sleeps until
+   * the lock holder wakes it up. The latter two reduce the CPU time wasted
+   * on contended data items, in particular when there are more threads than
+   * processors.
+   * Effective with Silo and SiloNWR.
+   *
+   * Default: Yield
+   */
+  LockWaitPolicy lock_wait_policy = Yield;
+
+  /**
+   * @brief
+   * The number of read-modify-write conflicts after which a data item is
+   * regarded as hot. A transaction of TxType::ReadWrite locks a hot item
+   * exclusively when it first reads it and releases it at the commit or the
+   * abort, so that the transactions updating the item are serialized instead
+   * of aborting each other in the validation; the other items are processed
+   * optimistically. The conflicts are counted when a transaction with writes
+   * fails the validation of its reads, and they decay as the transactions
+   * holding the lock commit.
+   * Declare read-only transactions as TxType::ReadOnly, so that they do not
+   * wait for the lock of a hot item. Zero disables the detection.
+   * Effective with Silo and SiloNWR.
+   *
+   * Default: 0
+   */
+  size_t hot_key_threshold = 0;
+
+  enum Logger {
+    ThreadLocalLogger,
+    GroupCommitLogger,
+    BinaryLogger,
+    PersistentMemoryLogger
+  };
   /**
    * @brief
    * Set a logging algorithm.
    * See LineairDB::Config::Logger for the enum options of this
    * configuration.
+   * ThreadLocalLogger writes the logs of each thread into the page cache and
+   * does not wait for the storage device.
+   * GroupCommitLogger submits the logs of all threads as asynchronous writes
+   * through io_uring, and persists them with one fdatasync per log file in
+   * each epoch; the durable epoch advances only when the storage device has
+   * completed them. It falls back to the blocking system calls if io_uring
+   * is not available.
+   * BinaryLogger writes as ThreadLocalLogger does, but in a checksummed
+   * binary format instead of msgpack; a commit serializes the write set
+   * directly into a reusable buffer of the thread without copying the keys
+   * and values into intermediate objects.
+   * PersistentMemoryLogger is for a working directory on persistent memory
+   * (a file system mounted with DAX): each thread maps its log file, and a
+   * commit writes its record in the format of BinaryLogger into the mapping
+   * and flushes the cache lines, without a system call. The durable epoch
+   * advances on every epoch; use it with
+   * enable_eager_durability_notification to notify the commits without
+   * waiting for another epoch. On the other file systems, each record is
+   * persisted with msync.
    *
    * Default: ThreadLocalLogger
    */
   Logger logger = ThreadLocalLogger;
 
-  enum IndexStructure { HashTableWithPrecisionLockingIndex };
+  /**
+   * @brief
+   * If true, GroupCommitLogger opens the log files with O_DIRECT, and writes
+   * the logs in blocks of 4KiB into preallocated segments of the files, so
+   * that the logs bypass the page cache. It is ignored if the file system
+   * does not support O_DIRECT, and with the other loggers.
+   *
+   * Default: false
+   */
+  bool enable_direct_log_io = false;
+
+  /**
+   * @brief
+   * If true, ThreadLocalLogger keeps only the latest version of each key
+   * that a thread has written in an epoch, until the thread flushes its
+   * logs. Recovery replays only the latest version of each key anyway, and
+   * the durable epoch never covers a part of an epoch; thus a hot key
+   * updated many times in an epoch costs a single log entry per thread.
+   * The versions of different epochs are kept apart, so that the records
+   * after the durable epoch are still discarded by recovery.
+   * It is ignored by the other loggers.
+   *
+   * Default: false
+   */
+  bool enable_log_coalescing = false;
+
+  enum LogCompression { NoCompression, LZ4, Zstd, Zlib };
+  /**
+   * @brief
+   * Set a codec to compress the logs and the delta files of incremental
+   * checkpoints. Each batch of log records is compressed by the thread that
+   * flushes it, and thus the commit path is not affected.
+   * See LineairDB::Config::LogCompression for the enum options of this
+   * configuration.
+   * A codec that LineairDB is not built with falls back to NoCompression.
+   * BinaryLogger and the full checkpoints, which are mapped into memory at
+   * recovery, are not compressed.
+   *
+   * Default: NoCompression
+   */
+  LogCompression log_compression = NoCompression;
+
+  /**
+   * @brief
+   * The level (the acceleration factor for LZ4) given to the codec of
+   * log_compression. If 0, the default one of the codec is used.
+   *
+   * Default: 0
+   */
+  int log_compression_level = 0;
+
+  /**
+   * @brief
+   * If true, the commit callbacks of an epoch are executed as soon as the
+   * logs of the epoch have been flushed and have reached the storage device,
+   * instead of on the next epoch update. The last worker that flushes its
+   * logs of the epoch waits for the device (only GroupCommitLogger does),
+   * persists the durable epoch and then has the workers execute the
+   * callbacks; thus the commit latency is up to one epoch plus the latency
+   * of the device. In this mode, no callback of a committed transaction is
+   * executed before the durable epoch covers it.
+   * It is ignored if enable_logging is false.
+   *
+   * Default: false
+   */
+  bool enable_eager_durability_notification = false;
+
+  enum IndexStructure {
+    HashTableWithPrecisionLockingIndex,
+    HashTableWithOLCTreeIndex
+  };
   /**
    * @brief
    * Set the type of index.
    * See LineairDB::Config::IndexStructure for the enum options of this
    * configuration.
+   * HashTableWithOLCTreeIndex replaces the std::map of the range index with a
+   * B+-tree synchronized by optimistic lock coupling, so that concurrent
+   * scans and inserts on disjoint key ranges do not contend.
    *
    * Default: Hash table with precision locking index
    */
@@ -140,6 +352,43 @@ struct Config {
    */
   size_t checkpoint_period = 30;
 
+  /**
+   * @brief
+   * The number of incremental checkpoints between two full checkpoints.
+   * An incremental checkpoint saves only the data items written since the
+   * previous checkpoint into a delta file; a full checkpoint saves all the
+   * data items and removes the delta files.
+   * The first checkpoint after startup is always a full checkpoint.
+   * If 0, every checkpoint is a full checkpoint.
+   *
+   * Default: 8
+   */
+  size_t checkpoint_compaction_interval = 8;
+
+  /**
+   * @brief
+   * The number of partitions of a checkpoint, which the workers of the
+   * thread pool capture in parallel. Each worker reads the data items of its
+   * partition without locking them.
+   *
+   * Default: 4
+   */
+  size_t checkpoint_threads = 4;
+
+  /**
+   * @brief
+   * The bytes of the serialized data items that a checkpoint holds in memory
+   * at once. The checkpoint threads serialize the data items into chunks
+   * while they iterate over the index, and an I/O thread writes the chunks
+   * behind them; when the chunks waiting for the I/O thread reach half of
+   * this size, the checkpoint threads wait for it.
+   * A full checkpoint keeps the keys in memory to sort them, but not the
+   * values.
+   *
+   * Default: 64 MiB
+   */
+  size_t checkpoint_buffer_size = 64 << 20;
+
   /**
    * @brief
    * It uses as the threshold (percentage) for rehashing of the hash index.
@@ -152,6 +401,90 @@ struct Config {
    */
   double rehash_threshold = 0.75;
 
+  enum HashIndexProbing { LinearProbing, CuckooHashing };
+  /**
+   * @brief
+   * Set the collision resolution scheme of the hash index.
+   * LinearProbing has the shortest probe while the table has enough room.
+   * CuckooHashing bounds the probe length of a lookup to two buckets
+   * regardless of the fill rate; it allows you to set rehash_threshold up to
+   * around 0.9 without increasing the latency of reads.
+   *
+   * Default: LinearProbing
+   */
+  HashIndexProbing hash_index_probing = LinearProbing;
+
+  /**
+   * @brief
+   * The number of records that you expect to store.
+   * The hash index is allocated with enough room to hold this number of
+   * records under rehash_threshold, so that populating the database does not
+   * repeat rehashing. Zero means that the index starts small and grows on
+   * demand.
+   *
+   * Default: 0
+   */
+  size_t expected_record_count = 0;
+
+  /**
+   * @brief
+   * If true, reads do not copy values into the read set; Transaction::Read
+   * returns a pointer to an immutable version of the value, which is valid
+   * until the transaction terminates. Writers create a new version instead of
+   * overwriting the old one, and an old version is freed after the readers
+   * have left its epoch.
+   * It is beneficial for large values that are read more than written; a
+   * value up to 32 bytes is copied regardless of this configuration.
+   * Effective with Silo and SiloNWR. The TwoPhaseLocking variants always copy
+   * values.
+   *
+   * Default: false
+   */
+  bool enable_zero_copy_read = false;
+
+  /**
+   * @brief
+   * If true, data items keep their past versions, so that transactions of
+   * TxType::SnapshotReadOnly read a consistent snapshot of a past epoch
+   * without validation, locking, or aborts. A version is kept only when it is
+   * overwritten in a later epoch, and it is discarded once no running
+   * snapshot can read it.
+   * Effective with Silo and SiloNWR; with the TwoPhaseLocking variants,
+   * snapshot transactions are processed as the ordinary ones.
+   *
+   * Default: false
+   */
+  bool enable_snapshot_read = false;
+
+  /**
+   * @brief
+   * If not zero, the values are evicted to a cold storage file in
+   * Config::work_dir while their heap areas in memory exceed this number of
+   * bytes (over the process; see Statistics::Memory::values). The evicted
+   * values are those of the data items not accessed recently, chosen by a
+   * clock sweep over the index in the background. An evicted value is mapped
+   * from the file, and the operating system reads it back when it is
+   * accessed; a write puts the new value in memory again. The file is a
+   * cache, not a part of the recovery; it is removed at the destruction.
+   *
+   * Default: 0 (disabled)
+   */
+  size_t cold_storage_threshold_bytes = 0;
+
+  /**
+   * @brief
+   * If true, the database is a read replica of another one, a.k.a. the
+   * primary, and it is updated only by Database::ApplyReplicatedLogs.
+   * All the transactions are processed as TxType::SnapshotReadOnly; they
+   * read the snapshot at the last epoch of the primary that has been applied,
+   * with any concurrency control protocol. A replica keeps no logs of the
+   * applied batches; set Config::enable_logging and
+   * Config::enable_checkpointing to false.
+   *
+   * Default: false
+   */
+  bool replica = false;
+
   /**
    * @brief
    * The directory path that lineardb use as working directory.
@@ -19,12 +19,23 @@
 
 #include <lineairdb/transaction.h>
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 #include <memory>
 #include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "completion_queue.h"
 #include "config.h"
+#include "statistics.h"
 #include "tx_status.h"
+#include "tx_type.h"
 
 namespace LineairDB {
 
@@ -80,6 +91,168 @@ class Database {
       ProcedureType proc, CallbackType commit_clbk,
       std::optional<CallbackType> precommit_clbk = std::nullopt);
 
+  /**
+   * @brief
+   * #ExecuteTransaction of a transaction which declares its type.
+   * See LineairDB::TxType for the options.
+   */
+  void ExecuteTransaction(TxType type, ProcedureType proc,
+                          CallbackType commit_clbk,
+                          std::optional<CallbackType> precommit_clbk =
+                              std::nullopt);
+
+  /**
+   * @brief
+   * #ExecuteTransaction of a transaction which mainly accesses the partition
+   * of `partition_key`. The transactions of a partition are processed by the
+   * same thread, which keeps the partition in its cache; with
+   * Config::enable_numa_aware_thread_pool, the thread is on the NUMA node
+   * that owns the partition, so that its data items are allocated and
+   * accessed on the same node. The partitions are assigned by the hash values
+   * of the keys.
+   */
+  void ExecuteTransaction(TxType type, std::string_view partition_key,
+                          ProcedureType proc, CallbackType commit_clbk,
+                          std::optional<CallbackType> precommit_clbk =
+                              std::nullopt);
+
+  /**
+   * @brief
+   * #ExecuteTransaction that pushes the result of the transaction into
+   * `completions` with `tag`, instead of calling a callback function on
+   * LineairDB's threads. It does not allocate memory for the completion.
+   * See CompletionQueue.
+   */
+  void ExecuteTransaction(TxType type, ProcedureType proc,
+                          CompletionQueue& completions, uint64_t tag);
+
+  /**
+   * @brief
+   * A transaction of #ExecuteTransactions.
+   */
+  struct TransactionRequest {
+    ProcedureType proc;
+    CallbackType commit_clbk;
+    std::optional<CallbackType> precommit_clbk = std::nullopt;
+    TxType type                                = TxType::ReadWrite;
+    /**
+     * @brief
+     * If set, the transaction is processed as #ExecuteTransaction with this
+     * partition key. It is used only in #ExecuteTransactions.
+     */
+    std::optional<std::string_view> partition_key = std::nullopt;
+    /**
+     * @brief
+     * The keys that the transaction is going to access first. The
+     * transactions with these keys are processed in groups on a thread, in
+     * turn; the index entries of the keys of each transaction are prefetched
+     * while the previous one is processed, so that its cache misses overlap
+     * with the work of the previous one.
+     */
+    std::vector<std::string> prefetch_keys;
+  };
+
+  /**
+   * @brief
+   * #ExecuteTransaction of a batch of transactions. The batch is enqueued
+   * into the thread pool with a few bulk operations, and the enqueued
+   * transactions do not allocate memory, unless their procedures and
+   * callbacks do.
+   * Thread-safe.
+   */
+  void ExecuteTransactions(std::vector<TransactionRequest>&& batch);
+
+  /**
+   * @brief
+   * The shape of the transactions of a procedure prepared by #Prepare.
+   * It only sizes the read/write sets; the commit of a prepared transaction
+   * orders its locks as the one of any other transaction does.
+   */
+  struct ProcedureShape {
+    TxType type = TxType::ReadWrite;
+    // The numbers of the keys that a transaction reads and writes at most;
+    // the read/write sets are allocated for them in advance.
+    size_t reads  = 0;
+    size_t writes = 0;
+  };
+  static constexpr size_t MaxParameterSize = 64;
+
+  /**
+   * @brief
+   * A procedure prepared by #Prepare, which executes the transactions of the
+   * procedure with their parameters. A call neither wraps the procedure in
+   * std::function nor allocates memory, unless the procedure and the
+   * callback do. It may be copied, and used by any threads.
+   * @tparam Parameters the parameters of a transaction, which are copied
+   * into the job of the transaction. Trivially copyable, and at most
+   * MaxParameterSize bytes.
+   */
+  template <typename Parameters>
+  class PreparedProcedure {
+    static_assert(std::is_trivially_copyable_v<Parameters>,
+                  "the parameters should be trivially copyable");
+    static_assert(sizeof(Parameters) <= MaxParameterSize &&
+                      alignof(Parameters) <= alignof(void*),
+                  "the parameters should fit the job of a transaction");
+
+   public:
+    using FunctionType = void (*)(Transaction&, const Parameters&);
+
+    /**
+     * @brief #ExecuteTransaction of the procedure with `parameters`.
+     */
+    void Execute(const Parameters& parameters,
+                 CallbackType commit_clbk) const {
+      db_->ExecutePrepared(*shape_, &Invoke,
+                           reinterpret_cast<void (*)()>(procedure_),
+                           reinterpret_cast<const std::byte*>(&parameters),
+                           sizeof(Parameters), std::move(commit_clbk));
+    }
+    /**
+     * @brief #Execute that pushes the result into `completions` with `tag`.
+     */
+    void Execute(const Parameters& parameters, CompletionQueue& completions,
+                 uint64_t tag) const {
+      // Small enough for the local storage of std::function.
+      Execute(parameters, [&completions, tag](const TxStatus status) {
+        completions.Push(tag, status);
+      });
+    }
+
+   private:
+    friend class Database;
+    PreparedProcedure(Database* db, FunctionType procedure,
+                      const ProcedureShape* shape)
+        : db_(db), procedure_(procedure), shape_(shape) {}
+
+    static void Invoke(Transaction& tx, void (*procedure)(),
+                       const std::byte* parameters) {
+      Parameters copy;
+      std::memcpy(&copy, parameters, sizeof(Parameters));
+      reinterpret_cast<FunctionType>(procedure)(tx, copy);
+    }
+
+    Database* db_;
+    FunctionType procedure_;
+    const ProcedureShape* shape_;  // owned by the database
+  };
+
+  /**
+   * @brief
+   * Prepares `procedure`, whose transactions are of `shape`, to execute its
+   * transactions by their parameters. The prepared transactions reuse the
+   * read/write sets allocated for the shape, and they are processed as
+   * #ExecuteTransaction does.
+   * Thread-safe.
+   * @return The prepared procedure, which is valid while this database is.
+   */
+  template <typename Parameters>
+  PreparedProcedure<Parameters> Prepare(
+      void (*procedure)(Transaction&, const Parameters&),
+      const ProcedureShape& shape) {
+    return PreparedProcedure<Parameters>(this, procedure, KeepShape(shape));
+  }
+
   /**
    * @brief
    * Creates a new transaction.
@@ -91,9 +264,10 @@ class Database {
    * Database::RequestCommit more frequently, in order to resolve the congestion
    * of the thread-local commit callback queue.
    *
+   * @param[in] type See LineairDB::TxType.
    * @return Transaction
    */
-  Transaction& BeginTransaction();
+  Transaction& BeginTransaction(TxType type = TxType::ReadWrite);
 
   /**
    * @brief
@@ -101,7 +275,8 @@ class Database {
    * If Transaction::Abort has not been called, LineairDB tries to commit `tx`.
    * @pre To achieve user abort, Transaction::Abort must be called before this
    * method.
-   * @post The first argument `tx` might have been deleted.
+   * @post The first argument `tx` must not be used anymore; LineairDB reuses
+   * the object for the next transaction of the callee thread.
    * @param[in] tx A transaction wants to terminate.
    * @param[out] clbk A callback function accepts a result (Committed or
    * @return true if the LineairDB's concurrency control protocol **decides** to
@@ -116,6 +291,88 @@ class Database {
    */
   bool EndTransaction(Transaction& tx, CallbackType clbk);
 
+  using BulkLoadWriter =
+      std::function<void(std::string_view, const std::byte[], size_t)>;
+  /**
+   * @brief
+   * Populates the database without transactions.
+   * `load` is invoked once with a writer function; each call of the writer
+   * stores a key-value pair into the indexes directly, without constructing
+   * read/write sets or logging. After `load` returns, LineairDB saves all the
+   * data items as a single checkpoint if logging or checkpointing is enabled.
+   * A key written twice holds the last value.
+   * Note that this method is NOT thread-safe with running transactions; call
+   * it before starting the workload. It calls Fence() at first.
+   * @param[in] load A procedure that writes key-value pairs via the writer.
+   */
+  void BulkLoad(std::function<void(const BulkLoadWriter&)> load);
+
+  /**
+   * @brief
+   * #BulkLoad over an iterator range.
+   * @tparam InputIterator
+   * The value type must be a pair of a key (convertible to std::string_view)
+   * and a value, std::pair<const std::byte*, size_t>.
+   */
+  template <typename InputIterator>
+  void BulkLoad(InputIterator first, InputIterator last) {
+    BulkLoad([&](const BulkLoadWriter& write) {
+      for (; first != last; ++first) {
+        const auto& [key, value] = *first;
+        write(key, value.first, value.second);
+      }
+    });
+  }
+
+  /**
+   * @brief
+   * Creates a table `name`, which the transactions access after
+   * Transaction::SetTable. A table has the indexes of its own: the scans of
+   * a table conflict only with the insertions into it.
+   * The table is configured by index_structure, rehash_threshold,
+   * hash_index_probing and expected_record_count of `table_config`; the
+   * other configurations are of the database.
+   * The tables are recorded in the working directory, and the recovery
+   * creates them again before it recovers their rows. Each table saves its
+   * own full checkpoint file. A replica applies the logs of the tables that
+   * it has created.
+   * Note that this method is NOT thread-safe with running transactions, as
+   * #BulkLoad is. It calls Fence() at first.
+   * @param name alphanumerics, '_' and '-'.
+   * @return false if `name` is invalid or the table already exists, e.g.,
+   * since it has been recovered.
+   */
+  bool CreateTable(const std::string& name, const Config& table_config);
+  /**
+   * @brief Same as above, but the table is configured as the database is.
+   */
+  bool CreateTable(const std::string& name);
+
+  /**
+   * @brief
+   * Gives the secondary key of a row, or std::nullopt if the row is not
+   * indexed. It must be a pure function of the row.
+   */
+  using SecondaryKeyExtractor = std::function<std::optional<std::string>(
+      std::string_view key, const std::pair<const std::byte*, size_t> value)>;
+  /**
+   * @brief
+   * Creates an ordered index of the keys of the default table by the
+   * secondary keys that `extractor` gives for their values, which
+   * Transaction::ScanIndex scans.
+   * The index is built from the current rows, and then the commits of the
+   * transactions and #BulkLoad maintain it along with the rows that they
+   * write, under the same concurrency control.
+   * The index is neither logged nor checkpointed: create it again after a
+   * restart, which builds it from the recovered rows. A replica does not
+   * maintain the indexes by the logs that it applies.
+   * Note that this method is NOT thread-safe with running transactions, as
+   * #BulkLoad is. It calls Fence() at first.
+   * @return false if an index of `name` already exists.
+   */
+  bool CreateSecondaryIndex(const std::string& name,
+                            SecondaryKeyExtractor extractor);
+
   /**
    * @brief
    * Fence() waits termination of transactions which is currently in progress.
@@ -150,10 +407,56 @@ class Database {
    */
   void RequestCallbacks();
 
+  using LogShipperType = std::function<void(const std::string& batch)>;
+  /**
+   * @brief
+   * Starts to ship the logs of this primary to read replicas. Whenever an
+   * epoch becomes durable (or completed, if Config::enable_logging is
+   * false), `shipper` is invoked with a batch of the write sets committed in
+   * the epochs after the previous batch, in the order of epochs. The
+   * transport of the batches, e.g., over the network, is up to `shipper`;
+   * each replica applies them in the same order by #ApplyReplicatedLogs.
+   * The transactions committed before this call are not shipped; the
+   * replicas start from the same data, e.g., loaded by #BulkLoad.
+   * @param shipper It is invoked in a thread of LineairDB, one batch at a
+   * time.
+   */
+  void StartLogShipping(LogShipperType shipper);
+
+  /**
+   * @brief
+   * Applies a batch of #StartLogShipping to this replica (see
+   * Config::replica). The versions are installed in parallel on the thread
+   * pool, and the transactions read the snapshot at the last epoch of the
+   * primary that has been applied entirely.
+   * @pre The batches are applied one by one in the order of shipping, by
+   * a thread which is not of LineairDB.
+   * @return false if `batch` is broken.
+   */
+  bool ApplyReplicatedLogs(const std::string& batch);
+
+  /**
+   * @brief
+   * Returns the memory usage of the subsystems and the statistics of the
+   * indexes, the logs and the callbacks. It reads the counters maintained by
+   * each thread and the sizes of the structures, without visiting the data
+   * items, and thus it is cheap enough to call periodically.
+   * Thread-safe.
+   */
+  Statistics GetStatistics() const;
+
  private:
+  using PreparedInvoker = void (*)(Transaction&, void (*)(),
+                                   const std::byte*);
+  const ProcedureShape* KeepShape(const ProcedureShape& shape);
+  void ExecutePrepared(const ProcedureShape& shape, PreparedInvoker invoke,
+                       void (*procedure)(), const std::byte* parameters,
+                       size_t size, CallbackType commit_clbk);
+
   class Impl;
   const std::unique_ptr<Impl> db_pimpl_;
   friend class Transaction;
+  friend class ShardedDatabase;
 };
 
 };  // namespace LineairDB
@@ -17,9 +17,14 @@
 #ifndef LINEAIRDB_H
 #define LINEAIRDB_H
 
+#include <lineairdb/completion_queue.h>
 #include <lineairdb/config.h>
 #include <lineairdb/database.h>
+#include <lineairdb/merge_operator.h>
+#include <lineairdb/sharded_database.h>
+#include <lineairdb/statistics.h>
 #include <lineairdb/transaction.h>
 #include <lineairdb/tx_status.h>
+#include <lineairdb/tx_type.h>
 
 #endif /* LINEAIRDB_H */
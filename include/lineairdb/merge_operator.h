@@ -0,0 +1,36 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_MERGE_OPERATOR_H
+#define LINEAIRDB_MERGE_OPERATOR_H
+
+#include <cstdint>
+
+namespace LineairDB {
+/*
+  @brief The commutative updates of Transaction::Merge. Each of them combines
+  the current value of a data item with an operand.
+  Add: the sum, as int64_t; the operand must be 8 bytes.
+  Max: the larger one, as int64_t; the operand must be 8 bytes.
+  Append: the concatenation of the current value and the operand.
+  An absent or deleted data item, and a value whose size is not 8 bytes for
+  Add and Max, is regarded as empty: the result is the operand itself.
+ */
+enum class MergeOperator : uint8_t { Add, Max, Append };
+
+}  // namespace LineairDB
+
+#endif
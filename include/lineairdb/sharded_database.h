@@ -0,0 +1,144 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_SHARDED_DATABASE_H
+#define LINEAIRDB_SHARDED_DATABASE_H
+
+#include <lineairdb/database.h>
+#include <lineairdb/transaction.h>
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "config.h"
+#include "tx_status.h"
+
+namespace LineairDB {
+
+class ShardedTransaction;
+
+/**
+ * @brief
+ * A front end of independent Database instances, i.e., shards, each of which
+ * has its own thread pool, epochs, logs and working directory. The keys are
+ * partitioned among the shards by a Partitioner. A transaction that accesses
+ * the keys of a single shard is executed by the shard as usual, and the rare
+ * transactions over several shards are committed by a commit protocol
+ * coordinated among the shards; see #ExecuteCrossShardTransaction.
+ * @note Each shard recovers from its own logs; a crash may recover the
+ * writes of a cross-shard transaction in some shards but not in the others.
+ */
+class ShardedDatabase {
+ public:
+  using Partitioner = std::function<size_t(std::string_view key)>;
+
+  /**
+   * @brief Constructs the shards with `configs`. Thread-safe.
+   * @param configs One Config for each shard; each shard needs a distinct
+   * Config::work_dir.
+   * @param partitioner Returns the shard of a key, in [0, configs.size()).
+   * By default, the keys are hash-partitioned; see #HashPartitioner.
+   */
+  ShardedDatabase(const std::vector<Config>& configs,
+                  Partitioner partitioner = nullptr);
+  ~ShardedDatabase();
+  ShardedDatabase(const ShardedDatabase&) = delete;
+  ShardedDatabase& operator=(const ShardedDatabase&) = delete;
+
+  static Partitioner HashPartitioner(size_t shards);
+  /**
+   * @brief
+   * Range-partitions the keys: the i-th shard owns the keys in
+   * [boundaries[i-1], boundaries[i]); the first shard owns the keys less than
+   * boundaries[0], and the last one the keys not less than boundaries.back().
+   * @param boundaries The sorted boundaries, one less than the shards.
+   */
+  static Partitioner RangePartitioner(std::vector<std::string> boundaries);
+
+  size_t GetNumberOfShards() const;
+  size_t GetShardOf(std::string_view key) const;
+  Database& GetShard(size_t shard);
+
+  /**
+   * @brief
+   * Executes a transaction that accesses only the keys of the shard of
+   * `key`, by Database::ExecuteTransaction of the shard. Thread-safe.
+   */
+  void ExecuteTransaction(std::string_view key, Database::ProcedureType proc,
+                          Database::CallbackType commit_clbk);
+
+  using ProcedureType = std::function<void(ShardedTransaction&)>;
+  /**
+   * @brief
+   * Executes a transaction over several shards in the callee thread, as
+   * Database::BeginTransaction and Database::EndTransaction do.
+   * The transaction begins a transaction in each shard that it accesses;
+   * after `proc`, they lock their write sets shard by shard, then validate
+   * their read sets, and are committed only if all of them have succeeded.
+   * Thread-safe.
+   * @param[out] commit_clbk It accepts the result once; Committed after the
+   * transaction has been durable in all the shards.
+   * @pre The callee is not a thread of LineairDB.
+   * @return true if the shards **decide** to commit the transaction; see
+   * Database::EndTransaction.
+   */
+  bool ExecuteCrossShardTransaction(ProcedureType proc,
+                                    Database::CallbackType commit_clbk);
+
+  /**
+   * @brief Database::Fence for all the shards.
+   */
+  void Fence() const noexcept;
+
+ private:
+  class Impl;
+  const std::unique_ptr<Impl> pimpl_;
+  friend class ShardedTransaction;
+};
+
+/**
+ * @brief
+ * A transaction of ShardedDatabase::ExecuteCrossShardTransaction. The
+ * operations on a key are issued to the transaction of its shard, e.g.,
+ * `tx.On(key).Read<int>(key)`; a scan is processed within a shard.
+ */
+class ShardedTransaction {
+ public:
+  /**
+   * @brief Returns the transaction in the shard of `key`.
+   */
+  Transaction& On(std::string_view key);
+  Transaction& OnShard(size_t shard);
+
+  bool IsAborted();
+  void Abort();
+
+ private:
+  ShardedTransaction(ShardedDatabase::Impl& db);
+
+  ShardedDatabase::Impl& db_;
+  std::vector<Transaction*> transactions_;  // nullptr if not begun
+  bool aborted_;
+  friend class ShardedDatabase;
+};
+
+}  // namespace LineairDB
+
+#endif /* LINEAIRDB_SHARDED_DATABASE_H */
@@ -0,0 +1,161 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+
+#ifndef LINEAIRDB_STATISTICS_H
+#define LINEAIRDB_STATISTICS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace LineairDB {
+
+/**
+ * @brief
+ * The resource usage of a Database; see Database::GetStatistics.
+ * The counters are read while transactions are running, and thus they are
+ * not consistent with each other.
+ */
+struct Statistics {
+  /**
+   * @brief
+   * The bytes used by each subsystem. They are the sizes of the objects and
+   * buffers allocated, without the overhead of the memory allocator.
+   */
+  struct Memory {
+    // The hash tables of the point index, and the keys stored out of them.
+    size_t point_index = 0;
+    // The ordered set of keys, and the predicates that the range index
+    // keeps for phantom avoidance.
+    size_t range_index = 0;
+    // The DataItem objects in the index.
+    size_t data_items = 0;
+    // The heap areas of the values, in the data items, in the versions kept
+    // for snapshot reads, and in the read/write sets. The values stored in
+    // DataItem itself are counted in #data_items. It is counted over the
+    // process, not for each Database.
+    size_t values = 0;
+    // The values kept for checkpoints (stable versions), over the process.
+    size_t stable_versions = 0;
+    // The log records buffered by the threads; see #pending_log_bytes.
+    size_t log_buffers = 0;
+    // The callbacks queued for the durability of their transactions.
+    size_t callback_queues = 0;
+
+    size_t Total() const {
+      return point_index + range_index + data_items + values +
+             stable_versions + log_buffers + callback_queues;
+    }
+  };
+  Memory memory;
+
+  // The keys in the point index, including the tombstones not reclaimed yet.
+  size_t records = 0;
+  // The number of the slots of the hash table.
+  size_t hash_table_capacity = 0;
+  // The ratio of the occupied slots; the table grows at
+  // Config::rehash_threshold.
+  double hash_table_fill_rate = 0;
+  // The average number of slots whose keys are compared by a lookup of the
+  // point index, since the construction of the Database. With
+  // Config::HashIndexProbing::LinearProbing, the slots of other keys are
+  // mostly skipped by their hash bits; a miss may compare no slot at all.
+  double average_probe_length = 0;
+  // The key ranges of the scans that the range index checks the insertions
+  // and deletions against.
+  size_t live_predicates = 0;
+  // The bytes of the keys and values that have been committed but not
+  // flushed into the log files yet.
+  size_t pending_log_bytes = 0;
+  // The callbacks that have not been invoked yet.
+  size_t pending_callbacks = 0;
+  // The bytes of the values evicted to the cold storage, including the ones
+  // overwritten since then; see Config::cold_storage_threshold_bytes.
+  size_t cold_storage_bytes = 0;
+
+  /**
+   * @brief
+   * The following statistics are recorded only if LineairDB is built with
+   * the CMake option ENABLE_INSTRUMENTATION (the macro
+   * LINEAIRDB_ENABLE_INSTRUMENTATION); otherwise the probes are compiled out
+   * and the statistics are zero. They are summed up over the process.
+   */
+  bool instrumented = false;
+
+  // The phases of transaction processing whose latencies are measured.
+  enum Phase : size_t {
+    IndexLookup,      // a lookup of the point index by a read or a write
+    LockAcquisition,  // locking the write set (Silo) or an item (2PL)
+    Validation,       // validating the read set, with Silo and SiloNWR
+    LogEnqueue,       // buffering the log records of a transaction
+    LogFlush,         // writing the buffered log records of a thread
+    LogSync,          // persisting the durable epoch, with the log files
+    CallbackDelay,    // from the commit to the execution of its callback
+    NumberOfPhases
+  };
+  // The causes of aborts.
+  enum AbortReason : size_t {
+    UserAbort,         // Transaction::Abort by the user
+    InvalidOperation,  // a read or a write not allowed by the TxType
+    ReadValidation,    // a read version has been overwritten (TID change)
+    AntiDependency,    // SiloNWR: NWRValidationResult::ANTI_DEPENDENCY
+    Phantom,           // a scan has conflicted with an insertion
+    LockConflict,      // 2PL: NoWait, WaitDie or WoundWait
+    RemovedItem,       // a deleted key has been reclaimed concurrently
+    NumberOfAbortReasons
+  };
+
+  /**
+   * @brief
+   * A summary of a latency histogram. The histogram has 16 buckets for each
+   * power of two, and thus a percentile is accurate to within 1/16.
+   */
+  struct Latency {
+    uint64_t count   = 0;
+    double mean_ns   = 0;
+    uint64_t p50_ns  = 0;
+    uint64_t p90_ns  = 0;
+    uint64_t p99_ns  = 0;
+    uint64_t p999_ns = 0;
+    uint64_t max_ns  = 0;
+  };
+  std::array<Latency, NumberOfPhases> latencies{};
+  std::array<uint64_t, NumberOfAbortReasons> aborts{};
+  // The write transactions checked whether their writes are omittable by
+  // SiloNWR, and the ones committed without locking.
+  uint64_t nwr_omittable_checks = 0;
+  uint64_t nwr_omitted          = 0;
+
+  static const char* PhaseName(const Phase phase) {
+    static constexpr const char* Names[] = {
+        "index_lookup", "lock_acquisition", "validation",    "log_enqueue",
+        "log_flush",    "log_sync",         "callback_delay"};
+    static_assert(sizeof(Names) / sizeof(Names[0]) == NumberOfPhases);
+    return Names[phase];
+  }
+  static const char* AbortReasonName(const AbortReason reason) {
+    static constexpr const char* Names[] = {
+        "user_abort", "invalid_operation", "read_validation",
+        "anti_dependency", "phantom", "lock_conflict", "removed_item"};
+    static_assert(sizeof(Names) / sizeof(Names[0]) == NumberOfAbortReasons);
+    return Names[reason];
+  }
+};
+
+}  // namespace LineairDB
+
+#endif /* LINEAIRDB_STATISTICS_H */
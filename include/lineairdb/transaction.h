@@ -16,6 +16,7 @@
 #ifndef LINEAIRDB_TRANSACTION_H
 #define LINEAIRDB_TRANSACTION_H
 
+#include <lineairdb/merge_operator.h>
 #include <lineairdb/tx_status.h>
 
 #include <cstddef>
@@ -25,6 +26,8 @@
 #include <optional>
 #include <string_view>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace LineairDB {
 
@@ -62,6 +65,17 @@ class Transaction {
   bool IsCommitted() { return GetCurrentStatus() == TxStatus::Aborted; }
   bool IsAborted() { return GetCurrentStatus() == TxStatus::Aborted; }
 
+  /**
+   * @brief
+   * Makes the subsequent operations of this transaction access the table
+   * `name`, which Database::CreateTable has created; the empty name is the
+   * default table, which a transaction accesses first. A transaction may
+   * access several tables, and it is committed atomically.
+   * A deterministic transaction cannot change its table; it is aborted.
+   * @return false and keeps the current table if there is no such table.
+   */
+  bool SetTable(const std::string_view name);
+
   /**
    * @brief
    * If the database contains a data item for "key", returns a pair
@@ -102,6 +116,47 @@ class Transaction {
     }
   }
 
+  /**
+   * @brief
+   * Reads multiple data items at once; it is equivalent to the #Read
+   * operations for all the keys in order. LineairDB looks up the index
+   * entries of the keys together and prefetches them, which hides the cache
+   * misses of the lookups; this is beneficial for transactions that read
+   * tens or hundreds of keys.
+   * @param keys Identifiers for data items
+   * @return std::vector<std::pair<const std::byte*, size_t>>
+   * The pairs of (a pointer of value, the size of value) in the same order as
+   * `keys`, as #Read returns. Once this transaction has aborted, the pairs
+   * of the subsequent keys are (nullptr, 0).
+   */
+  const std::vector<std::pair<const std::byte*, size_t>> MultiRead(
+      const std::vector<std::string_view>& keys);
+
+  /**
+   * @brief
+   * #MultiRead operation with user-defined template type.
+   * @tparam T
+   * T must be Trivially Copyable and Constructable.
+   * @param keys
+   * @return const std::vector<std::optional<T>>
+   */
+  template <typename T>
+  const std::vector<std::optional<T>> MultiRead(
+      const std::vector<std::string_view>& keys) {
+    static_assert(std::is_trivially_copyable<T>::value == true,
+                  "LineairDB expects to read/write trivially copyable types.");
+    std::vector<std::optional<T>> values;
+    values.reserve(keys.size());
+    for (const auto& result : MultiRead(keys)) {
+      if (result.second != 0) {
+        values.emplace_back(*reinterpret_cast<const T*>(result.first));
+      } else {
+        values.emplace_back(std::nullopt);
+      }
+    }
+    return values;
+  }
+
   /**
    * @brief
    * Writes a value with a given key.
@@ -132,6 +187,88 @@ class Transaction {
     Write(key, buffer, sizeof(T));
   };
 
+  /**
+   * @brief
+   * Deletes the data item of a given key; it is a write of a tombstone, and
+   * the subsequent reads of the key return (nullptr, 0) as for absent keys.
+   * #Scan skips the deleted keys.
+   * LineairDB removes the key from the indexes and frees the data item in
+   * background, once no running transaction may read the deleted version.
+   * Note that #Write with the size 0 also makes a tombstone.
+   *
+   * @param key
+   */
+  void Delete(const std::string_view key);
+  /**
+   * @brief
+   * Updates the data item of a given key with a commutative operator, e.g.,
+   * adds `operand` to a counter; see LineairDB::MergeOperator.
+   * A merge is a blind write: with Silo and SiloNWR, it is applied to the
+   * latest version when the data item is locked in the commit, and thus the
+   * transactions merging into the same data item do not abort each other.
+   * If this transaction reads the key after merging into it, the read turns
+   * the merge into a read-modify-write. With the TwoPhaseLocking variants, a
+   * merge is always a read-modify-write.
+   * An operand of Add or Max other than 8 bytes aborts this transaction.
+   *
+   * @param key
+   * @param operand
+   * @param size
+   * @param op
+   */
+  void Merge(const std::string_view key, const std::byte operand[],
+             const size_t size, const MergeOperator op);
+  /**
+   * @brief
+   * #Merge operation with user-defined template type.
+   * @tparam T
+   * T must be Trivially Copyable; int64_t for Add and Max.
+   */
+  template <typename T>
+  void Merge(const std::string_view key, const T& operand,
+             const MergeOperator op) {
+    static_assert(std::is_trivially_copyable<T>::value == true,
+                  "LineairDB expects to read/write trivially copyable types.");
+    std::byte buffer[sizeof(T)];
+    std::memcpy(buffer, &operand, sizeof(T));
+    Merge(key, buffer, sizeof(T), op);
+  };
+
+  /**
+   * @brief
+   * Writes multiple values at once; it is equivalent to the #Write
+   * operations for all the entries in order, but looks up the index entries
+   * of the keys together as #MultiRead does.
+   * @param entries The pairs of (key, (a pointer of value, the size of
+   * value)).
+   */
+  void MultiWrite(
+      const std::vector<
+          std::pair<std::string_view, std::pair<const std::byte*, size_t>>>&
+          entries);
+
+  /**
+   * @brief
+   * #MultiWrite operation with user-defined template type.
+   * @tparam T
+   * T must be Trivially Copyable.
+   * @param entries The pairs of (key, value).
+   */
+  template <typename T>
+  void MultiWrite(const std::vector<std::pair<std::string_view, T>>& entries) {
+    static_assert(std::is_trivially_copyable<T>::value == true,
+                  "LineairDB expects to read/write trivially copyable types.");
+    std::vector<
+        std::pair<std::string_view, std::pair<const std::byte*, size_t>>>
+        raw_entries;
+    raw_entries.reserve(entries.size());
+    for (const auto& [key, value] : entries) {
+      raw_entries.push_back(
+          {key, {reinterpret_cast<const std::byte*>(&value), sizeof(T)}});
+    }
+    MultiWrite(raw_entries);
+  }
+
   /**
    * @brief
    * Get all data items that match the range from the "begin" key to the "end"
@@ -151,7 +288,8 @@ class Transaction {
    * input range. The arguments of the function are key (std::string_view) and
    * value (std::pair). Return value (boolean) forces LineairDB to cancel the
    * scanning operation; when a function returns true at some key, this function
-   * will never be invoked with the next key.
+   * will never be invoked with the next key. It is not invoked with absent
+   * or deleted keys.
    * @return std::optional<size_t>
    *  returns the total number of rows that match the inputted range, if
    * succeed. Concurrent transactions may aborts this scan operation and returns
@@ -163,6 +301,18 @@ class Transaction {
       std::function<bool(std::string_view,
                          const std::pair<const void*, const size_t>)>
           operation);
+  /**
+   * @brief
+   * Same as #Scan, but gives at most `limit` rows to the operation. The rows
+   * after them are not read, and thus they do not conflict with concurrent
+   * writers; inserting a key into the range still conflicts with this scan.
+   */
+  const std::optional<size_t> Scan(
+      const std::string_view begin, const std::optional<std::string_view> end,
+      const size_t limit,
+      std::function<bool(std::string_view,
+                         const std::pair<const void*, const size_t>)>
+          operation);
 
   /**
    * @brief
@@ -187,6 +337,50 @@ class Transaction {
       return operation(key, copy_constructed);
     });
   }
+  template <typename T>
+  const std::optional<size_t> Scan(
+      const std::string_view begin, const std::optional<std::string_view> end,
+      const size_t limit, std::function<bool(std::string_view, T)> operation) {
+    static_assert(std::is_trivially_copyable<T>::value == true,
+                  "LineairDB expects to trivially copyable types.");
+    return Scan(begin, end, limit, [&](auto key, auto pair) {
+      const T copy_constructed = *reinterpret_cast<const T*>(pair.first);
+      return operation(key, copy_constructed);
+    });
+  }
+
+  /**
+   * @brief
+   * Same as #Scan, but gives the rows whose secondary keys of the index
+   * `index_name` are in the range from `begin` to `end`, in the order of the
+   * secondary keys (and then the keys); see Database::CreateSecondaryIndex.
+   * The rows are of the default table, regardless of #SetTable.
+   * The entries of the index are read as the rows are, and thus a commit
+   * of a row into the range conflicts with this scan.
+   * Note that the rows which this transaction itself has moved into the
+   * range are not given, since the index is maintained at the commit.
+   * @return std::optional<size_t>
+   *  returns the number of the rows given to the operation, or std::nullopt
+   * if this scan has aborted this transaction, e.g., for an unknown index.
+   */
+  const std::optional<size_t> ScanIndex(
+      const std::string_view index_name, const std::string_view begin,
+      const std::optional<std::string_view> end,
+      std::function<bool(std::string_view,
+                         const std::pair<const void*, const size_t>)>
+          operation);
+  template <typename T>
+  const std::optional<size_t> ScanIndex(
+      const std::string_view index_name, const std::string_view begin,
+      const std::optional<std::string_view> end,
+      std::function<bool(std::string_view, T)> operation) {
+    static_assert(std::is_trivially_copyable<T>::value == true,
+                  "LineairDB expects to trivially copyable types.");
+    return ScanIndex(index_name, begin, end, [&](auto key, auto pair) {
+      const T copy_constructed = *reinterpret_cast<const T*>(pair.first);
+      return operation(key, copy_constructed);
+    });
+  }
 
   /**
    * @brief
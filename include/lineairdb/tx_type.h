@@ -0,0 +1,39 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_TX_TYPE_H
+#define LINEAIRDB_TX_TYPE_H
+
+namespace LineairDB {
+/*
+  @brief A transaction may declare what it does when it begins, so that
+  LineairDB skips the work which the transaction does not need.
+  ReadWrite: the default; the transaction may read and write data items.
+  ReadOnly: the transaction only reads data items. A write aborts the
+  transaction.
+  WriteOnly: the transaction only writes data items without reading them
+  (blind writes); it may read its own writes. A read of any other data item
+  aborts the transaction.
+  SnapshotReadOnly: the transaction only reads data items, from a consistent
+  snapshot of a past epoch. It never aborts by conflicts, but it may miss the
+  writes of the transactions committed in the last two epochs. A write
+  aborts the transaction. See Config::enable_snapshot_read.
+ */
+enum class TxType { ReadWrite, ReadOnly, WriteOnly, SnapshotReadOnly };
+
+}  // namespace LineairDB
+
+#endif
@@ -31,9 +31,13 @@ CallbackManager::CallbackManager(const Config& config) {
   LineairDB::Util::SetUpSPDLog();
   switch (config.callback_engine) {
     case Config::CallbackEngine::ThreadLocal:
-      if (config.logger != Config::Logger::ThreadLocalLogger) {
+      if (config.logger != Config::Logger::ThreadLocalLogger &&
+          config.logger != Config::Logger::GroupCommitLogger &&
+          config.logger != Config::Logger::BinaryLogger &&
+          config.logger != Config::Logger::PersistentMemoryLogger) {
         SPDLOG_ERROR(
-            "ThreadLocal callback engine must be used with ThreadLocalLogger. "
+            "ThreadLocal callback engine must be used with ThreadLocalLogger, "
+            "GroupCommitLogger, BinaryLogger or PersistentMemoryLogger. "
             "Please change the configuration.");
         exit(EXIT_FAILURE);
       }
@@ -61,6 +65,9 @@ void CallbackManager::ExecuteCallbacks(EpochNumber new_epoch) {
 void CallbackManager::WaitForAllCallbacksToBeExecuted() {
   callback_manager_pimpl_->WaitForAllCallbacksToBeExecuted();
 }
+size_t CallbackManager::GetPendingCallbacks() const {
+  return callback_manager_pimpl_->GetPendingCallbacks();
+}
 };  // namespace Callback
 
 }  // namespace LineairDB
@@ -49,6 +49,7 @@ manage this callback as work-stealing.
                bool entrusting = false);
   void ExecuteCallbacks(EpochNumber new_epoch);
   void WaitForAllCallbacksToBeExecuted();
+  size_t GetPendingCallbacks() const;
 
  private:
   std::unique_ptr<CallbackManagerBase> callback_manager_pimpl_;
@@ -32,6 +32,8 @@ class CallbackManagerBase {
                        EpochNumber epoch, bool entrusting) = 0;
   virtual void ExecuteCallbacks(EpochNumber new_epoch)     = 0;
   virtual void WaitForAllCallbacksToBeExecuted()           = 0;
+  // the number of the callbacks enqueued but not executed yet.
+  virtual size_t GetPendingCallbacks() const = 0;
 };
 
 }  // namespace Callback
@@ -0,0 +1,120 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+
+#include <lineairdb/completion_queue.h>
+
+#include <atomic>
+#include <chrono>
+
+#include "concurrentqueue.h"  // moodycamel::concurrentqueue
+#include "util/event_count.hpp"
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace LineairDB {
+
+class CompletionQueue::Impl {
+ public:
+  Impl() : signaled_(false), event_fd_(-1) {
+#if defined(__linux__)
+    event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+  }
+  ~Impl() {
+#if defined(__linux__)
+    if (0 <= event_fd_) close(event_fd_);
+#endif
+  }
+
+  void Push(uint64_t tag, TxStatus status) {
+    queue_.enqueue({tag, status});
+    Signal();
+  }
+
+  size_t Poll(Completion* out, size_t max) {
+    if (signaled_.exchange(false, std::memory_order_acq_rel)) {
+#if defined(__linux__)
+      uint64_t count;
+      if (0 <= event_fd_) {
+        [[maybe_unused]] auto r = read(event_fd_, &count, sizeof(count));
+      }
+#endif
+    }
+    const size_t polled = queue_.try_dequeue_bulk(out, max);
+    // Some completions may remain; keep the queue signaled.
+    if (polled == max) Signal();
+    return polled;
+  }
+
+  size_t Wait(Completion* out, size_t max, std::chrono::microseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+      const auto key      = arrived_.PrepareWait();
+      const size_t polled = Poll(out, max);
+      const auto now      = std::chrono::steady_clock::now();
+      if (0 < polled || deadline <= now) {
+        arrived_.CancelWait();
+        return polled;
+      }
+      arrived_.Wait(key, std::chrono::duration_cast<std::chrono::microseconds>(
+                             deadline - now));
+    }
+  }
+
+  int GetEventFd() const { return event_fd_; }
+
+ private:
+  // Notifies the harvesters once until the next #Poll.
+  void Signal() {
+    if (signaled_.exchange(true, std::memory_order_acq_rel)) return;
+#if defined(__linux__)
+    if (0 <= event_fd_) {
+      const uint64_t one = 1;
+      [[maybe_unused]] auto w = write(event_fd_, &one, sizeof(one));
+    }
+#endif
+    arrived_.Notify();
+  }
+
+  moodycamel::ConcurrentQueue<Completion> queue_;
+  std::atomic<bool> signaled_;
+  EventCount arrived_;
+  int event_fd_;
+};
+
+CompletionQueue::CompletionQueue() : pimpl_(std::make_unique<Impl>()) {}
+CompletionQueue::~CompletionQueue() = default;
+
+size_t CompletionQueue::Poll(Completion* out, size_t max) {
+  return pimpl_->Poll(out, max);
+}
+
+size_t CompletionQueue::Wait(Completion* out, size_t max,
+                             std::chrono::microseconds timeout) {
+  return pimpl_->Wait(out, max, timeout);
+}
+
+int CompletionQueue::GetEventFd() const { return pimpl_->GetEventFd(); }
+
+void CompletionQueue::Push(uint64_t tag, TxStatus status) {
+  pimpl_->Push(tag, status);
+}
+
+}  // namespace LineairDB
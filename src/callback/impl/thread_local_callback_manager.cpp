@@ -18,112 +18,95 @@
 
 #include <lineairdb/database.h>
 
+#include <chrono>
+#include <mutex>
+#include <vector>
+
 #include "types/definitions.h"
-#include "util/backoff.hpp"
 
 namespace LineairDB {
 
 namespace Callback {
 
 ThreadLocalCallbackManager::ThreadLocalCallbackManager()
-    : work_steal_queue_size_(0) {}
+    : entrusted_node_size_(0), pending_callbacks_(0) {}
 
 void ThreadLocalCallbackManager::Enqueue(
     const LineairDB::Database::CallbackType& callback, EpochNumber epoch,
     bool entrusting) {
+  pending_callbacks_.fetch_add(1, std::memory_order_relaxed);
   if (entrusting) {
     // The callee thread is not willing to manage this callback.
-    // Enqueue to work-stealing queue.
-    auto* my_work_steal_queue = GetMyWorkStealingQueue();
-    my_work_steal_queue->queue.enqueue({epoch, callback});
-
+    // Enqueue to the batches which the other threads take.
+    auto* my_node = GetMyEntrustedNode();
+    std::lock_guard<std::mutex> guard(my_node->lock);
+    my_node->queue.Push(callback, epoch);
   } else {
     // The caller thread manages the callback. Enqueue to thread-local queue.
     auto* my_storage = thread_key_storage_.Get();
-    my_storage->callback_queue.push({epoch, callback});
+    my_storage->queue.Push(callback, epoch);
   }
 }
+
 void ThreadLocalCallbackManager::ExecuteCallbacks(EpochNumber stable_epoch) {
-  auto* queues         = thread_key_storage_.Get();
-  auto& callback_queue = queues->callback_queue;
-
-  if (callback_queue.empty()) {
-    // my thread-local callback queue is empty.
-    // helping to the jobs on the work-stealing queue.
-    const size_t queue_size = work_steal_queue_size_.load();
-    if (0 == queue_size) return;
-    size_t checked_queue      = 0;
-    auto work_steal_queue_itr = work_steal_queues_.begin();
-    for (;;) {
-      auto& queue = work_steal_queue_itr->queue;
-
-      for (;;) {
-        if (queue.size_approx() == 0) break;
-        std::pair<EpochNumber, LineairDB::Database::CallbackType> pair;
-        auto dequeued = queue.try_dequeue(pair);
-        if (!dequeued) break;
-        if (pair.first < stable_epoch) {
-          pair.second(TxStatus::Committed);
-        } else {
-          queue.enqueue(std::move(pair));
-          break;
-        }
-      }
-
-      checked_queue++;
-      if (checked_queue == queue_size) break;
-      work_steal_queue_itr++;
-    }
-  } else {
-    for (;;) {
-      if (callback_queue.empty()) break;
-      auto& entry = callback_queue.front();
-      if (entry.first < stable_epoch) {
-        entry.second(TxStatus::Committed);
-        callback_queue.pop();
-      } else {
-        break;
-      }
+  auto& my_batches = thread_key_storage_.Get()->queue.batches;
+  while (!my_batches.empty() && my_batches.front().epoch < stable_epoch) {
+    Execute(my_batches.front());
+    my_batches.pop_front();
+  }
+
+  // Helping to execute the entrusted batches. A node that another thread is
+  // taking from is skipped.
+  const size_t node_size = entrusted_node_size_.load();
+  if (0 == node_size) return;
+  std::vector<Batch> taken;
+  auto node_itr = entrusted_nodes_.begin();
+  for (size_t checked = 0; checked < node_size; checked++, node_itr++) {
+    auto& node = *node_itr;
+    if (!node.lock.try_lock()) continue;
+    auto& batches = node.queue.batches;
+    while (!batches.empty() && batches.front().epoch < stable_epoch) {
+      taken.emplace_back(std::move(batches.front()));
+      batches.pop_front();
     }
+    node.lock.unlock();
+
+    for (auto& batch : taken) Execute(batch);
+    taken.clear();
   }
 }
+
+void ThreadLocalCallbackManager::Execute(Batch& batch) {
+  Instrumentation::Record(Statistics::CallbackDelay, batch.enqueued_at,
+                          batch.callbacks.size());
+  for (auto& callback : batch.callbacks) callback(TxStatus::Committed);
+  const size_t executed = batch.callbacks.size();
+  if (pending_callbacks_.fetch_sub(executed) == executed) drained_.Notify();
+}
+
 void ThreadLocalCallbackManager::WaitForAllCallbacksToBeExecuted() {
-  thread_key_storage_.ForEach(
-      [&](const ThreadLocalStorageNode* thread_local_node) {
-        auto& queue = thread_local_node->callback_queue;
-        for (;;) {
-          if (queue.empty()) { break; }
-          std::this_thread::yield();
-        }
-      });
-
-  size_t checked                     = 0;
-  const size_t work_steal_queue_size = work_steal_queue_size_.load();
-  if (0 == work_steal_queue_size) return;
-  auto itr = work_steal_queues_.begin();
-  for (;;) {
-    for (;;) {
-      if (itr->queue.size_approx() == 0) break;
-      std::this_thread::yield();
+  while (pending_callbacks_.load() != 0) {
+    const auto key = drained_.PrepareWait();
+    if (pending_callbacks_.load() == 0) {
+      drained_.CancelWait();
+      break;
     }
-    checked++;
-    if (checked == work_steal_queue_size) break;
-    itr++;
+    drained_.Wait(key, std::chrono::milliseconds(10));
   }
-  // Here we observed empty queue for all thread.
+  // Here we observed that all callbacks have been executed.
 }
 
-ThreadLocalCallbackManager::WorkStealingQueueNode*
-ThreadLocalCallbackManager::GetMyWorkStealingQueue() {
-  auto* my_node = thread_local_work_steal_queue_
-                      .Get<ThreadLocalCallbackManager::WorkStealingQueueNode*>(
+ThreadLocalCallbackManager::EntrustedNode*
+ThreadLocalCallbackManager::GetMyEntrustedNode() {
+  auto* my_node = thread_local_entrusted_node_
+                      .Get<ThreadLocalCallbackManager::EntrustedNode*>(
                           []() { return nullptr; });
   if (nullptr != *my_node) return *my_node;
 
   std::lock_guard<std::mutex> guard(list_lock_);
-  work_steal_queues_.emplace_back();
-  work_steal_queue_size_.fetch_add(1);
-  *my_node = &work_steal_queues_.back();
+  entrusted_nodes_.emplace_back();
+  entrusted_node_size_.fetch_add(1);
+  *my_node = &entrusted_nodes_.back();
 
   return *my_node;
 }
@@ -18,19 +18,30 @@
 #define LINEAIRDB_THREAD_LOCAL_CALLBACK_MANAGER_BASE_H
 
 #include <atomic>
+#include <cstdint>
+#include <deque>
 #include <list>
 #include <mutex>
-#include <queue>
+#include <vector>
 
 #include "callback/callback_manager_base.h"
-#include "concurrentqueue.h"  // moodycamel::concurrentqueue
 #include "types/definitions.h"
+#include "util/instrumentation.hpp"
+#include "util/event_count.hpp"
 #include "util/thread_key_storage.h"
 
 namespace LineairDB {
 
 namespace Callback {
 
+/**
+ * @brief
+ * Keeps the callbacks of each thread in per-epoch batches, so that a batch
+ * is released with a single check of its epoch. The callbacks that the
+ * callee thread manages are executed by itself, and the entrusted ones are
+ * executed by any thread that calls #ExecuteCallbacks; the entrusted batches
+ * of the threads are taken in parallel.
+ */
 class ThreadLocalCallbackManager final : public CallbackManagerBase {
  public:
   ThreadLocalCallbackManager();
@@ -38,29 +49,53 @@ class ThreadLocalCallbackManager final : public CallbackManagerBase {
                EpochNumber epoch, bool entrusting) final override;
   void ExecuteCallbacks(EpochNumber new_epoch) final override;
   void WaitForAllCallbacksToBeExecuted() final override;
+  size_t GetPendingCallbacks() const final override {
+    return pending_callbacks_.load(std::memory_order_relaxed);
+  }
 
  private:
+  struct Batch {
+    EpochNumber epoch;
+    std::vector<LineairDB::Database::CallbackType> callbacks;
+    // when the first callback was enqueued; see Instrumentation::Now.
+    uint64_t enqueued_at;
+  };
+  // The batches of a thread, in the order of epochs.
+  struct BatchQueue {
+    std::deque<Batch> batches;
+
+    void Push(const LineairDB::Database::CallbackType& callback,
+              EpochNumber epoch) {
+      if (batches.empty() || batches.back().epoch != epoch) {
+        batches.push_back({epoch, {}, Instrumentation::Now()});
+      }
+      batches.back().callbacks.push_back(callback);
+    }
+  };
+
   struct ThreadLocalStorageNode {
-   public:
-    std::queue<std::pair<EpochNumber, LineairDB::Database::CallbackType>>
-        callback_queue;
+    BatchQueue queue;
   };
 
-  struct WorkStealingQueueNode {
-    moodycamel::ConcurrentQueue<
-        std::pair<EpochNumber, LineairDB::Database::CallbackType>>
-        queue;
+  // The lock is held only to push a callback or to take batches.
+  struct alignas(64) EntrustedNode {
+    std::mutex lock;
+    BatchQueue queue;
   };
 
  private:
-  inline WorkStealingQueueNode* GetMyWorkStealingQueue();
+  inline EntrustedNode* GetMyEntrustedNode();
+  void Execute(Batch& batch);
 
  private:
   ThreadKeyStorage<ThreadLocalStorageNode> thread_key_storage_;
-  std::list<WorkStealingQueueNode> work_steal_queues_;
-  ThreadKeyStorage<WorkStealingQueueNode*> thread_local_work_steal_queue_;
+  std::list<EntrustedNode> entrusted_nodes_;
+  ThreadKeyStorage<EntrustedNode*> thread_local_entrusted_node_;
   std::mutex list_lock_;
-  std::atomic<size_t> work_steal_queue_size_;
+  std::atomic<size_t> entrusted_node_size_;
+  // The number of callbacks not executed yet, and the waiters of zero.
+  std::atomic<size_t> pending_callbacks_;
+  EventCount drained_;
 };
 
 }  // namespace Callback
@@ -17,7 +17,9 @@
 #ifndef LINEAIRDB_CONCURRENCY_CONTROL_BASE_H
 #define LINEAIRDB_CONCURRENCY_CONTROL_BASE_H
 
+#include <lineairdb/config.h>
 #include <lineairdb/tx_status.h>
+#include <lineairdb/tx_type.h>
 
 #include <cstddef>
 #include <string>
@@ -33,17 +35,45 @@ struct TransactionReferences {
   WriteSetType& write_set_ref_;
   EpochFramework& epoch_framework_ref_;
   TxStatus& current_status_ref_;
+  const Config& config_ref_;
+  const TxType& type_ref_;
+  const bool& coordinated_ref_;  // see Transaction::Impl::coordinated_
+  Index::ConcurrentTable& index_ref_;
 };
+/**
+ * @brief
+ * The common part of concurrency control protocols.
+ * Each protocol derives this class and implements the following member
+ * functions, which are invoked by Transaction::Impl without virtual dispatch:
+ *   const DataItem Read(std::string_view, DataItem*);
+ *   void Write(const std::string_view key, const std::byte* const value,
+ *              const size_t size, DataItem*);
+ *   void Abort();
+ *   bool Precommit(EpochNumber checkpoint_epoch);  // 0 if not checkpointing
+ *   bool LockForCommit(EpochNumber checkpoint_epoch);
+ *   bool ValidateForCommit();
+ *   void Install();
+ *   void PostProcessing(TxStatus);
+ *   void Reset();  // prepares for the next transaction, keeping its buffers
+ *   static constexpr bool DefersMerges;
+ *   static constexpr bool ValidatesReads;
+ * A protocol that defers merges applies the pending merges of the write set
+ * (Snapshot::merge_operator) in Precommit; otherwise Transaction::Impl
+ * processes a merge as a read-modify-write.
+ * A protocol that validates reads by the transaction ids of the data items,
+ * without locking them, reads an absent key by its absence item (see
+ * Index::ConcurrentTable::GetOrAbsence); otherwise a read of an absent key
+ * inserts a blank entry, which the protocol locks.
+ * #Precommit is the three phases of a commit, #LockForCommit,
+ * #ValidateForCommit and #Install, in a row; a commit coordinated among
+ * databases runs each phase in all the participants before the next phase.
+ * A transaction aborted between the phases releases its locks by Abort.
+ * The protocol is held by value in Transaction::Impl; see
+ * Transaction::Impl::ConcurrencyControlType for the list of protocols.
+ */
 class ConcurrencyControlBase {
  public:
   ConcurrencyControlBase(TransactionReferences&& tx) : tx_ref_(tx) {}
-  virtual ~ConcurrencyControlBase(){};
-  virtual const DataItem Read(std::string_view, DataItem*) = 0;
-  virtual void Write(const std::string_view key, const std::byte* const value,
-                     const size_t size, DataItem*)         = 0;
-  virtual void Abort()                                     = 0;
-  virtual bool Precommit(bool)                             = 0;
-  virtual void PostProcessing(TxStatus)                    = 0;
 
   bool IsReadOnly() { return (0 == tx_ref_.write_set_ref_.size()); }
   bool IsWriteOnly() { return (0 == tx_ref_.read_set_ref_.size()); }
@@ -18,17 +18,25 @@
 #define LINEAIRDB_SILO_NWR_H
 
 #include <lineairdb/tx_status.h>
+#include <lineairdb/tx_type.h>
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
 #include <cstring>
+#include <functional>
 #include <vector>
 
 #include "concurrency_control/concurrency_control_base.h"
 #include "concurrency_control/pivot_object.hpp"
 #include "index/concurrent_table.h"
+#include "index/table.h"
+#include "lock/wait_policy.hpp"
 #include "types/data_item.hpp"
 #include "types/definitions.h"
+#include "types/merge.hpp"
+#include "util/instrumentation.hpp"
+#include "util/position_map.hpp"
 
 namespace LineairDB {
 
@@ -43,6 +51,27 @@ class SiloNWRTyped final : public ConcurrencyControlBase {
     const DataItem* item_p_cache;
     TransactionId transaction_id;
   };
+  struct ValidationItemKey {
+    const DataItem* operator()(const ValidationItem& v) const {
+      return v.item_p_cache;
+    }
+  };
+  using ValidationPositionMap =
+      PositionMap<const DataItem*, ValidationItemKey>;
+  /**
+   * @brief
+   * The write set is locked in the order of the addresses of its data items,
+   * which all the transactions share as they did the order of the keys.
+   * Sorting these entries, instead of the snapshots, neither compares the
+   * keys nor moves the copies of the values.
+   */
+  struct LockOrderItem {
+    DataItem* item;
+    size_t position;  // in the write set
+  };
+  // the items fetched ahead of the lock being acquired.
+  static constexpr size_t PrefetchDistance = 8;
+
   struct PivotObjectSnapshot {
     DataItem* item_p_cache;
     NWRPivotObject pv_snapshot;
@@ -51,32 +80,61 @@ class SiloNWRTyped final : public ConcurrencyControlBase {
   };
 
   std::vector<ValidationItem> validation_set_;
+  ValidationPositionMap validation_positions_;
   NWRValidationResult nwr_validation_result_;
   NWRPivotObject my_pivot_object_;
   std::vector<PivotObjectSnapshot> pivot_object_snapshots_;
+  Lock::WaitPolicy wait_policy_;
+  // The hot items locked at the first read; see Config::hot_key_threshold.
+  std::vector<DataItem*> hot_locks_;
+  size_t hot_commits_;
+  // the write set locked by #LockForCommit, which #Abort unlocks.
+  size_t locked_for_commit_;
+  std::vector<LockOrderItem> lock_order_;
 
  public:
+  // The merges are applied to the latest versions under the locks.
+  static constexpr bool DefersMerges = true;
+  // The reads are validated by the transaction ids.
+  static constexpr bool ValidatesReads = true;
+
   SiloNWRTyped(TransactionReferences&& tx)
       : ConcurrencyControlBase(std::forward<TransactionReferences&&>(tx)),
-        nwr_validation_result_(NWRValidationResult::NOT_YET_VALIDATED){};
-  ~SiloNWRTyped() final override{};
+        nwr_validation_result_(NWRValidationResult::NOT_YET_VALIDATED),
+        wait_policy_(tx_ref_.config_ref_.lock_wait_policy),
+        hot_commits_(0),
+        locked_for_commit_(0){};
+
+  void Reset() {
+    ReleaseHotItems(false);
+    locked_for_commit_ = 0;
+    lock_order_.clear();
+    validation_set_.clear();
+    validation_positions_.Clear();
+    nwr_validation_result_ = NWRValidationResult::NOT_YET_VALIDATED;
+    my_pivot_object_       = NWRPivotObject();
+    pivot_object_snapshots_.clear();
+  }
 
-  const DataItem Read(const std::string_view,
-                      DataItem* index_leaf) final override {
+  const DataItem Read(const std::string_view, DataItem* index_leaf) {
     assert(index_leaf != nullptr);
+    if (IsHot(index_leaf)) LockHotItem(index_leaf);
 
     DataItem snapshot;
     for (;;) {
       auto tx_id = index_leaf->transaction_id.load();
 
       if (tx_id.tid & 1u) {  // locked
-                             // WANTFIX user-space adaptive mutex locking may
-                             // improve the performance
-        std::this_thread::yield();
+        wait_policy_.WaitUntil(index_leaf,
+                               [&]() { return index_leaf->IsUnlocked(); });
         continue;
       }
 
-      snapshot = *index_leaf;
+      if (tx_ref_.config_ref_.enable_zero_copy_read) {
+        snapshot.Borrow(*index_leaf);
+      } else {
+        snapshot = *index_leaf;
+      }
 
       if (index_leaf->transaction_id.load() == tx_id) {
         validation_set_.push_back({index_leaf, tx_id});
@@ -85,15 +143,19 @@ class SiloNWRTyped final : public ConcurrencyControlBase {
     }
   };
   void Write(const std::string_view, const std::byte* const, const size_t,
-             DataItem*) final override{};
-  void Abort() final override{};
-  bool Precommit(bool need_to_checkpoint) final override {
-    /** Sorting write set to prevent deadlock **/
-    std::sort(tx_ref_.write_set_ref_.begin(), tx_ref_.write_set_ref_.end(),
-              Snapshot::Compare);
+             DataItem*) {}
+  void Abort() {
+    UnlockWriteSet(locked_for_commit_);
+    locked_for_commit_ = 0;
+  }
+  bool Precommit(EpochNumber checkpoint_epoch) {
+    if (IsReadOnly()) return PrecommitReadOnly();
 
     if constexpr (EnableNWR) {
-      if (!IsReadOnly() && IsOmittable()) {
+      // NOTE: a merge is never omittable, as it depends on the latest version.
+      const bool omittable = !IsReadOnly() && !HasMerges() && IsOmittable();
+      Instrumentation::CountOmittableCheck(omittable);
+      if (omittable) {
         // we can safely clear writeset since all versions x_j in writeset_j are
         // omittable.
         tx_ref_.write_set_ref_.clear();
@@ -104,51 +166,33 @@ class SiloNWRTyped final : public ConcurrencyControlBase {
         // since the subsequent validation of Silo's version order will also
         // fail.
         if (nwr_validation_result_ == NWRValidationResult::ANTI_DEPENDENCY) {
+          Instrumentation::CountAbort(Statistics::AntiDependency);
           return false;
         }
       }
     }
 
-    /** Acquire Lock **/
-    for (auto& snapshot : tx_ref_.write_set_ref_) {
-      auto* item = snapshot.index_cache;
-      assert(item != nullptr);
-      __builtin_prefetch(item, 1, 3);
+    if (!LockWriteSet(checkpoint_epoch)) return false;
+    if (!ValidateForCommit()) return false;
+    Install();
+    return true;
+  };
 
-      for (;;) {
-        auto current = item->transaction_id.load();
-        if (current.tid & 1llu) {
-          // WANTFIX user-space adaptive mutex locking may
-          // improve the performance
-          std::this_thread::yield();
-          continue;
-        }
-        auto desired = current;
-        desired.tid |= 1llu;
-        bool lock_acquired =
-            item->transaction_id.compare_exchange_weak(current, desired);
-        if (lock_acquired) {
-          snapshot.data_item_copy.transaction_id.store(desired);
-          // If this item is in readset, add 1 (lockflag) into snapshot for
-          // validation
-          for (auto& read_item : validation_set_) {
-            if (read_item.item_p_cache == item) {
-              read_item.transaction_id.tid++;
-              break;
-            }
-          }
-          break;
-        }
-      }
-    }
-    if (need_to_checkpoint) {
-      for (auto& snapshot : tx_ref_.write_set_ref_) {
-        snapshot.index_cache->CopyLiveVersionToStableVersion();
-      }
-    }
+  /**
+   * @brief
+   * The first phase of a coordinated commit; see ConcurrencyControlBase.
+   * It locks the write set without NWR's omission, since the omission orders
+   * a transaction in each database independently.
+   */
+  bool LockForCommit(EpochNumber checkpoint_epoch) {
+    if (IsReadOnly()) return true;
+    // the pivot objects are updated as the lock-based transactions do.
+    if constexpr (EnableNWR) { SnapshotPivotObjects(); }
+    return LockWriteSet(checkpoint_epoch);
+  }
 
-    /** Update Metadata for NWR **/
-    if constexpr (EnableNWR) { UpdatePivotObjects(); }
+  bool ValidateForCommit() {
+    if (IsReadOnly()) return PrecommitReadOnly();
 
     // CompilerFence();
     tx_ref_.epoch_framework_ref_.MakeMeOffline();
@@ -156,26 +200,56 @@ class SiloNWRTyped final : public ConcurrencyControlBase {
     // CompilerFence();
 
     /** Validation Phase **/
-    if (!AntiDependencyValidation()) {
+    if (!ValidateReadSet(true)) {
       // if validation failed, unlock all objects
-      for (auto& snapshot : tx_ref_.write_set_ref_) {
-        auto current = snapshot.index_cache->transaction_id.load();
-        current.tid--;
-        snapshot.index_cache->transaction_id.store(current);
-      }
+      UnlockWriteSet(tx_ref_.write_set_ref_.size());
+      locked_for_commit_ = 0;
       return false;
     }
+    return true;
+  }
 
-    /** Buffer Update **/
+  void Install() {
+    /** Apply Merges **/
     for (auto& snapshot : tx_ref_.write_set_ref_) {
-      *snapshot.index_cache = snapshot.data_item_copy;
+      if (!snapshot.merge_operator.has_value()) continue;
+      ApplyMerge(snapshot.merge_operator.value(), *snapshot.index_cache,
+                 snapshot.data_item_copy);
+      snapshot.merge_operator.reset();
     }
 
-    return true;
-  };
+    /** Buffer Update **/
+    if (tx_ref_.config_ref_.enable_snapshot_read) {
+      auto& epoch_framework = tx_ref_.epoch_framework_ref_;
+      const auto horizon    = EpochFramework::GetCompletedEpoch(
+          epoch_framework.GetOldestActiveEpoch());
+      for (auto& snapshot : tx_ref_.write_set_ref_) {
+        snapshot.index_cache->KeepVersionForSnapshots(
+            epoch_framework.GetMyThreadLocalEpoch(), horizon);
+      }
+    }
+    if (tx_ref_.config_ref_.enable_zero_copy_read) {
+      // Concurrent readers may refer to the current versions; they are freed
+      // after the readers have left this epoch.
+      for (auto& snapshot : tx_ref_.write_set_ref_) {
+        auto* detached = snapshot.index_cache->ResetWithoutOverwriting(
+            snapshot.data_item_copy);
+        if (detached == nullptr) continue;
+        tx_ref_.epoch_framework_ref_.Retire(detached, [](void* area) {
+          delete[] static_cast<std::byte*>(area);
+        });
+      }
+    } else {
+      for (auto& snapshot : tx_ref_.write_set_ref_) {
+        *snapshot.index_cache = snapshot.data_item_copy;
+      }
+    }
+  }
 
-  void PostProcessing(TxStatus status) final override {
+  void PostProcessing(TxStatus status) {
+    ReleaseHotItems(status == TxStatus::Committed);
     if (status == TxStatus::Committed) {
+      locked_for_commit_ = 0;
       if constexpr (EnableNWR) {
         if (nwr_validation_result_ == NWRValidationResult::ACYCLIC) { return; }
       }
@@ -196,12 +270,237 @@ class SiloNWRTyped final : public ConcurrencyControlBase {
           unlocked_id = {current_epoch, current_tid.tid + 1};
         }
         item->transaction_id.store(unlocked_id);
+        wait_policy_.NotifyReleased(item);
         snapshot.data_item_copy.transaction_id.store(unlocked_id);
       }
     }
   }
 
  private:
+  void OrderLocks() {
+    auto& write_set = tx_ref_.write_set_ref_;
+    lock_order_.clear();
+    lock_order_.reserve(write_set.size());
+    for (size_t i = 0; i < write_set.size(); i++) {
+      assert(write_set[i].index_cache != nullptr);
+      lock_order_.push_back({write_set[i].index_cache, i});
+    }
+    std::sort(lock_order_.begin(), lock_order_.end(),
+              [](const LockOrderItem& left, const LockOrderItem& right) {
+                return std::less<DataItem*>()(left.item, right.item);
+              });
+  }
+
+  /**
+   * @brief
+   * Locks the write set in the order of #OrderLocks, and keeps the current
+   * versions for the checkpoint and the pivot objects for NWR.
+   * @return false if it has failed, after unlocking the locked items.
+   */
+  bool LockWriteSet(EpochNumber checkpoint_epoch) {
+    /** Ordering the locks to prevent deadlock **/
+    OrderLocks();
+
+    /** Acquire Lock **/
+    const auto lock_begin = Instrumentation::Now();
+    for (size_t i = 0; i < PrefetchDistance && i < lock_order_.size(); i++) {
+      __builtin_prefetch(lock_order_[i].item, 1, 3);
+    }
+    for (size_t locked = 0; locked < lock_order_.size(); locked++) {
+      if (locked + PrefetchDistance < lock_order_.size()) {
+        __builtin_prefetch(lock_order_[locked + PrefetchDistance].item, 1, 3);
+      }
+      auto* item     = lock_order_[locked].item;
+      auto& snapshot = tx_ref_.write_set_ref_[lock_order_[locked].position];
+
+      for (;;) {
+        auto current = item->transaction_id.load();
+        if (current.tid & 1llu) {
+          wait_policy_.WaitUntil(item, [&]() { return item->IsUnlocked(); });
+          continue;
+        }
+        // The tombstone has been removed from the index since we looked it
+        // up; a retry writes the new item of the key.
+        if (__builtin_expect(item->IsRemoved(), false)) {
+          Instrumentation::CountAbort(Statistics::RemovedItem);
+          UnlockWriteSet(locked);
+          return false;
+        }
+        auto desired = current;
+        desired.tid |= 1llu;
+        bool lock_acquired =
+            item->transaction_id.compare_exchange_weak(current, desired);
+        if (lock_acquired) {
+          snapshot.data_item_copy.transaction_id.store(desired);
+          // If this item is in readset, add 1 (lockflag) into snapshot for
+          // validation
+          const auto read_at =
+              validation_positions_.Find(validation_set_, item);
+          if (read_at != ValidationPositionMap::npos) {
+            validation_set_[read_at].transaction_id.tid++;
+          }
+          if (!item->IsInitialized() && snapshot.secondary_index == nullptr) {
+            IncreaseAbsence(snapshot);
+          }
+          break;
+        }
+      }
+    }
+    Instrumentation::Record(Statistics::LockAcquisition, lock_begin);
+    if (checkpoint_epoch != 0) {
+      for (auto& snapshot : tx_ref_.write_set_ref_) {
+        snapshot.index_cache->CopyLiveVersionToStableVersion(checkpoint_epoch);
+      }
+    }
+
+    /** Update Metadata for NWR **/
+    if constexpr (EnableNWR) { UpdatePivotObjects(); }
+    locked_for_commit_ = tx_ref_.write_set_ref_.size();
+    return true;
+  }
+
+  /**
+   * @brief
+   * Invalidates the reads of the key of `snapshot` as an absent key by the
+   * other transactions, before installing a value into a data item without
+   * one; see Index::ConcurrentTable::GetOrAbsence. The own reads of the
+   * absence item, which the other absent keys may share, are kept valid.
+   */
+  void IncreaseAbsence(const Snapshot& snapshot) {
+    auto& index = snapshot.table != nullptr ? snapshot.table->GetIndex()
+                                            : tx_ref_.index_ref_;
+    const auto key             = Index::Table::DecodeKey(snapshot.key).second;
+    const auto [before, after] = index.IncreaseAbsence(key);
+    const auto* absence        = &index.AbsenceOf(key);
+    for (auto& validation_item : validation_set_) {
+      if (validation_item.item_p_cache != absence) continue;
+      if (validation_item.transaction_id != before) continue;
+      validation_item.transaction_id = after;
+    }
+  }
+
+  /**
+   * @brief Releases the locks of the first `locked` items in the lock order.
+   */
+  void UnlockWriteSet(const size_t locked) {
+    for (size_t i = 0; i < locked; i++) {
+      auto* item   = lock_order_[i].item;
+      auto current = item->transaction_id.load();
+      current.tid--;
+      item->transaction_id.store(current);
+      wait_policy_.NotifyReleased(item);
+    }
+  }
+
+  /**
+   * @brief
+   * A read-only transaction neither acquires locks nor updates the pivot
+   * objects; it only validates its reads. It refreshes its epoch only when it
+   * has read a version written in a later epoch, so that it is ordered after
+   * the writer of the version.
+   */
+  bool PrecommitReadOnly() {
+    auto& epoch_framework = tx_ref_.epoch_framework_ref_;
+    const auto my_epoch   = epoch_framework.GetMyThreadLocalEpoch();
+    for (auto& validation_item : validation_set_) {
+      if (my_epoch < validation_item.transaction_id.epoch) {
+        epoch_framework.MakeMeOffline();
+        epoch_framework.MakeMeOnline();
+        break;
+      }
+    }
+    return ValidateReadSet();
+  }
+
+  // AntiDependencyValidation, which is measured and counted as an abort.
+  // `has_writes`: the conflicts heat the items; see #IsHot.
+  bool ValidateReadSet(const bool has_writes = false) {
+    Instrumentation::ScopedTimer timer(Statistics::Validation);
+    if (AntiDependencyValidation()) return true;
+    Instrumentation::CountAbort(Statistics::ReadValidation);
+    if (has_writes && tx_ref_.config_ref_.hot_key_threshold != 0) {
+      for (auto& validation_item : validation_set_) {
+        auto* item = validation_item.item_p_cache;
+        if (item->transaction_id.load() == validation_item.transaction_id) {
+          continue;
+        }
+        const auto contention =
+            item->contention.load(std::memory_order_relaxed);
+        if (contention < UINT8_MAX) {
+          item->contention.store(contention + 1, std::memory_order_relaxed);
+        }
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief
+   * Hot items are locked pessimistically by ReadWrite transactions, with the
+   * rw_lock of the item, which Silo does not use otherwise.
+   * NOTE: the conflicts are counted without atomic read-modify-writes; a lost
+   * update only delays the detection.
+   */
+  bool IsHot(const DataItem* item) const {
+    const size_t threshold = tx_ref_.config_ref_.hot_key_threshold;
+    // NOTE: a coordinated transaction waits for the locks in several
+    // databases, which do not order the locks among them.
+    return threshold != 0 && tx_ref_.type_ref_ == TxType::ReadWrite &&
+           !tx_ref_.coordinated_ref_ &&
+           threshold <= item->contention.load(std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief
+   * A transaction waits for the lock of a hot item only if the item is
+   * ordered after all the hot items that it holds; otherwise it tries the
+   * lock once, and reads the item optimistically if it fails. Hence there is
+   * no deadlock among the holders, and they wait for the lock bit of the
+   * transaction id only while another transaction is committing the item.
+   */
+  void LockHotItem(DataItem* item) {
+    if (std::find(hot_locks_.begin(), hot_locks_.end(), item) !=
+        hot_locks_.end()) {
+      return;
+    }
+    auto& lock = item->GetRWLockRef();
+    if (hot_locks_.empty() ||
+        *std::max_element(hot_locks_.begin(), hot_locks_.end()) < item) {
+      lock.Lock();
+    } else if (!lock.TryLock()) {
+      return;
+    }
+    hot_locks_.push_back(item);
+  }
+
+  /**
+   * @brief
+   * Releases the hot items. Every HotCoolingInterval commits of the locking
+   * transactions cool an item by one conflict, so that an item turns back to
+   * be optimistic once it is no longer contended.
+   */
+  static constexpr size_t HotCoolingInterval = 32;
+  void ReleaseHotItems(const bool committed) {
+    for (auto* item : hot_locks_) {
+      if (committed && ++hot_commits_ % HotCoolingInterval == 0) {
+        const auto contention =
+            item->contention.load(std::memory_order_relaxed);
+        if (0 < contention) {
+          item->contention.store(contention - 1, std::memory_order_relaxed);
+        }
+      }
+      item->GetRWLockRef().UnLock();
+    }
+    hot_locks_.clear();
+  }
+
+  bool HasMerges() const {
+    for (auto& snapshot : tx_ref_.write_set_ref_) {
+      if (snapshot.merge_operator.has_value()) return true;
+    }
+    return false;
+  }
+
   bool AntiDependencyValidation() {
     for (auto& validation_item : validation_set_) {
       auto* item = validation_item.item_p_cache;
@@ -222,29 +521,7 @@ class SiloNWRTyped final : public ConcurrencyControlBase {
     // x_j, __in the generated version order <<__. When << fails to validate
     // the correctness, Silo generate the another version order which includes
     // x_pv < x_j by using exclusive locking.
-
-    {  // snapshot the pivot version objects from write_set
-      for (auto& snapshot : tx_ref_.write_set_ref_) {
-        auto* value_ptr = snapshot.index_cache;
-        assert(value_ptr != nullptr);
-
-        const auto pivot_object               = value_ptr->pivot_object.load();
-        const PivotObjectSnapshot pv_snapshot = {value_ptr, pivot_object,
-                                                 PivotObjectSnapshot::WRITESET};
-        pivot_object_snapshots_.emplace_back(pv_snapshot);
-      }
-    }
-    {  // snapshot the pivot version objects
-       // from read_set
-      for (auto& snapshot : tx_ref_.read_set_ref_) {
-        auto* value_ptr = snapshot.index_cache;
-        assert(value_ptr != nullptr);
-        const auto pivot_object               = value_ptr->pivot_object.load();
-        const PivotObjectSnapshot pv_snapshot = {value_ptr, pivot_object,
-                                                 PivotObjectSnapshot::READSET};
-        pivot_object_snapshots_.emplace_back(pv_snapshot);
-      }
-    }
+    SnapshotPivotObjects();
 
     // We now validate Linearizability.
     // In short, linearizability prohibits the ordering of version orders
@@ -362,6 +639,35 @@ class SiloNWRTyped final : public ConcurrencyControlBase {
     return true;
   }
 
+  /**
+   * @brief Snapshots the pivot objects of the items in the read/write sets.
+   */
+  void SnapshotPivotObjects() {
+    pivot_object_snapshots_.clear();
+    {  // snapshot the pivot version objects from write_set
+      for (auto& snapshot : tx_ref_.write_set_ref_) {
+        auto* value_ptr = snapshot.index_cache;
+        assert(value_ptr != nullptr);
+
+        const auto pivot_object               = value_ptr->pivot_object.load();
+        const PivotObjectSnapshot pv_snapshot = {value_ptr, pivot_object,
+                                                 PivotObjectSnapshot::WRITESET};
+        pivot_object_snapshots_.emplace_back(pv_snapshot);
+      }
+    }
+    {  // snapshot the pivot version objects
+       // from read_set
+      for (auto& snapshot : tx_ref_.read_set_ref_) {
+        auto* value_ptr = snapshot.index_cache;
+        assert(value_ptr != nullptr);
+        const auto pivot_object               = value_ptr->pivot_object.load();
+        const PivotObjectSnapshot pv_snapshot = {value_ptr, pivot_object,
+                                                 PivotObjectSnapshot::READSET};
+        pivot_object_snapshots_.emplace_back(pv_snapshot);
+      }
+    }
+  }
+
   /**
    * @brief
    * Update the metadata (the pivot objects) for each data item in readset or
@@ -23,6 +23,7 @@
 #include <cstddef>
 #include <cstring>
 #include <set>
+#include <thread>
 #include <vector>
 
 #include "concurrency_control/concurrency_control_base.h"
@@ -30,6 +31,7 @@
 #include "index/concurrent_table.h"
 #include "types/data_item.hpp"
 #include "types/definitions.h"
+#include "util/instrumentation.hpp"
 
 namespace LineairDB {
 
@@ -41,28 +43,36 @@ template <DeadLockAvoidanceType deadlock_avoidance_type =
               DeadLockAvoidanceType::NoWait>
 class TwoPhaseLockingImpl final : public ConcurrencyControlBase {
  public:
+  static constexpr bool DefersMerges  = false;
+  static constexpr bool ValidatesReads = false;
+
   TwoPhaseLockingImpl(TransactionReferences&& tx)
-      : ConcurrencyControlBase(std::forward<TransactionReferences&&>(tx)) {}
+      : ConcurrencyControlBase(std::forward<TransactionReferences&&>(tx)),
+        timestamp_(GenerateTimestamp()),
+        conflicted_(false),
+        checkpoint_epoch_(0) {}
 
-  ~TwoPhaseLockingImpl() final override{};
+  /**
+   * @note A transaction aborted by a conflict passes its timestamp to the
+   * next transaction of the thread, i.e., its retry, so that the retried
+   * transaction gets older and eventually wins the conflicts; otherwise
+   * WaitDie and WoundWait may starve it.
+   */
+  void Reset() {
+    checkpoint_epoch_ = 0;
+    undo_set_.clear();
+    read_lock_set_.clear();
+    if (!conflicted_) timestamp_ = GenerateTimestamp();
+    conflicted_ = false;
+  }
 
-  const DataItem Read(const std::string_view,
-                      DataItem* index_leaf) final override {
+  const DataItem Read(const std::string_view, DataItem* index_leaf) {
     assert(index_leaf != nullptr);
-    auto& rw_lock = index_leaf->GetRWLockRef();
-
-    auto lock_acquired = rw_lock.TryLock(
-        std::remove_reference<decltype(rw_lock)>::type::LockType::Shared);
-
-    if (!lock_acquired) {
-      if constexpr (deadlock_avoidance_type == DeadLockAvoidanceType::NoWait) {
-        Abort();
-        return {};
-      } else {
-        SPDLOG_ERROR(
-            "Selected deadlock-avoidance algorithm is not implemented.");
-        exit(EXIT_FAILURE);
-      }
+    if (!AcquireLock(index_leaf, LockType::Shared)) {
+      Instrumentation::CountAbort(Statistics::LockConflict);
+      conflicted_ = true;
+      Abort();
+      return {};
     }
     read_lock_set_.emplace(index_leaf);
     DataItem snapshot_item = *index_leaf;
@@ -70,10 +80,9 @@ class TwoPhaseLockingImpl final : public ConcurrencyControlBase {
     return snapshot_item;
   };
   void Write(const std::string_view key, const std::byte* const value,
-             const size_t size, DataItem* index_leaf) final override {
+             const size_t size, DataItem* index_leaf) {
     assert(index_leaf != nullptr);
 
-    auto& rw_lock             = index_leaf->GetRWLockRef();
     bool is_read_modify_write = false;
     for (auto& item : tx_ref_.read_set_ref_) {
       if (item.key == key) {
@@ -86,22 +95,24 @@ class TwoPhaseLockingImpl final : public ConcurrencyControlBase {
     if (is_read_modify_write) {
       // it has already been acquired shared lock. request upgrade.
       assert(read_lock_set_.find(index_leaf) != read_lock_set_.end());
-      lock_acquired = rw_lock.TryLock(
-          std::remove_reference<decltype(rw_lock)>::type::LockType::Upgrade);
+      lock_acquired = AcquireLock(index_leaf, LockType::Upgrade);
       if (lock_acquired) read_lock_set_.erase(index_leaf);
     } else {
-      lock_acquired = rw_lock.TryLock(
-          std::remove_reference<decltype(rw_lock)>::type::LockType::Exclusive);
+      lock_acquired = AcquireLock(index_leaf, LockType::Exclusive);
     }
     if (!lock_acquired) {
-      if constexpr (deadlock_avoidance_type == DeadLockAvoidanceType::NoWait) {
-        Abort();
-        return;
-      } else {
-        SPDLOG_ERROR(
-            "Selected deadlock-avoidance algorithm is not implemented.");
-        exit(EXIT_FAILURE);
-      }
+      Instrumentation::CountAbort(Statistics::LockConflict);
+      conflicted_ = true;
+      Abort();
+      return;
+    }
+    // The tombstone has been removed from the index since we looked it up.
+    if (__builtin_expect(index_leaf->IsRemoved(), false)) {
+      ReleaseLock(index_leaf);
+      Instrumentation::CountAbort(Statistics::RemovedItem);
+      conflicted_ = true;
+      Abort();
+      return;
     }
 
     auto copy_for_undo = *index_leaf;
@@ -110,7 +121,7 @@ class TwoPhaseLockingImpl final : public ConcurrencyControlBase {
     index_leaf->Reset(value, size);
   };
 
-  void Abort() final override {
+  void Abort() {
     if (tx_ref_.current_status_ref_ == TxStatus::Aborted) {
       // User abort or Sysabort on the commit request
       Undo();
@@ -121,17 +132,42 @@ class TwoPhaseLockingImpl final : public ConcurrencyControlBase {
       PostProcessing(TxStatus::Aborted);
     }
   };
-  bool Precommit(bool need_to_checkpoint) final override {
-    if (need_to_checkpoint) {
-      for (auto& snapshot : tx_ref_.write_set_ref_) {
-        snapshot.index_cache->CopyLiveVersionToStableVersion();
-      }
+  bool Precommit(EpochNumber checkpoint_epoch) {
+    LockForCommit(checkpoint_epoch);
+    if (!ValidateForCommit()) {
+      Undo();
+      return false;
     }
-
+    Install();
     return true;
   };
 
-  void PostProcessing(TxStatus) final override { UnlockAll(); }
+  // The phases of a coordinated commit; see ConcurrencyControlBase.
+  // The locks have been acquired at the accesses.
+  bool LockForCommit(EpochNumber checkpoint_epoch) {
+    checkpoint_epoch_ = checkpoint_epoch;
+    return true;
+  }
+  bool ValidateForCommit() {
+    if constexpr (deadlock_avoidance_type ==
+                  DeadLockAvoidanceType::WoundWait) {
+      if (IsWounded()) {
+        Instrumentation::CountAbort(Statistics::LockConflict);
+        conflicted_ = true;
+        return false;
+      }
+    }
+    return true;
+  }
+  void Install() {
+    if (checkpoint_epoch_ != 0) {
+      for (auto& snapshot : tx_ref_.write_set_ref_) {
+        snapshot.index_cache->CopyLiveVersionToStableVersion(checkpoint_epoch_);
+      }
+    }
+  }
+
+  void PostProcessing(TxStatus) { UnlockAll(); }
 
  private:
   void Undo() {
@@ -140,16 +176,82 @@ class TwoPhaseLockingImpl final : public ConcurrencyControlBase {
     }
   }
   void UnlockAll() {
-    for (auto* item : read_lock_set_) { item->GetRWLockRef().UnLock(); }
-    for (auto& item : undo_set_) { item.first->GetRWLockRef().UnLock(); }
+    for (auto* item : read_lock_set_) { ReleaseLock(item); }
+    for (auto& item : undo_set_) { ReleaseLock(item.first); }
+  }
+
+  using LockType = decltype(DataItem::readers_writers_lock)::LockType;
+
+  /**
+   * @return false if this transaction has to abort.
+   */
+  bool AcquireLock(DataItem* item, const LockType type) {
+    Instrumentation::ScopedTimer timer(Statistics::LockAcquisition);
+    auto& rw_lock = item->GetRWLockRef();
+    if constexpr (deadlock_avoidance_type == DeadLockAvoidanceType::NoWait) {
+      return rw_lock.TryLock(type);
+    } else {
+      // NOTE: a coordinated transaction spans several databases, and the
+      // deadlock avoidance of each one does not see the locks held in the
+      // others. It never waits, so that no cycle is made across them.
+      if (tx_ref_.coordinated_ref_) {
+        return rw_lock.TryLockWithTimestamp(type, timestamp_);
+      }
+      for (;;) {
+        if (rw_lock.TryLockWithTimestamp(type, timestamp_)) return true;
+        if constexpr (deadlock_avoidance_type ==
+                      DeadLockAvoidanceType::WaitDie) {
+          // an older transaction waits for the younger owners; a younger one
+          // dies. NOTE: an upgrading transaction is itself one of the owners.
+          if (rw_lock.GetOldestOwner() < timestamp_) return false;
+        } else {
+          // an older transaction wounds the younger owners, and they abort
+          // themselves when they wait for a lock or try to commit.
+          rw_lock.Wound(timestamp_);
+          if (IsWounded()) return false;
+        }
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void ReleaseLock(DataItem* item) {
+    if constexpr (deadlock_avoidance_type == DeadLockAvoidanceType::NoWait) {
+      item->GetRWLockRef().UnLock();
+    } else {
+      item->GetRWLockRef().UnLockWithTimestamp();
+    }
+  }
+
+  bool IsWounded() {
+    for (auto* item : read_lock_set_) {
+      if (item->GetRWLockRef().IsWounded(timestamp_)) return true;
+    }
+    for (auto& item : undo_set_) {
+      if (item.first->GetRWLockRef().IsWounded(timestamp_)) return true;
+    }
+    return false;
+  }
+
+  // A smaller timestamp means an older transaction.
+  static uint64_t GenerateTimestamp() {
+    static std::atomic<uint64_t> counter(0);
+    return counter.fetch_add(1);
   }
 
  private:
   std::vector<std::pair<DataItem*, DataItem>> undo_set_;
   std::set<DataItem*> read_lock_set_;
+  uint64_t timestamp_;
+  bool conflicted_;  // whether this transaction has aborted by a conflict
+  EpochNumber checkpoint_epoch_;  // of the commit; see #LockForCommit
 };
 
 using TwoPhaseLocking = TwoPhaseLockingImpl<DeadLockAvoidanceType::NoWait>;
+using TwoPhaseLockingWaitDie =
+    TwoPhaseLockingImpl<DeadLockAvoidanceType::WaitDie>;
+using TwoPhaseLockingWoundWait =
+    TwoPhaseLockingImpl<DeadLockAvoidanceType::WoundWait>;
 
 }  // namespace ConcurrencyControl
 }  // namespace LineairDB
@@ -20,6 +20,10 @@
 
 #include <functional>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 #include "database_impl.h"
 #include "util/logger.hpp"
@@ -47,8 +51,54 @@ void Database::ExecuteTransaction(
                                 precommit_clbk);
 }
 
-Transaction& Database::BeginTransaction() {
-  return db_pimpl_->BeginTransaction();
+void Database::ExecuteTransaction(
+    TxType type, std::function<void(Transaction&)> transaction_procedure,
+    std::function<void(TxStatus)> callback,
+    std::optional<CallbackType> precommit_clbk) {
+  db_pimpl_->ExecuteTransaction(transaction_procedure, callback,
+                                precommit_clbk, type);
+}
+
+void Database::ExecuteTransaction(
+    TxType type, std::string_view partition_key,
+    std::function<void(Transaction&)> transaction_procedure,
+    std::function<void(TxStatus)> callback,
+    std::optional<CallbackType> precommit_clbk) {
+  db_pimpl_->ExecuteTransaction(
+      transaction_procedure, callback, precommit_clbk, type,
+      std::hash<std::string_view>()(partition_key));
+}
+
+void Database::ExecuteTransaction(
+    TxType type, std::function<void(Transaction&)> transaction_procedure,
+    CompletionQueue& completions, uint64_t tag) {
+  // Small enough for the local storage of std::function.
+  auto push = [&completions, tag](const TxStatus status) {
+    completions.Push(tag, status);
+  };
+  db_pimpl_->ExecuteTransaction(transaction_procedure, push, std::nullopt,
+                                type);
+}
+
+void Database::ExecuteTransactions(std::vector<TransactionRequest>&& batch) {
+  db_pimpl_->ExecuteTransactions(batch);
+}
+
+const Database::ProcedureShape* Database::KeepShape(
+    const ProcedureShape& shape) {
+  return db_pimpl_->KeepShape(shape);
+}
+
+void Database::ExecutePrepared(const ProcedureShape& shape,
+                               PreparedInvoker invoke, void (*procedure)(),
+                               const std::byte* parameters, size_t size,
+                               CallbackType commit_clbk) {
+  db_pimpl_->ExecutePrepared(shape, invoke, procedure, parameters, size,
+                             std::move(commit_clbk));
+}
+
+Transaction& Database::BeginTransaction(TxType type) {
+  return db_pimpl_->BeginTransaction(type);
 }
 
 bool Database::EndTransaction(Transaction& tx, CallbackType clbk) {
@@ -56,9 +106,37 @@ bool Database::EndTransaction(Transaction& tx, CallbackType clbk) {
                                    std::forward<decltype(clbk)>(clbk));
 }
 
+void Database::BulkLoad(std::function<void(const BulkLoadWriter&)> load) {
+  db_pimpl_->BulkLoad(load);
+}
+
+bool Database::CreateTable(const std::string& name,
+                           const Config& table_config) {
+  return db_pimpl_->CreateTable(name, table_config);
+}
+bool Database::CreateTable(const std::string& name) {
+  return db_pimpl_->CreateTable(name, db_pimpl_->GetConfig());
+}
+
+bool Database::CreateSecondaryIndex(const std::string& name,
+                                    SecondaryKeyExtractor extractor) {
+  return db_pimpl_->CreateSecondaryIndex(name, std::move(extractor));
+}
+
 void Database::Fence() const noexcept { db_pimpl_->Fence(); }
 void Database::WaitForCheckpoint() const noexcept {
   db_pimpl_->WaitForCheckpoint();
 }
 void Database::RequestCallbacks() { db_pimpl_->RequestCallbacks(); }
+
+void Database::StartLogShipping(LogShipperType shipper) {
+  db_pimpl_->StartLogShipping(std::move(shipper));
+}
+bool Database::ApplyReplicatedLogs(const std::string& batch) {
+  return db_pimpl_->ApplyReplicatedLogs(batch);
+}
+
+Statistics Database::GetStatistics() const {
+  return db_pimpl_->GetStatistics();
+}
 }  // namespace LineairDB
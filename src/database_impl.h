@@ -18,45 +18,91 @@
 
 #include <lineairdb/config.h>
 #include <lineairdb/database.h>
+#include <lineairdb/statistics.h>
 #include <lineairdb/transaction.h>
 #include <lineairdb/tx_status.h>
-
+#include <lineairdb/tx_type.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
 #include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "callback/callback_manager.h"
 #include "index/concurrent_table.h"
+#include "index/secondary_index.h"
+#include "index/table.h"
+#include "recovery/checkpoint_image.h"
 #include "recovery/checkpoint_manager.hpp"
 #include "recovery/logger.h"
+#include "recovery/replication.h"
 #include "thread_pool/thread_pool.h"
 #include "transaction_impl.h"
+#include "util/adaptive_epoch_controller.hpp"
 #include "util/backoff.hpp"
 #include "util/epoch_framework.hpp"
+#include "util/instrumentation.hpp"
 #include "util/logger.hpp"
+#include "util/memory_statistics.hpp"
+#include "util/thread_key_storage.h"
 
 namespace LineairDB {
 class Database::Impl {
   friend class Transaction::Impl;
 
- public:
-  inline static Database::Impl* CurrentDBInstance;
+  // The working directories of the living instances. The instances must not
+  // share a directory, as they would overwrite the logs of each other.
+  inline static std::mutex WorkingDirectoriesLock;
+  inline static std::unordered_set<std::string> WorkingDirectories;
+  // The catalog of the tables in the working directory; see #PersistTables.
+  static constexpr const char* TablesFileName = "tables";
 
+ public:
   Impl(const Config& c = Config())
       : config_(c),
-        thread_pool_(c.max_thread),
+        thread_pool_(c.max_thread, c.enable_numa_aware_thread_pool,
+                     c.thread_pool_spin_duration_us),
         logger_(config_),
         callback_manager_(config_),
         epoch_framework_(c.epoch_duration_ms, EventsOnEpochIsUpdated()),
+        cold_store_(c.cold_storage_threshold_bytes == 0
+                        ? nullptr
+                        : std::make_unique<Index::ColdStore>(
+                              c.work_dir + "/cold_storage.dat")),
         index_(epoch_framework_, config_),
-        checkpoint_manager_(config_, index_, epoch_framework_) {
-    if (Database::Impl::CurrentDBInstance == nullptr) {
-      Database::Impl::CurrentDBInstance = this;
-      SPDLOG_INFO("LineairDB instance has been constructed.");
-    } else {
-      SPDLOG_ERROR(
-          "It is prohibited to allocate two LineairDB::Database instance at "
-          "the same time.");
-      exit(1);
+        checkpoint_manager_(config_, index_, epoch_framework_, thread_pool_),
+        log_applier_(index_, MakeTableResolver(), epoch_framework_,
+                     thread_pool_),
+        epoch_controller_(MakeEpochController(c)),
+        observed_commits_(0),
+        observed_bytes_(0),
+        last_epoch_update_(std::chrono::steady_clock::now()) {
+    {
+      std::lock_guard<std::mutex> guard(WorkingDirectoriesLock);
+      if (!WorkingDirectories.insert(config_.work_dir).second) {
+        SPDLOG_ERROR(
+            "It is prohibited to allocate two LineairDB::Database instances "
+            "with the same working directory {0} at the same time.",
+            config_.work_dir);
+        exit(1);
+      }
     }
+    SPDLOG_INFO("LineairDB instance has been constructed.");
     if (config_.enable_recovery) { Recovery(); }
     epoch_framework_.Start();
   }
@@ -69,97 +115,247 @@ class Database::Impl {
     epoch_framework_.Stop();
     while (!thread_pool_.IsEmpty()) { std::this_thread::yield(); }
     thread_pool_.Shutdown();
+    transaction_pool_.ForEach([](Transaction** tx) { delete *tx; });
     SPDLOG_DEBUG(
         "Epoch number and Durable epoch number are ended at {0}, and {1}, "
         "respectively.",
         epoch_framework_.GetGlobalEpoch(), logger_.GetDurableEpoch());
     SPDLOG_INFO("LineairDB instance has been destructed.");
-    assert(Database::Impl::CurrentDBInstance == this);
-    Database::Impl::CurrentDBInstance = nullptr;
+    std::lock_guard<std::mutex> guard(WorkingDirectoriesLock);
+    WorkingDirectories.erase(config_.work_dir);
   }
 
   void ExecuteTransaction(ProcedureType proc, CallbackType clbk,
-                          std::optional<CallbackType> prclbk) {
+                          std::optional<CallbackType> prclbk,
+                          TxType type                     = TxType::ReadWrite,
+                          std::optional<size_t> partition = std::nullopt) {
     for (;;) {
-      bool success = thread_pool_.Enqueue([&, transaction_procedure = proc,
-                                           callback       = clbk,
-                                           precommit_clbk = prclbk]() {
-        epoch_framework_.MakeMeOnline();
-        Transaction tx(this);
-
-        transaction_procedure(tx);
-        if (tx.IsAborted()) {
-          if (precommit_clbk)
-            precommit_clbk.value()(LineairDB::TxStatus::Aborted);
-          callback(LineairDB::TxStatus::Aborted);
-          epoch_framework_.MakeMeOffline();
-          return;
+      auto job = MakeTransactionJob(proc, clbk, prclbk, type);
+      const bool success =
+          partition ? thread_pool_.EnqueueToPartition(std::move(job),
+                                                      partition.value())
+                    : thread_pool_.Enqueue(std::move(job));
+      if (success) break;
+    }
+  }
+
+  void ExecuteTransactions(std::vector<Database::TransactionRequest>& batch) {
+    std::vector<ThreadPool::Job> jobs;
+    std::vector<std::optional<size_t>> partitions;
+    jobs.reserve(batch.size());
+    partitions.reserve(batch.size());
+    std::unique_ptr<InterleavedTransactions> group;
+    auto enqueue_group = [&]() {
+      if (!group) return;
+      partitions.emplace_back(group->partition);
+      jobs.emplace_back([this, g = std::move(group)]() {
+        index_.Prefetch(g->key_views.front());
+        for (size_t i = 0; i < g->jobs.size(); i++) {
+          if (i + 1 < g->jobs.size()) index_.Prefetch(g->key_views[i + 1]);
+          g->jobs[i]();
         }
+      });
+    };
 
-        bool committed = tx.Precommit();
-        if (committed) {
-          tx.tx_pimpl_->PostProcessing(TxStatus::Committed);
+    for (auto& request : batch) {
+      std::optional<size_t> partition;
+      if (request.partition_key.has_value()) {
+        partition =
+            std::hash<std::string_view>()(request.partition_key.value());
+      }
+      auto job = MakeTransactionJob(
+          std::move(request.proc), std::move(request.commit_clbk),
+          std::move(request.precommit_clbk), request.type);
+      if (request.prefetch_keys.empty()) {
+        jobs.emplace_back(std::move(job));
+        partitions.emplace_back(partition);
+        continue;
+      }
 
-          if (precommit_clbk.has_value()) {
-            precommit_clbk.value()(TxStatus::Committed);
-          }
-          const auto current_epoch = epoch_framework_.GetMyThreadLocalEpoch();
-          callback_manager_.Enqueue(std::move(callback), current_epoch);
-          if (config_.enable_logging) {
-            logger_.Enqueue(tx.tx_pimpl_->write_set_, current_epoch);
-          }
-        } else {
-          tx.tx_pimpl_->PostProcessing(TxStatus::Aborted);
-          if (precommit_clbk.has_value()) {
-            precommit_clbk.value()(TxStatus::Aborted);
-          }
-          callback(LineairDB::TxStatus::Aborted);
-        }
+      if (group && (group->partition != partition ||
+                    group->jobs.size() == InterleavedGroupSize)) {
+        enqueue_group();
+      }
+      if (!group) {
+        group            = std::make_unique<InterleavedTransactions>();
+        group->partition = partition;
+      }
+      group->jobs.emplace_back(std::move(job));
+      group->keys.emplace_back(std::move(request.prefetch_keys));
+      group->key_views.emplace_back(group->keys.back().begin(),
+                                    group->keys.back().end());
+    }
+    enqueue_group();
+    while (!thread_pool_.EnqueueBulk(jobs, partitions)) {}
+  }
+
+  const Database::ProcedureShape* KeepShape(
+      const Database::ProcedureShape& shape) {
+    std::lock_guard<std::mutex> guard(prepared_shapes_lock_);
+    return &prepared_shapes_.emplace_back(shape);
+  }
 
+  void ExecutePrepared(const Database::ProcedureShape& shape,
+                       Database::PreparedInvoker invoke, void (*procedure)(),
+                       const std::byte* parameters, size_t size,
+                       CallbackType clbk) {
+    std::array<std::byte, Database::MaxParameterSize> copy;
+    std::memcpy(copy.data(), parameters, size);
+    for (;;) {
+      auto job = [this, shape = &shape, invoke, procedure, copy,
+                  callback = clbk]() mutable {
+        std::optional<CallbackType> no_precommit_clbk;
+        epoch_framework_.MakeMeOnline();
+        Transaction& tx = AcquireTransaction(shape->type);
+        tx.tx_pimpl_->Prepare(shape);
+        auto prepared_procedure = [&](Transaction& tx) {
+          invoke(tx, procedure, copy.data());
+        };
+        ProcessTransaction(tx, prepared_procedure, callback,
+                           no_precommit_clbk);
         epoch_framework_.MakeMeOffline();
-      });
-      if (success) break;
+      };
+      static_assert(sizeof(job) <= ThreadPool::JobCapacity,
+                    "a prepared transaction job should not allocate");
+      if (thread_pool_.Enqueue(std::move(job))) break;
     }
   }
 
-  Transaction& BeginTransaction() {
+  Transaction& BeginTransaction(TxType type = TxType::ReadWrite) {
     epoch_framework_.MakeMeOnline();
-    return *(new Transaction(this));
+    return AcquireTransaction(type);
   }
 
   bool EndTransaction(Transaction& tx, CallbackType clbk) {
     if (tx.IsAborted()) {
       clbk(TxStatus::Aborted);
-      delete &tx;
       epoch_framework_.MakeMeOffline();
       return false;
     }
 
     bool committed = tx.Precommit();
     if (committed) {
-      tx.tx_pimpl_->PostProcessing(TxStatus::Committed);
-
-      tx.tx_pimpl_->current_status_ = TxStatus::Committed;
-      const auto current_epoch      = epoch_framework_.GetMyThreadLocalEpoch();
-      callback_manager_.Enqueue(std::move(clbk), current_epoch, true);
-
-      if (config_.enable_logging) {
-        logger_.Enqueue(tx.tx_pimpl_->write_set_, current_epoch, true);
-      }
-
+      CompleteCommit(tx, std::move(clbk));
     } else {
       tx.tx_pimpl_->PostProcessing(TxStatus::Aborted);
       clbk(TxStatus::Aborted);
     }
     epoch_framework_.MakeMeOffline();
+    return committed;
+  }
 
-    if (config_.enable_checkpointing) {
-      auto checkpoint_completed =
-          checkpoint_manager_.GetCheckpointCompletedEpoch();
-      logger_.TruncateLogs(checkpoint_completed);
+  /**
+   * @brief
+   * Same as #BeginTransaction, but the transaction is committed by the phases
+   * of a commit coordinated with the other databases: #LockForCommit and
+   * #ValidateForCommit in all the participants, and then #EndCoordinated.
+   * @see ShardedDatabase
+   */
+  Transaction& BeginCoordinatedTransaction() {
+    auto& tx                   = BeginTransaction(TxType::ReadWrite);
+    tx.tx_pimpl_->coordinated_ = true;
+    return tx;
+  }
+  bool LockForCommit(Transaction& tx) { return tx.tx_pimpl_->LockForCommit(); }
+  bool ValidateForCommit(Transaction& tx) {
+    return tx.tx_pimpl_->ValidateForCommit();
+  }
+  /**
+   * @brief Commits `tx` if `commit`, or aborts it, and terminates it.
+   * @param[out] clbk it accepts the result only if `tx` is committed.
+   */
+  void EndCoordinated(Transaction& tx, const bool commit, CallbackType clbk) {
+    if (commit) {
+      tx.tx_pimpl_->Install();
+      CompleteCommit(tx, std::move(clbk));
+    } else {
+      tx.tx_pimpl_->Abort();
     }
-    delete &tx;
-    return committed;
+    epoch_framework_.MakeMeOffline();
+  }
+
+  void BulkLoad(const std::function<void(const BulkLoadWriter&)>& load) {
+    Fence();
+    // Loaded items are regarded as versions written in the current epoch;
+    // any transaction after this method overwrites them with newer ids.
+    const auto epoch = epoch_framework_.GetGlobalEpoch();
+    const TransactionId tid(epoch, 0);
+    load([&](std::string_view key, const std::byte value[], size_t size) {
+      DataItem item(value, size, tid);
+      if (!secondary_indexes_.empty()) {
+        const auto* before = index_.Get(key);
+        for (auto& secondary_index : secondary_indexes_) {
+          BulkPutEntry(*secondary_index, key, before, item);
+        }
+      }
+      index_.BulkPut(key, std::move(item));
+    });
+    if (config_.enable_logging || config_.enable_checkpointing) {
+      checkpoint_manager_.WriteCheckpoint(epoch);
+    }
+    SPDLOG_INFO("Bulk loading is completed.");
+  }
+
+  bool CreateTable(const std::string& name, const Config& table_config) {
+    Fence();
+    if (!Index::Table::IsValidName(name) || GetTable(name) != nullptr) {
+      return false;
+    }
+    AddTable(name, table_config);
+    if (config_.enable_logging || config_.enable_checkpointing) {
+      PersistTables();
+    }
+    SPDLOG_INFO("A table {0} is created.", name);
+    return true;
+  }
+  Index::Table* GetTable(const std::string_view name) {
+    for (auto& table : tables_) {
+      if (table->GetName() == name) return table.get();
+    }
+    return nullptr;
+  }
+
+  bool CreateSecondaryIndex(const std::string& name,
+                            Database::SecondaryKeyExtractor extractor) {
+    Fence();
+    for (auto& secondary_index : secondary_indexes_) {
+      if (secondary_index->GetName() == name) return false;
+    }
+    auto secondary_index = std::make_unique<Index::SecondaryIndex>(
+        name, epoch_framework_, config_, std::move(extractor));
+    index_.ForEach([&](std::string_view key, DataItem& item) {
+      BulkPutEntry(*secondary_index, key, nullptr, item);
+      return true;
+    });
+    secondary_indexes_.emplace_back(std::move(secondary_index));
+    SPDLOG_INFO("A secondary index {0} is created.", name);
+    return true;
+  }
+  const std::vector<std::unique_ptr<Index::SecondaryIndex>>&
+  GetSecondaryIndexes() const {
+    return secondary_indexes_;
+  }
+  Index::SecondaryIndex* GetSecondaryIndex(const std::string_view name) {
+    for (auto& secondary_index : secondary_indexes_) {
+      if (secondary_index->GetName() == name) return secondary_index.get();
+    }
+    return nullptr;
+  }
+
+  void StartLogShipping(LogShipperType shipper) {
+    log_shipper_.Start(std::move(shipper));
+  }
+  bool ApplyReplicatedLogs(const std::string& batch) {
+    if (!config_.replica) {
+      SPDLOG_ERROR(
+          "The replicated logs are applied to a database which is not a "
+          "replica.");
+      exit(1);
+    }
+    return log_applier_.Apply(batch);
+  }
+  EpochNumber GetReplicatedEpoch() const {
+    return log_applier_.GetAppliedEpoch();
   }
 
   void RequestCallbacks() {
@@ -182,9 +378,26 @@ class Database::Impl {
   // NOTE: Called by a special thread managed by EpochFramework.
   std::function<void(EpochNumber)> EventsOnEpochIsUpdated() {
     return [&](EpochNumber old_epoch) {
-      // Logging
-      if (config_.enable_logging) {
+      if (config_.enable_adaptive_epoch) AdaptEpochDuration();
+
+      if (config_.enable_logging &&
+          config_.enable_eager_durability_notification) {
+        // The last worker that flushes the logs notifies the committers.
+        auto flushing = std::make_shared<std::atomic<size_t>>(
+            thread_pool_.GetPoolSize());
+        thread_pool_.EnqueueForAllThreads([&, old_epoch, flushing]() {
+          logger_.FlushLogs(old_epoch);
+          if (flushing->fetch_sub(1) != 1) return;
+          EpochNumber durable_epoch = logger_.SyncDurableEpoch();
+          ShipLogs(durable_epoch);
+          thread_pool_.EnqueueForAllThreads([&, durable_epoch] {
+            callback_manager_.ExecuteCallbacks(durable_epoch);
+          });
+        });
+      } else if (config_.enable_logging) {
+        // Logging
         EpochNumber durable_epoch = logger_.FlushDurableEpoch();
+        ShipLogs(durable_epoch);
         thread_pool_.EnqueueForAllThreads(
             [&, old_epoch]() { logger_.FlushLogs(old_epoch); });
         thread_pool_.EnqueueForAllThreads([&, durable_epoch] {
@@ -192,21 +405,60 @@ class Database::Impl {
         });
       }
 
-      // Execute Callbacks
-      thread_pool_.EnqueueForAllThreads(
-          [&, old_epoch]() { callback_manager_.ExecuteCallbacks(old_epoch); });
+      if (!config_.enable_logging) ShipLogs(old_epoch);
+      if (!config_.enable_logging ||
+          !config_.enable_eager_durability_notification) {
+        // Execute Callbacks
+        thread_pool_.EnqueueForAllThreads([&, old_epoch]() {
+          callback_manager_.ExecuteCallbacks(old_epoch);
+        });
+      }
 
-      if (config_.enable_checkpointing) {
+      // A worker truncates the logs of all threads, including the ones of
+      // the callee threads of #EndTransaction, so that no transaction waits
+      // for the removal of the log files.
+      if (config_.enable_checkpointing && !truncating_.exchange(true)) {
         auto checkpoint_completed =
             checkpoint_manager_.GetCheckpointCompletedEpoch();
-
-        thread_pool_.EnqueueForAllThreads([&, checkpoint_completed]() {
+        const bool enqueued = thread_pool_.Enqueue([&, checkpoint_completed]() {
           logger_.TruncateLogs(checkpoint_completed);
+          truncating_.store(false);
+        });
+        if (!enqueued) truncating_.store(false);
+      }
+
+      if (0 < pending_tombstones_.load() && !reclaiming_.exchange(true)) {
+        const bool enqueued = thread_pool_.Enqueue([&]() {
+          ReclaimTombstones();
+          reclaiming_.store(false);
         });
+        if (!enqueued) reclaiming_.store(false);
+      }
+
+      if (cold_store_ != nullptr && !evicting_.exchange(true)) {
+        const size_t threshold = config_.cold_storage_threshold_bytes;
+        const size_t values = MemoryStatistics::Get(MemoryStatistics::Values);
+        const bool enqueued = threshold < values &&
+                              thread_pool_.Enqueue([&, threshold, values]() {
+                                index_.EvictColdValues(*cold_store_,
+                                                       values - threshold);
+                                evicting_.store(false);
+                              });
+        if (!enqueued) evicting_.store(false);
       }
     };
   }
 
+  /**
+   * @brief Ships the logs of the epochs before `stable_epoch` to the
+   * replicas, on a worker of the thread pool.
+   */
+  void ShipLogs(const EpochNumber stable_epoch) {
+    if (!log_shipper_.IsEnabled()) return;
+    thread_pool_.Enqueue(
+        [&, stable_epoch]() { log_shipper_.Ship(stable_epoch); });
+  }
+
   void WaitForCheckpoint() {
     const auto start = checkpoint_manager_.GetCheckpointCompletedEpoch();
     Util::RetryWithExponentialBackoff([&]() {
@@ -215,11 +467,383 @@ class Database::Impl {
     });
   }
 
-  bool IsNeedToCheckpointing(const EpochNumber epoch) {
-    return checkpoint_manager_.IsNeedToCheckpointing(epoch);
+  Statistics GetStatistics() {
+    Statistics statistics;
+    index_.GetStatistics(statistics);
+    statistics.memory.values = MemoryStatistics::Get(MemoryStatistics::Values);
+    statistics.memory.stable_versions =
+        MemoryStatistics::Get(MemoryStatistics::StableVersions);
+    if (config_.enable_logging) {
+      statistics.pending_log_bytes  = logger_.GetPendingLogBytes();
+      statistics.memory.log_buffers = statistics.pending_log_bytes;
+    }
+    statistics.pending_callbacks = callback_manager_.GetPendingCallbacks();
+    if (cold_store_ != nullptr) {
+      statistics.cold_storage_bytes = cold_store_->GetBytes();
+    }
+    statistics.memory.callback_queues =
+        statistics.pending_callbacks * sizeof(CallbackType);
+    Instrumentation::Collect(statistics);
+    return statistics;
+  }
+
+  EpochNumber GetCheckpointEpochToSave(const EpochNumber epoch) {
+    return checkpoint_manager_.GetCheckpointEpochToSave(epoch);
   }
 
  private:
+  // Counts the commit and its written bytes for AdaptiveEpochController.
+  void CountCommit(const WriteSetType& write_set) {
+    if (!config_.enable_adaptive_epoch) return;
+    size_t bytes = 0;
+    for (auto& snapshot : write_set) {
+      bytes += snapshot.key.size() + snapshot.data_item_copy.buffer.size;
+    }
+    // NOTE: only the owner thread updates the counters.
+    auto* statistics = commit_statistics_.Get();
+    statistics->commits.store(statistics->commits.load() + 1,
+                              std::memory_order_relaxed);
+    statistics->bytes.store(statistics->bytes.load() + bytes,
+                            std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief
+   * Puts the entry of the row into `secondary_index`, replacing the entry for
+   * the row `before`, if any.
+   * @pre No transaction is running concurrently.
+   */
+  void BulkPutEntry(Index::SecondaryIndex& secondary_index,
+                    const std::string_view key, const DataItem* before,
+                    const DataItem& item) {
+    auto& table = secondary_index.GetTable();
+    if (before != nullptr) {
+      auto secondary_key = secondary_index.Extract(key, *before);
+      if (secondary_key.has_value()) {
+        table.BulkPut(Index::SecondaryIndex::EntryKey(*secondary_key, key),
+                      DataItem());
+      }
+    }
+    auto secondary_key = secondary_index.Extract(key, item);
+    if (!secondary_key.has_value()) return;
+    table.BulkPut(Index::SecondaryIndex::EntryKey(*secondary_key, key),
+                  DataItem(Index::SecondaryIndex::EntryValue,
+                           sizeof(Index::SecondaryIndex::EntryValue),
+                           item.transaction_id.load()));
+  }
+
+  /**
+   * @brief
+   * Adds the table `name`, configured by the index configurations of
+   * `table_config`; see Database::CreateTable.
+   */
+  Index::Table& AddTable(const std::string& name, const Config& table_config) {
+    Config config                = config_;
+    config.index_structure       = table_config.index_structure;
+    config.rehash_threshold      = table_config.rehash_threshold;
+    config.hash_index_probing    = table_config.hash_index_probing;
+    config.expected_record_count = table_config.expected_record_count;
+    auto& table = *tables_.emplace_back(
+        std::make_unique<Index::Table>(name, epoch_framework_, config));
+    checkpoint_manager_.AddTable(table);
+    return table;
+  }
+  Recovery::LogApplier::TableResolver MakeTableResolver() {
+    return [&](const std::string_view name) -> Index::ConcurrentTable* {
+      auto* table = GetTable(name);
+      return table != nullptr ? &table->GetIndex() : nullptr;
+    };
+  }
+
+  /**
+   * @brief
+   * Saves the catalog of the tables into TablesFileName, a line per table:
+   * its name, index_structure, rehash_threshold, hash_index_probing and
+   * expected_record_count separated by tabs.
+   */
+  void PersistTables() {
+    const auto filename         = config_.work_dir + "/" + TablesFileName;
+    const auto working_filename = filename + ".working";
+    {
+      std::ofstream file(working_filename, std::ios_base::trunc);
+      file.precision(std::numeric_limits<double>::max_digits10);
+      for (auto& table : tables_) {
+        const auto& c = table->GetConfig();
+        file << table->GetName() << '\t' << c.index_structure << '\t'
+             << c.rehash_threshold << '\t' << c.hash_index_probing << '\t'
+             << c.expected_record_count << '\n';
+      }
+      file.flush();
+      if (!file) {
+        SPDLOG_ERROR("Durability Error: fail to write the tables into {0}.",
+                     working_filename);
+        exit(1);
+      }
+    }
+    // NOTE POSIX ensures that rename syscall provides atomicity
+    if (std::rename(working_filename.c_str(), filename.c_str()) != 0) {
+      SPDLOG_ERROR("Durability Error: fail to rename the tables {0}. "
+                   "errno: {1}",
+                   filename, errno);
+      exit(1);
+    }
+  }
+  /**
+   * @brief Creates the tables in the catalog; see #PersistTables.
+   */
+  void RecoverTables() {
+    std::ifstream file(config_.work_dir + "/" + TablesFileName);
+    std::string name;
+    int index_structure, hash_index_probing;
+    Config table_config;
+    while (file >> name >> index_structure >> table_config.rehash_threshold >>
+           hash_index_probing >> table_config.expected_record_count) {
+      table_config.index_structure =
+          static_cast<Config::IndexStructure>(index_structure);
+      table_config.hash_index_probing =
+          static_cast<Config::HashIndexProbing>(hash_index_probing);
+      if (!Index::Table::IsValidName(name) || GetTable(name) != nullptr) {
+        SPDLOG_ERROR("  Stop recovery procedure: the tables are broken.");
+        exit(EXIT_FAILURE);
+      }
+      AddTable(name, table_config);
+      SPDLOG_DEBUG("  Table {0} is recovered.", name);
+    }
+  }
+
+  /**
+   * @brief Remembers the keys of the tombstones that a transaction committed
+   * in `epoch` has written, for #ReclaimTombstones.
+   */
+  void RememberTombstones(const WriteSetType& write_set,
+                          const EpochNumber epoch) {
+    Tombstones* tombstones = nullptr;
+    for (auto& snapshot : write_set) {
+      if (snapshot.data_item_copy.IsInitialized()) continue;
+      if (tombstones == nullptr) {
+        tombstones = tombstones_.Get();
+        tombstones->lock.lock();
+      }
+      if (snapshot.secondary_index != nullptr) {
+        tombstones->keys.push_back(
+            {snapshot.key, epoch, &snapshot.secondary_index->GetTable()});
+      } else {
+        auto* table = snapshot.table != nullptr ? &snapshot.table->GetIndex()
+                                                : &index_;
+        const auto key = Index::Table::DecodeKey(snapshot.key).second;
+        tombstones->keys.push_back({std::string(key), epoch, table});
+      }
+      pending_tombstones_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (tombstones != nullptr) tombstones->lock.unlock();
+  }
+  void RememberTombstone(const std::string_view key, const EpochNumber epoch,
+                         Index::ConcurrentTable& table) {
+    auto* tombstones = tombstones_.Get();
+    std::lock_guard<std::mutex> guard(tombstones->lock);
+    tombstones->keys.push_back({std::string(key), epoch, &table});
+    pending_tombstones_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /**
+   * @brief
+   * Removes the tombstones from the index and frees their data items. A
+   * tombstone written in epoch `e` is removed when every running transaction
+   * has started after `e`, and its snapshot reads (see
+   * EpochFramework::GetCompletedEpoch) no longer need the deleted version.
+   * With checkpointing, the tombstone also has to be in a completed
+   * checkpoint: an incremental one records it to hide the deleted version in
+   * the former checkpoint files, and the logs before the checkpoint are
+   * truncated.
+   * @note Called by a worker of the thread pool, one at a time.
+   */
+  void ReclaimTombstones() {
+    EpochNumber reclaimable = std::min(epoch_framework_.GetSmallestEpoch(),
+                                       epoch_framework_.GetGlobalEpoch());
+    reclaimable = EpochFramework::GetCompletedEpoch(reclaimable);
+    if (config_.enable_checkpointing) {
+      reclaimable = std::min(reclaimable,
+                             checkpoint_manager_.GetCheckpointCompletedEpoch());
+    }
+
+    std::vector<Tombstone> keys;
+    tombstones_.ForEach([&](Tombstones* tombstones) {
+      std::lock_guard<std::mutex> guard(tombstones->lock);
+      // the keys of each thread are in the order of the epochs.
+      auto& thread_keys = tombstones->keys;
+      auto end          = std::find_if(
+          thread_keys.begin(), thread_keys.end(),
+          [&](const auto& entry) { return reclaimable <= entry.epoch; });
+      std::move(thread_keys.begin(), end, std::back_inserter(keys));
+      thread_keys.erase(thread_keys.begin(), end);
+    });
+    if (keys.empty()) return;
+
+    epoch_framework_.MakeMeOnline();
+    std::vector<Tombstone> retries;
+    for (auto& tombstone : keys) {
+      if (!tombstone.table->EraseTombstone(tombstone.key, tombstone.epoch)) {
+        retries.emplace_back(std::move(tombstone));
+      }
+    }
+    epoch_framework_.MakeMeOffline();
+    pending_tombstones_.fetch_sub(keys.size() - retries.size(),
+                                  std::memory_order_relaxed);
+    if (retries.empty()) return;
+    auto* tombstones = tombstones_.Get();
+    std::lock_guard<std::mutex> guard(tombstones->lock);
+    // the retries are older than the keys of this thread.
+    tombstones->keys.insert(tombstones->keys.begin(),
+                            std::make_move_iterator(retries.begin()),
+                            std::make_move_iterator(retries.end()));
+  }
+
+  /**
+   * @brief Lets the controller choose the duration of the next epoch from
+   * the commits since the previous epoch update.
+   * @note Called by the epoch thread.
+   */
+  void AdaptEpochDuration() {
+    uint64_t commits = 0;
+    uint64_t bytes   = 0;
+    commit_statistics_.ForEach([&](CommitStatistics* statistics) {
+      commits += statistics->commits.load(std::memory_order_relaxed);
+      bytes += statistics->bytes.load(std::memory_order_relaxed);
+    });
+    const auto now     = std::chrono::steady_clock::now();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        now - last_epoch_update_);
+    epoch_framework_.SetEpochDuration(epoch_controller_.Observe(
+        commits - observed_commits_, bytes - observed_bytes_,
+        elapsed.count()));
+    observed_commits_  = commits;
+    observed_bytes_    = bytes;
+    last_epoch_update_ = now;
+  }
+
+  static AdaptiveEpochController MakeEpochController(const Config& c) {
+    constexpr uint64_t Millisecond = 1000 * 1000;
+    // See Config::target_commit_latency_ms.
+    const size_t epochs_to_commit =
+        c.enable_logging && !c.enable_eager_durability_notification ? 2 : 1;
+    const size_t max_epoch_duration_ms = std::min(
+        c.max_epoch_duration_ms, c.target_commit_latency_ms / epochs_to_commit);
+    return AdaptiveEpochController(c.epoch_duration_ms * Millisecond,
+                                   c.min_epoch_duration_ms * Millisecond,
+                                   max_epoch_duration_ms * Millisecond,
+                                   c.max_log_bytes_per_epoch);
+  }
+
+  /**
+   * @brief
+   * Transactions of #ExecuteTransactions with prefetch keys, which are
+   * processed in turn as a single job.
+   */
+  struct InterleavedTransactions {
+    std::optional<size_t> partition;
+    std::vector<ThreadPool::Job> jobs;
+    std::vector<std::vector<std::string>> keys;
+    std::vector<std::vector<std::string_view>> key_views;
+  };
+  static constexpr size_t InterleavedGroupSize = 8;
+
+  ThreadPool::Job MakeTransactionJob(ProcedureType proc, CallbackType clbk,
+                                     std::optional<CallbackType> prclbk,
+                                     TxType type) {
+    auto job = [this, transaction_procedure = std::move(proc),
+                callback = std::move(clbk), precommit_clbk = std::move(prclbk),
+                type]() mutable {
+      epoch_framework_.MakeMeOnline();
+      Transaction& tx = AcquireTransaction(type);
+      ProcessTransaction(tx, transaction_procedure, callback, precommit_clbk);
+      epoch_framework_.MakeMeOffline();
+    };
+    static_assert(sizeof(job) <= ThreadPool::JobCapacity,
+                  "a transaction job should not allocate");
+    return job;
+  }
+
+  /**
+   * @brief Runs `transaction_procedure` on `tx` and terminates `tx`.
+   * @pre The callee thread is online.
+   */
+  template <typename Procedure>
+  void ProcessTransaction(Transaction& tx, Procedure& transaction_procedure,
+                          CallbackType& callback,
+                          std::optional<CallbackType>& precommit_clbk) {
+    transaction_procedure(tx);
+    if (tx.IsAborted()) {
+      if (precommit_clbk) precommit_clbk.value()(LineairDB::TxStatus::Aborted);
+      callback(LineairDB::TxStatus::Aborted);
+      return;
+    }
+
+    bool committed = tx.Precommit();
+    if (committed) {
+      tx.tx_pimpl_->PostProcessing(TxStatus::Committed);
+
+      if (precommit_clbk.has_value()) {
+        precommit_clbk.value()(TxStatus::Committed);
+      }
+      const auto current_epoch = epoch_framework_.GetMyThreadLocalEpoch();
+      CountCommit(tx.tx_pimpl_->write_set_);
+      RememberTombstones(tx.tx_pimpl_->write_set_, current_epoch);
+      RememberTombstones(tx.tx_pimpl_->index_write_set_, current_epoch);
+      callback_manager_.Enqueue(std::move(callback), current_epoch);
+      if (log_shipper_.IsEnabled()) {
+        log_shipper_.Enqueue(tx.tx_pimpl_->write_set_, current_epoch);
+      }
+      if (config_.enable_logging && !tx.tx_pimpl_->write_set_.empty()) {
+        logger_.Enqueue(tx.tx_pimpl_->write_set_, current_epoch);
+      }
+    } else {
+      tx.tx_pimpl_->PostProcessing(TxStatus::Aborted);
+      if (precommit_clbk.has_value()) {
+        precommit_clbk.value()(TxStatus::Aborted);
+      }
+      callback(LineairDB::TxStatus::Aborted);
+    }
+  }
+
+  /**
+   * @brief Completes the commit of a precommitted transaction of the callee.
+   */
+  void CompleteCommit(Transaction& tx, CallbackType&& clbk) {
+    tx.tx_pimpl_->PostProcessing(TxStatus::Committed);
+
+    tx.tx_pimpl_->current_status_ = TxStatus::Committed;
+    const auto current_epoch      = epoch_framework_.GetMyThreadLocalEpoch();
+    CountCommit(tx.tx_pimpl_->write_set_);
+    RememberTombstones(tx.tx_pimpl_->write_set_, current_epoch);
+    RememberTombstones(tx.tx_pimpl_->index_write_set_, current_epoch);
+    callback_manager_.Enqueue(std::move(clbk), current_epoch, true);
+    if (log_shipper_.IsEnabled()) {
+      log_shipper_.Enqueue(tx.tx_pimpl_->write_set_, current_epoch);
+    }
+
+    if (config_.enable_logging && !tx.tx_pimpl_->write_set_.empty()) {
+      logger_.Enqueue(tx.tx_pimpl_->write_set_, current_epoch, true);
+    }
+  }
+
+  /**
+   * @brief Returns the transaction object of the callee thread.
+   * Each thread reuses one object for all of its transactions, so that
+   * starting a transaction does not allocate the object, its read/write sets
+   * and the concurrency control state in the steady state.
+   * @pre The callee thread has no running transaction, and it is online.
+   */
+  Transaction& AcquireTransaction(const TxType type) {
+    auto** tx = transaction_pool_.Get();
+    if (*tx == nullptr) {
+      *tx = new Transaction(this);
+    } else {
+      (*tx)->tx_pimpl_->Reset();
+    }
+    (*tx)->tx_pimpl_->Begin(type);
+    return **tx;
+  }
+
   void Recovery() {
     SPDLOG_INFO("Start recovery process");
     // Start recovery from logfiles
@@ -233,19 +857,98 @@ class Database::Impl {
 
     thread_pool_.WaitForQueuesToBecomeEmpty();
 
-    epoch_framework_.MakeMeOnline();
-    auto& local_epoch = epoch_framework_.GetMyThreadLocalEpoch();
-    local_epoch       = durable_epoch;
+    highest_epoch = std::max(highest_epoch, durable_epoch);
+    // The tables are created before their rows are recovered.
+    RecoverTables();
+    // The data items recovered from a checkpoint image refer to the values in
+    // the mapping, which are read from the disk on demand.
+    checkpoint_image_ = logger_.OpenCheckpointImage();
+    for (auto& table : tables_) {
+      table_images_.emplace_back(logger_.OpenCheckpointImage(table->GetName()));
+    }
+    auto recovery_sets =
+        logger_.GetRecoverySetFromLogs(durable_epoch, thread_pool_);
+
+    const size_t workers = std::max<size_t>(1, thread_pool_.GetPoolSize());
+    std::vector<EpochNumber> highest_epochs(workers, 0);
+    auto recover = [&](const std::function<void(EpochNumber&)>& f) {
+      std::atomic<size_t> next_worker(0);
+      [[maybe_unused]] auto enqueued = thread_pool_.EnqueueForAllThreads([&]() {
+        epoch_framework_.MakeMeOnline();
+        auto& local_epoch = epoch_framework_.GetMyThreadLocalEpoch();
+        local_epoch       = durable_epoch;
+        f(highest_epochs[next_worker.fetch_add(1)]);
+        epoch_framework_.MakeMeOffline();
+      });
+      assert(enqueued);
+      thread_pool_.WaitForQueuesToBecomeEmpty();
+    };
 
-    highest_epoch       = std::max(highest_epoch, durable_epoch);
-    auto&& recovery_set = logger_.GetRecoverySetFromLogs(durable_epoch);
-    for (auto& entry : recovery_set) {
-      highest_epoch = std::max(
-          highest_epoch, entry.data_item_copy.transaction_id.load().epoch);
+    auto recover_image = [&](const Recovery::CheckpointImage& image,
+                             Index::ConcurrentTable& index) {
+      constexpr size_t ChunkSize = 4096;
+      const size_t image_size    = image.size();
+      std::atomic<size_t> next_entry(0);
+      recover([&](EpochNumber& my_highest_epoch) {
+        for (size_t begin;
+             (begin = next_entry.fetch_add(ChunkSize)) < image_size;) {
+          const size_t end = std::min(begin + ChunkSize, image_size);
+          for (size_t i = begin; i < end; i++) {
+            const auto entry = image[i];
+            DataItem item;
+            item.transaction_id.store(entry.tid);
+            item.initialized = true;
+            item.buffer.Refer(
+                reinterpret_cast<const std::byte*>(entry.value.data()),
+                entry.value.size());
+            my_highest_epoch = std::max(my_highest_epoch, entry.tid.epoch);
+            index.Put(entry.key, std::move(item));
+          }
+        }
+      });
+    };
+    if (checkpoint_image_ != nullptr) recover_image(*checkpoint_image_, index_);
+    for (size_t i = 0; i < tables_.size(); i++) {
+      if (table_images_[i] == nullptr) continue;
+      recover_image(*table_images_[i], tables_[i]->GetIndex());
+    }
 
-      index_.Put(entry.key, std::move(entry.data_item_copy));
+    // The partitions have no key in common; the workers insert them into the
+    // index in parallel. A version in the logs replaces the one in the
+    // checkpoint image only if it is newer.
+    const size_t partitions = recovery_sets.size();
+    std::atomic<size_t> next_partition(0);
+    recover([&](EpochNumber& my_highest_epoch) {
+      for (size_t p; (p = next_partition.fetch_add(1)) < partitions;) {
+        for (auto& [encoded_key, version] : recovery_sets[p]) {
+          const auto [table_name, key] = Index::Table::DecodeKey(encoded_key);
+          auto* index = table_name.empty() ? &index_ : nullptr;
+          if (index == nullptr) {
+            auto* table = GetTable(table_name);
+            // the rows of a table missing in the catalog are not recovered.
+            if (table == nullptr) continue;
+            index = &table->GetIndex();
+          }
+          my_highest_epoch = std::max(my_highest_epoch, version.tid.epoch);
+          const auto* value =
+              reinterpret_cast<const std::byte*>(version.value.data());
+          auto* item = index->Get(key);
+          // An empty value is a tombstone; see Transaction::Delete.
+          const bool is_tombstone = version.value.empty();
+          if (item == nullptr) {
+            if (is_tombstone) continue;
+            index->Put(key, DataItem(value, version.value.size(), version.tid));
+          } else if (item->transaction_id.load() < version.tid) {
+            item->Reset(value, version.value.size(), version.tid);
+            if (is_tombstone) RememberTombstone(key, version.tid.epoch, *index);
+          }
+        }
+        Recovery::Logger::RecoverySet().swap(recovery_sets[p]);
+      }
+    });
+    for (auto epoch : highest_epochs) {
+      highest_epoch = std::max(highest_epoch, epoch);
     }
-    epoch_framework_.MakeMeOffline();
 
     SPDLOG_DEBUG("  Global epoch is resumed from {0}", highest_epoch);
     epoch_framework_.SetGlobalEpoch(highest_epoch);
@@ -258,11 +961,51 @@ class Database::Impl {
   Recovery::Logger logger_;
   Callback::CallbackManager callback_manager_;
   EpochFramework epoch_framework_;
+  // NOTE: it outlives index_, whose data items may refer to the mapping.
+  std::unique_ptr<Recovery::CheckpointImage> checkpoint_image_;
+  // NOTE: it outlives index_ as well; see Config::cold_storage_threshold_bytes.
+  std::unique_ptr<Index::ColdStore> cold_store_;
   Index::ConcurrentTable index_;
+  std::vector<std::unique_ptr<Index::SecondaryIndex>> secondary_indexes_;
+  // NOTE: they outlive tables_, as checkpoint_image_ outlives index_.
+  std::vector<std::unique_ptr<Recovery::CheckpointImage>> table_images_;
+  std::vector<std::unique_ptr<Index::Table>> tables_;
   Recovery::CPRManager checkpoint_manager_;
+  Recovery::LogShipper log_shipper_;
+  Recovery::LogApplier log_applier_;
+  ThreadKeyStorage<Transaction*> transaction_pool_;
+  // The shapes of the prepared procedures; see Database::Prepare.
+  std::mutex prepared_shapes_lock_;
+  std::deque<Database::ProcedureShape> prepared_shapes_;
+
+  struct CommitStatistics {
+    std::atomic<uint64_t> commits{0};
+    std::atomic<uint64_t> bytes{0};
+  };
+  ThreadKeyStorage<CommitStatistics> commit_statistics_;
+
+  // The keys of the committed tombstones and their epochs; the workers of
+  // the thread pool remove them from the index. See #ReclaimTombstones.
+  struct Tombstone {
+    std::string key;
+    EpochNumber epoch;
+    Index::ConcurrentTable* table;  // of a table or of a secondary index
+  };
+  struct Tombstones {
+    std::mutex lock;
+    std::vector<Tombstone> keys;
+  };
+  ThreadKeyStorage<Tombstones> tombstones_;
+  std::atomic<size_t> pending_tombstones_{0};
+  std::atomic<bool> reclaiming_{false};
+  std::atomic<bool> truncating_{false};
+  std::atomic<bool> evicting_{false};
+  // The followings are used only by the epoch thread.
+  AdaptiveEpochController epoch_controller_;
+  uint64_t observed_commits_;
+  uint64_t observed_bytes_;
+  std::chrono::steady_clock::time_point last_epoch_update_;
 };
 
-// Database::Impl* Database::Impl::CurrentDBInstance = nullptr;
-
 }  // namespace LineairDB
 #endif /** LINEAIRDB_DATABASE_IMPL_H **/
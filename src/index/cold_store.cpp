@@ -0,0 +1,84 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "cold_store.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <util/logger.hpp>
+
+namespace LineairDB {
+namespace Index {
+
+ColdStore::ColdStore(const std::string& filename)
+    : filename_(filename), tail_(SegmentSize), bytes_(0) {
+  fd_ = open(filename_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    SPDLOG_ERROR("fail to open the cold storage {0}. errno: {1}", filename_,
+                 errno);
+    exit(1);
+  }
+}
+
+ColdStore::~ColdStore() {
+  for (auto* segment : segments_) munmap(segment, SegmentSize);
+  close(fd_);
+  std::remove(filename_.c_str());
+}
+
+const std::byte* ColdStore::Append(const std::byte* value,
+                                   const size_t size) {
+  if (SegmentSize < size) return nullptr;
+  std::lock_guard<std::mutex> guard(lock_);
+  if (SegmentSize < tail_ + size) {
+    if (!segments_.empty()) {
+      // The values in a full segment are cold; they are written back and
+      // their pages are freed without waiting for memory pressure.
+#if defined(MADV_PAGEOUT)
+      madvise(segments_.back(), SegmentSize, MADV_PAGEOUT);
+#else
+      msync(segments_.back(), SegmentSize, MS_ASYNC);
+#endif
+    }
+    const off_t offset = segments_.size() * SegmentSize;
+    void* segment      = MAP_FAILED;
+    if (ftruncate(fd_, offset + SegmentSize) == 0) {
+      segment = mmap(nullptr, SegmentSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, fd_, offset);
+    }
+    if (segment == MAP_FAILED) {
+      SPDLOG_ERROR("fail to extend the cold storage {0}. errno: {1}",
+                   filename_, errno);
+      exit(1);
+    }
+    madvise(segment, SegmentSize, MADV_RANDOM);
+    segments_.push_back(static_cast<std::byte*>(segment));
+    tail_ = 0;
+  }
+  std::byte* copy = segments_.back() + tail_;
+  std::memcpy(copy, value, size);
+  tail_ += size;
+  bytes_.fetch_add(size, std::memory_order_relaxed);
+  return copy;
+}
+
+}  // namespace Index
+}  // namespace LineairDB
@@ -0,0 +1,65 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef LINEAIRDB_INDEX_COLD_STORE_H
+#define LINEAIRDB_INDEX_COLD_STORE_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace LineairDB {
+namespace Index {
+
+/**
+ * @brief
+ * An append-only file of the values evicted from memory, mapped segment by
+ * segment. The data items refer to the values in the mapping (see
+ * DataBuffer::Refer), and thus the operating system writes them back and
+ * reads them again on demand, as it does for a mapped checkpoint image.
+ * The file is only a cache: it is removed at the destruction, and the space
+ * of the values overwritten later is not reused.
+ */
+class ColdStore {
+ public:
+  static constexpr size_t SegmentSize = 64 << 20;
+
+  ColdStore(const std::string& filename);
+  ~ColdStore();
+  ColdStore(const ColdStore&) = delete;
+  ColdStore& operator=(const ColdStore&) = delete;
+
+  /**
+   * @brief Copies `value` into the file. Thread-safe.
+   * @return The copy in the mapping, which is valid until the destruction,
+   * or nullptr if the value does not fit into a segment.
+   */
+  const std::byte* Append(const std::byte* value, const size_t size);
+  size_t GetBytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+ private:
+  const std::string filename_;
+  int fd_;
+  std::mutex lock_;
+  std::vector<std::byte*> segments_;
+  size_t tail_;  // the offset in the last segment
+  std::atomic<size_t> bytes_;
+};
+
+}  // namespace Index
+}  // namespace LineairDB
+#endif /* LINEAIRDB_INDEX_COLD_STORE_H */
@@ -17,8 +17,10 @@
 #include "concurrent_table.h"
 
 #include <functional>
+#include <string_view>
 
 #include "index/precision_locking_index/index.hpp"
+#include "index/precision_locking_index/range_index/impl/olc_btree_container.hpp"
 #include "lineairdb/config.h"
 #include "types/data_item.hpp"
 #include "types/definitions.h"
@@ -28,12 +30,19 @@ namespace Index {
 
 ConcurrentTable::ConcurrentTable(EpochFramework& epoch_framework, Config config,
                                  WriteSetType recovery_set)
-    : epoch_manager_ref_(epoch_framework) {
+    : absences_(new DataItem[AbsenceItems]),
+      epoch_manager_ref_(epoch_framework),
+      wait_policy_(config.lock_wait_policy),
+      clock_hand_(0) {
   switch (config.index_structure) {
     case Config::IndexStructure::HashTableWithPrecisionLockingIndex:
       index_ = std::make_unique<HashTableWithPrecisionLockingIndex<DataItem>>(
           config, epoch_manager_ref_);
       break;
+    case Config::IndexStructure::HashTableWithOLCTreeIndex:
+      index_ = std::make_unique<HashTableWithPrecisionLockingIndex<DataItem>>(
+          config, epoch_manager_ref_, std::make_unique<OLCBTreeContainer>());
+      break;
     default:
       index_ = std::make_unique<HashTableWithPrecisionLockingIndex<DataItem>>(
           config, epoch_manager_ref_);
@@ -52,24 +61,178 @@ DataItem* ConcurrentTable::Get(const std::string_view key) {
 
 DataItem* ConcurrentTable::GetOrInsert(const std::string_view key) {
   auto* item = index_->Get(key);
-  if (item == nullptr) {
+  // NOTE: the entry may be erased by #EraseTombstone in between.
+  while (item == nullptr) {
     index_->ForcePutBlankEntry(key);
     item = index_->Get(key);
-    assert(item != nullptr);
   }
   return item;
 }
 
+DataItem* ConcurrentTable::GetOrAbsence(const std::string_view key,
+                                        TransactionId& absence_tid) {
+  auto& absence = AbsenceOf(key);
+  // NOTE: the id is loaded before the lookup, and a writer inserts the entry
+  // before it increases the id; either the lookup finds the entry, or the
+  // reader sees the increase.
+  absence_tid = absence.transaction_id.load();
+  auto* item  = index_->Get(key);
+  return item != nullptr ? item : &absence;
+}
+
+DataItem& ConcurrentTable::AbsenceOf(const std::string_view key) {
+  return absences_[std::hash<std::string_view>()(key) % AbsenceItems];
+}
+
+std::pair<TransactionId, TransactionId> ConcurrentTable::IncreaseAbsence(
+    const std::string_view key) {
+  auto& tid     = AbsenceOf(key).transaction_id;
+  auto expected = tid.load();
+  for (;;) {
+    // the lock bit is always clear, and the removed id is never given.
+    auto next = expected;
+    next.tid += 2;
+    if ((next.tid & ~1u) == DataItem::RemovedTid) next.tid = 2;
+    if (tid.compare_exchange_weak(expected, next)) return {expected, next};
+  }
+}
+
+std::vector<DataItem*> ConcurrentTable::MultiGet(
+    const std::vector<std::string_view>& keys) {
+  std::vector<DataItem*> items;
+  index_->MultiGet(keys, items);
+  return items;
+}
+
+std::vector<DataItem*> ConcurrentTable::MultiGetOrInsert(
+    const std::vector<std::string_view>& keys) {
+  auto items = MultiGet(keys);
+  for (size_t i = 0; i < keys.size(); i++) {
+    if (items[i] == nullptr) items[i] = GetOrInsert(keys[i]);
+  }
+  return items;
+}
+
+void ConcurrentTable::Prefetch(const std::vector<std::string_view>& keys) {
+  index_->Prefetch(keys);
+}
+
 // return false if a corresponding entry already exists
 bool ConcurrentTable::Put(const std::string_view key, DataItem&& rhs) {
   return index_->Put(key, std::forward<decltype(rhs)>(rhs));
 }
 
+// NOTE: thread-unsafe with running transactions. It overwrites the existing
+// entry, if any.
+void ConcurrentTable::BulkPut(const std::string_view key, DataItem&& rhs) {
+  auto* item = index_->Get(key);
+  if (item != nullptr) {
+    *item = rhs;
+    return;
+  }
+  index_->BulkPut(key, std::forward<decltype(rhs)>(rhs));
+}
+
+bool ConcurrentTable::EraseTombstone(const std::string_view key,
+                                     const EpochNumber epoch) {
+  auto* item = index_->Get(key);
+  if (item == nullptr) return true;
+  // The lock excludes the transactions that are writing the item.
+  item->ExclusiveLock(wait_policy_);
+  auto tid = item->transaction_id.load();
+  tid.tid &= ~1u;
+  // It has been overwritten; a later tombstone is erased by its own request.
+  if (item->IsInitialized() || item->IsRemoved() || epoch < tid.epoch) {
+    item->ExclusiveUnlock(wait_policy_);
+    return true;
+  }
+  item->transaction_id.store(TransactionId(0, DataItem::RemovedTid | 1u));
+  item->ExclusiveUnlock(wait_policy_);
+
+  // NOTE: the item is unlocked before the removal, since the point index may
+  // wait for the threads which wait for the lock; e.g., a checkpoint.
+  auto* erased = index_->Delete(key);
+  if (erased == nullptr) {
+    // Nobody has written the removed item; it is the same tombstone.
+    item->transaction_id.store(tid);
+    wait_policy_.NotifyReleased(item);
+    return false;
+  }
+  assert(erased == item);
+  epoch_manager_ref_.Retire(item, [](void* removed) {
+    delete static_cast<DataItem*>(removed);
+  });
+  return true;
+}
+
 void ConcurrentTable::ForEach(
     std::function<bool(std::string_view, DataItem&)> f) {
   index_->ForEach(f);
 };
 
+size_t ConcurrentTable::EvictColdValues(ColdStore& store,
+                                        const size_t bytes) {
+  size_t freed = 0;
+  // The hand goes round at most twice; the first round clears the reference
+  // bits and the second one evicts the values.
+  for (size_t round = 0; round < 2 && freed < bytes; round++) {
+    size_t position = 0;
+    index_->ForEach([&](std::string_view, DataItem& item) {
+      if (position++ < clock_hand_) return true;
+      clock_hand_ = position;
+      if (item.referenced.load(std::memory_order_relaxed)) {
+        item.referenced.store(false, std::memory_order_relaxed);
+        return true;
+      }
+      if (item.buffer.HeapBytes() == 0 || !item.TryExclusiveLock()) {
+        return true;
+      }
+      const size_t heap_bytes = item.buffer.HeapBytes();
+      std::byte* detached     = nullptr;
+      if (item.IsInitialized() && heap_bytes != 0) {
+        const auto* copy = store.Append(item.value(), item.size());
+        if (copy != nullptr) {
+          detached = item.buffer.ReferWithoutOverwriting(copy);
+        }
+      }
+      item.ExclusiveUnlock(wait_policy_);
+      if (detached != nullptr) {
+        // the optimistic readers may be copying the value.
+        epoch_manager_ref_.MakeMeOnline();
+        epoch_manager_ref_.Retire(detached, [](void* area) {
+          delete[] static_cast<std::byte*>(area);
+        });
+        epoch_manager_ref_.MakeMeOffline();
+        freed += heap_bytes;
+      }
+      return freed < bytes;
+    });
+    if (freed < bytes) clock_hand_ = 0;
+  }
+  return freed;
+}
+
+/**
+ * @note The index does not exclude #EraseTombstone. An item is visited
+ * online, after the index has given it for the key again, so that it is not
+ * freed during the visit.
+ */
+void ConcurrentTable::ParallelForEach(
+    size_t partitions,
+    std::function<bool(size_t, std::string_view, DataItem&)> f,
+    const PartitionRunner& run) {
+  index_->ParallelForEach(
+      partitions,
+      [&](size_t partition, std::string_view key, DataItem& item) {
+        epoch_manager_ref_.MakeMeOnline();
+        const bool is_live    = index_->Get(key) == &item && !item.IsRemoved();
+        const bool is_success = !is_live || f(partition, key, item);
+        epoch_manager_ref_.MakeMeOffline();
+        return is_success;
+      },
+      run);
+};
+
 std::optional<size_t> ConcurrentTable::Scan(
     const std::string_view begin, const std::optional<std::string_view> end,
     std::function<bool(std::string_view)> operation) {
@@ -77,10 +240,21 @@ std::optional<size_t> ConcurrentTable::Scan(
 };
 
 std::optional<size_t> ConcurrentTable::Scan(
-    const std::string_view begin, const std::string_view end,
+    const std::string_view begin, const std::optional<std::string_view> end,
     std::function<bool(std::string_view, DataItem&)> operation) {
   return index_->Scan(begin, end, operation);
 };
 
+std::pair<size_t, size_t> ConcurrentTable::GetProbeStatistics() {
+  const auto& statistics =
+      HashTableWithPrecisionLockingIndex<DataItem>::GetProbeStatistics();
+  return {statistics.lookups.load(), statistics.probes.load()};
+}
+
+void ConcurrentTable::GetStatistics(Statistics& statistics) {
+  index_->GetStatistics(statistics);
+  statistics.memory.data_items = statistics.records * sizeof(DataItem);
+}
+
 }  // namespace Index
 }  // namespace LineairDB
@@ -18,12 +18,18 @@
 #define LINEAIRDB_CONCURRENT_TABLE_H
 
 #include <lineairdb/config.h>
+#include <lineairdb/statistics.h>
 
 #include <functional>
+#include <memory>
 #include <string>
 #include <string_view>
+#include <utility>
+#include <vector>
 
 #include "index/precision_locking_index/index.hpp"
+#include "index/cold_store.h"
+#include "lock/wait_policy.hpp"
 #include "types/data_item.hpp"
 #include "types/definitions.h"
 #include "types/snapshot.hpp"
@@ -39,18 +45,114 @@ class ConcurrentTable {
 
   DataItem* Get(const std::string_view key);
   DataItem* GetOrInsert(const std::string_view key);
+  /**
+   * @brief
+   * Same as #Get, but gives the absence item of `key` instead of nullptr,
+   * without inserting a blank entry as #GetOrInsert does.
+   * An absence item is a data item shared by the keys hashed into it. It is
+   * never written nor locked, but its transaction id is increased by
+   * #IncreaseAbsence before a value of these keys is installed into a data
+   * item without a value. Hence a reader that validates the transaction id
+   * of the absence item detects a concurrent insertion of `key`, as the
+   * readers of a blank entry do.
+   * @param [out] absence_tid The transaction id of the absence item before
+   * the lookup; the absence of `key` holds while the absence item has it.
+   */
+  DataItem* GetOrAbsence(const std::string_view key,
+                         TransactionId& absence_tid);
+  DataItem& AbsenceOf(const std::string_view key);
+  bool IsAbsence(const DataItem* item) const {
+    return absences_.get() <= item && item < absences_.get() + AbsenceItems;
+  }
+  /**
+   * @brief Increases the transaction id of the absence item of `key`.
+   * @pre The callee has locked a data item of `key` without a value, to
+   * install a value into it.
+   * @return The transaction ids before and after the increase.
+   */
+  std::pair<TransactionId, TransactionId> IncreaseAbsence(
+      const std::string_view key);
+  /**
+   * @brief Same as #Get and #GetOrInsert for each of `keys`, but prefetches
+   * the index entries of the keys ahead of the lookups.
+   */
+  std::vector<DataItem*> MultiGet(const std::vector<std::string_view>& keys);
+  std::vector<DataItem*> MultiGetOrInsert(
+      const std::vector<std::string_view>& keys);
+  /**
+   * @brief Prefetches the index entries of `keys` for the lookups that
+   * follow, e.g., in the next transaction.
+   */
+  void Prefetch(const std::vector<std::string_view>& keys);
   bool Put(const std::string_view key, DataItem&& value);
+  void BulkPut(const std::string_view key, DataItem&& value);
+  /**
+   * @brief
+   * Removes `key` from the index if its data item is still a tombstone,
+   * which a transaction committed in `epoch` has written, and frees the data
+   * item after the concurrent transactions. The removed item is marked as
+   * DataItem::IsRemoved; a transaction that has looked it up before the
+   * removal aborts.
+   * @pre The callee thread is online, and no transaction running or to run
+   * reads a version of `key` written before `epoch`.
+   * @return false if the removal is rejected for now, since a concurrent
+   * scan may have read the key. The callee retries it later.
+   */
+  bool EraseTombstone(const std::string_view key, const EpochNumber epoch);
   void ForEach(std::function<bool(std::string_view, DataItem&)>);
+  /**
+   * @brief
+   * Evicts the values of the data items not accessed recently into `store`,
+   * until about `bytes` of their heap areas are freed. A clock hand sweeps
+   * the index: it clears DataItem::referenced, and evicts the value of an
+   * item that has not been referenced since the last sweep. The items locked
+   * by transactions are skipped, and the heap areas are freed after the
+   * concurrent readers.
+   * @note Called by one thread at a time, which is offline.
+   * @return The bytes freed.
+   */
+  size_t EvictColdValues(ColdStore& store, const size_t bytes);
+  /**
+   * @brief Same as #ForEach, but visits `partitions` disjoint ranges of the
+   * index by the jobs of `run` in parallel; `f` takes the number of the
+   * partition. It blocks neither the transactions nor the rehashing of the
+   * index, and the items removed by #EraseTombstone are skipped. `run` must
+   * not run the jobs on the callee thread; see Index::PartitionRunner.
+   */
+  void ParallelForEach(
+      size_t partitions,
+      std::function<bool(size_t, std::string_view, DataItem&)>,
+      const PartitionRunner& run);
   std::optional<size_t> Scan(const std::string_view begin,
                              const std::optional<std::string_view> end,
                              std::function<bool(std::string_view)> operation);
+  /**
+   * @brief Same as #Scan, but gives the data items without looking up the
+   * point index.
+   */
   std::optional<size_t> Scan(
-      const std::string_view begin, const std::string_view end,
+      const std::string_view begin, const std::optional<std::string_view> end,
       std::function<bool(std::string_view, DataItem&)> operation);
 
+  /**
+   * @brief Returns the number of point lookups and the number of hash table
+   * slots probed by them, on the callee thread so far.
+   */
+  static std::pair<size_t, size_t> GetProbeStatistics();
+  /**
+   * @brief Fills the statistics of the indexes and the data items; see
+   * Database::GetStatistics.
+   */
+  void GetStatistics(Statistics& statistics);
+
  private:
+  static constexpr size_t AbsenceItems = 4096;
+
   std::unique_ptr<HashTableWithPrecisionLockingIndex<DataItem>> index_;
+  std::unique_ptr<DataItem[]> absences_;
   LineairDB::EpochFramework& epoch_manager_ref_;
+  Lock::WaitPolicy wait_policy_;
+  size_t clock_hand_;  // the position of the next item to sweep
 };
 }  // namespace Index
 }  // namespace LineairDB
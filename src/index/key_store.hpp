@@ -0,0 +1,109 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_INDEX_KEY_STORE_HPP
+#define LINEAIRDB_INDEX_KEY_STORE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <vector>
+
+namespace LineairDB {
+namespace Index {
+
+/**
+ * @brief
+ * Append-only storage for keys. A key is copied once, with its length, into
+ * a chunk of ChunkSize bytes, and the handle (KeyStore::Key) is a single
+ * pointer to it. Keys are never moved nor freed until the destruction of the
+ * store, so that optimistic readers can dereference a handle without
+ * synchronization; a key interned twice occupies the store twice.
+ * Compared with a std::string per key, it saves the header of the string
+ * and the allocation of each key.
+ */
+class KeyStore {
+ public:
+  struct Key {
+    uint32_t size;  // followed by the bytes of the key
+
+    const char* data() const { return reinterpret_cast<const char*>(this + 1); }
+    std::string_view View() const { return std::string_view(data(), size); }
+  };
+
+  KeyStore() : bytes_(0), current_(nullptr), offset_(0) {}
+  KeyStore(const KeyStore&) = delete;
+  KeyStore& operator=(const KeyStore&) = delete;
+
+  /**
+   * @brief Copies `key` into the store. Thread-safe.
+   */
+  const Key* Intern(const std::string_view key) {
+    const size_t size = RecordSize(key.size());
+    std::lock_guard<std::mutex> lock(lock_);
+    char* allocated = nullptr;
+    if (ChunkSize < size) {
+      allocated = new char[size];
+      AddChunk(allocated, size);
+    } else {
+      if (current_ == nullptr || ChunkSize < offset_ + size) {
+        current_ = new char[ChunkSize];
+        AddChunk(current_, ChunkSize);
+        offset_ = 0;
+      }
+      allocated = current_ + offset_;
+      offset_ += size;
+    }
+    auto* interned = new (allocated) Key{static_cast<uint32_t>(key.size())};
+    std::memcpy(allocated + sizeof(Key), key.data(), key.size());
+    return interned;
+  }
+
+  /**
+   * @brief Returns the bytes of the chunks allocated.
+   */
+  size_t Bytes() const { return bytes_.load(std::memory_order_relaxed); }
+
+ private:
+  static constexpr size_t ChunkSize = 1 << 16;
+
+  // the records are aligned to the length field.
+  static size_t RecordSize(const size_t key_size) {
+    const size_t size = sizeof(Key) + key_size;
+    return (size + alignof(Key) - 1) / alignof(Key) * alignof(Key);
+  }
+  void AddChunk(char* chunk, size_t size) {
+    chunks_.emplace_back(chunk);
+    bytes_.store(bytes_.load(std::memory_order_relaxed) + size,
+                 std::memory_order_relaxed);
+  }
+
+  std::atomic<size_t> bytes_;
+  std::mutex lock_;
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  char* current_;
+  size_t offset_;
+};
+
+}  // namespace Index
+}  // namespace LineairDB
+
+#endif /* LINEAIRDB_INDEX_KEY_STORE_HPP */
@@ -18,12 +18,18 @@
 #ifndef LINEAIRDB_INDEX_PRECISION_LOCKING_INDEX_HPP
 #define LINEAIRDB_INDEX_PRECISION_LOCKING_INDEX_HPP
 
+#include <lineairdb/statistics.h>
+
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string_view>
+#include <vector>
 
 #include "point_index/mpmc_concurrent_set_impl.hpp"
+#include "range_index/impl/std_map_container.hpp"
 #include "range_index/precision_locking.h"
+#include "range_index/range_index_container_base.h"
 
 namespace LineairDB {
 
@@ -32,29 +38,84 @@ namespace Index {
 template <typename T>
 class HashTableWithPrecisionLockingIndex {
  public:
-  HashTableWithPrecisionLockingIndex(Config c, EpochFramework& e)
-      : point_index_(c.rehash_threshold), range_index_(e) {}
+  HashTableWithPrecisionLockingIndex(
+      Config c, EpochFramework& e,
+      std::unique_ptr<RangeIndexContainerBase>&& container =
+          std::make_unique<StdMapContainer>())
+      : point_index_(c.rehash_threshold, c.hash_index_probing,
+                     c.expected_record_count),
+        range_index_(e, std::move(container)) {}
 
   T* Get(const std::string_view key) { return point_index_.Get(key); }
+  void MultiGet(const std::vector<std::string_view>& keys,
+                std::vector<T*>& values) {
+    point_index_.MultiGet(keys, values);
+  }
+  void Prefetch(const std::vector<std::string_view>& keys) {
+    point_index_.Prefetch(keys);
+  }
 
   /**
-   * @note return false if a phantom anomaly has detected.
+   * @note return false if a phantom anomaly has detected. The entry stays in
+   * the point index even then, as with #ForcePutBlankEntry; the range index
+   * keeps the key so that both indexes agree.
+   * @note The range index publishes its pointer to the scans at once, and
+   * thus it is given only the pointer that has won the point index, which is
+   * never deleted here.
    */
   bool Put(const std::string_view key, T&& rhs) { return Put(key, rhs); }
   bool Put(const std::string_view key, const T& rhs) {
-    bool r_success = range_index_.Insert(key);
-    if (!r_success) return false;
-    auto* value    = new T(rhs);
-    bool p_success = point_index_.Put(key, value);
-    if (!p_success) delete value;
+    auto* value = new T(rhs);
+    if (!point_index_.Put(key, value)) {
+      // the scans look up the existing entry; see #ForcePutBlankEntry.
+      delete value;
+      value = nullptr;
+    }
+    if (!range_index_.Insert(key, value)) {
+      range_index_.ForceInsert(key, value);
+      return false;
+    }
+    return true;
+  }
+
+  /**
+   * @brief Puts an entry into both indexes immediately, bypassing the
+   * phantom avoidance of the range index.
+   * @pre No transaction is running concurrently.
+   * @return false if the key has already been inserted; the existing entry is
+   * not replaced.
+   */
+  bool BulkPut(const std::string_view key, T&& rhs) {
+    auto* value = new T(std::move(rhs));
+    if (!point_index_.Put(key, value)) {
+      delete value;
+      return false;
+    }
+    range_index_.InsertDirectly(key, value);
     return true;
   }
 
+  /**
+   * @brief Removes the entry of `key` from both indexes.
+   * @return The removed value, which the callee has to free after the
+   * concurrent readers, or nullptr. It returns nullptr without removing the
+   * entry if a phantom anomaly has detected; i.e., a concurrent scan may
+   * have read the key.
+   */
+  T* Delete(const std::string_view key) {
+    if (!range_index_.Delete(key)) return nullptr;
+    return point_index_.Erase(key);
+  }
+
   void ForcePutBlankEntry(const std::string_view key) {
     auto* new_entry = new T();
-    if (!point_index_.Put(key, new_entry))
-      delete new_entry;  // already inserted
-    range_index_.ForceInsert(key);
+    if (!point_index_.Put(key, new_entry)) {
+      // Already inserted. The existing entry may be being removed, and thus
+      // the range index does not keep its pointer; the scans look it up.
+      delete new_entry;
+      new_entry = nullptr;
+    }
+    range_index_.ForceInsert(key, new_entry);
   }
 
   /**
@@ -66,14 +127,20 @@ class HashTableWithPrecisionLockingIndex {
    * continues scanning to the end of index.
    * @param operation This callback function will be invoked for every entry
    * matching the range, The key/value pair will be given as an argument.
+   * The range index keeps the pointers to the values, and thus the scan does
+   * not look up the point index, except for the keys inserted by concurrent
+   * puts. A removed value is never given: its removal is a deletion in the
+   * range index, which the scans overlapping with it detect as a phantom.
    * @return std::optional<size_t> returns std::nullopt if a phantom anomaly has
    * detected.
    */
   std::optional<size_t> Scan(
       const std::string_view begin, const std::optional<std::string_view> end,
       std::function<bool(std::string_view, T&)> operation) {
-    return Scan(begin, end, [&](std::string_view key) {
-      auto* value = Get(key);
+    return range_index_.Scan(begin, end, [&](std::string_view key, void* v) {
+      auto* value = v != nullptr ? static_cast<T*>(v) : Get(key);
+      // the key has been deleted from the point index.
+      if (value == nullptr) return false;
       return operation(key, *value);
     });
   };
@@ -91,6 +158,35 @@ class HashTableWithPrecisionLockingIndex {
   void ForEach(std::function<bool(std::string_view, T&)> f) {
     point_index_.ForEach(f);
   };
+  void ParallelForEach(size_t partitions,
+                       std::function<bool(size_t, std::string_view, T&)> f,
+                       const PartitionRunner& run) {
+    point_index_.ParallelForEach(partitions, f, run);
+  };
+
+  /**
+   * @brief Fills the statistics of the point index and the range index.
+   */
+  void GetStatistics(Statistics& statistics) {
+    const auto point = point_index_.GetStatistics();
+    statistics.records             = point.entries;
+    statistics.hash_table_capacity = point.capacity;
+    statistics.hash_table_fill_rate =
+        static_cast<double>(point.occupied) / point.capacity;
+    statistics.average_probe_length =
+        point.lookups == 0 ? 0
+                           : static_cast<double>(point.probes) / point.lookups;
+    statistics.memory.point_index = point.bytes;
+
+    const auto range              = range_index_.GetUsage();
+    statistics.live_predicates    = range.predicates;
+    statistics.memory.range_index = range.bytes;
+  }
+
+  using ProbeStatistics = typename MPMCConcurrentSetImpl<T>::ProbeStatistics;
+  static ProbeStatistics& GetProbeStatistics() {
+    return MPMCConcurrentSetImpl<T>::GetProbeStatistics();
+  }
 
  private:
   MPMCConcurrentSetImpl<T> point_index_;
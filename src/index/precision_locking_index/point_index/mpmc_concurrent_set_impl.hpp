@@ -17,18 +17,33 @@
 #ifndef LINEAIRDB_MPMC_CONCURRENT_SET_IMPL_H
 #define LINEAIRDB_MPMC_CONCURRENT_SET_IMPL_H
 
+#include <lineairdb/config.h>
+
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <cassert>
 #include <cstdint>
+#include <cstring>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <new>
+#include <optional>
 #include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
+#include "index/key_store.hpp"
 #include "types/data_item.hpp"
 #include "types/definitions.h"
-#include "util/epoch_framework.hpp"
+#include "util/quiescent_counters.hpp"
+#include "util/thread_slots.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #ifndef PREFETCH_LOCALITY
 #define PREFETCH_LOCALITY 3
@@ -37,6 +52,14 @@
 namespace LineairDB {
 namespace Index {
 
+/**
+ * @brief Runs `job` for each of `partitions` partitions, given the number of
+ * the partition, and returns when all of them have finished; e.g., on the
+ * workers of a thread pool. The jobs must not run on the callee thread.
+ */
+using PartitionRunner =
+    std::function<void(size_t partitions, const std::function<void(size_t)>&)>;
+
 /**
  * @brief
  * Multi-Producer Multi-Consumer (MPMC) hash-table,
@@ -46,44 +69,187 @@ namespace Index {
  * This is because LineairDB requires that point-indexes have to
  * hold only indirection pointer to each data item; once an indirection is
  * created and stored into the index, it will not be changed by #puts.
+ * An entry is removed only by #Erase, for the reclamation of deleted keys.
+ * With LinearProbing, the slot of an erased entry is left as Deleted so that
+ * the probe sequences through it are kept; Deleted slots are dropped by the
+ * next rehashing, which compacts the table instead of growing it when most
+ * of the occupied slots are Deleted.
+ *
+ * Each slot of the table occupies exactly one cache line and holds the hash
+ * tag, the length and the key itself inline (keys up to InlineKeySize bytes).
+ * Longer keys are copied into a KeyStore and the slot keeps the 8-byte
+ * prefix and the pointer to the bytes. Thus a successful #Get of a short key
+ * touches only one cache line. The contents of a slot are guarded by the seqlock-like `meta`
+ * word; see #ProbeSlot.
+ *
+ * With LinearProbing, each slot also has a one-byte control word in a
+ * separate array, in the manner of SwissTable [2]: it holds 7 bits of the
+ * hash of the key, or a state. #Get compares GroupSize control words at
+ * once (with SSE2 if available), and touches only the slots whose control
+ * words match. A writer claims a slot by its control word, so the control
+ * words are never behind the slots.
+ *
+ * The collision resolution is selected by Config::HashIndexProbing.
+ * With CuckooHashing, the table is divided into buckets of
+ * CuckooBucketSize slots and each key is stored in one of its two candidate
+ * buckets; #Get probes at most 2 * CuckooBucketSize slots. #Put displaces
+ * existing entries along a cuckoo path under table_lock_, and readers
+ * re-check only on a miss if a displacement has run concurrently [1].
+ * @ref [1] https://www.cs.cmu.edu/~dga/papers/memc3-nsdi2013.pdf
+ * @ref [2] https://abseil.io/about/design/swisstables
  */
 
 template <typename T>
 class MPMCConcurrentSetImpl {
   // TODO WANTFIX replace std::hardware_destructive_interference_size
-  // TODO performance fix hashed prefix uint64_t key
-  struct alignas(64) TableNode {
-    std::string key;
-    const T* value;
-    uint64_t key_8b_prefix;
-    TableNode() : value(nullptr) { assert(key.empty()); };
-    TableNode(std::string_view k, const T* const v)
-        : key(k), value(v), key_8b_prefix(string_to_uint64_t(k)) {}
+  static constexpr size_t CacheLineSize = 64;
+  static constexpr size_t InlineWords   = 6;
+  static constexpr size_t InlineKeySize = InlineWords * sizeof(uint64_t);
+
+  /**
+   * @brief
+   * `meta` consists of [length:32][tag:16][version:13][state:3].
+   * A writer moves a slot into Busy (with incrementing the version) before it
+   * rewrites the key and the value, and then publishes it as Ready.
+   * While rehashing, a Ready slot becomes Moved once it has been copied into
+   * the next table (its key and value are kept, so readers can still use
+   * it), and an Empty slot becomes Redirected. #Erase moves a Ready slot
+   * into Deleted.
+   */
+  enum SlotState : uint64_t {
+    Empty      = 0,
+    Busy       = 1,
+    Ready      = 2,
+    Moved      = 3,
+    Redirected = 4,
+    Deleted    = 5
+  };
+  struct alignas(CacheLineSize) Slot {
+    std::atomic<uint64_t> meta;
+    std::atomic<const T*> value;
+    // Inline key, or [8-byte prefix, pointer into KeyStore] for long keys.
+    std::array<std::atomic<uint64_t>, InlineWords> key_words;
+    Slot() : meta(0), value(nullptr) {
+      for (auto& word : key_words) word.store(0, std::memory_order_relaxed);
+    }
   };
-  // static_assert(sizeof(TableNode) ==
-  //             std::hardware_destructive_interference_size);
+  static_assert(sizeof(Slot) == CacheLineSize);
 
-  static constexpr size_t InitialTableSize = 4096;
-  static constexpr uintptr_t RedirectedPtr = 0x4B1D;
-  inline static bool IsRedirectedPtr(void* ptr) {
-    return reinterpret_cast<uintptr_t>(ptr) == RedirectedPtr;
+  inline static SlotState State(uint64_t meta) {
+    return static_cast<SlotState>(meta & 0b111);
   }
-  inline static TableNode* GetRedirectedPtr() {
-    return reinterpret_cast<TableNode*>(RedirectedPtr);
+  inline static uint64_t Version(uint64_t meta) {
+    return (meta >> 3) & 0x1FFF;
   }
-  inline static uint64_t string_to_uint64_t(std::string_view k) {
-    uint64_t result = 0;
-    const size_t copy_size = std::min(k.size(), sizeof(uint64_t));
-    std::memcpy(&result, k.data(), copy_size);
-    return result;
+  inline static uint16_t Tag(uint64_t meta) { return (meta >> 16) & 0xFFFF; }
+  inline static uint32_t Length(uint64_t meta) { return meta >> 32; }
+
+  /**
+   * @brief
+   * A control word is Empty, Redirected (the same as the states of `meta`),
+   * End (the padding after the last slot), or `0x80 | 7 bits of the hash`
+   * for a claimed slot. It changes only once, from Empty.
+   */
+  enum Control : uint8_t {
+    EmptyControl      = 0,
+    RedirectedControl = 1,
+    EndControl        = 2,
+  };
+  static constexpr size_t GroupSize = 16;
+  /**
+   * @brief The positions of the control words in a group, as bitmasks.
+   */
+  struct GroupMatch {
+    uint32_t matched;
+    uint32_t empty;
+    uint32_t redirected;
+    uint32_t end;
+    uint32_t Stops() const { return empty | redirected | end; }
+  };
+  inline static uint64_t MakeMeta(SlotState state, uint64_t version,
+                                  uint16_t tag, uint32_t length) {
+    return (static_cast<uint64_t>(length) << 32) |
+           (static_cast<uint64_t>(tag) << 16) | ((version & 0x1FFF) << 3) |
+           state;
   }
 
-  using TableType = std::vector<std::atomic<TableNode*>>;
+  /**
+   * @brief A key and its hash, encoded once per operation in the same format
+   * as Slot::key_words.
+   */
+  struct SearchKey {
+    std::string_view key;
+    size_t hash;
+    uint16_t tag;
+    uint8_t control;
+    std::array<uint64_t, InlineWords> words;
+
+    explicit SearchKey(std::string_view k)
+        : key(k), hash(std::hash<std::string_view>()(k)), words{} {
+      tag     = static_cast<uint16_t>(hash >> 48);
+      control = static_cast<uint8_t>(0x80 | (hash >> 57));
+      std::memcpy(words.data(), k.data(), std::min(k.size(), InlineKeySize));
+    }
+    bool IsInline() const { return key.size() <= InlineKeySize; }
+    size_t UsedWords() const {
+      if (!IsInline()) return 1;
+      return (key.size() + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    }
+  };
+
+  static constexpr size_t InitialTableSize = 4096;
+  static constexpr size_t CuckooBucketSize = 4;
+  static constexpr size_t CuckooMaxSearch  = 512;
+  static constexpr size_t RehashStripeSize = 1024;
+  // the number of keys whose slots #MultiGet prefetches ahead of the probes.
+  static constexpr size_t PrefetchGroupSize = 16;
+
+  /**
+   * @brief
+   * While `next` is not null, the table is being migrated into `next`.
+   * The migration is divided into stripes of RehashStripeSize slots; any
+   * thread claims a stripe by `transfer_cursor` and helps the migration.
+   */
+  struct Table {
+    std::vector<Slot> slots;
+    // with GroupSize words of EndControl after the last slot.
+    std::vector<std::atomic<uint8_t>> controls;
+    std::atomic<Table*> next{nullptr};
+    std::atomic<size_t> transfer_cursor{0};
+    std::atomic<size_t> transferred_stripes{0};
+
+    explicit Table(size_t size) : slots(size), controls(size + GroupSize) {
+      for (size_t i = size; i < controls.size(); i++) {
+        controls[i].store(EndControl, std::memory_order_relaxed);
+      }
+    }
+    size_t size() const { return slots.size(); }
+    size_t stripes() const {
+      return (size() + RehashStripeSize - 1) / RehashStripeSize;
+    }
+    Slot& operator[](size_t i) { return slots[i]; }
+  };
+  using TableType = Table;
+
+  /**
+   * @brief Returns the smallest power-of-two capacity that holds
+   * `expected_size` entries under the rehash threshold `r`.
+   */
+  static size_t InitialCapacity(size_t expected_size, double r) {
+    size_t capacity = InitialTableSize;
+    if (r <= 0 || 1 < r) return capacity;
+    while (capacity * r < expected_size) capacity *= 2;
+    return capacity;
+  }
 
  public:
-  explicit MPMCConcurrentSetImpl(double r = 0.75)
+  explicit MPMCConcurrentSetImpl(
+      double r                         = 0.75,
+      Config::HashIndexProbing probing = Config::HashIndexProbing::LinearProbing,
+      size_t expected_size             = 0)
       : rehash_threshold_(r),
-        table_(new TableType(InitialTableSize)),
+        is_cuckoo_(probing == Config::HashIndexProbing::CuckooHashing),
+        table_(new TableType(InitialCapacity(expected_size, r))),
         populated_count_(0),
         rehash_thread_([&]() {
           while (!stop_flag_.load()) {
@@ -107,9 +273,7 @@ class MPMCConcurrentSetImpl {
               Rehash();
             }
           }
-        }) {
-    epoch_framework_.Start();
-  }
+        }) {}
   ~MPMCConcurrentSetImpl() {
     stop_flag_.store(true);
     rehash_cv_.notify_all();
@@ -117,122 +281,464 @@ class MPMCConcurrentSetImpl {
     Clear();
     delete table_.load();
   };
-  T* Get(const std::string_view);
+  T* Get(const std::string_view key) { return Get(SearchKey(key)); }
+  void MultiGet(const std::vector<std::string_view>&, std::vector<T*>&);
+  /**
+   * @brief Prefetches the slots of `keys`, so that the following #Get of
+   * them hit the cache.
+   */
+  void Prefetch(const std::vector<std::string_view>&);
+
+  /**
+   * @brief The numbers of #Get and of the slots that they have compared with
+   * the keys, on the callee thread. Only the owner thread updates them, once
+   * per #Get.
+   */
+  struct ProbeStatistics {
+    std::atomic<size_t> lookups{0};
+    std::atomic<size_t> probes{0};
+  };
+  static ProbeStatistics& GetProbeStatistics() { return ProbeSlots().Get(); }
+
+  /**
+   * @brief The sizes of the set, and the probes of the lookups of all the
+   * threads since the construction of the set.
+   */
+  struct SetStatistics {
+    size_t entries;   // not including the Deleted slots
+    size_t occupied;  // the slots that are not Empty
+    size_t capacity;
+    size_t bytes;  // the tables and the KeyStore
+    size_t lookups;
+    size_t probes;
+  };
+  SetStatistics GetStatistics();
   bool Put(const std::string_view, const T* const);
+  /**
+   * @brief Removes the entry of the key.
+   * @return The value of the removed entry, or nullptr if the key is absent.
+   * Concurrent readers may still refer to the value; the callee has to free
+   * it after them.
+   */
+  T* Erase(const std::string_view);
   void Clear();  // thread-unsafe
   void ForEach(std::function<bool(std::string_view, T&)>);
+  /**
+   * @brief Same as #ForEach, but divides the slots into `partitions` ranges
+   * and visits them by the jobs of `run` in parallel. `f` takes the number of
+   * the partition, and returns false to stop visiting the partition.
+   * It neither blocks the rehashing nor the writers: the entries put or
+   * erased concurrently may or may not be visited, and thus `f` may be given
+   * a value that is being erased; the callee has to validate it. The entries
+   * put before the call are visited.
+   * The callee thread is a reader of the table during the visit, and thus
+   * `run` must run the jobs on other threads.
+   */
+  void ParallelForEach(size_t partitions,
+                       std::function<bool(size_t, std::string_view, T&)>,
+                       const PartitionRunner& run);
 
  private:
-  inline size_t Hash(std::string_view, TableType*);
+  enum class ProbeResult { Match, Mismatch, Empty, Redirected };
+
+  T* Get(const SearchKey&);
+  inline void Prefetch(const SearchKey&, TableType*);
+  inline size_t Hash(const SearchKey&, TableType*);
+  inline ProbeResult ProbeSlot(const Slot&, const SearchKey&, T*&);
+  inline static GroupMatch MatchGroup(const TableType*, size_t, uint8_t);
+  inline static bool ClaimSlot(TableType*, size_t, uint8_t);
+  inline void FillSlot(Slot&, uint64_t version, const SearchKey&,
+                       const T* const);
+  inline void CopySlot(Slot& destination, uint64_t version, const Slot&);
+  inline std::string_view KeyOf(const Slot&, uint64_t meta);
   bool Rehash();
+  size_t NextTableSize(const TableType*);
+  void HelpRehash(TableType*);
+  void MigrateSlot(TableType*, size_t, TableType* next);
+
+  inline std::pair<size_t, size_t> CuckooBuckets(size_t hash, TableType*);
+  inline T* FindInBucket(const SearchKey&, TableType*, size_t,
+                          size_t& probes);
+  T* CuckooGet(const SearchKey&);
+  bool CuckooPut(const std::string_view, const T* const);
+  T* CuckooErase(const SearchKey&);
+  bool CuckooInsert(const SearchKey&, const T* const, TableType*,
+                    const Slot* source = nullptr);
+  bool CuckooRehash(TableType* expected = nullptr);
+
+  // Publishes a lookup that has compared `probes` slots with the key.
+  static void CountLookup(const size_t probes) {
+    auto& statistics = GetProbeStatistics();
+    statistics.lookups.store(
+        statistics.lookups.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+    statistics.probes.store(
+        statistics.probes.load(std::memory_order_relaxed) + probes,
+        std::memory_order_relaxed);
+  }
+  static std::pair<size_t, size_t> SumProbeStatistics() {
+    size_t lookups = 0;
+    size_t probes  = 0;
+    ProbeSlots().ForEach([&](const ProbeStatistics& statistics) {
+      lookups += statistics.lookups.load(std::memory_order_relaxed);
+      probes += statistics.probes.load(std::memory_order_relaxed);
+    });
+    return {lookups, probes};
+  }
+  // NOTE: never destroyed, as the thread-local storage of the counters.
+  static ThreadSlots<ProbeStatistics>& ProbeSlots() {
+    static auto* slots = new ThreadSlots<ProbeStatistics>();
+    return *slots;
+  }
 
  private:
   const double rehash_threshold_;
+  const bool is_cuckoo_;
   std::atomic<TableType*> table_;
   std::atomic<size_t> populated_count_;
+  // the Deleted slots, which are counted in populated_count_ as well.
+  std::atomic<size_t> deleted_count_{0};
+  KeyStore long_keys_;
+  // the probes counted before the construction; see #GetStatistics.
+  const std::pair<size_t, size_t> probe_baseline_ = SumProbeStatistics();
 
   std::mutex table_lock_;
   std::atomic<bool> stop_flag_{false};
 
   std::mutex rehash_flag_;
   std::condition_variable rehash_cv_;
-  std::thread rehash_thread_;
   std::atomic<bool> force_rehash_flag_{false};
+  // odd while a cuckoo path is being moved; see #CuckooGet.
+  std::atomic<uint64_t> displacement_version_{0};
 
-  EpochFramework epoch_framework_;
+  // The readers of table_; a table is deleted after they have exited.
+  QuiescentCounters readers_;
+  // NOTE: declared last; the thread reads the members above.
+  std::thread rehash_thread_;
 };
 
 /** the followings are implementation **/
+
+/**
+ * @brief Compares the slot with the key.
+ * The keys and the value are read optimistically and validated by re-reading
+ * `meta`; a reader waits only while the slot is Busy.
+ */
 template <typename T>
-T* MPMCConcurrentSetImpl<T>::Get(const std::string_view key) {
-get_start:
-  epoch_framework_.MakeMeOnline();
-  auto* table = table_.load(std::memory_order::memory_order_relaxed);
-  __builtin_prefetch(table, 0, PREFETCH_LOCALITY);
-  size_t hash = Hash(key, table);
-  auto* bucket_p = (*table)[hash].load(std::memory_order::memory_order_relaxed);
-  T* return_value_p = nullptr;
+inline typename MPMCConcurrentSetImpl<T>::ProbeResult
+MPMCConcurrentSetImpl<T>::ProbeSlot(const Slot& slot, const SearchKey& key,
+                                    T*& value) {
+  for (;;) {
+    const uint64_t meta =
+        slot.meta.load(std::memory_order::memory_order_acquire);
+    const auto state = State(meta);
+    if (state == Empty) return ProbeResult::Empty;
+    if (state == Redirected) return ProbeResult::Redirected;
+    if (state == Deleted) return ProbeResult::Mismatch;
+    // Moved slots are read as well as Ready ones.
+    if (__builtin_expect(state == Busy, false)) {
+      std::this_thread::yield();
+      continue;
+    }
+    // `meta` is read atomically; no validation is needed to reject the key.
+    if (Tag(meta) != key.tag || Length(meta) != key.key.size()) {
+      return ProbeResult::Mismatch;
+    }
 
-  size_t count = 0;
+    bool equal = true;
+    for (size_t i = 0; i < key.UsedWords(); i++) {
+      if (slot.key_words[i].load(std::memory_order::memory_order_relaxed) !=
+          key.words[i]) {
+        equal = false;
+        break;
+      }
+    }
+    const char* long_key = nullptr;
+    if (!key.IsInline()) {
+      long_key = reinterpret_cast<const char*>(
+          slot.key_words[1].load(std::memory_order::memory_order_relaxed));
+    }
+    auto* v = slot.value.load(std::memory_order::memory_order_relaxed);
 
-  // lineair probing
-  for (;;) {
-    // redirected
-    if (__builtin_expect(IsRedirectedPtr(bucket_p), false)) {
-      table = table_.load();
-      hash = Hash(key, table);
-      bucket_p = (*table)[hash].load(std::memory_order::memory_order_relaxed);
-      __builtin_prefetch(bucket_p, 0, PREFETCH_LOCALITY);
-      count = 0;
+    std::atomic_thread_fence(std::memory_order::memory_order_acquire);
+    if (slot.meta.load(std::memory_order::memory_order_relaxed) != meta) {
       continue;
     }
+    if (equal && long_key != nullptr) {
+      equal = std::memcmp(long_key, key.key.data(), key.key.size()) == 0;
+    }
+    if (!equal) return ProbeResult::Mismatch;
+    value = const_cast<T*>(v);
+    return ProbeResult::Match;
+  }
+}
 
-    if (__builtin_expect(bucket_p == nullptr, false)) {
-      break;
+/**
+ * @brief Writes the key and the value into the slot in Busy state, and then
+ * publishes it. The caller must have moved the slot into Busy with `version`.
+ */
+template <typename T>
+inline void MPMCConcurrentSetImpl<T>::FillSlot(Slot& slot, uint64_t version,
+                                               const SearchKey& key,
+                                               const T* const value) {
+  if (key.IsInline()) {
+    for (size_t i = 0; i < InlineWords; i++) {
+      slot.key_words[i].store(key.words[i],
+                              std::memory_order::memory_order_relaxed);
     }
+  } else {
+    slot.key_words[0].store(key.words[0],
+                            std::memory_order::memory_order_relaxed);
+    slot.key_words[1].store(
+        reinterpret_cast<uint64_t>(long_keys_.Intern(key.key)->data()),
+        std::memory_order::memory_order_relaxed);
+  }
+  slot.value.store(value, std::memory_order::memory_order_relaxed);
+  slot.meta.store(MakeMeta(Ready, version, key.tag, key.key.size()),
+                  std::memory_order::memory_order_release);
+}
 
-    // Optimization: we assume that cmp of uint64_T is faster than strcmp.
-    if (bucket_p->key_8b_prefix == string_to_uint64_t(key)) {
-      if (bucket_p->key == key) {
-        return_value_p = const_cast<T*>(bucket_p->value);
+/**
+ * @brief Copies a Ready slot. The same as #FillSlot but the long key is
+ * shared with the source.
+ */
+template <typename T>
+inline void MPMCConcurrentSetImpl<T>::CopySlot(Slot& destination,
+                                               uint64_t version,
+                                               const Slot& source) {
+  const uint64_t meta =
+      source.meta.load(std::memory_order::memory_order_acquire);
+  assert(State(meta) == Ready);
+  for (size_t i = 0; i < InlineWords; i++) {
+    destination.key_words[i].store(
+        source.key_words[i].load(std::memory_order::memory_order_relaxed),
+        std::memory_order::memory_order_relaxed);
+  }
+  destination.value.store(
+      source.value.load(std::memory_order::memory_order_relaxed),
+      std::memory_order::memory_order_relaxed);
+  destination.meta.store(MakeMeta(Ready, version, Tag(meta), Length(meta)),
+                         std::memory_order::memory_order_release);
+}
+
+/**
+ * @note The slot must not be rewritten concurrently; i.e., it is used under
+ * table_lock_, or it is a Ready or Moved slot of LinearProbing.
+ */
+template <typename T>
+inline std::string_view MPMCConcurrentSetImpl<T>::KeyOf(const Slot& slot,
+                                                        uint64_t meta) {
+  const size_t length = Length(meta);
+  if (length <= InlineKeySize) {
+    return std::string_view(reinterpret_cast<const char*>(&slot.key_words),
+                            length);
+  }
+  return std::string_view(reinterpret_cast<const char*>(slot.key_words[1].load(
+                              std::memory_order::memory_order_relaxed)),
+                          length);
+}
+
+/**
+ * @brief Compares the control words from `position` with `control`.
+ */
+template <typename T>
+inline typename MPMCConcurrentSetImpl<T>::GroupMatch
+MPMCConcurrentSetImpl<T>::MatchGroup(const TableType* table,
+                                     const size_t position,
+                                     const uint8_t control) {
+  static_assert(sizeof(std::atomic<uint8_t>) == sizeof(uint8_t));
+  GroupMatch match;
+#if defined(__SSE2__)
+  // NOTE: the words are read as a whole; each of them changes only once and
+  // the slots are validated by `meta` in #ProbeSlot.
+  const __m128i words = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(&table->controls[position]));
+  auto mask_of = [&](uint8_t c) {
+    return static_cast<uint32_t>(_mm_movemask_epi8(
+        _mm_cmpeq_epi8(words, _mm_set1_epi8(static_cast<char>(c)))));
+  };
+  match.matched    = mask_of(control);
+  match.empty      = mask_of(EmptyControl);
+  match.redirected = mask_of(RedirectedControl);
+  match.end        = mask_of(EndControl);
+#else
+  match = {0, 0, 0, 0};
+  for (size_t i = 0; i < GroupSize; i++) {
+    const auto word = table->controls[position + i].load(
+        std::memory_order::memory_order_relaxed);
+    const uint32_t bit = 1u << i;
+    if (word == control) match.matched |= bit;
+    if (word == EmptyControl) match.empty |= bit;
+    if (word == RedirectedControl) match.redirected |= bit;
+    if (word == EndControl) match.end |= bit;
+  }
+#endif
+  std::atomic_thread_fence(std::memory_order::memory_order_acquire);
+  return match;
+}
+
+/**
+ * @brief Claims an Empty slot by its control word. The claimer moves the slot
+ * into Busy and fills it.
+ */
+template <typename T>
+inline bool MPMCConcurrentSetImpl<T>::ClaimSlot(TableType* table,
+                                                const size_t position,
+                                                const uint8_t control) {
+  uint8_t expected = EmptyControl;
+  return table->controls[position].compare_exchange_strong(expected, control);
+}
+
+template <typename T>
+T* MPMCConcurrentSetImpl<T>::Get(const SearchKey& search_key) {
+  if (is_cuckoo_) return CuckooGet(search_key);
+  readers_.Enter();
+  auto* table = table_.load(std::memory_order::memory_order_relaxed);
+  size_t hash = Hash(search_key, table);
+  __builtin_prefetch(&(*table)[hash], 0, PREFETCH_LOCALITY);
+  T* return_value_p = nullptr;
+
+  size_t count  = 0;
+  size_t probes = 0;
+
+  // lineair probing, a group of control words at a time
+  for (;;) {
+    const auto match = MatchGroup(table, hash, search_key.control);
+    const uint32_t stops = match.Stops();
+    const uint32_t first_stop =
+        stops == 0 ? GroupSize : __builtin_ctz(stops);
+    // the slots after the first stop belong to other probe sequences.
+    uint32_t candidates = match.matched & ((1u << first_stop) - 1);
+    bool found          = false;
+    while (candidates != 0) {
+      const size_t i = __builtin_ctz(candidates);
+      candidates &= candidates - 1;
+      probes++;
+      // an Empty result is a slot that is being filled: it is not ours yet.
+      if (ProbeSlot((*table)[hash + i], search_key, return_value_p) ==
+          ProbeResult::Match) {
+        found = true;
         break;
       }
     }
+    if (found) break;
 
-    hash++;
-    count++;
-    if (__builtin_expect(hash == table->size(), false)) {
-      hash = 0;
+    const uint32_t stop_bit = stops & (~stops + 1);
+    if (stop_bit == 0) {
+      hash += GroupSize;
+    } else if (stop_bit & match.empty) {
+      break;
+    } else if (__builtin_expect(stop_bit & match.redirected, false)) {
+      // redirected: the rest of the probe sequence lives in the next table.
+      table = table->next.load();
+      hash  = Hash(search_key, table);
+      count = 0;
+      continue;
+    } else {
+      hash = 0;  // the end of the table
     }
-    bucket_p = (*table)[hash].load(std::memory_order::memory_order_relaxed);
-    if (count > 100) {
-      epoch_framework_.MakeMeOffline();
+
+    const size_t previous_count = count;
+    count += first_stop;
+    if (__builtin_expect(previous_count < 100 && 100 <= count, false)) {
+      // Rehash the table to reduce the probing length. Readers do not wait
+      // for the rehashing; the probe ends at an empty bucket anyway.
       force_rehash_flag_.store(true);
-      rehash_cv_.notify_all();  // rehash the table to reduce the probing length
-      epoch_framework_.Sync();
-      count = 0;
-      goto get_start;
+      rehash_cv_.notify_all();
     }
+    // the table is full and has no redirection: the key is absent.
+    if (__builtin_expect(table->size() <= count, false)) break;
   }
 
-  epoch_framework_.MakeMeOffline();
+  readers_.Exit();
+  CountLookup(probes);
   return return_value_p;
 }
 
+/**
+ * @brief
+ * Gets the values of `keys` into `values`, in the manner of group
+ * prefetching: for each group of PrefetchGroupSize keys, it hashes all the
+ * keys and prefetches their slots first, and then probes them. Thus the
+ * cache misses on the slots overlap with each other, instead of being
+ * exposed one by one as a sequence of #Get.
+ */
+template <typename T>
+void MPMCConcurrentSetImpl<T>::MultiGet(
+    const std::vector<std::string_view>& keys, std::vector<T*>& values) {
+  values.resize(keys.size());
+  std::vector<SearchKey> group;
+  group.reserve(std::min(keys.size(), PrefetchGroupSize));
+  for (size_t begin = 0; begin < keys.size(); begin += PrefetchGroupSize) {
+    const size_t end = std::min(keys.size(), begin + PrefetchGroupSize);
+    group.clear();
+    for (size_t i = begin; i < end; i++) group.emplace_back(keys[i]);
+
+    readers_.Enter();
+    auto* table = table_.load(std::memory_order::memory_order_acquire);
+    for (const auto& search_key : group) Prefetch(search_key, table);
+    readers_.Exit();
+
+    // NOTE: a rehash in between only wastes the prefetches.
+    for (size_t i = begin; i < end; i++) values[i] = Get(group[i - begin]);
+  }
+}
+
+template <typename T>
+void MPMCConcurrentSetImpl<T>::Prefetch(
+    const std::vector<std::string_view>& keys) {
+  readers_.Enter();
+  auto* table = table_.load(std::memory_order::memory_order_acquire);
+  for (const auto key : keys) Prefetch(SearchKey(key), table);
+  readers_.Exit();
+}
+
+template <typename T>
+inline void MPMCConcurrentSetImpl<T>::Prefetch(const SearchKey& key,
+                                               TableType* table) {
+  if (is_cuckoo_) {
+    const auto [first, second] = CuckooBuckets(key.hash, table);
+    __builtin_prefetch(&(*table)[first * CuckooBucketSize], 0,
+                       PREFETCH_LOCALITY);
+    __builtin_prefetch(&(*table)[second * CuckooBucketSize], 0,
+                       PREFETCH_LOCALITY);
+  } else {
+    __builtin_prefetch(&(*table)[Hash(key, table)], 0, PREFETCH_LOCALITY);
+  }
+}
+
 template <typename T>
 bool MPMCConcurrentSetImpl<T>::Put(const std::string_view key,
                                    const T* const value_p) {
-put_start:
-  epoch_framework_.MakeMeOnline();
+  if (is_cuckoo_) return CuckooPut(key, value_p);
+  const SearchKey search_key(key);
+  readers_.Enter();
   auto* table = table_.load(std::memory_order::memory_order_seq_cst);
-  size_t hash = Hash(key, table);
-  auto* new_node = new TableNode(key, value_p);
+  if (__builtin_expect(table->next.load() != nullptr, false)) {
+    HelpRehash(table);
+  }
+  size_t hash  = Hash(search_key, table);
   size_t count = 0;
 
-  // TODO: WANTFIX
-  // Replace linear-probing with hopscotch-hashing or cuckoo-hashing to reduce
-  // the computational costs of find operation.
   for (;;) {
-    auto& bucket_atm = (*table)[hash];
-    auto* node = bucket_atm.load(std::memory_order::memory_order_relaxed);
-
-    // redirected
-    if (__builtin_expect(IsRedirectedPtr(node), false)) {
-      table = table_.load(std::memory_order::memory_order_seq_cst);
-      hash = Hash(key, table);
-      node = (*table)[hash].load(std::memory_order::memory_order_relaxed);
-      count = 0;
-      continue;
-    }
+    auto& slot         = (*table)[hash];
+    const auto control = table->controls[hash].load(
+        std::memory_order::memory_order_acquire);
 
     // empty bucket has found. insert
-    if (node == nullptr) {
-      bool succ = bucket_atm.compare_exchange_weak(node, new_node);
-      if (succ) {
+    if (control == EmptyControl) {
+      if (ClaimSlot(table, hash, search_key.control)) {
+        const uint64_t version =
+            Version(slot.meta.load(std::memory_order::memory_order_relaxed)) +
+            1;
+        slot.meta.store(MakeMeta(Busy, version, 0, 0),
+                        std::memory_order::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order::memory_order_release);
+        FillSlot(slot, version, search_key, value_p);
         const size_t current_stored = populated_count_.fetch_add(1);
         const double current_fill_rate =
             (current_stored / static_cast<double>(table->size()));
-        epoch_framework_.MakeMeOffline();
+        readers_.Exit();
         if (rehash_threshold_ < current_fill_rate) {
           rehash_cv_.notify_one();
         }
@@ -242,11 +748,21 @@ put_start:
       }
     }
 
-    // Optimization: we assume that cmp of uint64_t is faster than strcmp.
-    if (node->key_8b_prefix == string_to_uint64_t(key)) {
-      if (node->key == key) {
-        delete new_node;
-        epoch_framework_.MakeMeOffline();
+    // redirected: help the migration and continue in the next table.
+    if (__builtin_expect(control == RedirectedControl, false)) {
+      HelpRehash(table);
+      table = table->next.load();
+      hash  = Hash(search_key, table);
+      count = 0;
+      continue;
+    }
+    if (control == search_key.control) {
+      T* unused         = nullptr;
+      const auto result = ProbeSlot(slot, search_key, unused);
+      // the claimer has not filled the slot yet; it may be the same key.
+      if (result == ProbeResult::Empty) continue;
+      if (result == ProbeResult::Match) {
+        readers_.Exit();
         return false;
       }
     }
@@ -257,107 +773,528 @@ put_start:
       hash = 0;
     }
 
-    if (count > 100) {
-      epoch_framework_.MakeMeOffline();
+    if (__builtin_expect(count == 100, false)) {
       force_rehash_flag_.store(true);
       rehash_cv_.notify_all();  // rehash the table to reduce the probing length
-      epoch_framework_.Sync();
-      delete new_node;
-      goto put_start;
+    }
+    if (__builtin_expect(count == table->size(), false)) {
+      // The table is full; wait for the rehashing to begin.
+      readers_.Exit();
+      std::this_thread::yield();
+      readers_.Enter();
+      table = table_.load(std::memory_order::memory_order_seq_cst);
+      if (table->next.load() != nullptr) HelpRehash(table);
+      hash  = Hash(search_key, table);
+      count = 0;
     }
   }
 }
 
-// FYI: https://preshing.com/20160222/a-resizable-concurrent-map/
+/**
+ * @note table_lock_ is held, so that no migration runs concurrently; the
+ * probe sequences are not redirected.
+ */
 template <typename T>
-bool MPMCConcurrentSetImpl<T>::Rehash() {
+T* MPMCConcurrentSetImpl<T>::Erase(const std::string_view key) {
+  const SearchKey search_key(key);
   std::lock_guard<std::mutex> lock(table_lock_);
+  if (is_cuckoo_) return CuckooErase(search_key);
   auto* table = table_.load(std::memory_order::memory_order_seq_cst);
+  size_t hash = Hash(search_key, table);
+  for (size_t count = 0; count < table->size(); count++) {
+    const auto control =
+        table->controls[hash].load(std::memory_order::memory_order_acquire);
+    if (control == EmptyControl) return nullptr;
+    if (control == search_key.control) {
+      auto& slot = (*table)[hash];
+      T* value   = nullptr;
+      if (ProbeSlot(slot, search_key, value) == ProbeResult::Match) {
+        const uint64_t meta =
+            slot.meta.load(std::memory_order::memory_order_acquire);
+        slot.meta.store(
+            MakeMeta(Deleted, Version(meta) + 1, Tag(meta), Length(meta)),
+            std::memory_order::memory_order_release);
+        deleted_count_.fetch_add(1);
+        return value;
+      }
+    }
+    hash++;
+    if (__builtin_expect(hash == table->size(), false)) hash = 0;
+  }
+  return nullptr;
+}
 
-  // NOTE changing the table size also changes the results of #Hash,
-  // since it is used as the salt.
-  TableType* new_table = new TableType(table->size() * 2);
+/**
+ * @brief
+ * Incremental and cooperative rehashing, in the same manner as the transfer
+ * of Java's ConcurrentHashMap. The rehash thread publishes the next table
+ * and migrates stripes; inserting threads which see the migration also help
+ * it (see #HelpRehash). Both tables are readable during the migration, and
+ * thus no reader and no writer waits for the whole copy.
+ * @note table_lock_ is held to exclude #ForEach and the beginning of
+ * #ParallelForEach during the migration.
+ */
+template <typename T>
+bool MPMCConcurrentSetImpl<T>::Rehash() {
+  if (is_cuckoo_) return CuckooRehash();
+  TableType* table = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(table_lock_);
+    table = table_.load(std::memory_order::memory_order_seq_cst);
 
-  // copy and rehashing all nodes
-  for (auto& bucket_atm : *table) {
-    auto* node = bucket_atm.load(std::memory_order::memory_order_relaxed);
+    // NOTE changing the table size also changes the results of #Hash,
+    // since it is used as the salt.
+    table->next.store(new TableType(NextTableSize(table)));
+    HelpRehash(table);
+    // The other helpers may be still migrating their stripes.
+    while (table_.load() == table) std::this_thread::yield();
+  }
 
-    if (node == nullptr) {
-      if (bucket_atm.compare_exchange_strong(node, GetRedirectedPtr())) {
-        continue;
-      } else {
-        node = bucket_atm.load(std::memory_order::memory_order_relaxed);
-      }
+  // QSBR-based garbage collection. The lock is released, since the readers
+  // may be a #ParallelForEach, which keeps the old table for a long time.
+  readers_.WaitForReaders();
+  delete table;
+  return true;
+}
+
+template <typename T>
+typename MPMCConcurrentSetImpl<T>::SetStatistics
+MPMCConcurrentSetImpl<T>::GetStatistics() {
+  SetStatistics statistics;
+  const size_t populated = populated_count_.load();
+  const size_t deleted   = std::min(populated, deleted_count_.load());
+  statistics.entries     = populated - deleted;
+  statistics.occupied    = populated;
+  // A table is freed after its readers; see #Rehash.
+  readers_.Enter();
+  auto* table         = table_.load();
+  statistics.capacity = table->size();
+  statistics.bytes    = 0;
+  for (; table != nullptr; table = table->next.load()) {
+    statistics.bytes += sizeof(TableType) + table->size() * sizeof(Slot) +
+                        table->controls.size() * sizeof(table->controls[0]);
+  }
+  readers_.Exit();
+  statistics.bytes += long_keys_.Bytes();
+  const auto [lookups, probes] = SumProbeStatistics();
+  statistics.lookups           = lookups - probe_baseline_.first;
+  statistics.probes            = probes - probe_baseline_.second;
+  return statistics;
+}
+
+/**
+ * @brief Returns the size of the table after rehashing: the same size if the
+ * live entries fill less than a half of the threshold, i.e., the rehashing
+ * just drops the Deleted slots, and the double size otherwise.
+ */
+template <typename T>
+size_t MPMCConcurrentSetImpl<T>::NextTableSize(const TableType* table) {
+  const size_t live = populated_count_.load() - deleted_count_.load();
+  if (live < table->size() * rehash_threshold_ / 2) return table->size();
+  return table->size() * 2;
+}
+
+template <typename T>
+void MPMCConcurrentSetImpl<T>::HelpRehash(TableType* table) {
+  auto* next           = table->next.load();
+  const size_t stripes = table->stripes();
+  for (;;) {
+    const size_t stripe = table->transfer_cursor.fetch_add(1);
+    if (stripes <= stripe) return;
+    const size_t end =
+        std::min(table->size(), (stripe + 1) * RehashStripeSize);
+    for (size_t i = stripe * RehashStripeSize; i < end; i++) {
+      MigrateSlot(table, i, next);
+    }
+    if (table->transferred_stripes.fetch_add(1) + 1 == stripes) {
+      table_.store(next, std::memory_order::memory_order_seq_cst);
     }
+  }
+}
 
-    size_t rehashed = Hash(node->key, new_table);
+template <typename T>
+void MPMCConcurrentSetImpl<T>::MigrateSlot(TableType* table, size_t index,
+                                           TableType* next) {
+  auto& slot    = (*table)[index];
+  uint64_t meta = slot.meta.load(std::memory_order::memory_order_acquire);
+  if (ClaimSlot(table, index, RedirectedControl)) {
+    slot.meta.store(MakeMeta(Redirected, Version(meta), 0, 0));
+    return;
+  }
+  for (;;) {
+    switch (State(meta)) {
+      case Empty:  // claimed by a writer, which is going to fill it.
+      case Busy:
+        std::this_thread::yield();
+        meta = slot.meta.load(std::memory_order::memory_order_acquire);
+        continue;
+      case Ready:
+        break;
+      case Deleted:  // dropped
+        populated_count_.fetch_sub(1);
+        deleted_count_.fetch_sub(1);
+        return;
+      default:
+        return;
+    }
 
-    // lineair probing
+    // Copy the entry into the next table. It cannot exist in the next table:
+    // a writer goes to the next table only after it has seen a Redirected
+    // slot, which precedes all the entries of its probe sequence.
+    const SearchKey key(KeyOf(slot, meta));
+    size_t rehashed = Hash(key, next);
     for (;;) {
-      auto& target_bucket = (*new_table)[rehashed];
-      if (target_bucket.load(std::memory_order::memory_order_relaxed) ==
-          nullptr) {
-        target_bucket.store(node);
+      if (ClaimSlot(next, rehashed, key.control)) {
+        auto& target           = (*next)[rehashed];
+        const uint64_t version = Version(target.meta.load()) + 1;
+        target.meta.store(MakeMeta(Busy, version, 0, 0));
+        CopySlot(target, version, slot);
         break;
       }
       rehashed++;
-      if (rehashed == new_table->size()) rehashed = 0;
+      if (rehashed == next->size()) rehashed = 0;
     }
 
-    [[maybe_unused]] bool exchanged =
-        bucket_atm.compare_exchange_strong(node, GetRedirectedPtr());
-    assert(exchanged);  // NOTE: This class provides concurrent `set` of
-    // `pointer`; we assume that pointer entries are never
-    // be deleted and updated.
+    [[maybe_unused]] bool exchanged = slot.meta.compare_exchange_strong(
+        meta, MakeMeta(Moved, Version(meta), Tag(meta), Length(meta)));
+    // NOTE: entries are never updated, and #Erase holds table_lock_, which
+    // excludes the migration.
+    assert(exchanged);
+    return;
   }
-
-  [[maybe_unused]] auto table_exchanged =
-      table_.compare_exchange_strong(table, new_table);
-  assert(table_exchanged);
-
-  // QSBR-based garbage collection
-  epoch_framework_.Sync();
-  delete table;
-  return true;
 }
 
 template <typename T>
-inline size_t MPMCConcurrentSetImpl<T>::Hash(std::string_view key,
+inline size_t MPMCConcurrentSetImpl<T>::Hash(const SearchKey& key,
                                              TableType* table) {
   auto capacity = table->size();
-  auto hashed = std::hash<std::string_view>()(key);
-  hashed = hashed ^ capacity;
+  auto hashed   = key.hash;
+  hashed        = hashed ^ capacity;
   return hashed % capacity;
 }
 
+template <typename T>
+inline std::pair<size_t, size_t> MPMCConcurrentSetImpl<T>::CuckooBuckets(
+    size_t hash, TableType* table) {
+  const uint64_t buckets = table->size() / CuckooBucketSize;
+  const uint64_t hashed  = hash;
+  const size_t first     = (hashed ^ buckets) % buckets;
+  // The second candidate is derived from the upper bits, so that keys
+  // colliding on the first bucket are spread over different second ones.
+  size_t second = ((hashed >> 32) * 0x9E3779B97F4A7C15ull) % buckets;
+  if (second == first) second = (first + 1) % buckets;
+  return {first, second};
+}
+
+template <typename T>
+inline T* MPMCConcurrentSetImpl<T>::FindInBucket(const SearchKey& key,
+                                                 TableType* table,
+                                                 size_t bucket,
+                                                 size_t& probes) {
+  for (size_t i = 0; i < CuckooBucketSize; i++) {
+    T* value = nullptr;
+    probes++;
+    if (ProbeSlot((*table)[bucket * CuckooBucketSize + i], key, value) ==
+        ProbeResult::Match) {
+      return value;
+    }
+  }
+  return nullptr;
+}
+
+template <typename T>
+T* MPMCConcurrentSetImpl<T>::CuckooGet(const SearchKey& search_key) {
+  readers_.Enter();
+  T* return_value_p = nullptr;
+  size_t probes     = 0;
+  for (;;) {
+    const auto version =
+        displacement_version_.load(std::memory_order::memory_order_acquire);
+    auto* table = table_.load(std::memory_order::memory_order_acquire);
+    const auto [first, second] = CuckooBuckets(search_key.hash, table);
+    __builtin_prefetch(&(*table)[second * CuckooBucketSize], 0,
+                       PREFETCH_LOCALITY);
+    return_value_p = FindInBucket(search_key, table, first, probes);
+    if (return_value_p == nullptr) {
+      return_value_p = FindInBucket(search_key, table, second, probes);
+    }
+    if (return_value_p != nullptr) break;
+
+    // A miss is reliable only if no entry has moved between the buckets
+    // during the probe.
+    std::atomic_thread_fence(std::memory_order::memory_order_acquire);
+    if ((version & 1) == 0 &&
+        version == displacement_version_.load(
+                       std::memory_order::memory_order_relaxed)) {
+      break;
+    }
+  }
+  readers_.Exit();
+  CountLookup(probes);
+  return return_value_p;
+}
+
+template <typename T>
+bool MPMCConcurrentSetImpl<T>::CuckooPut(const std::string_view key,
+                                         const T* const value_p) {
+  const SearchKey search_key(key);
+  if (CuckooGet(search_key) != nullptr) return false;
+
+  for (;;) {
+    TableType* table = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(table_lock_);
+      table = table_.load();
+      const auto [first, second] = CuckooBuckets(search_key.hash, table);
+      size_t unused              = 0;  // not a lookup of #Get
+      if (FindInBucket(search_key, table, first, unused) != nullptr ||
+          FindInBucket(search_key, table, second, unused) != nullptr) {
+        return false;
+      }
+      if (CuckooInsert(search_key, value_p, table)) {
+        const size_t current_stored = populated_count_.fetch_add(1);
+        const double current_fill_rate =
+            (current_stored / static_cast<double>(table->size()));
+        if (rehash_threshold_ < current_fill_rate) rehash_cv_.notify_one();
+        return true;
+      }
+    }
+    // No cuckoo path has found; grow the table by ourselves.
+    CuckooRehash(table);
+  }
+}
+
+/**
+ * @note table_lock_ must be held. The slot becomes Empty at once, since no
+ * probe sequence goes through it.
+ */
+template <typename T>
+T* MPMCConcurrentSetImpl<T>::CuckooErase(const SearchKey& search_key) {
+  auto* table                = table_.load();
+  const auto [first, second] = CuckooBuckets(search_key.hash, table);
+  for (const auto bucket : {first, second}) {
+    for (size_t i = 0; i < CuckooBucketSize; i++) {
+      auto& slot = (*table)[bucket * CuckooBucketSize + i];
+      T* value   = nullptr;
+      if (ProbeSlot(slot, search_key, value) != ProbeResult::Match) continue;
+      const uint64_t meta =
+          slot.meta.load(std::memory_order::memory_order_relaxed);
+      slot.meta.store(MakeMeta(Empty, Version(meta) + 1, 0, 0),
+                      std::memory_order::memory_order_release);
+      populated_count_.fetch_sub(1);
+      return value;
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * @note table_lock_ must be held. Searches a cuckoo path in breadth-first
+ * order and moves the entries from the end of the path, so that each entry
+ * is always reachable from at least one of its candidate buckets.
+ * If `source` is given, the new entry is copied from it (on rehashing).
+ */
+template <typename T>
+bool MPMCConcurrentSetImpl<T>::CuckooInsert(const SearchKey& key,
+                                            const T* const value,
+                                            TableType* table,
+                                            const Slot* source) {
+  auto find_empty_slot = [&](size_t bucket) -> std::optional<size_t> {
+    for (size_t i = 0; i < CuckooBucketSize; i++) {
+      const size_t slot = bucket * CuckooBucketSize + i;
+      if (State((*table)[slot].meta.load(
+              std::memory_order::memory_order_relaxed)) == Empty) {
+        return slot;
+      }
+    }
+    return std::nullopt;
+  };
+  // The slot is Empty or Ready here; we hold table_lock_.
+  auto lock_slot = [&](size_t slot) {
+    const uint64_t meta =
+        (*table)[slot].meta.load(std::memory_order::memory_order_relaxed);
+    const uint64_t version = Version(meta) + 1;
+    (*table)[slot].meta.store(MakeMeta(Busy, version, 0, 0),
+                              std::memory_order::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order::memory_order_release);
+    return version;
+  };
+  auto place = [&](size_t slot) {
+    if (source != nullptr) {
+      CopySlot((*table)[slot], lock_slot(slot), *source);
+    } else {
+      FillSlot((*table)[slot], lock_slot(slot), key, value);
+    }
+  };
+
+  const auto [first, second] = CuckooBuckets(key.hash, table);
+  for (const auto bucket : {first, second}) {
+    if (auto slot = find_empty_slot(bucket); slot.has_value()) {
+      place(slot.value());
+      return true;
+    }
+  }
+
+  // Each step moves the entry at `slot` of the parent's bucket into `bucket`.
+  struct Step {
+    size_t bucket;
+    size_t slot;
+    int parent;
+  };
+  std::vector<Step> steps{{first, 0, -1}, {second, 0, -1}};
+  auto is_on_path = [&](int index, size_t bucket) {
+    for (; index != -1; index = steps[index].parent) {
+      if (steps[index].bucket == bucket) return true;
+    }
+    return false;
+  };
+
+  for (size_t current = 0; current < steps.size(); current++) {
+    const size_t bucket = steps[current].bucket;
+    for (size_t i = 0; i < CuckooBucketSize; i++) {
+      const size_t slot   = bucket * CuckooBucketSize + i;
+      const auto& victim  = (*table)[slot];
+      const uint64_t meta = victim.meta.load();
+      const SearchKey victim_key(KeyOf(victim, meta));
+      auto [c1, c2]            = CuckooBuckets(victim_key.hash, table);
+      const size_t alternative = c1 == bucket ? c2 : c1;
+      if (is_on_path(current, alternative)) continue;
+
+      auto empty = find_empty_slot(alternative);
+      if (!empty.has_value()) {
+        if (steps.size() < CuckooMaxSearch) {
+          steps.push_back({alternative, slot, static_cast<int>(current)});
+        }
+        continue;
+      }
+
+      // Found: move entries from the end of the path.
+      displacement_version_.fetch_add(1);
+      size_t destination = empty.value();
+      size_t source      = slot;
+      for (int index = current;; index = steps[index].parent) {
+        CopySlot((*table)[destination], lock_slot(destination),
+                 (*table)[source]);
+        destination = source;
+        if (steps[index].parent == -1) break;
+        source = steps[index].slot;
+      }
+      place(destination);
+      displacement_version_.fetch_add(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename T>
+bool MPMCConcurrentSetImpl<T>::CuckooRehash(TableType* expected) {
+  TableType* table = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(table_lock_);
+    table = table_.load(std::memory_order::memory_order_seq_cst);
+    // Another thread has already grown the table.
+    if (expected != nullptr && expected != table) return false;
+
+    // Readers keep probing the old table until the new one is published;
+    // writers are blocked by table_lock_.
+    for (size_t size = table->size() * 2;; size *= 2) {
+      TableType* new_table = new TableType(size);
+      bool succeed         = true;
+      for (auto& slot : table->slots) {
+        const uint64_t meta =
+            slot.meta.load(std::memory_order::memory_order_relaxed);
+        if (State(meta) != Ready) continue;
+        const SearchKey key(KeyOf(slot, meta));
+        if (!CuckooInsert(key, nullptr, new_table, &slot)) {
+          succeed = false;
+          break;
+        }
+      }
+      if (succeed) {
+        table_.store(new_table, std::memory_order::memory_order_seq_cst);
+        break;
+      }
+      delete new_table;
+    }
+  }
+
+  // QSBR-based garbage collection
+  readers_.WaitForReaders();
+  delete table;
+  return true;
+}
+
 template <typename T>
 void MPMCConcurrentSetImpl<T>::Clear() {
   std::lock_guard<std::mutex> lock(table_lock_);
   auto* table = table_.load(std::memory_order::memory_order_seq_cst);
-  for (auto& bucket_atm : *table) {
-    auto* node = bucket_atm.load(std::memory_order::memory_order_seq_cst);
-    if (node == nullptr) continue;
-    delete node->value;
-
-    delete node;
+  for (auto& slot : table->slots) {
+    const uint64_t meta =
+        slot.meta.load(std::memory_order::memory_order_seq_cst);
+    if (State(meta) != Ready) continue;
+    delete slot.value.load();
   }
-  table->clear();
+  table->slots.clear();
 }
 
 template <typename T>
 void MPMCConcurrentSetImpl<T>::ForEach(
     std::function<bool(std::string_view, T&)> f) {
   std::lock_guard<std::mutex> lock(table_lock_);
-  epoch_framework_.MakeMeOnline();
+  readers_.Enter();
   auto* table = table_.load(std::memory_order::memory_order_seq_cst);
-  for (auto& bucket_atm : *table) {
-    auto* node = bucket_atm.load(std::memory_order::memory_order_seq_cst);
-    if (node == nullptr) continue;
-    assert(!IsRedirectedPtr(node));
-    auto is_success = f(node->key, *const_cast<T*>(node->value));
+  for (auto& slot : table->slots) {
+    uint64_t meta = slot.meta.load(std::memory_order::memory_order_seq_cst);
+    while (State(meta) == Busy) {
+      std::this_thread::yield();
+      meta = slot.meta.load(std::memory_order::memory_order_seq_cst);
+    }
+    if (State(meta) != Ready) continue;
+    auto is_success =
+        f(KeyOf(slot, meta), *const_cast<T*>(slot.value.load()));
     if (!is_success) break;
   }
-  epoch_framework_.MakeMeOffline();
+  readers_.Exit();
+}
+
+/**
+ * @note With LinearProbing, the table is only pinned by readers_, so that
+ * the rehashing and the writers run concurrently; the keys and the values of
+ * the Ready and Moved slots are never rewritten in the table. The table is
+ * pinned under table_lock_, i.e., not during a migration, in which the
+ * writers put keys into the next table; the keys put after the pin are not
+ * visited. The cuckoo displacements rewrite the slots, and thus a cuckoo
+ * table is visited under table_lock_, which its writers hold anyway.
+ */
+template <typename T>
+void MPMCConcurrentSetImpl<T>::ParallelForEach(
+    size_t partitions, std::function<bool(size_t, std::string_view, T&)> f,
+    const PartitionRunner& run) {
+  std::unique_lock<std::mutex> lock(table_lock_);
+  readers_.Enter();
+  auto* table = table_.load(std::memory_order::memory_order_seq_cst);
+  if (!is_cuckoo_) lock.unlock();
+  const size_t size = table->slots.size();
+  partitions        = std::max<size_t>(1, std::min(partitions, size));
+
+  run(partitions, [&](size_t partition) {
+    const size_t begin = size * partition / partitions;
+    const size_t end   = size * (partition + 1) / partitions;
+    for (size_t i = begin; i < end; i++) {
+      auto& slot    = table->slots[i];
+      uint64_t meta = slot.meta.load(std::memory_order::memory_order_seq_cst);
+      while (State(meta) == Busy) {
+        std::this_thread::yield();
+        meta = slot.meta.load(std::memory_order::memory_order_seq_cst);
+      }
+      if (State(meta) != Ready && State(meta) != Moved) continue;
+      auto is_success = f(partition, KeyOf(slot, meta),
+                          *const_cast<T*>(slot.value.load()));
+      if (!is_success) break;
+    }
+  });
+  readers_.Exit();
 }
 
 }  // namespace Index
@@ -0,0 +1,94 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_INDEX_DISJOINT_RANGE_SET_HPP
+#define LINEAIRDB_INDEX_DISJOINT_RANGE_SET_HPP
+
+#include <functional>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace LineairDB {
+namespace Index {
+
+/**
+ * @brief
+ * A set of closed key ranges. Overlapping ranges are merged at insertion, and
+ * thus the set always consists of sorted and disjoint ranges. It is enough
+ * for phantom detection since we only ask whether *some* predicate contains a
+ * key; both Insert and Contains take logarithmic time of the number of
+ * ranges.
+ * std::nullopt as the end of a range means the end of the key space.
+ */
+class DisjointRangeSet {
+ public:
+  void Insert(const std::string_view b,
+              const std::optional<std::string_view> e) {
+    std::string begin(b);
+    std::optional<std::string> end;
+    if (e.has_value()) end.emplace(e.value());
+
+    auto it = ranges_.upper_bound(begin);
+    if (it != ranges_.begin()) {
+      auto prev = std::prev(it);
+      if (Covers(prev, begin)) {
+        if (!prev->second.has_value()) return;
+        if (end.has_value() && end.value() <= prev->second.value()) return;
+        begin = prev->first;
+        it    = prev;
+      }
+    }
+    while (it != ranges_.end() &&
+           (!end.has_value() || it->first <= end.value())) {
+      if (!it->second.has_value()) {
+        end.reset();
+      } else if (end.has_value() && end.value() < it->second.value()) {
+        end = it->second;
+      }
+      it = ranges_.erase(it);
+    }
+    ranges_.emplace(std::move(begin), std::move(end));
+  }
+
+  bool Contains(const std::string_view key) const {
+    auto it = ranges_.upper_bound(key);
+    if (it == ranges_.begin()) return false;
+    return Covers(std::prev(it), key);
+  }
+
+  bool empty() const { return ranges_.empty(); }
+  size_t size() const { return ranges_.size(); }
+
+ private:
+  using RangeMap =
+      std::map<std::string, std::optional<std::string>, std::less<>>;
+
+  static bool Covers(RangeMap::const_iterator range,
+                     const std::string_view key) {
+    return range->first <= key &&
+           (!range->second.has_value() || key <= range->second.value());
+  }
+
+  RangeMap ranges_;
+};
+
+}  // namespace Index
+}  // namespace LineairDB
+
+#endif /* LINEAIRDB_INDEX_DISJOINT_RANGE_SET_HPP */
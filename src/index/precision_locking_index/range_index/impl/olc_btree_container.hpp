@@ -0,0 +1,497 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_INDEX_OLC_BTREE_CONTAINER_HPP
+#define LINEAIRDB_INDEX_OLC_BTREE_CONTAINER_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "index/key_store.hpp"
+#include "index/precision_locking_index/range_index/range_index_container_base.h"
+
+namespace LineairDB {
+namespace Index {
+
+/**
+ * @brief
+ * B+-tree synchronized by optimistic lock coupling (OLC) [1].
+ * Readers never write to shared memory: they remember the version of each
+ * node, read the node, and restart if the version has changed in the
+ * meantime. Writers lock only the nodes they modify, so that scans and
+ * inserts on disjoint key ranges do not contend.
+ *
+ * @note
+ * Nodes and keys are immutable once they are published and are never
+ * deallocated until the destruction of the tree; deletion is represented as a
+ * flag of each entry. Thus an optimistic reader can safely dereference a stale
+ * pointer without any memory reclamation scheme. The keys are interned in a
+ * KeyStore; the leaves and the separators in the inner nodes share them.
+ *
+ * @ref [1] https://db.in.tum.de/~leis/papers/artsync.pdf
+ */
+class OLCBTreeContainer final : public RangeIndexContainerBase {
+ public:
+  OLCBTreeContainer() : root_(new Leaf()), bytes_(sizeof(Leaf)) {}
+  ~OLCBTreeContainer() { Destroy(root_.load()); }
+
+  using RangeIndexContainerBase::Scan;
+
+  void Put(const std::string_view key, const bool is_deleted,
+           void* value = nullptr) final override {
+  restart:
+    bool need_restart = false;
+    NodeBase* node    = root_.load();
+    uint64_t version  = node->ReadLockOrRestart(need_restart);
+    if (need_restart || node != root_.load()) goto restart;
+
+    Inner* parent           = nullptr;
+    uint64_t parent_version = 0;
+
+    while (!node->is_leaf) {
+      auto* inner = static_cast<Inner*>(node);
+
+      // Split eagerly on the way down, so that the parent always has room for
+      // a new separator.
+      if (inner->IsFull()) {
+        if (!LockForSplit(parent, parent_version, node, version)) goto restart;
+        const Key* separator = nullptr;
+        auto* new_inner              = inner->Split(separator);
+        CountBytes(sizeof(Inner));
+        if (parent != nullptr) {
+          parent->Insert(separator, new_inner);
+        } else {
+          MakeRoot(separator, inner, new_inner);
+        }
+        node->WriteUnlock();
+        if (parent != nullptr) parent->WriteUnlock();
+        goto restart;
+      }
+
+      if (parent != nullptr) {
+        parent->ReadUnlockOrRestart(parent_version, need_restart);
+        if (need_restart) goto restart;
+      }
+      parent         = inner;
+      parent_version = version;
+
+      node = inner->children[inner->LowerBound(key, need_restart)].load();
+      inner->CheckOrRestart(version, need_restart);
+      if (need_restart) goto restart;
+      version = node->ReadLockOrRestart(need_restart);
+      if (need_restart) goto restart;
+    }
+
+    auto* leaf = static_cast<Leaf*>(node);
+    if (leaf->IsFull()) {
+      if (!LockForSplit(parent, parent_version, node, version)) goto restart;
+      const Key* separator = nullptr;
+      auto* new_leaf               = leaf->Split(separator);
+      CountBytes(sizeof(Leaf));
+      if (parent != nullptr) {
+        parent->Insert(separator, new_leaf);
+      } else {
+        MakeRoot(separator, leaf, new_leaf);
+      }
+      node->WriteUnlock();
+      if (parent != nullptr) parent->WriteUnlock();
+      goto restart;
+    }
+
+    node->UpgradeToWriteLockOrRestart(version, need_restart);
+    if (need_restart) goto restart;
+    if (parent != nullptr) {
+      parent->ReadUnlockOrRestart(parent_version, need_restart);
+      if (need_restart) {
+        node->WriteUnlock();
+        goto restart;
+      }
+    }
+    leaf->Insert(key, is_deleted, value, keys_);
+    node->WriteUnlock();
+  }
+
+  size_t MemoryUsage() const final override {
+    return bytes_.load(std::memory_order_relaxed) + keys_.Bytes();
+  }
+
+  size_t Scan(const std::string_view begin,
+              const std::optional<std::string_view> end,
+              std::function<bool(std::string_view, void*)> operation)
+      final override {
+    size_t hit = 0;
+    // Keys handed to the operation are excluded when we restart the scan
+    // from the point where it has stopped.
+    std::string_view resume_key = begin;
+    bool resume_exclusive       = false;
+    struct Entry {
+      const Key* key;
+      bool is_deleted;
+      void* value;
+    };
+    std::array<Entry, Leaf::Capacity> entries;
+
+  restart:
+    bool need_restart = false;
+    uint64_t version  = 0;
+    Leaf* leaf        = FindLeaf(resume_key, version);
+
+    for (;;) {
+      size_t n_entries  = 0;
+      bool reached_end  = false;
+      const auto count  = leaf->Count();
+      const size_t from = leaf->LowerBound(resume_key, need_restart);
+      for (size_t i = from; i < count && !need_restart; i++) {
+        const auto* key = leaf->keys[i].load(std::memory_order_relaxed);
+        if (key == nullptr) {
+          need_restart = true;
+          break;
+        }
+        if (resume_exclusive && key->View() == resume_key) continue;
+        if (end.has_value() && end.value() < key->View()) {
+          reached_end = true;
+          break;
+        }
+        entries[n_entries++] = {
+            key, leaf->is_deleted[i].load(std::memory_order_relaxed),
+            leaf->values[i].load(std::memory_order_relaxed)};
+      }
+      Leaf* next = leaf->next.load(std::memory_order_relaxed);
+      leaf->ReadUnlockOrRestart(version, need_restart);
+      if (need_restart) goto restart;
+
+      for (size_t i = 0; i < n_entries; i++) {
+        resume_key       = entries[i].key->View();
+        resume_exclusive = true;
+        if (entries[i].is_deleted) continue;
+        hit++;
+        if (operation(resume_key, entries[i].value)) return hit;
+      }
+      if (reached_end || next == nullptr) return hit;
+
+      leaf    = next;
+      version = leaf->ReadLockOrRestart(need_restart);
+      if (need_restart) goto restart;
+    }
+  }
+
+ private:
+  using Key = KeyStore::Key;
+
+  /**
+   * @brief
+   * The version number works as a lock; the lowest bit indicates that a
+   * writer holds the node. Unlocking increments the version, and thus
+   * optimistic readers detect any modification by comparing versions.
+   */
+  struct NodeBase {
+    std::atomic<uint64_t> version;
+    std::atomic<uint16_t> count;
+    const bool is_leaf;
+
+    explicit NodeBase(bool leaf) : version(0), count(0), is_leaf(leaf) {}
+
+    static bool IsLocked(uint64_t v) { return (v & 1) == 1; }
+
+    uint64_t ReadLockOrRestart(bool& need_restart) const {
+      const uint64_t v = version.load(std::memory_order_acquire);
+      if (IsLocked(v)) need_restart = true;
+      return v;
+    }
+    void ReadUnlockOrRestart(uint64_t v, bool& need_restart) const {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (v != version.load(std::memory_order_relaxed)) need_restart = true;
+    }
+    void CheckOrRestart(uint64_t v, bool& need_restart) const {
+      ReadUnlockOrRestart(v, need_restart);
+    }
+    void UpgradeToWriteLockOrRestart(uint64_t& v, bool& need_restart) {
+      if (version.compare_exchange_strong(v, v + 1)) {
+        v = v + 1;
+      } else {
+        need_restart = true;
+      }
+    }
+    void WriteUnlock() { version.fetch_add(1, std::memory_order_release); }
+  };
+
+  /**
+   * @brief
+   * Sorted keys with their 8-byte prefixes inline. The prefixes are
+   * big-endian, and thus compared as integers in the lexical order of the
+   * keys; a search dereferences a key only when the prefixes are equal.
+   */
+  template <size_t N>
+  struct SortedKeys {
+    std::array<std::atomic<const Key*>, N> keys;
+    std::array<std::atomic<uint64_t>, N> prefixes;
+
+    SortedKeys() {
+      for (auto& key : keys) key.store(nullptr, std::memory_order_relaxed);
+      for (auto& prefix : prefixes) {
+        prefix.store(0, std::memory_order_relaxed);
+      }
+    }
+
+    static uint64_t PrefixOf(const std::string_view key) {
+      uint64_t prefix = 0;
+      std::memcpy(&prefix, key.data(), std::min(key.size(), sizeof(prefix)));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+      prefix = __builtin_bswap64(prefix);
+#endif
+      return prefix;
+    }
+
+    // The following member functions require the write lock.
+    void SetKey(const size_t i, const Key* key) {
+      keys[i].store(key, std::memory_order_relaxed);
+      prefixes[i].store(PrefixOf(key->View()), std::memory_order_relaxed);
+    }
+    void CopyKey(const size_t i, const SortedKeys& from, const size_t j) {
+      keys[i].store(from.keys[j].load(std::memory_order_relaxed),
+                    std::memory_order_relaxed);
+      prefixes[i].store(from.prefixes[j].load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Returns the first position whose key is not less than the given
+     * key. A torn (optimistic) read may give a null key; we report it as a
+     * restart since the version check would fail anyway.
+     */
+    size_t LowerBound(const NodeBase* node, const std::string_view key,
+                      bool& need_restart) const {
+      const uint64_t prefix = PrefixOf(key);
+      size_t lower          = 0;
+      size_t upper          = std::min<size_t>(node->count.load(), N);
+      while (lower < upper) {
+        const size_t mid = (lower + upper) / 2;
+        const auto p     = prefixes[mid].load(std::memory_order_relaxed);
+        bool is_less     = p < prefix;
+        if (p == prefix) {
+          const auto* k = keys[mid].load(std::memory_order_relaxed);
+          if (k == nullptr) {
+            need_restart = true;
+            return 0;
+          }
+          is_less = k->View() < key;
+        }
+        if (is_less) {
+          lower = mid + 1;
+        } else {
+          upper = mid;
+        }
+      }
+      return lower;
+    }
+  };
+
+  struct Leaf : NodeBase, SortedKeys<64> {
+    static constexpr size_t Capacity = 64;
+    std::array<std::atomic<bool>, Capacity> is_deleted;
+    std::array<std::atomic<void*>, Capacity> values;
+    std::atomic<Leaf*> next;
+
+    Leaf() : NodeBase(true), next(nullptr) {
+      for (auto& flag : is_deleted) flag.store(false);
+      for (auto& value : values) value.store(nullptr);
+    }
+
+    size_t Count() const { return std::min<size_t>(count.load(), Capacity); }
+    bool IsFull() const { return Count() == Capacity; }
+    size_t LowerBound(const std::string_view key, bool& need_restart) const {
+      return SortedKeys::LowerBound(this, key, need_restart);
+    }
+
+    // The following member functions require the write lock.
+    // interns the key into `store` if it is not in the leaf yet.
+    void Insert(const std::string_view key, const bool deleted, void* value,
+                KeyStore& store) {
+      bool unused    = false;
+      const auto pos = LowerBound(key, unused);
+      const auto n   = Count();
+      if (pos < n && keys[pos].load()->View() == key) {
+        is_deleted[pos].store(deleted, std::memory_order_relaxed);
+        if (!deleted) values[pos].store(value, std::memory_order_relaxed);
+        return;
+      }
+      for (size_t i = n; i > pos; i--) {
+        CopyKey(i, *this, i - 1);
+        is_deleted[i].store(is_deleted[i - 1].load(),
+                            std::memory_order_relaxed);
+        values[i].store(values[i - 1].load(), std::memory_order_relaxed);
+      }
+      SetKey(pos, store.Intern(key));
+      is_deleted[pos].store(deleted, std::memory_order_relaxed);
+      values[pos].store(value, std::memory_order_relaxed);
+      count.store(n + 1, std::memory_order_relaxed);
+    }
+
+    Leaf* Split(const Key*& separator) {
+      auto* new_leaf  = new Leaf();
+      const auto n    = Count();
+      const auto left = n / 2;
+      for (size_t i = left; i < n; i++) {
+        new_leaf->CopyKey(i - left, *this, i);
+        new_leaf->is_deleted[i - left].store(is_deleted[i].load());
+        new_leaf->values[i - left].store(values[i].load());
+      }
+      new_leaf->count.store(n - left);
+      new_leaf->next.store(next.load());
+      // The new leaf is published only by the following stores.
+      next.store(new_leaf, std::memory_order_release);
+      count.store(left, std::memory_order_relaxed);
+      separator = keys[left - 1].load();
+      return new_leaf;
+    }
+  };
+
+  struct Inner : NodeBase, SortedKeys<64> {
+    static constexpr size_t Capacity = 64;
+    std::array<std::atomic<NodeBase*>, Capacity + 1> children;
+
+    Inner() : NodeBase(false) {
+      for (auto& child : children) child.store(nullptr);
+    }
+
+    size_t Count() const { return std::min<size_t>(count.load(), Capacity); }
+    bool IsFull() const { return Count() == Capacity - 1; }
+    size_t LowerBound(const std::string_view key, bool& need_restart) const {
+      return SortedKeys::LowerBound(this, key, need_restart);
+    }
+
+    // The following member functions require the write lock.
+    // Separators are not copied; they share the keys of the leaves.
+    void Insert(const Key* separator, NodeBase* right) {
+      bool unused    = false;
+      const auto pos = LowerBound(separator->View(), unused);
+      const auto n   = Count();
+      for (size_t i = n; i > pos; i--) {
+        CopyKey(i, *this, i - 1);
+        children[i + 1].store(children[i].load(), std::memory_order_relaxed);
+      }
+      SetKey(pos, separator);
+      children[pos + 1].store(right, std::memory_order_relaxed);
+      count.store(n + 1, std::memory_order_relaxed);
+    }
+
+    Inner* Split(const Key*& separator) {
+      auto* new_inner = new Inner();
+      const auto n    = Count();
+      const auto left = n / 2;
+      // keys[left] moves up to the parent.
+      for (size_t i = left + 1; i < n; i++) {
+        new_inner->CopyKey(i - left - 1, *this, i);
+      }
+      for (size_t i = left + 1; i <= n; i++) {
+        new_inner->children[i - left - 1].store(children[i].load());
+      }
+      new_inner->count.store(n - left - 1);
+      separator = keys[left].load();
+      count.store(left, std::memory_order_relaxed);
+      return new_inner;
+    }
+  };
+
+  /**
+   * @brief Takes write locks of the parent and the node before splitting.
+   * @return false if the caller has to restart.
+   */
+  bool LockForSplit(Inner* parent, uint64_t parent_version, NodeBase* node,
+                    uint64_t version) {
+    bool need_restart = false;
+    if (parent != nullptr) {
+      parent->UpgradeToWriteLockOrRestart(parent_version, need_restart);
+      if (need_restart) return false;
+    }
+    node->UpgradeToWriteLockOrRestart(version, need_restart);
+    if (need_restart) {
+      if (parent != nullptr) parent->WriteUnlock();
+      return false;
+    }
+    if (parent == nullptr && node != root_.load()) {
+      // Another thread has grown the tree; a new parent exists.
+      node->WriteUnlock();
+      return false;
+    }
+    return true;
+  }
+
+  void MakeRoot(const Key* separator, NodeBase* left, NodeBase* right) {
+    auto* inner = new Inner();
+    CountBytes(sizeof(Inner));
+    inner->SetKey(0, separator);
+    inner->children[0].store(left);
+    inner->children[1].store(right);
+    inner->count.store(1);
+    root_.store(inner);
+  }
+
+  Leaf* FindLeaf(const std::string_view key, uint64_t& version) {
+  restart:
+    bool need_restart = false;
+    NodeBase* node    = root_.load();
+    version           = node->ReadLockOrRestart(need_restart);
+    if (need_restart || node != root_.load()) goto restart;
+
+    while (!node->is_leaf) {
+      auto* inner     = static_cast<Inner*>(node);
+      NodeBase* child = inner->children[inner->LowerBound(key, need_restart)];
+      inner->CheckOrRestart(version, need_restart);
+      if (need_restart) goto restart;
+      const uint64_t child_version = child->ReadLockOrRestart(need_restart);
+      inner->CheckOrRestart(version, need_restart);
+      if (need_restart) goto restart;
+      node    = child;
+      version = child_version;
+    }
+    return static_cast<Leaf*>(node);
+  }
+
+  void Destroy(NodeBase* node) {
+    if (node->is_leaf) {
+      auto* leaf = static_cast<Leaf*>(node);
+      delete leaf;
+      return;
+    }
+    auto* inner = static_cast<Inner*>(node);
+    for (size_t i = 0; i <= inner->Count(); i++) {
+      Destroy(inner->children[i].load());
+    }
+    delete inner;
+  }
+
+  // NOTE: called by the writers while they hold a node.
+  void CountBytes(const size_t bytes) { bytes_.fetch_add(bytes); }
+
+  std::atomic<NodeBase*> root_;
+  std::atomic<size_t> bytes_;  // the nodes
+  KeyStore keys_;
+};
+
+}  // namespace Index
+}  // namespace LineairDB
+
+#endif /* LINEAIRDB_INDEX_OLC_BTREE_CONTAINER_HPP */
@@ -0,0 +1,123 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_INDEX_STD_MAP_CONTAINER_HPP
+#define LINEAIRDB_INDEX_STD_MAP_CONTAINER_HPP
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "index/key_store.hpp"
+#include "index/precision_locking_index/range_index/range_index_container_base.h"
+
+namespace LineairDB {
+namespace Index {
+
+/**
+ * @brief
+ * std::map guarded by a readers-writer lock.
+ * Scans share the lock with each other and conflict only with updates.
+ */
+class StdMapContainer final : public RangeIndexContainerBase {
+ public:
+  using RangeIndexContainerBase::Scan;
+
+  void Put(const std::string_view key, const bool is_deleted,
+           void* value = nullptr) final override {
+    std::lock_guard<decltype(lock_)> guard(lock_);
+    auto it = container_.find(key);
+    if (it == container_.end()) {
+      it = container_.emplace(keys_.Intern(key)->View(), IndexItem{}).first;
+      bytes_.store(bytes_.load(std::memory_order_relaxed) + NodeBytes,
+                   std::memory_order_relaxed);
+    }
+    it->second.is_deleted = is_deleted;
+    if (!is_deleted) it->second.value = value;
+  }
+
+  size_t MemoryUsage() const final override {
+    return bytes_.load(std::memory_order_relaxed) + keys_.Bytes();
+  }
+
+  /**
+   * @note The entries are copied in batches, and the operation is invoked
+   * without holding the lock: it may wait for a transaction that is putting
+   * a key, which waits for the lock.
+   */
+  size_t Scan(const std::string_view begin,
+              const std::optional<std::string_view> end,
+              std::function<bool(std::string_view, void*)> operation)
+      final override {
+    size_t hit = 0;
+    std::array<std::pair<std::string_view, void*>, BatchSize> entries;
+    std::string_view resume_key = begin;
+    bool resume_exclusive       = false;
+    for (;;) {
+      size_t n_entries = 0;
+      bool reached_end = false;
+      {
+        std::shared_lock<decltype(lock_)> guard(lock_);
+        auto it = resume_exclusive ? container_.upper_bound(resume_key)
+                                   : container_.lower_bound(resume_key);
+        for (; n_entries < BatchSize; it++) {
+          if (it == container_.end() ||
+              (end.has_value() && end.value() < it->first)) {
+            reached_end = true;
+            break;
+          }
+          resume_key = it->first;
+          if (it->second.is_deleted) continue;
+          entries[n_entries++] = {it->first, it->second.value};
+        }
+      }
+      resume_exclusive = true;
+      for (size_t i = 0; i < n_entries; i++) {
+        hit++;
+        if (operation(entries[i].first, entries[i].second)) return hit;
+      }
+      if (reached_end) return hit;
+    }
+  }
+
+ private:
+  struct IndexItem {
+    bool is_deleted = false;
+    void* value     = nullptr;
+  };
+  static constexpr size_t BatchSize = 64;
+  // the pointers and the color of a red-black tree node, and its entry.
+  static constexpr size_t NodeBytes =
+      4 * sizeof(void*) + sizeof(std::string_view) + sizeof(IndexItem);
+
+  // The keys are views of the ones interned in keys_.
+  std::map<std::string_view, IndexItem> container_;
+  std::shared_mutex lock_;
+  std::atomic<size_t> bytes_{0};  // the nodes
+  KeyStore keys_;
+};
+
+}  // namespace Index
+}  // namespace LineairDB
+
+#endif /* LINEAIRDB_INDEX_STD_MAP_CONTAINER_HPP */
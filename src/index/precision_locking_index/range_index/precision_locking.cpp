@@ -16,64 +16,35 @@
 
 #include "precision_locking.h"
 
-#include <algorithm>
-#include <atomic>
-#include <cassert>
 #include <functional>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <string>
 #include <string_view>
-#include <vector>
+#include <utility>
 
-#include "types/data_item.hpp"
 #include "types/definitions.h"
 
 namespace LineairDB {
 namespace Index {
 
-PrecisionLockingIndex::PrecisionLockingIndex(LineairDB::EpochFramework& e)
-    : epoch_manager_ref_(e), manager_stop_flag_(false), manager_([&]() {
+PrecisionLockingIndex::PrecisionLockingIndex(
+    LineairDB::EpochFramework& e,
+    std::unique_ptr<RangeIndexContainerBase>&& container)
+    : container_(std::move(container)),
+      epoch_manager_ref_(e),
+      manager_stop_flag_(false),
+      manager_([&]() {
         while (manager_stop_flag_.load() != true) {
           epoch_manager_ref_.Sync();
           const auto global       = epoch_manager_ref_.GetGlobalEpoch();
           const auto stable_epoch = global - 2;
-
           {
+            // Clear predicate list
             std::lock_guard<decltype(plock_)> p_guard(plock_);
-            std::lock_guard<decltype(ulock_)> u_guard(ulock_);
-            {
-              // Clear predicate list
-              auto it = predicate_list_.begin();
-              if (it->first <= stable_epoch) {
-                const auto beg = it;
-                while (it != predicate_list_.end() &&
-                       it->first <= stable_epoch) {
-                  it++;
-                }
-                predicate_list_.erase(beg, it);
-              }
-            }
-            {
-              // Clear insert_or_delete_keys
-              auto it = insert_or_delete_key_set_.begin();
-              if (it->first <= stable_epoch) {
-                const auto beg = it;
-                while (it != insert_or_delete_key_set_.end() &&
-                       it->first <= stable_epoch) {
-                  it++;
-                }
-                const auto end = it;
-
-                // Before deleting the set of insert_or_delete_keys, we update
-                // the index container to apply such outdated (already
-                // committed) insertions and deletions.
-                for (it = beg; it != end; it++) {
-                  for (const auto& event : it->second) {
-                    container_[event.key].is_deleted = event.is_delete_event;
-                  }
-                }
-                insert_or_delete_key_set_.erase(beg, end);
-              }
-            }
+            predicate_list_.erase(predicate_list_.begin(),
+                                  predicate_list_.upper_bound(stable_epoch));
           }
         }
       }){};
@@ -86,82 +57,77 @@ PrecisionLockingIndex::~PrecisionLockingIndex() {
 std::optional<size_t> PrecisionLockingIndex::Scan(
     const std::string_view b, const std::optional<std::string_view> e,
     std::function<bool(std::string_view)> operation) {
-  size_t hit       = 0;
-  const auto begin = std::string(b);
-  auto end         = begin;
-  if (e.has_value()) {
-    end = std::string(e.value());
-    if (end < begin) return std::nullopt;
-  }
+  return Scan(b, e,
+              [&](std::string_view key, void*) { return operation(key); });
+}
 
-  std::lock_guard<decltype(plock_)> p_guard(plock_);
-  std::shared_lock<decltype(ulock_)> u_guard(ulock_);
-  if (IsOverlapWithInsertOrDelete(b, e)) { return std::nullopt; }
+std::optional<size_t> PrecisionLockingIndex::Scan(
+    const std::string_view b, const std::optional<std::string_view> e,
+    std::function<bool(std::string_view, void*)> operation) {
+  if (e.has_value() && e.value() < b) return std::nullopt;
 
   {
-    auto it     = container_.lower_bound(begin);
-    auto it_end = container_.end();
-    if (e.has_value()) { it_end = container_.upper_bound(end); }
-    for (; it != it_end; it++) {
-      if (it->second.is_deleted) continue;
-      hit++;
-      auto cancel = operation(it->first);
-      if (cancel) break;
-    }
+    // Registering the predicate must be atomic against Insert/Delete, which
+    // hold plock_ while they check the predicates and update the container;
+    // an update either precedes this scan in the container, or is rejected
+    // by the predicate. Iterating the container needs no lock.
+    std::lock_guard<decltype(plock_)> p_guard(plock_);
+    const auto epoch = epoch_manager_ref_.GetMyThreadLocalEpoch();
+    predicate_list_[epoch].Insert(b, e);
   }
 
-  const auto epoch = epoch_manager_ref_.GetMyThreadLocalEpoch();
-
-  predicate_list_[epoch].emplace_back(b, e);
-
-  return hit;
+  return container_->Scan(b, e, operation);
 };
-bool PrecisionLockingIndex::Insert(const std::string_view key) {
+bool PrecisionLockingIndex::Insert(const std::string_view key, void* value) {
   std::shared_lock<decltype(plock_)> p_guard(plock_);
   if (IsInPredicateSet(key)) { return false; }
-
-  const auto epoch = epoch_manager_ref_.GetMyThreadLocalEpoch();
-  std::lock_guard<decltype(ulock_)> u_guard(ulock_);
-  insert_or_delete_key_set_[epoch].emplace_back(key, false);
+  container_->Put(key, false, value);
 
   return true;
 };
 
-void PrecisionLockingIndex::ForceInsert(const std::string_view key) {
-  const auto epoch = epoch_manager_ref_.GetMyThreadLocalEpoch();
-  std::lock_guard<decltype(ulock_)> u_guard(ulock_);
-  insert_or_delete_key_set_[epoch].emplace_back(key, false);
+/**
+ * @note It does not detect phantoms. The point index already has the key,
+ * or the key is of a blank entry, which the scans find uninitialized; see
+ * HashTableWithPrecisionLockingIndex.
+ */
+void PrecisionLockingIndex::ForceInsert(const std::string_view key,
+                                        void* value) {
+  container_->Put(key, false, value);
+}
+
+void PrecisionLockingIndex::InsertDirectly(const std::string_view key,
+                                           void* value) {
+  container_->Put(key, false, value);
 }
 
 bool PrecisionLockingIndex::Delete(const std::string_view key) {
   std::shared_lock<decltype(plock_)> p_guard(plock_);
   if (IsInPredicateSet(key)) { return false; }
-  const auto epoch = epoch_manager_ref_.GetMyThreadLocalEpoch();
-  std::lock_guard<decltype(ulock_)> u_guard(ulock_);
-  insert_or_delete_key_set_[epoch].emplace_back(key, true);
+  container_->Put(key, true, nullptr);
 
   return true;
 };
 
-bool PrecisionLockingIndex::IsInPredicateSet(const std::string_view key) {
-  for (auto it = predicate_list_.begin(); it != predicate_list_.end(); it++) {
-    for (const auto& predicate : it->second) {
-      if (predicate.begin <= key && key <= predicate.end) return true;
+/**
+ * @note The entries of L_p are estimated as tree nodes with a pair of keys.
+ */
+PrecisionLockingIndex::Usage PrecisionLockingIndex::GetUsage() {
+  constexpr size_t NodeBytes = 4 * sizeof(void*) + 2 * sizeof(std::string);
+  Usage usage{0, container_->MemoryUsage()};
+  {
+    std::shared_lock<decltype(plock_)> p_guard(plock_);
+    for (const auto& [epoch, predicates] : predicate_list_) {
+      usage.predicates += predicates.size();
     }
   }
-  return false;
+  usage.bytes += usage.predicates * NodeBytes;
+  return usage;
 }
 
-bool PrecisionLockingIndex::IsOverlapWithInsertOrDelete(
-    const std::string_view begin, const std::optional<std::string_view> end) {
-  for (auto it = insert_or_delete_key_set_.begin();
-       it != insert_or_delete_key_set_.end(); it++) {
-    for (const auto& event : it->second) {
-      const bool is_after_begin = begin <= event.key;
-      const bool is_before_end =
-          end.has_value() ? event.key <= end.value() : true;
-      return is_after_begin && is_before_end;
-    }
+bool PrecisionLockingIndex::IsInPredicateSet(const std::string_view key) {
+  for (const auto& [epoch, predicates] : predicate_list_) {
+    if (predicates.Contains(key)) return true;
   }
   return false;
 }
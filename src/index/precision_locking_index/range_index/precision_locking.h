@@ -22,10 +22,14 @@
 #include <cstdint>
 #include <functional>
 #include <map>
+#include <memory>
 #include <optional>
 #include <shared_mutex>
 #include <string_view>
+#include <thread>
 
+#include "disjoint_range_set.hpp"
+#include "range_index_container_base.h"
 #include "types/definitions.h"
 #include "util/epoch_framework.hpp"
 
@@ -36,65 +40,63 @@ namespace Index {
  * @brief
  * Range-index with phantom avoidance via precision locking [1].
  * We named it PrecisionLockingIndex.
- * It consists of a sorted index, a insert/delete key set (L_u), and a predicate
- * set (L_p).
+ * It consists of a sorted index and a predicate set (L_p).
  * @note
- * The special thread updates the index periodically (per epoch). It
- * means that other worker threads fetch the (maybe stale) index. To prevent
- * anomalies caused by the stale index (i.e., to prevent phantoms), we use L_u
- * and L_p. All update operations (such as Insert/Delete) and scan operations
- * are grouped as L_u and L_p for each epoch, respectively. Updates in L_u will
- * be applied as a batch by the special thread. If a transaction detects that
- * the addition of an element to L_u satisfies with some predicate in L_p, or
- * vice versa, we will fail the transaction because a phantom may exist.
+ * The insertions and deletions are applied to the sorted index at once, and
+ * thus a scan finds the keys inserted before it, including the ones of the
+ * running transactions: whether such a key is visible is up to the commit of
+ * its data item, which the scanning transaction reads and validates as a
+ * read of the key. To prevent phantoms, i.e., the keys inserted or deleted
+ * after a scan in its range, the scans are grouped as L_p for each epoch; if
+ * an insertion or a deletion satisfies some predicate in L_p, we fail it
+ * since a phantom may exist. The special thread removes the predicates of
+ * the stale epochs periodically.
+ * The sorted index is given as a RangeIndexContainerBase; it is iterated
+ * without holding plock_, and thus scans do not serialize with each other.
  *
  * @ref [1] https://dl.acm.org/doi/pdf/10.1145/582318.582340
  *
  */
 class PrecisionLockingIndex {
  public:
-  PrecisionLockingIndex(LineairDB::EpochFramework&);
+  PrecisionLockingIndex(LineairDB::EpochFramework&,
+                        std::unique_ptr<RangeIndexContainerBase>&&);
   ~PrecisionLockingIndex();
+  /**
+   * @brief Gives the operation each key in the range and the value inserted
+   * with it; see RangeIndexContainerBase::Scan.
+   */
+  std::optional<size_t> Scan(
+      const std::string_view begin, const std::optional<std::string_view> end,
+      std::function<bool(std::string_view, void*)> operation);
   std::optional<size_t> Scan(const std::string_view begin,
                              const std::optional<std::string_view> end,
                              std::function<bool(std::string_view)> operation);
-  bool Insert(const std::string_view key);
-  void ForceInsert(const std::string_view key);
+  bool Insert(const std::string_view key, void* value = nullptr);
+  void ForceInsert(const std::string_view key, void* value = nullptr);
+  // for bulk loading, when no transaction is running; see #ForceInsert.
+  void InsertDirectly(const std::string_view key, void* value = nullptr);
   bool Delete(const std::string_view key);
 
- private:
-  bool IsInPredicateSet(const std::string_view);
-  bool IsOverlapWithInsertOrDelete(const std::string_view,
-                                   const std::optional<std::string_view>);
-
-  struct Predicate {
-    std::string begin;
-    std::optional<std::string> end;
-    Predicate(std::string_view b, std::optional<std::string_view> e)
-        : begin(b), end(e) {}
-  };
-
-  struct InsertOrDeleteEvent {
-    std::string key;
-    bool is_delete_event;
-    InsertOrDeleteEvent(std::string_view k, bool i)
-        : key(k), is_delete_event(i) {}
+  struct Usage {
+    size_t predicates;  // the disjoint key ranges in L_p
+    size_t bytes;       // the container and L_p
   };
+  Usage GetUsage();
 
-  struct IndexItem {
-    bool is_deleted;
-  };
+ private:
+  bool IsInPredicateSet(const std::string_view);
 
-  using PredicateList = std::map<EpochNumber, std::vector<Predicate>>;
-  using InsertOrDeleteKeySet =
-      std::map<EpochNumber, std::vector<InsertOrDeleteEvent>>;
-  using ROWEXRangeIndexContainer = std::map<std::string, IndexItem>;
+  /**
+   * @note The set is partitioned by epoch and kept sorted, so that checking
+   * a key costs O(log n) per live epoch regardless of the number of
+   * concurrent scans.
+   */
+  using PredicateList = std::map<EpochNumber, DisjointRangeSet>;
 
   PredicateList predicate_list_;
   std::shared_mutex plock_;
-  InsertOrDeleteKeySet insert_or_delete_key_set_;
-  std::shared_mutex ulock_;
-  ROWEXRangeIndexContainer container_;
+  std::unique_ptr<RangeIndexContainerBase> container_;
   EpochFramework& epoch_manager_ref_;
   std::atomic<bool> manager_stop_flag_;
   std::thread manager_;
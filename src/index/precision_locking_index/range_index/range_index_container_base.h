@@ -0,0 +1,73 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_INDEX_RANGE_INDEX_CONTAINER_BASE_H
+#define LINEAIRDB_INDEX_RANGE_INDEX_CONTAINER_BASE_H
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <string_view>
+
+namespace LineairDB {
+namespace Index {
+
+/**
+ * @brief
+ * The ordered set of keys held by PrecisionLockingIndex, with a value of
+ * each key; HashTableWithPrecisionLockingIndex stores the pointers to the
+ * data items, so that scans need no lookups of the point index.
+ * Implementations must allow Scan to run concurrently with Put, i.e.,
+ * PrecisionLockingIndex does not hold any lock while it iterates a container.
+ */
+class RangeIndexContainerBase {
+ public:
+  virtual ~RangeIndexContainerBase() {}
+
+  /**
+   * @brief Inserts the key, or updates the deletion flag and the value if it
+   * already exists. The value of a deletion is left as it is.
+   */
+  virtual void Put(const std::string_view key, const bool is_deleted,
+                   void* value = nullptr) = 0;
+
+  /**
+   * @brief Invokes the operation for each key (not marked as deleted) in
+   * [begin, end] and its value in ascending order, until the operation
+   * returns true. The keys given stay valid until the destruction of the
+   * container.
+   * @return the number of keys given to the operation.
+   */
+  virtual size_t Scan(
+      const std::string_view begin, const std::optional<std::string_view> end,
+      std::function<bool(std::string_view, void*)> operation) = 0;
+  size_t Scan(const std::string_view begin,
+              const std::optional<std::string_view> end,
+              std::function<bool(std::string_view)> operation) {
+    return Scan(begin, end,
+                [&](std::string_view key, void*) { return operation(key); });
+  }
+
+  /**
+   * @brief Returns the bytes of the nodes and the keys of the container.
+   */
+  virtual size_t MemoryUsage() const = 0;
+};
+
+}  // namespace Index
+}  // namespace LineairDB
+
+#endif /* LINEAIRDB_INDEX_RANGE_INDEX_CONTAINER_BASE_H */
@@ -0,0 +1,81 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "secondary_index.h"
+
+#include <utility>
+
+namespace LineairDB {
+namespace Index {
+
+namespace {
+void AppendEscaped(std::string& encoded, const std::string_view key) {
+  for (const char c : key) {
+    encoded.push_back(c);
+    if (c == '\0') encoded.push_back('\xff');
+  }
+}
+}  // namespace
+
+SecondaryIndex::SecondaryIndex(const std::string& name,
+                               EpochFramework& epoch_framework,
+                               const Config& config,
+                               Database::SecondaryKeyExtractor extractor)
+    : name_(name),
+      extractor_(std::move(extractor)),
+      table_(epoch_framework, config) {}
+
+std::optional<std::string> SecondaryIndex::Extract(
+    const std::string_view key, const DataItem& item) const {
+  if (!item.IsInitialized()) return std::nullopt;
+  return extractor_(key, {item.value(), item.size()});
+}
+
+std::string SecondaryIndex::EntryKey(const std::string_view secondary_key,
+                                     const std::string_view primary_key) {
+  std::string encoded = LowerBound(secondary_key);
+  encoded.append(primary_key);
+  return encoded;
+}
+
+std::string SecondaryIndex::LowerBound(const std::string_view secondary_key) {
+  std::string encoded;
+  encoded.reserve(secondary_key.size() + 2);
+  AppendEscaped(encoded, secondary_key);
+  encoded.append("\0\1", 2);
+  return encoded;
+}
+
+std::string SecondaryIndex::UpperBound(const std::string_view secondary_key) {
+  std::string encoded;
+  encoded.reserve(secondary_key.size() + 2);
+  AppendEscaped(encoded, secondary_key);
+  encoded.append("\0\2", 2);
+  return encoded;
+}
+
+std::string_view SecondaryIndex::PrimaryKeyOf(
+    const std::string_view entry_key) {
+  for (size_t i = 0; i + 1 < entry_key.size(); i++) {
+    if (entry_key[i] != '\0') continue;
+    if (entry_key[i + 1] == '\1') return entry_key.substr(i + 2);
+    i++;  // an escaped null character
+  }
+  return {};
+}
+
+}  // namespace Index
+}  // namespace LineairDB
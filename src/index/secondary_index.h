@@ -0,0 +1,89 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef LINEAIRDB_INDEX_SECONDARY_INDEX_H
+#define LINEAIRDB_INDEX_SECONDARY_INDEX_H
+
+#include <lineairdb/config.h>
+#include <lineairdb/database.h>
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "index/concurrent_table.h"
+#include "types/data_item.hpp"
+#include "util/epoch_framework.hpp"
+
+namespace LineairDB {
+namespace Index {
+
+/**
+ * @brief
+ * An ordered index of the keys by the secondary keys of their values; see
+ * Database::CreateSecondaryIndex.
+ * An entry is a data item of a table of its own, whose key is the pair of a
+ * secondary key and a primary key (see #EntryKey). The transactions read and
+ * write the entries as they do the rows: a commit writes the entries of the
+ * rows that it writes (see Transaction::Impl::MaintainSecondaryIndexes)
+ * under the same concurrency control, and the scans of the entries detect
+ * phantoms by the range index of the table. The entries are neither logged
+ * nor checkpointed; they are built from the rows at the creation.
+ */
+class SecondaryIndex {
+ public:
+  SecondaryIndex(const std::string& name, EpochFramework& epoch_framework,
+                 const Config& config,
+                 Database::SecondaryKeyExtractor extractor);
+
+  const std::string& GetName() const { return name_; }
+  ConcurrentTable& GetTable() { return table_; }
+
+  /**
+   * @return The secondary key of the row, or std::nullopt if `item` has no
+   * value or the extractor does not index it.
+   */
+  std::optional<std::string> Extract(const std::string_view key,
+                                     const DataItem& item) const;
+
+  /**
+   * @brief
+   * Encodes the pair of the keys, so that the entries are ordered by the
+   * secondary keys, and then by the primary keys: the null characters of the
+   * secondary key are escaped, and it is terminated by "\0\1".
+   */
+  static std::string EntryKey(const std::string_view secondary_key,
+                              const std::string_view primary_key);
+  /**
+   * @brief Returns the bounds of the entries of `secondary_key`, which are
+   * included in the range [#LowerBound, #UpperBound].
+   */
+  static std::string LowerBound(const std::string_view secondary_key);
+  static std::string UpperBound(const std::string_view secondary_key);
+  static std::string_view PrimaryKeyOf(const std::string_view entry_key);
+
+  // The value of an entry; a removed entry is a tombstone.
+  static constexpr std::byte EntryValue[1] = {std::byte{1}};
+
+ private:
+  const std::string name_;
+  const Database::SecondaryKeyExtractor extractor_;
+  ConcurrentTable table_;
+};
+
+}  // namespace Index
+}  // namespace LineairDB
+#endif /* LINEAIRDB_INDEX_SECONDARY_INDEX_H */
@@ -0,0 +1,61 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "table.h"
+
+#include <cctype>
+
+namespace LineairDB {
+namespace Index {
+
+Table::Table(const std::string& name, EpochFramework& epoch_framework,
+             const Config& config)
+    : name_(name), config_(config), index_(epoch_framework, config_) {}
+
+std::string_view Table::EncodeKey(const std::string_view table_name,
+                                  const std::string_view key,
+                                  std::string& buffer) {
+  if (table_name.empty() && (key.empty() || key.front() != '\0')) return key;
+  buffer.clear();
+  buffer.reserve(table_name.size() + key.size() + 2);
+  buffer.push_back('\0');
+  buffer.append(table_name);
+  buffer.push_back('\0');
+  buffer.append(key);
+  return buffer;
+}
+
+std::pair<std::string_view, std::string_view> Table::DecodeKey(
+    const std::string_view encoded) {
+  if (encoded.empty() || encoded.front() != '\0') return {{}, encoded};
+  const auto separator = encoded.find('\0', 1);
+  if (separator == std::string_view::npos) return {{}, encoded};
+  return {encoded.substr(1, separator - 1), encoded.substr(separator + 1)};
+}
+
+bool Table::IsValidName(const std::string_view name) {
+  if (name.empty()) return false;
+  for (const char c : name) {
+    if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' &&
+        c != '-') {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace Index
+}  // namespace LineairDB
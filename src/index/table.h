@@ -0,0 +1,80 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef LINEAIRDB_INDEX_TABLE_H
+#define LINEAIRDB_INDEX_TABLE_H
+
+#include <lineairdb/config.h>
+
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "index/concurrent_table.h"
+#include "util/epoch_framework.hpp"
+
+namespace LineairDB {
+namespace Index {
+
+/**
+ * @brief
+ * A named table of a database; see Database::CreateTable. It has the
+ * indexes of its own, which are configured by its own Config, and thus the
+ * scans of a table never check the insertions into the other tables.
+ * The read/write sets, the logs and the incremental checkpoints have the
+ * keys of all the tables, which are told apart by #EncodeKey; the indexes
+ * and the full checkpoint of a table have its keys as they are.
+ */
+class Table {
+ public:
+  Table(const std::string& name, EpochFramework& epoch_framework,
+        const Config& config);
+
+  const std::string& GetName() const { return name_; }
+  const Config& GetConfig() const { return config_; }
+  ConcurrentTable& GetIndex() { return index_; }
+
+  /**
+   * @brief
+   * Returns `key` of the table `table_name`, or of the default table if the
+   * name is empty, as a key unique among the tables. A key of a named table
+   * is encoded as "\0<name>\0<key>" into `buffer`; a key of the default
+   * table is given as it is, unless it begins with a null character.
+   */
+  static std::string_view EncodeKey(const std::string_view table_name,
+                                    const std::string_view key,
+                                    std::string& buffer);
+  /**
+   * @brief The inverse of #EncodeKey.
+   * @return The pair of the name of the table and the key.
+   */
+  static std::pair<std::string_view, std::string_view> DecodeKey(
+      const std::string_view encoded);
+  /**
+   * @brief
+   * A name consists of alphanumerics, '_' and '-', so that it is also a part
+   * of the names of the files; see Recovery::CheckpointImage::FileName.
+   */
+  static bool IsValidName(const std::string_view name);
+
+ private:
+  const std::string name_;
+  const Config config_;
+  ConcurrentTable index_;
+};
+
+}  // namespace Index
+}  // namespace LineairDB
+#endif /* LINEAIRDB_INDEX_TABLE_H */
@@ -21,6 +21,7 @@
 #include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstdint>
 #include <thread>
 
 #include "lock/lock.h"
@@ -30,9 +31,14 @@ namespace LineairDB {
 
 namespace Lock {
 
-template <bool EnableBackoff = false, bool EnableCohort = false>
-class alignas(64) ReadersWritersLockImpl
-    : LockBase<ReadersWritersLockImpl<EnableBackoff, EnableCohort>> {
+/**
+ * @tparam Padded whether a lock occupies a cache line. A lock embedded in a
+ * data item is not padded, since the item is shared anyway.
+ */
+template <bool EnableBackoff = false, bool EnableCohort = false,
+          bool Padded = true>
+class alignas(Padded ? 64 : 8) ReadersWritersLockImpl
+    : LockBase<ReadersWritersLockImpl<EnableBackoff, EnableCohort, Padded>> {
  public:
   enum class LockType { Exclusive, Shared, Upgrade };
   ReadersWritersLockImpl() : lock_bit_(UnLocked) {}
@@ -102,6 +108,55 @@ class alignas(64) ReadersWritersLockImpl
     }
   }
 
+  /**
+   * @brief
+   * Same as #TryLock, but records the timestamp of the owner for the
+   * timestamp-based deadlock avoidance algorithms such as WaitDie and
+   * WoundWait. The owner has to release this lock by #UnLockWithTimestamp.
+   */
+  bool TryLockWithTimestamp(LockType type, const uint64_t timestamp) {
+    LatchMetadata();
+    const bool acquired = TryLock(type);
+    if (acquired && timestamp < oldest_owner_.load()) {
+      oldest_owner_.store(timestamp);
+    }
+    UnLatchMetadata();
+    return acquired;
+  }
+
+  void UnLockWithTimestamp() {
+    LatchMetadata();
+    auto current = lock_bit_.load();
+    if (IsExclusivelyLocked(current) || GetNumberOfReaders(current) == 1) {
+      // NOTE: the owners which acquired this lock by #TryLock are not
+      // recorded; the others just wait for them.
+      oldest_owner_.store(NoOwner);
+      wounded_below_.store(NoOwner);
+    }
+    UnLock();
+    UnLatchMetadata();
+  }
+
+  /**
+   * @brief
+   * Returns the lower bound of the timestamps of the owners, or UINT64_MAX
+   * if there are no owners which recorded their timestamps.
+   */
+  uint64_t GetOldestOwner() const { return oldest_owner_.load(); }
+
+  /**
+   * @brief
+   * Requests the owners younger than `timestamp` to abort themselves.
+   */
+  void Wound(const uint64_t timestamp) {
+    auto current = wounded_below_.load();
+    while (timestamp < current &&
+           !wounded_below_.compare_exchange_weak(current, timestamp)) {}
+  }
+  bool IsWounded(const uint64_t timestamp) const {
+    return wounded_below_.load() < timestamp;
+  }
+
   constexpr static bool IsStarvationFreeAlgorithm() { return false; }
   constexpr static bool IsReadersWritersLockingAlgorithm() { return true; }
 
@@ -109,6 +164,24 @@ class alignas(64) ReadersWritersLockImpl
   std::atomic<uint64_t> lock_bit_;
   static_assert(decltype(lock_bit_)::is_always_lock_free);
 
+  // metadata for the timestamp-based deadlock avoidance
+  constexpr static uint64_t NoOwner = UINT64_MAX;
+  std::atomic<bool> metadata_latch_{false};
+  std::atomic<uint64_t> oldest_owner_{NoOwner};
+  std::atomic<uint64_t> wounded_below_{NoOwner};
+
+  void LatchMetadata() {
+    for (;;) {
+      bool unlatched = false;
+      if (!metadata_latch_.load() &&
+          metadata_latch_.compare_exchange_weak(unlatched, true)) {
+        return;
+      }
+      std::this_thread::yield();
+    }
+  }
+  void UnLatchMetadata() { metadata_latch_.store(false); }
+
   constexpr static uint64_t ExclusivelyLocked = 1llu;
   constexpr static uint64_t UnLocked          = 0llu;
   constexpr static uint64_t Reader            = 1llu << 1;
@@ -135,6 +208,7 @@ using ReadersWritersLockBO   = ReadersWritersLockImpl<true, false>;
 using ReadersWritersLockCO   = ReadersWritersLockImpl<false, true>;
 using ReadersWritersLockBOCO = ReadersWritersLockImpl<true, true>;
 using ReadersWritersLockCOBO = ReadersWritersLockBOCO;
+using UnpaddedReadersWritersLockBO = ReadersWritersLockImpl<true, false, false>;
 // static_assert(sizeof(ReadersWritersLock) ==
 //             std::hardware_destructive_interference_size);
 
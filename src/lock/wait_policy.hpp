@@ -0,0 +1,172 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_LOCK_WAIT_POLICY_HPP
+#define LINEAIRDB_LOCK_WAIT_POLICY_HPP
+
+#include <lineairdb/config.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+#include "util/backoff.hpp"
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+namespace LineairDB {
+
+namespace Lock {
+
+/**
+ * @brief
+ * Parks threads by the address of a lock word.
+ * A lock word is mapped to one of the buckets, and each bucket has a futex
+ * word which is incremented when one of its lock words is released.
+ * The releaser issues the system call only when some threads are parked on
+ * the bucket.
+ */
+class ParkingLot {
+ public:
+  template <typename Predicate>
+  static void Park(const void* address, Predicate&& is_released) {
+    auto& bucket = GetBucket(address);
+    bucket.waiters.fetch_add(1);
+    for (;;) {
+      const auto sequence = bucket.sequence.load();
+      if (is_released()) break;
+      FutexWait(bucket.sequence, sequence);
+    }
+    bucket.waiters.fetch_sub(1);
+  }
+
+  static void UnparkAll(const void* address) {
+    auto& bucket = GetBucket(address);
+    if (bucket.waiters.load() == 0) return;
+    bucket.sequence.fetch_add(1);
+    FutexWake(bucket.sequence);
+  }
+
+ private:
+  struct alignas(64) Bucket {
+    std::atomic<uint32_t> waiters{0};
+    std::atomic<uint32_t> sequence{0};
+  };
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+
+  constexpr static size_t BucketCount = 512;
+  // NOTE: a parked thread wakes up at this interval even if nobody notifies
+  // it, so that a release without notification does not hang the waiters.
+  constexpr static long ParkTimeoutNs = 1000 * 1000;
+
+  static Bucket& GetBucket(const void* address) {
+    static Bucket buckets[BucketCount];
+    const auto hash = reinterpret_cast<uintptr_t>(address) >> 6;
+    return buckets[hash % BucketCount];
+  }
+
+  static void FutexWait(std::atomic<uint32_t>& word, const uint32_t expected) {
+#ifdef __linux__
+    const struct timespec timeout = {0, ParkTimeoutNs};
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAIT_PRIVATE,
+            expected, &timeout, nullptr, 0);
+#else
+    if (word.load() == expected) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(ParkTimeoutNs));
+    }
+#endif
+  }
+
+  static void FutexWake([[maybe_unused]] std::atomic<uint32_t>& word) {
+#ifdef __linux__
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word), FUTEX_WAKE_PRIVATE,
+            INT32_MAX, nullptr, nullptr, 0);
+#endif
+  }
+};
+
+/**
+ * @brief
+ * Waits for the release of a lock word such as the lock bit of
+ * DataItem::transaction_id, in the way of Config::LockWaitPolicy.
+ * The owner of the lock has to call #NotifyReleased after it releases the
+ * lock, so that the parked waiters wake up.
+ */
+class WaitPolicy {
+ public:
+  WaitPolicy(Config::LockWaitPolicy policy = Config::LockWaitPolicy::Yield)
+      : policy_(policy) {}
+
+  /**
+   * @brief Returns when `is_released` returns true.
+   * @param address the lock word, which identifies the waiters to notify.
+   */
+  template <typename Predicate>
+  void WaitUntil(const void* address, Predicate&& is_released) const {
+    if (policy_ == Config::LockWaitPolicy::Yield) {
+      while (!is_released()) std::this_thread::yield();
+      return;
+    }
+
+    for (size_t i = 0; i < SpinCount; i++) {
+      if (is_released()) return;
+      CpuRelax();
+    }
+    if (policy_ == Config::LockWaitPolicy::SpinThenBackoff) {
+      Util::RetryWithExponentialBackoff([&]() { return is_released(); }, 100,
+                                        YieldCount, 0, MaxSleepNs);
+    } else {
+      for (size_t i = 0; i < YieldCount; i++) {
+        if (is_released()) return;
+        std::this_thread::yield();
+      }
+      ParkingLot::Park(address, is_released);
+    }
+  }
+
+  void NotifyReleased(const void* address) const {
+    if (policy_ == Config::LockWaitPolicy::SpinThenPark) {
+      ParkingLot::UnparkAll(address);
+    }
+  }
+
+ private:
+  constexpr static size_t SpinCount  = 128;
+  constexpr static size_t YieldCount = 16;
+  constexpr static size_t MaxSleepNs = 100 * 1000;
+
+  static void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+  }
+
+  Config::LockWaitPolicy policy_;
+};
+
+}  // namespace Lock
+}  // namespace LineairDB
+
+#endif /* LINEAIRDB_LOCK_WAIT_POLICY_HPP */
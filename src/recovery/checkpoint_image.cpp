@@ -0,0 +1,222 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "checkpoint_image.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <queue>
+#include <thread>
+#include <util/logger.hpp>
+
+#include "util/checksum.hpp"
+
+namespace LineairDB {
+namespace Recovery {
+
+CheckpointImage::CheckpointImage(const std::string& filename)
+    : header_(nullptr),
+      directory_(nullptr),
+      mapping_(nullptr),
+      mapping_size_(0) {
+  if (!IsCheckpointImage(filename)) return;
+  const int fd = open(filename.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    SPDLOG_ERROR("Durability Error: fail to open checkpoint {0}. errno: {1}",
+                 filename, errno);
+    exit(1);
+  }
+  mapping_size_ = st.st_size;
+  void* mapping = mmap(nullptr, mapping_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    SPDLOG_ERROR("Durability Error: fail to map checkpoint {0}. errno: {1}",
+                 filename, errno);
+    exit(1);
+  }
+  mapping_   = static_cast<const char*>(mapping);
+  header_    = reinterpret_cast<const Header*>(mapping_);
+  directory_ = reinterpret_cast<const DirectoryEntry*>(
+      mapping_ + header_->directory_offset);
+
+  // Only the directory is validated here; the heap is not touched.
+  const uint64_t heap_end = header_->directory_offset;
+  bool broken = heap_end < sizeof(Header) || mapping_size_ < heap_end ||
+                (mapping_size_ - heap_end) / sizeof(DirectoryEntry) <
+                    header_->count;
+  if (!broken) {
+    broken = header_->directory_checksum !=
+             Util::Crc32c(directory_, header_->count * sizeof(DirectoryEntry));
+  }
+  for (size_t i = 0; !broken && i < header_->count; i++) {
+    const auto& entry = directory_[i];
+    broken = entry.key_offset < sizeof(Header) ||
+             heap_end < entry.key_offset + entry.key_size ||
+             entry.value_offset < sizeof(Header) ||
+             heap_end < entry.value_offset + entry.value_size;
+  }
+  if (broken) {
+    SPDLOG_ERROR(
+        "  Stop recovery procedure: file {0} is broken. Some records may not "
+        "be recovered.",
+        filename);
+    exit(EXIT_FAILURE);
+  }
+  madvise(mapping, mapping_size_, MADV_RANDOM);
+}
+
+CheckpointImage::~CheckpointImage() {
+  if (mapping_ != nullptr) {
+    munmap(const_cast<char*>(mapping_), mapping_size_);
+  }
+}
+
+CheckpointImage::Entry CheckpointImage::operator[](size_t i) const {
+  const auto& entry = directory_[i];
+  return {std::string_view(mapping_ + entry.key_offset, entry.key_size),
+          std::string_view(mapping_ + entry.value_offset, entry.value_size),
+          entry.tid};
+}
+
+std::string CheckpointImage::FileName(const std::string& work_dir,
+                                      const std::string_view table_name) {
+  if (table_name.empty()) return work_dir + "/checkpoint.log";
+  return work_dir + "/checkpoint.table." + std::string(table_name) + ".log";
+}
+
+std::string CheckpointImage::WorkingFileName(
+    const std::string& work_dir, const std::string_view table_name) {
+  if (table_name.empty()) return work_dir + "/checkpoint.working.log";
+  return work_dir + "/checkpoint.table." + std::string(table_name) +
+         ".working.log";
+}
+
+bool CheckpointImage::IsCheckpointImage(const std::string& filename) {
+  std::ifstream file(filename, std::ifstream::in | std::ifstream::binary);
+  Header header;
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+    return false;
+  }
+  return header.magic == Magic;
+}
+
+CheckpointImage::Writer::Writer(const std::string& filename,
+                                const EpochNumber epoch,
+                                const size_t partitions,
+                                const size_t buffer_size)
+    : epoch_(epoch),
+      partitions_(std::max<size_t>(1, partitions)),
+      writer_(filename, buffer_size, sizeof(Header)),
+      chunk_size_(writer_.ChunkSize(partitions_.size())) {}
+
+void CheckpointImage::Writer::Add(const size_t partition,
+                                  const std::string_view key,
+                                  const std::string_view value,
+                                  const TransactionId tid) {
+  auto& p = partitions_[partition];
+  DirectoryEntry entry;
+  entry.key_offset   = p.chunk.size();
+  entry.key_size     = static_cast<uint32_t>(key.size());
+  entry.value_offset = p.chunk.size() + key.size();
+  entry.value_size   = static_cast<uint32_t>(value.size());
+  entry.tid          = tid;
+  p.entries.emplace_back(std::string(key), entry);
+  p.chunk.append(key);
+  p.chunk.append(value);
+  if (chunk_size_ <= p.chunk.size()) Flush(p);
+}
+
+void CheckpointImage::Writer::Flush(Partition& partition) {
+  if (partition.chunk.empty()) return;
+  const uint64_t offset = writer_.Append(std::move(partition.chunk));
+  partition.chunk.clear();
+  for (size_t i = partition.placed; i < partition.entries.size(); i++) {
+    partition.entries[i].second.key_offset += offset;
+    partition.entries[i].second.value_offset += offset;
+  }
+  partition.placed = partition.entries.size();
+}
+
+void CheckpointImage::Writer::Finish() {
+  using KeyedEntry = std::pair<std::string, DirectoryEntry>;
+  auto by_key      = [](const KeyedEntry& lhs, const KeyedEntry& rhs) {
+    return lhs.first < rhs.first;
+  };
+  for (auto& partition : partitions_) Flush(partition);
+  {
+    std::vector<std::thread> sorters;
+    for (size_t i = 1; i < partitions_.size(); i++) {
+      sorters.emplace_back([&, i]() {
+        auto& entries = partitions_[i].entries;
+        std::sort(entries.begin(), entries.end(), by_key);
+      });
+    }
+    auto& entries = partitions_[0].entries;
+    std::sort(entries.begin(), entries.end(), by_key);
+    for (auto& sorter : sorters) sorter.join();
+  }
+
+  // Merge the sorted partitions into the directory, chunk by chunk.
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  header.magic = Magic;
+  header.epoch = epoch_;
+  std::string chunk;
+  bool first_chunk = true;
+  auto flush       = [&]() {
+    const uint64_t offset = writer_.Append(std::move(chunk));
+    chunk.clear();
+    if (first_chunk) header.directory_offset = offset;
+    first_chunk = false;
+  };
+  using Cursor = std::pair<size_t, size_t>;  // (partition, position)
+  auto greater = [&](const Cursor& lhs, const Cursor& rhs) {
+    return by_key(partitions_[rhs.first].entries[rhs.second],
+                  partitions_[lhs.first].entries[lhs.second]);
+  };
+  std::priority_queue<Cursor, std::vector<Cursor>, decltype(greater)>
+      cursors(greater);
+  for (size_t i = 0; i < partitions_.size(); i++) {
+    if (!partitions_[i].entries.empty()) cursors.emplace(i, 0);
+  }
+  while (!cursors.empty()) {
+    auto [partition, position] = cursors.top();
+    cursors.pop();
+    const auto& entry = partitions_[partition].entries[position].second;
+    chunk.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    header.directory_checksum =
+        Util::Crc32c(&entry, sizeof(entry), header.directory_checksum);
+    header.count++;
+    if (chunk_size_ <= chunk.size()) flush();
+    if (position + 1 < partitions_[partition].entries.size()) {
+      cursors.emplace(partition, position + 1);
+    }
+  }
+  if (first_chunk || !chunk.empty()) flush();
+  writer_.Close(
+      std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)));
+}
+
+}  // namespace Recovery
+}  // namespace LineairDB
@@ -0,0 +1,145 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef LINEAIRDB_RECOVERY_CHECKPOINT_IMAGE_H
+#define LINEAIRDB_RECOVERY_CHECKPOINT_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <msgpack.hpp>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "recovery/checkpoint_writer.h"
+#include "types/definitions.h"
+#include "types/transaction_id.hpp"
+
+namespace LineairDB {
+namespace Recovery {
+
+/**
+ * @brief
+ * A full checkpoint laid out to be used through mmap without decoding.
+ * It is laid out as follows (in the native byte order):
+ *
+ *   Header | heap (key | value) * count | DirectoryEntry * count
+ *
+ * where the directory is sorted by the keys and each entry points to its key
+ * and its value in the heap. Recovery refers to the values in the mapping
+ * instead of copying them, and thus the pages of a value are read from the
+ * disk only when the value is read for the first time.
+ * The heap is written in the order of capture (see #Writer), and only the
+ * directory, which is validated at the opening, has a checksum.
+ */
+class CheckpointImage {
+ public:
+  static constexpr uint32_t Magic = 0x324d4943;  // "CIM2"
+
+  struct Header {
+    uint32_t magic;
+    EpochNumber epoch;
+    uint64_t count;
+    uint64_t directory_offset;
+    uint32_t directory_checksum;  // CRC-32C of the directory
+    uint32_t reserved;
+  };
+  struct DirectoryEntry {
+    uint64_t key_offset;
+    uint64_t value_offset;
+    uint32_t key_size;
+    uint32_t value_size;
+    TransactionId tid;
+  };
+  static_assert(sizeof(DirectoryEntry) == 32);
+  struct Entry {
+    std::string_view key;
+    std::string_view value;
+    TransactionId tid;
+  };
+  /**
+   * @brief
+   * Writes an image as the entries are captured: each partition copies the
+   * keys and the values into a chunk of its own, which is written by a
+   * CheckpointWriter when it is full, and keeps only the keys and the
+   * directory entries until #Finish sorts them.
+   */
+  class Writer {
+   public:
+    Writer(const std::string& filename, const EpochNumber epoch,
+           const size_t partitions, const size_t buffer_size);
+    /**
+     * @brief Adds an entry to `partition`. Thread-safe if each partition is
+     * added by one thread. The partitions must have no key in common.
+     */
+    void Add(const size_t partition, const std::string_view key,
+             const std::string_view value, const TransactionId tid);
+    /**
+     * @brief Writes the rest of the chunks, the directory and the header.
+     */
+    void Finish();
+
+   private:
+    struct Partition {
+      std::string chunk;
+      // the keys and their entries; the offsets of the entries from
+      // `placed` are relative to `chunk` until it is written.
+      std::vector<std::pair<std::string, DirectoryEntry>> entries;
+      size_t placed = 0;
+    };
+    void Flush(Partition& partition);
+
+    const EpochNumber epoch_;
+    std::vector<Partition> partitions_;
+    CheckpointWriter writer_;
+    const size_t chunk_size_;
+  };
+
+  /**
+   * @brief Maps `filename` if it is a checkpoint image; see #IsOpen.
+   */
+  CheckpointImage(const std::string& filename);
+  ~CheckpointImage();
+  CheckpointImage(const CheckpointImage&) = delete;
+  CheckpointImage& operator=(const CheckpointImage&) = delete;
+
+  bool IsOpen() const { return header_ != nullptr; }
+  size_t size() const { return header_->count; }
+  Entry operator[](size_t i) const;
+
+  /**
+   * @brief Returns the file of the full checkpoint of the table `table_name`
+   * in `work_dir`; the empty name is of the default table.
+   */
+  static std::string FileName(const std::string& work_dir,
+                              const std::string_view table_name);
+  static std::string WorkingFileName(const std::string& work_dir,
+                                     const std::string_view table_name);
+  /**
+   * @brief Returns true if `filename` begins with the header of this format.
+   */
+  static bool IsCheckpointImage(const std::string& filename);
+
+ private:
+  const Header* header_;
+  const DirectoryEntry* directory_;
+  const char* mapping_;
+  size_t mapping_size_;
+};
+
+}  // namespace Recovery
+}  // namespace LineairDB
+#endif /* LINEAIRDB_RECOVERY_CHECKPOINT_IMAGE_H */
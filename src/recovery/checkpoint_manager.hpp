@@ -20,20 +20,35 @@
 
 #include <lineairdb/config.h>
 #include <lineairdb/transaction.h>
+#include <unistd.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <experimental/filesystem>
+#include <functional>
 #include <msgpack.hpp>
+#include <mutex>
+#include <string>
 #include <string_view>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include "index/concurrent_table.h"
+#include "index/table.h"
+#include "lock/wait_policy.hpp"
+#include "recovery/checkpoint_image.h"
+#include "recovery/checkpoint_writer.h"
+#include "recovery/log_compression.h"
 #include "recovery/logger.h"
+#include "thread_pool/thread_pool.h"
 #include "transaction_impl.h"
 #include "types/data_item.hpp"
 #include "types/definitions.h"
 #include "types/snapshot.hpp"
 #include "util/epoch_framework.hpp"
+#include "util/event_count.hpp"
 #include "util/logger.hpp"
 #include "util/thread_key_storage.h"
 
@@ -41,22 +56,50 @@ namespace LineairDB {
 
 namespace Recovery {
 
+/**
+ * @brief
+ * Takes CPR-consistent checkpoints periodically.
+ * A full checkpoint saves all the data items into CheckpointFileName as a
+ * CheckpointImage, which recovery maps instead of decoding; each named table
+ * (see #AddTable) has an image of its own. Between two full checkpoints, an
+ * incremental checkpoint saves only the data items whose versions may be
+ * missing in the checkpoint files, into a delta file
+ * `checkpoint.delta.<epoch>.log` shared by the tables. Recovery replays the
+ * full checkpoints, the delta files and the logs together; the version of
+ * the largest transaction id wins.
+ */
 class CPRManager {
  public:
   enum class Phase { REST, IN_PROGRESS, WAIT_FLUSH };
   const std::string CheckpointFileName;
   const std::string CheckpointWorkingFileName;
+  const std::string DeltaFilePrefix;
 
   CPRManager(const LineairDB::Config& c_ref,
-             LineairDB::Index::ConcurrentTable& t_ref, EpochFramework& e_ref)
-      : CheckpointFileName(c_ref.work_dir + "/checkpoint.log"),
-        CheckpointWorkingFileName(c_ref.work_dir + "/checkpoint.working.log"),
+             LineairDB::Index::ConcurrentTable& t_ref, EpochFramework& e_ref,
+             ThreadPool& thread_pool)
+      : CheckpointFileName(CheckpointImage::FileName(c_ref.work_dir, {})),
+        CheckpointWorkingFileName(
+            CheckpointImage::WorkingFileName(c_ref.work_dir, {})),
+        DeltaFilePrefix("checkpoint.delta."),
         config_ref_(c_ref),
+        compressor_(c_ref),
         table_ref_(t_ref),
         epoch_manager_ref_(e_ref),
+        thread_pool_ref_(thread_pool),
         current_phase_(Phase::REST),
         checkpoint_epoch_(0),
         checkpoint_completed_epoch_(0),
+        dirty_epoch_(0),
+        delta_files_(GetExistingDeltaFiles()),
+        is_two_phase_locking_(
+            c_ref.concurrency_control_protocol ==
+                Config::ConcurrencyControl::TwoPhaseLocking ||
+            c_ref.concurrency_control_protocol ==
+                Config::ConcurrencyControl::TwoPhaseLockingWaitDie ||
+            c_ref.concurrency_control_protocol ==
+                Config::ConcurrencyControl::TwoPhaseLockingWoundWait),
+        wait_policy_(c_ref.lock_wait_policy),
         stop_(false),
         manager_thread_([&]() {
           if (!config_ref_.enable_checkpointing) return;
@@ -110,52 +153,7 @@ class CPRManager {
 
               // We now create the consistent snapshot of the end of the epoch
               // `e+1`.
-              Recovery::Logger::LogRecords records;
-              Recovery::Logger::LogRecord record;
-              record.epoch = checkpoint_epoch_.load() + 1;
-
-              table_ref_.ForEach(
-                  [&](std::string_view key, LineairDB::DataItem& data_item) {
-                    data_item.ExclusiveLock();
-
-                    Logger::LogRecord::KeyValuePair kvp;
-                    kvp.key = key;
-                    if (data_item.checkpoint_buffer.IsEmpty()) {
-                      // this data item holds version which has written before
-                      // the point of consistency.
-                      kvp.buffer = data_item.buffer.toString();
-                    } else {
-                      kvp.buffer = data_item.checkpoint_buffer.toString();
-                      data_item.checkpoint_buffer.Reset(nullptr, 0);
-                    }
-                    kvp.tid.epoch = record.epoch;
-                    kvp.tid.tid   = 0;
-                    record.key_value_pairs.emplace_back(std::move(kvp));
-
-                    data_item.ExclusiveUnlock();
-                    return true;
-                  });
-              records.emplace_back(std::move(record));
-
-              std::ofstream new_file(
-                  CheckpointWorkingFileName,
-                  std::ios_base::out | std::ios_base::binary);
-              msgpack::pack(new_file, records);
-              new_file.flush();
-              SPDLOG_DEBUG("RENAME checkpoint workingfile from {0} to {1}",
-                           CheckpointWorkingFileName, CheckpointFileName);
-
-              // NOTE POSIX ensures that rename syscall provides atomicity
-              if (rename(CheckpointWorkingFileName.c_str(),
-                         CheckpointFileName.c_str())) {
-                SPDLOG_ERROR(
-                    "Durability Error: fail to rename checkpoint of the "
-                    "epoch "
-                    "{0:d}. "
-                    "errno: {1}",
-                    record.epoch, errno);
-                exit(1);
-              }
+              SaveSnapshot(checkpoint_epoch_.load() + 1, true);
             }
             SPDLOG_DEBUG("FLUSH consistent snapshot of epoch {}",
                          checkpoint_epoch_.load());
@@ -164,6 +162,24 @@ class CPRManager {
           }
         }) {}
 
+  /**
+   * @brief
+   * Saves all the data items as a checkpoint at once.
+   * It is used after bulk loading, when there are no running transactions;
+   * every data item is regarded as the version of the epoch `epoch`.
+   */
+  void WriteCheckpoint(const EpochNumber epoch) {
+    SaveSnapshot(epoch, false);
+  }
+
+  /**
+   * @brief Lets the checkpoints save `table` as well, from the next one.
+   */
+  void AddTable(Index::Table& table) {
+    std::lock_guard<decltype(snapshot_lock_)> guard(snapshot_lock_);
+    tables_.push_back(&table);
+  }
+
   void Stop() {
     stop_.store(true);
     manager_thread_.join();
@@ -173,22 +189,315 @@ class CPRManager {
     return checkpoint_completed_epoch_.load();
   }
 
-  bool IsNeedToCheckpointing(EpochNumber my_epoch) {
+  /**
+   * @brief
+   * Returns the epoch of the running checkpoint if a transaction in
+   * `my_epoch` has to keep the versions it overwrites for the checkpoint;
+   * otherwise 0.
+   */
+  EpochNumber GetCheckpointEpochToSave(EpochNumber my_epoch) {
     const auto global_phase = current_phase_.load();
-    if (global_phase == Phase::REST) { return false; }
-    return checkpoint_epoch_.load() <= my_epoch;
+    if (global_phase == Phase::REST) { return 0; }
+    const auto checkpoint_epoch = checkpoint_epoch_.load();
+    return checkpoint_epoch <= my_epoch ? checkpoint_epoch : 0;
+  }
+
+ private:
+  /**
+   * @brief
+   * Saves the snapshot of `epoch`. A periodic checkpoint saves the versions
+   * at the point of consistency of checkpoint_epoch_; if the number of the
+   * delta files is less than checkpoint_compaction_interval, it skips the
+   * data items whose versions are written before `dirty_epoch_` since the
+   * previous checkpoint files have them.
+   * Otherwise, it saves the current versions of all the data items; it is
+   * used only when there are no running transactions.
+   * The index is divided into checkpoint_threads partitions, which the
+   * workers of the thread pool capture and serialize in parallel; each
+   * partition fills chunks of its own, which a CheckpointWriter writes while
+   * the capture continues, so that at most Config::checkpoint_buffer_size
+   * bytes are buffered.
+   * A full checkpoint is written table by table into the image of each
+   * table; an incremental one appends all the tables into one delta file,
+   * with the keys encoded by Index::Table::EncodeKey, and each chunk of it
+   * has a checksum.
+   */
+  void SaveSnapshot(const EpochNumber epoch, const bool periodic) {
+    // the periodic checkpoint and #WriteCheckpoint share the working file.
+    std::lock_guard<decltype(snapshot_lock_)> guard(snapshot_lock_);
+    // The first checkpoint of this process has no previous one to rely on.
+    const bool full =
+        !periodic || dirty_epoch_ == 0 ||
+        config_ref_.checkpoint_compaction_interval <= delta_files_.size();
+    // NOTE: no item keeps a version for the checkpoint of THREAD_OFFLINE.
+    const EpochNumber stable_epoch =
+        periodic ? checkpoint_epoch_.load() : EpochFramework::THREAD_OFFLINE;
+
+    const size_t partitions =
+        std::max<size_t>(1, config_ref_.checkpoint_threads);
+    // the default table and then the named tables.
+    std::vector<std::pair<std::string_view, Index::ConcurrentTable*>> tables;
+    tables.emplace_back(std::string_view(), &table_ref_);
+    for (auto* table : tables_) {
+      tables.emplace_back(table->GetName(), &table->GetIndex());
+    }
+    std::vector<std::pair<std::string, std::string>> images;
+
+    if (full) {
+      for (auto& [table_name, table] : tables) {
+        images.emplace_back(
+            CheckpointImage::WorkingFileName(config_ref_.work_dir, table_name),
+            CheckpointImage::FileName(config_ref_.work_dir, table_name));
+        CheckpointImage::Writer image(images.back().first, epoch, partitions,
+                                      config_ref_.checkpoint_buffer_size);
+        CaptureTable(*table, partitions, epoch, stable_epoch, full,
+                     [&](size_t partition, std::string_view key,
+                         std::string& value, TransactionId tid) {
+                       image.Add(partition, key, value, tid);
+                     });
+        image.Finish();
+      }
+    } else {
+      CheckpointWriter delta(CheckpointWorkingFileName,
+                             config_ref_.checkpoint_buffer_size);
+      const size_t chunk_size = delta.ChunkSize(partitions);
+      std::vector<Recovery::Logger::LogRecords> records(partitions);
+      std::vector<size_t> bytes(partitions, 0);
+      for (auto& partition_records : records) {
+        partition_records.emplace_back();
+        partition_records.back().epoch = epoch;
+      }
+      auto pack = [&](size_t partition) {
+        msgpack::sbuffer packed;
+        compressor_.Pack(records[partition], packed);
+        delta.Append(
+            CheckpointWriter::Checksummed(packed.data(), packed.size()));
+        records[partition].back().key_value_pairs.clear();
+        bytes[partition] = 0;
+      };
+      for (auto& [table_name, table] : tables) {
+        CaptureTable(
+            *table, partitions, epoch, stable_epoch, full,
+            [&, table_name = table_name](size_t partition,
+                                         std::string_view key,
+                                         std::string& value,
+                                         TransactionId tid) {
+              Logger::LogRecord::KeyValuePair kvp;
+              std::string encoded;
+              kvp.key = Index::Table::EncodeKey(table_name, key, encoded);
+              kvp.buffer = std::move(value);
+              kvp.tid    = tid;
+              bytes[partition] += kvp.key.size() + kvp.buffer.size();
+              records[partition].back().key_value_pairs.emplace_back(
+                  std::move(kvp));
+              // The chunk of a partition is serialized by the same thread.
+              if (chunk_size <= bytes[partition]) pack(partition);
+            });
+      }
+      for (size_t i = 0; i < partitions; i++) {
+        if (!records[i].back().key_value_pairs.empty()) pack(i);
+      }
+      delta.Close();
+      images.emplace_back(CheckpointWorkingFileName,
+                          config_ref_.work_dir + "/" + DeltaFilePrefix +
+                              std::to_string(epoch) + ".log");
+    }
+
+    for (auto& [working_file, filename] : images) {
+      SPDLOG_DEBUG("RENAME checkpoint workingfile from {0} to {1}",
+                   working_file, filename);
+      // NOTE POSIX ensures that rename syscall provides atomicity
+      if (rename(working_file.c_str(), filename.c_str())) {
+        SPDLOG_ERROR(
+            "Durability Error: fail to rename checkpoint of the "
+            "epoch "
+            "{0:d}. "
+            "errno: {1}",
+            epoch, errno);
+        exit(1);
+      }
+    }
+    // The versions of the checkpoint epoch may be written before the phase
+    // becomes IN_PROGRESS, and then they are in this snapshot; the versions
+    // after the epoch are not.
+    dirty_epoch_ = periodic ? checkpoint_epoch_.load() : epoch + 1;
+    if (!full) {
+      delta_files_.emplace_back(images.back().second);
+      return;
+    }
+
+    // The full checkpoint has all the versions of the delta files.
+    for (auto& delta_file : delta_files_) {
+      if (unlink(delta_file.c_str()) != 0) {
+        SPDLOG_ERROR(
+            "Durability Error: fail to remove checkpoint file {0}. errno: {1}",
+            delta_file, errno);
+        exit(1);
+      }
+    }
+    delta_files_.clear();
+  }
+
+  /**
+   * @brief
+   * Captures the stable versions of `table` in `partitions` partitions, and
+   * passes each of them to `f` with its partition; see #SaveSnapshot.
+   */
+  template <typename F>
+  void CaptureTable(Index::ConcurrentTable& table, const size_t partitions,
+                    const EpochNumber epoch, const EpochNumber stable_epoch,
+                    const bool full, F&& f) {
+    table.ParallelForEach(
+        partitions, [&](size_t partition, std::string_view key,
+                        LineairDB::DataItem& data_item) {
+          std::string value;
+          TransactionId tid;
+          if (ReadStableVersion(data_item, stable_epoch, full, value, tid)) {
+            // NOTE: the TwoPhaseLocking protocols do not assign transaction
+            // ids; the version is regarded as the one of `epoch`.
+            if (tid.IsEmpty()) tid = TransactionId(epoch, 0);
+            f(partition, key, value, tid);
+          }
+          ReleaseStaleVersion(data_item, stable_epoch);
+          return true;
+        },
+        [&](size_t partitions, const std::function<void(size_t)>& capture) {
+          RunPartitions(partitions, capture);
+        });
+  }
+
+  /**
+   * @brief
+   * Runs `job` for each of `partitions` on the workers of the thread pool,
+   * and waits for them. If the pool does not accept jobs, e.g., while the
+   * database is being destructed, a thread of its own runs them; the callee
+   * thread pins the index during the capture, and the jobs look it up.
+   */
+  void RunPartitions(const size_t partitions,
+                     const std::function<void(size_t)>& job) {
+    std::atomic<size_t> running(partitions);
+    EventCount finished;
+    std::vector<ThreadPool::Job> jobs;
+    for (size_t i = 0; i < partitions; i++) {
+      jobs.emplace_back([&job, &running, &finished, i]() {
+        job(i);
+        if (running.fetch_sub(1) == 1) finished.Notify();
+      });
+    }
+    if (!thread_pool_ref_.EnqueueBulk(jobs)) {
+      std::thread([&]() {
+        for (size_t i = 0; i < partitions; i++) job(i);
+      }).join();
+      return;
+    }
+    while (running.load() != 0) {
+      const auto key = finished.PrepareWait();
+      if (running.load() == 0) {
+        finished.CancelWait();
+        break;
+      }
+      finished.Wait(key, std::chrono::milliseconds(1));
+    }
+  }
+
+  /**
+   * @brief
+   * Reads the version of `item` at the point of consistency of the
+   * checkpoint `stable_epoch` into `value` and `tid`. Recovery compares it
+   * with the logs by the transaction id, as the log records.
+   * With Silo and SiloNWR, it reads optimistically and validates the
+   * transaction id, as transactions do. The TwoPhaseLocking protocols write
+   * values in place without updating transaction ids, and thus it takes the
+   * shared lock for them.
+   * @return false if the version is absent, or if the item is skipped by an
+   * incremental checkpoint.
+   */
+  bool ReadStableVersion(DataItem& item, const EpochNumber stable_epoch,
+                         const bool full, std::string& value,
+                         TransactionId& tid) {
+    auto copy = [&](const TransactionId current) {
+      if (item.checkpoint_epoch == stable_epoch) {
+        tid = item.checkpoint_tid;
+        if (item.checkpoint_buffer.IsEmpty() && (full || tid.IsEmpty())) {
+          return false;
+        }
+        value = item.checkpoint_buffer.toString();
+        return true;
+      }
+      // Otherwise, this data item holds version which has written before
+      // the point of consistency.
+      // NOTE: a full checkpoint omits tombstones; an incremental one records
+      // them as empty values, which hide the versions of the former files.
+      if (!item.IsInitialized() && (full || current.IsEmpty())) return false;
+      if (!full && current.epoch < dirty_epoch_) return false;
+      tid   = current;
+      value = item.IsInitialized() ? item.buffer.toString() : std::string();
+      return true;
+    };
+
+    if (is_two_phase_locking_) {
+      using LockType = decltype(DataItem::readers_writers_lock)::LockType;
+      item.GetRWLockRef().Lock(LockType::Shared);
+      const bool captured = copy(item.transaction_id.load());
+      item.GetRWLockRef().UnLock();
+      return captured;
+    }
+    for (;;) {
+      const auto tid = item.transaction_id.load();
+      if (tid.tid & 1llu) {  // locked
+        wait_policy_.WaitUntil(&item, [&]() { return item.IsUnlocked(); });
+        continue;
+      }
+      const bool captured = copy(tid);
+      if (item.transaction_id.load() == tid) return captured;
+    }
+  }
+
+  /**
+   * @brief
+   * Frees the version which `item` has kept for a former checkpoint.
+   */
+  void ReleaseStaleVersion(DataItem& item, const EpochNumber stable_epoch) {
+    if (item.checkpoint_epoch == stable_epoch ||
+        item.checkpoint_buffer.IsEmpty()) {
+      return;
+    }
+    item.ExclusiveLock(wait_policy_);
+    if (item.checkpoint_epoch != stable_epoch) item.ReleaseStableVersion();
+    item.ExclusiveUnlock(wait_policy_);
+  }
+
+  std::vector<std::string> GetExistingDeltaFiles() const {
+    namespace fs = std::experimental::filesystem;
+    std::vector<std::string> files;
+    std::error_code ec;
+    for (fs::directory_iterator it(config_ref_.work_dir, ec), end;
+         !ec && it != end; it.increment(ec)) {
+      if (it->path().filename().generic_string().find(DeltaFilePrefix) == 0) {
+        files.emplace_back(it->path().generic_string());
+      }
+    }
+    return files;
   }
 
  private:
   const LineairDB::Config& config_ref_;
+  const LogCompressor compressor_;
   LineairDB::Index::ConcurrentTable& table_ref_;
   LineairDB::EpochFramework& epoch_manager_ref_;
+  ThreadPool& thread_pool_ref_;
   Logger::LogRecords log_records;
   std::atomic<Phase> current_phase_;
   std::atomic<EpochNumber> checkpoint_epoch_;  // 'v' in the CPR paper
   std::atomic<EpochNumber> checkpoint_completed_epoch_;
-  // BloomFilter bloom_filter_for_recent_updates_;
+  // The followings are protected by snapshot_lock_.
+  EpochNumber dirty_epoch_;
+  std::vector<std::string> delta_files_;
+  std::vector<Index::Table*> tables_;
+  const bool is_two_phase_locking_;
+  const Lock::WaitPolicy wait_policy_;
   std::atomic<bool> stop_;
+  std::mutex snapshot_lock_;
   std::thread manager_thread_;
   MSGPACK_DEFINE(log_records);
 };
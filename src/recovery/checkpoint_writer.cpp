@@ -0,0 +1,141 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "checkpoint_writer.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <msgpack.hpp>
+#include <util/logger.hpp>
+
+#include "util/checksum.hpp"
+
+namespace LineairDB {
+namespace Recovery {
+
+CheckpointWriter::CheckpointWriter(const std::string& filename,
+                                   const size_t buffer_size,
+                                   const uint64_t offset)
+    : filename_(filename),
+      buffer_size_(std::max<size_t>(2, buffer_size)),
+      queued_bytes_(0),
+      tail_(offset),
+      closing_(false) {
+  fd_ = open(filename_.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    SPDLOG_ERROR("Durability Error: fail to open checkpoint {0}. errno: {1}",
+                 filename_, errno);
+    exit(1);
+  }
+  io_thread_ = std::thread([&]() {
+    std::unique_lock<std::mutex> lock(lock_);
+    for (;;) {
+      queued_.wait(lock, [&]() { return closing_ || !queue_.empty(); });
+      if (queue_.empty()) return;
+      auto [chunk_offset, chunk] = std::move(queue_.front());
+      queue_.pop_front();
+      lock.unlock();
+      Write(chunk_offset, chunk.data(), chunk.size());
+      lock.lock();
+      queued_bytes_ -= chunk.size();
+      written_.notify_all();
+    }
+  });
+}
+
+CheckpointWriter::~CheckpointWriter() {
+  if (0 <= fd_) Close();
+}
+
+size_t CheckpointWriter::ChunkSize(const size_t producers) const {
+  return std::max<size_t>(1, buffer_size_ / 2 / std::max<size_t>(1, producers));
+}
+
+uint64_t CheckpointWriter::Append(std::string&& chunk) {
+  std::unique_lock<std::mutex> lock(lock_);
+  // A chunk larger than the buffer is written alone.
+  written_.wait(lock, [&]() {
+    return queued_bytes_ == 0 ||
+           queued_bytes_ + chunk.size() <= buffer_size_ / 2;
+  });
+  const uint64_t offset = tail_;
+  tail_ += chunk.size();
+  queued_bytes_ += chunk.size();
+  queue_.emplace_back(offset, std::move(chunk));
+  queued_.notify_one();
+  return offset;
+}
+
+void CheckpointWriter::Close(const std::string_view head) {
+  {
+    std::lock_guard<std::mutex> guard(lock_);
+    closing_ = true;
+  }
+  queued_.notify_one();
+  io_thread_.join();
+  Write(0, head.data(), head.size());
+  if (close(fd_) != 0) {
+    SPDLOG_ERROR("Durability Error: fail to close checkpoint {0}. errno: {1}",
+                 filename_, errno);
+    exit(1);
+  }
+  fd_ = -1;
+}
+
+void CheckpointWriter::Write(uint64_t offset, const char* data, size_t size) {
+  while (0 < size) {
+    const ssize_t written = pwrite(fd_, data, size, offset);
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) {
+      SPDLOG_ERROR(
+          "Durability Error: fail to write checkpoint {0}. errno: {1}",
+          filename_, errno);
+      exit(1);
+    }
+    offset += written;
+    data += written;
+    size -= written;
+  }
+}
+
+std::string CheckpointWriter::Checksummed(const char* data,
+                                          const size_t size) {
+  const uint32_t checksum = Util::Crc32c(data, size);
+  msgpack::sbuffer framed;
+  msgpack::packer<msgpack::sbuffer> packer(framed);
+  packer.pack_ext(sizeof(checksum) + size, ChecksumExtensionType);
+  packer.pack_ext_body(reinterpret_cast<const char*>(&checksum),
+                       sizeof(checksum));
+  packer.pack_ext_body(data, size);
+  return std::string(framed.data(), framed.size());
+}
+
+bool CheckpointWriter::Verify(const char* payload, const size_t size,
+                              std::string_view& records) {
+  uint32_t checksum;
+  if (size < sizeof(checksum)) return false;
+  std::memcpy(&checksum, payload, sizeof(checksum));
+  records = std::string_view(payload + sizeof(checksum),
+                             size - sizeof(checksum));
+  return Util::Crc32c(records.data(), records.size()) == checksum;
+}
+
+}  // namespace Recovery
+}  // namespace LineairDB
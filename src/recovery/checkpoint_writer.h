@@ -0,0 +1,109 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef LINEAIRDB_RECOVERY_CHECKPOINT_WRITER_H
+#define LINEAIRDB_RECOVERY_CHECKPOINT_WRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+
+namespace LineairDB {
+namespace Recovery {
+
+/**
+ * @brief
+ * Writes a checkpoint file chunk by chunk with an I/O thread, so that the
+ * checkpoint threads serialize the next chunks while the former ones are
+ * written. The chunks are placed one after another in the order of
+ * #Append, and the bytes of the chunks waiting for the I/O thread are
+ * bounded by a half of Config::checkpoint_buffer_size; the other half is
+ * for the chunks that the checkpoint threads are filling (see #ChunkSize).
+ */
+class CheckpointWriter {
+ public:
+  /**
+   * @brief The extension type of a chunk framed by #Checksummed.
+   */
+  static constexpr int8_t ChecksumExtensionType = 2;
+
+  /**
+   * @brief Truncates `filename`, and places the first chunk at `offset`.
+   */
+  CheckpointWriter(const std::string& filename, const size_t buffer_size,
+                   const uint64_t offset = 0);
+  ~CheckpointWriter();
+  CheckpointWriter(const CheckpointWriter&) = delete;
+  CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+  /**
+   * @brief Returns the size of the chunks that each of `producers`
+   * checkpoint threads fills before it appends them.
+   */
+  size_t ChunkSize(const size_t producers) const;
+  /**
+   * @brief Queues `chunk` to be written. Thread-safe. It blocks while the
+   * queued chunks fill the buffer.
+   * @return The offset of the chunk in the file.
+   */
+  uint64_t Append(std::string&& chunk);
+  /**
+   * @brief Waits for the queued chunks, writes `head` at the beginning of
+   * the file and closes it.
+   */
+  void Close(const std::string_view head = {});
+
+  /**
+   * @brief Frames the serialized log records `data` as a msgpack extension
+   * object of ChecksumExtensionType, whose payload is
+   *
+   *   CRC-32C of the records (4 bytes) | records
+   *
+   * so that Logger::ForEachLogRecords detects a broken chunk.
+   */
+  static std::string Checksummed(const char* data, const size_t size);
+  /**
+   * @brief Sets `records` to the records in the payload of an extension
+   * object of ChecksumExtensionType.
+   * @return false if the payload is broken.
+   */
+  static bool Verify(const char* payload, const size_t size,
+                     std::string_view& records);
+
+ private:
+  void Write(uint64_t offset, const char* data, size_t size);
+
+  const std::string filename_;
+  const size_t buffer_size_;
+  int fd_;
+  std::mutex lock_;
+  std::condition_variable queued_;
+  std::condition_variable written_;
+  std::deque<std::pair<uint64_t, std::string>> queue_;
+  size_t queued_bytes_;  // including the chunk being written
+  uint64_t tail_;
+  bool closing_;
+  std::thread io_thread_;
+};
+
+}  // namespace Recovery
+}  // namespace LineairDB
+#endif /* LINEAIRDB_RECOVERY_CHECKPOINT_WRITER_H */
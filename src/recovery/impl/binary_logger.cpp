@@ -0,0 +1,265 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "binary_logger.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <util/logger.hpp>
+
+#include "types/definitions.h"
+#include "types/snapshot.hpp"
+#include "util/checksum.hpp"
+
+namespace LineairDB {
+namespace Recovery {
+
+std::atomic<size_t> BinaryLogger::ThreadLocalStorageNode::ThreadIdCounter = {
+    0};
+
+BinaryLogger::ThreadLocalStorageNode::~ThreadLocalStorageNode() {
+  if (0 <= fd) close(fd);
+}
+
+BinaryLogger::BinaryLogger(const Config& config)
+    : WorkingDir(config.work_dir) {
+  LineairDB::Util::SetUpSPDLog();
+}
+
+void BinaryLogger::RememberMe(const EpochNumber epoch) {
+  auto* my_storage = thread_key_storage_.Get();
+  my_storage->durable_epoch.store(epoch);
+}
+
+void BinaryLogger::Enqueue(const WriteSetType& ws_ref, EpochNumber epoch,
+                           bool entrusting) {
+  if (ws_ref.empty()) return;
+
+  const size_t size   = RecordSize(ws_ref);
+  auto* my_storage    = thread_key_storage_.Get();
+  auto& buffer        = my_storage->buffer;
+  const size_t offset = buffer.size();
+  buffer.resize(offset + size);
+  WriteRecord(ws_ref, epoch, buffer.data() + offset, size);
+
+  if (offset == 0) {
+    my_storage->min_buffered_epoch = epoch;
+    my_storage->max_buffered_epoch = epoch;
+  } else {
+    my_storage->min_buffered_epoch =
+        std::min(my_storage->min_buffered_epoch, epoch);
+    my_storage->max_buffered_epoch =
+        std::max(my_storage->max_buffered_epoch, epoch);
+  }
+
+  if (entrusting) {
+    // The callee thread is not in the thread pool and may be terminated
+    // soon; we write the log record immediately, as ThreadLocalLogger does.
+    WriteBuffer(my_storage);
+    my_storage->durable_epoch.store(epoch);
+  }
+}
+
+size_t BinaryLogger::RecordSize(const WriteSetType& ws_ref) {
+  size_t size = sizeof(RecordHeader);
+  for (auto& snapshot : ws_ref) {
+    size += sizeof(EntryHeader) + snapshot.key.size() +
+            snapshot.data_item_copy.buffer.size;
+  }
+  return size;
+}
+
+void BinaryLogger::WriteRecord(const WriteSetType& ws_ref,
+                               const EpochNumber epoch, char* record,
+                               const size_t size) {
+  char* p = record + sizeof(RecordHeader);
+  for (auto& snapshot : ws_ref) {
+    const auto& value = snapshot.data_item_copy.buffer;
+    EntryHeader entry = {static_cast<uint32_t>(snapshot.key.size()),
+                         static_cast<uint32_t>(value.size),
+                         snapshot.data_item_copy.transaction_id.load()};
+    std::memcpy(p, &entry, sizeof(entry));
+    p += sizeof(entry);
+    std::memcpy(p, snapshot.key.data(), snapshot.key.size());
+    p += snapshot.key.size();
+    if (0 < value.size) std::memcpy(p, value.data(), value.size);
+    p += value.size;
+  }
+  assert(p == record + size);
+
+  RecordHeader header;
+  header.magic    = Magic;
+  header.size     = static_cast<uint32_t>(size - sizeof(RecordHeader));
+  header.epoch    = epoch;
+  header.count    = static_cast<uint32_t>(ws_ref.size());
+  header.checksum = 0;
+  std::memcpy(record, &header, sizeof(header));
+  // The checksum covers the rest of the header and the entries.
+  const size_t checksum_end = offsetof(RecordHeader, checksum) + 4;
+  header.checksum = Util::Crc32c(record + checksum_end, size - checksum_end);
+  std::memcpy(record, &header, sizeof(header));
+}
+
+void BinaryLogger::FlushLogs(EpochNumber stable_epoch) {
+  auto* my_storage = thread_key_storage_.Get();
+  WriteBuffer(my_storage);
+  my_storage->durable_epoch.store(stable_epoch);
+}
+
+void BinaryLogger::WriteBuffer(ThreadLocalStorageNode* my_storage) {
+  auto& buffer = my_storage->buffer;
+  if (buffer.empty()) return;
+  std::lock_guard<std::mutex> guard(my_storage->lock);
+
+  if (my_storage->fd < 0) {
+    auto filename = GetLogFileName(my_storage->thread_id,
+                                   my_storage->min_buffered_epoch);
+    my_storage->fd =
+        open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (my_storage->fd < 0) {
+      SPDLOG_ERROR("Durability Error: fail to open logfile {0}. errno: {1}",
+                   filename, errno);
+      exit(1);
+    }
+    my_storage->segments.push_back(
+        {std::move(filename), my_storage->max_buffered_epoch});
+  }
+  auto& segment     = my_storage->segments.back();
+  segment.max_epoch = std::max(segment.max_epoch,
+                               my_storage->max_buffered_epoch);
+
+  const char* p = buffer.data();
+  size_t size   = buffer.size();
+  while (0 < size) {
+    const ssize_t written = write(my_storage->fd, p, size);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      SPDLOG_ERROR("Durability Error: fail to write logfile. errno: {0}",
+                   errno);
+      exit(1);
+    }
+    p += written;
+    size -= written;
+  }
+  // NOTE: clear() keeps the capacity; the next epoch reuses the buffer.
+  buffer.clear();
+}
+
+void BinaryLogger::TruncateLogs(const EpochNumber checkpoint_completed_epoch) {
+  thread_key_storage_.ForEach([&](ThreadLocalStorageNode* node) {
+    std::lock_guard<std::mutex> guard(node->lock);
+    Truncate(node, checkpoint_completed_epoch);
+  });
+}
+
+void BinaryLogger::Truncate(ThreadLocalStorageNode* my_storage,
+                            const EpochNumber checkpoint_completed_epoch) {
+  if (checkpoint_completed_epoch <= my_storage->truncated_epoch) return;
+
+  // The records written after here go to a new segment, so that the current
+  // one is removed by a later checkpoint.
+  if (0 <= my_storage->fd) {
+    close(my_storage->fd);
+    my_storage->fd = -1;
+  }
+
+  std::vector<Segment> remaining;
+  for (auto& segment : my_storage->segments) {
+    if (checkpoint_completed_epoch <= segment.max_epoch) {
+      remaining.emplace_back(std::move(segment));
+      continue;
+    }
+    if (unlink(segment.filename.c_str()) != 0) {
+      SPDLOG_ERROR("Durability Error: fail to truncate logfile {0}. errno: {1}",
+                   segment.filename, errno);
+      exit(1);
+    }
+  }
+  my_storage->segments        = std::move(remaining);
+  my_storage->truncated_epoch = checkpoint_completed_epoch;
+}
+
+EpochNumber BinaryLogger::GetMinDurableEpochForAllThreads() {
+  EpochNumber min_flushed_epoch = EpochFramework::THREAD_OFFLINE;
+  thread_key_storage_.ForEach(
+      [&](const ThreadLocalStorageNode* thread_local_node) {
+        const EpochNumber epoch = thread_local_node->durable_epoch.load();
+        if (epoch == EpochFramework::THREAD_OFFLINE) return;
+        if (epoch < min_flushed_epoch) min_flushed_epoch = epoch;
+      });
+  return min_flushed_epoch;
+}
+
+std::string BinaryLogger::GetLogFileName(size_t thread_id,
+                                         EpochNumber epoch) const {
+  const auto prefix = WorkingDir + "/thread" + std::to_string(thread_id) +
+                      "." + std::to_string(epoch);
+  // A new segment never reuses the files left by the previous processes.
+  auto filename = prefix + ".log";
+  for (size_t i = 1; access(filename.c_str(), F_OK) == 0; i++) {
+    filename = prefix + "-" + std::to_string(i) + ".log";
+  }
+  return filename;
+}
+
+bool BinaryLogger::IsBinaryLog(std::string_view buffer) {
+  uint32_t magic;
+  if (buffer.size() < sizeof(magic)) return false;
+  std::memcpy(&magic, buffer.data(), sizeof(magic));
+  return magic == Magic;
+}
+
+bool BinaryLogger::ForEachEntry(std::string_view buffer,
+                                const std::function<void(const Entry&)>& f) {
+  const size_t checksum_end = offsetof(RecordHeader, checksum) + 4;
+  while (!buffer.empty()) {
+    RecordHeader header;
+    if (buffer.size() < sizeof(header)) return false;
+    std::memcpy(&header, buffer.data(), sizeof(header));
+    if (header.magic == 0 && header.size == 0) return true;
+    if (header.magic != Magic) return false;
+    const size_t size = sizeof(header) + header.size;
+    if (buffer.size() < size) return false;
+    const uint32_t checksum = Util::Crc32c(buffer.data() + checksum_end,
+                                           size - checksum_end);
+    if (checksum != header.checksum) return false;
+
+    auto entries = buffer.substr(sizeof(header), header.size);
+    buffer.remove_prefix(size);
+    for (uint32_t i = 0; i < header.count; i++) {
+      EntryHeader entry;
+      if (entries.size() < sizeof(entry)) return false;
+      std::memcpy(&entry, entries.data(), sizeof(entry));
+      entries.remove_prefix(sizeof(entry));
+      if (entries.size() < size_t{entry.key_size} + entry.value_size) {
+        return false;
+      }
+      f({header.epoch, entries.substr(0, entry.key_size),
+         entries.substr(entry.key_size, entry.value_size), entry.tid});
+      entries.remove_prefix(entry.key_size + entry.value_size);
+    }
+  }
+  return true;
+}
+
+}  // namespace Recovery
+}  // namespace LineairDB
@@ -0,0 +1,151 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef LINEAIRDB_RECOVERY_BINARY_LOGGER_H
+#define LINEAIRDB_RECOVERY_BINARY_LOGGER_H
+
+#include <lineairdb/config.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "recovery/logger_base.h"
+#include "types/definitions.h"
+#include "types/transaction_id.hpp"
+#include "util/epoch_framework.hpp"
+#include "util/thread_key_storage.h"
+
+namespace LineairDB {
+namespace Recovery {
+
+/**
+ * @brief
+ * A thread-local logger that writes the write sets in a compact binary
+ * format instead of msgpack.
+ * At commit, Enqueue serializes the snapshots directly into the log buffer
+ * of the callee thread, which is reused across epochs; it allocates no
+ * object for each written item. A log record of a transaction is laid out
+ * as follows (in the native byte order):
+ *
+ *   RecordHeader | (EntryHeader | key | value) * count
+ *
+ * where RecordHeader::checksum is CRC-32C of the rest of the record, so
+ * that recovery detects a torn write at the tail of a log file.
+ * The log files are split into segments as in ThreadLocalLogger.
+ */
+class BinaryLogger final : public LoggerBase {
+ public:
+  static constexpr uint32_t Magic = 0x474f4c42;  // "BLOG"
+
+  struct RecordHeader {
+    uint32_t magic;
+    uint32_t checksum;
+    uint32_t size;  // the bytes after this header
+    EpochNumber epoch;
+    uint32_t count;
+  };
+  struct EntryHeader {
+    uint32_t key_size;
+    uint32_t value_size;
+    TransactionId tid;
+  };
+  struct Entry {
+    EpochNumber epoch;
+    std::string_view key;
+    std::string_view value;
+    TransactionId tid;
+  };
+
+  BinaryLogger(const Config&);
+  void RememberMe(const EpochNumber) final override;
+  void Enqueue(const WriteSetType& ws_ref_, EpochNumber epoch,
+               bool entrusting) final override;
+  void FlushLogs(EpochNumber stable_epoch) final override;
+  void TruncateLogs(
+      const EpochNumber checkpoint_completed_epoch) final override;
+  EpochNumber GetMinDurableEpochForAllThreads() final override;
+  std::string GetLogFileName(size_t thread_id, EpochNumber epoch) const;
+
+  /**
+   * @brief Returns the bytes of the record of `ws_ref`.
+   */
+  static size_t RecordSize(const WriteSetType& ws_ref);
+  /**
+   * @brief Serializes `ws_ref` as a record of `epoch` into the
+   * #RecordSize bytes at `record`.
+   */
+  static void WriteRecord(const WriteSetType& ws_ref, EpochNumber epoch,
+                          char* record, size_t size);
+  /**
+   * @brief Returns true if `buffer` begins with a record of this format.
+   */
+  static bool IsBinaryLog(std::string_view buffer);
+  /**
+   * @brief Calls `f` for each entry of the records in `buffer`. The entries
+   * refer to `buffer` without copying. A header of zeros ends the records,
+   * as the unwritten tail of a preallocated file does.
+   * @return false if a broken or torn record is found; the records before
+   * it have been passed to `f`.
+   */
+  static bool ForEachEntry(std::string_view buffer,
+                           const std::function<void(const Entry&)>& f);
+
+ private:
+  struct Segment {
+    std::string filename;
+    EpochNumber max_epoch;
+  };
+
+  struct ThreadLocalStorageNode {
+   private:
+    static std::atomic<size_t> ThreadIdCounter;
+
+   public:
+    size_t thread_id;
+    std::atomic<EpochNumber> durable_epoch;
+    // excludes #TruncateLogs from the writes of the owner thread.
+    std::mutex lock;
+    EpochNumber truncated_epoch;
+    int fd;
+    std::vector<Segment> segments;
+    std::vector<char> buffer;
+    EpochNumber min_buffered_epoch;
+    EpochNumber max_buffered_epoch;
+
+    ThreadLocalStorageNode()
+        : thread_id(ThreadIdCounter.fetch_add(1)),
+          durable_epoch(EpochFramework::THREAD_OFFLINE),
+          truncated_epoch(0),
+          fd(-1),
+          min_buffered_epoch(0),
+          max_buffered_epoch(0) {}
+    ~ThreadLocalStorageNode();
+  };
+
+  void WriteBuffer(ThreadLocalStorageNode*);
+  void Truncate(ThreadLocalStorageNode*, EpochNumber checkpoint_completed);
+
+  std::string WorkingDir;
+  ThreadKeyStorage<ThreadLocalStorageNode> thread_key_storage_;
+};
+
+}  // namespace Recovery
+}  // namespace LineairDB
+#endif /* LINEAIRDB_RECOVERY_BINARY_LOGGER_H */
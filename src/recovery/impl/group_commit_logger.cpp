@@ -0,0 +1,436 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "group_commit_logger.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <msgpack.hpp>
+#include <util/logger.hpp>
+
+#include "recovery/logger.h"
+#include "types/definitions.h"
+
+namespace LineairDB {
+namespace Recovery {
+
+namespace {
+// O_DIRECT requires the buffers, the sizes and the offsets of writes to be
+// aligned to the logical block size of the device.
+constexpr size_t BlockSize = 4096;
+// The unit of the preallocation of the log files with O_DIRECT.
+constexpr uint64_t SegmentSize = 16 << 20;
+// msgpack nil, which pads the blocks written with O_DIRECT.
+constexpr char Padding = static_cast<char>(0xc0);
+
+bool WriteAll(int fd, const char* buffer, size_t size, uint64_t offset) {
+  while (0 < size) {
+    const ssize_t written = pwrite(fd, buffer, size, offset);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    buffer += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
+
+void SyncDirectory(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0 || fsync(fd) != 0) {
+    SPDLOG_ERROR("Durability Error: fail to sync directory {0}. errno: {1}",
+                 path, errno);
+    exit(1);
+  }
+  close(fd);
+}
+}  // namespace
+
+std::atomic<size_t> GroupCommitLogger::ThreadLocalStorageNode::ThreadIdCounter =
+    {0};
+
+GroupCommitLogger::ThreadLocalStorageNode::~ThreadLocalStorageNode() {
+  if (0 <= fd) close(fd);
+}
+
+GroupCommitLogger::GroupCommitLogger(const Config& config)
+    : WorkingDir(config.work_dir),
+      enable_direct_io_(config.enable_direct_log_io),
+      compressor_(config),
+      ring_(static_cast<unsigned>(
+          std::min<size_t>(4 * config.max_thread + 16, 4096))),
+      pending_syncs_(0),
+      syncing_epoch_(EpochFramework::THREAD_OFFLINE),
+      synced_epoch_(EpochFramework::THREAD_OFFLINE) {
+  LineairDB::Util::SetUpSPDLog();
+  if (!ring_.IsAvailable()) {
+    SPDLOG_INFO(
+        "io_uring is not available; GroupCommitLogger uses blocking writes.");
+  }
+}
+
+GroupCommitLogger::~GroupCommitLogger() {
+  std::lock_guard<std::mutex> lock(ring_lock_);
+  thread_key_storage_.ForEach([&](ThreadLocalStorageNode* node) {
+    while (node->in_flight != 0) WaitForCompletion();
+  });
+  while (pending_syncs_ != 0) WaitForCompletion();
+}
+
+void GroupCommitLogger::RememberMe(const EpochNumber epoch) {
+  auto* my_storage = thread_key_storage_.Get();
+  my_storage->durable_epoch.store(epoch);
+}
+
+void GroupCommitLogger::Enqueue(const WriteSetType& ws_ref, EpochNumber epoch,
+                                bool entrusting) {
+  if (ws_ref.empty()) return;
+
+  Recovery::Logger::LogRecord record;
+  {
+    record.epoch = epoch;
+
+    for (auto& snapshot : ws_ref) {
+      Logger::LogRecord::KeyValuePair kvp;
+      kvp.key    = snapshot.key;
+      kvp.buffer = snapshot.data_item_copy.buffer.toString();
+      kvp.tid    = snapshot.data_item_copy.transaction_id.load();
+
+      record.key_value_pairs.emplace_back(std::move(kvp));
+    }
+  }
+  auto* my_storage = thread_key_storage_.Get();
+  my_storage->log_records.emplace_back(std::move(record));
+
+  if (entrusting) {
+    // The callee thread is not in the thread pool and may be terminated
+    // soon; we submit the log records immediately, as ThreadLocalLogger
+    // does.
+    Submit(my_storage);
+    my_storage->durable_epoch.store(epoch);
+  }
+}
+
+void GroupCommitLogger::FlushLogs(EpochNumber stable_epoch) {
+  auto* my_storage = thread_key_storage_.Get();
+  Submit(my_storage);
+  // NOTE: the logs may be still in flight. The epoch thread regards them as
+  // durable after the completions of them and of the following fdatasync.
+  my_storage->durable_epoch.store(stable_epoch);
+}
+
+void GroupCommitLogger::TruncateLogs(
+    const EpochNumber checkpoint_completed_epoch) {
+  thread_key_storage_.ForEach([&](ThreadLocalStorageNode* node) {
+    std::lock_guard<std::mutex> guard(node->lock);
+    Truncate(node, checkpoint_completed_epoch);
+  });
+}
+
+void GroupCommitLogger::Truncate(
+    ThreadLocalStorageNode* my_storage,
+    const EpochNumber checkpoint_completed_epoch) {
+  if (checkpoint_completed_epoch <= my_storage->truncated_epoch) return;
+
+  std::lock_guard<std::mutex> lock(ring_lock_);
+  while (my_storage->in_flight != 0 || my_storage->syncing) {
+    WaitForCompletion();
+  }
+
+  // The records written after here go to a new segment, so that the current
+  // one is removed by a later checkpoint.
+  if (0 <= my_storage->fd) {
+    if (dirty_nodes_.erase(my_storage) != 0 && fdatasync(my_storage->fd)) {
+      SPDLOG_ERROR("Durability Error: fail to sync logfile. errno: {0}",
+                   errno);
+      exit(1);
+    }
+    close(my_storage->fd);
+    my_storage->fd = -1;
+  }
+
+  std::vector<Segment> remaining;
+  for (auto& segment : my_storage->segments) {
+    if (checkpoint_completed_epoch <= segment.max_epoch) {
+      remaining.emplace_back(std::move(segment));
+      continue;
+    }
+    if (unlink(segment.filename.c_str()) != 0) {
+      SPDLOG_ERROR("Durability Error: fail to truncate logfile {0}. errno: {1}",
+                   segment.filename, errno);
+      exit(1);
+    }
+  }
+  my_storage->segments        = std::move(remaining);
+  my_storage->truncated_epoch = checkpoint_completed_epoch;
+}
+
+EpochNumber GroupCommitLogger::GetMinDurableEpochForAllThreads() {
+  EpochNumber min_flushed_epoch = EpochFramework::THREAD_OFFLINE;
+  thread_key_storage_.ForEach(
+      [&](const ThreadLocalStorageNode* thread_local_node) {
+        const EpochNumber epoch = thread_local_node->durable_epoch.load();
+        if (epoch == EpochFramework::THREAD_OFFLINE) return;
+        if (epoch < min_flushed_epoch) min_flushed_epoch = epoch;
+      });
+
+  std::lock_guard<std::mutex> lock(ring_lock_);
+  ReapCompletions();
+  if (pending_syncs_ != 0) return synced_epoch_;
+  if (min_flushed_epoch == EpochFramework::THREAD_OFFLINE) {
+    return synced_epoch_;
+  }
+  if (synced_epoch_ != EpochFramework::THREAD_OFFLINE &&
+      min_flushed_epoch <= synced_epoch_) {
+    return synced_epoch_;
+  }
+
+  if (dirty_nodes_.empty()) {
+    synced_epoch_ = min_flushed_epoch;
+  } else if (!ring_.IsAvailable()) {
+    for (auto* node : dirty_nodes_) {
+      if (fdatasync(node->fd) != 0) {
+        SPDLOG_ERROR("Durability Error: fail to sync logfile. errno: {0}",
+                     errno);
+        exit(1);
+      }
+    }
+    dirty_nodes_.clear();
+    synced_epoch_ = min_flushed_epoch;
+  } else {
+    // One fdatasync for each log file written in this epoch. The first one
+    // drains the ring, i.e., it waits for all the writes submitted so far.
+    syncing_epoch_ = min_flushed_epoch;
+    pending_syncs_ = dirty_nodes_.size();
+    bool drain     = true;
+    for (auto* node : dirty_nodes_) {
+      node->syncing = true;
+      syncing_nodes_.push_back(node);
+      SubmitRequest(new Request{node, node->fd, nullptr, 0, 0, 0}, drain);
+      drain = false;
+    }
+    dirty_nodes_.clear();
+  }
+  return synced_epoch_;
+}
+
+EpochNumber GroupCommitLogger::SyncLogsForAllThreads() {
+  // The first round may only wait for the fdatasyncs submitted before; the
+  // second one submits and waits for the ones of the logs flushed so far.
+  for (size_t round = 0; round < 2; round++) {
+    GetMinDurableEpochForAllThreads();
+    std::lock_guard<std::mutex> lock(ring_lock_);
+    while (pending_syncs_ != 0) WaitForCompletion();
+  }
+  std::lock_guard<std::mutex> lock(ring_lock_);
+  return synced_epoch_;
+}
+
+std::string GroupCommitLogger::GetLogFileName(size_t thread_id,
+                                              EpochNumber epoch) const {
+  const auto prefix = WorkingDir + "/thread" + std::to_string(thread_id) +
+                      "." + std::to_string(epoch);
+  auto filename = prefix + ".log";
+  for (size_t i = 1; access(filename.c_str(), F_OK) == 0; i++) {
+    filename = prefix + "-" + std::to_string(i) + ".log";
+  }
+  return filename;
+}
+
+void GroupCommitLogger::OpenLogFile(ThreadLocalStorageNode* node,
+                                    EpochNumber epoch) {
+  std::string filename;
+  int fd;
+  do {
+    filename = GetLogFileName(node->thread_id, epoch);
+    fd       = open(filename.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+  } while (fd < 0 && errno == EEXIST);
+  if (fd < 0) {
+    SPDLOG_ERROR("Durability Error: fail to open logfile {0}. errno: {1}",
+                 filename, errno);
+    exit(1);
+  }
+  // The new segment has to survive a crash as well as the records in it.
+  SyncDirectory(WorkingDir);
+
+  node->direct = false;
+  if (enable_direct_io_) {
+    const int direct_fd = open(filename.c_str(), O_WRONLY | O_DIRECT);
+    if (0 <= direct_fd) {
+      close(fd);
+      fd           = direct_fd;
+      node->direct = true;
+    } else {
+      SPDLOG_DEBUG("O_DIRECT is not supported on {0}. errno: {1}", filename,
+                   errno);
+    }
+  }
+  node->fd        = fd;
+  node->offset    = 0;
+  node->allocated = 0;
+  node->segments.push_back({std::move(filename), epoch});
+}
+
+void GroupCommitLogger::Submit(ThreadLocalStorageNode* node) {
+  auto& records = node->log_records;
+  if (records.empty()) return;
+  std::lock_guard<std::mutex> guard(node->lock);
+
+  EpochNumber min_epoch = records.front().epoch;
+  EpochNumber max_epoch = records.front().epoch;
+  for (auto& record : records) {
+    min_epoch = std::min(min_epoch, record.epoch);
+    max_epoch = std::max(max_epoch, record.epoch);
+  }
+  if (node->fd < 0) OpenLogFile(node, min_epoch);
+  auto& segment     = node->segments.back();
+  segment.max_epoch = std::max(segment.max_epoch, max_epoch);
+
+  msgpack::sbuffer sbuffer;
+  compressor_.Pack(records, sbuffer);
+  records.clear();
+
+  size_t size = sbuffer.size();
+  char* buffer;
+  if (node->direct) {
+    const size_t padded_size = (size + BlockSize - 1) / BlockSize * BlockSize;
+    buffer = static_cast<char*>(std::aligned_alloc(BlockSize, padded_size));
+    std::memcpy(buffer, sbuffer.data(), size);
+    std::memset(buffer + size, Padding, padded_size - size);
+    size = padded_size;
+    // Preallocation is an optimization; we ignore the failures of it.
+    while (node->allocated < node->offset + size) {
+      fallocate(node->fd, FALLOC_FL_KEEP_SIZE, node->allocated, SegmentSize);
+      node->allocated += SegmentSize;
+    }
+  } else {
+    buffer = sbuffer.release();
+  }
+  Write(node, buffer, size);
+}
+
+void GroupCommitLogger::Write(ThreadLocalStorageNode* node, char* buffer,
+                              size_t size) {
+  const uint64_t offset = node->offset;
+  node->offset += size;
+
+  if (!ring_.IsAvailable()) {
+    if (!WriteAll(node->fd, buffer, size, offset)) {
+      SPDLOG_ERROR("Durability Error: fail to write logfile. errno: {0}",
+                   errno);
+      exit(1);
+    }
+    std::free(buffer);
+    std::lock_guard<std::mutex> lock(ring_lock_);
+    dirty_nodes_.insert(node);
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(ring_lock_);
+  ReapCompletions();
+  node->in_flight++;
+  dirty_nodes_.insert(node);
+  SubmitRequest(new Request{node, node->fd, buffer, size, 0, offset});
+}
+
+void GroupCommitLogger::SubmitRequest(Request* request, bool drain) {
+  IoUring::SubmissionEntry* sqe;
+  while ((sqe = ring_.GetSubmissionEntry()) == nullptr) {
+    if (!ring_.Submit()) break;
+  }
+  if (sqe != nullptr) {
+    const auto user_data = reinterpret_cast<uint64_t>(request);
+    if (request->buffer == nullptr) {
+      ring_.PrepareDataSync(sqe, request->fd, drain, user_data);
+    } else {
+      const size_t written = request->written;
+      ring_.PrepareWrite(sqe, request->fd, request->buffer + written,
+                         static_cast<unsigned>(request->size - written),
+                         request->offset + written, user_data);
+    }
+  }
+  if (sqe == nullptr || !ring_.Submit()) {
+    SPDLOG_ERROR("Durability Error: fail to submit logs. errno: {0}", errno);
+    exit(1);
+  }
+}
+
+void GroupCommitLogger::ReapCompletions() {
+  std::vector<Request*> retries;
+  ring_.ForEachCompletion([&](uint64_t user_data, int32_t result) {
+    auto* request = reinterpret_cast<Request*>(user_data);
+    // The kernel cancels the requests that have not started when the
+    // submitter thread exits, e.g., a thread that has entrusted its logs.
+    if (result == -ECANCELED || result == -EINTR || result == -EAGAIN) {
+      retries.push_back(request);
+      return;
+    }
+    if (result < 0 || (request->buffer != nullptr && result == 0)) {
+      SPDLOG_ERROR("Durability Error: fail to persist logfile. errno: {0}",
+                   -result);
+      exit(1);
+    }
+
+    if (request->buffer == nullptr) {
+      assert(0 < pending_syncs_);
+      if (--pending_syncs_ == 0) {
+        for (auto* node : syncing_nodes_) node->syncing = false;
+        syncing_nodes_.clear();
+        synced_epoch_ = syncing_epoch_;
+      }
+    } else {
+      request->written += result;
+      if (request->written < request->size) {
+        retries.push_back(request);
+        return;
+      }
+      request->node->in_flight--;
+      std::free(request->buffer);
+    }
+    delete request;
+  });
+
+  // Writes go first, so that the (draining) fdatasync follows them.
+  std::stable_partition(retries.begin(), retries.end(),
+                        [](Request* r) { return r->buffer != nullptr; });
+  bool drain = true;
+  for (auto* request : retries) {
+    const bool sync = request->buffer == nullptr;
+    SubmitRequest(request, sync && drain);
+    if (sync) drain = false;
+  }
+}
+
+void GroupCommitLogger::WaitForCompletion() {
+  if (!ring_.Submit(1)) {
+    SPDLOG_ERROR("Durability Error: fail to wait for logs. errno: {0}",
+                 errno);
+    exit(1);
+  }
+  ReapCompletions();
+}
+
+}  // namespace Recovery
+}  // namespace LineairDB
@@ -0,0 +1,138 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef LINEAIRDB_RECOVERY_GROUP_COMMIT_LOGGER_H
+#define LINEAIRDB_RECOVERY_GROUP_COMMIT_LOGGER_H
+
+#include <lineairdb/config.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "io_uring.hpp"
+#include "recovery/log_compression.h"
+#include "recovery/logger.h"
+#include "recovery/logger_base.h"
+#include "types/definitions.h"
+#include "util/epoch_framework.hpp"
+#include "util/thread_key_storage.h"
+
+namespace LineairDB {
+namespace Recovery {
+
+/**
+ * @brief
+ * A logger that persists the logs of all threads with group commit.
+ * Each thread submits its log buffer as an asynchronous write through
+ * io_uring in FlushLogs. The epoch thread submits one fdatasync for each
+ * log file written in the epoch, and reports an epoch as durable only after
+ * the completions of them have arrived.
+ * If io_uring is not available, the threads write with pwrite and the epoch
+ * thread calls fdatasync instead.
+ */
+class GroupCommitLogger final : public LoggerBase {
+ public:
+  GroupCommitLogger(const Config&);
+  ~GroupCommitLogger();
+  void RememberMe(const EpochNumber) final override;
+  void Enqueue(const WriteSetType& ws_ref_, EpochNumber epoch,
+               bool entrusting) final override;
+  void FlushLogs(EpochNumber stable_epoch) final override;
+  void TruncateLogs(
+      const EpochNumber checkpoint_completed_epoch) final override;
+  EpochNumber GetMinDurableEpochForAllThreads() final override;
+  EpochNumber SyncLogsForAllThreads() final override;
+  std::string GetLogFileName(size_t thread_id, EpochNumber epoch) const;
+
+ private:
+  // A log file of a thread; see ThreadLocalLogger::Segment.
+  struct Segment {
+    std::string filename;
+    EpochNumber max_epoch;
+  };
+
+  struct ThreadLocalStorageNode {
+   private:
+    static std::atomic<size_t> ThreadIdCounter;
+
+   public:
+    size_t thread_id;
+    // The latest epoch whose logs have been submitted by this thread.
+    std::atomic<EpochNumber> durable_epoch;
+    // excludes #TruncateLogs from the writes of the owner thread; it is
+    // acquired before ring_lock_.
+    std::mutex lock;
+    EpochNumber truncated_epoch;
+    int fd;
+    bool direct;
+    uint64_t offset;
+    uint64_t allocated;
+    std::vector<Segment> segments;
+    Logger::LogRecords log_records;
+    // The followings are protected by ring_lock_.
+    size_t in_flight;
+    bool syncing;
+
+    ThreadLocalStorageNode()
+        : thread_id(ThreadIdCounter.fetch_add(1)),
+          durable_epoch(EpochFramework::THREAD_OFFLINE),
+          truncated_epoch(0),
+          fd(-1),
+          direct(false),
+          offset(0),
+          allocated(0),
+          in_flight(0),
+          syncing(false) {}
+    ~ThreadLocalStorageNode();
+  };
+
+  // A write (or an fdatasync if buffer is nullptr) submitted to the ring.
+  struct Request {
+    ThreadLocalStorageNode* node;
+    int fd;
+    char* buffer;
+    size_t size;
+    size_t written;
+    uint64_t offset;
+  };
+
+  void OpenLogFile(ThreadLocalStorageNode*, EpochNumber epoch);
+  void Submit(ThreadLocalStorageNode*);
+  void Truncate(ThreadLocalStorageNode*, EpochNumber checkpoint_completed);
+  void Write(ThreadLocalStorageNode*, char* buffer, size_t size);
+  void SubmitRequest(Request*, bool drain = false);
+  void ReapCompletions();
+  void WaitForCompletion();
+
+  const std::string WorkingDir;
+  const bool enable_direct_io_;
+  const LogCompressor compressor_;
+  std::mutex ring_lock_;
+  IoUring ring_;
+  std::unordered_set<ThreadLocalStorageNode*> dirty_nodes_;
+  std::vector<ThreadLocalStorageNode*> syncing_nodes_;
+  size_t pending_syncs_;
+  EpochNumber syncing_epoch_;
+  EpochNumber synced_epoch_;
+  ThreadKeyStorage<ThreadLocalStorageNode> thread_key_storage_;
+};
+
+}  // namespace Recovery
+}  // namespace LineairDB
+#endif /* LINEAIRDB_RECOVERY_GROUP_COMMIT_LOGGER_H */
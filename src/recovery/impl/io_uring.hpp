@@ -0,0 +1,227 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_RECOVERY_IO_URING_HPP
+#define LINEAIRDB_RECOVERY_IO_URING_HPP
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define LINEAIRDB_HAS_IO_URING 1
+#endif
+#endif
+
+namespace LineairDB {
+namespace Recovery {
+
+/**
+ * @brief
+ * A minimal io_uring [1] instance built on the raw system calls.
+ * It is not thread-safe; the callee serializes the calls.
+ * #IsAvailable returns false if the kernel (or a seccomp filter) does not
+ * allow io_uring; then the callee has to fall back to the blocking calls.
+ * @ref [1] https://kernel.dk/io_uring.pdf
+ */
+class IoUring {
+ public:
+#ifdef LINEAIRDB_HAS_IO_URING
+  using SubmissionEntry = struct io_uring_sqe;
+
+  explicit IoUring(unsigned entries) {
+    struct io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    const long fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd < 0) return;
+    ring_fd_ = static_cast<int>(fd);
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      if (sq_ring_size_ < cq_ring_size_) sq_ring_size_ = cq_ring_size_;
+      cq_ring_size_ = sq_ring_size_;
+    }
+    sq_ring_ = Map(sq_ring_size_, IORING_OFF_SQ_RING);
+    cq_ring_ = single_mmap ? sq_ring_ : Map(cq_ring_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_      = static_cast<struct io_uring_sqe*>(
+        Map(sqes_size_, IORING_OFF_SQES));
+    if (sq_ring_ == nullptr || cq_ring_ == nullptr || sqes_ == nullptr) {
+      Destroy();
+      return;
+    }
+
+    auto* sq    = static_cast<std::byte*>(sq_ring_);
+    sq_head_    = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_    = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_    = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_   = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+    auto* cq    = static_cast<std::byte*>(cq_ring_);
+    cq_head_    = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_    = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_    = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+    sqe_tail_ = *sq_tail_;
+  }
+  ~IoUring() { Destroy(); }
+
+  bool IsAvailable() const { return ring_fd_ >= 0; }
+
+  /**
+   * @brief Returns a cleared submission entry, or nullptr if the submission
+   * queue is full.
+   */
+  SubmissionEntry* GetSubmissionEntry() {
+    const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (sq_entries_ <= sqe_tail_ - head) return nullptr;
+    const unsigned index = sqe_tail_ & sq_mask_;
+    auto* sqe            = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    sqe_tail_++;
+    return sqe;
+  }
+
+  void PrepareWrite(SubmissionEntry* sqe, int fd, const void* buffer,
+                    unsigned size, uint64_t offset, uint64_t user_data) {
+    sqe->opcode    = IORING_OP_WRITE;
+    sqe->fd        = fd;
+    sqe->addr      = reinterpret_cast<uint64_t>(buffer);
+    sqe->len       = size;
+    sqe->off       = offset;
+    sqe->user_data = user_data;
+  }
+
+  /**
+   * @param drain if true, the kernel starts this fdatasync after all the
+   * entries submitted before it have completed.
+   */
+  void PrepareDataSync(SubmissionEntry* sqe, int fd, bool drain,
+                       uint64_t user_data) {
+    sqe->opcode      = IORING_OP_FSYNC;
+    sqe->fd          = fd;
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    if (drain) sqe->flags |= IOSQE_IO_DRAIN;
+    sqe->user_data = user_data;
+  }
+
+  /**
+   * @brief Submits the prepared entries, and waits for `wait_for`
+   * completions.
+   * @return false on a failure of io_uring_enter.
+   */
+  bool Submit(unsigned wait_for = 0) {
+    __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+    // The kernel may have left some of the entries submitted before.
+    const unsigned to_submit =
+        sqe_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (to_submit == 0 && wait_for == 0) return true;
+    for (;;) {
+      const long result =
+          syscall(__NR_io_uring_enter, ring_fd_, to_submit, wait_for,
+                  wait_for == 0 ? 0 : IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (0 <= result) return true;
+      if (errno != EINTR) return false;
+    }
+  }
+
+  /**
+   * @brief Calls f(user_data, result) for each arrived completion.
+   * @return the number of the completions.
+   */
+  template <typename F>
+  size_t ForEachCompletion(F&& f) {
+    unsigned head       = *cq_head_;
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    size_t count        = 0;
+    for (; head != tail; head++, count++) {
+      const auto& cqe = cqes_[head & cq_mask_];
+      f(cqe.user_data, cqe.res);
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    return count;
+  }
+
+ private:
+  void* Map(size_t size, off_t offset) {
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ring_fd_, offset);
+    return address == MAP_FAILED ? nullptr : address;
+  }
+
+  void Destroy() {
+    if (sqes_ != nullptr) munmap(sqes_, sqes_size_);
+    if (cq_ring_ != nullptr && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != nullptr) munmap(sq_ring_, sq_ring_size_);
+    if (0 <= ring_fd_) close(ring_fd_);
+    sqes_    = nullptr;
+    cq_ring_ = nullptr;
+    sq_ring_ = nullptr;
+    ring_fd_ = -1;
+  }
+
+  int ring_fd_ = -1;
+  void* sq_ring_ = nullptr;
+  void* cq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  size_t cq_ring_size_ = 0;
+  struct io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_size_          = 0;
+
+  unsigned* sq_head_  = nullptr;
+  unsigned* sq_tail_  = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned sq_mask_   = 0;
+  unsigned sq_entries_ = 0;
+  unsigned* cq_head_  = nullptr;
+  unsigned* cq_tail_  = nullptr;
+  unsigned cq_mask_   = 0;
+  struct io_uring_cqe* cqes_ = nullptr;
+
+  unsigned sqe_tail_ = 0;  // the entries prepared so far
+#else
+  struct SubmissionEntry {};
+
+  explicit IoUring(unsigned) {}
+  bool IsAvailable() const { return false; }
+  SubmissionEntry* GetSubmissionEntry() { return nullptr; }
+  void PrepareWrite(SubmissionEntry*, int, const void*, unsigned, uint64_t,
+                    uint64_t) {}
+  void PrepareDataSync(SubmissionEntry*, int, bool, uint64_t) {}
+  bool Submit(unsigned = 0) { return false; }
+  template <typename F>
+  size_t ForEachCompletion(F&&) {
+    return 0;
+  }
+#endif
+};
+
+}  // namespace Recovery
+}  // namespace LineairDB
+
+#endif /* LINEAIRDB_RECOVERY_IO_URING_HPP */
@@ -0,0 +1,232 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "persistent_memory_logger.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <util/logger.hpp>
+
+#if defined(__CLWB__) || defined(__CLFLUSHOPT__)
+#include <immintrin.h>
+#endif
+
+#include "binary_logger.h"
+#include "types/definitions.h"
+#include "types/snapshot.hpp"
+
+namespace LineairDB {
+namespace Recovery {
+
+namespace {
+constexpr uintptr_t CacheLineSize = 64;
+}  // namespace
+
+std::atomic<size_t>
+    PersistentMemoryLogger::ThreadLocalStorageNode::ThreadIdCounter = {0};
+
+PersistentMemoryLogger::ThreadLocalStorageNode::~ThreadLocalStorageNode() {
+  CloseSegment();
+}
+
+void PersistentMemoryLogger::ThreadLocalStorageNode::CloseSegment() {
+  if (mapping != nullptr) munmap(mapping, capacity);
+  if (0 <= fd) {
+    // NOTE: it only saves the space; the zeros of the tail end the records.
+    [[maybe_unused]] const int trimmed = ftruncate(fd, offset);
+    close(fd);
+  }
+  fd       = -1;
+  mapping  = nullptr;
+  capacity = 0;
+  offset   = 0;
+}
+
+PersistentMemoryLogger::PersistentMemoryLogger(const Config& config)
+    : WorkingDir(config.work_dir) {
+  LineairDB::Util::SetUpSPDLog();
+}
+
+void PersistentMemoryLogger::RememberMe(const EpochNumber epoch) {
+  auto* my_storage = thread_key_storage_.Get();
+  my_storage->durable_epoch.store(epoch);
+}
+
+void PersistentMemoryLogger::Enqueue(const WriteSetType& ws_ref,
+                                     EpochNumber epoch, bool entrusting) {
+  if (ws_ref.empty()) return;
+
+  const size_t size = BinaryLogger::RecordSize(ws_ref);
+  auto* my_storage  = thread_key_storage_.Get();
+  std::lock_guard<std::mutex> guard(my_storage->lock);
+  if (my_storage->mapping == nullptr ||
+      my_storage->capacity < my_storage->offset + size) {
+    my_storage->CloseSegment();
+    OpenSegment(my_storage, epoch, size);
+  }
+  char* record = my_storage->mapping + my_storage->offset;
+  BinaryLogger::WriteRecord(ws_ref, epoch, record, size);
+  Persist(my_storage, record, size);
+  my_storage->offset += size;
+  auto& segment     = my_storage->segments.back();
+  segment.max_epoch = std::max(segment.max_epoch, epoch);
+
+  // The callee thread is not in the thread pool and may not flush later;
+  // the record is already durable.
+  if (entrusting) my_storage->durable_epoch.store(epoch);
+}
+
+void PersistentMemoryLogger::FlushLogs(EpochNumber stable_epoch) {
+  // The records have been persisted by #Enqueue.
+  thread_key_storage_.Get()->durable_epoch.store(stable_epoch);
+}
+
+void PersistentMemoryLogger::OpenSegment(ThreadLocalStorageNode* my_storage,
+                                         const EpochNumber epoch,
+                                         const size_t size) {
+  assert(my_storage->mapping == nullptr);
+  const size_t capacity = std::max(SegmentSize, size);
+  auto filename         = GetLogFileName(my_storage->thread_id, epoch);
+  const int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  // NOTE: the blocks are allocated before the mapping is written, so that a
+  // write to the mapping never faults for the space of the file system.
+  const int error = fd < 0 ? errno : posix_fallocate(fd, 0, capacity);
+  if (error != 0 || fdatasync(fd) != 0) {
+    SPDLOG_ERROR("Durability Error: fail to allocate logfile {0}. errno: {1}",
+                 filename, error != 0 ? error : errno);
+    exit(1);
+  }
+
+  void* mapping = MAP_FAILED;
+#if defined(MAP_SYNC) && defined(MAP_SHARED_VALIDATE)
+  // It succeeds only on persistent memory (DAX), where the stores to the
+  // mapping are durable as soon as they leave the cache.
+  mapping = mmap(nullptr, capacity, PROT_READ | PROT_WRITE,
+                 MAP_SHARED_VALIDATE | MAP_SYNC, fd, 0);
+  my_storage->synchronous = mapping != MAP_FAILED;
+#endif
+  if (mapping == MAP_FAILED) {
+    mapping = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                   0);
+  }
+  if (mapping == MAP_FAILED) {
+    SPDLOG_ERROR("Durability Error: fail to map logfile {0}. errno: {1}",
+                 filename, errno);
+    exit(1);
+  }
+  my_storage->fd       = fd;
+  my_storage->mapping  = static_cast<char*>(mapping);
+  my_storage->capacity = capacity;
+  my_storage->offset   = 0;
+  my_storage->segments.push_back({std::move(filename), epoch});
+}
+
+void PersistentMemoryLogger::Persist(const ThreadLocalStorageNode* my_storage,
+                                     const char* p, const size_t size) {
+  const auto begin = reinterpret_cast<uintptr_t>(p);
+  const auto end   = begin + size;
+#if defined(__CLWB__) || defined(__CLFLUSHOPT__)
+  if (my_storage->synchronous) {
+    for (auto line = begin & ~(CacheLineSize - 1); line < end;
+         line += CacheLineSize) {
+#if defined(__CLWB__)
+      _mm_clwb(reinterpret_cast<void*>(line));
+#else
+      _mm_clflushopt(reinterpret_cast<void*>(line));
+#endif
+    }
+    _mm_sfence();
+    return;
+  }
+#else
+  (void)my_storage;
+#endif
+  // msync writes back the cache lines on DAX, and the pages otherwise.
+  static const uintptr_t PageSize = sysconf(_SC_PAGESIZE);
+  const auto page_begin           = begin & ~(PageSize - 1);
+  if (msync(reinterpret_cast<void*>(page_begin), end - page_begin,
+            MS_SYNC) != 0) {
+    SPDLOG_ERROR("Durability Error: fail to persist logs. errno: {0}",
+                 errno);
+    exit(1);
+  }
+}
+
+void PersistentMemoryLogger::TruncateLogs(
+    const EpochNumber checkpoint_completed_epoch) {
+  thread_key_storage_.ForEach([&](ThreadLocalStorageNode* node) {
+    std::lock_guard<std::mutex> guard(node->lock);
+    Truncate(node, checkpoint_completed_epoch);
+  });
+}
+
+void PersistentMemoryLogger::Truncate(
+    ThreadLocalStorageNode* my_storage,
+    const EpochNumber checkpoint_completed_epoch) {
+  if (checkpoint_completed_epoch <= my_storage->truncated_epoch) return;
+
+  // The records written after here go to a new segment, so that the current
+  // one is removed by a later checkpoint.
+  my_storage->CloseSegment();
+
+  std::vector<Segment> remaining;
+  for (auto& segment : my_storage->segments) {
+    if (checkpoint_completed_epoch <= segment.max_epoch) {
+      remaining.emplace_back(std::move(segment));
+      continue;
+    }
+    if (unlink(segment.filename.c_str()) != 0) {
+      SPDLOG_ERROR("Durability Error: fail to truncate logfile {0}. errno: {1}",
+                   segment.filename, errno);
+      exit(1);
+    }
+  }
+  my_storage->segments        = std::move(remaining);
+  my_storage->truncated_epoch = checkpoint_completed_epoch;
+}
+
+EpochNumber PersistentMemoryLogger::GetMinDurableEpochForAllThreads() {
+  EpochNumber min_flushed_epoch = EpochFramework::THREAD_OFFLINE;
+  thread_key_storage_.ForEach(
+      [&](const ThreadLocalStorageNode* thread_local_node) {
+        const EpochNumber epoch = thread_local_node->durable_epoch.load();
+        if (epoch == EpochFramework::THREAD_OFFLINE) return;
+        if (epoch < min_flushed_epoch) min_flushed_epoch = epoch;
+      });
+  return min_flushed_epoch;
+}
+
+std::string PersistentMemoryLogger::GetLogFileName(size_t thread_id,
+                                                   EpochNumber epoch) const {
+  const auto prefix = WorkingDir + "/thread" + std::to_string(thread_id) +
+                      "." + std::to_string(epoch);
+  // A new segment never reuses the files left by the previous processes.
+  auto filename = prefix + ".log";
+  for (size_t i = 1; access(filename.c_str(), F_OK) == 0; i++) {
+    filename = prefix + "-" + std::to_string(i) + ".log";
+  }
+  return filename;
+}
+
+}  // namespace Recovery
+}  // namespace LineairDB
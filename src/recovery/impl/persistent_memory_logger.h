@@ -0,0 +1,118 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef LINEAIRDB_RECOVERY_PERSISTENT_MEMORY_LOGGER_H
+#define LINEAIRDB_RECOVERY_PERSISTENT_MEMORY_LOGGER_H
+
+#include <lineairdb/config.h>
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "recovery/logger_base.h"
+#include "types/definitions.h"
+#include "util/epoch_framework.hpp"
+#include "util/thread_key_storage.h"
+
+namespace LineairDB {
+namespace Recovery {
+
+/**
+ * @brief
+ * A thread-local logger that makes each commit durable by itself, for the
+ * working directories on persistent memory (e.g., a file system mounted
+ * with DAX).
+ * Each thread maps a preallocated segment of SegmentSize bytes, and Enqueue
+ * serializes the write set into the mapping in the format of BinaryLogger,
+ * and then flushes the cache lines of the record (clwb or clflushopt,
+ * followed by sfence). Thus a commit costs no system call, and FlushLogs
+ * only advances the durable epoch of the thread. If the file system does
+ * not support MAP_SYNC, or the processor has no such instruction, a record
+ * is persisted with msync instead.
+ * A new segment is mapped when the current one is full or after
+ * TruncateLogs; recovery reads the segments as the log files of
+ * BinaryLogger, and the unwritten tail of a segment ends its records.
+ */
+class PersistentMemoryLogger final : public LoggerBase {
+ public:
+  static constexpr size_t SegmentSize = 64 << 20;
+
+  PersistentMemoryLogger(const Config&);
+  void RememberMe(const EpochNumber) final override;
+  void Enqueue(const WriteSetType& ws_ref_, EpochNumber epoch,
+               bool entrusting) final override;
+  void FlushLogs(EpochNumber stable_epoch) final override;
+  void TruncateLogs(
+      const EpochNumber checkpoint_completed_epoch) final override;
+  EpochNumber GetMinDurableEpochForAllThreads() final override;
+  std::string GetLogFileName(size_t thread_id, EpochNumber epoch) const;
+
+ private:
+  struct Segment {
+    std::string filename;
+    EpochNumber max_epoch;
+  };
+
+  struct ThreadLocalStorageNode {
+   private:
+    static std::atomic<size_t> ThreadIdCounter;
+
+   public:
+    size_t thread_id;
+    std::atomic<EpochNumber> durable_epoch;
+    // excludes #TruncateLogs from the writes of the owner thread.
+    std::mutex lock;
+    EpochNumber truncated_epoch;
+    std::vector<Segment> segments;
+    int fd;
+    char* mapping;  // of the last segment, or nullptr
+    size_t capacity;
+    size_t offset;
+    bool synchronous;  // mapped with MAP_SYNC; see #Persist
+
+    ThreadLocalStorageNode()
+        : thread_id(ThreadIdCounter.fetch_add(1)),
+          durable_epoch(EpochFramework::THREAD_OFFLINE),
+          truncated_epoch(0),
+          fd(-1),
+          mapping(nullptr),
+          capacity(0),
+          offset(0),
+          synchronous(false) {}
+    ~ThreadLocalStorageNode();
+    /**
+     * @brief Unmaps the segment and trims its unwritten tail.
+     */
+    void CloseSegment();
+  };
+
+  void OpenSegment(ThreadLocalStorageNode*, EpochNumber epoch, size_t size);
+  void Truncate(ThreadLocalStorageNode*, EpochNumber checkpoint_completed);
+  /**
+   * @brief Makes the `size` bytes at `p` in the mapping durable.
+   */
+  static void Persist(const ThreadLocalStorageNode*, const char* p,
+                      size_t size);
+
+  std::string WorkingDir;
+  ThreadKeyStorage<ThreadLocalStorageNode> thread_key_storage_;
+};
+
+}  // namespace Recovery
+}  // namespace LineairDB
+#endif /* LINEAIRDB_RECOVERY_PERSISTENT_MEMORY_LOGGER_H */
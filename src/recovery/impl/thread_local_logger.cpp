@@ -20,7 +20,10 @@
 #include <lineairdb/database.h>
 #include <lineairdb/tx_status.h>
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstdio>
 #include <cstring>
 #include <experimental/filesystem>
 #include <fstream>
@@ -40,7 +43,9 @@ std::atomic<size_t> ThreadLocalLogger::ThreadLocalStorageNode::ThreadIdCounter =
     {0};
 
 ThreadLocalLogger::ThreadLocalLogger(const Config& config)
-    : WorkingDir(config.work_dir) {
+    : WorkingDir(config.work_dir),
+      compressor_(config),
+      coalescing_(config.enable_log_coalescing) {
   LineairDB::Util::SetUpSPDLog();
 }
 
@@ -52,6 +57,15 @@ void ThreadLocalLogger::RememberMe(const EpochNumber epoch) {
 void ThreadLocalLogger::Enqueue(const WriteSetType& ws_ref, EpochNumber epoch,
                                 bool entrusting) {
   if (ws_ref.empty()) return;
+  auto* my_storage = thread_key_storage_.Get();
+  if (coalescing_) {
+    Coalesce(my_storage, ws_ref, epoch);
+    if (entrusting) {
+      WriteLogRecords(my_storage);
+      my_storage->durable_epoch.store(epoch);
+    }
+    return;
+  }
 
   /** Make log record and add it into local buffer  **/
   Recovery::Logger::LogRecord record;
@@ -67,7 +81,6 @@ void ThreadLocalLogger::Enqueue(const WriteSetType& ws_ref, EpochNumber epoch,
       record.key_value_pairs.emplace_back(std::move(kvp));
     }
   }
-  auto* my_storage = thread_key_storage_.Get();
   my_storage->log_records.emplace_back(std::move(record));
 
   if (entrusting) {
@@ -76,100 +89,111 @@ void ThreadLocalLogger::Enqueue(const WriteSetType& ws_ref, EpochNumber epoch,
     // The log record is not persisted when 1) this thread buffers its log
     // records and 2) will be terminated soon after here.
     // To ensure durability, we immediately flush the log records.
+    WriteLogRecords(my_storage);
+    my_storage->durable_epoch.store(epoch);
+  }
+}
 
-    if (!my_storage->log_file.is_open()) {
-      my_storage->log_file = std::fstream(
-          GetLogFileName(my_storage->thread_id),
-          std::fstream::out | std::fstream::binary | std::fstream::ate);
+void ThreadLocalLogger::Coalesce(ThreadLocalStorageNode* my_storage,
+                                 const WriteSetType& ws_ref,
+                                 const EpochNumber epoch) {
+  auto& records = my_storage->log_records;
+  if (records.empty() || records.back().epoch != epoch) {
+    // The entries of the former epochs are no longer overwritten.
+    my_storage->coalesced.clear();
+    records.emplace_back();
+    records.back().epoch = epoch;
+  }
+  auto& entries = records.back().key_value_pairs;
+  for (auto& snapshot : ws_ref) {
+    auto tid = snapshot.data_item_copy.transaction_id.load();
+    auto [it, inserted] =
+        my_storage->coalesced.try_emplace(snapshot.key, entries.size());
+    if (inserted) {
+      entries.emplace_back();
+      entries.back().key = snapshot.key;
+    } else if (tid < entries[it->second].tid) {
+      continue;  // keeps the version of the larger id, as recovery does
     }
-    msgpack::pack(my_storage->log_file, my_storage->log_records);
-    my_storage->log_file.flush();
-    my_storage->log_records.clear();
-    my_storage->durable_epoch.store(epoch);
+    // NOTE: assign() reuses the capacity of the overwritten value.
+    auto& kvp         = entries[it->second];
+    const auto& value = snapshot.data_item_copy.buffer;
+    if (value.size == 0) {
+      kvp.buffer.clear();
+    } else {
+      kvp.buffer.assign(reinterpret_cast<const char*>(value.data()),
+                        value.size);
+    }
+    kvp.tid = tid;
   }
 }
 
 void ThreadLocalLogger::FlushLogs(EpochNumber stable_epoch) {
   auto* my_storage = thread_key_storage_.Get();
+  WriteLogRecords(my_storage);
+  my_storage->durable_epoch.store(stable_epoch);
+}
 
-  if (!my_storage->log_records.empty()) {
-    if (!my_storage->log_file.is_open()) {
-      my_storage->log_file = std::fstream(
-          GetLogFileName(my_storage->thread_id),
-          std::fstream::out | std::fstream::binary | std::fstream::ate);
-    }
-    msgpack::pack(my_storage->log_file, my_storage->log_records);
-    my_storage->log_file.flush();
-    my_storage->log_records.clear();
-  }
+void ThreadLocalLogger::WriteLogRecords(ThreadLocalStorageNode* my_storage) {
+  auto& records = my_storage->log_records;
+  if (records.empty()) return;
+  std::lock_guard<std::mutex> guard(my_storage->lock);
 
-  my_storage->durable_epoch.store(stable_epoch);
+  EpochNumber min_epoch = records.front().epoch;
+  EpochNumber max_epoch = records.front().epoch;
+  for (auto& record : records) {
+    min_epoch = std::min(min_epoch, record.epoch);
+    max_epoch = std::max(max_epoch, record.epoch);
+  }
+  if (!my_storage->log_file.is_open()) {
+    auto filename = GetLogFileName(my_storage->thread_id, min_epoch);
+    my_storage->log_file = std::fstream(
+        filename, std::fstream::out | std::fstream::binary |
+                      std::fstream::app);
+    my_storage->segments.push_back({std::move(filename), max_epoch});
+  }
+  auto& segment     = my_storage->segments.back();
+  segment.max_epoch = std::max(segment.max_epoch, max_epoch);
+
+  msgpack::sbuffer sbuffer;
+  compressor_.Pack(records, sbuffer);
+  my_storage->log_file.write(sbuffer.data(), sbuffer.size());
+  my_storage->log_file.flush();
+  records.clear();
+  my_storage->coalesced.clear();
 }
 
 void ThreadLocalLogger::TruncateLogs(
     const EpochNumber checkpoint_completed_epoch) {
-  auto* my_storage = thread_key_storage_.Get();
+  thread_key_storage_.ForEach([&](ThreadLocalStorageNode* node) {
+    std::lock_guard<std::mutex> guard(node->lock);
+    Truncate(node, checkpoint_completed_epoch);
+  });
+}
 
-  assert(my_storage->truncated_epoch <= checkpoint_completed_epoch);
-  if (checkpoint_completed_epoch == my_storage->truncated_epoch) return;
-  auto log_filename = GetLogFileName(my_storage->thread_id);
-  std::ifstream old_file(log_filename,
-                         std::ifstream::in | std::ifstream::binary);
+void ThreadLocalLogger::Truncate(
+    ThreadLocalStorageNode* my_storage,
+    const EpochNumber checkpoint_completed_epoch) {
+  if (checkpoint_completed_epoch <= my_storage->truncated_epoch) return;
 
-  std::string buffer((std::istreambuf_iterator<char>(old_file)),
-                     std::istreambuf_iterator<char>());
-  if (buffer.empty()) {
-    my_storage->truncated_epoch = checkpoint_completed_epoch;
+  // The records written after here go to a new segment, so that the current
+  // one is removed by a later checkpoint.
+  if (my_storage->log_file.is_open()) my_storage->log_file.close();
 
-    return;
-  }
-  Logger::LogRecords records;
-  Logger::LogRecords deserialized_records;
-  size_t offset = 0;
-  for (;;) {
-    if (offset == buffer.size()) break;
-    try {
-      auto oh  = msgpack::unpack(buffer.data(), buffer.size(), offset);
-      auto obj = oh.get();
-      obj.convert(deserialized_records);
-
-    } catch (const std::bad_cast& e) {
-      SPDLOG_ERROR(
-          "  Stop recovery procedure: msgpack deserialize failure. Some "
-          "records may not be recovered.");
-      exit(EXIT_FAILURE);
-    } catch (...) {
-      SPDLOG_ERROR(
-          "  Stop recovery procedure: msgpack deserialize failure. Some "
-          "records may not be recovered.");
-      exit(EXIT_FAILURE);
+  std::vector<Segment> remaining;
+  for (auto& segment : my_storage->segments) {
+    if (checkpoint_completed_epoch <= segment.max_epoch) {
+      remaining.emplace_back(std::move(segment));
+      continue;
+    }
+    if (std::remove(segment.filename.c_str()) != 0) {
+      SPDLOG_ERROR("Durability Error: fail to truncate logfile {0}. errno: {1}",
+                   segment.filename, errno);
+      exit(1);
     }
-
-    deserialized_records.erase(
-        remove_if(deserialized_records.begin(), deserialized_records.end(),
-                  [&](auto record) {
-                    return record.epoch < checkpoint_completed_epoch;
-                  }),
-        deserialized_records.end());
-    records.insert(records.end(), deserialized_records.begin(),
-                   deserialized_records.end());
-  }
-
-  std::ofstream new_file(GetWorkingLogFileName(my_storage->thread_id));
-  msgpack::pack(new_file, records);
-  new_file.flush();
-
-  // NOTE POSIX ensures that rename syscall provides atomicity
-  if (rename(log_filename.c_str(),
-             GetLogFileName(my_storage->thread_id).c_str())) {
-    SPDLOG_ERROR("Durability Error: fail to truncate logfile. errno: {1}",
-                 errno);
-    exit(1);
   }
+  my_storage->segments = std::move(remaining);
   my_storage->truncated_epoch = checkpoint_completed_epoch;
-  my_storage->log_file        = std::fstream(
-             GetLogFileName(my_storage->thread_id),
-             std::fstream::out | std::fstream::binary | std::fstream::ate);
 }
 
 EpochNumber ThreadLocalLogger::GetMinDurableEpochForAllThreads() {
@@ -183,13 +207,17 @@ EpochNumber ThreadLocalLogger::GetMinDurableEpochForAllThreads() {
   return min_flushed_epoch;
 }
 
-std::string ThreadLocalLogger::GetLogFileName(size_t thread_id) const {
+std::string ThreadLocalLogger::GetLogFileName(size_t thread_id,
+                                              EpochNumber epoch) const {
   // TODO: think of beautiful path concatation in C++
-  return WorkingDir + "/thread" + std::to_string(thread_id) + ".log";
-}
-
-std::string ThreadLocalLogger::GetWorkingLogFileName(size_t thread_id) const {
-  return WorkingDir + "/thread" + std::to_string(thread_id) + ".working.log";
+  const auto prefix = WorkingDir + "/thread" + std::to_string(thread_id) +
+                      "." + std::to_string(epoch);
+  // A new segment never reuses the files left by the previous processes.
+  auto filename = prefix + ".log";
+  for (size_t i = 1; std::experimental::filesystem::exists(filename); i++) {
+    filename = prefix + "-" + std::to_string(i) + ".log";
+  }
+  return filename;
 }
 
 }  // namespace Recovery
@@ -26,7 +26,12 @@
 #include <msgpack.hpp>
 #include <queue>
 #include <sstream>
+#include <string>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
+#include "recovery/log_compression.h"
 #include "recovery/logger.h"
 #include "recovery/logger_base.h"
 #include "types/definitions.h"
@@ -46,11 +51,24 @@ class ThreadLocalLogger final : public LoggerBase {
   void TruncateLogs(
       const EpochNumber checkpoint_completed_epoch) final override;
   EpochNumber GetMinDurableEpochForAllThreads() final override;
-  std::string GetLogFileName(size_t thread_id) const;
-  std::string GetWorkingLogFileName(size_t thread_id) const;
+  std::string GetLogFileName(size_t thread_id, EpochNumber epoch) const;
 
  private:
   std::string WorkingDir;
+  const LogCompressor compressor_;
+  const bool coalescing_;  // see Config::enable_log_coalescing
+
+  /**
+   * @brief
+   * A log file of a thread, which holds the records up to max_epoch.
+   * A thread appends its records to the latest segment, and starts a new
+   * one after each checkpoint; thus truncation just removes the segments
+   * that the checkpoint has covered, without rewriting any record.
+   */
+  struct Segment {
+    std::string filename;
+    EpochNumber max_epoch;
+  };
 
   struct ThreadLocalStorageNode {
    private:
@@ -59,9 +77,15 @@ class ThreadLocalLogger final : public LoggerBase {
    public:
     size_t thread_id;
     std::atomic<EpochNumber> durable_epoch;
+    // excludes #TruncateLogs from the writes of the owner thread.
+    std::mutex lock;
     EpochNumber truncated_epoch;
     std::fstream log_file;
+    std::vector<Segment> segments;
     Logger::LogRecords log_records;
+    // With coalescing, the entries of the keys in the last record, which
+    // holds the buffered entries of its epoch.
+    std::unordered_map<std::string, size_t> coalesced;
     MSGPACK_DEFINE(log_records);
 
     ThreadLocalStorageNode()
@@ -71,6 +95,15 @@ class ThreadLocalLogger final : public LoggerBase {
     ~ThreadLocalStorageNode() {}
   };
 
+  void WriteLogRecords(ThreadLocalStorageNode*);
+  void Truncate(ThreadLocalStorageNode*, EpochNumber checkpoint_completed);
+  /**
+   * @brief Buffers `ws_ref` into the last record of `epoch`, over the
+   * entries of the same keys; see Config::enable_log_coalescing.
+   */
+  void Coalesce(ThreadLocalStorageNode*, const WriteSetType& ws_ref,
+                EpochNumber epoch);
+
  private:
   ThreadKeyStorage<ThreadLocalStorageNode> thread_key_storage_;
 };
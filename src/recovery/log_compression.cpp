@@ -0,0 +1,182 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "log_compression.h"
+
+#include <cstring>
+#include <limits>
+#include <util/logger.hpp>
+
+#ifdef LINEAIRDB_WITH_LZ4
+#include <lz4.h>
+#endif
+#ifdef LINEAIRDB_WITH_ZSTD
+#include <zstd.h>
+#endif
+#ifdef LINEAIRDB_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+namespace LineairDB {
+namespace Recovery {
+
+namespace {
+constexpr size_t HeaderSize = sizeof(uint8_t) + sizeof(uint32_t);
+
+/**
+ * @brief Compresses `size` bytes of `src` into `dst`.
+ * @return the size of the compressed data, or 0 on failure.
+ */
+size_t Compress(const Config::LogCompression codec, const int level,
+                const char* src, size_t size, std::string& dst) {
+  switch (codec) {
+#ifdef LINEAIRDB_WITH_LZ4
+    case Config::LogCompression::LZ4: {
+      dst.resize(LZ4_compressBound(size));
+      const int compressed =
+          LZ4_compress_fast(src, dst.data(), size, dst.size(), level);
+      return 0 < compressed ? compressed : 0;
+    }
+#endif
+#ifdef LINEAIRDB_WITH_ZSTD
+    case Config::LogCompression::Zstd: {
+      dst.resize(ZSTD_compressBound(size));
+      const size_t compressed =
+          ZSTD_compress(dst.data(), dst.size(), src, size, level);
+      return ZSTD_isError(compressed) ? 0 : compressed;
+    }
+#endif
+#ifdef LINEAIRDB_WITH_ZLIB
+    case Config::LogCompression::Zlib: {
+      uLongf compressed = compressBound(size);
+      dst.resize(compressed);
+      const int result =
+          compress2(reinterpret_cast<Bytef*>(dst.data()), &compressed,
+                    reinterpret_cast<const Bytef*>(src), size,
+                    level == 0 ? Z_DEFAULT_COMPRESSION : level);
+      return result == Z_OK ? compressed : 0;
+    }
+#endif
+    default:
+      return 0;
+  }
+}
+}  // namespace
+
+LogCompressor::LogCompressor(const Config& config)
+    : codec_(config.log_compression), level_(config.log_compression_level) {
+  if (!IsAvailable(codec_)) {
+    SPDLOG_WARN(
+        "LineairDB is not built with the log compression codec {0}; the logs "
+        "are not compressed.",
+        static_cast<int>(codec_));
+    codec_ = Config::LogCompression::NoCompression;
+  }
+}
+
+void LogCompressor::Pack(const Logger::LogRecords& records,
+                         msgpack::sbuffer& out) const {
+  if (codec_ == Config::LogCompression::NoCompression) {
+    msgpack::pack(out, records);
+    return;
+  }
+
+  msgpack::sbuffer raw;
+  msgpack::pack(raw, records);
+  std::string compressed;
+  size_t compressed_size = 0;
+  if (MinCompressionSize <= raw.size() &&
+      raw.size() <= std::numeric_limits<uint32_t>::max()) {
+    compressed_size =
+        Compress(codec_, level_, raw.data(), raw.size(), compressed);
+  }
+  if (compressed_size == 0 || raw.size() <= HeaderSize + compressed_size) {
+    out.write(raw.data(), raw.size());
+    return;
+  }
+
+  char header[HeaderSize];
+  header[0]               = static_cast<char>(codec_);
+  const uint32_t raw_size = raw.size();
+  std::memcpy(header + 1, &raw_size, sizeof(raw_size));
+  msgpack::packer<msgpack::sbuffer> packer(out);
+  packer.pack_ext(HeaderSize + compressed_size, ExtensionType);
+  packer.pack_ext_body(header, HeaderSize);
+  packer.pack_ext_body(compressed.data(), compressed_size);
+}
+
+bool LogCompressor::Decompress(const char* payload, size_t size,
+                               std::string& out) {
+  if (size < HeaderSize) return false;
+  const auto codec = static_cast<Config::LogCompression>(payload[0]);
+  uint32_t raw_size;
+  std::memcpy(&raw_size, payload + 1, sizeof(raw_size));
+  const char* src       = payload + HeaderSize;
+  const size_t src_size = size - HeaderSize;
+  out.resize(raw_size);
+
+  switch (codec) {
+#ifdef LINEAIRDB_WITH_LZ4
+    case Config::LogCompression::LZ4:
+      return LZ4_decompress_safe(src, out.data(), src_size, raw_size) ==
+             static_cast<int>(raw_size);
+#endif
+#ifdef LINEAIRDB_WITH_ZSTD
+    case Config::LogCompression::Zstd:
+      return ZSTD_decompress(out.data(), raw_size, src, src_size) ==
+             raw_size;
+#endif
+#ifdef LINEAIRDB_WITH_ZLIB
+    case Config::LogCompression::Zlib: {
+      uLongf decompressed = raw_size;
+      const int result =
+          uncompress(reinterpret_cast<Bytef*>(out.data()), &decompressed,
+                     reinterpret_cast<const Bytef*>(src), src_size);
+      return result == Z_OK && decompressed == raw_size;
+    }
+#endif
+    default:
+      SPDLOG_ERROR(
+          "Found logs compressed with the codec {0}, which LineairDB is not "
+          "built with.",
+          static_cast<int>(codec));
+      return false;
+  }
+}
+
+bool LogCompressor::IsAvailable(const Config::LogCompression codec) {
+  switch (codec) {
+    case Config::LogCompression::NoCompression:
+      return true;
+#ifdef LINEAIRDB_WITH_LZ4
+    case Config::LogCompression::LZ4:
+      return true;
+#endif
+#ifdef LINEAIRDB_WITH_ZSTD
+    case Config::LogCompression::Zstd:
+      return true;
+#endif
+#ifdef LINEAIRDB_WITH_ZLIB
+    case Config::LogCompression::Zlib:
+      return true;
+#endif
+    default:
+      return false;
+  }
+}
+
+}  // namespace Recovery
+}  // namespace LineairDB
@@ -0,0 +1,74 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef LINEAIRDB_RECOVERY_LOG_COMPRESSION_H
+#define LINEAIRDB_RECOVERY_LOG_COMPRESSION_H
+
+#include <lineairdb/config.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <msgpack.hpp>
+#include <string>
+
+#include "recovery/logger.h"
+
+namespace LineairDB {
+namespace Recovery {
+
+/**
+ * @brief
+ * Serializes batches of log records with the codec of
+ * Config::log_compression. A compressed batch is written as a msgpack
+ * extension object of ExtensionType, whose payload is
+ *
+ *   codec (1 byte) | size of the serialized records (4 bytes) | compressed
+ *
+ * so that compressed and raw batches can be mixed in one file, and the
+ * files written without compression are read as before; see
+ * Logger::ForEachLogRecords.
+ */
+class LogCompressor {
+ public:
+  static constexpr int8_t ExtensionType = 1;
+  // Smaller batches are not worth compressing.
+  static constexpr size_t MinCompressionSize = 256;
+
+  LogCompressor(const Config&);
+
+  /**
+   * @brief Serializes `records` and appends them to `out`. The records are
+   * left uncompressed if the compression does not make them smaller.
+   */
+  void Pack(const Logger::LogRecords& records, msgpack::sbuffer& out) const;
+
+  /**
+   * @brief Decompresses the payload of an extension object of ExtensionType
+   * into `out`.
+   * @return false if the payload is broken or LineairDB is not built with
+   * its codec.
+   */
+  static bool Decompress(const char* payload, size_t size, std::string& out);
+
+  static bool IsAvailable(const Config::LogCompression codec);
+
+ private:
+  Config::LogCompression codec_;
+  int level_;
+};
+
+}  // namespace Recovery
+}  // namespace LineairDB
+#endif /* LINEAIRDB_RECOVERY_LOG_COMPRESSION_H */
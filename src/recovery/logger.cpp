@@ -16,11 +16,15 @@
 
 #include "logger.h"
 
+#include <fcntl.h>
 #include <glob.h>
 #include <lineairdb/config.h>
 #include <lineairdb/database.h>
 #include <lineairdb/tx_status.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <experimental/filesystem>
 #include <fstream>
@@ -28,28 +32,63 @@
 #include <iostream>
 #include <memory>
 #include <msgpack.hpp>
+#include <string_view>
 #include <util/logger.hpp>
 
+#include "checkpoint_image.h"
+#include "checkpoint_writer.h"
+#include "impl/binary_logger.h"
+#include "impl/group_commit_logger.h"
+#include "impl/persistent_memory_logger.h"
 #include "impl/thread_local_logger.h"
+#include "log_compression.h"
 #include "types/definitions.h"
+#include "util/instrumentation.hpp"
 
 namespace LineairDB {
 namespace Recovery {
 
+static inline std::vector<std::string> glob(const std::string& pat) {
+  using namespace std;
+  glob_t glob_result;
+  ::glob(pat.c_str(), GLOB_TILDE, NULL, &glob_result);
+  vector<string> ret;
+  for (unsigned int i = 0; i < glob_result.gl_pathc; ++i) {
+    ret.push_back(string(glob_result.gl_pathv[i]));
+  }
+  globfree(&glob_result);
+  return ret;
+}
+
 Logger::Logger(const Config& config)
     : DurableEpochNumberFileName(config.work_dir + "/durable_epoch.json"),
       DurableEpochNumberWorkingFileName(config.work_dir +
                                         "/durable_epoch.working.json"),
       WorkingDir(config.work_dir),
+      entrusted_bytes_(0),
       durable_epoch_(0),
       durable_epoch_working_file_(DurableEpochNumberWorkingFileName,
-                                  std::ofstream::trunc) {
+                                  std::ofstream::trunc),
+      sync_durable_epoch_(
+          config.logger == Config::Logger::GroupCommitLogger ||
+          config.logger == Config::Logger::PersistentMemoryLogger) {
   std::experimental::filesystem::create_directory(config.work_dir);
   LineairDB::Util::SetUpSPDLog();
+  previous_log_files_     = glob(WorkingDir + "/thread*");
+  has_previous_log_files_ = !previous_log_files_.empty();
   switch (config.logger) {
     case Config::Logger::ThreadLocalLogger:
       logger_ = std::make_unique<ThreadLocalLogger>(config);
       break;
+    case Config::Logger::GroupCommitLogger:
+      logger_ = std::make_unique<GroupCommitLogger>(config);
+      break;
+    case Config::Logger::BinaryLogger:
+      logger_ = std::make_unique<BinaryLogger>(config);
+      break;
+    case Config::Logger::PersistentMemoryLogger:
+      logger_ = std::make_unique<PersistentMemoryLogger>(config);
+      break;
     default:
       logger_ = std::make_unique<ThreadLocalLogger>(config);
       break;
@@ -60,29 +99,106 @@ Logger::~Logger() = default;
 void Logger::RememberMe(const EpochNumber epoch) { logger_->RememberMe(epoch); }
 void Logger::Enqueue(const WriteSetType& ws_ref, EpochNumber epoch,
                      bool entrusting) {
-  logger_->Enqueue(ws_ref, epoch, entrusting);
+  Instrumentation::ScopedTimer timer(Statistics::LogEnqueue);
+  if (ws_ref.empty()) return;
+  size_t bytes = 0;
+  for (auto& snapshot : ws_ref) {
+    bytes += snapshot.key.size() + snapshot.data_item_copy.buffer.size;
+  }
+  if (entrusting) {
+    // NOTE: the callee thread is in `epoch` until it returns; the workers
+    // flush `epoch` after it, and thus they always find this record.
+    entrusted_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+    entrusted_records_.enqueue({epoch, ws_ref});
+    return;
+  }
+  logger_->Enqueue(ws_ref, epoch, false);
+  auto& pending = pending_bytes_.Get();
+  pending.store(pending.load(std::memory_order_relaxed) + bytes,
+                std::memory_order_relaxed);
 }
 void Logger::FlushLogs(const EpochNumber stable_epoch) {
+  Instrumentation::ScopedTimer timer(Statistics::LogFlush);
+  // The workers take the entrusted records in batches, and each of them
+  // writes the ones it has taken with its own records by a single write.
+  constexpr size_t BatchSize = 64;
+  EntrustedRecord batch[BatchSize];
+  size_t taken;
+  while ((taken = entrusted_records_.try_dequeue_bulk(batch, BatchSize)) !=
+         0) {
+    size_t bytes = 0;
+    for (size_t i = 0; i < taken; i++) {
+      for (auto& snapshot : batch[i].write_set) {
+        bytes += snapshot.key.size() + snapshot.data_item_copy.buffer.size;
+      }
+      logger_->Enqueue(batch[i].write_set, batch[i].epoch, false);
+      batch[i].write_set.clear();
+    }
+    entrusted_bytes_.fetch_sub(bytes, std::memory_order_relaxed);
+  }
   logger_->FlushLogs(stable_epoch);
+  pending_bytes_.Get().store(0, std::memory_order_relaxed);
+}
+
+size_t Logger::GetPendingLogBytes() {
+  size_t bytes = entrusted_bytes_.load(std::memory_order_relaxed);
+  pending_bytes_.ForEach([&](const std::atomic<size_t>& pending) {
+    bytes += pending.load(std::memory_order_relaxed);
+  });
+  return bytes;
 }
 
 void Logger::TruncateLogs(const EpochNumber checkpoint_completed_epoch) {
   logger_->TruncateLogs(checkpoint_completed_epoch);
+
+  // A checkpoint of this process covers all the records that the previous
+  // processes have left.
+  if (checkpoint_completed_epoch != 0 && has_previous_log_files_.load()) {
+    std::lock_guard<std::mutex> lock(previous_log_files_lock_);
+    for (auto& filename : previous_log_files_) std::remove(filename.c_str());
+    previous_log_files_.clear();
+    has_previous_log_files_.store(false);
+  }
 }
 
 EpochNumber Logger::FlushDurableEpoch() {
-  auto min_flushed_epoch = logger_->GetMinDurableEpochForAllThreads();
+  Instrumentation::ScopedTimer timer(Statistics::LogSync);
+  return PersistDurableEpoch(logger_->GetMinDurableEpochForAllThreads());
+}
+
+EpochNumber Logger::SyncDurableEpoch() {
+  Instrumentation::ScopedTimer timer(Statistics::LogSync);
+  return PersistDurableEpoch(logger_->SyncLogsForAllThreads());
+}
+
+EpochNumber Logger::PersistDurableEpoch(const EpochNumber min_flushed_epoch) {
+  // NOTE: the callers of #SyncDurableEpoch may race; an older epoch is
+  // ignored.
+  std::lock_guard<std::mutex> lock(durable_epoch_lock_);
   if (min_flushed_epoch == EpochFramework::THREAD_OFFLINE ||
-      min_flushed_epoch == durable_epoch_) {
+      min_flushed_epoch <= durable_epoch_) {
     return durable_epoch_;
   }
 
-  assert(durable_epoch_ < min_flushed_epoch);
   if (!durable_epoch_working_file_.is_open())
     durable_epoch_working_file_.open(DurableEpochNumberWorkingFileName);
 
   durable_epoch_ = min_flushed_epoch;
   durable_epoch_working_file_ << durable_epoch_;
+  if (sync_durable_epoch_) {
+    // The logs up to durable_epoch_ have reached the storage device; so
+    // should the number itself before the callbacks are executed.
+    durable_epoch_working_file_.flush();
+    const int fd = open(DurableEpochNumberWorkingFileName.c_str(), O_WRONLY);
+    if (fd < 0 || fdatasync(fd) != 0) {
+      SPDLOG_ERROR(
+          "Durability Error: fail to flush the durable epoch number {0:d}. "
+          "errno: {1}",
+          durable_epoch_, errno);
+      exit(1);
+    }
+    close(fd);
+  }
 
   // NOTE POSIX ensures that rename syscall provides atomicity
   if (rename(DurableEpochNumberWorkingFileName.c_str(),
@@ -93,6 +209,17 @@ EpochNumber Logger::FlushDurableEpoch() {
         durable_epoch_, errno);
     exit(1);
   }
+  if (sync_durable_epoch_) {
+    const int fd = open(WorkingDir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd < 0 || fsync(fd) != 0) {
+      SPDLOG_ERROR(
+          "Durability Error: fail to flush the durable epoch number {0:d}. "
+          "errno: {1}",
+          durable_epoch_, errno);
+      exit(1);
+    }
+    close(fd);
+  }
   durable_epoch_working_file_.close();
   durable_epoch_working_file_.open(DurableEpochNumberWorkingFileName,
                                    std::fstream::trunc);
@@ -119,102 +246,185 @@ EpochNumber Logger::GetDurableEpochFromLog() {
   return epoch;
 }
 
-static inline std::vector<std::string> glob(const std::string& pat) {
-  using namespace std;
-  glob_t glob_result;
-  ::glob(pat.c_str(), GLOB_TILDE, NULL, &glob_result);
-  vector<string> ret;
-  for (unsigned int i = 0; i < glob_result.gl_pathc; ++i) {
-    ret.push_back(string(glob_result.gl_pathv[i]));
+namespace {
+/**
+ * @brief Replays a log file into `sets`, which are partitioned by the hash
+ * value of keys, by keeping the version of the largest transaction id for
+ * each key.
+ */
+void ReplayLogFile(const std::string& filename, const bool is_checkpoint,
+                   const EpochNumber durable_epoch,
+                   std::vector<Logger::RecoverySet>& sets) {
+  std::ifstream file(filename, std::ifstream::in | std::ifstream::binary);
+  if (!file.good()) {
+    SPDLOG_ERROR(
+        "  Stop recovery procedure: file {0} is broken. Some records may not "
+        "be recovered.",
+        filename);
+    exit(EXIT_FAILURE);
+  };
+
+  std::string buffer((std::istreambuf_iterator<char>(file)),
+                     std::istreambuf_iterator<char>());
+  if (buffer.empty()) return;
+  SPDLOG_DEBUG(" Start recovery from {0}", filename);
+
+  auto replay = [&](EpochNumber epoch, const std::string_view key,
+                    const std::string_view value, TransactionId tid) {
+    assert(0 < epoch);
+    if (!is_checkpoint && durable_epoch < epoch) return;
+    auto& set = sets[std::hash<std::string_view>()(key) % sets.size()];
+    auto [it, inserted] = set.try_emplace(std::string(key));
+    if (inserted || it->second.tid < tid) {
+      it->second.value.assign(value);
+      it->second.tid = tid;
+    }
+  };
+
+  if (BinaryLogger::IsBinaryLog(buffer)) {
+    const bool succeed = BinaryLogger::ForEachEntry(
+        buffer, [&](const BinaryLogger::Entry& entry) {
+          replay(entry.epoch, entry.key, entry.value, entry.tid);
+        });
+    // A torn record can be left only at the tail of a log file.
+    if (!succeed) {
+      SPDLOG_ERROR(
+          "  Found a broken record on file {0}; the records after it are "
+          "ignored.",
+          filename);
+    }
+    return;
   }
-  globfree(&glob_result);
-  return ret;
+
+  const bool succeed =
+      Logger::ForEachLogRecords(buffer, [&](Logger::LogRecords& log_records) {
+        for (auto& log_record : log_records) {
+          for (auto& kvp : log_record.key_value_pairs) {
+            replay(log_record.epoch, kvp.key, kvp.buffer, kvp.tid);
+          }
+        }
+      });
+  if (!succeed) {
+    SPDLOG_ERROR(
+        "  Stop recovery procedure: msgpack deserialize failure on file "
+        "{0}. Some records may not be recovered.",
+        filename);
+  }
+  SPDLOG_DEBUG(" Close filename {0}", filename);
 }
+}  // namespace
 
-WriteSetType Logger::GetRecoverySetFromLogs(const EpochNumber durable_epoch) {
+std::unique_ptr<CheckpointImage> Logger::OpenCheckpointImage(
+    const std::string_view table_name) {
+  auto image = std::make_unique<CheckpointImage>(
+      CheckpointImage::FileName(WorkingDir, table_name));
+  if (!image->IsOpen()) return nullptr;
+  return image;
+}
+
+std::vector<Logger::RecoverySet> Logger::GetRecoverySetFromLogs(
+    const EpochNumber durable_epoch, ThreadPool& thread_pool) {
   SPDLOG_DEBUG("Replay the logs in epoch 0-{0}", durable_epoch);
   SPDLOG_DEBUG("Check WorkingDirectory {0}", WorkingDir);
 
   auto logfiles                         = glob(WorkingDir + "/thread*");
-  const std::string checkpoint_filename = WorkingDir + "/checkpoint.log";
-  bool checkpoint_file_exists           = false;
+  const std::string checkpoint_filename =
+      CheckpointImage::FileName(WorkingDir, {});
+  bool checkpoint_file_exists = false;
   {
     std::ifstream ifs(checkpoint_filename);
     checkpoint_file_exists = ifs.is_open();
   }
-  if (checkpoint_file_exists) logfiles.push_back(checkpoint_filename);
-  WriteSetType recovery_set;
-  recovery_set.clear();
+  // The delta files of incremental checkpoints are replayed as checkpoints.
+  const size_t number_of_logfiles = logfiles.size();
+  if (checkpoint_file_exists &&
+      !CheckpointImage::IsCheckpointImage(checkpoint_filename)) {
+    logfiles.push_back(checkpoint_filename);
+  }
+  for (auto& filename : glob(WorkingDir + "/checkpoint.delta.*")) {
+    logfiles.emplace_back(std::move(filename));
+  }
 
-  for (auto filename : logfiles) {
-    std::ifstream file(filename, std::ifstream::in | std::ifstream::binary);
-    if (!file.good()) {
-      SPDLOG_ERROR(
-          "  Stop recovery procedure: file {0} is broken. Some records may not "
-          "be recovered.",
-          filename);
-      exit(EXIT_FAILURE);
-    };
-
-    std::string buffer((std::istreambuf_iterator<char>(file)),
-                       std::istreambuf_iterator<char>());
-    if (buffer.empty()) continue;
-    SPDLOG_DEBUG(" Start recovery from {0}", filename);
-
-    LogRecords log_records;
-    size_t offset = 0;
-    for (;;) {
-      if (offset == buffer.size()) break;
-      try {
-        auto oh  = msgpack::unpack(buffer.data(), buffer.size(), offset);
-        auto obj = oh.get();
-        obj.convert(log_records);
-      } catch (const std::bad_cast& e) {
-        SPDLOG_ERROR(
-            "  Stop recovery procedure: msgpack deserialize failure on file "
-            "{0}. Some records may not be recovered.");
-        SPDLOG_DEBUG("Error code: {0}", e.what());
-        return recovery_set;
-      } catch (...) {
-        SPDLOG_ERROR(
-            "  Stop recovery procedure: msgpack deserialize failure on file "
-            "{0}. Some records may not be recovered.");
-        return recovery_set;
-      }
+  // Each worker streams the log files one by one into its own sets.
+  const size_t workers = std::max<size_t>(1, thread_pool.GetPoolSize());
+  std::vector<std::vector<RecoverySet>> local_sets(
+      workers, std::vector<RecoverySet>(workers));
+  std::atomic<size_t> next_worker(0);
+  std::atomic<size_t> next_file(0);
+  thread_pool.EnqueueForAllThreads([&]() {
+    auto& my_sets = local_sets[next_worker.fetch_add(1)];
+    for (size_t i; (i = next_file.fetch_add(1)) < logfiles.size();) {
+      ReplayLogFile(logfiles[i], number_of_logfiles <= i, durable_epoch,
+                    my_sets);
+    }
+  });
+  thread_pool.WaitForQueuesToBecomeEmpty();
 
-      for (auto& log_record : log_records) {
-        assert(0 < log_record.epoch);
-        if (filename == checkpoint_filename ||
-            log_record.epoch <= durable_epoch) {
-          for (auto& kvp : log_record.key_value_pairs) {
-            bool not_found = true;
-            for (auto& item : recovery_set) {
-              if (item.key == kvp.key) {
-                not_found = false;
-                if (item.data_item_copy.transaction_id.load() < kvp.tid) {
-                  item.data_item_copy.buffer.Reset(kvp.buffer);
-                  item.data_item_copy.transaction_id = kvp.tid;
-                  SPDLOG_DEBUG("    update-> key {0}, version {1} in epoch {2}",
-                               kvp.key, kvp.tid.tid, kvp.tid.epoch);
-                }
-              }
-            }
-            if (not_found) {
-              SPDLOG_DEBUG("    insert-> key {0}, version {1} in epoch {2}",
-                           kvp.key, kvp.tid.tid, kvp.tid.epoch);
-              Snapshot snapshot = {
-                  kvp.key, reinterpret_cast<std::byte*>(kvp.buffer.data()),
-                  kvp.buffer.size(), nullptr, kvp.tid};
-              recovery_set.emplace_back(std::move(snapshot));
-            }
+  // Then the workers merge the sets of the same partition.
+  std::vector<RecoverySet> recovery_sets(workers);
+  std::atomic<size_t> next_partition(0);
+  thread_pool.EnqueueForAllThreads([&]() {
+    for (size_t p; (p = next_partition.fetch_add(1)) < workers;) {
+      auto& merged = recovery_sets[p];
+      for (auto& sets : local_sets) {
+        auto& set = sets[p];
+        if (merged.empty()) {
+          merged.swap(set);
+          continue;
+        }
+        for (auto& [key, version] : set) {
+          auto [it, inserted] = merged.try_emplace(key);
+          if (inserted || it->second.tid < version.tid) {
+            it->second = std::move(version);
           }
         }
+        RecoverySet().swap(set);
       }
     }
+  });
+  thread_pool.WaitForQueuesToBecomeEmpty();
+  return recovery_sets;
+}
 
-    SPDLOG_DEBUG(" Close filename {0}", filename);
+bool Logger::ForEachLogRecords(const std::string& buffer,
+                               const std::function<void(LogRecords&)>& f) {
+  LogRecords log_records;
+  size_t offset = 0;
+  while (offset < buffer.size()) {
+    try {
+      auto oh  = msgpack::unpack(buffer.data(), buffer.size(), offset);
+      auto obj = oh.get();
+      if (obj.type == msgpack::type::NIL) continue;
+      if (obj.type == msgpack::type::EXT &&
+          obj.via.ext.type() == LogCompressor::ExtensionType) {
+        std::string decompressed;
+        if (!LogCompressor::Decompress(obj.via.ext.data(), obj.via.ext.size,
+                                       decompressed) ||
+            !ForEachLogRecords(decompressed, f)) {
+          return false;
+        }
+        continue;
+      }
+      if (obj.type == msgpack::type::EXT &&
+          obj.via.ext.type() == CheckpointWriter::ChecksumExtensionType) {
+        std::string_view records;
+        if (!CheckpointWriter::Verify(obj.via.ext.data(), obj.via.ext.size,
+                                      records) ||
+            !ForEachLogRecords(std::string(records), f)) {
+          return false;
+        }
+        continue;
+      }
+      obj.convert(log_records);
+    } catch (const std::bad_cast& e) {
+      SPDLOG_DEBUG("Error code: {0}", e.what());
+      return false;
+    } catch (...) {
+      return false;
+    }
+    f(log_records);
   }
-  return recovery_set;
+  return true;
 }
 
 }  // namespace Recovery
@@ -18,17 +18,30 @@
 
 #include <lineairdb/config.h>
 
+#include <atomic>
 #include <fstream>
+#include <functional>
 #include <memory>
 #include <msgpack.hpp>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
+#include "concurrentqueue.h"  // moodycamel::concurrentqueue
 #include "logger_base.h"
+#include "thread_pool/thread_pool.h"
 #include "types/data_buffer.hpp"
 #include "types/definitions.h"
+#include "types/transaction_id.hpp"
+#include "util/thread_slots.hpp"
 
 namespace LineairDB {
 namespace Recovery {
 
+class CheckpointImage;
+
 class Logger {
  public:
   constexpr static EpochNumber NumberIsNotUpdated = 0;
@@ -41,16 +54,63 @@ class Logger {
 
   // Methods that pass (delegate) to LoggerBase
   void RememberMe(const EpochNumber);
+  /**
+   * @brief Buffers the log record of `ws_ref_` in the callee thread, which
+   * writes it at #FlushLogs.
+   * @param entrusting true if the callee thread is not a worker of the thread
+   * pool, e.g., the one of Database::EndTransaction. Such a thread never
+   * calls #FlushLogs and may exit at any time; thus the record is handed to
+   * the workers through a queue shared by all threads, and the workers write
+   * the records of the queue together with theirs at #FlushLogs. The threads
+   * of the entrusted records have neither log files nor durable epochs.
+   */
   void Enqueue(const WriteSetType& ws_ref_, EpochNumber epoch,
                bool entrusting = false);
+  /**
+   * @brief Writes the records buffered by the callee thread and the
+   * entrusted ones, of the epochs up to `stable_epoch`.
+   */
   void FlushLogs(const EpochNumber stable_epoch);
   void TruncateLogs(const EpochNumber checkpoint_completed_epoch);
+  /**
+   * @brief Returns the bytes of the keys and values that the threads have
+   * enqueued and not flushed yet.
+   */
+  size_t GetPendingLogBytes();
 
   EpochNumber FlushDurableEpoch();
+  /**
+   * @brief Flushes the durable epoch as #FlushDurableEpoch does, after
+   * waiting for the logs flushed so far to reach the storage device.
+   */
+  EpochNumber SyncDurableEpoch();
   EpochNumber GetDurableEpoch();
   void SetDurableEpoch(const EpochNumber);
   EpochNumber GetDurableEpochFromLog();
-  WriteSetType GetRecoverySetFromLogs(const EpochNumber durable_epoch);
+
+  struct RecoveredVersion {
+    std::string value;
+    TransactionId tid;
+  };
+  using RecoverySet = std::unordered_map<std::string, RecoveredVersion>;
+  /**
+   * @brief Maps the full checkpoint of the table `table_name` (see
+   * CheckpointImage::FileName) if it is written as a CheckpointImage;
+   * otherwise returns nullptr.
+   */
+  std::unique_ptr<CheckpointImage> OpenCheckpointImage(
+      const std::string_view table_name = {});
+  /**
+   * @brief Replays the checkpoint and the logs up to `durable_epoch` on the
+   * workers of `thread_pool`. Each worker reads the log files one by one and
+   * keeps the latest version of each key in hash maps partitioned by the
+   * hash value of keys; then the workers merge the maps of each partition in
+   * parallel. A checkpoint image is not replayed; see #OpenCheckpointImage.
+   * @return the latest versions, in the partitions that have no key in
+   * common.
+   */
+  std::vector<RecoverySet> GetRecoverySetFromLogs(
+      const EpochNumber durable_epoch, ThreadPool& thread_pool);
 
   struct LogRecord {
     struct KeyValuePair {
@@ -68,10 +128,36 @@ class Logger {
   };
   typedef std::vector<LogRecord> LogRecords;
 
+  /**
+   * @brief Decodes the log records serialized in `buffer`, and calls `f`
+   * for each group of them. Nil objects, which pad the logs written with
+   * Config::enable_direct_log_io, are skipped, the groups compressed by
+   * LogCompressor are decompressed, and the checksums of the chunks of the
+   * checkpoints (see CheckpointWriter::Checksummed) are verified.
+   * @return false if `buffer` is broken.
+   */
+  static bool ForEachLogRecords(const std::string& buffer,
+                                const std::function<void(LogRecords&)>& f);
+
  private:
+  EpochNumber PersistDurableEpoch(const EpochNumber min_flushed_epoch);
+
   std::unique_ptr<LoggerBase> logger_;
+  // Each thread counts the bytes that it has buffered; see #Enqueue.
+  ThreadSlots<std::atomic<size_t>> pending_bytes_;
+  struct EntrustedRecord {
+    EpochNumber epoch;
+    WriteSetType write_set;
+  };
+  moodycamel::ConcurrentQueue<EntrustedRecord> entrusted_records_;
+  std::atomic<size_t> entrusted_bytes_;
+  std::mutex durable_epoch_lock_;
   EpochNumber durable_epoch_;
   std::ofstream durable_epoch_working_file_;
+  const bool sync_durable_epoch_;
+  std::vector<std::string> previous_log_files_;
+  std::atomic<bool> has_previous_log_files_;
+  std::mutex previous_log_files_lock_;
   std::string work_dir_;
 };
 
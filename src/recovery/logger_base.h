@@ -31,8 +31,21 @@ class LoggerBase {
   virtual void Enqueue(const WriteSetType& ws_ref_, EpochNumber epoch,
                        bool entrusting)                 = 0;
   virtual void FlushLogs(EpochNumber stable_epoch)      = 0;
+  /**
+   * @brief Removes the log files of all threads that the checkpoint of the
+   * given epoch has covered. It may run on any thread, concurrently with the
+   * threads writing their logs.
+   */
   virtual void TruncateLogs(const EpochNumber)          = 0;
   virtual EpochNumber GetMinDurableEpochForAllThreads() = 0;
+  /**
+   * @brief Waits for the logs flushed so far to reach the storage device,
+   * and returns the minimum durable epoch of all threads. The loggers that
+   * do not wait for the device regard the flushed logs as durable.
+   */
+  virtual EpochNumber SyncLogsForAllThreads() {
+    return GetMinDurableEpochForAllThreads();
+  }
 };
 
 }  // namespace Recovery
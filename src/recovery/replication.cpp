@@ -0,0 +1,181 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "replication.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <msgpack.hpp>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "index/table.h"
+#include "types/data_item.hpp"
+#include "types/transaction_id.hpp"
+#include "util/event_count.hpp"
+#include "util/logger.hpp"
+
+namespace LineairDB {
+namespace Recovery {
+
+void LogShipper::Start(Database::LogShipperType shipper) {
+  std::lock_guard<std::mutex> guard(ship_lock_);
+  shipper_ = std::move(shipper);
+  enabled_.store(true);
+}
+
+void LogShipper::Enqueue(const WriteSetType& ws_ref, EpochNumber epoch) {
+  if (ws_ref.empty()) return;
+  Logger::LogRecord record;
+  record.epoch = epoch;
+  for (auto& snapshot : ws_ref) {
+    Logger::LogRecord::KeyValuePair kvp;
+    kvp.key    = snapshot.key;
+    kvp.buffer = snapshot.data_item_copy.buffer.toString();
+    kvp.tid    = snapshot.data_item_copy.transaction_id.load();
+    record.key_value_pairs.emplace_back(std::move(kvp));
+  }
+  auto& buffer = buffers_.Get();
+  std::lock_guard<std::mutex> guard(buffer.lock);
+  buffer.log_records.emplace_back(std::move(record));
+}
+
+void LogShipper::Ship(EpochNumber stable_epoch) {
+  std::lock_guard<std::mutex> guard(ship_lock_);
+  if (stable_epoch <= shipped_epoch_) return;
+
+  ReplicationBatch batch;
+  batch.stable_epoch = stable_epoch;
+  buffers_.ForEach([&](Buffer& buffer) {
+    std::lock_guard<std::mutex> buffer_guard(buffer.lock);
+    auto& records = buffer.log_records;
+    auto end      = std::find_if(
+        records.begin(), records.end(),
+        [&](const auto& record) { return stable_epoch <= record.epoch; });
+    std::move(records.begin(), end, std::back_inserter(batch.log_records));
+    records.erase(records.begin(), end);
+  });
+  // NOTE: the versions of a key are ordered by their transaction ids on the
+  // replicas; the order of the records is only for readability.
+  std::stable_sort(
+      batch.log_records.begin(), batch.log_records.end(),
+      [](auto& lhs, auto& rhs) { return lhs.epoch < rhs.epoch; });
+
+  msgpack::sbuffer buffer;
+  msgpack::pack(buffer, batch);
+  shipper_(std::string(buffer.data(), buffer.size()));
+  shipped_epoch_ = stable_epoch;
+}
+
+bool LogApplier::Apply(const std::string& serialized) {
+  ReplicationBatch batch;
+  try {
+    auto oh = msgpack::unpack(serialized.data(), serialized.size());
+    oh.get().convert(batch);
+  } catch (...) {
+    SPDLOG_ERROR("A replication batch is broken; it is not applied.");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> guard(apply_lock_);
+  if (batch.stable_epoch <= stable_epoch_) return true;  // already applied
+
+  // The readers in the local epochs after the one recorded with an applied
+  // epoch read the snapshots at or after it; the older versions are
+  // unreachable.
+  const auto oldest_active = epoch_framework_.GetOldestActiveEpoch();
+  while (1 < history_.size() && history_[1].local_epoch < oldest_active) {
+    history_.pop_front();
+  }
+  const EpochNumber horizon =
+      !history_.empty() && history_.front().local_epoch < oldest_active
+          ? history_.front().applied_epoch
+          : 0;
+
+  // Each worker installs the versions of the keys in its partition.
+  std::vector<const Logger::LogRecord::KeyValuePair*> kvps;
+  for (auto& record : batch.log_records) {
+    for (auto& kvp : record.key_value_pairs) kvps.push_back(&kvp);
+  }
+  if (!kvps.empty()) {
+    const size_t workers = std::max<size_t>(1, thread_pool_.GetPoolSize());
+    std::atomic<size_t> next_partition(0);
+    std::atomic<size_t> running(workers);
+    EventCount finished;
+    for (;;) {
+      const bool enqueued = thread_pool_.EnqueueForAllThreads([&]() {
+        epoch_framework_.MakeMeOnline();
+        for (size_t p; (p = next_partition.fetch_add(1)) < workers;) {
+          for (auto* kvp : kvps) {
+            if (std::hash<std::string_view>()(kvp->key) % workers != p) {
+              continue;
+            }
+            Install(*kvp, horizon);
+          }
+        }
+        epoch_framework_.MakeMeOffline();
+        if (running.fetch_sub(1) == 1) finished.Notify();
+      });
+      if (enqueued) break;
+    }
+    while (running.load() != 0) {
+      const auto key = finished.PrepareWait();
+      if (running.load() == 0) {
+        finished.CancelWait();
+        break;
+      }
+      finished.Wait(key, std::chrono::milliseconds(1));
+    }
+  }
+
+  stable_epoch_ = batch.stable_epoch;
+  applied_epoch_.store(stable_epoch_ - 1);
+  // NOTE: the local epoch is read after the applied epoch is updated, and
+  // thus the readers in the later local epochs see the update.
+  history_.push_back(
+      {epoch_framework_.GetGlobalEpoch(), applied_epoch_.load()});
+  return true;
+}
+
+void LogApplier::Install(const Logger::LogRecord::KeyValuePair& kvp,
+                         const EpochNumber horizon) {
+  const auto [table_name, key] = Index::Table::DecodeKey(kvp.key);
+  // the tables which this replica has not created are skipped.
+  auto* index = table_name.empty() ? &index_ : tables_(table_name);
+  if (index == nullptr) return;
+  auto* item = index->GetOrInsert(key);
+  item->ExclusiveLock();
+  auto current = item->transaction_id.load();
+  current.tid &= ~1llu;
+  TransactionId tid = kvp.tid;
+  if (current < tid) {
+    // the readers of the absent key fail their validation.
+    if (!item->IsInitialized()) index->IncreaseAbsence(key);
+    item->KeepVersionForSnapshots(tid.epoch, horizon);
+    // keeps the lock bit, which ExclusiveUnlock releases.
+    tid.tid |= 1llu;
+    item->Reset(reinterpret_cast<const std::byte*>(kvp.buffer.data()),
+                kvp.buffer.size(), tid);
+  }
+  item->ExclusiveUnlock();
+}
+
+}  // namespace Recovery
+}  // namespace LineairDB
@@ -0,0 +1,150 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef LINEAIRDB_RECOVERY_REPLICATION_H
+#define LINEAIRDB_RECOVERY_REPLICATION_H
+
+#include <lineairdb/database.h>
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <msgpack.hpp>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "index/concurrent_table.h"
+#include "logger.h"
+#include "thread_pool/thread_pool.h"
+#include "types/definitions.h"
+#include "util/epoch_framework.hpp"
+#include "util/thread_slots.hpp"
+
+namespace LineairDB {
+namespace Recovery {
+
+/**
+ * @brief
+ * The unit of log shipping: the write sets of the transactions committed in
+ * the epochs before `stable_epoch` and after the previous batch.
+ */
+struct ReplicationBatch {
+  EpochNumber stable_epoch;
+  Logger::LogRecords log_records;
+  MSGPACK_DEFINE(stable_epoch, log_records);
+
+  ReplicationBatch() : stable_epoch(0) {}
+};
+
+/**
+ * @brief
+ * Ships the write sets of a primary to its replicas, epoch by epoch. Each
+ * thread buffers the write sets that it commits, and #Ship takes the ones in
+ * the stable (i.e., durable) epochs from all the threads.
+ */
+class LogShipper {
+ public:
+  LogShipper() : enabled_(false), shipped_epoch_(0) {}
+
+  void Start(Database::LogShipperType shipper);
+  bool IsEnabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  /**
+   * @pre The callee thread is in `epoch` and thus #Ship for a later epoch
+   * has not begun.
+   */
+  void Enqueue(const WriteSetType& ws_ref, EpochNumber epoch);
+  /**
+   * @brief
+   * Ships the write sets committed before `stable_epoch` as a
+   * ReplicationBatch. A batch is shipped even if it is empty, so that the
+   * replicas advance their snapshots. An epoch older than the shipped one is
+   * ignored.
+   */
+  void Ship(EpochNumber stable_epoch);
+
+ private:
+  struct Buffer {
+    std::mutex lock;
+    Logger::LogRecords log_records;  // in the order of epochs
+  };
+
+  std::atomic<bool> enabled_;
+  ThreadSlots<Buffer> buffers_;
+  std::mutex ship_lock_;
+  EpochNumber shipped_epoch_;
+  Database::LogShipperType shipper_;
+};
+
+/**
+ * @brief
+ * Applies the batches of LogShipper to a replica. The versions are installed
+ * with the transaction ids of the primary, in parallel by key; the past ones
+ * are kept as in Config::enable_snapshot_read, so that the readers of the
+ * snapshot at #GetAppliedEpoch do not see a batch that is being applied.
+ * The versions of a named table go to the index given by the TableResolver;
+ * the tables which the replica has not created are not replicated.
+ */
+class LogApplier {
+ public:
+  // Returns the index of the named table, or nullptr if it does not exist.
+  using TableResolver =
+      std::function<Index::ConcurrentTable*(const std::string_view)>;
+
+  LogApplier(Index::ConcurrentTable& index, TableResolver tables,
+             EpochFramework& epoch_framework, ThreadPool& thread_pool)
+      : index_(index),
+        tables_(std::move(tables)),
+        epoch_framework_(epoch_framework),
+        thread_pool_(thread_pool),
+        applied_epoch_(0),
+        stable_epoch_(0) {}
+
+  /**
+   * @return false if `batch` is broken.
+   * @pre The batches are applied one by one, in the order of shipping.
+   */
+  bool Apply(const std::string& batch);
+  /**
+   * @brief Returns the last epoch of the primary that has been applied.
+   */
+  EpochNumber GetAppliedEpoch() const { return applied_epoch_.load(); }
+
+ private:
+  void Install(const Logger::LogRecord::KeyValuePair& kvp,
+               EpochNumber horizon);
+
+  Index::ConcurrentTable& index_;
+  const TableResolver tables_;
+  EpochFramework& epoch_framework_;
+  ThreadPool& thread_pool_;
+  std::atomic<EpochNumber> applied_epoch_;
+  EpochNumber stable_epoch_;
+  std::mutex apply_lock_;
+  // The applied epochs and the local epochs after them. The readers which
+  // begin in a later local epoch read a snapshot at the applied epoch or
+  // later; see #Apply.
+  struct AppliedAt {
+    EpochNumber local_epoch;
+    EpochNumber applied_epoch;
+  };
+  std::deque<AppliedAt> history_;
+};
+
+}  // namespace Recovery
+}  // namespace LineairDB
+#endif /* LINEAIRDB_RECOVERY_REPLICATION_H */
@@ -0,0 +1,190 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <lineairdb/config.h>
+#include <lineairdb/database.h>
+#include <lineairdb/sharded_database.h>
+#include <lineairdb/transaction.h>
+#include <lineairdb/tx_status.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "database_impl.h"
+#include "util/logger.hpp"
+
+namespace LineairDB {
+
+class ShardedDatabase::Impl {
+ public:
+  Impl(const std::vector<Config>& configs, Partitioner partitioner)
+      : partitioner_(partitioner ? std::move(partitioner)
+                                 : HashPartitioner(configs.size())) {
+    if (configs.empty()) {
+      SPDLOG_ERROR("A ShardedDatabase requires at least one shard.");
+      exit(1);
+    }
+    shards_.reserve(configs.size());
+    for (auto& config : configs) {
+      shards_.emplace_back(std::make_unique<Database>(config));
+    }
+  }
+
+  size_t GetNumberOfShards() const { return shards_.size(); }
+  size_t GetShardOf(std::string_view key) const {
+    const size_t shard = partitioner_(key);
+    assert(shard < shards_.size());
+    return shard;
+  }
+  Database& GetShard(size_t shard) { return *shards_[shard]; }
+
+  Transaction& BeginTransaction(size_t shard) {
+    return shards_[shard]->db_pimpl_->BeginCoordinatedTransaction();
+  }
+
+  bool Commit(std::vector<Transaction*>& transactions, bool commit,
+              Database::CallbackType& commit_clbk) {
+    // NOTE: the shards are locked in order, and so are the items in each
+    // shard; hence the coordinated transactions do not deadlock.
+    for (size_t shard = 0; commit && shard < shards_.size(); shard++) {
+      if (transactions[shard] == nullptr) continue;
+      commit = shards_[shard]->db_pimpl_->LockForCommit(*transactions[shard]);
+    }
+    // The reads are validated while all the writes are locked, as if the
+    // shards were a single database.
+    for (size_t shard = 0; commit && shard < shards_.size(); shard++) {
+      if (transactions[shard] == nullptr) continue;
+      commit =
+          shards_[shard]->db_pimpl_->ValidateForCommit(*transactions[shard]);
+    }
+
+    const size_t participants = static_cast<size_t>(std::count_if(
+        transactions.begin(), transactions.end(),
+        [](Transaction* tx) { return tx != nullptr; }));
+    // The callback is shared by the participants, and is invoked by the last
+    // one which becomes durable.
+    auto waiting  = std::make_shared<std::atomic<size_t>>(participants);
+    auto callback = std::make_shared<Database::CallbackType>(commit_clbk);
+    for (size_t shard = 0; shard < shards_.size(); shard++) {
+      if (transactions[shard] == nullptr) continue;
+      shards_[shard]->db_pimpl_->EndCoordinated(
+          *transactions[shard], commit, [waiting, callback](TxStatus status) {
+            if (waiting->fetch_sub(1) == 1) (*callback)(status);
+          });
+    }
+    if (!commit) {
+      commit_clbk(TxStatus::Aborted);
+    } else if (participants == 0) {
+      commit_clbk(TxStatus::Committed);
+    }
+    return commit;
+  }
+
+  void Fence() const {
+    for (auto& shard : shards_) shard->Fence();
+  }
+
+ private:
+  const Partitioner partitioner_;
+  std::vector<std::unique_ptr<Database>> shards_;
+};
+
+ShardedDatabase::ShardedDatabase(const std::vector<Config>& configs,
+                                 Partitioner partitioner)
+    : pimpl_(std::make_unique<Impl>(configs, std::move(partitioner))) {}
+ShardedDatabase::~ShardedDatabase() = default;
+
+ShardedDatabase::Partitioner ShardedDatabase::HashPartitioner(
+    const size_t shards) {
+  return [shards](std::string_view key) {
+    return std::hash<std::string_view>()(key) % shards;
+  };
+}
+
+ShardedDatabase::Partitioner ShardedDatabase::RangePartitioner(
+    std::vector<std::string> boundaries) {
+  assert(std::is_sorted(boundaries.begin(), boundaries.end()));
+  return [boundaries = std::move(boundaries)](std::string_view key) {
+    return static_cast<size_t>(
+        std::upper_bound(boundaries.begin(), boundaries.end(), key) -
+        boundaries.begin());
+  };
+}
+
+size_t ShardedDatabase::GetNumberOfShards() const {
+  return pimpl_->GetNumberOfShards();
+}
+size_t ShardedDatabase::GetShardOf(std::string_view key) const {
+  return pimpl_->GetShardOf(key);
+}
+Database& ShardedDatabase::GetShard(size_t shard) {
+  return pimpl_->GetShard(shard);
+}
+
+void ShardedDatabase::ExecuteTransaction(std::string_view key,
+                                         Database::ProcedureType proc,
+                                         Database::CallbackType commit_clbk) {
+  GetShard(GetShardOf(key)).ExecuteTransaction(proc, commit_clbk);
+}
+
+bool ShardedDatabase::ExecuteCrossShardTransaction(
+    ProcedureType proc, Database::CallbackType commit_clbk) {
+  ShardedTransaction tx(*pimpl_);
+  proc(tx);
+  return pimpl_->Commit(tx.transactions_, !tx.IsAborted(), commit_clbk);
+}
+
+void ShardedDatabase::Fence() const noexcept { pimpl_->Fence(); }
+
+ShardedTransaction::ShardedTransaction(ShardedDatabase::Impl& db)
+    : db_(db), transactions_(db.GetNumberOfShards(), nullptr),
+      aborted_(false) {}
+
+Transaction& ShardedTransaction::On(std::string_view key) {
+  return OnShard(db_.GetShardOf(key));
+}
+
+Transaction& ShardedTransaction::OnShard(size_t shard) {
+  if (transactions_[shard] == nullptr) {
+    transactions_[shard] = &db_.BeginTransaction(shard);
+    if (aborted_) transactions_[shard]->Abort();
+  }
+  return *transactions_[shard];
+}
+
+bool ShardedTransaction::IsAborted() {
+  if (aborted_) return true;
+  for (auto* tx : transactions_) {
+    if (tx != nullptr && tx->IsAborted()) return true;
+  }
+  return false;
+}
+
+void ShardedTransaction::Abort() {
+  aborted_ = true;
+  for (auto* tx : transactions_) {
+    if (tx != nullptr) tx->Abort();
+  }
+}
+
+}  // namespace LineairDB
@@ -20,6 +20,7 @@
 
 #ifndef __APPLE__
 #include <numa.h>
+#include <sched.h>
 #include <unistd.h>
 
 #if __GLIBC__ == 2 && __GLIBC_MINOR__ < 30
@@ -29,65 +30,238 @@
 
 #endif
 
+#include <algorithm>
 #include <atomic>
 #include <functional>
-#include <mutex>
+#include <memory>
 #include <queue>
 #include <random>
 #include <thread>
+#include <utility>
 #include <vector>
 
 namespace LineairDB {
-ThreadPool::ThreadPool(size_t pool_size)
+
+namespace {
+thread_local std::mt19937 random_engine(0xDEADBEEF);
+}  // namespace
+
+ThreadPool::ThreadPool(size_t pool_size, bool numa_aware,
+                       size_t spin_duration_us)
     : stop_(false),
       shutdown_(false),
+      numa_aware_(numa_aware),
       work_queues_(pool_size),
-      no_steal_queues_(pool_size) {
+      no_steal_queues_(pool_size),
+      ready_workers_(0),
+      spin_duration_(spin_duration_us) {
   assert(work_queues_.size() == pool_size);
   for (size_t i = 0; i < pool_size; i++) {
-#ifndef __APPLE__
+    parkers_.emplace_back(std::make_unique<EventCount>());
+  }
+  PlaceWorkers(pool_size);
+  for (size_t i = 0; i < pool_size; i++) {
     worker_threads_.emplace_back([&, i]() {
+#ifndef __APPLE__
       const auto pid = gettid();
-      auto* mask     = numa_bitmask_alloc(std::thread::hardware_concurrency());
-      const auto cpu_bit = i % mask->size;
+      auto* mask     = numa_allocate_cpumask();
       numa_bitmask_clearall(mask);
-      numa_bitmask_setbit(mask, cpu_bit);
+      numa_bitmask_setbit(mask, cpu_of_worker_[i]);
 
       numa_sched_setaffinity(pid, mask);
       numa_free_cpumask(mask);
-#else
-    worker_threads_.emplace_back([&]() {
+      if (numa_aware_ && numa_available() != -1) numa_set_localalloc();
 #endif
+      // Allocated after the pinning, so that the queues are on the node of
+      // this worker.
+      work_queues_[i]     = std::make_unique<WorkQueue>();
+      no_steal_queues_[i] = std::make_unique<WorkQueue>();
+      ready_workers_.fetch_add(1);
+      while (ready_workers_.load() < work_queues_.size()) {
+        std::this_thread::yield();
+      }
+
+      // Spins for spin_duration_ after the last job, and then parks.
+      auto last_job = std::chrono::steady_clock::now();
       for (;;) {
-        Dequeue();
+        if (Dequeue(i)) {
+          last_job = std::chrono::steady_clock::now();
+        } else if (spin_duration_ <= std::chrono::steady_clock::now() -
+                                         last_job) {
+          Park(i);
+          last_job = std::chrono::steady_clock::now();
+        }
         if (stop_ && IsEmpty() && shutdown_) { break; }
       }
     });
   }
+  while (ready_workers_.load() < pool_size) std::this_thread::yield();
 }
 
 ThreadPool::~ThreadPool() {
   stop_     = true;
   shutdown_ = true;
+  for (size_t i = 0; i < parkers_.size(); i++) Unpark(i);
   for (auto& thread : worker_threads_) { thread.join(); }
 }
 
+void ThreadPool::PlaceWorkers(size_t pool_size) {
+  // The CPUs that this process may run on, and their nodes.
+  std::vector<std::pair<int, int>> cpus;
+#ifndef __APPLE__
+  auto* allowed = numa_allocate_cpumask();
+  if (numa_sched_getaffinity(getpid(), allowed) < 0) {
+    numa_bitmask_setall(allowed);
+  }
+  const bool has_numa = numa_available() != -1;
+  for (int cpu = 0; cpu < numa_num_configured_cpus(); cpu++) {
+    if (!numa_bitmask_isbitset(allowed, cpu)) continue;
+    const int node = has_numa && numa_aware_ ? numa_node_of_cpu(cpu) : 0;
+    cpus.emplace_back(cpu, std::max(0, node));
+  }
+  numa_free_cpumask(allowed);
+#endif
+  if (cpus.empty()) {
+    const int n = std::max(1u, std::thread::hardware_concurrency());
+    for (int cpu = 0; cpu < n; cpu++) cpus.emplace_back(cpu, 0);
+  }
+  // Fill the nodes one by one, so that a small pool spans few nodes.
+  std::stable_sort(cpus.begin(), cpus.end(), [](auto& a, auto& b) {
+    return a.second < b.second;
+  });
+
+  std::vector<int> index_of_node;
+  std::vector<size_t> node_of_worker(pool_size);
+  cpu_of_worker_.resize(pool_size);
+  for (size_t i = 0; i < pool_size; i++) {
+    const auto [cpu, node] = cpus[i % cpus.size()];
+    if (index_of_node.size() <= static_cast<size_t>(node)) {
+      index_of_node.resize(node + 1, -1);
+    }
+    if (index_of_node[node] < 0) {
+      index_of_node[node] = workers_of_node_.size();
+      workers_of_node_.emplace_back();
+    }
+    cpu_of_worker_[i]  = cpu;
+    all_workers_.push_back(i);
+    node_of_worker[i] = index_of_node[node];
+    workers_of_node_[node_of_worker[i]].push_back(i);
+  }
+  for (auto [cpu, node] : cpus) {
+    if (node_index_of_cpu_.size() <= static_cast<size_t>(cpu)) {
+      node_index_of_cpu_.resize(cpu + 1, -1);
+    }
+    if (static_cast<size_t>(node) < index_of_node.size()) {
+      node_index_of_cpu_[cpu] = index_of_node[node];
+    }
+  }
+
+  // Each worker steals jobs from the following workers of its node, and
+  // then from the workers of the other nodes.
+  steal_order_.resize(pool_size);
+  for (size_t i = 0; i < pool_size; i++) {
+    for (size_t j = 1; j < pool_size; j++) {
+      const size_t victim = (i + j) % pool_size;
+      if (node_of_worker[victim] == node_of_worker[i]) {
+        steal_order_[i].push_back(victim);
+      }
+    }
+    for (size_t j = 1; j < pool_size; j++) {
+      const size_t victim = (i + j) % pool_size;
+      if (node_of_worker[victim] != node_of_worker[i]) {
+        steal_order_[i].push_back(victim);
+      }
+    }
+  }
+}
+
 size_t ThreadPool::GetPoolSize() const { return worker_threads_.size(); }
+size_t ThreadPool::GetNumberOfNodes() const { return workers_of_node_.size(); }
 void ThreadPool::StopAcceptingTransactions() { stop_ = true; }
 void ThreadPool::ResumeAcceptingTransactions() { stop_ = false; }
 void ThreadPool::Shutdown() { shutdown_ = true; }
 
-bool ThreadPool::Enqueue(std::function<void()>&& job) {
+bool ThreadPool::Enqueue(Job&& job) {
   if (stop_) return false;
-  thread_local static std::mt19937 random(0xDEADBEEF);
-  auto& queue = work_queues_[random() % work_queues_.size()];
-  return queue.enqueue(job);
+  const auto& workers = GetWorkersToEnqueue();
+  const size_t worker = workers[random_engine() % workers.size()];
+  if (!work_queues_[worker]->enqueue(std::move(job))) return false;
+  Unpark(worker);
+  return true;
+}
+
+bool ThreadPool::EnqueueToPartition(Job&& job, size_t partition) {
+  if (stop_) return false;
+  const size_t worker = GetWorkerOfPartition(partition);
+  if (!work_queues_[worker]->enqueue(std::move(job))) return false;
+  Unpark(worker);
+  return true;
+}
+
+bool ThreadPool::EnqueueBulk(
+    std::vector<Job>& jobs,
+    const std::vector<std::optional<size_t>>& partitions) {
+  if (stop_) return false;
+  auto has_partition = [&](size_t i) {
+    return i < partitions.size() && partitions[i].has_value();
+  };
+  size_t undirected = 0;
+  for (size_t i = 0; i < jobs.size(); i++) {
+    if (!has_partition(i)) undirected++;
+  }
+
+  // The undirected jobs are divided into contiguous chunks, so that each
+  // worker receives a single bulk.
+  const auto& workers     = GetWorkersToEnqueue();
+  const size_t chunk_size = std::max<size_t>(
+      1, (undirected + workers.size() - 1) / workers.size());
+  const size_t first = random_engine() % workers.size();
+  std::vector<std::vector<Job>> jobs_of_worker(work_queues_.size());
+  for (size_t i = 0, k = 0; i < jobs.size(); i++) {
+    const size_t worker =
+        has_partition(i)
+            ? GetWorkerOfPartition(partitions[i].value())
+            : workers[(first + k++ / chunk_size) % workers.size()];
+    jobs_of_worker[worker].emplace_back(std::move(jobs[i]));
+  }
+  jobs.clear();
+
+  for (size_t worker = 0; worker < jobs_of_worker.size(); worker++) {
+    auto& bulk = jobs_of_worker[worker];
+    if (bulk.empty()) continue;
+    auto& queue = *work_queues_[worker];
+    moodycamel::ProducerToken token(queue);
+    while (!queue.enqueue_bulk(token, std::make_move_iterator(bulk.begin()),
+                               bulk.size())) {};
+    Unpark(worker);
+  }
+  return true;
+}
+
+const std::vector<size_t>& ThreadPool::GetWorkersToEnqueue() {
+#ifndef __APPLE__
+  if (numa_aware_) {
+    const int cpu = sched_getcpu();
+    if (0 <= cpu && static_cast<size_t>(cpu) < node_index_of_cpu_.size() &&
+        0 <= node_index_of_cpu_[cpu]) {
+      return workers_of_node_[node_index_of_cpu_[cpu]];
+    }
+  }
+#endif
+  return all_workers_;
+}
+
+size_t ThreadPool::GetWorkerOfPartition(size_t partition) const {
+  const size_t nodes  = workers_of_node_.size();
+  const auto& workers = workers_of_node_[partition % nodes];
+  return workers[(partition / nodes) % workers.size()];
 }
 
 bool ThreadPool::EnqueueForAllThreads(std::function<void()>&& job) {
   if (stop_) return false;
-  for (auto& queue : no_steal_queues_) {
-    while (!queue.enqueue(job)) {};
+  for (size_t i = 0; i < no_steal_queues_.size(); i++) {
+    while (!no_steal_queues_[i]->enqueue(Job(job))) {};
+    Unpark(i);
   }
   return true;
 }
@@ -98,64 +272,83 @@ bool ThreadPool::EnqueueForAllThreads(std::function<void()>&& job) {
 // Thus, you cannot use this method to wait until all queues become empty.
 bool ThreadPool::IsEmpty() {
   for (auto& queue : work_queues_) {
-    if (queue.size_approx() != 0) { return false; }
+    if (queue->size_approx() != 0) { return false; }
   }
   for (auto& queue : no_steal_queues_) {
-    if (queue.size_approx() != 0) { return false; }
+    if (queue->size_approx() != 0) { return false; }
   }
   return true;
 }
 
 void ThreadPool::WaitForQueuesToBecomeEmpty() {
   std::atomic<size_t> ends(0);
-  for (auto& queue : no_steal_queues_) {
+  for (size_t i = 0; i < no_steal_queues_.size(); i++) {
     for (;;) {
-      bool success = queue.enqueue([&]() { ends.fetch_add(1); });
+      bool success =
+          no_steal_queues_[i]->enqueue([&]() { ends.fetch_add(1); });
       if (success) break;
     }
+    Unpark(i);
   }
   while (ends.load() < worker_threads_.size()) std::this_thread::yield();
 }
 
-void ThreadPool::Dequeue() {
-  size_t idx              = GetIdxByThreadId();
-  auto* my_queue          = &work_queues_[idx];
-  auto* my_no_steal_queue = &no_steal_queues_[idx];
+bool ThreadPool::Dequeue(size_t idx) {
+  auto* my_queue          = work_queues_[idx].get();
+  auto* my_no_steal_queue = no_steal_queues_[idx].get();
   auto* selected_queue    = my_queue;
 
   if (my_queue->size_approx() == 0 && my_no_steal_queue->size_approx() != 0) {
     selected_queue = my_no_steal_queue;
-  } else {
+  } else if (my_queue->size_approx() == 0) {
     // work stealing
-    while (selected_queue->size_approx() == 0) {
-      idx++;
-      if (work_queues_.size() <= idx) idx = 0;
-      selected_queue = &work_queues_[idx];
+    auto& victims = steal_order_[idx];
+    auto it       = std::find_if(victims.begin(), victims.end(), [&](auto v) {
+      return work_queues_[v]->size_approx() != 0;
+    });
 
-      // It seems that there does not exist any active transaction
-      if (my_queue == selected_queue) {
-        std::this_thread::yield();
-        return;
-      }
+    // It seems that there does not exist any active transaction
+    if (it == victims.end()) {
+      std::this_thread::yield();
+      return false;
     }
+    selected_queue = work_queues_[*it].get();
   }
-  std::function<void()> f;
+  Job f;
   bool dequeued = selected_queue->try_dequeue(f);
   if (dequeued) {
     assert(f);
+    // Only the owner of a queue is woken up by #Enqueue; the next worker is
+    // woken up to steal the remaining jobs, and it wakes up the following
+    // one in turn.
+    if (selected_queue != my_no_steal_queue &&
+        selected_queue->size_approx() != 0 && !steal_order_[idx].empty()) {
+      Unpark(steal_order_[idx].front());
+    }
     f();
   }
+  return dequeued;
 }
 
-size_t ThreadPool::GetIdxByThreadId() {
-  thread_local size_t idx = ~0llu;
-  if (idx == ~0llu) {
-    std::lock_guard<std::mutex> lock(thread_ids_lock_);
-    idx = thread_ids_.size();
-    thread_ids_.push_back(std::this_thread::get_id());
-    assert(thread_ids_.size() <= no_steal_queues_.size());
+bool ThreadPool::HasJobsFor(size_t idx) {
+  if (work_queues_[idx]->size_approx() != 0) return true;
+  if (no_steal_queues_[idx]->size_approx() != 0) return true;
+  for (auto victim : steal_order_[idx]) {
+    if (work_queues_[victim]->size_approx() != 0) return true;
   }
-  return idx;
+  return false;
 }
 
+void ThreadPool::Park(size_t idx) {
+  auto& parker   = *parkers_[idx];
+  const auto key = parker.PrepareWait();
+  if (HasJobsFor(idx) || (stop_ && shutdown_)) {
+    parker.CancelWait();
+    return;
+  }
+  parker.Wait(key, MaxParkingTime);
+}
+
+void ThreadPool::Unpark(size_t idx) { parkers_[idx]->Notify(); }
+
 }  // namespace LineairDB
@@ -17,24 +17,58 @@
 #ifndef LINEAIRDB_THREADPOOL_H
 #define LINEAIRDB_THREADPOOL_H
 
+#include <atomic>
+#include <chrono>
 #include <functional>
-#include <mutex>
+#include <memory>
+#include <optional>
 #include <thread>
 #include <vector>
 
 #include "concurrentqueue.h"  // moodycamel::concurrentqueue
+#include "util/event_count.hpp"
+#include "util/inline_function.hpp"
 
 namespace LineairDB {
 
 /**
  * @brief
  * MPMC (Multiple producer / multiple consumer) thread pool.
+ * The workers are pinned to the CPUs that the process is allowed to run on.
+ * If `numa_aware`, they are placed node by node, each worker allocates its
+ * queues on its own node, jobs are enqueued into the workers on the node of
+ * the callee thread, and idle workers steal jobs from the same node first.
+ * A worker that has found no job for `spin_duration_us` sleeps until a job is
+ * enqueued into its queues.
  */
 class ThreadPool {
  public:
-  ThreadPool(size_t pool_size = std::thread::hardware_concurrency());
+  // Jobs of up to this size, e.g., a transaction with its callbacks, are
+  // enqueued without allocation.
+  static constexpr size_t JobCapacity = 128;
+  using Job                           = InlineFunction<JobCapacity>;
+
+  ThreadPool(size_t pool_size = std::thread::hardware_concurrency(),
+             bool numa_aware = false, size_t spin_duration_us = 100);
   ~ThreadPool();
-  bool Enqueue(std::function<void()>&&);
+  bool Enqueue(Job&&);
+  /**
+   * @brief
+   * Enqueues a job into the worker that owns `partition`, so that the jobs
+   * of a partition are processed by the same worker. With NUMA awareness,
+   * the partitions are assigned to the nodes in a round-robin manner, and
+   * then to the workers of the node.
+   */
+  bool EnqueueToPartition(Job&&, size_t partition);
+  /**
+   * @brief
+   * Enqueues `jobs` with a bulk enqueue per worker; the i-th job is
+   * enqueued as #EnqueueToPartition if `partitions[i]` has a value, and
+   * the others are divided among the workers that #Enqueue chooses from.
+   * @return false if the pool does not accept jobs, without consuming them.
+   */
+  bool EnqueueBulk(std::vector<Job>& jobs,
+                   const std::vector<std::optional<size_t>>& partitions = {});
   bool EnqueueForAllThreads(std::function<void()>&&);
   void StopAcceptingTransactions();
   void ResumeAcceptingTransactions();
@@ -42,20 +76,39 @@ class ThreadPool {
   void WaitForQueuesToBecomeEmpty();
   bool IsEmpty();
   size_t GetPoolSize() const;
+  size_t GetNumberOfNodes() const;
 
  private:
-  size_t GetIdxByThreadId();
-  void Dequeue();
+  using WorkQueue = moodycamel::ConcurrentQueue<Job>;
+  void PlaceWorkers(size_t pool_size);
+  const std::vector<size_t>& GetWorkersToEnqueue();
+  size_t GetWorkerOfPartition(size_t partition) const;
+  bool Dequeue(size_t idx);
+  bool HasJobsFor(size_t idx);
+  void Park(size_t idx);
+  void Unpark(size_t idx);
+
+  // A parked worker wakes up at least at this interval, e.g., to steal jobs.
+  static constexpr std::chrono::microseconds MaxParkingTime{10000};
 
  private:
   bool stop_;
   bool shutdown_;
-  std::vector<moodycamel::ConcurrentQueue<std::function<void()>>> work_queues_;
-  std::vector<moodycamel::ConcurrentQueue<std::function<void()>>>
-      no_steal_queues_;
+  const bool numa_aware_;
+  std::vector<std::unique_ptr<WorkQueue>> work_queues_;
+  std::vector<std::unique_ptr<WorkQueue>> no_steal_queues_;
+  // The CPU of each worker, and the workers of each node that has workers.
+  std::vector<int> cpu_of_worker_;
+  std::vector<size_t> all_workers_;
+  std::vector<std::vector<size_t>> workers_of_node_;
+  // Maps a CPU to the index of its node in #workers_of_node_, or -1.
+  std::vector<int> node_index_of_cpu_;
+  // The queues that each worker steals jobs from, in order.
+  std::vector<std::vector<size_t>> steal_order_;
+  std::atomic<size_t> ready_workers_;
+  const std::chrono::microseconds spin_duration_;
+  std::vector<std::unique_ptr<EventCount>> parkers_;
   std::vector<std::thread> worker_threads_;
-  std::vector<std::thread::id> thread_ids_;
-  std::mutex thread_ids_lock_;
 };
 }  // namespace LineairDB
 #endif
@@ -21,49 +21,63 @@
 #include <lineairdb/transaction.h>
 
 #include <algorithm>
+#include <array>
+#include <cassert>
+#include <iterator>
 #include <memory>
 #include <type_traits>
 #include <utility>
+#include <variant>
 
 #include "concurrency_control/concurrency_control_base.h"
-#include "concurrency_control/impl/silo_nwr.hpp"
-#include "concurrency_control/impl/two_phase_locking.hpp"
 #include "database_impl.h"
+#include "index/secondary_index.h"
+#include "index/table.h"
 #include "types/snapshot.hpp"
+#include "util/instrumentation.hpp"
+#include "util/logger.hpp"
 
 namespace LineairDB {
 
 Transaction::Impl::Impl(Database::Impl* db_pimpl) noexcept
     : current_status_(TxStatus::Running),
+      type_(TxType::ReadWrite),
+      snapshot_epoch_(0),
+      pending_merges_(0),
+      table_(nullptr),
+      coordinated_(false),
       db_pimpl_(db_pimpl),
-      config_ref_(db_pimpl_->GetConfig()) {
-  TransactionReferences&& tx = {read_set_, write_set_,
-                                db_pimpl_->epoch_framework_, current_status_};
-
-  // WANTFIX for performance
-  // Here we allocate one (derived) concurrency control instance per
-  // transactions. It may be worse on performance because of heap
-  // memory allocation. Need to re-implement with composition or templates.
-  switch (config_ref_.concurrency_control_protocol) {
+      config_ref_(db_pimpl_->GetConfig()),
+      concurrency_control_(MakeConcurrencyControl(
+          config_ref_.concurrency_control_protocol,
+          {read_set_, write_set_, db_pimpl_->epoch_framework_,
+           current_status_, config_ref_, type_, coordinated_,
+           db_pimpl_->GetIndex()})) {}
+
+Transaction::Impl::ConcurrencyControlType
+Transaction::Impl::MakeConcurrencyControl(Config::ConcurrencyControl protocol,
+                                          TransactionReferences&& tx) {
+  using namespace ConcurrencyControl;
+  switch (protocol) {
     case Config::ConcurrencyControl::SiloNWR:
-      concurrency_control_ = std::make_unique<ConcurrencyControl::SiloNWR>(
-          std::forward<TransactionReferences>(tx));
-      break;
+      return ConcurrencyControlType(std::in_place_type<SiloNWR>,
+                                    std::forward<TransactionReferences>(tx));
     case Config::ConcurrencyControl::Silo:
-      concurrency_control_ = std::make_unique<ConcurrencyControl::Silo>(
-          std::forward<TransactionReferences>(tx));
-      break;
+      return ConcurrencyControlType(std::in_place_type<Silo>,
+                                    std::forward<TransactionReferences>(tx));
     case Config::ConcurrencyControl::TwoPhaseLocking:
-      concurrency_control_ =
-          std::make_unique<ConcurrencyControl::TwoPhaseLocking>(
-              std::forward<TransactionReferences>(tx));
-      break;
-
-    default:
-      concurrency_control_ = std::make_unique<ConcurrencyControl::SiloNWR>(
+      return ConcurrencyControlType(std::in_place_type<TwoPhaseLocking>,
+                                    std::forward<TransactionReferences>(tx));
+    case Config::ConcurrencyControl::TwoPhaseLockingWaitDie:
+      return ConcurrencyControlType(std::in_place_type<TwoPhaseLockingWaitDie>,
+                                    std::forward<TransactionReferences>(tx));
+    case Config::ConcurrencyControl::TwoPhaseLockingWoundWait:
+      return ConcurrencyControlType(
+          std::in_place_type<TwoPhaseLockingWoundWait>,
           std::forward<TransactionReferences>(tx));
-
-      break;
+    default:
+      return ConcurrencyControlType(std::in_place_type<SiloNWR>,
+                                    std::forward<TransactionReferences>(tx));
   }
 }
 
@@ -71,28 +85,199 @@ Transaction::Impl::~Impl() noexcept = default;
 
 TxStatus Transaction::Impl::GetCurrentStatus() { return current_status_; }
 
+bool Transaction::Impl::SetTable(const std::string_view name) {
+  if (IsAborted()) return false;
+  if (name.empty()) {
+    table_ = nullptr;
+    return true;
+  }
+  auto* table = db_pimpl_->GetTable(name);
+  if (table == nullptr) return false;
+  table_ = table;
+  return true;
+}
+
+Index::ConcurrentTable& Transaction::Impl::GetCurrentIndex() {
+  return table_ != nullptr ? table_->GetIndex() : db_pimpl_->GetIndex();
+}
+
+std::string_view Transaction::Impl::EncodeKey(const std::string_view key,
+                                              std::string& buffer) {
+  const std::string_view table_name =
+      table_ != nullptr ? table_->GetName() : std::string_view();
+  return Index::Table::EncodeKey(table_name, key, buffer);
+}
+
 const std::pair<const std::byte* const, const size_t> Transaction::Impl::Read(
-    const std::string_view key) {
+    const std::string_view key, DataItem* index_leaf) {
   if (IsAborted()) return {nullptr, 0};
 
-  for (auto& snapshot : write_set_) {
-    if (snapshot.key == key) {
-      return std::make_pair(snapshot.data_item_copy.value(),
-                            snapshot.data_item_copy.size());
+  std::string buffer;
+  const auto set_key = EncodeKey(key, buffer);
+  auto* own          = FindOwnSnapshot(set_key);
+  if (own != nullptr) {
+    if (own->merge_operator.has_value()) {
+      ResolveMerge(*own);
+      if (IsAborted()) return {nullptr, 0};
+    }
+    return {own->data_item_copy.value(), own->data_item_copy.size()};
+  }
+
+  if (type_ == TxType::WriteOnly) {
+    SPDLOG_DEBUG("A write-only transaction has tried to read {0}.", key);
+    Instrumentation::CountAbort(Statistics::InvalidOperation);
+    Abort();
+    return {nullptr, 0};
+  }
+
+  if (index_leaf == nullptr) {
+    const auto lookup_begin = Instrumentation::Now();
+    auto& index             = GetCurrentIndex();
+    TransactionId absence_tid;
+    if (type_ == TxType::SnapshotReadOnly) {
+      index_leaf = index.Get(key);
+    } else if (ValidatesReads()) {
+      index_leaf = index.GetOrAbsence(key, absence_tid);
+    } else {
+      index_leaf = index.GetOrInsert(key);
+    }
+    Instrumentation::Record(Statistics::IndexLookup, lookup_begin);
+    if (index.IsAbsence(index_leaf)) {
+      return ReadAbsence(set_key, index_leaf, absence_tid);
+    }
+  }
+  return ReadDataItem(set_key, index_leaf);
+}
+
+const std::vector<std::pair<const std::byte*, size_t>>
+Transaction::Impl::MultiRead(const std::vector<std::string_view>& keys) {
+  std::vector<std::pair<const std::byte*, size_t>> results(
+      keys.size(), {nullptr, 0});
+  if (IsAborted()) return results;
+  // the keys in the read/write sets; see #EncodeKey.
+  std::vector<std::string> buffers(keys.size());
+  std::vector<std::string_view> set_keys;
+  set_keys.reserve(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) {
+    set_keys.push_back(EncodeKey(keys[i], buffers[i]));
+  }
+  // NOTE: it reads before the results below point into the read set.
+  if (pending_merges_ != 0) {
+    for (auto& key : set_keys) {
+      auto* own = FindOwnSnapshot(key);
+      if (own == nullptr || !own->merge_operator.has_value()) continue;
+      ResolveMerge(*own);
+      if (IsAborted()) return results;
     }
   }
 
-  for (auto& snapshot : read_set_) {
-    if (snapshot.key == key) {
-      return std::make_pair(snapshot.data_item_copy.value(),
-                            snapshot.data_item_copy.size());
+  // NOTE: the results point into the read set, which must not reallocate;
+  // the short values are stored in the snapshots themselves.
+  read_set_.reserve(read_set_.size() + keys.size());
+  std::vector<std::string_view> missed_keys;
+  std::vector<size_t> missed_at;
+  for (size_t i = 0; i < keys.size(); i++) {
+    const auto* own = FindOwnSnapshot(set_keys[i]);
+    if (own != nullptr) {
+      results[i] = {own->data_item_copy.value(), own->data_item_copy.size()};
+    } else {
+      missed_keys.push_back(keys[i]);
+      missed_at.push_back(i);
+    }
+  }
+  if (missed_keys.empty()) return results;
+
+  if (type_ == TxType::WriteOnly) {
+    SPDLOG_DEBUG("A write-only transaction has tried to read {0}.",
+                 missed_keys.front());
+    Instrumentation::CountAbort(Statistics::InvalidOperation);
+    Abort();
+    return results;
+  }
+
+  const auto lookup_begin = Instrumentation::Now();
+  auto& index             = GetCurrentIndex();
+  std::vector<DataItem*> index_leaves;
+  std::vector<TransactionId> absence_tids;
+  if (type_ == TxType::SnapshotReadOnly) {
+    index_leaves = index.MultiGet(missed_keys);
+  } else if (ValidatesReads()) {
+    index_leaves = index.MultiGet(missed_keys);
+    absence_tids.resize(missed_keys.size());
+    for (size_t i = 0; i < missed_keys.size(); i++) {
+      if (index_leaves[i] != nullptr) continue;
+      index_leaves[i] = index.GetOrAbsence(missed_keys[i], absence_tids[i]);
+    }
+  } else {
+    index_leaves = index.MultiGetOrInsert(missed_keys);
+  }
+  Instrumentation::Record(Statistics::IndexLookup, lookup_begin,
+                          missed_keys.size());
+  for (auto* index_leaf : index_leaves) {
+    if (index_leaf == nullptr) continue;
+    __builtin_prefetch(index_leaf, 0, 3);
+    __builtin_prefetch(reinterpret_cast<const std::byte*>(index_leaf) + 64, 0,
+                       3);
+  }
+
+  for (size_t i = 0; i < missed_keys.size(); i++) {
+    // the same key may appear twice in `keys`.
+    const auto set_key = set_keys[missed_at[i]];
+    const auto* own    = FindOwnSnapshot(set_key);
+    if (own != nullptr) {
+      results[missed_at[i]] = {own->data_item_copy.value(),
+                               own->data_item_copy.size()};
+      continue;
     }
+    const auto result =
+        index.IsAbsence(index_leaves[i])
+            ? ReadAbsence(set_key, index_leaves[i], absence_tids[i])
+            : ReadDataItem(set_key, index_leaves[i]);
+    if (IsAborted()) break;
+    results[missed_at[i]] = {result.first, result.second};
+  }
+  return results;
+}
+
+Snapshot* Transaction::Impl::FindOwnSnapshot(
+    const std::string_view key) {
+  auto position = write_set_positions_.Find(write_set_, key);
+  if (position != SnapshotPositionMap::npos) return &write_set_[position];
+  position = read_set_positions_.Find(read_set_, key);
+  if (position != SnapshotPositionMap::npos) return &read_set_[position];
+  return nullptr;
+}
+
+const std::pair<const std::byte* const, const size_t>
+Transaction::Impl::ReadDataItem(const std::string_view key,
+                                DataItem* index_leaf) {
+  if (config_ref_.cold_storage_threshold_bytes != 0 && index_leaf != nullptr) {
+    index_leaf->Touch();
   }
-  auto* index_leaf  = db_pimpl_->GetIndex().GetOrInsert(key);
+  if (type_ == TxType::SnapshotReadOnly) {
+    // no validation: a snapshot is not overwritten by the running writers.
+    if (index_leaf == nullptr) return {nullptr, 0};
+    auto& ref          = read_set_.emplace_back(key, nullptr, 0, index_leaf);
+    ref.table          = table_;
+    ref.data_item_copy = index_leaf->ReadSnapshot(
+        snapshot_epoch_, config_ref_.lock_wait_policy);
+    if (!ref.data_item_copy.IsInitialized()) return {nullptr, 0};
+    return {ref.data_item_copy.value(), ref.data_item_copy.size()};
+  }
+
   Snapshot snapshot = {key, nullptr, 0, index_leaf};
+  snapshot.table    = table_;
 
-  snapshot.data_item_copy = concurrency_control_->Read(key, index_leaf);
-  auto& ref               = read_set_.emplace_back(std::move(snapshot));
+  snapshot.data_item_copy = std::visit(
+      [&](auto& cc) { return cc.Read(key, index_leaf); }, concurrency_control_);
+  // The tombstone has been removed from the index since we looked it up; the
+  // key may have been written again into a new item.
+  if (__builtin_expect(snapshot.data_item_copy.IsRemoved(), false)) {
+    Instrumentation::CountAbort(Statistics::RemovedItem);
+    Abort();
+    return {nullptr, 0};
+  }
+  auto& ref = read_set_.emplace_back(std::move(snapshot));
   if (ref.data_item_copy.IsInitialized()) {
     return {ref.data_item_copy.value(), ref.data_item_copy.size()};
   } else {
@@ -100,94 +285,550 @@ const std::pair<const std::byte* const, const size_t> Transaction::Impl::Read(
   }
 }
 
+const std::pair<const std::byte* const, const size_t>
+Transaction::Impl::ReadAbsence(const std::string_view key, DataItem* absence,
+                               const TransactionId absence_tid) {
+  const auto result = ReadDataItem(key, absence);
+  if (IsAborted()) return result;
+  // The key may have been inserted between the lookup and the read.
+  auto tid = read_set_.back().data_item_copy.transaction_id.load();
+  if (tid != absence_tid) {
+    Instrumentation::CountAbort(Statistics::ReadValidation);
+    Abort();
+    return {nullptr, 0};
+  }
+  return result;
+}
+
+bool Transaction::Impl::ValidatesReads() {
+  return std::visit(
+      [](auto& cc) { return std::decay_t<decltype(cc)>::ValidatesReads; },
+      concurrency_control_);
+}
+
 void Transaction::Impl::Write(const std::string_view key,
-                              const std::byte value[], const size_t size) {
+                              const std::byte value[], const size_t size,
+                              DataItem* index_leaf) {
   if (IsAborted()) return;
+  if (type_ == TxType::ReadOnly || type_ == TxType::SnapshotReadOnly) {
+    SPDLOG_DEBUG("A read-only transaction has tried to write {0}.", key);
+    Instrumentation::CountAbort(Statistics::InvalidOperation);
+    return Abort();
+  }
 
   // TODO: if `size` is larger than Config.internal_buffer_size,
   // then we have to abort this transaction or throw exception
 
+  std::string buffer;
+  const auto set_key = EncodeKey(key, buffer);
+  // The entries of the secondary indexes are maintained by the value that
+  // this write overwrites; hence it becomes a read-modify-write.
+  const bool indexed =
+      table_ == nullptr && !db_pimpl_->GetSecondaryIndexes().empty();
+  if (indexed && FindOwnSnapshot(set_key) == nullptr) {
+    if (index_leaf == nullptr) {
+      const auto lookup_begin = Instrumentation::Now();
+      index_leaf              = db_pimpl_->GetIndex().GetOrInsert(key);
+      Instrumentation::Record(Statistics::IndexLookup, lookup_begin);
+    }
+    ReadDataItem(set_key, index_leaf);
+    if (IsAborted()) return;
+  }
+
   bool is_rmf = false;
-  for (auto& snapshot : read_set_) {
-    if (snapshot.key == key) {
-      is_rmf                        = true;
-      snapshot.is_read_modify_write = true;
-      break;
+  if (type_ != TxType::WriteOnly || indexed) {
+    const auto read_at = read_set_positions_.Find(read_set_, set_key);
+    if (read_at != SnapshotPositionMap::npos) {
+      is_rmf                                  = true;
+      read_set_[read_at].is_read_modify_write = true;
     }
   }
 
-  for (auto& snapshot : write_set_) {
-    if (snapshot.key != key) continue;
+  const auto written_at = write_set_positions_.Find(write_set_, set_key);
+  if (written_at != SnapshotPositionMap::npos) {
+    auto& snapshot = write_set_[written_at];
     snapshot.data_item_copy.Reset(value, size);
     if (is_rmf) snapshot.is_read_modify_write = true;
+    if (snapshot.merge_operator.has_value()) {
+      snapshot.merge_operator.reset();
+      pending_merges_--;
+    }
     return;
   }
 
-  auto* index_leaf = db_pimpl_->GetIndex().GetOrInsert(key);
+  if (index_leaf == nullptr) {
+    const auto lookup_begin = Instrumentation::Now();
+    index_leaf              = GetCurrentIndex().GetOrInsert(key);
+    Instrumentation::Record(Statistics::IndexLookup, lookup_begin);
+  }
+  if (config_ref_.cold_storage_threshold_bytes != 0) index_leaf->Touch();
 
-  concurrency_control_->Write(key, value, size, index_leaf);
-  Snapshot sp(key, value, size, index_leaf);
+  std::visit([&](auto& cc) { cc.Write(set_key, value, size, index_leaf); },
+             concurrency_control_);
+  Snapshot sp(set_key, value, size, index_leaf);
+  sp.table = table_;
   if (is_rmf) sp.is_read_modify_write = true;
   write_set_.emplace_back(std::move(sp));
 }
 
+void Transaction::Impl::Delete(const std::string_view key) {
+  Write(key, nullptr, 0);
+}
+
+void Transaction::Impl::Merge(const std::string_view key,
+                              const std::byte operand[], const size_t size,
+                              const MergeOperator op) {
+  if (IsAborted()) return;
+  if (type_ == TxType::ReadOnly || type_ == TxType::SnapshotReadOnly) {
+    SPDLOG_DEBUG("A read-only transaction has tried to merge into {0}.", key);
+    Instrumentation::CountAbort(Statistics::InvalidOperation);
+    return Abort();
+  }
+  if (!IsValidMergeOperand(op, size)) {
+    SPDLOG_DEBUG("An operand of {1} bytes is invalid to merge into {0}.", key,
+                 size);
+    Instrumentation::CountAbort(Statistics::InvalidOperation);
+    return Abort();
+  }
+
+  std::string buffer;
+  const auto set_key = EncodeKey(key, buffer);
+  DataItem result(operand, size);
+  const auto written_at = write_set_positions_.Find(write_set_, set_key);
+  if (written_at != SnapshotPositionMap::npos) {
+    auto& snapshot = write_set_[written_at];
+    if (snapshot.merge_operator == op) {
+      // combines the operands
+      ApplyMerge(op, snapshot.data_item_copy, result);
+      snapshot.data_item_copy.Reset(result.value(), result.size());
+      return;
+    }
+    if (snapshot.merge_operator.has_value()) {
+      ResolveMerge(snapshot);
+      if (IsAborted()) return;
+    }
+    ApplyMerge(op, snapshot.data_item_copy, result);
+    return Write(key, result.value(), result.size());
+  }
+
+  const bool defers_merges = std::visit(
+      [](auto& cc) { return std::decay_t<decltype(cc)>::DefersMerges; },
+      concurrency_control_);
+  const auto read_at = read_set_positions_.Find(read_set_, set_key);
+  if (!defers_merges || read_at != SnapshotPositionMap::npos) {
+    // a read-modify-write
+    if (read_at == SnapshotPositionMap::npos) {
+      const auto lookup_begin = Instrumentation::Now();
+      auto* index_leaf        = GetCurrentIndex().GetOrInsert(key);
+      Instrumentation::Record(Statistics::IndexLookup, lookup_begin);
+      ReadDataItem(set_key, index_leaf);
+      if (IsAborted()) return;
+    }
+    const auto& current = read_at == SnapshotPositionMap::npos
+                              ? read_set_.back()
+                              : read_set_[read_at];
+    ApplyMerge(op, current.data_item_copy, result);
+    return Write(key, result.value(), result.size());
+  }
+
+  const auto lookup_begin = Instrumentation::Now();
+  auto* index_leaf        = GetCurrentIndex().GetOrInsert(key);
+  Instrumentation::Record(Statistics::IndexLookup, lookup_begin);
+  std::visit([&](auto& cc) { cc.Write(set_key, operand, size, index_leaf); },
+             concurrency_control_);
+  auto& snapshot = write_set_.emplace_back(set_key, operand, size, index_leaf);
+  snapshot.table          = table_;
+  snapshot.merge_operator = op;
+  pending_merges_++;
+}
+
+void Transaction::Impl::ResolveMerge(Snapshot& snapshot) {
+  const auto op = snapshot.merge_operator.value();
+  snapshot.merge_operator.reset();
+  pending_merges_--;
+  ReadDataItem(snapshot.key, snapshot.index_cache);
+  if (IsAborted()) return;
+  auto& current                 = read_set_.back();
+  current.table                 = snapshot.table;
+  current.is_read_modify_write  = true;
+  snapshot.is_read_modify_write = true;
+  ApplyMerge(op, current.data_item_copy, snapshot.data_item_copy);
+}
+
+void Transaction::Impl::MultiWrite(
+    const std::vector<
+        std::pair<std::string_view, std::pair<const std::byte*, size_t>>>&
+        entries) {
+  if (IsAborted()) return;
+  if (type_ == TxType::ReadOnly || type_ == TxType::SnapshotReadOnly) {
+    SPDLOG_DEBUG("A read-only transaction has tried to write.");
+    Instrumentation::CountAbort(Statistics::InvalidOperation);
+    return Abort();
+  }
+
+  std::vector<std::string_view> keys;
+  keys.reserve(entries.size());
+  for (auto& entry : entries) keys.push_back(entry.first);
+  const auto lookup_begin = Instrumentation::Now();
+  const auto index_leaves = GetCurrentIndex().MultiGetOrInsert(keys);
+  Instrumentation::Record(Statistics::IndexLookup, lookup_begin, keys.size());
+  for (auto* index_leaf : index_leaves) {
+    __builtin_prefetch(index_leaf, 1, 3);
+  }
+
+  write_set_.reserve(write_set_.size() + entries.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    const auto& [value, size] = entries[i].second;
+    Write(keys[i], value, size, index_leaves[i]);
+    if (IsAborted()) return;
+  }
+}
+
 const std::optional<size_t> Transaction::Impl::Scan(
     const std::string_view begin, const std::optional<std::string_view> end,
+    const std::optional<size_t> limit,
     std::function<bool(std::string_view,
                        const std::pair<const void*, const size_t>)>
         operation) {
-  auto result =
-      db_pimpl_->GetIndex().Scan(begin, end, [&](std::string_view key) {
-        const auto read_result = Read(key);
-        if (IsAborted()) return true;
-        return operation(key, read_result);
+  if (limit == 0u) return 0;
+
+  // The rows are read in batches: the data items of a batch are prefetched
+  // while the range index gives the following keys. A batch never exceeds
+  // the rows left to the limit.
+  constexpr size_t ScanBatchSize = 16;
+  std::array<std::pair<std::string_view, DataItem*>, ScanBatchSize> batch;
+  size_t batched  = 0;
+  size_t rows     = 0;
+  bool terminated = false;
+  auto read_batch = [&]() {
+    for (size_t i = 0; i < batched && !terminated; i++) {
+      const auto [key, index_leaf] = batch[i];
+      const auto read_result       = Read(key, index_leaf);
+      // the key is absent or deleted, but the read is still validated.
+      if (!IsAborted() && read_result.first == nullptr) continue;
+      rows++;
+      terminated = IsAborted() || operation(key, read_result) ||
+                   (limit.has_value() && rows == limit.value());
+    }
+    batched = 0;
+    return terminated;
+  };
+  auto result = GetCurrentIndex().Scan(
+      begin, end, [&](std::string_view key, DataItem& index_leaf) {
+        __builtin_prefetch(&index_leaf, 0, 3);
+        __builtin_prefetch(reinterpret_cast<const std::byte*>(&index_leaf) + 64,
+                           0, 3);
+        batch[batched++] = {key, &index_leaf};
+        const size_t capacity =
+            limit.has_value() ? std::min(ScanBatchSize, limit.value() - rows)
+                              : ScanBatchSize;
+        if (batched < capacity) return false;
+        return read_batch();
       });
-  if (!result.has_value()) { Abort(); }
-  return result;
+  if (!result.has_value()) {
+    Instrumentation::CountAbort(Statistics::Phantom);
+    Abort();
+    return result;
+  }
+  read_batch();
+  return rows;
 };
 
+const std::optional<size_t> Transaction::Impl::ScanIndex(
+    const std::string_view index_name, const std::string_view begin,
+    const std::optional<std::string_view> end,
+    std::function<bool(std::string_view,
+                       const std::pair<const void*, const size_t>)>
+        operation) {
+  if (IsAborted()) return std::nullopt;
+  auto* secondary_index = db_pimpl_->GetSecondaryIndex(index_name);
+  if (secondary_index == nullptr) {
+    SPDLOG_DEBUG("A transaction has tried to scan an unknown index {0}.",
+                 index_name);
+    Instrumentation::CountAbort(Statistics::InvalidOperation);
+    Abort();
+    return std::nullopt;
+  }
+
+  size_t rows = 0;
+  auto in_range = [&](const std::optional<std::string>& secondary_key) {
+    return secondary_key.has_value() && begin <= *secondary_key &&
+           (!end.has_value() || *secondary_key <= end.value());
+  };
+  const auto lower = Index::SecondaryIndex::LowerBound(begin);
+  std::optional<std::string> upper;
+  if (end.has_value()) upper = Index::SecondaryIndex::UpperBound(end.value());
+  // the rows are read from the default table.
+  auto* table = std::exchange(table_, nullptr);
+  auto result = secondary_index->GetTable().Scan(
+      lower, upper, [&](std::string_view entry_key, DataItem& entry) {
+        // an entry is read once, as a row is; see FindOwnSnapshot.
+        const auto* own = FindOwnSnapshot(entry_key);
+        if (own == nullptr || own->secondary_index != secondary_index) {
+          ReadDataItem(entry_key, &entry);
+          if (IsAborted()) return true;
+          read_set_.back().secondary_index = secondary_index;
+          own                              = &read_set_.back();
+        }
+        if (!own->data_item_copy.IsInitialized()) return false;
+
+        const auto key = Index::SecondaryIndex::PrimaryKeyOf(entry_key);
+        const auto row = Read(key);
+        if (IsAborted()) return true;
+        if (row.first == nullptr) return false;
+        // The row may have been written by this transaction or, if the scan
+        // is to abort at the validation, by a concurrent one.
+        const auto* row_snapshot = FindOwnSnapshot(key);
+        if (!in_range(
+                secondary_index->Extract(key, row_snapshot->data_item_copy))) {
+          return false;
+        }
+        rows++;
+        return operation(key, row);
+      });
+  table_ = table;
+  if (IsAborted()) return std::nullopt;
+  if (!result.has_value()) {
+    Instrumentation::CountAbort(Statistics::Phantom);
+    Abort();
+    return result;
+  }
+  return rows;
+}
+
 void Transaction::Impl::Abort() {
   if (!IsAborted()) {
     current_status_ = TxStatus::Aborted;
-    concurrency_control_->Abort();
-    concurrency_control_->PostProcessing(TxStatus::Aborted);
+    std::visit(
+        [](auto& cc) {
+          cc.Abort();
+          cc.PostProcessing(TxStatus::Aborted);
+        },
+        concurrency_control_);
   }
 }
 bool Transaction::Impl::Precommit() {
   if (IsAborted()) return false;
+  if (type_ == TxType::SnapshotReadOnly) return true;
+  if (!MaintainSecondaryIndexes()) return false;
 
-  const bool need_to_checkpoint =
-      (db_pimpl_->GetConfig().enable_checkpointing &&
-       db_pimpl_->IsNeedToCheckpointing(
-           db_pimpl_->epoch_framework_.GetMyThreadLocalEpoch()));
-  bool committed = concurrency_control_->Precommit(need_to_checkpoint);
+  const EpochNumber checkpoint_epoch =
+      db_pimpl_->GetConfig().enable_checkpointing
+          ? db_pimpl_->GetCheckpointEpochToSave(
+                db_pimpl_->epoch_framework_.GetMyThreadLocalEpoch())
+          : 0;
+  bool committed = std::visit(
+      [&](auto& cc) { return cc.Precommit(checkpoint_epoch); },
+      concurrency_control_);
+  // the protocols may reorder or clear the read/write sets.
+  read_set_positions_.Clear();
+  write_set_positions_.Clear();
   return committed;
 }
 
+bool Transaction::Impl::LockForCommit() {
+  assert(coordinated_);
+  if (IsAborted()) return false;
+  if (!MaintainSecondaryIndexes()) return false;
+  const EpochNumber checkpoint_epoch =
+      db_pimpl_->GetConfig().enable_checkpointing
+          ? db_pimpl_->GetCheckpointEpochToSave(
+                db_pimpl_->epoch_framework_.GetMyThreadLocalEpoch())
+          : 0;
+  const bool locked = std::visit(
+      [&](auto& cc) { return cc.LockForCommit(checkpoint_epoch); },
+      concurrency_control_);
+  read_set_positions_.Clear();
+  write_set_positions_.Clear();
+  return locked;
+}
+
+bool Transaction::Impl::ValidateForCommit() {
+  return std::visit([](auto& cc) { return cc.ValidateForCommit(); },
+                    concurrency_control_);
+}
+
+void Transaction::Impl::Install() {
+  std::visit([](auto& cc) { cc.Install(); }, concurrency_control_);
+}
+
 void Transaction::Impl::PostProcessing(TxStatus status) {
-  if (status == TxStatus::Aborted) current_status_ = TxStatus::Aborted;
-  concurrency_control_->PostProcessing(status);
+  if (status == TxStatus::Aborted) {
+    // #Abort has already post-processed, e.g., in #MaintainSecondaryIndexes.
+    if (IsAborted()) return;
+    current_status_ = TxStatus::Aborted;
+  }
+  std::visit([&](auto& cc) { cc.PostProcessing(status); },
+             concurrency_control_);
+  if (status == TxStatus::Committed &&
+      !db_pimpl_->GetSecondaryIndexes().empty()) {
+    auto entries = std::stable_partition(
+        write_set_.begin(), write_set_.end(),
+        [](const Snapshot& s) { return s.secondary_index == nullptr; });
+    index_write_set_.assign(std::make_move_iterator(entries),
+                            std::make_move_iterator(write_set_.end()));
+    write_set_.erase(entries, write_set_.end());
+  }
+}
+
+bool Transaction::Impl::MaintainSecondaryIndexes() {
+  const auto& secondary_indexes = db_pimpl_->GetSecondaryIndexes();
+  if (secondary_indexes.empty() || write_set_.empty()) return true;
+  // the entries depend on the results of the merges.
+  for (auto& snapshot : write_set_) {
+    if (pending_merges_ == 0) break;
+    if (!snapshot.merge_operator.has_value()) continue;
+    ResolveMerge(snapshot);
+    if (IsAborted()) return false;
+  }
+
+  WriteSetType entries;
+  auto write_entry = [&](Index::SecondaryIndex& secondary_index,
+                         const std::string& entry_key, const std::byte* value,
+                         const size_t size) {
+    auto* entry = secondary_index.GetTable().GetOrInsert(entry_key);
+    std::visit([&](auto& cc) { cc.Write(entry_key, value, size, entry); },
+               concurrency_control_);
+    entries.emplace_back(entry_key, value, size, entry);
+    entries.back().secondary_index = &secondary_index;
+  };
+  for (auto& snapshot : write_set_) {
+    // the secondary indexes are of the default table.
+    if (snapshot.table != nullptr) continue;
+    // #Write has read the row, unless the index has been created since then.
+    auto read_at = read_set_positions_.Find(read_set_, snapshot.key);
+    if (read_at == SnapshotPositionMap::npos) {
+      ReadDataItem(snapshot.key, snapshot.index_cache);
+      if (IsAborted()) return false;
+      read_at                  = read_set_.size() - 1;
+      read_set_[read_at].table = nullptr;
+    }
+    const auto& before = read_set_[read_at].data_item_copy;
+    const auto key     = Index::Table::DecodeKey(snapshot.key).second;
+    for (auto& secondary_index : secondary_indexes) {
+      using Index::SecondaryIndex;
+      const auto old_key = secondary_index->Extract(key, before);
+      const auto new_key =
+          secondary_index->Extract(key, snapshot.data_item_copy);
+      if (old_key == new_key) continue;
+      if (old_key.has_value()) {
+        write_entry(*secondary_index, SecondaryIndex::EntryKey(*old_key, key),
+                    nullptr, 0);
+      }
+      if (new_key.has_value() && !IsAborted()) {
+        write_entry(*secondary_index, SecondaryIndex::EntryKey(*new_key, key),
+                    SecondaryIndex::EntryValue,
+                    sizeof(SecondaryIndex::EntryValue));
+      }
+      if (IsAborted()) return false;
+    }
+  }
+  write_set_.insert(write_set_.end(), std::make_move_iterator(entries.begin()),
+                    std::make_move_iterator(entries.end()));
+  return true;
+}
+
+void Transaction::Impl::Reset() {
+  current_status_ = TxStatus::Running;
+  pending_merges_ = 0;
+  table_          = nullptr;
+  coordinated_    = false;
+  read_set_.clear();
+  write_set_.clear();
+  index_write_set_.clear();
+  read_set_positions_.Clear();
+  write_set_positions_.Clear();
+  std::visit([](auto& cc) { cc.Reset(); }, concurrency_control_);
+}
+
+void Transaction::Impl::Begin(TxType type) {
+  // NOTE: only Silo and SiloNWR keep the past versions.
+  const auto protocol = config_ref_.concurrency_control_protocol;
+  const bool snapshot_available =
+      config_ref_.enable_snapshot_read &&
+      (protocol == Config::ConcurrencyControl::Silo ||
+       protocol == Config::ConcurrencyControl::SiloNWR);
+  if (type == TxType::SnapshotReadOnly && !snapshot_available) {
+    type = TxType::ReadWrite;
+  }
+  // A replica serves the snapshot that has been replicated.
+  if (config_ref_.replica) {
+    type_           = TxType::SnapshotReadOnly;
+    snapshot_epoch_ = db_pimpl_->GetReplicatedEpoch();
+    return;
+  }
+  type_ = type;
+  if (type_ == TxType::SnapshotReadOnly) {
+    snapshot_epoch_ = EpochFramework::GetCompletedEpoch(
+        db_pimpl_->epoch_framework_.GetMyThreadLocalEpoch());
+  }
+}
+
+void Transaction::Impl::Prepare(const Database::ProcedureShape* shape) {
+  read_set_.reserve(shape->reads);
+  write_set_.reserve(shape->writes);
 }
 
 TxStatus Transaction::GetCurrentStatus() {
   return tx_pimpl_->GetCurrentStatus();
 }
+bool Transaction::SetTable(const std::string_view name) {
+  return tx_pimpl_->SetTable(name);
+}
 const std::pair<const std::byte* const, const size_t> Transaction::Read(
     const std::string_view key) {
   return tx_pimpl_->Read(key);
 }
+const std::vector<std::pair<const std::byte*, size_t>> Transaction::MultiRead(
+    const std::vector<std::string_view>& keys) {
+  return tx_pimpl_->MultiRead(keys);
+}
 void Transaction::Write(const std::string_view key, const std::byte value[],
                         const size_t size) {
   tx_pimpl_->Write(key, value, size);
 }
+void Transaction::Delete(const std::string_view key) {
+  tx_pimpl_->Delete(key);
+}
+void Transaction::Merge(const std::string_view key, const std::byte operand[],
+                        const size_t size, const MergeOperator op) {
+  tx_pimpl_->Merge(key, operand, size, op);
+}
+void Transaction::MultiWrite(
+    const std::vector<
+        std::pair<std::string_view, std::pair<const std::byte*, size_t>>>&
+        entries) {
+  tx_pimpl_->MultiWrite(entries);
+}
 const std::optional<size_t> Transaction::Scan(
     const std::string_view begin, const std::optional<std::string_view> end,
     std::function<bool(std::string_view,
                        const std::pair<const void*, const size_t>)>
         operation) {
-  return tx_pimpl_->Scan(begin, end, operation);
+  return tx_pimpl_->Scan(begin, end, std::nullopt, operation);
 };
-void Transaction::Abort() { tx_pimpl_->Abort(); }
+const std::optional<size_t> Transaction::Scan(
+    const std::string_view begin, const std::optional<std::string_view> end,
+    const size_t limit,
+    std::function<bool(std::string_view,
+                       const std::pair<const void*, const size_t>)>
+        operation) {
+  return tx_pimpl_->Scan(begin, end, limit, operation);
+};
+const std::optional<size_t> Transaction::ScanIndex(
+    const std::string_view index_name, const std::string_view begin,
+    const std::optional<std::string_view> end,
+    std::function<bool(std::string_view,
+                       const std::pair<const void*, const size_t>)>
+        operation) {
+  return tx_pimpl_->ScanIndex(index_name, begin, end, operation);
+}
+void Transaction::Abort() {
+  if (tx_pimpl_->GetCurrentStatus() != TxStatus::Aborted) {
+    Instrumentation::CountAbort(Statistics::UserAbort);
+  }
+  tx_pimpl_->Abort();
+}
 bool Transaction::Precommit() { return tx_pimpl_->Precommit(); }
 
 Transaction::Transaction(void* db_pimpl) noexcept
@@ -19,15 +19,25 @@
 
 #include <lineairdb/config.h>
 #include <lineairdb/database.h>
+#include <lineairdb/merge_operator.h>
 #include <lineairdb/transaction.h>
 #include <lineairdb/tx_status.h>
+#include <lineairdb/tx_type.h>
 
 #include <memory>
 #include <optional>
 #include <string_view>
+#include <variant>
+#include <vector>
 
 #include "concurrency_control/concurrency_control_base.h"
+#include "concurrency_control/impl/silo_nwr.hpp"
+#include "concurrency_control/impl/two_phase_locking.hpp"
 #include "types/definitions.h"
+#include "types/merge.hpp"
+#include "types/snapshot.hpp"
+#include "types/transaction_id.hpp"
+#include "util/position_map.hpp"
 
 namespace LineairDB {
 
@@ -57,36 +67,177 @@ class Transaction::Impl {
   ~Impl() noexcept;
 
   TxStatus GetCurrentStatus();
+  bool SetTable(const std::string_view name);
+  /**
+   * @param index_leaf the data item of `key`, if the callee has already
+   * looked it up.
+   */
   const std::pair<const std::byte* const, const size_t> Read(
-      const std::string_view key);
+      const std::string_view key, DataItem* index_leaf = nullptr);
+  const std::vector<std::pair<const std::byte*, size_t>> MultiRead(
+      const std::vector<std::string_view>& keys);
+  /**
+   * @param index_leaf the data item of `key`, if the callee has already
+   * looked it up.
+   */
   void Write(const std::string_view key, const std::byte value[],
-             const size_t size);
+             const size_t size, DataItem* index_leaf = nullptr);
+  void Delete(const std::string_view key);
+  void Merge(const std::string_view key, const std::byte operand[],
+             const size_t size, const MergeOperator op);
+  void MultiWrite(
+      const std::vector<
+          std::pair<std::string_view, std::pair<const std::byte*, size_t>>>&
+          entries);
 
+  /**
+   * @param limit the number of the rows to read at most, if any.
+   */
   const std::optional<size_t> Scan(
       const std::string_view begin, const std::optional<std::string_view> end,
+      const std::optional<size_t> limit,
+      std::function<bool(std::string_view,
+                         const std::pair<const void*, const size_t>)>
+          operation);
+
+  /**
+   * @see Transaction::ScanIndex
+   */
+  const std::optional<size_t> ScanIndex(
+      const std::string_view index_name, const std::string_view begin,
+      const std::optional<std::string_view> end,
       std::function<bool(std::string_view,
                          const std::pair<const void*, const size_t>)>
           operation);
 
   void Abort();
   bool Precommit();
+  /**
+   * @brief The phases of a coordinated commit; see ConcurrencyControlBase.
+   * @pre this transaction is coordinated; see #coordinated_.
+   */
+  bool LockForCommit();
+  bool ValidateForCommit();
+  void Install();
 
   /**
    * We assume that #PostProcessing will be invoked after #Precommit().
    */
   void PostProcessing(TxStatus);
 
+  /**
+   * @brief Clears this object to process the next transaction.
+   * The read/write sets keep their capacity.
+   */
+  void Reset();
+
+  /**
+   * @brief Starts a transaction of `type`.
+   * @pre The callee thread is online.
+   */
+  void Begin(TxType type);
+
+  /**
+   * @brief Makes this transaction one of `shape`, whose read/write sets are
+   * allocated for the shape.
+   * @see Database::Prepare
+   */
+  void Prepare(const Database::ProcedureShape* shape);
+
  private:
   bool IsAborted() { return current_status_ == TxStatus::Aborted; };
+  /**
+   * @brief Returns the index of the table that this transaction accesses.
+   */
+  Index::ConcurrentTable& GetCurrentIndex();
+  /**
+   * @brief Returns `key` of the current table as it is in the read/write
+   * sets; see Index::Table::EncodeKey.
+   */
+  std::string_view EncodeKey(const std::string_view key, std::string& buffer);
+  /**
+   * @brief Returns the snapshot of `key` which this transaction has already
+   * written or read, or nullptr.
+   */
+  Snapshot* FindOwnSnapshot(const std::string_view key);
+  /**
+   * @brief Reads `index_leaf` via the protocol and appends it to the read set.
+   * @param index_leaf nullptr only for a snapshot read of an absent key.
+   */
+  const std::pair<const std::byte* const, const size_t> ReadDataItem(
+      const std::string_view key, DataItem* index_leaf);
+  /**
+   * @brief Reads the absence item of `key`, which the index has not found;
+   * see Index::ConcurrentTable::GetOrAbsence. The validation of the read set
+   * detects the insertion of the key after the read.
+   * @param absence_tid The transaction id of `absence` before the lookup.
+   */
+  const std::pair<const std::byte* const, const size_t> ReadAbsence(
+      const std::string_view key, DataItem* absence,
+      const TransactionId absence_tid);
+  /**
+   * @brief Whether the protocol validates the reads without locking the data
+   * items; see ConcurrencyControlBase.
+   */
+  bool ValidatesReads();
+  /**
+   * @brief Turns the pending merge of `snapshot`, in the write set, into a
+   * write of the result, by reading the current version of the key.
+   */
+  void ResolveMerge(Snapshot& snapshot);
+  /**
+   * @brief
+   * Writes the entries of the secondary indexes for the rows in the write
+   * set, as a part of this transaction: the entry of the value that a row has
+   * had is removed, and the entry of the value written is added. The entries
+   * are appended to the write set; see Snapshot::secondary_index.
+   * @return false if this transaction has been aborted.
+   */
+  bool MaintainSecondaryIndexes();
+
+ private:
+  /**
+   * @note The protocol is held by value, so that a transaction does not
+   * allocate it. Since every protocol is a final class, the calls via
+   * std::visit are resolved statically.
+   */
+  using ConcurrencyControlType =
+      std::variant<ConcurrencyControl::SiloNWR, ConcurrencyControl::Silo,
+                   ConcurrencyControl::TwoPhaseLocking,
+                   ConcurrencyControl::TwoPhaseLockingWaitDie,
+                   ConcurrencyControl::TwoPhaseLockingWoundWait>;
+  static ConcurrencyControlType MakeConcurrencyControl(
+      Config::ConcurrencyControl, TransactionReferences&&);
+
+  struct SnapshotKey {
+    std::string_view operator()(const Snapshot& s) const { return s.key; }
+  };
+  /**
+   * @note Large transactions find their own reads and writes by hashing,
+   * instead of scanning the read/write sets for each operation.
+   */
+  using SnapshotPositionMap = PositionMap<std::string_view, SnapshotKey>;
 
  private:
   TxStatus current_status_;
+  TxType type_;
+  EpochNumber snapshot_epoch_;  // for TxType::SnapshotReadOnly
+  size_t pending_merges_;       // see Snapshot::merge_operator
+  Index::Table* table_;  // see #SetTable; nullptr for the default table
+  // whether the commit is coordinated with the other databases, e.g., its
+  // transactions in the other shards of a ShardedDatabase.
+  bool coordinated_;
   Database::Impl* db_pimpl_;
   const Config& config_ref_;
-  std::unique_ptr<ConcurrencyControlBase> concurrency_control_;
 
   ReadSetType read_set_;
   WriteSetType write_set_;
+  // The entries of the secondary indexes that a committed transaction has
+  // written, which are put apart from the rows for the logging.
+  WriteSetType index_write_set_;
+  SnapshotPositionMap read_set_positions_;
+  SnapshotPositionMap write_set_positions_;
+  ConcurrencyControlType concurrency_control_;
 };
 }  // namespace LineairDB
 #endif /* LINEAIRDB_TRANSACTION_IMPL_H */
@@ -18,52 +18,201 @@
 #ifndef LINEAIRDB_DATA_BUFFER_HPP
 #define LINEAIRDB_DATA_BUFFER_HPP
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
 #include <new>
+#include <string>
 
 #include "util/logger.hpp"
+#include "util/memory_statistics.hpp"
 
 namespace LineairDB {
 
+/**
+ * @brief
+ * A byte buffer holding a value.
+ * Values up to InlineCapacity bytes are stored in the buffer itself; larger
+ * values are stored in a heap area, which is reused while the new value fits
+ * into it. The heap areas owned by buffers are counted in MemoryStatistics.
+ */
 struct DataBuffer {
-  std::byte* value;
+  static constexpr size_t InlineCapacity = 32;
+
   size_t size;
 
-  DataBuffer() : size(0) { value = nullptr; }
-  ~DataBuffer() {
-    if (value != nullptr) delete[] value;
+  DataBuffer() : size(0), capacity_(0) {}
+  DataBuffer(const DataBuffer& rhs) : DataBuffer() { Reset(rhs); }
+  DataBuffer& operator=(const DataBuffer& rhs) {
+    Reset(rhs);
+    return *this;
   }
+  ~DataBuffer() { ReleaseHeap(); }
+
+  // returns nullptr if the buffer is empty.
+  std::byte* data() { return IsEmpty() ? nullptr : Storage(); }
+  const std::byte* data() const { return IsEmpty() ? nullptr : Storage(); }
 
   void Reset(const std::byte* v, const size_t s) {
-    if (v == nullptr){
-      delete[] value;
-      value = nullptr;
+    if (v == nullptr) {
+      ReleaseHeap();
       size = 0;
+      return;
     }
-    if (size < s) {
-      if (value == nullptr) {
-        value = new std::byte[s];
-      } else {
-        value = static_cast<decltype(value)>(
-            std::realloc(reinterpret_cast<void*>(value), s));
-        if (value == nullptr) { throw std::bad_alloc(); }
-      }
+    if (Capacity() < s) {
+      auto* allocated = new std::byte[s];
+      ReleaseHeap();
+      heap_value_ = allocated;
+      capacity_   = s;
+      MemoryStatistics::Add(MemoryStatistics::Values, s);
     }
     size = s;
-    std::memcpy(value, v, s);
+    if (s != 0) std::memmove(Storage(), v, s);
+  }
+  void Reset(const DataBuffer& rhs) {
+    if (this == &rhs) return;
+    if (rhs.capacity_ == Mapped) {
+      // the area is immutable; copying the reference is enough.
+      ReleaseHeap();
+      heap_value_ = rhs.heap_value_;
+      capacity_   = Mapped;
+      size        = rhs.size;
+      return;
+    }
+    Reset(rhs.data(), rhs.size);
   }
-  void Reset(const DataBuffer& rhs) { Reset(rhs.value, rhs.size); }
   void Reset(const std::string& rhs) {
     Reset(reinterpret_cast<const std::byte*>(rhs.data()), rhs.size());
   }
   bool IsEmpty() const { return size == 0; }
 
+  /**
+   * @brief
+   * Refers to the heap area of `rhs` instead of copying it; an inline value
+   * is copied. The area must not be overwritten while this buffer refers to
+   * it, i.e., the owner has to update it by #ResetWithoutOverwriting.
+   */
+  void Borrow(const DataBuffer& rhs) {
+    if (rhs.IsInline() || rhs.IsEmpty()) {
+      Reset(rhs);
+      return;
+    }
+    ReleaseHeap();
+    heap_value_ = rhs.heap_value_;
+    capacity_   = Borrowed;
+    size        = rhs.size;
+  }
+
+  /**
+   * @brief
+   * Refers to the immutable area `v`, which outlives this buffer, e.g., a
+   * value in a mapped checkpoint image. The copies of this buffer also refer
+   * to the area, and the first update allocates a new heap area.
+   */
+  void Refer(const std::byte* v, const size_t s) {
+    ReleaseHeap();
+    if (s == 0) {
+      size = 0;
+      return;
+    }
+    heap_value_ = const_cast<std::byte*>(v);
+    capacity_   = Mapped;
+    size        = s;
+  }
+
+  /**
+   * @brief
+   * Updates the value without writing into the current heap area, so that
+   * the buffers borrowing the area keep the old value.
+   * @return The heap area which this buffer has detached, or nullptr. The
+   * caller must `delete[]` it after the borrowers have gone.
+   */
+  std::byte* ResetWithoutOverwriting(const std::byte* v, const size_t s) {
+    if (IsInline() && s <= InlineCapacity) {
+      Reset(v, s);
+      return nullptr;
+    }
+    // NOTE: once moved to the heap, the value is kept on the heap; otherwise
+    // an inline value would overwrite the pointer that readers may load.
+    std::byte* detached = nullptr;
+    if (!IsInline() && capacity_ != Borrowed && capacity_ != Mapped) {
+      detached = heap_value_;
+      MemoryStatistics::Add(MemoryStatistics::Values,
+                            -static_cast<int64_t>(capacity_));
+    }
+    const size_t capacity = std::max<size_t>(s, 1);
+    auto* allocated       = new std::byte[capacity];
+    MemoryStatistics::Add(MemoryStatistics::Values, capacity);
+    if (s != 0) std::memcpy(allocated, v, s);
+    heap_value_ = allocated;
+    capacity_   = capacity;
+    size        = s;
+    return detached;
+  }
+
+  /**
+   * @brief
+   * Same as #Refer, but keeps the current heap area intact for the
+   * concurrent readers, as #ResetWithoutOverwriting does. `v` holds the same
+   * value as this buffer, e.g., a copy evicted to a cold storage.
+   * @return The heap area which this buffer has detached, or nullptr if this
+   * buffer owns no heap area and is left as it is.
+   */
+  std::byte* ReferWithoutOverwriting(const std::byte* v) {
+    if (HeapBytes() == 0) return nullptr;
+    std::byte* detached = heap_value_;
+    MemoryStatistics::Add(MemoryStatistics::Values,
+                          -static_cast<int64_t>(capacity_));
+    heap_value_ = const_cast<std::byte*>(v);
+    capacity_   = Mapped;
+    return detached;
+  }
+
+  // the bytes of the heap area that this buffer owns.
+  size_t HeapBytes() const {
+    if (IsInline() || capacity_ == Borrowed || capacity_ == Mapped) return 0;
+    return capacity_;
+  }
+
   std::string toString() const {
-    return std::string(reinterpret_cast<char*>(value), size);
+    if (IsEmpty()) return std::string();
+    return std::string(reinterpret_cast<const char*>(data()), size);
+  }
+
+ private:
+  // capacity_ of a buffer that refers to the heap area of another one.
+  static constexpr size_t Borrowed = SIZE_MAX;
+  // capacity_ of a buffer that refers to an external area; see #Refer.
+  static constexpr size_t Mapped = SIZE_MAX - 1;
+
+  // zero while the value is stored inline
+  size_t capacity_;
+  union {
+    std::byte* heap_value_;
+    std::byte inline_value_[InlineCapacity];
+  };
+
+  bool IsInline() const { return capacity_ == 0; }
+  std::byte* Storage() { return IsInline() ? inline_value_ : heap_value_; }
+  const std::byte* Storage() const {
+    return IsInline() ? inline_value_ : heap_value_;
+  }
+  size_t Capacity() const {
+    // a borrowed or mapped area is read-only
+    if (capacity_ == Borrowed || capacity_ == Mapped) return 0;
+    return IsInline() ? InlineCapacity : capacity_;
+  }
+  void ReleaseHeap() {
+    if (IsInline()) return;
+    if (capacity_ != Borrowed && capacity_ != Mapped) {
+      delete[] heap_value_;
+      MemoryStatistics::Add(MemoryStatistics::Values,
+                            -static_cast<int64_t>(capacity_));
+    }
+    capacity_ = 0;
   }
 };
 }  // namespace LineairDB
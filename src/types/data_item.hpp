@@ -20,6 +20,7 @@
 
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
 #include <msgpack.hpp>
 #include <string>
@@ -29,35 +30,98 @@
 #include "concurrency_control/pivot_object.hpp"
 #include "data_buffer.hpp"
 #include "lock/impl/readers_writers_lock.hpp"
+#include "lock/wait_policy.hpp"
 #include "types/transaction_id.hpp"
 #include "util/logger.hpp"
+#include "util/memory_statistics.hpp"
 
 namespace LineairDB {
 
 struct DataItem {
+  /**
+   * @brief
+   * A past version kept for snapshot reads; see Config::enable_snapshot_read.
+   * It is immutable once it is linked to DataItem::old_versions.
+   */
+  struct Version {
+    TransactionId transaction_id;
+    DataBuffer buffer;
+    std::atomic<Version*> next;
+
+    Version(const TransactionId tid, const DataBuffer& b)
+        : transaction_id(tid), buffer(b), next(nullptr) {}
+  };
+
   std::atomic<TransactionId> transaction_id;
   bool initialized;
+  // The read-modify-write conflicts, for SiloNWR; see
+  // Config::hot_key_threshold. It is a hint, not a part of the version.
+  mutable std::atomic<uint8_t> contention;
+  // Set by the accesses and cleared by the clock sweep of the cold storage;
+  // see Config::cold_storage_threshold_bytes. It is a hint as well.
+  mutable std::atomic<bool> referenced;
   DataBuffer buffer;
   DataBuffer checkpoint_buffer;                     // a.k.a. stable version
-  std::atomic<NWRPivotObject> pivot_object;         // for NWR
-  Lock::ReadersWritersLockBO readers_writers_lock;  // for 2PL
+  TransactionId checkpoint_tid;  // the transaction id of checkpoint_buffer
+  EpochNumber checkpoint_epoch;  // the checkpoint of checkpoint_buffer
+  std::atomic<NWRPivotObject> pivot_object;  // for NWR
+  // for 2PL and the hot items; it does not pad the item to a cache line.
+  Lock::UnpaddedReadersWritersLockBO readers_writers_lock;
+  std::atomic<Version*> old_versions;  // the newest first, for snapshot reads
 
-  std::byte* value() { return &buffer.value[0]; }
-  const std::byte* value() const { return &buffer.value[0]; }
+  std::byte* value() { return buffer.data(); }
+  const std::byte* value() const { return buffer.data(); }
   size_t size() const { return buffer.size; }
   bool IsInitialized() const { return initialized; }
 
+  /**
+   * @brief
+   * The transaction id of a data item that has been removed from the index
+   * by the reclamation of tombstones (see ConcurrentTable::EraseTombstone).
+   * No transaction generates this id, and thus the readers of a removed item
+   * fail their validation, and the writers abort when they lock it.
+   */
+  static constexpr uint32_t RemovedTid = UINT32_MAX - 1;
+  bool IsRemoved() const {
+    const auto tid = transaction_id.load();
+    return tid.epoch == 0 && (tid.tid & ~1u) == RemovedTid;
+  }
+
   DataItem()
-      : transaction_id(0), initialized(false), pivot_object(NWRPivotObject()) {}
+      : transaction_id(0),
+        initialized(false),
+        contention(0),
+        referenced(false),
+        checkpoint_tid(0),
+        checkpoint_epoch(0),
+        pivot_object(NWRPivotObject()),
+        old_versions(nullptr) {}
   DataItem(const std::byte* v, size_t s, TransactionId tid = 0)
-      : transaction_id(tid), initialized(true), pivot_object(NWRPivotObject()) {
+      : transaction_id(tid),
+        initialized(true),
+        contention(0),
+        referenced(false),
+        checkpoint_tid(0),
+        checkpoint_epoch(0),
+        pivot_object(NWRPivotObject()),
+        old_versions(nullptr) {
     Reset(v, s);
   }
   DataItem(const DataItem& rhs)
       : transaction_id(rhs.transaction_id.load()),
         initialized(rhs.initialized),
-        pivot_object(NWRPivotObject()) {
-    buffer.Reset(rhs.buffer);
+        contention(0),
+        referenced(false),
+        checkpoint_tid(0),
+        checkpoint_epoch(0),
+        pivot_object(NWRPivotObject()),
+        old_versions(nullptr) {
+    // a tombstone may keep the overwritten value; see #ResetWithoutOverwriting.
+    if (initialized) buffer.Reset(rhs.buffer);
+  }
+  ~DataItem() {
+    DeleteVersions(old_versions.load());
+    ReleaseStableVersion();
   }
   DataItem& operator=(const DataItem& rhs) {
     transaction_id.store(rhs.transaction_id.load());
@@ -66,28 +130,142 @@ struct DataItem {
     return *this;
   }
 
+  /**
+   * @brief Same as the copy assignment, but refers to the value of `rhs`
+   * instead of copying it; see DataBuffer::Borrow.
+   */
+  void Borrow(const DataItem& rhs) {
+    transaction_id.store(rhs.transaction_id.load());
+    initialized = rhs.initialized;
+    if (initialized) { buffer.Borrow(rhs.buffer); }
+  }
+
+  /**
+   * @brief Same as the copy assignment, but keeps the current value intact
+   * for the borrowers; see DataBuffer::ResetWithoutOverwriting.
+   * @return The detached value area, or nullptr.
+   */
+  std::byte* ResetWithoutOverwriting(const DataItem& rhs) {
+    transaction_id.store(rhs.transaction_id.load());
+    initialized = rhs.initialized;
+    if (!initialized) return nullptr;
+    return buffer.ResetWithoutOverwriting(rhs.value(), rhs.size());
+  }
+
   void Reset(const std::byte* v, const size_t s, TransactionId tid = 0) {
     buffer.Reset(v, s);
     if (!tid.IsEmpty()) transaction_id.store(tid);
     initialized = (v != nullptr && s != 0);
   }
 
-  void CopyLiveVersionToStableVersion() {
-    if (!checkpoint_buffer.IsEmpty()) return;  // snapshot is already taken
+  /**
+   * @brief
+   * Keeps the current version for the checkpoint of `epoch`, before a
+   * transaction overwrites it. The version kept for a former checkpoint is
+   * stale, and it is simply overwritten.
+   */
+  void CopyLiveVersionToStableVersion(const EpochNumber epoch) {
+    // snapshot is already taken
+    if (checkpoint_epoch == epoch) return;
     // There is an assumption that this thread can `exclusively` access this
     // data item.
-    checkpoint_buffer.Reset(buffer);
+    const size_t released = checkpoint_buffer.HeapBytes();
+    if (initialized) {
+      checkpoint_buffer.Reset(buffer);
+      checkpoint_tid = transaction_id.load();
+      checkpoint_tid.tid &= ~1llu;  // Silo and SiloNWR hold the lock bit
+    } else {
+      // The version is absent at the point of consistency; the id of a
+      // tombstone is kept so that incremental checkpoints can record it.
+      checkpoint_buffer.Reset(nullptr, 0);
+      checkpoint_tid = transaction_id.load();
+      checkpoint_tid.tid &= ~1llu;
+    }
+    checkpoint_epoch = epoch;
+    CountStableVersion(checkpoint_buffer.HeapBytes(), released);
+  }
+
+  /**
+   * @brief Frees the version kept by #CopyLiveVersionToStableVersion.
+   */
+  void ReleaseStableVersion() {
+    CountStableVersion(0, checkpoint_buffer.HeapBytes());
+    checkpoint_buffer.Reset(nullptr, 0);
+  }
+
+  /**
+   * @brief
+   * Keeps the current version for snapshot reads, before a transaction in
+   * `epoch` overwrites it. It also discards the versions which no snapshot
+   * at or after `horizon` reads.
+   * @pre The callee has locked this item by transaction_id.
+   */
+  void KeepVersionForSnapshots(const EpochNumber epoch,
+                               const EpochNumber horizon) {
+    auto tid = transaction_id.load();
+    tid.tid &= ~1u;  // the version written by the previous owner
+    // a snapshot never reads a version overwritten in the same epoch.
+    if (initialized && tid.epoch < epoch) {
+      auto* version = new Version(tid, buffer);
+      version->next.store(old_versions.load());
+      old_versions.store(version);
+    }
+
+    // A snapshot at or after `horizon` stops at the first version written
+    // at or before `horizon`; the older ones are unreachable.
+    for (auto* version = old_versions.load(); version != nullptr;
+         version       = version->next.load()) {
+      if (version->transaction_id.epoch <= horizon) {
+        DeleteVersions(version->next.exchange(nullptr));
+        break;
+      }
+    }
+  }
+
+  /**
+   * @brief
+   * Returns a copy of the newest version written at or before `epoch`.
+   * It returns an uninitialized item if there is no such version.
+   */
+  DataItem ReadSnapshot(const EpochNumber epoch,
+                        const Lock::WaitPolicy& wait_policy = {}) const {
+    for (;;) {
+      const auto tid = transaction_id.load();
+      if (tid.tid & 1llu) {
+        wait_policy.WaitUntil(this, [&]() { return IsUnlocked(); });
+        continue;
+      }
+      if (tid.epoch <= epoch) {
+        DataItem copy(*this);
+        if (transaction_id.load() == tid) return copy;
+        continue;
+      }
+      // NOTE: the writer links the overwritten version before it unlocks.
+      for (auto* version = old_versions.load(); version != nullptr;
+           version       = version->next.load()) {
+        if (version->transaction_id.epoch <= epoch) {
+          return DataItem(version->buffer.data(), version->buffer.size,
+                          version->transaction_id);
+        }
+      }
+      return DataItem();
+    }
   }
 
-  void ExclusiveLock() {
+  void ExclusiveLock(const Lock::WaitPolicy& wait_policy = {}) {
     // Acquire exclusive locking for all protocols:
 
+    // for TwoPhaseLocking. it uses rw_lock.
+    // NOTE: it is acquired first, since Silo and SiloNWR wait for the
+    // transaction id while they hold the rw_lock of a hot item.
+    { GetRWLockRef().Lock(); }
+
     {
       // for Silo, Silo+NWR. they uses transaction_id as the lock
       for (;;) {
         auto tid = transaction_id.load();
         if (tid.tid & 1llu) {
-          std::this_thread::yield();
+          wait_policy.WaitUntil(this, [&]() { return IsUnlocked(); });
           continue;
         }
         auto new_tid = tid;
@@ -95,12 +273,9 @@ struct DataItem {
         if (transaction_id.compare_exchange_weak(tid, new_tid)) break;
       }
     }
-
-    // for TwoPhaseLocking. it uses rw_lock.
-    { GetRWLockRef().Lock(); }
   }
 
-  void ExclusiveUnlock() {
+  void ExclusiveUnlock(const Lock::WaitPolicy& wait_policy = {}) {
     // Release exclusive locking for all protocols:
 
     // for Silo, Silo+NWR. they uses transaction_id as the lock
@@ -108,14 +283,60 @@ struct DataItem {
       auto tid = transaction_id.load();
       tid.tid -= 1llu;
       transaction_id.store(tid);
+      wait_policy.NotifyReleased(this);
     }
     // for TwoPhaseLocking. it uses rw_lock.
     { GetRWLockRef().UnLock(); }
   }
 
+  /**
+   * @brief
+   * Same as #ExclusiveLock, but gives up instead of waiting for the owners.
+   * @return true if locked; #ExclusiveUnlock releases the lock.
+   */
+  bool TryExclusiveLock() {
+    if (!GetRWLockRef().TryLock()) return false;
+    auto tid = transaction_id.load();
+    if (!(tid.tid & 1llu)) {
+      auto new_tid = tid;
+      new_tid.tid += 1llu;
+      if (transaction_id.compare_exchange_strong(tid, new_tid)) return true;
+    }
+    GetRWLockRef().UnLock();
+    return false;
+  }
+
+  void Touch() const {
+    if (!referenced.load(std::memory_order_relaxed)) {
+      referenced.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  bool IsUnlocked() const { return !(transaction_id.load().tid & 1llu); }
+
   decltype(readers_writers_lock)& GetRWLockRef() {
     return readers_writers_lock;
   };
+
+ private:
+  // DataBuffer counts the stable versions as Values; they are moved into
+  // StableVersions here.
+  static void CountStableVersion(const size_t allocated,
+                                 const size_t released) {
+    const auto delta =
+        static_cast<int64_t>(allocated) - static_cast<int64_t>(released);
+    if (delta == 0) return;
+    MemoryStatistics::Add(MemoryStatistics::StableVersions, delta);
+    MemoryStatistics::Add(MemoryStatistics::Values, -delta);
+  }
+
+  static void DeleteVersions(Version* version) {
+    while (version != nullptr) {
+      auto* next = version->next.load();
+      delete version;
+      version = next;
+    }
+  }
 };
 }  // namespace LineairDB
 #endif /* LINEAIRDB_DATA_ITEM_HPP */
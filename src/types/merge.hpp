@@ -0,0 +1,71 @@
+/*
+ *   Copyright (c) 2020 Nippon Telegraph and Telephone Corporation
+ *   All rights reserved.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+#ifndef LINEAIRDB_MERGE_HPP
+#define LINEAIRDB_MERGE_HPP
+
+#include <lineairdb/merge_operator.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "data_item.hpp"
+
+namespace LineairDB {
+
+/**
+ * @brief
+ * Combines `current` with the operand held by `operand`, which becomes the
+ * result; see LineairDB::MergeOperator. It also combines two operands of the
+ * same operator, as the operators are associative.
+ * @pre The operand of Add and Max is 8 bytes; see #IsValidMergeOperand.
+ */
+inline void ApplyMerge(const MergeOperator op, const DataItem& current,
+                       DataItem& operand) {
+  if (!current.IsInitialized()) return;
+  if (op == MergeOperator::Append) {
+    std::vector<std::byte> result(current.size() + operand.size());
+    std::memcpy(result.data(), current.value(), current.size());
+    if (operand.IsInitialized()) {
+      std::memcpy(result.data() + current.size(), operand.value(),
+                  operand.size());
+    }
+    operand.Reset(result.data(), result.size());
+    return;
+  }
+  if (current.size() != sizeof(int64_t)) return;
+  int64_t lhs, rhs;
+  std::memcpy(&lhs, current.value(), sizeof(int64_t));
+  std::memcpy(&rhs, operand.value(), sizeof(int64_t));
+  const int64_t result =
+      op == MergeOperator::Add
+          // wraps around on overflow, instead of the undefined behavior
+          ? static_cast<int64_t>(static_cast<uint64_t>(lhs) +
+                                 static_cast<uint64_t>(rhs))
+          : std::max(lhs, rhs);
+  operand.Reset(reinterpret_cast<const std::byte*>(&result), sizeof(result));
+}
+
+inline bool IsValidMergeOperand(const MergeOperator op, const size_t size) {
+  return op == MergeOperator::Append || size == sizeof(int64_t);
+}
+
+}  // namespace LineairDB
+
+#endif /* LINEAIRDB_MERGE_HPP */
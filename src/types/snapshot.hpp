@@ -18,6 +18,10 @@
 #ifndef LINEAIRDB_SNAPSHOT_HPP
 #define LINEAIRDB_SNAPSHOT_HPP
 
+#include <lineairdb/merge_operator.h>
+
+#include <functional>
+#include <optional>
 #include <vector>
 
 #include "data_item.hpp"
@@ -25,11 +29,24 @@
 
 namespace LineairDB {
 
+namespace Index {
+class SecondaryIndex;
+class Table;
+}  // namespace Index
+
 struct Snapshot {
   std::string key;
   DataItem data_item_copy;
   DataItem* index_cache;
   bool is_read_modify_write;
+  // A merge that has not been applied; data_item_copy holds its operand.
+  // See Transaction::Merge.
+  std::optional<MergeOperator> merge_operator;
+  // The index of the entry, or nullptr for a row; see Index::SecondaryIndex.
+  Index::SecondaryIndex* secondary_index = nullptr;
+  // The named table of the row, or nullptr for the default table; the key is
+  // encoded by Index::Table::EncodeKey.
+  Index::Table* table = nullptr;
 
   Snapshot(const std::string_view k, const std::byte v[], const size_t s,
            DataItem* const i, const TransactionId ver = 0)
@@ -38,10 +55,6 @@ struct Snapshot {
   }
   Snapshot(const Snapshot&) = default;
   Snapshot& operator=(const Snapshot&) = default;
-
-  static bool Compare(Snapshot& left, Snapshot& right) {
-    return left.key < right.key;
-  }
 };
 
 using ReadSetType  = std::vector<Snapshot>;
@@ -42,7 +42,7 @@ struct TransactionId {
       return epoch < rhs.epoch;
     }
   }
-  bool IsEmpty() { return (epoch == 0 && tid == 0); }
+  bool IsEmpty() const { return (epoch == 0 && tid == 0); }
   MSGPACK_DEFINE(epoch, tid);
 };
 
@@ -19,47 +19,69 @@
 
 #include <assert.h>
 
-#include <algorithm>
-#include <array>
 #include <atomic>
 #include <cstdint>
 #include <sstream>
-#include <utility>
-
-template <const uint32_t CounterSize = 1>
+#include <type_traits>
+
+/**
+ * @tparam SetSize the bits of the set, i.e., the lower SetSize bits of a
+ * `Word` are used.
+ * @tparam Word an unsigned integer of 32 bits or more; see WideHalfWordSet.
+ * @note The slots are compared and merged all at once by the arithmetic on
+ * the whole word (SWAR), without branches.
+ */
+template <const uint32_t CounterSize = 1, const uint32_t SetSize = 32,
+          typename Word = uint32_t>
 class HalfWordSet {
-  static_assert((CounterSize <= 32) && (32 % CounterSize == 0),
-                "HalfWordSet requires CounterSize <= 32-bit and 8-bit "
-                "divisible");
-
-  constexpr static size_t ArraySize = 32 / CounterSize;
-  constexpr static uint32_t Max     = (2 << (CounterSize - 1)) - 1;
-
-  constexpr static uint32_t MakeMask(const size_t i) {
-    uint32_t r = 0;
-    for (uint32_t j = i * CounterSize; j < ((i + 1) * CounterSize); j++) {
-      r |= 1llu << j;
+  constexpr static uint32_t WordBits = sizeof(Word) * 8;
+  static_assert((CounterSize <= SetSize) && (SetSize <= WordBits) &&
+                    (SetSize % CounterSize == 0) && (CounterSize <= 32),
+                "HalfWordSet requires CounterSize <= SetSize <= the bits of "
+                "Word, CounterSize <= 32 and SetSize divisible by "
+                "CounterSize");
+
+  constexpr static size_t ArraySize = SetSize / CounterSize;
+  constexpr static Word Max = (static_cast<Word>(2) << (CounterSize - 1)) - 1;
+
+  constexpr static Word MakeLowBits() {
+    Word r = 0;
+    for (size_t i = 0; i < ArraySize; i++) {
+      r |= static_cast<Word>(1) << (i * CounterSize);
     }
     return r;
   }
+  // the lowest and the highest bits of the slots, and the bits of the slots.
+  constexpr static Word Low  = MakeLowBits();
+  constexpr static Word High = Low << (CounterSize - 1);
+  constexpr static Word Used = Low * Max;
 
-  template <size_t... i>
-  constexpr static auto MaskBuilder(std::index_sequence<i...>) {
-    return std::array<uint32_t, sizeof...(i)>{{MakeMask(i)...}};
+  // The highest bit of a slot is set if the slot of `x` is not zero.
+  constexpr static Word NonZeroSlots(const Word x) {
+    return (((x & ~High) + (High - Low)) | x) & High;
   }
-
-  constexpr static std::array<uint32_t, ArraySize> GetMasks() {
-    return MaskBuilder(std::make_index_sequence<ArraySize>{});
+  // The highest bit of a slot is set if the slot of `lhs` is less than the
+  // one of `rhs`, i.e., if the subtraction of the slots borrows.
+  constexpr static Word LessSlots(const Word lhs, const Word rhs) {
+    const Word difference =
+        ((lhs | High) - (rhs & ~High)) ^ ((lhs ^ ~rhs) & High);
+    return ((~lhs & rhs) | (~(lhs ^ rhs) & difference)) & High;
+  }
+  // Fills the slots whose highest bits are set.
+  constexpr static Word FillSlots(const Word highest_bits) {
+    return (highest_bits >> (CounterSize - 1)) * Max;
   }
-
-  constexpr static std::array<uint32_t, ArraySize> Masks = GetMasks();
 
  private:
-  uint32_t bitarray_;
+  Word bitarray_;
 
  public:
   HalfWordSet() noexcept : bitarray_(0) {}
-  HalfWordSet(uint32_t s) : bitarray_(s) {}
+  HalfWordSet(Word s) : bitarray_(s) {}
+
+  // the largest version that a counter holds; larger ones are saturated.
+  constexpr static uint32_t MaxVersion = static_cast<uint32_t>(Max);
+  Word GetBitArray() const { return bitarray_; }
 
   void Put(const uint32_t seed, uint32_t version = 1) {
     const size_t slot = HalfWordSet::Hash(seed) % ArraySize;
@@ -91,59 +113,36 @@ class HalfWordSet {
   bool IsEmpty() const { return bitarray_ == 0; }
 
   HalfWordSet Merge(const HalfWordSet& rhs) const {
-    if (CounterSize == 1) {
+    if constexpr (CounterSize == 1) {
       return HalfWordSet(bitarray_ | rhs.bitarray_);
     } else {  // @NOTE: merge with choosing lower side
-
-      HalfWordSet bf;
-      for (size_t i = 0; i < ArraySize; i++) {
-        const uint32_t lhs_slot = bitarray_ & Masks[i];
-        const uint32_t rhs_slot = rhs.bitarray_ & Masks[i];
-        if (lhs_slot == 0 && rhs_slot == 0) continue;
-
-        if (lhs_slot == 0 || rhs_slot == 0) {
-          bf.bitarray_ |= std::max(lhs_slot, rhs_slot);
-        } else {
-          bf.bitarray_ |= std::min(lhs_slot, rhs_slot);
-        }
-      }
-
-      return bf;
+      // if the slot of any side is zero, the other one is chosen.
+      const Word lhs_nonzero = FillSlots(NonZeroSlots(bitarray_));
+      const Word rhs_nonzero = FillSlots(NonZeroSlots(rhs.bitarray_));
+      const Word lhs_less    = FillSlots(LessSlots(bitarray_, rhs.bitarray_));
+      const Word from_lhs    = (lhs_less & lhs_nonzero) | ~rhs_nonzero;
+      return HalfWordSet((bitarray_ & from_lhs) |
+                         (rhs.bitarray_ & ~from_lhs));
     }
   }
 
   // #greater_than: compare the slots.
   // if value of any side is zero, it ignores the slot.
-  // @NOTE SIMD(MMX)instruction cannot above: ignoring zero.
-  // and it does not better for geq: greater or equal than.
   constexpr inline bool IsGreaterThan(const HalfWordSet& rhs) const {
-    if (bitarray_ == 0llu || rhs.bitarray_ == 0llu) return false;
-    for (size_t i = 0; i < ArraySize; i++) {
-      const uint32_t lhs_slot = bitarray_ & Masks[i];
-      if (lhs_slot == 0) continue;
-      const uint32_t rhs_slot = rhs.bitarray_ & Masks[i];
-      if (rhs_slot == 0) continue;
-      if (lhs_slot == Masks[i]) return true;  // counter is saturated
-
-      if (rhs_slot < lhs_slot) { return true; }
-    }
-    return false;
+    const Word compared =
+        NonZeroSlots(bitarray_) & NonZeroSlots(rhs.bitarray_);
+    // a saturated counter is greater than any counter.
+    const Word saturated = ~NonZeroSlots(bitarray_ ^ Used) & High;
+    return (compared & (LessSlots(rhs.bitarray_, bitarray_) | saturated)) !=
+           0;
   }
 
   // #greater_or_eq_than: compare the slots.
   // if value of any side is zero, it ignores the slot.
   constexpr inline bool IsGreaterOrEqualThan(const HalfWordSet& rhs) const {
-    if (bitarray_ == 0llu || rhs.bitarray_ == 0llu) return false;
-    for (size_t i = 0; i < ArraySize; i++) {
-      const uint32_t lhs_slot = bitarray_ & Masks[i];
-      if (lhs_slot == 0) continue;
-      const uint32_t rhs_slot = rhs.bitarray_ & Masks[i];
-      if (rhs_slot == 0) continue;
-      if (lhs_slot == Masks[i]) return true;  // counter is saturated
-
-      if (rhs_slot <= lhs_slot) { return true; }
-    }
-    return false;
+    const Word compared =
+        NonZeroSlots(bitarray_) & NonZeroSlots(rhs.bitarray_);
+    return (compared & ~LessSlots(bitarray_, rhs.bitarray_)) != 0;
   }
 
   bool IsSameWith(const HalfWordSet& rhs) { return bitarray_ == rhs.bitarray_; }
@@ -172,13 +171,13 @@ class HalfWordSet {
   }
 
   inline uint32_t GetBySlot(const size_t slot) const {
-    return (bitarray_ >> (CounterSize * slot)) & Max;
+    return static_cast<uint32_t>((bitarray_ >> (CounterSize * slot)) & Max);
   }
 
   inline void Set(const uint32_t slot, uint32_t version) {
     Reset(slot);
-    if (Max < version) version = Max;
-    bitarray_ |= version << (CounterSize * slot);
+    if (MaxVersion < version) version = MaxVersion;
+    bitarray_ |= static_cast<Word>(version) << (CounterSize * slot);
   }
 
   static constexpr uint32_t FNV       = 2166136261lu;
@@ -198,8 +197,16 @@ class HalfWordSet {
   }
 };
 
-template <uint32_t CounterSize>
-constexpr std::array<uint32_t, HalfWordSet<CounterSize>::ArraySize>
-    HalfWordSet<CounterSize>::Masks;
+/**
+ * @brief
+ * HalfWordSet of 64 or 128 bits. The more slots that a set has, the fewer
+ * items share a slot by their hash values, and the fewer false positives
+ * the comparisons of the sets make; the sets of NWRPivotObject are narrower
+ * to fit a data item, though.
+ */
+template <const uint32_t CounterSize, const uint32_t SetSize>
+using WideHalfWordSet =
+    HalfWordSet<CounterSize, SetSize,
+                std::conditional_t<SetSize <= 64, uint64_t, unsigned __int128>>;
 
 #endif
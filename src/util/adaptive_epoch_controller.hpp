@@ -0,0 +1,104 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_ADAPTIVE_EPOCH_CONTROLLER_HPP
+#define LINEAIRDB_ADAPTIVE_EPOCH_CONTROLLER_HPP
+
+#include <algorithm>
+#include <cstdint>
+
+namespace LineairDB {
+
+/**
+ * @brief
+ * Chooses the duration of the next epoch from the commits and the bytes of
+ * logs observed in the previous epochs.
+ * A longer epoch amortizes the per-epoch work (log flushes and the jobs
+ * enqueued for all threads) only if the workers are saturated; otherwise it
+ * just delays the commits. Thus the controller climbs the commit rate: it
+ * keeps lengthening (shortening) the epoch while the commit rate increases,
+ * turns back when it decreases, and shortens the epoch when the rate is
+ * flat or there is no commit. The duration is kept within [min, max], and an
+ * epoch is shortened whenever it holds more logs than max_log_bytes.
+ */
+class AdaptiveEpochController {
+ public:
+  // The commit rate is compared over windows of at least this length.
+  static constexpr uint64_t WindowNs    = 100 * 1000 * 1000;
+  static constexpr double Step          = 1.25;
+  static constexpr double RateTolerance = 0.02;
+
+  AdaptiveEpochController(uint64_t initial_ns, uint64_t min_ns,
+                          uint64_t max_ns, uint64_t max_log_bytes)
+      : min_ns_(std::max<uint64_t>(1, min_ns)),
+        max_ns_(std::max(min_ns_, max_ns)),
+        max_log_bytes_(max_log_bytes),
+        duration_ns_(std::clamp(initial_ns, min_ns_, max_ns_)),
+        lengthening_(true),
+        previous_rate_(0),
+        window_ns_(0),
+        window_epochs_(0),
+        window_commits_(0),
+        window_log_bytes_(0) {}
+
+  /**
+   * @brief Observes an epoch that has lasted `elapsed_ns`, in which
+   * `commits` transactions have committed and written `log_bytes`.
+   * @return the duration of the next epoch in nanoseconds.
+   */
+  uint64_t Observe(uint64_t commits, uint64_t log_bytes, uint64_t elapsed_ns) {
+    window_ns_ += elapsed_ns;
+    window_epochs_++;
+    window_commits_ += commits;
+    window_log_bytes_ += log_bytes;
+    if (window_ns_ < std::max(WindowNs, 4 * duration_ns_)) return duration_ns_;
+
+    const double rate = static_cast<double>(window_commits_) / window_ns_;
+    const bool overflowing =
+        max_log_bytes_ < window_log_bytes_ / window_epochs_;
+    if (overflowing || window_commits_ == 0) {
+      lengthening_ = false;
+    } else if (rate < previous_rate_ * (1 - RateTolerance)) {
+      lengthening_ = !lengthening_;
+    } else if (rate <= previous_rate_ * (1 + RateTolerance)) {
+      lengthening_ = false;
+    }
+    previous_rate_ = rate;
+
+    const double next =
+        lengthening_ ? duration_ns_ * Step : duration_ns_ / Step;
+    duration_ns_ = std::clamp(static_cast<uint64_t>(next), min_ns_, max_ns_);
+    window_ns_ = window_epochs_ = window_commits_ = window_log_bytes_ = 0;
+    return duration_ns_;
+  }
+
+  uint64_t GetDuration() const { return duration_ns_; }
+
+ private:
+  const uint64_t min_ns_;
+  const uint64_t max_ns_;
+  const uint64_t max_log_bytes_;
+  uint64_t duration_ns_;
+  bool lengthening_;
+  double previous_rate_;
+  uint64_t window_ns_;
+  uint64_t window_epochs_;
+  uint64_t window_commits_;
+  uint64_t window_log_bytes_;
+};
+
+}  // namespace LineairDB
+#endif /* LINEAIRDB_ADAPTIVE_EPOCH_CONTROLLER_HPP */
@@ -27,7 +27,8 @@ namespace Util {
 static inline bool RetryWithExponentialBackoff(std::function<bool()>&& f,
                                                size_t sleep_ns         = 100,
                                                size_t yield_threshold  = 100,
-                                               size_t retire_threshold = 0) {
+                                               size_t retire_threshold = 0,
+                                               size_t max_sleep_ns     = 0) {
   size_t try_count = 0;
   for (;;) {
     if (f()) return true;
@@ -36,6 +37,7 @@ static inline bool RetryWithExponentialBackoff(std::function<bool()>&& f,
     if (yield_threshold < try_count) {
       std::this_thread::sleep_for(std::chrono::nanoseconds(sleep_ns));
       sleep_ns *= 2;
+      if (0 < max_sleep_ns && max_sleep_ns < sleep_ns) sleep_ns = max_sleep_ns;
     } else {
       std::this_thread::yield();
     }
@@ -0,0 +1,67 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_CHECKSUM_HPP
+#define LINEAIRDB_CHECKSUM_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#endif
+
+namespace LineairDB {
+namespace Util {
+
+/**
+ * @brief
+ * Computes CRC-32C (Castagnoli) of `size` bytes from `data`.
+ * A checksum of a large buffer can be computed piecewise by passing the
+ * result of the former part as `crc`.
+ */
+static inline uint32_t Crc32c(const void* data, size_t size,
+                              uint32_t crc = 0) {
+  const auto* p = static_cast<const unsigned char*>(data);
+  crc           = ~crc;
+#if defined(__SSE4_2__)
+  for (; 8 <= size; p += 8, size -= 8) {
+    uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    crc = static_cast<uint32_t>(_mm_crc32_u64(crc, word));
+  }
+  for (; 0 < size; p++, size--) crc = _mm_crc32_u8(crc, *p);
+#else
+  static const auto table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0x82F63B78u & (0u - (c & 1)));
+      t[i] = c;
+    }
+    return t;
+  }();
+  for (; 0 < size; p++, size--) crc = table[(crc ^ *p) & 0xff] ^ (crc >> 8);
+#endif
+  return ~crc;
+}
+
+}  // namespace Util
+}  // namespace LineairDB
+
+#endif /* LINEAIRDB_CHECKSUM_HPP */
@@ -20,9 +20,13 @@
 #include <assert.h>
 
 #include <atomic>
+#include <chrono>
+#include <functional>
 #include <thread>
+#include <vector>
 
-#include "util/thread_key_storage.h"
+#include "types/definitions.h"
+#include "util/thread_slots.hpp"
 
 namespace LineairDB {
 
@@ -49,39 +53,40 @@ class EpochFramework {
       : start_(false),
         stop_(false),
         global_epoch_(1),
-        epoch_writer_([=]() { EpochWriterJob(epoch_duration_ms); }) {}
+        epoch_duration_ns_(epoch_duration_ms * 1000 * 1000),
+        epoch_writer_([=]() { EpochWriterJob(); }) {}
   EpochFramework(size_t epoch_duration_ms,
                  std::function<void(EpochNumber)>&& pt)
       : start_(false),
         stop_(false),
         global_epoch_(1),
+        epoch_duration_ns_(epoch_duration_ms * 1000 * 1000),
         publish_target_(pt),
-        epoch_writer_([=]() { EpochWriterJob(epoch_duration_ms); }) {}
+        epoch_writer_([=]() { EpochWriterJob(); }) {}
 
-  ~EpochFramework() { Stop(); }
+  ~EpochFramework() {
+    Stop();
+    ForEachSlot([](Slot& slot) {
+      for (auto& retired : slot.retired) retired.deleter(retired.object);
+    });
+  }
 
   void SetGlobalEpoch(const EpochNumber epoch) { global_epoch_.store(epoch); }
 
   EpochNumber GetGlobalEpoch() const { return global_epoch_.load(); }
-  EpochNumber& GetMyThreadLocalEpoch() {
-    EpochNumber* my_epoch =
-        tls_.Get<EpochNumber>([]() { return THREAD_OFFLINE; });
-    return *my_epoch;
-  }
+  EpochNumber& GetMyThreadLocalEpoch() { return GetMySlot().epoch; }
 
   EpochNumber MakeMeOnline() {
-    EpochNumber* my_epoch =
-        tls_.Get<EpochNumber>([]() { return THREAD_OFFLINE; });
-    assert(*my_epoch == THREAD_OFFLINE);
-    *my_epoch = GetGlobalEpoch();
-    return *my_epoch;
+    EpochNumber& my_epoch = GetMySlot().epoch;
+    assert(my_epoch == THREAD_OFFLINE);
+    my_epoch = GetGlobalEpoch();
+    return my_epoch;
   }
 
   void MakeMeOffline() {
-    EpochNumber* my_epoch =
-        tls_.Get<EpochNumber>([]() { return THREAD_OFFLINE; });
-    assert(*my_epoch != THREAD_OFFLINE);
-    *my_epoch = THREAD_OFFLINE;
+    EpochNumber& my_epoch = GetMySlot().epoch;
+    assert(my_epoch != THREAD_OFFLINE);
+    my_epoch = THREAD_OFFLINE;
   }
 
   EpochNumber Sync() {
@@ -106,6 +111,58 @@ class EpochFramework {
     }
   }
 
+  /**
+   * @brief
+   * Deletes `object` with `deleter` after every thread that may have accessed
+   * it has left the epoch, i.e., two epochs after this call.
+   * The object is reclaimed by the callee thread on its subsequent calls, or
+   * at the destruction of this framework.
+   */
+  void Retire(void* object, void (*deleter)(void*)) {
+    auto* list        = &GetMySlot().retired;
+    const auto global = GetGlobalEpoch();
+    list->push_back({global, object, deleter});
+
+    auto it = list->begin();
+    while (it != list->end() && it->epoch + 2 <= global) {
+      it->deleter(it->object);
+      it++;
+    }
+    list->erase(list->begin(), it);
+  }
+
+  /**
+   * @brief
+   * Returns the newest epoch whose transactions have all terminated, while a
+   * thread belongs to `epoch`: since the global epoch is incremented only
+   * when all threads have reached it, no thread remains two epochs behind.
+   */
+  static EpochNumber GetCompletedEpoch(const EpochNumber epoch) {
+    return epoch < 2 ? 0 : epoch - 2;
+  }
+
+  /**
+   * @brief
+   * Returns a lower bound of the epochs of the running and future threads,
+   * which the epoch writer updates with #GetSmallestEpoch at every epoch.
+   * Unlike #GetSmallestEpoch, it does not iterate over the threads.
+   */
+  EpochNumber GetOldestActiveEpoch() const {
+    return oldest_active_epoch_.load();
+  }
+
+  /**
+   * @brief
+   * Changes the duration of the following epochs; e.g., the publish target
+   * may call it to adapt the duration to the workload.
+   */
+  void SetEpochDuration(const uint64_t epoch_duration_ns) {
+    epoch_duration_ns_.store(epoch_duration_ns, std::memory_order_relaxed);
+  }
+  uint64_t GetEpochDuration() const {
+    return epoch_duration_ns_.load(std::memory_order_relaxed);
+  }
+
   void Start() { start_.store(true); }
   void Stop() {
     stop_.store(true);
@@ -115,22 +172,24 @@ class EpochFramework {
  public:
   uint32_t GetSmallestEpoch() {
     uint32_t min_epoch = THREAD_OFFLINE;
-    tls_.ForEach([&](const EpochNumber* local_epoch) {
-      const EpochNumber e = *local_epoch;
+    ForEachSlot([&](const Slot& slot) {
+      const EpochNumber e = slot.epoch;
       if (0 < e && e < min_epoch) { min_epoch = e; }
     });
 
     return min_epoch;
   }
 
-  void EpochWriterJob(size_t epoch_duration_ms) {
-    const uint64_t epoch_duration = epoch_duration_ms * 1000 * 1000;
+  void EpochWriterJob() {
     while (!start_.load()) std::this_thread::yield();
 
     for (;;) {
-      std::this_thread::sleep_for(std::chrono::nanoseconds(epoch_duration));
+      std::this_thread::sleep_for(
+          std::chrono::nanoseconds(GetEpochDuration()));
       EpochNumber min_epoch = GetSmallestEpoch();
       EpochNumber old_epoch = global_epoch_;
+      oldest_active_epoch_.store(min_epoch == THREAD_OFFLINE ? old_epoch
+                                                             : min_epoch);
       if (min_epoch == THREAD_OFFLINE || min_epoch == old_epoch) {
         EpochNumber updated = global_epoch_.fetch_add(1);
         if (publish_target_) publish_target_(updated);
@@ -140,12 +199,33 @@ class EpochFramework {
   }
 
  private:
+  struct RetiredObject {
+    EpochNumber epoch;
+    void* object;
+    void (*deleter)(void*);
+  };
+  using RetiredList = std::vector<RetiredObject>;
+
+  struct Slot {
+    EpochNumber epoch = THREAD_OFFLINE;
+    RetiredList retired;
+  };
+
+  Slot& GetMySlot() { return slots_.Get(); }
+
+  template <class F>
+  void ForEachSlot(F&& f) {
+    slots_.ForEach(std::forward<F>(f));
+  }
+
+  ThreadSlots<Slot> slots_;
   std::atomic<bool> start_;
   std::atomic<bool> stop_;
   std::atomic<EpochNumber> global_epoch_;
+  std::atomic<EpochNumber> oldest_active_epoch_{0};
+  std::atomic<uint64_t> epoch_duration_ns_;
   const std::function<void(EpochNumber)> publish_target_;
   std::thread epoch_writer_;
-  ThreadKeyStorage<EpochNumber> tls_;
 };
 
 }  // namespace LineairDB
@@ -0,0 +1,105 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_EVENT_COUNT_HPP
+#define LINEAIRDB_EVENT_COUNT_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace LineairDB {
+
+/**
+ * @brief
+ * Lets threads sleep until a condition, that the other threads make true,
+ * holds. A waiter checks the condition between #PrepareWait and #Wait, and a
+ * notifier makes the condition true before #Notify; then no notification is
+ * lost, and #Notify costs a fence when there is no waiter.
+ * The waiters sleep on a futex on Linux.
+ * @see folly::EventCount, of which this is a simplified version.
+ */
+class EventCount {
+ public:
+  using Key = uint32_t;
+
+  EventCount() : epoch_(0), waiters_(0) {}
+
+  Key PrepareWait() {
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    return epoch_.load(std::memory_order_acquire);
+  }
+
+  void CancelWait() { waiters_.fetch_sub(1, std::memory_order_relaxed); }
+
+  /**
+   * @brief
+   * Sleeps until a #Notify after the #PrepareWait that returned `key`, or
+   * until `timeout` elapses.
+   */
+  void Wait(const Key key, const std::chrono::microseconds timeout) {
+#if defined(__linux__)
+    if (epoch_.load(std::memory_order_acquire) == key) {
+      struct timespec ts;
+      ts.tv_sec  = timeout.count() / 1000000;
+      ts.tv_nsec = (timeout.count() % 1000000) * 1000;
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_),
+              FUTEX_WAIT_PRIVATE, key, &ts, nullptr, 0);
+    }
+#else
+    std::unique_lock<std::mutex> lock(lock_);
+    cv_.wait_for(lock, timeout, [&]() { return epoch_.load() != key; });
+#endif
+    waiters_.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void Notify() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_relaxed) == 0) return;
+#if defined(__linux__)
+    epoch_.fetch_add(1, std::memory_order_release);
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAKE_PRIVATE,
+            INT32_MAX, nullptr, nullptr, 0);
+#else
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      epoch_.fetch_add(1, std::memory_order_release);
+    }
+    cv_.notify_all();
+#endif
+  }
+
+ private:
+  std::atomic<Key> epoch_;
+  std::atomic<uint32_t> waiters_;
+#if !defined(__linux__)
+  std::mutex lock_;
+  std::condition_variable cv_;
+#endif
+};
+
+}  // namespace LineairDB
+#endif /* LINEAIRDB_EVENT_COUNT_HPP */
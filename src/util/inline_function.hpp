@@ -0,0 +1,125 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_INLINE_FUNCTION_HPP
+#define LINEAIRDB_INLINE_FUNCTION_HPP
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace LineairDB {
+
+/**
+ * @brief
+ * A move-only `void()` function object that stores callables of up to
+ * `Capacity` bytes in itself. Unlike std::function, whose small buffer holds
+ * only two pointers, it does not allocate for the lambdas that capture a few
+ * std::functions, e.g., the jobs of the thread pool. Larger callables are
+ * stored on the heap.
+ */
+template <size_t Capacity>
+class InlineFunction {
+  static_assert(sizeof(void*) <= Capacity);
+
+ public:
+  InlineFunction() noexcept : ops_(nullptr) {}
+  template <typename F, typename = std::enable_if_t<!std::is_same_v<
+                            std::decay_t<F>, InlineFunction>>>
+  InlineFunction(F&& f) {
+    Construct<std::decay_t<F>>(std::forward<F>(f));
+  }
+  InlineFunction(InlineFunction&& rhs) noexcept : ops_(nullptr) {
+    MoveFrom(rhs);
+  }
+  InlineFunction& operator=(InlineFunction&& rhs) noexcept {
+    if (this != &rhs) {
+      Reset();
+      MoveFrom(rhs);
+    }
+    return *this;
+  }
+  InlineFunction(const InlineFunction&) = delete;
+  InlineFunction& operator=(const InlineFunction&) = delete;
+  ~InlineFunction() { Reset(); }
+
+  void operator()() { ops_->invoke(storage_); }
+  explicit operator bool() const noexcept { return ops_ != nullptr; }
+
+ private:
+  struct Ops {
+    void (*invoke)(void*);
+    void (*move)(void* from, void* to);
+    void (*destroy)(void*);
+  };
+
+  template <typename F>
+  static constexpr bool IsInline =
+      sizeof(F) <= Capacity && alignof(F) <= alignof(void*) &&
+      std::is_nothrow_move_constructible_v<F>;
+
+  template <typename F>
+  struct InlineOps {
+    static void Invoke(void* p) { (*static_cast<F*>(p))(); }
+    static void Move(void* from, void* to) {
+      new (to) F(std::move(*static_cast<F*>(from)));
+      static_cast<F*>(from)->~F();
+    }
+    static void Destroy(void* p) { static_cast<F*>(p)->~F(); }
+    static constexpr Ops ops{Invoke, Move, Destroy};
+  };
+
+  template <typename F>
+  struct HeapOps {
+    static void Invoke(void* p) { (**static_cast<F**>(p))(); }
+    static void Move(void* from, void* to) {
+      *static_cast<F**>(to) = *static_cast<F**>(from);
+    }
+    static void Destroy(void* p) { delete *static_cast<F**>(p); }
+    static constexpr Ops ops{Invoke, Move, Destroy};
+  };
+
+  template <typename F, typename Arg>
+  void Construct(Arg&& f) {
+    if constexpr (IsInline<F>) {
+      new (storage_) F(std::forward<Arg>(f));
+      ops_ = &InlineOps<F>::ops;
+    } else {
+      *reinterpret_cast<F**>(storage_) = new F(std::forward<Arg>(f));
+      ops_ = &HeapOps<F>::ops;
+    }
+  }
+
+  void MoveFrom(InlineFunction& rhs) noexcept {
+    if (rhs.ops_ == nullptr) return;
+    rhs.ops_->move(rhs.storage_, storage_);
+    ops_     = rhs.ops_;
+    rhs.ops_ = nullptr;
+  }
+
+  void Reset() noexcept {
+    if (ops_ == nullptr) return;
+    ops_->destroy(storage_);
+    ops_ = nullptr;
+  }
+
+  alignas(void*) unsigned char storage_[Capacity];
+  const Ops* ops_;
+};
+
+}  // namespace LineairDB
+#endif /* LINEAIRDB_INLINE_FUNCTION_HPP */
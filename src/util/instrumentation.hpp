@@ -0,0 +1,242 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_INSTRUMENTATION_HPP
+#define LINEAIRDB_INSTRUMENTATION_HPP
+
+#include <lineairdb/statistics.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "util/thread_slots.hpp"
+
+namespace LineairDB {
+
+/**
+ * @brief
+ * The probes that measure the phases of transaction processing and count the
+ * causes of aborts, for Database::GetStatistics. They are compiled out unless
+ * LINEAIRDB_ENABLE_INSTRUMENTATION is defined; then each thread records into
+ * its own histograms and counters, without atomic read-modify-writes.
+ */
+namespace Instrumentation {
+
+#if defined(LINEAIRDB_ENABLE_INSTRUMENTATION)
+constexpr bool Enabled = true;
+#else
+constexpr bool Enabled = false;
+#endif
+
+/**
+ * @brief
+ * A log-linear histogram in the manner of HdrHistogram [1]: a value below
+ * SubBuckets is counted exactly, and a value in [2^e, 2^(e+1)) falls into
+ * one of SubBuckets buckets of the same width. The values above
+ * 2^(MaxExponent+1) are counted in the last bucket.
+ * Only the owner thread records values.
+ * @ref [1] http://hdrhistogram.org/
+ */
+class Histogram {
+ public:
+  static constexpr size_t SubBucketBits = 4;
+  static constexpr size_t SubBuckets    = 1 << SubBucketBits;
+  static constexpr size_t MaxExponent   = 40;  // about 36 minutes in ns
+  static constexpr size_t Buckets =
+      (MaxExponent - SubBucketBits + 2) * SubBuckets;
+
+  void Record(uint64_t value, const uint64_t count = 1) {
+    value = std::min(value, (uint64_t{1} << (MaxExponent + 1)) - 1);
+    Add(buckets_[BucketOf(value)], count);
+    Add(count_, count);
+    Add(sum_, value * count);
+    if (max_.load(std::memory_order_relaxed) < value) {
+      max_.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  static size_t BucketOf(const uint64_t value) {
+    if (value < SubBuckets) return value;
+    const size_t exponent = 63 - __builtin_clzll(value);
+    const size_t shift    = exponent - SubBucketBits;
+    return (shift + 1) * SubBuckets + ((value >> shift) - SubBuckets);
+  }
+  // the highest value counted in `bucket`.
+  static uint64_t HighestValueOf(const size_t bucket) {
+    if (bucket < SubBuckets) return bucket;
+    const size_t shift = bucket / SubBuckets - 1;
+    const uint64_t sub = bucket % SubBuckets + SubBuckets;
+    return ((sub + 1) << shift) - 1;
+  }
+
+  /**
+   * @brief The sum of the histograms of the threads.
+   */
+  struct Merged {
+    std::array<uint64_t, Buckets> buckets{};
+    uint64_t count = 0;
+    uint64_t sum   = 0;
+    uint64_t max   = 0;
+
+    void Add(const Histogram& histogram) {
+      for (size_t i = 0; i < Buckets; i++) {
+        buckets[i] += histogram.buckets_[i].load(std::memory_order_relaxed);
+      }
+      count += histogram.count_.load(std::memory_order_relaxed);
+      sum += histogram.sum_.load(std::memory_order_relaxed);
+      max = std::max(max, histogram.max_.load(std::memory_order_relaxed));
+    }
+
+    uint64_t Percentile(const double percentile) const {
+      const auto rank = static_cast<uint64_t>(count * percentile / 100);
+      uint64_t seen   = 0;
+      for (size_t i = 0; i < Buckets; i++) {
+        seen += buckets[i];
+        if (rank < seen) return std::min(HighestValueOf(i), max);
+      }
+      return max;
+    }
+
+    Statistics::Latency Summarize() const {
+      Statistics::Latency latency;
+      latency.count   = count;
+      latency.mean_ns = count == 0 ? 0 : static_cast<double>(sum) / count;
+      latency.p50_ns  = Percentile(50);
+      latency.p90_ns  = Percentile(90);
+      latency.p99_ns  = Percentile(99);
+      latency.p999_ns = Percentile(99.9);
+      latency.max_ns  = max;
+      return latency;
+    }
+  };
+
+ private:
+  static void Add(std::atomic<uint64_t>& counter, const uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic<uint64_t>, Buckets> buckets_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> sum_{0};
+  std::atomic<uint64_t> max_{0};
+};
+
+struct ThreadCounters {
+  std::array<Histogram, Statistics::NumberOfPhases> histograms;
+  std::array<std::atomic<uint64_t>, Statistics::NumberOfAbortReasons>
+      aborts{};
+  std::atomic<uint64_t> nwr_omittable_checks{0};
+  std::atomic<uint64_t> nwr_omitted{0};
+};
+
+// NOTE: never destroyed; the threads may record until the exit.
+inline ThreadSlots<ThreadCounters>& Counters() {
+  static auto* counters = new ThreadSlots<ThreadCounters>();
+  return *counters;
+}
+
+inline void Increment(std::atomic<uint64_t>& counter) {
+  counter.store(counter.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+}
+
+// returns 0 if the instrumentation is disabled.
+inline uint64_t Now() {
+  if constexpr (Enabled) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+  return 0;
+}
+
+/**
+ * @brief Records the time elapsed since `begin_ns` (see #Now) for `count`
+ * events of `phase`.
+ */
+inline void Record(const Statistics::Phase phase, const uint64_t begin_ns,
+                   const uint64_t count = 1) {
+  if constexpr (Enabled) {
+    const uint64_t now = Now();
+    Counters().Get().histograms[phase].Record(
+        begin_ns < now ? now - begin_ns : 0, count);
+  }
+}
+
+inline void CountAbort(const Statistics::AbortReason reason) {
+  if constexpr (Enabled) Increment(Counters().Get().aborts[reason]);
+}
+
+inline void CountOmittableCheck(const bool omitted) {
+  if constexpr (Enabled) {
+    auto& counters = Counters().Get();
+    Increment(counters.nwr_omittable_checks);
+    if (omitted) Increment(counters.nwr_omitted);
+  }
+}
+
+/**
+ * @brief Records the lifetime of this object as a latency of `phase`.
+ */
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(const Statistics::Phase phase)
+      : phase_(phase), begin_(Now()) {}
+  ~ScopedTimer() { Record(phase_, begin_); }
+  ScopedTimer(const ScopedTimer&) = delete;
+  ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+ private:
+  const Statistics::Phase phase_;
+  const uint64_t begin_;
+};
+
+/**
+ * @brief Sums up the histograms and the counters of all the threads.
+ */
+inline void Collect(Statistics& statistics) {
+  statistics.instrumented = Enabled;
+  if constexpr (!Enabled) return;
+  auto merged = std::make_unique<
+      std::array<Histogram::Merged, Statistics::NumberOfPhases>>();
+  Counters().ForEach([&](const ThreadCounters& counters) {
+    for (size_t phase = 0; phase < Statistics::NumberOfPhases; phase++) {
+      (*merged)[phase].Add(counters.histograms[phase]);
+    }
+    for (size_t reason = 0; reason < Statistics::NumberOfAbortReasons;
+         reason++) {
+      statistics.aborts[reason] +=
+          counters.aborts[reason].load(std::memory_order_relaxed);
+    }
+    statistics.nwr_omittable_checks +=
+        counters.nwr_omittable_checks.load(std::memory_order_relaxed);
+    statistics.nwr_omitted +=
+        counters.nwr_omitted.load(std::memory_order_relaxed);
+  });
+  for (size_t phase = 0; phase < Statistics::NumberOfPhases; phase++) {
+    statistics.latencies[phase] = (*merged)[phase].Summarize();
+  }
+}
+
+}  // namespace Instrumentation
+}  // namespace LineairDB
+#endif /* LINEAIRDB_INSTRUMENTATION_HPP */
@@ -0,0 +1,70 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+
+#ifndef LINEAIRDB_MEMORY_STATISTICS_HPP
+#define LINEAIRDB_MEMORY_STATISTICS_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "util/thread_slots.hpp"
+
+namespace LineairDB {
+
+/**
+ * @brief
+ * Process-wide counters of the bytes of the heap areas allocated for values.
+ * Each thread updates its own counters without atomic read-modify-writes, and
+ * #Get sums them up. Since a thread may free an area that another thread has
+ * allocated, the counter of a thread may be negative, but the sum is not.
+ */
+class MemoryStatistics {
+ public:
+  enum Category : size_t {
+    Values,          // DataBuffer, except for the stable versions
+    StableVersions,  // DataItem::checkpoint_buffer
+    NumberOfCategories
+  };
+
+  static void Add(const Category category, const int64_t bytes) {
+    auto& counter = Slots().Get()[category];
+    counter.store(counter.load(std::memory_order_relaxed) + bytes,
+                  std::memory_order_relaxed);
+  }
+
+  static size_t Get(const Category category) {
+    int64_t sum = 0;
+    Slots().ForEach([&](const Counters& counters) {
+      sum += counters[category].load(std::memory_order_relaxed);
+    });
+    return 0 < sum ? static_cast<size_t>(sum) : 0;
+  }
+
+ private:
+  using Counters = std::array<std::atomic<int64_t>, NumberOfCategories>;
+
+  // NOTE: never destroyed; the buffers of static objects are freed at exit.
+  static ThreadSlots<Counters>& Slots() {
+    static auto* slots = new ThreadSlots<Counters>();
+    return *slots;
+  }
+};
+
+}  // namespace LineairDB
+#endif /* LINEAIRDB_MEMORY_STATISTICS_HPP */
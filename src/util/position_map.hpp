@@ -0,0 +1,103 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_UTIL_POSITION_MAP_HPP
+#define LINEAIRDB_UTIL_POSITION_MAP_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace LineairDB {
+
+/**
+ * @brief
+ * Finds the position of an element in a vector by its key.
+ * While the vector is small, it simply scans the vector. Once the vector
+ * exceeds LinearSearchThreshold, it indexes the elements with an
+ * open-addressing table of positions; the table does not copy the keys, and
+ * the elements appended to the vector are indexed lazily by #Find.
+ * @note Call #Clear when the vector is reordered or shrunk.
+ * @tparam KeyOf a function object which returns the key of an element.
+ */
+template <typename Key, typename KeyOf, typename Hash = std::hash<Key>,
+          size_t LinearSearchThreshold = 16>
+class PositionMap {
+ public:
+  static constexpr size_t npos = SIZE_MAX;
+
+  template <typename T>
+  size_t Find(const std::vector<T>& elements, const Key& key) {
+    KeyOf key_of;
+    if (elements.size() <= LinearSearchThreshold) {
+      for (size_t i = 0; i < elements.size(); i++) {
+        if (key_of(elements[i]) == key) return i;
+      }
+      return npos;
+    }
+
+    if (elements.size() < indexed_ ||
+        slots_.size() < elements.size() * 2) {
+      Rebuild(elements);
+    }
+    for (; indexed_ < elements.size(); indexed_++) {
+      Insert(Hash()(key_of(elements[indexed_])), indexed_);
+    }
+
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = Hash()(key) & mask;; slot = (slot + 1) & mask) {
+      const auto position = slots_[slot];
+      if (position == Empty) return npos;
+      if (key_of(elements[position]) == key) return position;
+    }
+  }
+
+  /**
+   * @brief Forgets all the positions. The table keeps its capacity.
+   */
+  void Clear() {
+    if (indexed_ == 0) return;
+    std::fill(slots_.begin(), slots_.end(), Empty);
+    indexed_ = 0;
+  }
+
+ private:
+  static constexpr uint32_t Empty = UINT32_MAX;
+
+  template <typename T>
+  void Rebuild(const std::vector<T>& elements) {
+    size_t capacity = slots_.empty() ? 64 : slots_.size();
+    while (capacity < elements.size() * 4) capacity *= 2;
+    slots_.assign(capacity, Empty);
+    indexed_ = 0;
+  }
+
+  void Insert(const size_t hash, const size_t position) {
+    const size_t mask = slots_.size() - 1;
+    size_t slot       = hash & mask;
+    while (slots_[slot] != Empty) slot = (slot + 1) & mask;
+    slots_[slot] = static_cast<uint32_t>(position);
+  }
+
+  std::vector<uint32_t> slots_;
+  size_t indexed_ = 0;
+};
+
+}  // namespace LineairDB
+
+#endif /* LINEAIRDB_UTIL_POSITION_MAP_HPP */
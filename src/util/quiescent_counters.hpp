@@ -0,0 +1,123 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_QUIESCENT_COUNTERS_HPP
+#define LINEAIRDB_QUIESCENT_COUNTERS_HPP
+
+#include <assert.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "util/thread_slots.hpp"
+
+#if defined(__linux__)
+#include <linux/membarrier.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace LineairDB {
+
+/**
+ * @brief
+ * Per-thread counters for the reclamation of objects shared by readers,
+ * without a background thread.
+ * A reader increments its own counter when it enters a read-side critical
+ * section (the counter becomes odd) and when it exits (even); the writer
+ * unpublishes an object and then calls #WaitForReaders, which returns when
+ * every reader that was in a critical section has exited it, so that the
+ * object may be deleted.
+ * The store-load ordering between a reader's counter and its reads of the
+ * shared objects is ensured by the writer, via membarrier(2), where it is
+ * available; the read side is then two plain stores into the cache line of
+ * the reader. Otherwise the readers issue a full fence at the entry.
+ * @see [URCU]: https://dl.acm.org/doi/10.1109/TPDS.2011.159
+ */
+class QuiescentCounters {
+ public:
+  QuiescentCounters() : asymmetric_(RegisterMembarrier()) {}
+
+  void Enter() {
+    auto& counter       = counters_.Get();
+    const uint64_t next = counter.load(std::memory_order_relaxed) + 1;
+    assert(next % 2 == 1);  // critical sections do not nest
+    counter.store(next, std::memory_order_relaxed);
+    if (asymmetric_) {
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+    } else {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+  }
+
+  void Exit() {
+    auto& counter = counters_.Get();
+    counter.store(counter.load(std::memory_order_relaxed) + 1,
+                  std::memory_order_release);
+  }
+
+  /**
+   * @brief
+   * Waits for the readers that are in a critical section. The callee must
+   * not be in a critical section.
+   */
+  void WaitForReaders() {
+    Barrier();
+    std::vector<std::pair<const std::atomic<uint64_t>*, uint64_t>> readers;
+    counters_.ForEach([&](const std::atomic<uint64_t>& counter) {
+      const uint64_t c = counter.load(std::memory_order_acquire);
+      if (c % 2 == 1) readers.emplace_back(&counter, c);
+    });
+    for (auto& [counter, c] : readers) {
+      while (counter->load(std::memory_order_acquire) == c) {
+        std::this_thread::yield();
+      }
+    }
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+ private:
+  // Orders the stores of the running readers, if they do not fence.
+  void Barrier() {
+#if defined(__linux__)
+    if (asymmetric_) {
+      syscall(__NR_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0);
+      return;
+    }
+#endif
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+
+  static bool RegisterMembarrier() {
+#if defined(__linux__)
+    static const bool registered =
+        syscall(__NR_membarrier, MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED,
+                0) == 0;
+    return registered;
+#else
+    return false;
+#endif
+  }
+
+  const bool asymmetric_;
+  ThreadSlots<std::atomic<uint64_t>> counters_;
+};
+
+}  // namespace LineairDB
+#endif /* LINEAIRDB_QUIESCENT_COUNTERS_HPP */
@@ -0,0 +1,165 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#ifndef LINEAIRDB_THREAD_SLOTS_HPP
+#define LINEAIRDB_THREAD_SLOTS_HPP
+
+#include <pthread.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+namespace LineairDB {
+
+/**
+ * @brief
+ * A `Slot` for each thread, on its own cache line. The slots are registered
+ * in chunks that are never moved, so that #ForEach scans them as arrays, and
+ * each thread caches its slots in a thread_local array without calling
+ * pthread_getspecific.
+ * When a thread exits, its slot is put into a free list as it is, and a
+ * thread registered later reuses it; thus the owner of the slots has to keep
+ * the slot of a thread in the state of an idle thread whenever the thread
+ * may exit. The slots are freed only with the owner.
+ */
+template <typename Slot>
+class ThreadSlots {
+ public:
+  static constexpr size_t SlotsPerChunk = 64;
+  static constexpr size_t MaxChunks     = 1024;
+
+  ThreadSlots() : id_(InstanceCounter.fetch_add(1) + 1), number_of_slots_(0) {
+    int err = ::pthread_key_create(&slot_of_thread_, &ReleaseSlot);
+    if (err != 0) {
+      std::cerr << "::pthread_key_create failed: " << err << std::endl;
+      exit(EXIT_FAILURE);
+    }
+  }
+  ~ThreadSlots() {
+    // NOTE: the threads that exit after this point do not release the slots.
+    ::pthread_key_delete(slot_of_thread_);
+    for (auto& chunk : chunks_) delete[] chunk.load();
+  }
+
+  Slot& Get() {
+    for (auto& entry : MySlotCache.entries) {
+      if (entry.owner_id == id_) return entry.slot->value;
+    }
+    return CacheMySlot();
+  }
+
+  template <class F>
+  void ForEach(F&& f) {
+    const size_t slots = number_of_slots_.load(std::memory_order_acquire);
+    for (size_t chunk = 0; chunk * SlotsPerChunk < slots; chunk++) {
+      Padded* slot_array = chunks_[chunk].load(std::memory_order_relaxed);
+      const size_t end = std::min(SlotsPerChunk, slots - chunk * SlotsPerChunk);
+      for (size_t i = 0; i < end; i++) f(slot_array[i].value);
+    }
+  }
+
+ private:
+  struct alignas(64) Padded {
+    Slot value;
+    ThreadSlots* owner;
+  };
+
+  // The slots of the owners that a thread has used most recently.
+  struct SlotCache {
+    static constexpr size_t Size = 4;
+    struct Entry {
+      uint64_t owner_id;
+      Padded* slot;
+    };
+    Entry entries[Size];
+    size_t next;
+  };
+  inline static thread_local SlotCache MySlotCache;
+  // Ids are never reused, so that a cached slot of a destroyed owner is never
+  // taken for the one of a new owner at the same address.
+  inline static std::atomic<uint64_t> InstanceCounter{0};
+
+  Slot& CacheMySlot() {
+    auto* my_slot =
+        static_cast<Padded*>(::pthread_getspecific(slot_of_thread_));
+    if (my_slot == nullptr) {
+      my_slot = RegisterSlot();
+      if (::pthread_setspecific(slot_of_thread_, my_slot) != 0) {
+        std::cerr << "::pthread_setspecific failed" << std::endl;
+        exit(EXIT_FAILURE);
+      }
+    }
+    auto& entry = MySlotCache.entries[MySlotCache.next++ % SlotCache::Size];
+    entry.owner_id = id_;
+    entry.slot     = my_slot;
+    return my_slot->value;
+  }
+
+  /**
+   * @brief The destructor of the thread-specific key, which is called by an
+   * exiting thread that has a slot.
+   */
+  static void ReleaseSlot(void* slot) {
+    auto* padded = static_cast<Padded*>(slot);
+    auto* owner  = padded->owner;
+    // the slot must not be used via the cache, e.g., by the destructors of
+    // the other keys.
+    for (auto& entry : MySlotCache.entries) {
+      if (entry.owner_id == owner->id_) entry = {0, nullptr};
+    }
+    std::lock_guard<std::mutex> guard(owner->slot_lock_);
+    owner->free_slots_.push_back(padded);
+  }
+
+  Padded* RegisterSlot() {
+    std::lock_guard<std::mutex> guard(slot_lock_);
+    if (!free_slots_.empty()) {
+      Padded* slot = free_slots_.back();
+      free_slots_.pop_back();
+      return slot;
+    }
+    const size_t index = number_of_slots_.load();
+    const size_t chunk = index / SlotsPerChunk;
+    if (MaxChunks <= chunk) {
+      std::cerr << "ThreadSlots: too many running threads" << std::endl;
+      exit(EXIT_FAILURE);
+    }
+    if (index % SlotsPerChunk == 0) {
+      chunks_[chunk].store(new Padded[SlotsPerChunk]());
+    }
+    Padded* slot = &chunks_[chunk].load()[index % SlotsPerChunk];
+    slot->owner  = this;
+    number_of_slots_.store(index + 1, std::memory_order_release);
+    return slot;
+  }
+
+  const uint64_t id_;
+  std::array<std::atomic<Padded*>, MaxChunks> chunks_{};
+  std::atomic<size_t> number_of_slots_;
+  std::mutex slot_lock_;
+  // the slots of the exited threads; protected by slot_lock_.
+  std::vector<Padded*> free_slots_;
+  pthread_key_t slot_of_thread_;
+};
+
+}  // namespace LineairDB
+#endif /* LINEAIRDB_THREAD_SLOTS_HPP */
@@ -21,6 +21,8 @@
 #include <chrono>
 #include <experimental/filesystem>
 #include <memory>
+#include <optional>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -130,6 +132,28 @@ TEST_F(DatabaseTest, Scan) {
                   }});
 }
 
+TEST_F(DatabaseTest, BulkLoad) {
+  std::vector<std::pair<std::string, int>> values;
+  for (int i = 0; i < 1000; i++) values.emplace_back(std::to_string(i), i);
+  db_->BulkLoad([&](const LineairDB::Database::BulkLoadWriter& write) {
+    for (auto& [key, value] : values) {
+      write(key, reinterpret_cast<std::byte*>(&value), sizeof(int));
+    }
+  });
+
+  TestHelper::DoTransactions(
+      db_.get(), {[&](LineairDB::Transaction& tx) {
+        for (auto& [key, value] : values) {
+          auto result = tx.Read<int>(key);
+          ASSERT_TRUE(result.has_value());
+          ASSERT_EQ(value, result.value());
+        }
+        // the range index is built as well as the hash index.
+        auto count = tx.Scan<int>("0", "1", [](auto, auto) { return false; });
+        if (count.has_value()) { ASSERT_EQ(count.value(), 2); }
+      }});
+}
+
 TEST_F(DatabaseTest, SaveAsString) {
   TestHelper::DoTransactions(db_.get(),
                              {[&](LineairDB::Transaction& tx) {
@@ -164,6 +188,90 @@ TEST_F(DatabaseTest, ReadYourOwnWrites) {
                              }});
 }
 
+TEST_F(DatabaseTest, ReadYourOwnWritesInLargeTransaction) {
+  constexpr size_t Keys = 1000;
+  auto key              = [](const char* prefix, size_t i) {
+    return prefix + std::to_string(i);
+  };
+  TestHelper::DoTransactions(
+      db_.get(), {[&](LineairDB::Transaction& tx) {
+                    for (size_t i = 0; i < Keys; i++) {
+                      tx.Write<size_t>(key("alice", i), i);
+                    }
+                    for (size_t i = 0; i < Keys; i += 2) {
+                      tx.Write<size_t>(key("alice", i), i + 1);
+                    }
+                  },
+                  [&](LineairDB::Transaction& tx) {
+                    for (size_t i = 0; i < Keys; i++) {
+                      auto alice = tx.Read<size_t>(key("alice", i));
+                      ASSERT_EQ(i % 2 == 0 ? i + 1 : i, alice.value());
+                      ASSERT_FALSE(tx.Read<size_t>(key("bob", i)).has_value());
+                    }
+                    for (size_t i = 0; i < Keys; i++) {
+                      tx.Write<size_t>(key("alice", i), 0);
+                      ASSERT_EQ(0u, tx.Read<size_t>(key("alice", i)).value());
+                    }
+                  }});
+}
+
+TEST_F(DatabaseTest, MultiReadAndMultiWrite) {
+  constexpr size_t Keys = 200;
+  std::vector<std::string> names;
+  for (size_t i = 0; i < Keys; i++) {
+    names.push_back("alice" + std::to_string(i));
+  }
+  std::vector<std::string_view> keys(names.begin(), names.end());
+
+  TestHelper::DoTransactions(
+      db_.get(), {[&](LineairDB::Transaction& tx) {
+                    std::vector<std::pair<std::string_view, size_t>> entries;
+                    for (size_t i = 0; i < Keys; i += 2) {
+                      entries.push_back({keys[i], i});
+                    }
+                    tx.MultiWrite(entries);
+                  },
+                  [&](LineairDB::Transaction& tx) {
+                    // a duplicated key and a read of its own write.
+                    tx.Write<size_t>(keys[1], 42);
+                    auto request = keys;
+                    request.push_back(keys[0]);
+                    const auto values = tx.MultiRead<size_t>(request);
+                    ASSERT_EQ(Keys + 1, values.size());
+                    ASSERT_EQ(42u, values[1].value());
+                    for (size_t i = 0; i < Keys; i += 2) {
+                      ASSERT_EQ(i, values[i].value());
+                    }
+                    for (size_t i = 3; i < Keys; i += 2) {
+                      ASSERT_FALSE(values[i].has_value());
+                    }
+                    ASSERT_EQ(0u, values[Keys].value());
+                  },
+                  [&](LineairDB::Transaction& tx) {
+                    // keys already read, followed by more new keys than the
+                    // read set has room for; the short values of the former
+                    // are stored in the read set.
+                    for (size_t i = 0; i < 4; i++) tx.Read<size_t>(keys[i]);
+                    std::vector<std::string> new_names;
+                    for (size_t i = 0; i < Keys * 8; i++) {
+                      new_names.push_back("bob" + std::to_string(i));
+                    }
+                    std::vector<std::string_view> request(keys.begin(),
+                                                          keys.begin() + 4);
+                    request.insert(request.end(), new_names.begin(),
+                                   new_names.end());
+                    const auto values = tx.MultiRead<size_t>(request);
+                    ASSERT_EQ(request.size(), values.size());
+                    ASSERT_EQ(0u, values[0].value());
+                    ASSERT_EQ(42u, values[1].value());
+                    ASSERT_EQ(2u, values[2].value());
+                    ASSERT_FALSE(values[3].has_value());
+                    for (size_t i = 4; i < values.size(); i++) {
+                      ASSERT_FALSE(values[i].has_value());
+                    }
+                  }});
+}
+
 TEST_F(DatabaseTest, ThreadSafetyInsertions) {
   TransactionProcedure insertTenTimes([](LineairDB::Transaction& tx) {
     int value = 0xBEEF;
@@ -208,3 +316,503 @@ TEST_F(DatabaseTest, NoConfigTransaction) {
          ASSERT_EQ(0, tx.Read("bob").second);
        }});
 }
+
+TEST_F(DatabaseTest, ExecuteTransactionWithAdaptiveEpoch) {
+  db_.reset(nullptr);
+  LineairDB::Config conf     = config_;
+  conf.enable_adaptive_epoch = true;
+  conf.max_epoch_duration_ms = 10;
+  db_                        = std::make_unique<LineairDB::Database>(conf);
+  for (size_t i = 0; i < 100; i++) {
+    TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                                 auto value = tx.Read<size_t>("alice");
+                                 ASSERT_EQ(i, value.value_or(0));
+                                 tx.Write<size_t>("alice", i + 1);
+                               }});
+  }
+}
+
+TEST_F(DatabaseTest, ExecuteTransactionOnPartitionOfKey) {
+  db_.reset(nullptr);
+  LineairDB::Config conf             = config_;
+  conf.enable_numa_aware_thread_pool = true;
+  db_ = std::make_unique<LineairDB::Database>(conf);
+  std::atomic<size_t> committed(0);
+  const std::vector<std::string> keys = {"alice", "bob", "carol", "dave"};
+  for (auto& key : keys) {
+    db_->ExecuteTransaction(
+        LineairDB::TxType::ReadWrite, key,
+        [&](LineairDB::Transaction& tx) { tx.Write<size_t>(key, 1); },
+        [&](LineairDB::TxStatus status) {
+          if (status == LineairDB::TxStatus::Committed) committed++;
+        });
+  }
+  db_->Fence();
+  ASSERT_EQ(keys.size(), committed.load());
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               for (auto& key : keys) {
+                                 ASSERT_EQ(1, tx.Read<size_t>(key).value());
+                               }
+                             }});
+}
+
+TEST_F(DatabaseTest, ExecuteTransactions) {
+  std::atomic<size_t> committed(0);
+  std::vector<LineairDB::Database::TransactionRequest> batch;
+  const std::vector<std::string> keys = {"alice", "bob", "carol", "dave"};
+  for (auto& key : keys) {
+    LineairDB::Database::TransactionRequest request;
+    request.proc = [&](LineairDB::Transaction& tx) {
+      tx.Write<size_t>(key, 1);
+    };
+    request.commit_clbk = [&](LineairDB::TxStatus status) {
+      if (status == LineairDB::TxStatus::Committed) committed++;
+    };
+    if (key != "alice") request.partition_key = key;
+    batch.emplace_back(std::move(request));
+  }
+  db_->ExecuteTransactions(std::move(batch));
+  db_->Fence();
+  ASSERT_EQ(keys.size(), committed.load());
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               for (auto& key : keys) {
+                                 ASSERT_EQ(1, tx.Read<size_t>(key).value());
+                               }
+                             }});
+}
+
+TEST_F(DatabaseTest, ExecuteTransactionsWithPrefetchKeys) {
+  std::atomic<size_t> committed(0);
+  std::vector<LineairDB::Database::TransactionRequest> batch;
+  constexpr size_t Transactions = 20;
+  for (size_t i = 0; i < Transactions; i++) {
+    LineairDB::Database::TransactionRequest request;
+    const std::string key = "key" + std::to_string(i);
+    request.proc          = [&, key, i](LineairDB::Transaction& tx) {
+      tx.Write<size_t>(key, i);
+    };
+    request.commit_clbk = [&](LineairDB::TxStatus status) {
+      if (status == LineairDB::TxStatus::Committed) committed++;
+    };
+    request.prefetch_keys = {key};
+    if (i % 3 == 0) request.partition_key = "partition";
+    batch.emplace_back(std::move(request));
+  }
+  db_->ExecuteTransactions(std::move(batch));
+  db_->Fence();
+  ASSERT_EQ(Transactions, committed.load());
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               for (size_t i = 0; i < Transactions; i++) {
+                                 auto key   = "key" + std::to_string(i);
+                                 auto value = tx.Read<size_t>(key);
+                                 ASSERT_EQ(i, value.value());
+                               }
+                             }});
+}
+
+TEST_F(DatabaseTest, ExecuteTransactionWithCompletionQueue) {
+  LineairDB::CompletionQueue completions;
+#if defined(__linux__)
+  ASSERT_LE(0, completions.GetEventFd());
+#endif
+  constexpr size_t Transactions = 10;
+  for (size_t i = 0; i < Transactions; i++) {
+    db_->ExecuteTransaction(
+        LineairDB::TxType::ReadWrite,
+        [i](LineairDB::Transaction& tx) {
+          tx.Write<size_t>("key" + std::to_string(i), i);
+        },
+        completions, i);
+  }
+
+  std::vector<bool> completed(Transactions, false);
+  LineairDB::CompletionQueue::Completion harvested[4];
+  for (size_t remaining = Transactions; 0 < remaining;) {
+    const size_t n =
+        completions.Wait(harvested, 4, std::chrono::microseconds(1000000));
+    ASSERT_LT(0, n);
+    for (size_t i = 0; i < n; i++) {
+      ASSERT_EQ(LineairDB::TxStatus::Committed, harvested[i].status);
+      ASSERT_FALSE(completed[harvested[i].tag]);
+      completed[harvested[i].tag] = true;
+    }
+    remaining -= n;
+  }
+  ASSERT_EQ(0, completions.Poll(harvested, 4));
+}
+
+TEST_F(DatabaseTest, ExecutePreparedProcedure) {
+  constexpr size_t Accounts = 4;
+  TestHelper::RetryTransactionUntilCommit(db_.get(), [&](auto& tx) {
+    for (size_t i = 0; i < Accounts; i++) {
+      tx.template Write<int>("account" + std::to_string(i), 100);
+    }
+  });
+
+  struct Transfer {
+    size_t from;
+    size_t to;
+    int amount;
+  };
+  LineairDB::Database::ProcedureShape shape;
+  shape.reads  = 2;
+  shape.writes = 2;
+
+  auto transfer = db_->Prepare<Transfer>(
+      [](LineairDB::Transaction& tx, const Transfer& p) {
+        const auto from        = "account" + std::to_string(p.from);
+        const auto to          = "account" + std::to_string(p.to);
+        const int from_balance = tx.Read<int>(from).value();
+        const int to_balance   = tx.Read<int>(to).value();
+        tx.Write<int>(from, from_balance - p.amount);
+        tx.Write<int>(to, to_balance + p.amount);
+      },
+      shape);
+
+  LineairDB::CompletionQueue completions;
+  constexpr size_t Transfers = 16;
+  for (size_t i = 0; i < Transfers; i++) {
+    transfer.Execute({i % Accounts, (i + 1) % Accounts, 1}, completions, i);
+  }
+  size_t committed = 0;
+  LineairDB::CompletionQueue::Completion harvested[4];
+  for (size_t remaining = Transfers; 0 < remaining;) {
+    const size_t n =
+        completions.Wait(harvested, 4, std::chrono::microseconds(1000000));
+    ASSERT_LT(0, n);
+    for (size_t i = 0; i < n; i++) {
+      if (harvested[i].status == LineairDB::TxStatus::Committed) committed++;
+    }
+    remaining -= n;
+  }
+  ASSERT_LT(0, committed);
+
+  // The transfers keep the total.
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               int total = 0;
+                               for (size_t i = 0; i < Accounts; i++) {
+                                 total += tx.Read<int>("account" +
+                                                       std::to_string(i))
+                                              .value();
+                               }
+                               ASSERT_EQ(100 * static_cast<int>(Accounts),
+                                         total);
+                             }});
+}
+
+TEST_F(DatabaseTest, Delete) {
+  TestHelper::RetryTransactionUntilCommit(db_.get(), [&](auto& tx) {
+    tx.template Write<int>("alice", 1);
+    tx.template Write<int>("bob", 2);
+    tx.template Write<int>("carol", 3);
+  });
+  TestHelper::RetryTransactionUntilCommit(db_.get(), [&](auto& tx) {
+    tx.Delete("bob");
+    // read-your-own-delete
+    ASSERT_FALSE(tx.template Read<int>("bob").has_value());
+  });
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               ASSERT_FALSE(tx.Read<int>("bob").has_value());
+                               auto count = tx.Scan<int>(
+                                   "alice", "carol", [&](auto key, auto) {
+                                     EXPECT_NE("bob", key);
+                                     return false;
+                                   });
+                               if (count.has_value()) {
+                                 ASSERT_EQ(2, count.value());
+                               }
+                             }});
+
+  // The tombstone is reclaimed in background; the key can be written again
+  // before and after the reclamation.
+  for (int i = 0; i < 3; i++) {
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(2 * config_.epoch_duration_ms));
+    TestHelper::RetryTransactionUntilCommit(db_.get(), [&](auto& tx) {
+      ASSERT_FALSE(tx.template Read<int>("bob").has_value());
+    });
+    db_->Fence();
+  }
+  TestHelper::RetryTransactionUntilCommit(
+      db_.get(), [&](auto& tx) { tx.template Write<int>("bob", 4); });
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               ASSERT_EQ(4, tx.Read<int>("bob").value());
+                             }});
+}
+
+TEST_F(DatabaseTest, Merge) {
+  using LineairDB::MergeOperator;
+  TestHelper::RetryTransactionUntilCommit(db_.get(), [&](auto& tx) {
+    tx.template Write<int64_t>("counter", 10);
+    tx.template Merge<int64_t>("counter", 5, MergeOperator::Add);
+    tx.template Merge<int64_t>("absent", 3, MergeOperator::Add);
+    tx.template Merge<int64_t>("max", 7, MergeOperator::Max);
+    tx.Merge("log", reinterpret_cast<const std::byte*>("ab"), 2,
+             MergeOperator::Append);
+  });
+  TestHelper::RetryTransactionUntilCommit(db_.get(), [&](auto& tx) {
+    tx.template Merge<int64_t>("counter", 1, MergeOperator::Add);
+    tx.template Merge<int64_t>("counter", 2, MergeOperator::Add);
+    tx.template Merge<int64_t>("max", 3, MergeOperator::Max);
+    tx.Merge("log", reinterpret_cast<const std::byte*>("cd"), 2,
+             MergeOperator::Append);
+    // a read after the merges sees their results.
+    ASSERT_EQ(18, tx.template Read<int64_t>("counter").value());
+    tx.template Merge<int64_t>("counter", 100, MergeOperator::Max);
+  });
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               ASSERT_EQ(100, tx.Read<int64_t>("counter"));
+                               ASSERT_EQ(3, tx.Read<int64_t>("absent"));
+                               ASSERT_EQ(7, tx.Read<int64_t>("max"));
+                               auto log = tx.Read("log");
+                               const std::string value(
+                                   reinterpret_cast<const char*>(log.first),
+                                   log.second);
+                               ASSERT_EQ("abcd", value);
+                             }});
+
+  // Add and Max take int64_t.
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               tx.Merge<int>("counter", 1, MergeOperator::Add);
+                               ASSERT_TRUE(tx.IsAborted());
+                             }});
+}
+
+TEST_F(DatabaseTest, GetStatistics) {
+  constexpr size_t Keys = 1000;
+  // larger than the inline buffer of a data item
+  const std::string value(128, 'v');
+  db_->BulkLoad([&](const auto& write) {
+    for (size_t i = 0; i < Keys; i++) {
+      write("key" + std::to_string(i),
+            reinterpret_cast<const std::byte*>(value.data()), value.size());
+    }
+  });
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               for (size_t i = 0; i < 10; i++) {
+                                 tx.Read("key" + std::to_string(i));
+                               }
+                             }});
+
+  const auto statistics = db_->GetStatistics();
+  ASSERT_EQ(Keys, statistics.records);
+  ASSERT_LE(Keys, statistics.hash_table_capacity);
+  ASSERT_LT(0, statistics.hash_table_fill_rate);
+  ASSERT_GE(config_.rehash_threshold, statistics.hash_table_fill_rate);
+  ASSERT_LT(0, statistics.average_probe_length);
+  ASSERT_LT(0, statistics.memory.point_index);
+  ASSERT_LT(0, statistics.memory.range_index);
+  ASSERT_LT(0, statistics.memory.data_items);
+  ASSERT_LE(Keys * value.size(), statistics.memory.values);
+  ASSERT_EQ(0, statistics.pending_callbacks);
+  ASSERT_LT(statistics.memory.values, statistics.memory.Total());
+}
+
+TEST_F(DatabaseTest, ReadOfAbsentKeysInsertsNoEntry) {
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               for (size_t i = 0; i < 100; i++) {
+                                 auto absent =
+                                     tx.Read<int>("key" + std::to_string(i));
+                                 ASSERT_FALSE(absent.has_value());
+                               }
+                               tx.Write<int>("alice", 1);
+                             }});
+  ASSERT_EQ(1, db_->GetStatistics().records);
+}
+
+TEST_F(DatabaseTest, SecondaryIndex) {
+  auto write = [](LineairDB::Transaction& tx, const std::string& key,
+                  const std::string& city) {
+    tx.Write(key, reinterpret_cast<const std::byte*>(city.data()),
+             city.size());
+  };
+  auto scan = [&](const std::string& begin,
+                  const std::optional<std::string> end) {
+    std::vector<std::string> keys;
+    TestHelper::DoTransactions(
+        db_.get(), {[&](LineairDB::Transaction& tx) {
+          auto rows = tx.ScanIndex(
+              "city", begin, end, [&](auto key, auto) {
+                keys.emplace_back(key);
+                return false;
+              });
+          ASSERT_TRUE(rows.has_value());
+          ASSERT_EQ(keys.size(), rows.value());
+        }});
+    return keys;
+  };
+  db_->BulkLoad([&](const auto& load) {
+    load("alice", reinterpret_cast<const std::byte*>("tokyo"), 5);
+    load("bob", reinterpret_cast<const std::byte*>("osaka"), 5);
+  });
+  auto by_value = [](std::string_view,
+                     const std::pair<const std::byte*, size_t> value) {
+    return std::optional<std::string>(
+        std::string(reinterpret_cast<const char*>(value.first), value.second));
+  };
+  ASSERT_TRUE(db_->CreateSecondaryIndex("city", by_value));
+  ASSERT_FALSE(db_->CreateSecondaryIndex("city", by_value));
+  ASSERT_EQ(std::vector<std::string>({"bob", "alice"}),
+            scan("a", std::nullopt));
+
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               write(tx, "carol", "tokyo");
+                             }});
+  ASSERT_EQ(std::vector<std::string>({"alice", "carol"}),
+            scan("tokyo", "tokyo"));
+
+  // The entries follow the updates and the deletions.
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               write(tx, "alice", "kyoto");
+                               tx.Delete("bob");
+                             }});
+  ASSERT_EQ(std::vector<std::string>({"alice", "carol"}),
+            scan("a", std::nullopt));
+  ASSERT_EQ(std::vector<std::string>({"alice"}), scan("kyoto", "osaka"));
+
+  // A row moved out of the range by the scanning transaction is not given.
+  TestHelper::DoTransactions(
+      db_.get(), {[&](LineairDB::Transaction& tx) {
+        write(tx, "carol", "nagoya");
+        size_t rows = 0;
+        tx.ScanIndex("city", "tokyo", "tokyo", [&](auto, auto) {
+          rows++;
+          return false;
+        });
+        ASSERT_EQ(0u, rows);
+      }});
+  ASSERT_EQ(std::vector<std::string>({"carol"}), scan("nagoya", "nagoya"));
+
+  bool aborted = false;
+  db_->ExecuteTransaction(
+      [&](LineairDB::Transaction& tx) {
+        auto rows = tx.ScanIndex("country", "a", std::nullopt,
+                                 [](auto, auto) { return false; });
+        ASSERT_FALSE(rows.has_value());
+      },
+      [&](const auto status) {
+        aborted = status == LineairDB::TxStatus::Aborted;
+      });
+  db_->Fence();
+  ASSERT_TRUE(aborted);
+}
+
+TEST_F(DatabaseTest, Tables) {
+  LineairDB::Config table_config;
+  table_config.index_structure =
+      LineairDB::Config::IndexStructure::HashTableWithOLCTreeIndex;
+  ASSERT_TRUE(db_->CreateTable("users", table_config));
+  ASSERT_TRUE(db_->CreateTable("orders"));
+  ASSERT_FALSE(db_->CreateTable("users"));
+  ASSERT_FALSE(db_->CreateTable(""));
+  ASSERT_FALSE(db_->CreateTable("users/orders"));
+
+  // The same key in the tables is of different rows.
+  TestHelper::RetryTransactionUntilCommit(db_.get(), [](auto& tx) {
+    tx.template Write<int>("alice", 0);
+    ASSERT_TRUE(tx.SetTable("users"));
+    tx.template Write<int>("alice", 1);
+    tx.template Write<int>("bob", 1);
+    ASSERT_TRUE(tx.SetTable("orders"));
+    tx.template Write<int>("alice", 2);
+    ASSERT_FALSE(tx.SetTable("items"));
+    ASSERT_EQ(2, tx.template Read<int>("alice").value());
+  });
+  TestHelper::DoTransactions(db_.get(), {[](LineairDB::Transaction& tx) {
+                               ASSERT_EQ(0, tx.Read<int>("alice").value());
+                               ASSERT_FALSE(tx.Read<int>("bob").has_value());
+                               ASSERT_TRUE(tx.SetTable("users"));
+                               ASSERT_EQ(1, tx.Read<int>("alice").value());
+                               ASSERT_EQ(1, tx.Read<int>("bob").value());
+                               ASSERT_TRUE(tx.SetTable("orders"));
+                               ASSERT_EQ(2, tx.Read<int>("alice").value());
+                               ASSERT_FALSE(tx.Read<int>("bob").has_value());
+                               ASSERT_TRUE(tx.SetTable(""));
+                               ASSERT_EQ(0, tx.Read<int>("alice").value());
+                             }});
+
+  // A scan of a table does not conflict with the insertions into another.
+  std::this_thread::sleep_for(
+      std::chrono::milliseconds(config_.epoch_duration_ms * 10));
+  TestHelper::DoTransactions(db_.get(), {[](LineairDB::Transaction& tx) {
+                               ASSERT_TRUE(tx.SetTable("orders"));
+                               tx.Write<int>("carol", 2);
+                             }});
+  TestHelper::DoTransactions(
+      db_.get(), {[](LineairDB::Transaction& tx) {
+        ASSERT_TRUE(tx.SetTable("users"));
+        std::vector<std::string> keys;
+        auto rows = tx.Scan<int>("a", std::nullopt, [&](auto key, auto) {
+          keys.emplace_back(key);
+          return false;
+        });
+        ASSERT_TRUE(rows.has_value());
+        ASSERT_EQ(std::vector<std::string>({"alice", "bob"}), keys);
+      }});
+}
+
+TEST_F(DatabaseTest, EvictColdValues) {
+  db_.reset(nullptr);
+  config_.cold_storage_threshold_bytes = 1;
+  db_ = std::make_unique<LineairDB::Database>(config_);
+
+  constexpr size_t Keys = 1000;
+  const std::string value(1024, 'v');
+  db_->BulkLoad([&](const auto& write) {
+    for (size_t i = 0; i < Keys; i++) {
+      write("key" + std::to_string(i),
+            reinterpret_cast<const std::byte*>(value.data()), value.size());
+    }
+  });
+  // The values are evicted in the background at the end of epochs.
+  while (db_->GetStatistics().cold_storage_bytes < Keys * value.size()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // The evicted values are read from the cold storage, and the written ones
+  // are kept in memory.
+  const std::string new_value(1024, 'n');
+  TestHelper::DoTransactions(
+      db_.get(), {[&](LineairDB::Transaction& tx) {
+                    for (size_t i = 0; i < Keys; i++) {
+                      auto result = tx.Read("key" + std::to_string(i));
+                      ASSERT_EQ(value,
+                                std::string(reinterpret_cast<const char*>(
+                                                result.first),
+                                            result.second));
+                    }
+                    tx.Write("key0",
+                             reinterpret_cast<const std::byte*>(
+                                 new_value.data()),
+                             new_value.size());
+                  },
+                  [&](LineairDB::Transaction& tx) {
+                    auto result = tx.Read("key0");
+                    ASSERT_EQ(new_value,
+                              std::string(reinterpret_cast<const char*>(
+                                              result.first),
+                                          result.second));
+                  }});
+}
+
+TEST_F(DatabaseTest, InstrumentedStatistics) {
+  using LineairDB::Statistics;
+  // NOTE: the statistics are summed up over the process.
+  const auto before = db_->GetStatistics();
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               tx.Read("alice");
+                               tx.Abort();
+                             }});
+  const auto after = db_->GetStatistics();
+  if (!after.instrumented) {
+    ASSERT_EQ(0u, after.aborts[Statistics::UserAbort]);
+    ASSERT_EQ(0u, after.latencies[Statistics::IndexLookup].count);
+    return;
+  }
+  ASSERT_EQ(before.aborts[Statistics::UserAbort] + 1,
+            after.aborts[Statistics::UserAbort]);
+  const auto& lookup = after.latencies[Statistics::IndexLookup];
+  ASSERT_LT(before.latencies[Statistics::IndexLookup].count, lookup.count);
+  ASSERT_LE(lookup.p50_ns, lookup.p99_ns);
+  ASSERT_LE(lookup.p99_ns, lookup.max_ns);
+}
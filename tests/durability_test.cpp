@@ -21,12 +21,16 @@
 
 #include <atomic>
 #include <chrono>
+#include <cstring>
 #include <experimental/filesystem>
+#include <fstream>
 #include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
 #include "gtest/gtest.h"
+#include "recovery/log_compression.h"
 #include "test_helper.hpp"
 #include "util/logger.hpp"
 
@@ -78,6 +82,37 @@ TEST_F(DurabilityTest, Recovery) {
   }
 }
 
+TEST_F(DurabilityTest, RecoveryFromBulkLoad) {
+  const LineairDB::Config config = db_->GetConfig();
+  int initial_value              = 1;
+  std::vector<std::pair<std::string, std::pair<const std::byte*, size_t>>>
+      entries;
+  for (size_t i = 0; i < 100; i++) {
+    entries.push_back({"key" + std::to_string(i),
+                       {reinterpret_cast<std::byte*>(&initial_value),
+                        sizeof(int)}});
+  }
+  db_->BulkLoad(entries.begin(), entries.end());
+  int updated_value = 2;
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               tx.Write<int>("key0", updated_value);
+                             }});
+  db_->Fence();
+
+  db_.reset(nullptr);
+  db_ = std::make_unique<LineairDB::Database>(config);
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               ASSERT_EQ(updated_value,
+                                         tx.Read<int>("key0").value());
+                               for (size_t i = 1; i < entries.size(); i++) {
+                                 auto value =
+                                     tx.Read<int>("key" + std::to_string(i));
+                                 ASSERT_TRUE(value.has_value());
+                                 ASSERT_EQ(initial_value, value.value());
+                               }
+                             }});
+}
+
 TEST_F(DurabilityTest, RecoveryLargeObject) {
   std::string initial_value(4096, 'a');
   TestHelper::DoTransactions(
@@ -159,7 +194,10 @@ size_t getLogDirectorySize(const LineairDB::Config& conf) {
     if (entry.path().filename().generic_string().find("working") !=
         std::string::npos)
       continue;
-    size += fs::file_size(entry.path());
+    // Log segments may be removed by truncation in the meantime.
+    std::error_code error;
+    const auto file_size = fs::file_size(entry.path(), error);
+    if (!error) size += file_size;
   }
   return size;
 }
@@ -251,6 +289,82 @@ TEST_F(DurabilityTest,
   ASSERT_FALSE(filesize_is_monotonically_increasing);
 }
 
+TEST_F(DurabilityTest, LogsOfFinishedHandlerThreadsAreTruncated) {
+  const LineairDB::Config config = db_->GetConfig();
+  ASSERT_TRUE(config.enable_checkpointing);
+
+  namespace fs  = std::experimental::filesystem;
+  auto log_files = [&]() {
+    size_t files = 0;
+    for (const auto& entry : fs::directory_iterator(config.work_dir)) {
+      if (entry.path().filename().generic_string().rfind("thread", 0) == 0) {
+        files++;
+      }
+    }
+    return files;
+  };
+
+  // The thread entrusts its logs to the workers and exits.
+  std::thread handler_thread([&]() {
+    auto& tx  = db_->BeginTransaction();
+    int value = 0xBEEF;
+    tx.Write<int>("alice", value);
+    ASSERT_TRUE(db_->EndTransaction(tx, [](auto) {}));
+  });
+  handler_thread.join();
+  db_->Fence();
+  ASSERT_LT(0u, log_files());
+
+  // The checkpoints cover the logs, which are truncated by the workers.
+  auto begin = std::chrono::high_resolution_clock::now();
+  while (0 < log_files()) {
+    db_->WaitForCheckpoint();
+    const auto elapsed = std::chrono::high_resolution_clock::now() - begin;
+    ASSERT_GT(std::chrono::seconds(config.checkpoint_period * 10), elapsed);
+  }
+}
+
+TEST_F(DurabilityTest, HandlerThreadsShareTheLogFilesOfTheWorkers) {
+  LineairDB::Config config    = db_->GetConfig();
+  config.enable_checkpointing = false;
+  db_.reset(nullptr);
+  std::experimental::filesystem::remove_all(config.work_dir);
+  db_ = std::make_unique<LineairDB::Database>(config);
+
+  // Each short-lived thread commits a transaction by itself.
+  constexpr int Handlers = 32;
+  for (int i = 0; i < Handlers; i++) {
+    std::thread handler_thread([&, i]() {
+      auto& tx = db_->BeginTransaction();
+      tx.Write<int>("key" + std::to_string(i), i);
+      ASSERT_TRUE(db_->EndTransaction(tx, [](auto) {}));
+    });
+    handler_thread.join();
+  }
+  db_->Fence();
+
+  namespace fs = std::experimental::filesystem;
+  size_t files = 0;
+  for (const auto& entry : fs::directory_iterator(config.work_dir)) {
+    if (entry.path().filename().generic_string().rfind("thread", 0) == 0) {
+      files++;
+    }
+  }
+  ASSERT_LT(0u, files);
+  ASSERT_GE(config.max_thread, files);
+
+  db_.reset(nullptr);
+  db_ = std::make_unique<LineairDB::Database>(config);
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               for (int i = 0; i < Handlers; i++) {
+                                 auto value =
+                                     tx.Read<int>("key" + std::to_string(i));
+                                 ASSERT_TRUE(value.has_value());
+                                 ASSERT_EQ(i, value.value());
+                               }
+                             }});
+}
+
 TEST_F(DurabilityTest, CPRConsistency) {  // a.k.a., checkpointing
   /**
    * CPR Consistency:
@@ -336,3 +450,473 @@ TEST_F(DurabilityTest,
         ASSERT_TRUE(alice.has_value());
       }});
 }
+
+TEST_F(DurabilityTest, RecoveryWithGroupCommitLogger) {
+  for (const bool direct : {false, true}) {
+    LineairDB::Config config    = db_->GetConfig();
+    config.logger               = LineairDB::Config::Logger::GroupCommitLogger;
+    config.enable_direct_log_io = direct;
+    db_.reset(nullptr);
+    std::experimental::filesystem::remove_all(config.work_dir);
+    db_ = std::make_unique<LineairDB::Database>(config);
+
+    TransactionProcedure UpdateAlice([](LineairDB::Transaction& tx) {
+      int value = 0xBEEF;
+      tx.Write<int>("alice", value);
+    });
+    TransactionProcedure UpdateBob([](LineairDB::Transaction& tx) {
+      int value = 0xCAFE;
+      tx.Write<int>("bob", value);
+    });
+    TestHelper::DoTransactionsOnMultiThreads(db_.get(),
+                                             {UpdateAlice, UpdateAlice});
+    // Let checkpointing truncate the log files.
+    std::this_thread::sleep_for(
+        std::chrono::seconds(config.checkpoint_period * 2));
+    TestHelper::DoHandlerTransactionsOnMultiThreads(db_.get(), {UpdateBob});
+    db_->Fence();
+
+    for (size_t i = 0; i < 2; i++) {
+      db_.reset(nullptr);
+      db_ = std::make_unique<LineairDB::Database>(config);
+      TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                                   auto alice = tx.Read<int>("alice");
+                                   ASSERT_TRUE(alice.has_value());
+                                   ASSERT_EQ(0xBEEF, alice.value());
+                                   auto bob = tx.Read<int>("bob");
+                                   ASSERT_TRUE(bob.has_value());
+                                   ASSERT_EQ(0xCAFE, bob.value());
+                                 }});
+    }
+  }
+}
+
+TEST_F(DurabilityTest, RecoveryWithBinaryLogger) {
+  LineairDB::Config config = db_->GetConfig();
+  config.logger            = LineairDB::Config::Logger::BinaryLogger;
+  config.checkpoint_period = 30;
+  db_.reset(nullptr);
+  std::experimental::filesystem::remove_all(config.work_dir);
+  db_ = std::make_unique<LineairDB::Database>(config);
+
+  TransactionProcedure UpdateAlice([](LineairDB::Transaction& tx) {
+    int value = 0xBEEF;
+    tx.Write<int>("alice", value);
+  });
+  TransactionProcedure UpdateBob([](LineairDB::Transaction& tx) {
+    std::string value(1000, 'b');
+    tx.Write("bob", reinterpret_cast<const std::byte*>(value.data()),
+             value.size());
+  });
+  TestHelper::DoTransactionsOnMultiThreads(db_.get(), {UpdateAlice});
+  TestHelper::DoHandlerTransactionsOnMultiThreads(db_.get(), {UpdateBob});
+  db_->Fence();
+  db_.reset(nullptr);
+
+  // A torn record at the tail of a log file is ignored.
+  namespace fs = std::experimental::filesystem;
+  for (const auto& entry : fs::directory_iterator(config.work_dir)) {
+    const auto filename = entry.path().filename().generic_string();
+    if (filename.find("thread") != 0) continue;
+    std::ofstream file(entry.path(), std::ofstream::app);
+    file << "BLOG broken";
+  }
+
+  db_ = std::make_unique<LineairDB::Database>(config);
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               auto alice = tx.Read<int>("alice");
+                               ASSERT_TRUE(alice.has_value());
+                               ASSERT_EQ(0xBEEF, alice.value());
+                               auto bob = tx.Read("bob");
+                               ASSERT_NE(nullptr, bob.first);
+                               ASSERT_EQ(1000, bob.second);
+                               ASSERT_EQ(std::byte{'b'}, bob.first[999]);
+                             }});
+}
+
+TEST_F(DurabilityTest, RecoveryWithPersistentMemoryLogger) {
+  LineairDB::Config config = db_->GetConfig();
+  config.checkpoint_period = 30;
+  config.logger = LineairDB::Config::Logger::PersistentMemoryLogger;
+  db_.reset(nullptr);
+  std::experimental::filesystem::remove_all(config.work_dir);
+  db_ = std::make_unique<LineairDB::Database>(config);
+
+  TransactionProcedure UpdateAlice([](LineairDB::Transaction& tx) {
+    int value = 0xBEEF;
+    tx.Write<int>("alice", value);
+  });
+  TransactionProcedure UpdateBob([](LineairDB::Transaction& tx) {
+    std::string value(1000, 'b');
+    tx.Write("bob", reinterpret_cast<const std::byte*>(value.data()),
+             value.size());
+  });
+  TestHelper::DoTransactionsOnMultiThreads(db_.get(), {UpdateAlice});
+  TestHelper::DoHandlerTransactionsOnMultiThreads(db_.get(), {UpdateBob});
+  db_->Fence();
+
+  // The database is not destructed, as if it crashed; the log files keep
+  // their preallocated tails.
+  auto recovered = config;
+  recovered.work_dir = "lineairdb_logs_recovered";
+  std::experimental::filesystem::remove_all(recovered.work_dir);
+  std::experimental::filesystem::copy(config.work_dir, recovered.work_dir);
+  db_.reset(nullptr);
+  db_ = std::make_unique<LineairDB::Database>(recovered);
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               auto alice = tx.Read<int>("alice");
+                               ASSERT_TRUE(alice.has_value());
+                               ASSERT_EQ(0xBEEF, alice.value());
+                               auto bob = tx.Read("bob");
+                               ASSERT_NE(nullptr, bob.first);
+                               ASSERT_EQ(1000, bob.second);
+                               ASSERT_EQ(std::byte{'b'}, bob.first[999]);
+                             }});
+  db_.reset(nullptr);
+  std::experimental::filesystem::remove_all(recovered.work_dir);
+}
+
+TEST_F(DurabilityTest, RecoveryWithLogCoalescing) {
+  LineairDB::Config config     = db_->GetConfig();
+  config.enable_log_coalescing = true;
+  config.checkpoint_period     = 30;
+  db_.reset(nullptr);
+  std::experimental::filesystem::remove_all(config.work_dir);
+  db_ = std::make_unique<LineairDB::Database>(config);
+
+  constexpr int Updates = 10000;
+  for (int i = 1; i <= Updates; i++) {
+    db_->ExecuteTransaction(
+        [i](LineairDB::Transaction& tx) {
+          tx.Write<int>("hot", i);
+          tx.Write<int>("key" + std::to_string(i % 10), i);
+        },
+        [](auto) {});
+  }
+  db_->Fence();
+  std::vector<std::string> keys = {"hot"};
+  for (int i = 0; i < 10; i++) keys.emplace_back("key" + std::to_string(i));
+  std::vector<int> values;
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               for (auto& key : keys) {
+                                 values.push_back(tx.Read<int>(key).value());
+                               }
+                             }});
+  db_.reset(nullptr);
+
+  // The updates of a key in an epoch are logged once.
+  namespace fs = std::experimental::filesystem;
+  size_t log_bytes = 0;
+  for (const auto& entry : fs::directory_iterator(config.work_dir)) {
+    const auto filename = entry.path().filename().generic_string();
+    if (filename.find("thread") == 0) log_bytes += fs::file_size(entry);
+  }
+  ASSERT_LT(log_bytes, Updates * sizeof(int));
+
+  db_ = std::make_unique<LineairDB::Database>(config);
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               for (size_t i = 0; i < keys.size(); i++) {
+                                 auto value = tx.Read<int>(keys[i]);
+                                 ASSERT_TRUE(value.has_value());
+                                 ASSERT_EQ(values[i], value.value());
+                               }
+                             }});
+}
+
+TEST_F(DurabilityTest, RecoveryFromIncrementalCheckpoints) {
+  LineairDB::Config config              = db_->GetConfig();
+  config.enable_logging                 = false;
+  config.checkpoint_compaction_interval = 2;
+  db_.reset(nullptr);
+  std::experimental::filesystem::remove_all(config.work_dir);
+  db_ = std::make_unique<LineairDB::Database>(config);
+
+  TransactionProcedure UpdateAlice([](LineairDB::Transaction& tx) {
+    int value = 0xBEEF;
+    tx.Write<int>("alice", value);
+  });
+  TransactionProcedure UpdateBob([](LineairDB::Transaction& tx) {
+    int value = 0xCAFE;
+    tx.Write<int>("bob", value);
+  });
+  TestHelper::DoTransactions(db_.get(), {UpdateAlice});
+  std::this_thread::sleep_for(
+      std::chrono::seconds(config.checkpoint_period * 3));
+  TestHelper::DoTransactions(db_.get(), {UpdateBob});
+  std::this_thread::sleep_for(
+      std::chrono::seconds(config.checkpoint_period * 3));
+
+  // The delta files are removed by full checkpoints.
+  namespace fs = std::experimental::filesystem;
+  size_t delta_files = 0;
+  for (const auto& entry : fs::directory_iterator(config.work_dir)) {
+    const auto filename = entry.path().filename().generic_string();
+    if (filename.find("checkpoint.delta.") == 0) delta_files++;
+  }
+  ASSERT_GE(config.checkpoint_compaction_interval, delta_files);
+
+  for (size_t i = 0; i < 2; i++) {
+    db_.reset(nullptr);
+    db_ = std::make_unique<LineairDB::Database>(config);
+    TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                                 auto alice = tx.Read<int>("alice");
+                                 ASSERT_TRUE(alice.has_value());
+                                 ASSERT_EQ(0xBEEF, alice.value());
+                                 auto bob = tx.Read<int>("bob");
+                                 ASSERT_TRUE(bob.has_value());
+                                 ASSERT_EQ(0xCAFE, bob.value());
+                               }});
+    std::this_thread::sleep_for(
+        std::chrono::seconds(config.checkpoint_period * 2));
+  }
+}
+
+TEST_F(DurabilityTest, RecoveryWithSmallCheckpointBuffer) {
+  // Test scenario: the checkpoints are written in many chunks.
+  LineairDB::Config config              = db_->GetConfig();
+  config.enable_logging                 = false;
+  config.checkpoint_compaction_interval = 2;
+  config.checkpoint_buffer_size         = 4096;
+  db_.reset(nullptr);
+  std::experimental::filesystem::remove_all(config.work_dir);
+  db_ = std::make_unique<LineairDB::Database>(config);
+
+  constexpr size_t Keys = 1000;
+  auto write            = [&](const char c) {
+    TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                                 for (size_t i = 0; i < Keys; i++) {
+                                   if (c == 'b' && i % 2 == 0) continue;
+                                   const std::string value(100 + i % 7, c);
+                                   tx.Write("key" + std::to_string(i),
+                                            reinterpret_cast<const std::byte*>(
+                                                value.data()),
+                                            value.size());
+                                 }
+                               }});
+    std::this_thread::sleep_for(
+        std::chrono::seconds(config.checkpoint_period * 3));
+  };
+  write('a');  // a full checkpoint
+  write('b');  // and an incremental one
+
+  db_.reset(nullptr);
+  db_ = std::make_unique<LineairDB::Database>(config);
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               for (size_t i = 0; i < Keys; i++) {
+                                 auto [value, size] =
+                                     tx.Read("key" + std::to_string(i));
+                                 ASSERT_NE(nullptr, value);
+                                 const std::string expected(
+                                     100 + i % 7, i % 2 == 0 ? 'a' : 'b');
+                                 ASSERT_EQ(expected,
+                                           std::string(reinterpret_cast<
+                                                           const char*>(value),
+                                                       size));
+                               }
+                             }});
+}
+
+TEST_F(DurabilityTest, RecoveryOfDeletedKeys) {
+  // Test scenario: a key in a full checkpoint is deleted, and the deletion is
+  // recovered from the delta file of an incremental checkpoint.
+  LineairDB::Config config              = db_->GetConfig();
+  config.enable_logging                 = false;
+  config.checkpoint_compaction_interval = 4;
+  db_.reset(nullptr);
+  std::experimental::filesystem::remove_all(config.work_dir);
+  db_ = std::make_unique<LineairDB::Database>(config);
+
+  TestHelper::DoTransactions(db_.get(), {[](LineairDB::Transaction& tx) {
+                               tx.Write<int>("alice", 0xBEEF);
+                               tx.Write<int>("bob", 0xCAFE);
+                             }});
+  std::this_thread::sleep_for(
+      std::chrono::seconds(config.checkpoint_period * 3));
+  TestHelper::DoTransactions(
+      db_.get(), {[](LineairDB::Transaction& tx) { tx.Delete("bob"); }});
+  std::this_thread::sleep_for(
+      std::chrono::seconds(config.checkpoint_period * 3));
+
+  for (size_t i = 0; i < 2; i++) {
+    db_.reset(nullptr);
+    db_ = std::make_unique<LineairDB::Database>(config);
+    TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                                 auto alice = tx.Read<int>("alice");
+                                 ASSERT_TRUE(alice.has_value());
+                                 ASSERT_EQ(0xBEEF, alice.value());
+                                 ASSERT_FALSE(tx.Read<int>("bob").has_value());
+                               }});
+    std::this_thread::sleep_for(
+        std::chrono::seconds(config.checkpoint_period * 2));
+  }
+}
+
+TEST_F(DurabilityTest, RecoveryFromCheckpointImage) {
+  const LineairDB::Config config = db_->GetConfig();
+  const std::string initial_value(1000, 'a');
+  std::vector<std::pair<std::string, std::pair<const std::byte*, size_t>>>
+      entries;
+  for (size_t i = 0; i < 100; i++) {
+    entries.push_back(
+        {"key" + std::to_string(i),
+         {reinterpret_cast<const std::byte*>(initial_value.data()),
+          initial_value.size()}});
+  }
+  // BulkLoad writes a full checkpoint as an image.
+  db_->BulkLoad(entries.begin(), entries.end());
+  db_.reset(nullptr);
+
+  // The recovered values refer to the mapped image until they are updated,
+  // and the next checkpoints rewrite the image while it is mapped.
+  const std::string updated_value(2000, 'b');
+  db_ = std::make_unique<LineairDB::Database>(config);
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               tx.Write("key0",
+                                        reinterpret_cast<const std::byte*>(
+                                            updated_value.data()),
+                                        updated_value.size());
+                             }});
+  std::this_thread::sleep_for(
+      std::chrono::seconds(config.checkpoint_period * 3));
+
+  for (size_t i = 0; i < 2; i++) {
+    db_.reset(nullptr);
+    db_ = std::make_unique<LineairDB::Database>(config);
+    TestHelper::DoTransactions(
+        db_.get(), {[&](LineairDB::Transaction& tx) {
+          auto key0 = tx.Read("key0");
+          ASSERT_EQ(updated_value.size(), key0.second);
+          ASSERT_EQ(std::byte{'b'}, key0.first[updated_value.size() - 1]);
+          for (size_t i = 1; i < entries.size(); i++) {
+            auto value = tx.Read("key" + std::to_string(i));
+            ASSERT_EQ(initial_value.size(), value.second);
+            ASSERT_EQ(0, std::memcmp(initial_value.data(), value.first,
+                                     value.second));
+          }
+        }});
+  }
+}
+
+TEST_F(DurabilityTest, RecoveryOfTables) {
+  const LineairDB::Config config = db_->GetConfig();
+  ASSERT_TRUE(db_->CreateTable("users"));
+  TestHelper::DoTransactions(db_.get(), {[](LineairDB::Transaction& tx) {
+                               tx.Write<int>("alice", 0xBEEF);
+                               tx.SetTable("users");
+                               tx.Write<int>("alice", 0xCAFE);
+                               tx.Write<int>("bob", 0xCAFE);
+                             }});
+  // The rows are recovered from the logs, and then from the checkpoints.
+  for (size_t i = 0; i < 2; i++) {
+    db_.reset(nullptr);
+    db_ = std::make_unique<LineairDB::Database>(config);
+    ASSERT_FALSE(db_->CreateTable("users"));
+    TestHelper::DoTransactions(db_.get(), {[](LineairDB::Transaction& tx) {
+                                 ASSERT_EQ(0xBEEF,
+                                           tx.Read<int>("alice").value());
+                                 ASSERT_FALSE(tx.Read<int>("bob").has_value());
+                                 ASSERT_TRUE(tx.SetTable("users"));
+                                 ASSERT_EQ(0xCAFE,
+                                           tx.Read<int>("alice").value());
+                                 ASSERT_EQ(0xCAFE, tx.Read<int>("bob").value());
+                               }});
+    std::this_thread::sleep_for(
+        std::chrono::seconds(config.checkpoint_period * 3));
+  }
+  ASSERT_TRUE(std::experimental::filesystem::exists(
+      config.work_dir + "/checkpoint.table.users.log"));
+}
+
+TEST_F(DurabilityTest, RecoveryWithLogCompression) {
+  for (const auto codec : {LineairDB::Config::LogCompression::LZ4,
+                           LineairDB::Config::LogCompression::Zstd,
+                           LineairDB::Config::LogCompression::Zlib}) {
+    LineairDB::Config config              = db_->GetConfig();
+    config.log_compression                = codec;
+    config.checkpoint_period              = 30;
+    config.checkpoint_compaction_interval = 2;
+    db_.reset(nullptr);
+    std::experimental::filesystem::remove_all(config.work_dir);
+    db_ = std::make_unique<LineairDB::Database>(config);
+
+    const std::string value(4000, 'a');
+    TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                                 for (size_t i = 0; i < 10; i++) {
+                                   tx.Write("key" + std::to_string(i),
+                                            reinterpret_cast<const std::byte*>(
+                                                value.data()),
+                                            value.size());
+                                 }
+                               }});
+    db_->Fence();
+
+    namespace fs = std::experimental::filesystem;
+    if (LineairDB::Recovery::LogCompressor::IsAvailable(codec)) {
+      size_t log_size = 0;
+      for (const auto& entry : fs::directory_iterator(config.work_dir)) {
+        const auto filename = entry.path().filename().generic_string();
+        if (filename.find("thread") == 0) log_size += fs::file_size(entry);
+      }
+      ASSERT_LT(log_size, value.size());
+    }
+
+    for (size_t i = 0; i < 2; i++) {
+      db_.reset(nullptr);
+      db_ = std::make_unique<LineairDB::Database>(config);
+      TestHelper::DoTransactions(
+          db_.get(), {[&](LineairDB::Transaction& tx) {
+            for (size_t i = 0; i < 10; i++) {
+              auto read = tx.Read("key" + std::to_string(i));
+              ASSERT_EQ(value.size(), read.second);
+              ASSERT_EQ(0, std::memcmp(value.data(), read.first,
+                                       read.second));
+            }
+          }});
+    }
+  }
+}
+
+TEST_F(DurabilityTest, RecoveryWithEagerDurabilityNotification) {
+  for (const auto logger : {LineairDB::Config::Logger::ThreadLocalLogger,
+                            LineairDB::Config::Logger::GroupCommitLogger}) {
+    LineairDB::Config config                    = db_->GetConfig();
+    config.logger                               = logger;
+    config.enable_eager_durability_notification = true;
+    db_.reset(nullptr);
+    std::experimental::filesystem::remove_all(config.work_dir);
+    db_ = std::make_unique<LineairDB::Database>(config);
+
+    // A callback is executed only after the durable epoch has been
+    // persisted.
+    std::atomic<size_t> committed(0);
+    std::atomic<bool> durable(true);
+    for (size_t i = 0; i < 10; i++) {
+      db_->ExecuteTransaction(
+          [i](LineairDB::Transaction& tx) {
+            tx.Write<size_t>("key" + std::to_string(i), i);
+          },
+          [&](const LineairDB::TxStatus status) {
+            if (status != LineairDB::TxStatus::Committed) return;
+            std::ifstream file(config.work_dir + "/durable_epoch.json");
+            size_t durable_epoch = 0;
+            file >> durable_epoch;
+            if (durable_epoch == 0) durable.store(false);
+            committed++;
+          });
+    }
+    db_->Fence();
+    ASSERT_EQ(10, committed.load());
+    ASSERT_TRUE(durable.load());
+
+    db_.reset(nullptr);
+    db_ = std::make_unique<LineairDB::Database>(config);
+    TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                                 for (size_t i = 0; i < 10; i++) {
+                                   auto value = tx.Read<size_t>(
+                                       "key" + std::to_string(i));
+                                   ASSERT_TRUE(value.has_value());
+                                   ASSERT_EQ(i, value.value());
+                                 }
+                               }});
+  }
+}
@@ -22,6 +22,7 @@
 #include <atomic>
 #include <chrono>
 #include <experimental/filesystem>
+#include <future>
 #include <memory>
 #include <thread>
 #include <vector>
@@ -97,3 +98,109 @@ TEST_F(HandlerTransactionTest, UserAbort) {
     });
   }
 }
+
+TEST_F(HandlerTransactionTest, ReusedTransactionStartsFresh) {
+  auto* db = db_.get();
+  {
+    auto& tx = db->BeginTransaction();
+    tx.Write<int>("alice", 1);
+    tx.Abort();
+    db->EndTransaction(tx, [&](auto status) {
+      ASSERT_EQ(LineairDB::TxStatus::Aborted, status);
+    });
+  }
+  {
+    // the callee thread gets the same object, which must not keep the aborted
+    // status and the write set of the previous transaction.
+    auto& tx = db->BeginTransaction();
+    ASSERT_TRUE(tx.IsRunning());
+    ASSERT_FALSE(tx.Read<int>("alice").has_value());
+    tx.Write<int>("bob", 2);
+    db->EndTransaction(tx, [&](auto status) {
+      ASSERT_EQ(LineairDB::TxStatus::Committed, status);
+    });
+  }
+  db->Fence();
+  {
+    auto& tx = db->BeginTransaction();
+    ASSERT_FALSE(tx.Read<int>("alice").has_value());
+    ASSERT_EQ(2, tx.Read<int>("bob").value());
+    db->EndTransaction(tx, [](auto) {});
+  }
+}
+
+TEST_F(HandlerTransactionTest, SnapshotReadOnlyTransaction) {
+  db_.reset(nullptr);
+  config_.enable_snapshot_read = true;
+  db_                          = std::make_unique<LineairDB::Database>(config_);
+  auto* db                     = db_.get();
+  TestHelper::DoTransactions(db, {[](LineairDB::Transaction& tx) {
+                               tx.Write<int>("alice", 1);
+                               tx.Write<int>("bob", 1);
+                             }});
+  db->Fence();
+
+  auto& tx = db->BeginTransaction(LineairDB::TxType::SnapshotReadOnly);
+  ASSERT_EQ(1, tx.Read<int>("alice").value());
+
+  // a writer concurrently overwrites both of the items.
+  std::promise<LineairDB::TxStatus> precommitted;
+  db->ExecuteTransaction(
+      [](LineairDB::Transaction& tx) {
+        tx.Write<int>("alice", 2);
+        tx.Write<int>("bob", 2);
+        tx.Write<int>("carol", 2);
+      },
+      [](auto) {}, [&](auto status) { precommitted.set_value(status); });
+  ASSERT_EQ(LineairDB::TxStatus::Committed, precommitted.get_future().get());
+
+  ASSERT_EQ(1, tx.Read<int>("bob").value());
+  ASSERT_FALSE(tx.Read<int>("carol").has_value());
+  ASSERT_TRUE(db->EndTransaction(tx, [](auto status) {
+    ASSERT_EQ(LineairDB::TxStatus::Committed, status);
+  }));
+  db->Fence();
+
+  auto& latest = db->BeginTransaction(LineairDB::TxType::SnapshotReadOnly);
+  ASSERT_EQ(2, latest.Read<int>("bob").value());
+  ASSERT_EQ(2, latest.Read<int>("carol").value());
+  db->EndTransaction(latest, [](auto) {});
+}
+
+TEST_F(HandlerTransactionTest, ReadOnlyAndWriteOnlyHints) {
+  auto* db = db_.get();
+  TestHelper::DoTransactions(db, {[](LineairDB::Transaction& tx) {
+                               tx.Write<int>("alice", 1);
+                             }});
+  db->Fence();
+
+  auto& reader = db->BeginTransaction(LineairDB::TxType::ReadOnly);
+  ASSERT_EQ(1, reader.Read<int>("alice").value());
+  ASSERT_TRUE(db->EndTransaction(reader, [](auto status) {
+    ASSERT_EQ(LineairDB::TxStatus::Committed, status);
+  }));
+
+  auto& writing_reader = db->BeginTransaction(LineairDB::TxType::ReadOnly);
+  writing_reader.Write<int>("alice", 2);
+  ASSERT_TRUE(writing_reader.IsAborted());
+  db->EndTransaction(writing_reader, [](auto) {});
+
+  auto& writer = db->BeginTransaction(LineairDB::TxType::WriteOnly);
+  writer.Write<int>("bob", 2);
+  ASSERT_EQ(2, writer.Read<int>("bob").value());  // its own write
+  ASSERT_FALSE(writer.IsAborted());
+  ASSERT_TRUE(db->EndTransaction(writer, [](auto status) {
+    ASSERT_EQ(LineairDB::TxStatus::Committed, status);
+  }));
+
+  auto& reading_writer = db->BeginTransaction(LineairDB::TxType::WriteOnly);
+  reading_writer.Read<int>("alice");
+  ASSERT_TRUE(reading_writer.IsAborted());
+  db->EndTransaction(reading_writer, [](auto) {});
+  db->Fence();
+
+  TestHelper::DoTransactions(db, {[](LineairDB::Transaction& tx) {
+                               ASSERT_EQ(1, tx.Read<int>("alice").value());
+                               ASSERT_EQ(2, tx.Read<int>("bob").value());
+                             }});
+}
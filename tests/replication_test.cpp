@@ -0,0 +1,165 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <experimental/filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "lineairdb/config.h"
+#include "lineairdb/database.h"
+#include "lineairdb/transaction.h"
+#include "lineairdb/tx_status.h"
+#include "test_helper.hpp"
+
+class ReplicationTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<LineairDB::Database> primary_;
+  std::unique_ptr<LineairDB::Database> replica_;
+  // The transport between the primary and the replica.
+  std::mutex lock_;
+  std::deque<std::string> shipped_;
+
+  virtual void SetUp() {
+    LineairDB::Config primary_config;
+    primary_config.work_dir          = "./lineairdb_logs_primary";
+    primary_config.max_thread        = 2;
+    primary_config.epoch_duration_ms = 10;
+    LineairDB::Config replica_config;
+    replica_config.work_dir             = "./lineairdb_logs_replica";
+    replica_config.max_thread           = 2;
+    replica_config.epoch_duration_ms    = 10;
+    replica_config.replica              = true;
+    replica_config.enable_logging       = false;
+    replica_config.enable_checkpointing = false;
+    replica_config.enable_recovery      = false;
+    for (auto& dir : {primary_config.work_dir, replica_config.work_dir}) {
+      std::experimental::filesystem::remove_all(dir);
+    }
+    primary_ = std::make_unique<LineairDB::Database>(primary_config);
+    replica_ = std::make_unique<LineairDB::Database>(replica_config);
+    primary_->StartLogShipping([&](const std::string& batch) {
+      std::lock_guard<std::mutex> guard(lock_);
+      shipped_.push_back(batch);
+    });
+  }
+  virtual void TearDown() {
+    const auto primary_dir = primary_->GetConfig().work_dir;
+    const auto replica_dir = replica_->GetConfig().work_dir;
+    primary_.reset(nullptr);
+    replica_.reset(nullptr);
+    std::experimental::filesystem::remove_all(primary_dir);
+    std::experimental::filesystem::remove_all(replica_dir);
+  }
+
+  size_t ApplyShippedLogs() {
+    std::deque<std::string> batches;
+    {
+      std::lock_guard<std::mutex> guard(lock_);
+      batches.swap(shipped_);
+    }
+    for (auto& batch : batches) {
+      EXPECT_TRUE(replica_->ApplyReplicatedLogs(batch));
+    }
+    return batches.size();
+  }
+  std::optional<int> ReadOnReplica(const std::string& key) {
+    auto& tx   = replica_->BeginTransaction();
+    auto value = tx.Read<int>(key);
+    replica_->EndTransaction(tx, [](auto) {});
+    return value;
+  }
+  // Applies the shipped logs until the replica reads `expected` for `key`.
+  bool WaitForReplication(const std::string& key, const int expected) {
+    for (size_t i = 0; i < 10000; i++) {
+      ApplyShippedLogs();
+      if (ReadOnReplica(key) == expected) return true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+  }
+};
+
+TEST_F(ReplicationTest, ReplicateWrites) {
+  TestHelper::DoTransactions(primary_.get(),
+                             {[&](LineairDB::Transaction& tx) {
+                                tx.Write<int>("alice", 1);
+                                tx.Write<int>("bob", 2);
+                              },
+                              [&](LineairDB::Transaction& tx) {
+                                tx.Write<int>("alice", 3);
+                                tx.Delete("bob");
+                              }});
+  ASSERT_TRUE(WaitForReplication("alice", 3));
+  ASSERT_FALSE(ReadOnReplica("bob").has_value());
+
+  // A replica is read-only.
+  auto& tx = replica_->BeginTransaction();
+  tx.Write<int>("alice", 4);
+  ASSERT_TRUE(tx.IsAborted());
+  replica_->EndTransaction(tx, [](auto) {});
+  ASSERT_EQ(3, ReadOnReplica("alice"));
+}
+
+TEST_F(ReplicationTest, BrokenBatchIsNotApplied) {
+  ASSERT_FALSE(replica_->ApplyReplicatedLogs("broken"));
+}
+
+TEST_F(ReplicationTest, ReadConsistentSnapshots) {
+  TestHelper::DoTransactions(primary_.get(), {[&](LineairDB::Transaction& tx) {
+                               tx.Write<int>("alice", 1000);
+                               tx.Write<int>("bob", 1000);
+                             }});
+  ASSERT_TRUE(WaitForReplication("alice", 1000));
+
+  // The primary transfers between alice and bob, while the replica reads
+  // the snapshots of the epochs; they never see a half of a transfer.
+  std::atomic<bool> finished(false);
+  auto transfers = std::async(std::launch::async, [&]() {
+    for (int i = 1; i <= 200; i++) {
+      TestHelper::RetryTransactionUntilCommit(
+          primary_.get(), [&](LineairDB::Transaction& tx) {
+            auto alice = tx.Read<int>("alice");
+            auto bob   = tx.Read<int>("bob");
+            if (!alice.has_value() || !bob.has_value()) return;
+            tx.Write<int>("alice", alice.value() - 1);
+            tx.Write<int>("bob", bob.value() + 1);
+          });
+    }
+    finished.store(true);
+  });
+  auto applier = std::async(std::launch::async, [&]() {
+    while (!finished.load()) ApplyShippedLogs();
+  });
+  while (!finished.load()) {
+    auto& tx   = replica_->BeginTransaction();
+    auto alice = tx.Read<int>("alice");
+    auto bob   = tx.Read<int>("bob");
+    replica_->EndTransaction(tx, [](auto) {});
+    ASSERT_EQ(2000, alice.value() + bob.value());
+  }
+  transfers.wait();
+  applier.wait();
+  ASSERT_TRUE(WaitForReplication("alice", 800));
+  ASSERT_EQ(1200, ReadOnReplica("bob"));
+}
@@ -0,0 +1,156 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "lineairdb/sharded_database.h"
+
+#include <atomic>
+#include <experimental/filesystem>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lineairdb/config.h"
+#include "lineairdb/database.h"
+#include "lineairdb/transaction.h"
+#include "lineairdb/tx_status.h"
+#include "test_helper.hpp"
+
+class ShardedDatabaseTest : public ::testing::Test {
+ protected:
+  std::vector<LineairDB::Config> configs_;
+  std::unique_ptr<LineairDB::ShardedDatabase> db_;
+  virtual void SetUp() {
+    configs_.resize(2);
+    for (size_t shard = 0; shard < configs_.size(); shard++) {
+      configs_[shard].work_dir          = "./lineairdb_logs_" +
+                                          std::to_string(shard);
+      configs_[shard].max_thread        = 2;
+      configs_[shard].epoch_duration_ms = 10;
+      std::experimental::filesystem::remove_all(configs_[shard].work_dir);
+    }
+    Open();
+  }
+  virtual void TearDown() {
+    db_.reset(nullptr);
+    for (auto& config : configs_) {
+      std::experimental::filesystem::remove_all(config.work_dir);
+    }
+  }
+  void Open() {
+    db_.reset(nullptr);
+    db_ = std::make_unique<LineairDB::ShardedDatabase>(
+        configs_, LineairDB::ShardedDatabase::RangePartitioner({"m"}));
+  }
+  LineairDB::TxStatus Transfer(const int amount) {
+    std::atomic<bool> terminated(false);
+    LineairDB::TxStatus result;
+    db_->ExecuteCrossShardTransaction(
+        [&](LineairDB::ShardedTransaction& tx) {
+          auto alice = tx.On("alice").Read<int>("alice");
+          auto zoe   = tx.On("zoe").Read<int>("zoe");
+          if (!alice.has_value() || !zoe.has_value() ||
+              alice.value() < amount) {
+            tx.Abort();
+            return;
+          }
+          tx.On("alice").Write<int>("alice", alice.value() - amount);
+          tx.On("zoe").Write<int>("zoe", zoe.value() + amount);
+        },
+        [&](LineairDB::TxStatus status) {
+          result = status;
+          terminated.store(true);
+        });
+    while (!terminated.load()) std::this_thread::yield();
+    return result;
+  }
+  void Load(const int alice, const int zoe) {
+    db_->ExecuteTransaction(
+        "alice",
+        [&](LineairDB::Transaction& tx) { tx.Write<int>("alice", alice); },
+        [](auto) {});
+    db_->ExecuteTransaction(
+        "zoe", [&](LineairDB::Transaction& tx) { tx.Write<int>("zoe", zoe); },
+        [](auto) {});
+    db_->Fence();
+  }
+  int Get(const std::string& key) {
+    int value = -1;
+    TestHelper::DoTransactions(
+        &db_->GetShard(db_->GetShardOf(key)),
+        {[&](LineairDB::Transaction& tx) {
+          value = tx.Read<int>(key).value_or(-1);
+        }});
+    return value;
+  }
+};
+
+TEST_F(ShardedDatabaseTest, InstantiateDatabasesInOneProcess) {
+  ASSERT_EQ(2u, db_->GetNumberOfShards());
+  ASSERT_EQ(0u, db_->GetShardOf("alice"));
+  ASSERT_EQ(1u, db_->GetShardOf("zoe"));
+
+  Load(10, 20);
+  ASSERT_EQ(10, Get("alice"));
+  ASSERT_EQ(20, Get("zoe"));
+  // Each shard holds only its own keys.
+  TestHelper::DoTransactions(&db_->GetShard(1),
+                             {[&](LineairDB::Transaction& tx) {
+                               ASSERT_FALSE(tx.Read<int>("alice").has_value());
+                             }});
+}
+
+TEST_F(ShardedDatabaseTest, CrossShardTransaction) {
+  Load(10, 20);
+  ASSERT_EQ(LineairDB::TxStatus::Committed, Transfer(3));
+  ASSERT_EQ(7, Get("alice"));
+  ASSERT_EQ(23, Get("zoe"));
+
+  // An aborted transaction leaves no writes in any shard.
+  ASSERT_EQ(LineairDB::TxStatus::Aborted, Transfer(100));
+  ASSERT_EQ(7, Get("alice"));
+  ASSERT_EQ(23, Get("zoe"));
+}
+
+TEST_F(ShardedDatabaseTest, ConcurrentCrossShardTransactions) {
+  for (auto protocol : {LineairDB::Config::Silo, LineairDB::Config::SiloNWR,
+                        LineairDB::Config::TwoPhaseLockingWoundWait}) {
+    db_.reset(nullptr);
+    for (auto& config : configs_) {
+      config.concurrency_control_protocol = protocol;
+      std::experimental::filesystem::remove_all(config.work_dir);
+    }
+    Open();
+    Load(1000, 1000);
+
+    std::atomic<size_t> committed(0);
+    std::vector<std::future<void>> clients;
+    for (size_t i = 0; i < 4; i++) {
+      clients.emplace_back(std::async(std::launch::async, [&]() {
+        for (size_t j = 0; j < 100; j++) {
+          if (Transfer(1) == LineairDB::TxStatus::Committed) committed++;
+        }
+      }));
+    }
+    for (auto& client : clients) client.wait();
+
+    ASSERT_LT(0u, committed.load());
+    // The sum of the balances over the shards never changes.
+    ASSERT_EQ(2000, Get("alice") + Get("zoe"));
+    ASSERT_EQ(static_cast<int>(1000 - committed.load()), Get("alice"));
+  }
+}
@@ -0,0 +1,78 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "util/adaptive_epoch_controller.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+
+#include "gtest/gtest.h"
+
+namespace {
+constexpr uint64_t Millisecond = 1000 * 1000;
+
+// Runs the controller for 10 seconds of epochs; `rate` gives the commits per
+// millisecond for an epoch duration.
+uint64_t Converge(LineairDB::AdaptiveEpochController& controller,
+                  const std::function<double(uint64_t)>& rate,
+                  const uint64_t bytes_per_commit = 100) {
+  for (uint64_t elapsed = 0; elapsed < 10000 * Millisecond;) {
+    const uint64_t duration = controller.GetDuration();
+    const auto commits =
+        static_cast<uint64_t>(rate(duration) * duration / Millisecond);
+    controller.Observe(commits, commits * bytes_per_commit, duration);
+    elapsed += duration;
+  }
+  return controller.GetDuration();
+}
+}  // namespace
+
+TEST(AdaptiveEpochControllerTest, ShortensIdleEpochs) {
+  LineairDB::AdaptiveEpochController controller(
+      40 * Millisecond, 1 * Millisecond, 100 * Millisecond, 1 << 20);
+  ASSERT_EQ(1 * Millisecond, Converge(controller, [](uint64_t) { return 0; }));
+}
+
+TEST(AdaptiveEpochControllerTest, ShortensEpochsOfUnsaturatedWorkload) {
+  // The commit rate is bounded by the clients, not by the epochs.
+  LineairDB::AdaptiveEpochController controller(
+      40 * Millisecond, 1 * Millisecond, 100 * Millisecond, 1 << 20);
+  ASSERT_GT(10 * Millisecond,
+            Converge(controller, [](uint64_t) { return 100; }));
+}
+
+TEST(AdaptiveEpochControllerTest, LengthensEpochsOfSaturatedWorkload) {
+  // Each epoch costs 5ms of the workers.
+  auto saturated = [](uint64_t duration) {
+    return 1000.0 * std::max<double>(0, duration - 5 * Millisecond) /
+           duration;
+  };
+  LineairDB::AdaptiveEpochController controller(
+      10 * Millisecond, 1 * Millisecond, 100 * Millisecond, 1 << 30);
+  ASSERT_LT(50 * Millisecond, Converge(controller, saturated));
+}
+
+TEST(AdaptiveEpochControllerTest, BoundsLogBytesPerEpoch) {
+  auto saturated = [](uint64_t duration) {
+    return 1000.0 * std::max<double>(0, duration - 5 * Millisecond) /
+           duration;
+  };
+  // 1000 commits of 1KiB per millisecond; 10MiB is about 10ms.
+  LineairDB::AdaptiveEpochController controller(
+      10 * Millisecond, 1 * Millisecond, 100 * Millisecond, 10 << 20);
+  ASSERT_GT(20 * Millisecond, Converge(controller, saturated, 1024));
+}
@@ -0,0 +1,70 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "callback/callback_manager.h"
+
+#include <lineairdb/config.h>
+#include <lineairdb/tx_status.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+TEST(CallbackManagerTest, ExecuteCallbacksOfStableEpochs) {
+  LineairDB::Config config;
+  LineairDB::Callback::CallbackManager manager(config);
+  std::atomic<size_t> executed(0);
+  auto callback = [&](LineairDB::TxStatus status) {
+    ASSERT_EQ(LineairDB::TxStatus::Committed, status);
+    executed++;
+  };
+  for (LineairDB::EpochNumber epoch = 1; epoch <= 3; epoch++) {
+    manager.Enqueue(callback, epoch);
+    manager.Enqueue(callback, epoch);
+  }
+
+  manager.ExecuteCallbacks(1);
+  ASSERT_EQ(0, executed.load());
+  manager.ExecuteCallbacks(3);
+  ASSERT_EQ(4, executed.load());
+  manager.ExecuteCallbacks(4);
+  ASSERT_EQ(6, executed.load());
+  manager.WaitForAllCallbacksToBeExecuted();
+}
+
+TEST(CallbackManagerTest, ExecuteEntrustedCallbacksOnOtherThreads) {
+  LineairDB::Config config;
+  LineairDB::Callback::CallbackManager manager(config);
+  std::atomic<size_t> executed(0);
+  auto callback = [&](LineairDB::TxStatus) { executed++; };
+  std::thread entrusting([&]() {
+    for (LineairDB::EpochNumber epoch = 1; epoch <= 2; epoch++) {
+      manager.Enqueue(callback, epoch, true);
+    }
+  });
+  entrusting.join();
+
+  std::thread executor([&]() {
+    // Let the fence wait for the executor.
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    manager.ExecuteCallbacks(3);
+  });
+  manager.WaitForAllCallbacksToBeExecuted();
+  ASSERT_EQ(2, executed.load());
+  executor.join();
+}
@@ -0,0 +1,96 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "recovery/checkpoint_image.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <msgpack.hpp>
+#include <string>
+#include <string_view>
+
+#include "gtest/gtest.h"
+
+using LineairDB::Recovery::CheckpointImage;
+using LineairDB::Recovery::CheckpointWriter;
+
+TEST(CheckpointImageTest, WritesSortedImage) {
+  const std::string filename = "checkpoint_image_test.log";
+  {
+    // a small buffer lets the entries span many chunks.
+    CheckpointImage::Writer writer(filename, 2, 3, 1024);
+    for (size_t i = 0; i < 300; i++) {
+      LineairDB::TransactionId tid(1, i);
+      writer.Add(i % 3, "key" + std::to_string(i), std::string(i, 'v'), tid);
+    }
+    writer.Finish();
+  }
+  ASSERT_TRUE(CheckpointImage::IsCheckpointImage(filename));
+
+  {
+    CheckpointImage image(filename);
+    ASSERT_TRUE(image.IsOpen());
+    ASSERT_EQ(300u, image.size());
+    for (size_t i = 0; i < image.size(); i++) {
+      const auto entry = image[i];
+      if (0 < i) { ASSERT_LT(image[i - 1].key, entry.key); }
+      const size_t n = std::stoul(std::string(entry.key.substr(3)));
+      ASSERT_EQ(std::string(n, 'v'), entry.value);
+      ASSERT_EQ(n, entry.tid.tid);
+    }
+  }
+  std::remove(filename.c_str());
+
+  CheckpointImage absent(filename);
+  ASSERT_FALSE(absent.IsOpen());
+}
+
+TEST(CheckpointImageTest, DetectsBrokenDirectory) {
+  const std::string filename = "checkpoint_image_broken_test.log";
+  {
+    CheckpointImage::Writer writer(filename, 2, 1, 1024);
+    writer.Add(0, "key", "value", LineairDB::TransactionId(1, 1));
+    writer.Finish();
+  }
+  {  // overwrite the transaction id in the directory
+    std::fstream file(filename,
+                      std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(-1, std::ios::end);
+    file.put('\x7f');
+  }
+  ASSERT_EXIT(CheckpointImage image(filename),
+              ::testing::ExitedWithCode(EXIT_FAILURE), "");
+  std::remove(filename.c_str());
+}
+
+TEST(CheckpointImageTest, ChecksummedChunk) {
+  const std::string records = "serialized records";
+  const auto framed =
+      CheckpointWriter::Checksummed(records.data(), records.size());
+  auto oh  = msgpack::unpack(framed.data(), framed.size());
+  auto ext = oh.get().via.ext;
+  ASSERT_EQ(CheckpointWriter::ChecksumExtensionType, ext.type());
+
+  std::string payload(ext.data(), ext.size);
+  std::string_view verified;
+  ASSERT_TRUE(CheckpointWriter::Verify(payload.data(), payload.size(),
+                                       verified));
+  ASSERT_EQ(records, verified);
+  payload.back() ^= 1;
+  ASSERT_FALSE(CheckpointWriter::Verify(payload.data(), payload.size(),
+                                        verified));
+}
@@ -0,0 +1,32 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "util/checksum.hpp"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+TEST(ChecksumTest, Crc32c) {
+  const std::string check = "123456789";
+  ASSERT_EQ(0xE3069283u, LineairDB::Util::Crc32c(check.data(), check.size()));
+  ASSERT_EQ(0u, LineairDB::Util::Crc32c(check.data(), 0));
+
+  // A checksum can be computed piecewise.
+  const auto first = LineairDB::Util::Crc32c(check.data(), 4);
+  ASSERT_EQ(0xE3069283u,
+            LineairDB::Util::Crc32c(check.data() + 4, check.size() - 4, first));
+}
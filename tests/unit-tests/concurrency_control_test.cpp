@@ -25,6 +25,9 @@
 #include <experimental/filesystem>
 #include <future>
 #include <memory>
+#include <optional>
+#include <set>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -52,12 +55,16 @@ class ConcurrencyControlTest
   }
 };
 
-const std::array<std::string, 3> Protocols{"Silo", "SiloNWR", "2PL"};
+const std::array<std::string, 5> Protocols{"Silo", "SiloNWR", "2PL",
+                                           "2PLWaitDie", "2PLWoundWait"};
 INSTANTIATE_TEST_SUITE_P(
     ForEachProtocol, ConcurrencyControlTest,
-    ::testing::Values(LineairDB::Config::ConcurrencyControl::Silo,
-                      LineairDB::Config::ConcurrencyControl::SiloNWR,
-                      LineairDB::Config::ConcurrencyControl::TwoPhaseLocking),
+    ::testing::Values(
+        LineairDB::Config::ConcurrencyControl::Silo,
+        LineairDB::Config::ConcurrencyControl::SiloNWR,
+        LineairDB::Config::ConcurrencyControl::TwoPhaseLocking,
+        LineairDB::Config::ConcurrencyControl::TwoPhaseLockingWaitDie,
+        LineairDB::Config::ConcurrencyControl::TwoPhaseLockingWoundWait),
     [](const testing::TestParamInfo<LineairDB::Config::ConcurrencyControl>&
            param) { return Protocols[param.index]; });
 
@@ -93,6 +100,167 @@ TEST_P(ConcurrencyControlTest, IncrementOnMultiThreads) {
                              }});
 }
 
+TEST_P(ConcurrencyControlTest, IncrementWithEachLockWaitPolicy) {
+  for (auto policy : {LineairDB::Config::LockWaitPolicy::SpinThenBackoff,
+                      LineairDB::Config::LockWaitPolicy::SpinThenPark}) {
+    LineairDB::Config config = db_->GetConfig();
+    config.lock_wait_policy  = policy;
+    db_.reset(nullptr);
+    db_ = std::make_unique<LineairDB::Database>(config);
+
+    TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                                 tx.Write<int>("alice", 0);
+                               }});
+    db_->Fence();
+    TransactionProcedure increment([](LineairDB::Transaction& tx) {
+      auto alice = tx.Read<int>("alice");
+      if (!alice.has_value()) return tx.Abort();
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      tx.Write<int>("alice", alice.value() + 1);
+    });
+    size_t committed_count = TestHelper::DoTransactionsOnMultiThreads(
+        db_.get(), {increment, increment, increment, increment});
+    db_->Fence();
+
+    TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                                 auto alice = tx.Read<int>("alice");
+                                 ASSERT_TRUE(alice.has_value());
+                                 ASSERT_EQ(committed_count, alice.value());
+                               }});
+  }
+}
+
+TEST_P(ConcurrencyControlTest, MergeOnMultiThreads) {
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               tx.Write<int64_t>("alice", 0);
+                             }});
+  db_->Fence();
+
+  TransactionProcedure increment([](LineairDB::Transaction& tx) {
+    tx.Merge<int64_t>("alice", 1, LineairDB::MergeOperator::Add);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  size_t committed_count = TestHelper::DoTransactionsOnMultiThreads(
+      db_.get(), {increment, increment, increment, increment});
+  db_->Fence();
+  const auto protocol = db_->GetConfig().concurrency_control_protocol;
+  if (protocol == LineairDB::Config::ConcurrencyControl::Silo ||
+      protocol == LineairDB::Config::ConcurrencyControl::SiloNWR) {
+    ASSERT_EQ(4u, committed_count);  // the merges do not conflict
+  }
+
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               auto alice = tx.Read<int64_t>("alice");
+                               ASSERT_TRUE(alice.has_value());
+                               ASSERT_EQ(committed_count, alice.value());
+                             }});
+}
+
+TEST_P(ConcurrencyControlTest, IncrementHotKeys) {
+  LineairDB::Config config = db_->GetConfig();
+  config.hot_key_threshold = 1;
+  db_.reset(nullptr);
+  db_ = std::make_unique<LineairDB::Database>(config);
+
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               tx.Write<int>("alice", 0);
+                               tx.Write<int>("bob", 0);
+                             }});
+  db_->Fence();
+  // the keys are locked in both orders once they get hot.
+  auto increment = [](const std::string& first, const std::string& second) {
+    return TransactionProcedure([=](LineairDB::Transaction& tx) {
+      auto a = tx.Read<int>(first);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      auto b = tx.Read<int>(second);
+      if (!a.has_value() || !b.has_value()) return tx.Abort();
+      tx.Write<int>(first, a.value() + 1);
+      tx.Write<int>(second, b.value() + 1);
+    });
+  };
+  size_t committed_count = 0;
+  for (size_t round = 0; round < 10; round++) {
+    committed_count += TestHelper::DoTransactionsOnMultiThreads(
+        db_.get(),
+        {increment("alice", "bob"), increment("bob", "alice"),
+         increment("alice", "bob"), increment("bob", "alice")});
+  }
+  db_->Fence();
+
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               auto alice = tx.Read<int>("alice");
+                               auto bob   = tx.Read<int>("bob");
+                               ASSERT_TRUE(alice.has_value());
+                               ASSERT_TRUE(bob.has_value());
+                               ASSERT_EQ(committed_count, alice.value());
+                               ASSERT_EQ(committed_count, bob.value());
+                             }});
+}
+
+TEST_P(ConcurrencyControlTest, SnapshotReadOnlyTransactions) {
+  LineairDB::Config config    = db_->GetConfig();
+  config.enable_snapshot_read = true;
+  config.epoch_duration_ms    = 1;
+  db_.reset(nullptr);
+  db_ = std::make_unique<LineairDB::Database>(config);
+
+  // transfers keep the sum of the balances.
+  constexpr int Accounts = 10;
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               for (int i = 0; i < Accounts; i++) {
+                                 tx.Write<int>("account" + std::to_string(i),
+                                               100);
+                               }
+                             }});
+  db_->Fence();
+
+  std::atomic<bool> finished(false);
+  std::atomic<size_t> snapshot_aborts(0);
+  auto writer = std::async(std::launch::async, [&]() {
+    for (int i = 0; !finished.load(); i++) {
+      db_->ExecuteTransaction(
+          [i](LineairDB::Transaction& tx) {
+            const auto from = "account" + std::to_string(i % Accounts);
+            const auto to   = "account" + std::to_string((i + 1) % Accounts);
+            auto balance    = tx.Read<int>(from);
+            auto other      = tx.Read<int>(to);
+            if (!balance.has_value() || !other.has_value()) return tx.Abort();
+            tx.Write<int>(from, balance.value() - 1);
+            tx.Write<int>(to, other.value() + 1);
+          },
+          [](auto) {});
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+  });
+
+  for (size_t round = 0; round < 100; round++) {
+    db_->ExecuteTransaction(
+        LineairDB::TxType::SnapshotReadOnly,
+        [&](LineairDB::Transaction& tx) {
+          int sum = 0;
+          for (int i = 0; i < Accounts; i++) {
+            auto balance = tx.Read<int>("account" + std::to_string(i));
+            if (!balance.has_value()) return tx.Abort();
+            sum += balance.value();
+          }
+          ASSERT_EQ(Accounts * 100, sum);
+        },
+        [&](auto status) {
+          if (status == LineairDB::TxStatus::Aborted) snapshot_aborts++;
+        });
+    std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+  finished.store(true);
+  writer.wait();
+  db_->Fence();
+
+  const auto protocol = config.concurrency_control_protocol;
+  if (protocol == LineairDB::Config::ConcurrencyControl::Silo ||
+      protocol == LineairDB::Config::ConcurrencyControl::SiloNWR) {
+    ASSERT_EQ(0u, snapshot_aborts.load());
+  }
+}
+
 TEST_P(ConcurrencyControlTest, AvoidingDeadLock) {
   TransactionProcedure readX_writeY([](LineairDB::Transaction& tx) {
     tx.Read<int>("x");
@@ -107,6 +275,73 @@ TEST_P(ConcurrencyControlTest, AvoidingDeadLock) {
       db_.get(), {readX_writeY, readX_writeY, readY_writeX, readY_writeX});
 }
 
+TEST_P(ConcurrencyControlTest, AvoidingDeadLockOfLargeWriteSets) {
+  constexpr int Keys = 2000;
+  // the writers write all the keys in the opposite orders.
+  auto write_all = [](int value, bool ascending) {
+    return [=](LineairDB::Transaction& tx) {
+      for (int i = 0; i < Keys; i++) {
+        const int key = ascending ? i : Keys - 1 - i;
+        tx.Write<int>("key" + std::to_string(key), value);
+      }
+    };
+  };
+  TestHelper::DoTransactionsOnMultiThreads(
+      db_.get(), {write_all(1, true), write_all(2, false),
+                  write_all(3, true), write_all(4, false)});
+  db_->Fence();
+
+  TestHelper::DoTransactions(db_.get(), {[&](LineairDB::Transaction& tx) {
+                               // the keys are of the last committed writer,
+                               // if any; 2PL may abort all of them.
+                               const auto first = tx.Read<int>("key0");
+                               for (int i = 1; i < Keys; i++) {
+                                 const auto key = "key" + std::to_string(i);
+                                 ASSERT_EQ(first, tx.Read<int>(key));
+                               }
+                             }});
+}
+
+TEST_P(ConcurrencyControlTest, RetriedTransactionIsNotStarved) {
+  // NOTE: Only WaitDie and WoundWait prioritize the older transactions; the
+  // other protocols do not bound the retries of a transaction.
+  if (GetParam() != LineairDB::Config::ConcurrencyControl::
+                        TwoPhaseLockingWaitDie &&
+      GetParam() != LineairDB::Config::ConcurrencyControl::
+                        TwoPhaseLockingWoundWait) {
+    return;
+  }
+  constexpr int Keys = 16;
+  constexpr size_t MaxRetries = 1000;
+
+  // the short transactions keep writing each of the keys that the long one
+  // writes all, until the long one commits.
+  std::atomic<bool> long_committed(false);
+  std::vector<std::future<void>> shorts;
+  for (int thread = 0; thread < 3; thread++) {
+    shorts.push_back(std::async(std::launch::async, [&, thread]() {
+      for (int i = thread; !long_committed.load(); i++) {
+        auto& tx = db_->BeginTransaction();
+        tx.Write<int>("key" + std::to_string(i % Keys), thread);
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        db_->EndTransaction(tx, [](auto) {});
+      }
+    }));
+  }
+
+  size_t retries = 0;
+  for (; retries < MaxRetries; retries++) {
+    auto& tx = db_->BeginTransaction();
+    for (int i = 0; i < Keys && !tx.IsAborted(); i++) {
+      tx.Write<int>("key" + std::to_string(i), -1);
+    }
+    if (db_->EndTransaction(tx, [](auto) {})) break;
+  }
+  long_committed.store(true);
+  for (auto& job : shorts) { job.wait(); }
+  ASSERT_GT(MaxRetries, retries);
+}
+
 TEST_P(ConcurrencyControlTest, AvoidingDirtyReadAnomaly) {
   TransactionProcedure insertTenTimes([](LineairDB::Transaction& tx) {
     int value = 0xBEEF;
@@ -190,6 +425,88 @@ TEST_P(ConcurrencyControlTest, AvoidingWriteSkewAnomaly) {
                              }});
 }
 
+TEST_P(ConcurrencyControlTest, AvoidingWriteSkewAnomalyOnAbsentKeys) {
+  // Each transaction inserts its key only if the other key is absent; at
+  // most one of them commits its insertion.
+  for (size_t round = 0; round < 20; round++) {
+    const auto alice = "alice" + std::to_string(round);
+    const auto bob   = "bob" + std::to_string(round);
+    auto insert_unless = [](const std::string& absent,
+                            const std::string& key) {
+      return [=](LineairDB::Transaction& tx) {
+        if (tx.Read<int>(absent).has_value()) return tx.Abort();
+        tx.Write<int>(key, 1);
+      };
+    };
+    TestHelper::DoTransactionsOnMultiThreads(
+        db_.get(), {insert_unless(bob, alice), insert_unless(alice, bob)});
+  }
+  db_->Fence();
+
+  TestHelper::DoTransactions(db_.get(), {[](LineairDB::Transaction& tx) {
+                               for (size_t round = 0; round < 20; round++) {
+                                 const auto r     = std::to_string(round);
+                                 const bool alice =
+                                     tx.Read<int>("alice" + r).has_value();
+                                 const bool bob =
+                                     tx.Read<int>("bob" + r).has_value();
+                                 ASSERT_FALSE(alice && bob);
+                               }
+                             }});
+}
+
+TEST_P(ConcurrencyControlTest, ScanIndexOnMultiThreads) {
+  // The rows move between the secondary keys "even" and "odd" while the
+  // other transactions scan them, and then a scan of both finds every row
+  // once.
+  constexpr int Rows = 8;
+  db_->BulkLoad([&](const auto& load) {
+    for (int i = 0; i < Rows; i++) {
+      const int value = 0;
+      load("row" + std::to_string(i),
+           reinterpret_cast<const std::byte*>(&value), sizeof(value));
+    }
+  });
+  db_->CreateSecondaryIndex(
+      "parity", [](std::string_view, const auto value) {
+        const int parity = *reinterpret_cast<const int*>(value.first) % 2;
+        return std::optional<std::string>(parity == 0 ? "even" : "odd");
+      });
+
+  std::vector<TransactionProcedure> procedures;
+  for (int i = 0; i < Rows; i++) {
+    procedures.emplace_back([i](LineairDB::Transaction& tx) {
+      const auto key = "row" + std::to_string(i % 2);
+      auto value     = tx.Read<int>(key);
+      if (!value.has_value()) return tx.Abort();
+      tx.Write<int>(key, value.value() + 1);
+    });
+    procedures.emplace_back([](LineairDB::Transaction& tx) {
+      tx.ScanIndex<int>("parity", "even", "odd",
+                        [](auto, auto) { return false; });
+    });
+  }
+  TestHelper::DoTransactionsOnMultiThreads(db_.get(), procedures);
+  db_->Fence();
+
+  // The scan conflicts with the removals of the old entries in background.
+  std::set<std::string> keys;
+  TestHelper::RetryTransactionUntilCommit(
+      db_.get(), [&](LineairDB::Transaction& tx) {
+        keys.clear();
+        for (const int parity : {0, 1}) {
+          const std::string secondary_key = parity == 0 ? "even" : "odd";
+          tx.ScanIndex<int>("parity", secondary_key, secondary_key,
+                            [&](auto key, auto value) {
+                              EXPECT_EQ(parity, value % 2);
+                              keys.emplace(key);
+                              return false;
+                            });
+        }
+      });
+  ASSERT_EQ(static_cast<size_t>(Rows), keys.size());
+}
+
 TEST_P(ConcurrencyControlTest, AvoidingReadOnlyAnomaly) {
   // Reference: Example 1.3 in
   // https://www.cse.iitb.ac.in/infolab/Data/Courses/CS632/2009/Papers/p492-fekete.pdf
@@ -356,4 +673,37 @@ TEST_P(ConcurrencyControlTest, Recoverability) {
   }
   db_->Fence();
   ASSERT_FALSE(recoverability_failure);
-}
\ No newline at end of file
+}
+TEST_P(ConcurrencyControlTest, ZeroCopyReadOfLargeValues) {
+  LineairDB::Config config     = db_->GetConfig();
+  config.enable_zero_copy_read = true;
+  config.epoch_duration_ms     = 1;
+  db_.reset(nullptr);
+  db_ = std::make_unique<LineairDB::Database>(config);
+
+  static constexpr size_t ValueSize = 4096;
+  TransactionProcedure overwrite([](LineairDB::Transaction& tx) {
+    for (size_t idx = 0; idx < 100; idx++) {
+      std::vector<std::byte> value(ValueSize, std::byte(idx));
+      tx.Write("alice", value.data(), value.size());
+    }
+  });
+  TransactionProcedure read([](LineairDB::Transaction& tx) {
+    for (size_t idx = 0; idx < 10; idx++) {
+      auto [value, size] = tx.Read("alice");
+      if (value == nullptr) continue;
+      ASSERT_EQ(ValueSize, size);
+      // the value must not be overwritten while this transaction is running
+      const auto first = value[0];
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      for (size_t i = 0; i < size; i++) { ASSERT_EQ(first, value[i]); }
+    }
+  });
+
+  ASSERT_NO_THROW({
+    for (size_t round = 0; round < 10; round++) {
+      TestHelper::DoTransactionsOnMultiThreads(
+          db_.get(), {overwrite, overwrite, read, read});
+    }
+  });
+}
@@ -16,9 +16,18 @@
 
 #include "index/concurrent_table.h"
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <optional>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "index/key_store.hpp"
+#include "index/precision_locking_index/range_index/disjoint_range_set.hpp"
+#include "index/precision_locking_index/range_index/impl/olc_btree_container.hpp"
 #include "types/definitions.h"
 #include "util/epoch_framework.hpp"
 #include "util/logger.hpp"
@@ -52,6 +61,25 @@ TEST(ConcurrentTableTest, GetOrInsert) {
   ASSERT_NE(nullptr, table.GetOrInsert("alice"));
 }
 
+TEST(ConcurrentTableTest, GetOrAbsence) {
+  LineairDB::EpochFramework epoch;
+  epoch.Start();
+  LineairDB::Index::ConcurrentTable table(epoch);
+  LineairDB::TransactionId absence_tid;
+  auto* absence = table.GetOrAbsence("alice", absence_tid);
+  ASSERT_TRUE(table.IsAbsence(absence));
+  ASSERT_EQ(nullptr, table.Get("alice"));
+  ASSERT_TRUE(absence->transaction_id.load() == absence_tid);
+
+  auto* item = table.GetOrInsert("alice");
+  ASSERT_EQ(item, table.GetOrAbsence("alice", absence_tid));
+  ASSERT_FALSE(table.IsAbsence(item));
+  auto [before, after] = table.IncreaseAbsence("alice");
+  ASSERT_TRUE(before == absence_tid);
+  ASSERT_TRUE(absence->transaction_id.load() == after);
+  ASSERT_FALSE(after == before);
+}
+
 TEST(ConcurrentTableTest, ConcurrentInserting) {
   std::vector<std::thread> threads;
   LineairDB::EpochFramework epoch;
@@ -180,3 +208,481 @@ TEST(ConcurrentTableTest, ForEachIsSafeWithRehashing) {
     thread.join();
   }
 }
+
+TEST(ConcurrentTableTest, ScanWithOLCTreeIndex) {
+  LineairDB::EpochFramework epoch;
+  LineairDB::Config config;
+  config.index_structure =
+      LineairDB::Config::IndexStructure::HashTableWithOLCTreeIndex;
+  epoch.Start();
+  LineairDB::Index::ConcurrentTable table(epoch, config);
+  // Insertions are applied to the range index after the epoch gets stable.
+  epoch.MakeMeOnline();
+  ASSERT_TRUE(table.Put("alice", {}));
+  ASSERT_TRUE(table.Put("bob", {}));
+  ASSERT_TRUE(table.Put("carol", {}));
+  epoch.MakeMeOffline();
+  epoch.Sync();
+  epoch.Sync();
+  epoch.Sync();
+
+  std::vector<std::string> keys;
+  auto count = table.Scan("alice", "carol", [&](auto key) {
+    keys.emplace_back(key);
+    return false;
+  });
+  ASSERT_TRUE(count.has_value());
+  ASSERT_EQ(3, count.value());
+  ASSERT_EQ((std::vector<std::string>{"alice", "bob", "carol"}), keys);
+}
+
+TEST(ConcurrentTableTest, OLCBTreeContainerIsSortedUnderConcurrentPut) {
+  LineairDB::Index::OLCBTreeContainer tree;
+  std::vector<std::thread> threads;
+  std::atomic<bool> finished{false};
+
+  constexpr size_t working_set_size = 8192;
+  auto to_key                       = [](size_t i) {
+    auto key = std::to_string(i);
+    return std::string(8 - key.size(), '0') + key;
+  };
+  for (size_t i = 0; i < 4; i++) {
+    threads.emplace_back([&, i]() {
+      // Interleave the key ranges so that threads share leaves.
+      for (size_t j = 0; j < working_set_size; j++) {
+        tree.Put(to_key(j * 4 + i), false);
+      }
+    });
+  }
+  std::thread scanner([&]() {
+    while (!finished.load()) {
+      std::string previous;
+      tree.Scan("", std::nullopt, [&](auto key) {
+        EXPECT_LT(previous, key);
+        previous = std::string(key);
+        return false;
+      });
+    }
+  });
+  for (auto& thread : threads) { thread.join(); }
+  finished.store(true);
+  scanner.join();
+
+  auto count = tree.Scan("", std::nullopt, [](auto) { return false; });
+  ASSERT_EQ(working_set_size * 4, count);
+
+  tree.Put(to_key(42), true);
+  count = tree.Scan(to_key(40), to_key(49), [](auto) { return false; });
+  ASSERT_EQ(9, count);
+}
+
+TEST(ConcurrentTableTest, DisjointRangeSetMergesOverlappingRanges) {
+  LineairDB::Index::DisjointRangeSet set;
+  ASSERT_FALSE(set.Contains("alice"));
+  set.Insert("bob", "dave");
+  set.Insert("carol", "erin");
+  set.Insert("zed", "zed");
+  ASSERT_EQ(2, set.size());
+  ASSERT_FALSE(set.Contains("alice"));
+  ASSERT_TRUE(set.Contains("bob"));
+  ASSERT_TRUE(set.Contains("erin"));
+  ASSERT_FALSE(set.Contains("frank"));
+  ASSERT_TRUE(set.Contains("zed"));
+
+  set.Insert("alice", "bob");
+  ASSERT_EQ(2, set.size());
+  ASSERT_TRUE(set.Contains("alice"));
+
+  set.Insert("frank", std::nullopt);
+  ASSERT_EQ(2, set.size());
+  ASSERT_TRUE(set.Contains("zzz"));
+  ASSERT_FALSE(set.Contains("ez"));
+}
+
+TEST(ConcurrentTableTest, TremendousGetAndPutWithCuckooHashing) {
+  std::vector<std::thread> threads;
+  LineairDB::EpochFramework epoch;
+  LineairDB::Config config;
+  config.hash_index_probing =
+      LineairDB::Config::HashIndexProbing::CuckooHashing;
+  config.rehash_threshold = 0.9;
+  epoch.Start();
+  LineairDB::Index::ConcurrentTable table(epoch, config);
+
+  constexpr size_t working_set_size = 8192;
+  for (size_t i = 0; i < 10; i++) {
+    threads.emplace_back([&, i]() {
+      for (size_t j = i * working_set_size; j < (i + 1) * working_set_size;
+           j++) {
+        table.Get(std::to_string(j - working_set_size));
+        table.Put(std::to_string(j), {});
+      }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  for (size_t j = 0; j < 10 * working_set_size; j++) {
+    ASSERT_NE(nullptr, table.Get(std::to_string(j)));
+  }
+}
+
+TEST(ConcurrentTableTest, LongKeysAreStoredOutOfLine) {
+  for (auto probing : {LineairDB::Config::HashIndexProbing::LinearProbing,
+                       LineairDB::Config::HashIndexProbing::CuckooHashing}) {
+    LineairDB::EpochFramework epoch;
+    LineairDB::Config config;
+    config.hash_index_probing = probing;
+    epoch.Start();
+    LineairDB::Index::ConcurrentTable table(epoch, config);
+
+    // The prefix is shared, so that keys differ only after the inline size.
+    const std::string prefix(64, 'k');
+    constexpr size_t working_set_size = 8192;
+    for (size_t i = 0; i < working_set_size; i++) {
+      table.Put(prefix + std::to_string(i), {});
+    }
+    for (size_t i = 0; i < working_set_size; i++) {
+      ASSERT_NE(nullptr, table.Get(prefix + std::to_string(i)));
+    }
+    ASSERT_EQ(nullptr, table.Get(prefix));
+    ASSERT_EQ(nullptr, table.Get(std::to_string(0)));
+
+    size_t count = 0;
+    table.ForEach([&](auto key, auto&) {
+      EXPECT_EQ(prefix, key.substr(0, prefix.size()));
+      count++;
+      return true;
+    });
+    ASSERT_EQ(working_set_size, count);
+  }
+}
+
+TEST(ConcurrentTableTest, InsertedKeysAreVisibleDuringRehashing) {
+  // Test scenario: tables are migrated while threads insert keys and read
+  // the keys they have inserted.
+  std::vector<std::thread> threads;
+  LineairDB::EpochFramework epoch;
+  LineairDB::Config config;
+  config.rehash_threshold = 0.5;
+  epoch.Start();
+  LineairDB::Index::ConcurrentTable table(epoch, config);
+
+  constexpr size_t working_set_size = 16384;
+  for (size_t i = 0; i < 4; i++) {
+    threads.emplace_back([&, i]() {
+      for (size_t j = i * working_set_size; j < (i + 1) * working_set_size;
+           j++) {
+        table.Put(std::to_string(j), {});
+        ASSERT_NE(nullptr, table.Get(std::to_string(j)));
+        ASSERT_NE(nullptr, table.Get(std::to_string(i * working_set_size)));
+      }
+    });
+  }
+  for (auto& thread : threads) { thread.join(); }
+  for (size_t j = 0; j < 4 * working_set_size; j++) {
+    ASSERT_NE(nullptr, table.Get(std::to_string(j)));
+  }
+}
+
+TEST(ConcurrentTableTest, MultiGet) {
+  for (auto probing : {LineairDB::Config::HashIndexProbing::LinearProbing,
+                       LineairDB::Config::HashIndexProbing::CuckooHashing}) {
+    LineairDB::EpochFramework epoch;
+    LineairDB::Config config;
+    config.hash_index_probing = probing;
+    epoch.Start();
+    LineairDB::Index::ConcurrentTable table(epoch, config);
+
+    constexpr size_t working_set_size = 100;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < working_set_size; i++) {
+      names.push_back(std::to_string(i));
+      if (i % 2 == 0) table.Put(names.back(), {});
+    }
+    std::vector<std::string_view> keys(names.begin(), names.end());
+
+    const auto items = table.MultiGet(keys);
+    ASSERT_EQ(working_set_size, items.size());
+    for (size_t i = 0; i < working_set_size; i++) {
+      if (i % 2 == 0) {
+        ASSERT_EQ(table.Get(keys[i]), items[i]);
+        ASSERT_NE(nullptr, items[i]);
+      } else {
+        ASSERT_EQ(nullptr, items[i]);
+      }
+    }
+
+    const auto inserted = table.MultiGetOrInsert(keys);
+    for (size_t i = 0; i < working_set_size; i++) {
+      ASSERT_NE(nullptr, inserted[i]);
+      ASSERT_EQ(table.Get(keys[i]), inserted[i]);
+    }
+  }
+}
+
+TEST(ConcurrentTableTest, OLCBTreeContainerOrdersKeysWithCommonPrefixes) {
+  LineairDB::Index::OLCBTreeContainer tree;
+  // Keys shorter than, equal to, and longer than the inline prefix, with
+  // common prefixes and bytes above 0x7F.
+  std::vector<std::string> keys;
+  for (size_t i = 0; i < 1000; i++) {
+    auto key = std::to_string(i);
+    keys.push_back(key);
+    keys.push_back("prefix__" + key);
+    keys.push_back(std::string("prefix\xff") + key);
+    keys.push_back(std::string(key.size(), '\0') + key);
+  }
+  for (auto it = keys.rbegin(); it != keys.rend(); it++) tree.Put(*it, false);
+
+  std::sort(keys.begin(), keys.end());
+  std::vector<std::string> scanned;
+  tree.Scan("", std::nullopt, [&](auto key) {
+    scanned.emplace_back(key);
+    return false;
+  });
+  ASSERT_EQ(keys, scanned);
+
+  const auto count =
+      tree.Scan("prefix__1", "prefix__2", [](auto) { return false; });
+  ASSERT_EQ(112, count);  // 1, 10-19, 100-199 and 2
+}
+
+TEST(ConcurrentTableTest, KeyStoreKeepsInternedKeys) {
+  LineairDB::Index::KeyStore store;
+  // Empty keys, odd lengths, and a key larger than a chunk.
+  std::vector<std::string> keys = {"", std::string(1 << 17, 'x')};
+  for (size_t i = 0; i < 10000; i++) keys.push_back(std::to_string(i));
+  std::vector<const LineairDB::Index::KeyStore::Key*> handles;
+  for (auto& key : keys) handles.push_back(store.Intern(key));
+  for (size_t i = 0; i < keys.size(); i++) {
+    ASSERT_EQ(keys[i], handles[i]->View());
+  }
+  ASSERT_LE(keys[1].size(), store.Bytes());
+}
+
+TEST(ConcurrentTableTest, ParallelForEachVisitsEachKeyOnce) {
+  LineairDB::EpochFramework epoch;
+  epoch.Start();
+  LineairDB::Index::ConcurrentTable table(epoch);
+  constexpr size_t Keys = 10000;
+  for (size_t i = 0; i < Keys; i++) {
+    table.Put(std::to_string(i), LineairDB::DataItem{});
+  }
+
+  constexpr size_t Partitions = 4;
+  std::vector<std::vector<std::string>> visited(Partitions);
+  table.ParallelForEach(
+      Partitions,
+      [&](size_t partition, auto key, auto&) {
+        visited[partition].emplace_back(key);
+        return true;
+      },
+      [](size_t partitions, const std::function<void(size_t)>& job) {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < partitions; i++) threads.emplace_back(job, i);
+        for (auto& thread : threads) thread.join();
+      });
+
+  std::vector<std::string> keys;
+  for (auto& partition : visited) {
+    ASSERT_FALSE(partition.empty());
+    keys.insert(keys.end(), partition.begin(), partition.end());
+  }
+  std::sort(keys.begin(), keys.end());
+  ASSERT_EQ(Keys, keys.size());
+  ASSERT_EQ(keys.end(), std::adjacent_find(keys.begin(), keys.end()));
+}
+
+TEST(ConcurrentTableTest, ParallelForEachDoesNotBlockRehashing) {
+  LineairDB::EpochFramework epoch;
+  epoch.Start();
+  LineairDB::Index::ConcurrentTable table(epoch);
+  constexpr size_t Keys = 10000;
+  for (size_t i = 0; i < Keys; i++) {
+    table.Put(std::to_string(i), LineairDB::DataItem{});
+  }
+
+  // The puts during the visit overflow the table; they wait for a rehash.
+  bool inserted = false;
+  std::vector<std::string> visited;
+  table.ParallelForEach(
+      1,
+      [&](size_t, auto key, auto&) {
+        if (!inserted) {
+          inserted = true;
+          for (size_t i = Keys; i < 2 * Keys; i++) {
+            table.Put(std::to_string(i), LineairDB::DataItem{});
+          }
+        }
+        visited.emplace_back(key);
+        return true;
+      },
+      [](size_t, const std::function<void(size_t)>& job) {
+        std::thread(job, 0).join();
+      });
+
+  for (size_t i = Keys; i < 2 * Keys; i++) {
+    ASSERT_NE(nullptr, table.Get(std::to_string(i)));
+  }
+  std::sort(visited.begin(), visited.end());
+  ASSERT_EQ(visited.end(), std::adjacent_find(visited.begin(), visited.end()));
+  for (size_t i = 0; i < Keys; i++) {
+    ASSERT_TRUE(std::binary_search(visited.begin(), visited.end(),
+                                   std::to_string(i)));
+  }
+}
+
+TEST(ConcurrentTableTest, ParallelForEachDuringRehashingVisitsPutKeys) {
+  // A checkpoint captures the keys put before it, even if they have been put
+  // into the next table of a running migration.
+  LineairDB::EpochFramework epoch;
+  epoch.Start();
+  LineairDB::Index::ConcurrentTable table(epoch);
+  constexpr size_t Keys = 200000;
+  std::atomic<size_t> put(0);
+  std::thread writer([&]() {
+    for (size_t i = 0; i < Keys; i++) {
+      table.Put(std::to_string(i), LineairDB::DataItem{});
+      put.store(i + 1);
+    }
+  });
+
+  while (put.load() < Keys) {
+    const size_t before = put.load();
+    std::vector<bool> visited(Keys, false);
+    table.ParallelForEach(
+        1,
+        [&](size_t, auto key, auto&) {
+          visited[std::stoul(std::string(key))] = true;
+          return true;
+        },
+        [](size_t, const std::function<void(size_t)>& job) {
+          std::thread(job, 0).join();
+        });
+    for (size_t i = 0; i < before; i++) ASSERT_TRUE(visited[i]) << i;
+  }
+  writer.join();
+}
+
+TEST(ConcurrentTableTest, EraseTombstone) {
+  LineairDB::EpochFramework epoch;
+  epoch.Start();
+  LineairDB::Index::ConcurrentTable table(epoch);
+  int value = 1;
+  table.Put("alice", LineairDB::DataItem(reinterpret_cast<std::byte*>(&value),
+                                          sizeof(int), {1, 2}));
+  table.GetOrInsert("bob");  // a blank item is absent, as a tombstone is
+
+  epoch.MakeMeOnline();
+  ASSERT_TRUE(table.EraseTombstone("alice", 1));
+  ASSERT_NE(nullptr, table.Get("alice"));  // not a tombstone
+  ASSERT_TRUE(table.EraseTombstone("bob", 1));
+  ASSERT_EQ(nullptr, table.Get("bob"));
+  auto* bob = table.GetOrInsert("bob");
+  ASSERT_NE(nullptr, bob);
+  ASSERT_FALSE(bob->IsRemoved());
+  epoch.MakeMeOffline();
+}
+
+TEST(ConcurrentTableTest, RangeIndexHasInsertionsOfThreadsAtOnce) {
+  LineairDB::EpochFramework epoch;
+  epoch.Start();
+  LineairDB::Index::ConcurrentTable table(epoch);
+  constexpr size_t Threads = 4;
+  constexpr size_t Keys    = 1000;
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < Threads; t++) {
+    threads.emplace_back([&, t]() {
+      epoch.MakeMeOnline();
+      for (size_t i = 0; i < Keys; i++) {
+        table.GetOrInsert(std::to_string(t * Keys + i));
+      }
+      epoch.MakeMeOffline();
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  // A key is erased on a thread, and inserted again on another thread.
+  epoch.MakeMeOnline();
+  ASSERT_TRUE(table.EraseTombstone("0", 0));
+  epoch.MakeMeOffline();
+  std::thread([&]() {
+    epoch.MakeMeOnline();
+    table.GetOrInsert("0");
+    epoch.MakeMeOffline();
+  }).join();
+
+  // No epoch has passed; the scan finds all the keys anyway.
+  epoch.MakeMeOnline();
+  const auto count = table.Scan("", std::nullopt,
+                                [&](auto key, LineairDB::DataItem& item) {
+                                  EXPECT_EQ(table.Get(key), &item);
+                                  return false;
+                                });
+  epoch.MakeMeOffline();
+  ASSERT_TRUE(count.has_value());
+  ASSERT_EQ(Threads * Keys, count.value());
+}
+
+TEST(ConcurrentTableTest, ErasedKeysAreCompacted) {
+  // Test scenario: keys are inserted and erased repeatedly, so that the
+  // erased slots are dropped by rehashing.
+  for (auto probing : {LineairDB::Config::HashIndexProbing::LinearProbing,
+                       LineairDB::Config::HashIndexProbing::CuckooHashing}) {
+    LineairDB::EpochFramework epoch;
+    LineairDB::Config config;
+    config.rehash_threshold   = 0.5;
+    config.hash_index_probing = probing;
+    epoch.Start();
+    LineairDB::Index::ConcurrentTable table(epoch, config);
+
+    epoch.MakeMeOnline();
+    constexpr size_t Keys = 4096;
+    for (size_t round = 0; round < 4; round++) {
+      for (size_t i = 0; i < Keys; i++) {
+        table.GetOrInsert(std::to_string(round * Keys + i));
+      }
+      for (size_t i = 0; i < Keys; i += 2) {
+        ASSERT_TRUE(table.EraseTombstone(std::to_string(round * Keys + i), 0));
+      }
+      for (size_t i = 0; i < Keys; i++) {
+        auto* item = table.Get(std::to_string(round * Keys + i));
+        if (i % 2 == 0) {
+          ASSERT_EQ(nullptr, item);
+        } else {
+          ASSERT_NE(nullptr, item);
+        }
+      }
+    }
+    epoch.MakeMeOffline();
+  }
+}
+
+TEST(ConcurrentTableTest, EvictColdValues) {
+  LineairDB::EpochFramework epoch;
+  epoch.Start();
+  LineairDB::Index::ConcurrentTable table(epoch);
+  LineairDB::Index::ColdStore store("./cold_storage_test.dat");
+
+  constexpr size_t Keys = 64;
+  const std::string value(1024, 'v');
+  for (size_t i = 0; i < Keys; i++) {
+    LineairDB::DataItem item(reinterpret_cast<const std::byte*>(value.data()),
+                             value.size());
+    table.Put(std::to_string(i), std::move(item));
+  }
+  // A referenced item survives the first round of the clock hand.
+  table.Get("0")->Touch();
+
+  ASSERT_EQ((Keys - 1) * value.size(),
+            table.EvictColdValues(store, (Keys - 1) * value.size()));
+  ASSERT_EQ((Keys - 1) * value.size(), store.GetBytes());
+  for (size_t i = 0; i < Keys; i++) {
+    auto* item = table.Get(std::to_string(i));
+    ASSERT_EQ(i == 0 ? value.size() : 0, item->buffer.HeapBytes());
+    ASSERT_EQ(value, item->buffer.toString());
+  }
+  // The evicted values are not evicted twice; the rest is evicted next time.
+  ASSERT_EQ(value.size(), table.EvictColdValues(store, Keys * value.size()));
+  constexpr size_t TooLarge = LineairDB::Index::ColdStore::SegmentSize + 1;
+  ASSERT_EQ(nullptr,
+            store.Append(reinterpret_cast<const std::byte*>(""), TooLarge));
+}
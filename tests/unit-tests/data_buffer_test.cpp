@@ -0,0 +1,71 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "types/data_buffer.hpp"
+
+#include <string>
+
+#include "gtest/gtest.h"
+
+using LineairDB::DataBuffer;
+
+TEST(DataBufferTest, EmptyBufferHasNoData) {
+  DataBuffer buffer;
+  ASSERT_TRUE(buffer.IsEmpty());
+  ASSERT_EQ(nullptr, buffer.data());
+  buffer.Reset(std::string("alice"));
+  ASSERT_NE(nullptr, buffer.data());
+  buffer.Reset(nullptr, 0);
+  ASSERT_TRUE(buffer.IsEmpty());
+  ASSERT_EQ(nullptr, buffer.data());
+}
+
+TEST(DataBufferTest, SwitchesBetweenInlineAndHeapValues) {
+  const std::string small(DataBuffer::InlineCapacity, 'a');
+  const std::string large(DataBuffer::InlineCapacity * 4, 'b');
+  DataBuffer buffer;
+  buffer.Reset(small);
+  ASSERT_EQ(small, buffer.toString());
+  buffer.Reset(large);
+  ASSERT_EQ(large, buffer.toString());
+  // a smaller value reuses the heap area
+  buffer.Reset(small);
+  ASSERT_EQ(small, buffer.toString());
+
+  DataBuffer copied(buffer);
+  ASSERT_EQ(small, copied.toString());
+  ASSERT_NE(buffer.data(), copied.data());
+  copied = DataBuffer();
+  ASSERT_TRUE(copied.IsEmpty());
+}
+
+TEST(DataBufferTest, ReferredAreaIsSharedUntilUpdate) {
+  const std::string external(DataBuffer::InlineCapacity * 4, 'c');
+  const auto* area = reinterpret_cast<const std::byte*>(external.data());
+  DataBuffer buffer;
+  buffer.Refer(area, external.size());
+  ASSERT_EQ(area, buffer.data());
+
+  // A copy refers to the same area.
+  DataBuffer copy(buffer);
+  ASSERT_EQ(area, copy.data());
+
+  // An update does not write into the area.
+  copy.Reset(std::string("alice"));
+  ASSERT_NE(area, copy.data());
+  ASSERT_EQ("alice", copy.toString());
+  ASSERT_EQ(external, buffer.toString());
+}
@@ -0,0 +1,100 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "util/epoch_framework.hpp"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "util/thread_slots.hpp"
+
+using LineairDB::EpochFramework;
+
+TEST(EpochFrameworkTest, KeepsEpochsOfEachFramework) {
+  // More frameworks than a thread caches the slots of.
+  std::vector<std::unique_ptr<EpochFramework>> frameworks;
+  for (size_t i = 0; i < 8; i++) {
+    frameworks.emplace_back(std::make_unique<EpochFramework>(1));
+    frameworks.back()->SetGlobalEpoch(i + 1);
+    frameworks.back()->Start();
+  }
+  for (auto& framework : frameworks) framework->MakeMeOnline();
+  for (size_t i = 0; i < frameworks.size(); i++) {
+    ASSERT_EQ(i + 1, frameworks[i]->GetMyThreadLocalEpoch());
+    ASSERT_EQ(i + 1, frameworks[i]->GetSmallestEpoch());
+  }
+  for (auto& framework : frameworks) framework->MakeMeOffline();
+  for (auto& framework : frameworks) {
+    ASSERT_EQ(EpochFramework::THREAD_OFFLINE,
+              framework->GetMyThreadLocalEpoch());
+  }
+}
+
+TEST(EpochFrameworkTest, GetSmallestEpochOfManyThreads) {
+  // The slots of more threads than a chunk holds.
+  constexpr size_t Threads = 200;
+  EpochFramework framework(1);
+  framework.Start();
+  std::atomic<size_t> online(0);
+  std::atomic<bool> finished(false);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < Threads; i++) {
+    threads.emplace_back([&, i]() {
+      framework.SetGlobalEpoch(Threads + 10 - i);
+      framework.MakeMeOnline();
+      online++;
+      while (!finished.load()) std::this_thread::yield();
+      framework.MakeMeOffline();
+    });
+    while (online.load() != i + 1) std::this_thread::yield();
+  }
+  ASSERT_EQ(11, framework.GetSmallestEpoch());
+  finished.store(true);
+  for (auto& thread : threads) thread.join();
+  ASSERT_EQ(EpochFramework::THREAD_OFFLINE, framework.GetSmallestEpoch());
+}
+
+TEST(EpochFrameworkTest, ReusesSlotsOfExitedThreads) {
+  // More threads in total than a ThreadSlots can hold at once.
+  constexpr size_t Threads =
+      LineairDB::ThreadSlots<size_t>::SlotsPerChunk *
+          LineairDB::ThreadSlots<size_t>::MaxChunks +
+      10;
+  LineairDB::ThreadSlots<size_t> slots;
+  for (size_t i = 0; i < Threads; i++) {
+    std::thread([&]() { slots.Get()++; }).join();
+  }
+  size_t number_of_slots = 0, sum = 0;
+  slots.ForEach([&](size_t& slot) {
+    number_of_slots++;
+    sum += slot;
+  });
+  ASSERT_EQ(1, number_of_slots);
+  ASSERT_EQ(Threads, sum);
+
+  EpochFramework framework(1);
+  framework.Start();
+  for (size_t i = 0; i < 100; i++) {
+    std::thread([&]() {
+      framework.MakeMeOnline();
+      framework.MakeMeOffline();
+    }).join();
+  }
+  ASSERT_EQ(EpochFramework::THREAD_OFFLINE, framework.GetSmallestEpoch());
+}
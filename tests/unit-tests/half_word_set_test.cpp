@@ -0,0 +1,117 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "util/32bit_set.hpp"
+
+template <uint32_t C, uint32_t S, typename W>
+struct SetType {
+  using Set                             = HalfWordSet<C, S, W>;
+  using Word                            = W;
+  static constexpr uint32_t CounterSize = C;
+  static constexpr uint32_t Slots       = S / C;
+};
+
+template <typename T>
+class HalfWordSetTest : public ::testing::Test {
+ protected:
+  using Word = typename T::Word;
+  static constexpr Word Max = T::Set::MaxVersion;
+
+  static Word GetSlot(const Word set, const uint32_t slot) {
+    return (set >> (slot * T::CounterSize)) & Max;
+  }
+  // a random set, some of whose slots are zero or saturated.
+  static Word MakeSet(std::mt19937_64& engine) {
+    Word set = 0;
+    for (uint32_t slot = 0; slot < T::Slots; slot++) {
+      Word counter = 0;
+      switch (engine() % 4) {
+        case 0:
+          counter = 0;
+          break;
+        case 1:
+          counter = Max;
+          break;
+        default:
+          counter = engine() % (static_cast<uint64_t>(Max) + 1);
+      }
+      set |= counter << (slot * T::CounterSize);
+    }
+    return set;
+  }
+
+  // The slot-by-slot definitions of the operations.
+  static bool IsGreaterThan(const Word lhs, const Word rhs, bool or_equal) {
+    for (uint32_t slot = 0; slot < T::Slots; slot++) {
+      const Word l = GetSlot(lhs, slot);
+      const Word r = GetSlot(rhs, slot);
+      if (l == 0 || r == 0) continue;
+      if (l == Max || r < l || (or_equal && r == l)) return true;
+    }
+    return false;
+  }
+  static Word Merge(const Word lhs, const Word rhs) {
+    Word merged = 0;
+    for (uint32_t slot = 0; slot < T::Slots; slot++) {
+      const Word l = GetSlot(lhs, slot);
+      const Word r = GetSlot(rhs, slot);
+      Word m = T::CounterSize == 1 ? l | r : std::min(l, r);
+      if (l == 0 || r == 0) m = l | r;  // the other one, if any
+      merged |= m << (slot * T::CounterSize);
+    }
+    return merged;
+  }
+};
+
+using SetTypes = ::testing::Types<
+    SetType<1, 32, uint32_t>, SetType<2, 32, uint32_t>,
+    SetType<4, 12, uint32_t>, SetType<8, 32, uint32_t>,
+    SetType<32, 32, uint32_t>, SetType<4, 64, uint64_t>,
+    SetType<3, 63, uint64_t>, SetType<4, 128, unsigned __int128>>;
+TYPED_TEST_SUITE(HalfWordSetTest, SetTypes);
+
+TYPED_TEST(HalfWordSetTest, PutAndGet) {
+  typename TypeParam::Set set;
+  int item;
+  ASSERT_TRUE(set.IsEmpty());
+  set.Put(&item, 1);
+  ASSERT_EQ(1u, set.Get(&item));
+  set.PutHigherside(&item, TypeParam::Set::MaxVersion);
+  ASSERT_EQ(TypeParam::Set::MaxVersion, set.Get(&item));
+  // the versions are saturated.
+  set.Put(&item, UINT32_MAX);
+  ASSERT_EQ(TypeParam::Set::MaxVersion, set.Get(&item));
+}
+
+TYPED_TEST(HalfWordSetTest, OperationsAgreeWithTheSlots) {
+  using Set = typename TypeParam::Set;
+  std::mt19937_64 engine(0);
+  for (size_t i = 0; i < 100000; i++) {
+    const auto lhs = TestFixture::MakeSet(engine);
+    const auto rhs = TestFixture::MakeSet(engine);
+    ASSERT_EQ(TestFixture::IsGreaterThan(lhs, rhs, false),
+              Set(lhs).IsGreaterThan(Set(rhs)));
+    ASSERT_EQ(TestFixture::IsGreaterThan(lhs, rhs, true),
+              Set(lhs).IsGreaterOrEqualThan(Set(rhs)));
+    ASSERT_TRUE(TestFixture::Merge(lhs, rhs) ==
+                Set(lhs).Merge(Set(rhs)).GetBitArray());
+  }
+}
@@ -21,6 +21,9 @@
 
 #include <memory>
 #include <optional>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "../test_helper.hpp"
 #include "gtest/gtest.h"
@@ -103,6 +106,29 @@ TEST_F(IndexTest, ScanWithoutEnd) {
   db_->EndTransaction(tx, [](auto) {});
 }
 
+TEST_F(IndexTest, ScanWithLimit) {
+  auto& tx = db_->BeginTransaction();
+  std::vector<std::string> keys;
+  auto count = tx.Scan("alice", std::nullopt, 2, [&](auto key, auto) {
+    keys.emplace_back(key);
+    return false;
+  });
+  ASSERT_EQ(2, count.value());
+  ASSERT_EQ(std::vector<std::string>({"alice", "bob"}), keys);
+
+  // the deleted keys are not counted.
+  tx.Delete("bob");
+  count = tx.Scan<int>("alice", "carol", 2, [&](auto key, auto value) {
+    EXPECT_TRUE(key == "alice" || key == "carol");
+    EXPECT_EQ(key == "alice" ? 1 : 3, value);
+    return false;
+  });
+  ASSERT_EQ(2, count.value());
+  count = tx.Scan("alice", "carol", 0, [](auto, auto) { return false; });
+  ASSERT_EQ(0, count.value());
+  db_->EndTransaction(tx, [](auto) {});
+}
+
 TEST_F(IndexTest, ScanWithPhantomAvoidance) {
   int dave = 4;
 
@@ -122,3 +148,48 @@ TEST_F(IndexTest, ScanWithPhantomAvoidance) {
     ASSERT_EQ(first, second);
   }
 }
+
+TEST_F(IndexTest, ScanFindsKeysJustInserted) {
+  // The scans right after the insertions do not wait for the epochs.
+  for (int i = 0; i < 10; i++) {
+    const std::string key = "dave" + std::to_string(i);
+    auto& tx              = db_->BeginTransaction();
+    tx.Write<int>(key, i);
+    // read-your-own-insert
+    auto count = tx.Scan<int>(key, key, [&](auto, auto value) {
+      EXPECT_EQ(i, value);
+      return false;
+    });
+    ASSERT_TRUE(count.has_value());
+    ASSERT_EQ(1, count.value());
+    ASSERT_TRUE(db_->EndTransaction(tx, [](auto) {}));
+
+    auto& next = db_->BeginTransaction();
+    count      = next.Scan("dave", std::nullopt, [&](auto, auto) {
+      return false;
+    });
+    ASSERT_TRUE(count.has_value());
+    ASSERT_EQ(i + 1, static_cast<int>(count.value()));
+    db_->EndTransaction(next, [](auto) {});
+  }
+}
+
+TEST_F(IndexTest, ScanSkipsKeysOfRunningTransactions) {
+  auto& writer = db_->BeginTransaction();
+  writer.Write<int>("dave", 4);
+
+  std::optional<size_t> count;
+  std::thread scanner([&]() {
+    auto& tx = db_->BeginTransaction();
+    count = tx.Scan("alice", std::nullopt, [&](auto key, auto) {
+      EXPECT_NE("dave", key);
+      return false;
+    });
+    db_->EndTransaction(tx, [](auto) {});
+  });
+  scanner.join();
+  // the key uncommitted is read as an absent one.
+  ASSERT_TRUE(count.has_value());
+  ASSERT_EQ(3, count.value());
+  db_->EndTransaction(writer, [](auto) {});
+}
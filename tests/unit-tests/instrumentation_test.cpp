@@ -0,0 +1,50 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "util/instrumentation.hpp"
+
+#include <cstdint>
+#include <memory>
+
+#include "gtest/gtest.h"
+
+using LineairDB::Instrumentation::Histogram;
+
+TEST(HistogramTest, BucketsAreContiguous) {
+  ASSERT_EQ(0u, Histogram::BucketOf(0));
+  for (uint64_t value = 1; value < (1u << 20); value++) {
+    const auto bucket = Histogram::BucketOf(value);
+    ASSERT_LT(bucket, Histogram::Buckets);
+    ASSERT_LE(value, Histogram::HighestValueOf(bucket));
+    ASSERT_LT(Histogram::HighestValueOf(bucket - 1), value);
+  }
+}
+
+TEST(HistogramTest, PercentilesAreAccurateToSubBuckets) {
+  auto histogram = std::make_unique<Histogram>();
+  for (uint64_t value = 1; value <= 10000; value++) histogram->Record(value);
+  histogram->Record(1000000, 20);
+
+  Histogram::Merged merged;
+  merged.Add(*histogram);
+  const auto latency = merged.Summarize();
+  ASSERT_EQ(10020u, latency.count);
+  ASSERT_EQ(1000000u, latency.max_ns);
+  ASSERT_NEAR(5000, latency.p50_ns, 5000 / Histogram::SubBuckets);
+  ASSERT_NEAR(9000, latency.p90_ns, 9000 / Histogram::SubBuckets);
+  ASSERT_NEAR(9920, latency.p99_ns, 9920 / Histogram::SubBuckets);
+  ASSERT_EQ(1000000u, latency.p999_ns);
+}
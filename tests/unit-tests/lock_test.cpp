@@ -24,6 +24,7 @@
 #include "gtest/gtest.h"
 #include "lock/impl/readers_writers_lock.hpp"
 #include "lock/impl/ttas_lock.hpp"
+#include "lock/wait_policy.hpp"
 #include "util/logger.hpp"
 
 template <typename T>
@@ -90,3 +91,25 @@ TYPED_TEST(LockTest, IsReadersWritersLockingAlgorithm) {
     ASSERT_TRUE(lock.TryLock(TypeParam::LockType::Upgrade));
   }
 }
+
+class WaitPolicyTest
+    : public ::testing::TestWithParam<LineairDB::Config::LockWaitPolicy> {};
+INSTANTIATE_TEST_SUITE_P(
+    ForEachPolicy, WaitPolicyTest,
+    ::testing::Values(LineairDB::Config::LockWaitPolicy::Yield,
+                      LineairDB::Config::LockWaitPolicy::SpinThenBackoff,
+                      LineairDB::Config::LockWaitPolicy::SpinThenPark));
+
+TEST_P(WaitPolicyTest, WaitUntilReleased) {
+  const WaitPolicy wait_policy(GetParam());
+  std::atomic<bool> locked(true);
+  auto waiter = std::async(std::launch::async, [&]() {
+    wait_policy.WaitUntil(&locked, [&]() { return !locked.load(); });
+    ASSERT_FALSE(locked.load());
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  locked.store(false);
+  wait_policy.NotifyReleased(&locked);
+  ASSERT_EQ(std::future_status::ready,
+            waiter.wait_for(std::chrono::seconds(10)));
+}
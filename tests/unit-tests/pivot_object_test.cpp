@@ -0,0 +1,37 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "concurrency_control/pivot_object.hpp"
+
+#include <atomic>
+
+#include "gtest/gtest.h"
+#include "types/data_item.hpp"
+
+using LineairDB::NWRPivotObject;
+
+TEST(PivotObjectTest, DisjointSetsAreNotReachable) {
+  // the seeds share a slot of a set of 3 slots, but not of the 8 ones.
+  NWRPivotObject lhs, rhs;
+  lhs.msets.wset.Put(2u, 1);
+  rhs.msets.rset.Put(3u, 1);
+  ASSERT_EQ(LineairDB::ACYCLIC, lhs.IsReachableInto(rhs));
+}
+
+TEST(PivotObjectTest, DataItemIsNotPaddedByLocks) {
+  ASSERT_EQ(alignof(std::atomic<NWRPivotObject>),
+            alignof(LineairDB::DataItem));
+}
@@ -0,0 +1,76 @@
+/*
+ *   Copyright (C) 2020 Nippon Telegraph and Telephone Corporation.
+
+ *   Licensed under the Apache License, Version 2.0 (the "License");
+ *   you may not use this file except in compliance with the License.
+ *   You may obtain a copy of the License at
+
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ *   Unless required by applicable law or agreed to in writing, software
+ *   distributed under the License is distributed on an "AS IS" BASIS,
+ *   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *   See the License for the specific language governing permissions and
+ *   limitations under the License.
+ */
+
+#include "util/quiescent_counters.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using LineairDB::QuiescentCounters;
+
+TEST(QuiescentCountersTest, WaitForReadersInCriticalSections) {
+  QuiescentCounters readers;
+  std::atomic<bool> entered(false);
+  std::atomic<bool> exited(false);
+  std::thread reader([&]() {
+    readers.Enter();
+    entered.store(true);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    exited.store(true);
+    readers.Exit();
+  });
+  while (!entered.load()) std::this_thread::yield();
+  readers.WaitForReaders();
+  ASSERT_TRUE(exited.load());
+  reader.join();
+
+  // Idle readers are not waited for.
+  readers.WaitForReaders();
+}
+
+TEST(QuiescentCountersTest, ReclaimUnpublishedObjects) {
+  constexpr size_t Readers = 4;
+  QuiescentCounters readers;
+  std::atomic<std::atomic<size_t>*> object(new std::atomic<size_t>(0));
+  std::atomic<bool> finished(false);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < Readers; i++) {
+    threads.emplace_back([&]() {
+      while (!finished.load()) {
+        readers.Enter();
+        object.load()->fetch_add(1);
+        readers.Exit();
+      }
+    });
+  }
+  for (size_t i = 0; i < 100; i++) {
+    auto* old = object.exchange(new std::atomic<size_t>(0));
+    readers.WaitForReaders();
+    // The old object is unreachable and no reader holds it.
+    const size_t reads = old->load();
+    std::this_thread::yield();
+    ASSERT_EQ(reads, old->load());
+    delete old;
+  }
+  finished.store(true);
+  for (auto& thread : threads) thread.join();
+  delete object.load();
+}
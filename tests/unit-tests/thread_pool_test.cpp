@@ -17,8 +17,10 @@
 #include "thread_pool/thread_pool.h"
 
 #include <mutex>
+#include <optional>
 #include <set>
 #include <thread>
+#include <vector>
 
 #include "gtest/gtest.h"
 
@@ -88,3 +90,79 @@ TEST(ThreadPoolTest, EnqueueForAllThreads) {
 
   Blocking(num_of_running_txns);
 }
+
+TEST(ThreadPoolTest, EnqueueToPartition) {
+  LineairDB::ThreadPool thread_pool(10, true);
+  ASSERT_LE(1, thread_pool.GetNumberOfNodes());
+  std::atomic<size_t> num_of_running_txns(100);
+
+  for (size_t i = 0; i < 100; i++) {
+    ASSERT_TRUE(thread_pool.EnqueueToPartition(
+        [&]() { num_of_running_txns--; }, i));
+  }
+  Blocking(num_of_running_txns);
+}
+
+TEST(ThreadPoolTest, NumaAwareEnqueueForAllThreads) {
+  LineairDB::ThreadPool thread_pool(10, true);
+  std::atomic<size_t> num_of_running_txns(10);
+  std::mutex lock;
+  std::set<std::thread::id> workers;
+
+  thread_pool.EnqueueForAllThreads([&]() {
+    std::lock_guard<std::mutex> guard(lock);
+    workers.insert(std::this_thread::get_id());
+    num_of_running_txns--;
+  });
+
+  Blocking(num_of_running_txns);
+  ASSERT_EQ(10, workers.size());
+}
+
+TEST(ThreadPoolTest, WakeUpParkedWorkers) {
+  LineairDB::ThreadPool thread_pool(4, false, 0);
+  for (size_t round = 0; round < 10; round++) {
+    // Let the workers park.
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    std::atomic<size_t> num_of_running_txns(10);
+    for (size_t i = 0; i < 10; i++) {
+      ASSERT_TRUE(thread_pool.Enqueue([&]() { num_of_running_txns--; }));
+    }
+    Blocking(num_of_running_txns);
+    thread_pool.WaitForQueuesToBecomeEmpty();
+  }
+}
+
+TEST(ThreadPoolTest, EnqueueBulk) {
+  LineairDB::ThreadPool thread_pool(4);
+  std::atomic<size_t> num_of_running_txns(100);
+  std::mutex lock;
+  std::set<std::thread::id> workers_of_partition;
+
+  std::vector<LineairDB::ThreadPool::Job> jobs;
+  std::vector<std::optional<size_t>> partitions;
+  for (size_t i = 0; i < 100; i++) {
+    if (i % 2 == 0) {
+      jobs.emplace_back([&]() {
+        std::lock_guard<std::mutex> guard(lock);
+        workers_of_partition.insert(std::this_thread::get_id());
+        num_of_running_txns--;
+      });
+      partitions.emplace_back(42);
+    } else {
+      jobs.emplace_back([&]() { num_of_running_txns--; });
+      partitions.emplace_back(std::nullopt);
+    }
+  }
+  ASSERT_TRUE(thread_pool.EnqueueBulk(jobs, partitions));
+  ASSERT_TRUE(jobs.empty());
+  Blocking(num_of_running_txns);
+  thread_pool.WaitForQueuesToBecomeEmpty();
+  // Work stealing may move a job of the partition to another worker.
+  ASSERT_LE(1, workers_of_partition.size());
+
+  thread_pool.StopAcceptingTransactions();
+  jobs.emplace_back([]() {});
+  ASSERT_FALSE(thread_pool.EnqueueBulk(jobs));
+  ASSERT_EQ(1, jobs.size());
+}